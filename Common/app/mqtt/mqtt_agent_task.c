@@ -65,6 +65,24 @@
 #include "mbedtls_transport.h"
 #include "sys_evt.h"
 
+#if MQTT_AGENT_USE_ALTCP_TRANSPORT
+#include "mbedtls_altcp_transport.h"
+
+#define mbedtls_transport_allocate           mbedtls_altcp_transport_allocate
+#define mbedtls_transport_free               mbedtls_altcp_transport_free
+#define mbedtls_transport_configure          mbedtls_altcp_transport_configure
+#define mbedtls_transport_setrecvcallback    mbedtls_altcp_transport_setrecvcallback
+#define mbedtls_transport_connect            mbedtls_altcp_transport_connect
+#define mbedtls_transport_disconnect         mbedtls_altcp_transport_disconnect
+#define mbedtls_transport_recv               mbedtls_altcp_transport_recv
+#define mbedtls_transport_send               mbedtls_altcp_transport_send
+#if TLS_TRANSPORT_WRITEV_ENABLED
+#define mbedtls_transport_writev             mbedtls_altcp_transport_writev
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
+#define mbedtls_transport_get_mem_usage      mbedtls_altcp_transport_get_mem_usage
+#define mbedtls_transport_get_stats          mbedtls_altcp_transport_get_stats
+#endif /* MQTT_AGENT_USE_ALTCP_TRANSPORT */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -202,6 +220,13 @@ static MQTTStatus_t prvHandleResubscribe( MQTTAgentContext_t * pxMqttAgentCtx,
  */
 static uint32_t prvGetTimeMs( void );
 
+/**
+ * @brief Log the RAM held by the TLS connection and the mqtt network buffer.
+ *
+ * @param[in] pxNetworkContext Network context of the connection.
+ */
+static void prvLogConnectionMemUsage( NetworkContext_t * pxNetworkContext );
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -859,6 +884,9 @@ static MQTTStatus_t prvConfigureAgentTaskCtx( MQTTAgentTaskCtx_t * pxCtx,
         pxCtx->xTransport.pNetworkContext = pxNetworkContext;
         pxCtx->xTransport.send = mbedtls_transport_send;
         pxCtx->xTransport.recv = mbedtls_transport_recv;
+#if TLS_TRANSPORT_WRITEV_ENABLED
+        pxCtx->xTransport.writev = mbedtls_transport_writev;
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
 
         /* MQTTConnectInfo_t */
         /* Always start the initial connection with a clean session */
@@ -955,6 +983,47 @@ MQTTAgentHandle_t xGetMqttAgentHandle( void )
 
 /*-----------------------------------------------------------*/
 
+BaseType_t xGetMqttAgentTransportStats( TlsTransportStats_t * pxStats )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( ( xDefaultInstanceHandle != NULL ) &&
+        ( pxStats != NULL ) )
+    {
+        NetworkContext_t * pxNetworkContext = xDefaultInstanceHandle->mqttContext.transportInterface.pNetworkContext;
+
+        if( mbedtls_transport_get_stats( pxNetworkContext, pxStats ) == 0 )
+        {
+            xResult = pdTRUE;
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLogConnectionMemUsage( NetworkContext_t * pxNetworkContext )
+{
+    TlsTransportMemUsage_t xMemUsage = { 0 };
+
+    if( mbedtls_transport_get_mem_usage( pxNetworkContext, &xMemUsage ) == 0 )
+    {
+        /* The TLS buffers only shrink when MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH is
+         * enabled and the server accepted the maximum fragment length. The mqtt
+         * network buffer is allocated once at its full size. */
+        LogInfo( "Connection RAM: TLS in: %lu bytes, TLS out: %lu bytes, mqtt network buffer: %lu bytes, "
+                 "transport context: %lu bytes, session heap: %ld bytes.",
+                 ( unsigned long ) xMemUsage.uxInBufLen,
+                 ( unsigned long ) xMemUsage.uxOutBufLen,
+                 ( unsigned long ) MQTT_AGENT_NETWORK_BUFFER_SIZE,
+                 ( unsigned long ) xMemUsage.uxContextSize,
+                 ( long ) xMemUsage.lSessionHeapDelta );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 void vMQTTAgentTask( void * pvParameters )
 {
     MQTTStatus_t xMQTTStatus = MQTTSuccess;
@@ -1189,6 +1258,8 @@ void vMQTTAgentTask( void * pvParameters )
 
         if( xMQTTStatus == MQTTSuccess )
         {
+            prvLogConnectionMemUsage( pxNetworkContext );
+
             ( void ) xEventGroupSetBits( xSystemEvents, EVT_MASK_MQTT_CONNECTED );
 
             /* Reset backoff timer */
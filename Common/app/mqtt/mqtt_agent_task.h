@@ -2,12 +2,16 @@
 #define _MQTT_AGENT_TASK_H_
 
 #include "FreeRTOS.h"
+#include "mbedtls_transport.h"
 
 struct MQTTAgentTaskCtx;
 typedef struct MQTTAgentContext * MQTTAgentHandle_t;
 
 MQTTAgentHandle_t xGetMqttAgentHandle( void );
 
+/* Copy the transport statistics of the MQTT agent connection. Returns pdFALSE if unavailable. */
+BaseType_t xGetMqttAgentTransportStats( TlsTransportStats_t * pxStats );
+
 /* Event group based mechanism that can be used to block tasks until agent is ready */
 void vSleepUntilMQTTAgentReady( void );
 
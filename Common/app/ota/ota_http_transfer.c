@@ -0,0 +1,822 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_INFO
+
+#include "logging.h"
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "rtos_time.h"
+
+#include "ota_http_transfer.h"
+
+#include "core_http_client.h"
+#include "mbedtls_transport.h"
+
+/*-----------------------------------------------------------*/
+
+#define otahttpHTTPS_PREFIX              "https://"
+#define otahttpHTTPS_PORT                ( 443U )
+
+/**
+ * @brief Longest host name accepted in a url.
+ */
+#define otahttpMAX_HOST_LEN              ( 253U )
+
+/**
+ * @brief Space reserved for the request headers, besides the path of the url.
+ */
+#define otahttpREQUEST_HEADER_SIZE       ( 256U )
+
+#define otahttpSTATUS_PARTIAL_CONTENT    ( 206U )
+#define otahttpCONTENT_RANGE_FIELD       "Content-Range"
+#define otahttpCONTENT_RANGE_UNIT        "bytes "
+
+#define otahttpFETCH_TASK_STACK_SIZE     ( 2048 )
+#define otahttpFETCH_TASK_PRIORITY       ( tskIDLE_PRIORITY + 2 )
+
+/*-----------------------------------------------------------*/
+
+typedef struct OtaHttpRange
+{
+    uint8_t * pucBuffer;     /**< Response buffer, the headers followed by the body. */
+    const uint8_t * pucBody; /**< Body of the response, in pucBuffer. */
+    uint32_t ulOffset;       /**< File offset of the range. */
+    uint32_t ulLength;       /**< Number of bytes fetched. */
+    BaseType_t xResult;      /**< pdPASS when the range was fetched. */
+} OtaHttpRange_t;
+
+typedef struct OtaHttpTransfer
+{
+    /* Url of the file */
+    char * pcUrl;
+    char cHost[ otahttpMAX_HOST_LEN + 1 ];
+    size_t uxHostLen;
+    const char * pcPath; /* Path and query of the url, in pcUrl */
+    size_t uxPathLen;
+    uint16_t usPort;
+
+    /* Connection, only used by the fetch task once it was started */
+    NetworkContext_t * pxNetworkContext;
+    TransportInterface_t xTransport;
+    BaseType_t xConnected;
+    uint8_t * pucRequestBuffer;
+    size_t uxRequestBufferLen;
+    uint32_t ulRequests;
+    uint32_t ulConnections;
+
+    /* Size of the file, 0 until the first range was fetched */
+    volatile uint32_t ulFileSize;
+
+    /* Ranges are handed to the fetch task through xFetchQueue, and come back
+     * through xDoneQueue in the same order. */
+    OtaHttpRange_t xRanges[ otahttpNUM_RANGES ];
+    OtaHttpRange_t * pxCurrent; /* Range being read, NULL when none. */
+    uint32_t ulNextOffset;      /* Offset of the next range to fetch. */
+    uint32_t ulPending;         /* Ranges owned by the fetch task. */
+    QueueHandle_t xFetchQueue;  /* NULL stops the fetch task. */
+    QueueHandle_t xDoneQueue;   /* NULL once the fetch task stopped. */
+    TaskHandle_t xFetchTask;
+} OtaHttpTransfer_t;
+
+static OtaHttpTransfer_t * pxTransfer = NULL;
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvParseUrl( OtaHttpTransfer_t * pxCtx )
+{
+    BaseType_t xResult = pdPASS;
+    const size_t uxPrefixLen = sizeof( otahttpHTTPS_PREFIX ) - 1U;
+    const char * pcHost = NULL;
+    const char * pcCursor = NULL;
+    uint32_t ulPort = 0U;
+
+    if( strncmp( pxCtx->pcUrl, otahttpHTTPS_PREFIX, uxPrefixLen ) != 0 )
+    {
+        LogError( ( "Only https urls are supported." ) );
+        xResult = pdFAIL;
+    }
+    else
+    {
+        pcHost = &( pxCtx->pcUrl[ uxPrefixLen ] );
+        pcCursor = pcHost;
+
+        while( ( *pcCursor != '\0' ) && ( *pcCursor != ':' ) && ( *pcCursor != '/' ) )
+        {
+            pcCursor++;
+        }
+
+        pxCtx->uxHostLen = ( size_t ) ( pcCursor - pcHost );
+
+        if( ( pxCtx->uxHostLen == 0U ) || ( pxCtx->uxHostLen > otahttpMAX_HOST_LEN ) )
+        {
+            LogError( ( "Invalid host name in the url." ) );
+            xResult = pdFAIL;
+        }
+        else
+        {
+            ( void ) memcpy( pxCtx->cHost, pcHost, pxCtx->uxHostLen );
+            pxCtx->cHost[ pxCtx->uxHostLen ] = '\0';
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        pxCtx->usPort = otahttpHTTPS_PORT;
+
+        if( *pcCursor == ':' )
+        {
+            pcCursor++;
+
+            while( ( *pcCursor >= '0' ) && ( *pcCursor <= '9' ) && ( ulPort <= UINT16_MAX ) )
+            {
+                ulPort = ( ulPort * 10U ) + ( uint32_t ) ( *pcCursor - '0' );
+                pcCursor++;
+            }
+
+            if( ( ulPort == 0U ) || ( ulPort > UINT16_MAX ) )
+            {
+                LogError( ( "Invalid port in the url." ) );
+                xResult = pdFAIL;
+            }
+            else
+            {
+                pxCtx->usPort = ( uint16_t ) ulPort;
+            }
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        if( *pcCursor == '/' )
+        {
+            pxCtx->pcPath = pcCursor;
+            pxCtx->uxPathLen = strlen( pcCursor );
+        }
+        else if( *pcCursor == '\0' )
+        {
+            pxCtx->pcPath = "/";
+            pxCtx->uxPathLen = 1U;
+        }
+        else
+        {
+            LogError( ( "Invalid url." ) );
+            xResult = pdFAIL;
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvConnect( OtaHttpTransfer_t * pxCtx )
+{
+    TlsTransportStatus_t xTlsStatus;
+
+    xTlsStatus = mbedtls_transport_connect( pxCtx->pxNetworkContext,
+                                            pxCtx->cHost,
+                                            pxCtx->usPort,
+                                            otahttpSOCKET_TIMEOUT_MS,
+                                            otahttpSOCKET_TIMEOUT_MS );
+
+    if( xTlsStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        pxCtx->xConnected = pdTRUE;
+        pxCtx->ulConnections++;
+    }
+    else
+    {
+        LogError( ( "Failed to connect to %s:%u, error: %d.",
+                    pxCtx->cHost, pxCtx->usPort, xTlsStatus ) );
+    }
+
+    return pxCtx->xConnected;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDisconnect( OtaHttpTransfer_t * pxCtx )
+{
+    if( pxCtx->xConnected == pdTRUE )
+    {
+        mbedtls_transport_disconnect( pxCtx->pxNetworkContext );
+        pxCtx->xConnected = pdFALSE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvParseNumber( const char ** ppcCursor,
+                                  const char * pcEnd,
+                                  uint32_t * pulNumber )
+{
+    BaseType_t xResult = pdFAIL;
+    const char * pcCursor = *ppcCursor;
+    uint32_t ulNumber = 0U;
+    uint32_t ulDigit;
+
+    while( ( pcCursor < pcEnd ) && ( *pcCursor >= '0' ) && ( *pcCursor <= '9' ) )
+    {
+        ulDigit = ( uint32_t ) ( *pcCursor - '0' );
+
+        if( ulNumber > ( ( UINT32_MAX - ulDigit ) / 10U ) )
+        {
+            xResult = pdFAIL;
+            break;
+        }
+
+        ulNumber = ( ulNumber * 10U ) + ulDigit;
+        xResult = pdPASS;
+        pcCursor++;
+    }
+
+    *ppcCursor = pcCursor;
+    *pulNumber = ulNumber;
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Parse a "bytes <first>-<last>/<size>" Content-Range value */
+static BaseType_t prvParseContentRange( const char * pcValue,
+                                        size_t uxValueLen,
+                                        uint32_t * pulFirst,
+                                        uint32_t * pulLast,
+                                        uint32_t * pulSize )
+{
+    BaseType_t xResult = pdFAIL;
+    const size_t uxUnitLen = sizeof( otahttpCONTENT_RANGE_UNIT ) - 1U;
+    const char * pcEnd = &( pcValue[ uxValueLen ] );
+    const char * pcCursor = &( pcValue[ uxUnitLen ] );
+
+    if( ( uxValueLen > uxUnitLen ) &&
+        ( strncmp( pcValue, otahttpCONTENT_RANGE_UNIT, uxUnitLen ) == 0 ) &&
+        ( prvParseNumber( &pcCursor, pcEnd, pulFirst ) == pdPASS ) &&
+        ( pcCursor < pcEnd ) && ( *pcCursor == '-' ) )
+    {
+        pcCursor++;
+
+        if( ( prvParseNumber( &pcCursor, pcEnd, pulLast ) == pdPASS ) &&
+            ( pcCursor < pcEnd ) && ( *pcCursor == '/' ) )
+        {
+            pcCursor++;
+
+            if( ( prvParseNumber( &pcCursor, pcEnd, pulSize ) == pdPASS ) &&
+                ( pcCursor == pcEnd ) &&
+                ( *pulFirst <= *pulLast ) &&
+                ( *pulLast < *pulSize ) )
+            {
+                xResult = pdPASS;
+            }
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvFetchRange( OtaHttpTransfer_t * pxCtx,
+                                 OtaHttpRange_t * pxRange )
+{
+    BaseType_t xResult = pdFAIL;
+    HTTPStatus_t xHttpStatus = HTTPNetworkError;
+    HTTPRequestInfo_t xRequestInfo = { 0 };
+    HTTPRequestHeaders_t xRequestHeaders = { 0 };
+    HTTPResponse_t xResponse = { 0 };
+    const uint32_t ulFileSize = pxCtx->ulFileSize;
+    uint32_t ulLast = pxRange->ulOffset + otahttpRANGE_SIZE - 1U;
+    uint32_t ulRespFirst = 0U;
+    uint32_t ulRespLast = 0U;
+    uint32_t ulRespSize = 0U;
+    const char * pcValue = NULL;
+    size_t uxValueLen = 0U;
+    uint32_t ulAttempt;
+
+    pxRange->pucBody = NULL;
+    pxRange->ulLength = 0U;
+
+    if( ( ulFileSize > 0U ) && ( ulLast >= ulFileSize ) )
+    {
+        ulLast = ulFileSize - 1U;
+    }
+
+    xRequestInfo.pMethod = HTTP_METHOD_GET;
+    xRequestInfo.methodLen = sizeof( HTTP_METHOD_GET ) - 1U;
+    xRequestInfo.pPath = pxCtx->pcPath;
+    xRequestInfo.pathLen = pxCtx->uxPathLen;
+    xRequestInfo.pHost = pxCtx->cHost;
+    xRequestInfo.hostLen = pxCtx->uxHostLen;
+    xRequestInfo.reqFlags = HTTP_REQUEST_KEEP_ALIVE_FLAG;
+
+    if( ( ulFileSize > 0U ) && ( pxRange->ulOffset >= ulFileSize ) )
+    {
+        /* Queued ahead of the end of the file */
+        xResult = pdPASS;
+    }
+    else
+    {
+        /* The server may have closed the kept alive connection since the last
+         * request, so a failed request is retried once on a new connection. */
+        for( ulAttempt = 0U; ( ulAttempt < 2U ) && ( xHttpStatus != HTTPSuccess ); ulAttempt++ )
+        {
+            if( pxCtx->xConnected == pdFALSE )
+            {
+                ( void ) prvConnect( pxCtx );
+            }
+
+            if( pxCtx->xConnected == pdTRUE )
+            {
+                xRequestHeaders.pBuffer = pxCtx->pucRequestBuffer;
+                xRequestHeaders.bufferLen = pxCtx->uxRequestBufferLen;
+                xRequestHeaders.headersLen = 0U;
+
+                xHttpStatus = HTTPClient_InitializeRequestHeaders( &xRequestHeaders, &xRequestInfo );
+
+                if( xHttpStatus == HTTPSuccess )
+                {
+                    xHttpStatus = HTTPClient_AddRangeHeader( &xRequestHeaders,
+                                                             ( int32_t ) pxRange->ulOffset,
+                                                             ( int32_t ) ulLast );
+                }
+
+                if( xHttpStatus == HTTPSuccess )
+                {
+                    ( void ) memset( &xResponse, 0, sizeof( xResponse ) );
+                    xResponse.pBuffer = pxRange->pucBuffer;
+                    xResponse.bufferLen = otahttpRANGE_SIZE + otahttpRESPONSE_HEADER_SIZE;
+                    xResponse.getTime = ulGetTimeMs;
+
+                    pxCtx->ulRequests++;
+                    xHttpStatus = HTTPClient_Send( &( pxCtx->xTransport ),
+                                                   &xRequestHeaders,
+                                                   NULL, 0U,
+                                                   &xResponse, 0U );
+                }
+
+                if( xHttpStatus != HTTPSuccess )
+                {
+                    LogWarn( ( "Request of the range at %lu failed: %s.",
+                               ( unsigned long ) pxRange->ulOffset,
+                               HTTPClient_strerror( xHttpStatus ) ) );
+                    prvDisconnect( pxCtx );
+                }
+            }
+        }
+    }
+
+    if( xHttpStatus == HTTPSuccess )
+    {
+        if( xResponse.statusCode != otahttpSTATUS_PARTIAL_CONTENT )
+        {
+            LogError( ( "Unexpected status %u for the range at %lu.",
+                        xResponse.statusCode, ( unsigned long ) pxRange->ulOffset ) );
+        }
+        else if( ( HTTPClient_ReadHeader( &xResponse,
+                                          otahttpCONTENT_RANGE_FIELD,
+                                          sizeof( otahttpCONTENT_RANGE_FIELD ) - 1U,
+                                          &pcValue, &uxValueLen ) != HTTPSuccess ) ||
+                 ( prvParseContentRange( pcValue, uxValueLen,
+                                         &ulRespFirst, &ulRespLast, &ulRespSize ) != pdPASS ) )
+        {
+            LogError( ( "Missing or invalid Content-Range header." ) );
+        }
+        else if( ( ulRespFirst != pxRange->ulOffset ) ||
+                 ( ulRespLast > ulLast ) ||
+                 ( xResponse.bodyLen != ( size_t ) ( ulRespLast - ulRespFirst + 1U ) ) ||
+                 ( ( ulFileSize > 0U ) && ( ulRespSize != ulFileSize ) ) )
+        {
+            LogError( ( "Response does not match the range requested at %lu.",
+                        ( unsigned long ) pxRange->ulOffset ) );
+        }
+        else
+        {
+            pxCtx->ulFileSize = ulRespSize;
+            pxRange->pucBody = xResponse.pBody;
+            pxRange->ulLength = ( uint32_t ) xResponse.bodyLen;
+            xResult = pdPASS;
+        }
+
+        if( ( xResponse.respFlags & HTTP_RESPONSE_CONNECTION_CLOSE_FLAG ) != 0U )
+        {
+            prvDisconnect( pxCtx );
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFetchTask( void * pvParameters )
+{
+    OtaHttpTransfer_t * pxCtx = ( OtaHttpTransfer_t * ) pvParameters;
+    OtaHttpRange_t * pxRange = NULL;
+
+    for( ; ; )
+    {
+        ( void ) xQueueReceive( pxCtx->xFetchQueue, &pxRange, portMAX_DELAY );
+
+        if( pxRange == NULL )
+        {
+            break;
+        }
+
+        pxRange->xResult = prvFetchRange( pxCtx, pxRange );
+
+        ( void ) xQueueSend( pxCtx->xDoneQueue, &pxRange, portMAX_DELAY );
+    }
+
+    prvDisconnect( pxCtx );
+
+    /* pxRange is NULL: tells vOtaHttpTransferStop that the task is done with the context. */
+    ( void ) xQueueSend( pxCtx->xDoneQueue, &pxRange, portMAX_DELAY );
+
+    vTaskDelete( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFetch( OtaHttpTransfer_t * pxCtx,
+                      OtaHttpRange_t * pxRange )
+{
+    pxRange->ulOffset = pxCtx->ulNextOffset;
+    pxCtx->ulNextOffset += otahttpRANGE_SIZE;
+    pxCtx->ulPending++;
+
+    ( void ) xQueueSend( pxCtx->xFetchQueue, &pxRange, portMAX_DELAY );
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpRange_t * prvWaitRange( OtaHttpTransfer_t * pxCtx )
+{
+    OtaHttpRange_t * pxRange = NULL;
+
+    if( xQueueReceive( pxCtx->xDoneQueue, &pxRange, pdMS_TO_TICKS( otahttpRANGE_TIMEOUT_MS ) ) == pdTRUE )
+    {
+        pxCtx->ulPending--;
+    }
+    else
+    {
+        LogError( ( "Timed out waiting for a range of the file." ) );
+        pxRange = NULL;
+    }
+
+    return pxRange;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Wait for the fetch task to hand back every range, then fetch from ulOffset */
+static BaseType_t prvRestart( OtaHttpTransfer_t * pxCtx,
+                              uint32_t ulOffset )
+{
+    BaseType_t xResult = pdPASS;
+    uint32_t ulIndex;
+
+    pxCtx->pxCurrent = NULL;
+
+    while( ( pxCtx->ulPending > 0U ) && ( xResult == pdPASS ) )
+    {
+        if( prvWaitRange( pxCtx ) == NULL )
+        {
+            xResult = pdFAIL;
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        pxCtx->ulNextOffset = ulOffset;
+
+        for( ulIndex = 0U; ulIndex < otahttpNUM_RANGES; ulIndex++ )
+        {
+            prvFetch( pxCtx, &( pxCtx->xRanges[ ulIndex ] ) );
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvFreeTransfer( OtaHttpTransfer_t * pxCtx )
+{
+    uint32_t ulIndex;
+
+    if( pxCtx->pxNetworkContext != NULL )
+    {
+        mbedtls_transport_free( pxCtx->pxNetworkContext );
+    }
+
+    if( pxCtx->xFetchQueue != NULL )
+    {
+        vQueueDelete( pxCtx->xFetchQueue );
+    }
+
+    if( pxCtx->xDoneQueue != NULL )
+    {
+        vQueueDelete( pxCtx->xDoneQueue );
+    }
+
+    for( ulIndex = 0U; ulIndex < otahttpNUM_RANGES; ulIndex++ )
+    {
+        vPortFree( pxCtx->xRanges[ ulIndex ].pucBuffer );
+    }
+
+    vPortFree( pxCtx->pucRequestBuffer );
+    vPortFree( pxCtx->pcUrl );
+    vPortFree( pxCtx );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xOtaHttpTransferStart( const char * pcUrl )
+{
+    BaseType_t xResult = pdPASS;
+    OtaHttpTransfer_t * pxCtx = NULL;
+    PkiObject_t xRootCa = xPkiObjectFromLabel( otahttpROOT_CA_CERT_LABEL );
+    size_t uxUrlLen;
+    uint32_t ulIndex;
+
+    configASSERT( pcUrl != NULL );
+
+    if( pxTransfer != NULL )
+    {
+        vOtaHttpTransferStop();
+    }
+
+    uxUrlLen = strlen( pcUrl );
+
+    pxCtx = ( OtaHttpTransfer_t * ) pvPortMalloc( sizeof( OtaHttpTransfer_t ) );
+
+    if( pxCtx == NULL )
+    {
+        xResult = pdFAIL;
+    }
+    else
+    {
+        ( void ) memset( pxCtx, 0, sizeof( OtaHttpTransfer_t ) );
+
+        pxCtx->pcUrl = ( char * ) pvPortMalloc( uxUrlLen + 1U );
+        pxCtx->uxRequestBufferLen = uxUrlLen + otahttpREQUEST_HEADER_SIZE;
+        pxCtx->pucRequestBuffer = ( uint8_t * ) pvPortMalloc( pxCtx->uxRequestBufferLen );
+
+        if( ( pxCtx->pcUrl == NULL ) || ( pxCtx->pucRequestBuffer == NULL ) )
+        {
+            xResult = pdFAIL;
+        }
+
+        for( ulIndex = 0U; ulIndex < otahttpNUM_RANGES; ulIndex++ )
+        {
+            pxCtx->xRanges[ ulIndex ].pucBuffer = ( uint8_t * ) pvPortMalloc( otahttpRANGE_SIZE + otahttpRESPONSE_HEADER_SIZE );
+
+            if( pxCtx->xRanges[ ulIndex ].pucBuffer == NULL )
+            {
+                xResult = pdFAIL;
+            }
+        }
+
+        if( xResult == pdFAIL )
+        {
+            LogError( ( "Failed to allocate the buffers of the http transfer." ) );
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        ( void ) memcpy( pxCtx->pcUrl, pcUrl, uxUrlLen + 1U );
+        xResult = prvParseUrl( pxCtx );
+    }
+
+    if( xResult == pdPASS )
+    {
+        pxCtx->xFetchQueue = xQueueCreate( otahttpNUM_RANGES + 1U, sizeof( OtaHttpRange_t * ) );
+        pxCtx->xDoneQueue = xQueueCreate( otahttpNUM_RANGES + 1U, sizeof( OtaHttpRange_t * ) );
+        pxCtx->pxNetworkContext = mbedtls_transport_allocate();
+
+        if( ( pxCtx->xFetchQueue == NULL ) ||
+            ( pxCtx->xDoneQueue == NULL ) ||
+            ( pxCtx->pxNetworkContext == NULL ) )
+        {
+            LogError( ( "Failed to allocate the http transfer context." ) );
+            xResult = pdFAIL;
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        /* The server is authenticated, the device is authorized by the pre-signed url. */
+        if( mbedtls_transport_configure( pxCtx->pxNetworkContext,
+                                         NULL,
+                                         NULL,
+                                         NULL,
+                                         &xRootCa,
+                                         1 ) != TLS_TRANSPORT_SUCCESS )
+        {
+            LogError( ( "Failed to configure the http transfer transport." ) );
+            xResult = pdFAIL;
+        }
+        else
+        {
+            pxCtx->xTransport.pNetworkContext = pxCtx->pxNetworkContext;
+            pxCtx->xTransport.send = mbedtls_transport_send;
+            pxCtx->xTransport.recv = mbedtls_transport_recv;
+#if TLS_TRANSPORT_WRITEV_ENABLED
+            pxCtx->xTransport.writev = mbedtls_transport_writev;
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        xResult = prvConnect( pxCtx );
+    }
+
+    if( xResult == pdPASS )
+    {
+        if( xTaskCreate( prvFetchTask,
+                         "OTAHttp",
+                         otahttpFETCH_TASK_STACK_SIZE,
+                         pxCtx,
+                         otahttpFETCH_TASK_PRIORITY,
+                         &( pxCtx->xFetchTask ) ) != pdPASS )
+        {
+            LogError( ( "Failed to create the http transfer task." ) );
+            prvDisconnect( pxCtx );
+            xResult = pdFAIL;
+        }
+    }
+
+    if( xResult == pdPASS )
+    {
+        LogInfo( ( "Downloading from %s:%u in ranges of %u bytes.",
+                   pxCtx->cHost, pxCtx->usPort, otahttpRANGE_SIZE ) );
+
+        /* The first ranges are fetched while the agent prepares the file. */
+        ( void ) prvRestart( pxCtx, 0U );
+        pxTransfer = pxCtx;
+    }
+    else if( pxCtx != NULL )
+    {
+        prvFreeTransfer( pxCtx );
+    }
+    else
+    {
+        LogError( ( "Failed to allocate the http transfer context." ) );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t lOtaHttpTransferRead( uint32_t ulOffset,
+                              uint8_t * pucBuffer,
+                              uint32_t ulLength )
+{
+    OtaHttpTransfer_t * pxCtx = pxTransfer;
+    OtaHttpRange_t * pxRange = NULL;
+    BaseType_t xRestarted = pdFALSE;
+    BaseType_t xDone = pdFALSE;
+    int32_t lResult = -1;
+    uint32_t ulAvailable;
+
+    configASSERT( pxCtx != NULL );
+    configASSERT( pucBuffer != NULL );
+
+    while( xDone == pdFALSE )
+    {
+        pxRange = pxCtx->pxCurrent;
+
+        if( ( pxCtx->ulFileSize > 0U ) && ( ulOffset >= pxCtx->ulFileSize ) )
+        {
+            lResult = 0;
+            xDone = pdTRUE;
+        }
+        else if( pxRange == NULL )
+        {
+            /* Ranges come back in order, the first one pending is the oldest one fetched */
+            if( ( pxCtx->ulPending > 0U ) &&
+                ( ( ulOffset - ( pxCtx->ulNextOffset - ( pxCtx->ulPending * otahttpRANGE_SIZE ) ) ) < otahttpRANGE_SIZE ) )
+            {
+                pxCtx->pxCurrent = prvWaitRange( pxCtx );
+            }
+            else if( xRestarted == pdFALSE )
+            {
+                xRestarted = pdTRUE;
+
+                if( prvRestart( pxCtx, ulOffset ) == pdPASS )
+                {
+                    pxCtx->pxCurrent = prvWaitRange( pxCtx );
+                }
+            }
+
+            xDone = ( pxCtx->pxCurrent == NULL ) ? pdTRUE : pdFALSE;
+        }
+        else if( pxRange->xResult != pdPASS )
+        {
+            /* The next read fetches the file again from its offset */
+            LogError( ( "Failed to fetch the range at %lu.", ( unsigned long ) pxRange->ulOffset ) );
+            pxCtx->pxCurrent = NULL;
+            xDone = pdTRUE;
+        }
+        else if( ( ulOffset >= pxRange->ulOffset ) &&
+                 ( ( ulOffset - pxRange->ulOffset ) < pxRange->ulLength ) )
+        {
+            ulAvailable = pxRange->ulLength - ( ulOffset - pxRange->ulOffset );
+
+            if( ulLength > ulAvailable )
+            {
+                ulLength = ulAvailable;
+            }
+
+            ( void ) memcpy( pucBuffer, &( pxRange->pucBody[ ulOffset - pxRange->ulOffset ] ), ulLength );
+            lResult = ( int32_t ) ulLength;
+            xDone = pdTRUE;
+        }
+        else if( ( ulOffset >= pxRange->ulOffset ) &&
+                 ( ( ulOffset - pxRange->ulOffset ) / otahttpRANGE_SIZE == 1U ) &&
+                 ( pxRange->ulLength == otahttpRANGE_SIZE ) )
+        {
+            /* Read on into the next range, this one is fetched again further ahead */
+            prvFetch( pxCtx, pxRange );
+            pxCtx->pxCurrent = prvWaitRange( pxCtx );
+            xDone = ( pxCtx->pxCurrent == NULL ) ? pdTRUE : pdFALSE;
+        }
+        else if( xRestarted == pdFALSE )
+        {
+            LogInfo( ( "Restarting the download at %lu.", ( unsigned long ) ulOffset ) );
+            pxCtx->pxCurrent = NULL;
+        }
+        else
+        {
+            pxCtx->pxCurrent = NULL;
+            xDone = pdTRUE;
+        }
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+void vOtaHttpTransferStop( void )
+{
+    OtaHttpTransfer_t * pxCtx = pxTransfer;
+    OtaHttpRange_t * pxRange = NULL;
+
+    if( pxCtx != NULL )
+    {
+        pxTransfer = NULL;
+
+        /* Ranges being fetched are handed back first, then NULL once the task stopped. */
+        ( void ) xQueueSend( pxCtx->xFetchQueue, &pxRange, portMAX_DELAY );
+
+        do
+        {
+            ( void ) xQueueReceive( pxCtx->xDoneQueue, &pxRange, portMAX_DELAY );
+        } while( pxRange != NULL );
+
+        LogInfo( ( "Http transfer done: %lu range requests over %lu connections.",
+                   ( unsigned long ) pxCtx->ulRequests,
+                   ( unsigned long ) pxCtx->ulConnections ) );
+
+        prvFreeTransfer( pxCtx );
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file ota_http_transfer.h
+ * @brief Download of an OTA file over HTTPS with range requests.
+ *
+ * The file given by a pre-signed url is downloaded over a single TLS
+ * connection, kept alive between requests, in ranges of otahttpRANGE_SIZE
+ * bytes. A fetch task requests the next ranges while the file is read from
+ * the current one, so that a range request is sent as soon as the previous
+ * response was received and the download does not wait for the flash writes.
+ *
+ * The file is read in order. Reading an offset outside of the ranges being
+ * fetched, or after a failed request, restarts the download at that offset.
+ * The connection is reopened when the server closes it or a request fails.
+ */
+
+#ifndef _OTA_HTTP_TRANSFER_H_
+#define _OTA_HTTP_TRANSFER_H_
+
+#include "FreeRTOS.h"
+
+#include "ota_config.h"
+
+/**
+ * @brief Number of bytes requested with each range request.
+ * Must be a multiple of otaconfigFILE_BLOCK_SIZE.
+ */
+#ifndef otahttpRANGE_SIZE
+#define otahttpRANGE_SIZE    ( 8U * otaconfigFILE_BLOCK_SIZE )
+#endif
+
+#if ( otahttpRANGE_SIZE % otaconfigFILE_BLOCK_SIZE ) != 0
+#error "otahttpRANGE_SIZE must be a multiple of otaconfigFILE_BLOCK_SIZE."
+#endif
+
+/**
+ * @brief Number of ranges buffered: the range being read and the ranges
+ * fetched ahead of it. Each one takes otahttpRANGE_SIZE +
+ * otahttpRESPONSE_HEADER_SIZE bytes of heap.
+ */
+#ifndef otahttpNUM_RANGES
+#define otahttpNUM_RANGES    2U
+#endif
+
+/**
+ * @brief Space reserved for the headers of each response.
+ */
+#ifndef otahttpRESPONSE_HEADER_SIZE
+#define otahttpRESPONSE_HEADER_SIZE    1024U
+#endif
+
+/**
+ * @brief Label of the root CA certificate authenticating the file server.
+ */
+#ifndef otahttpROOT_CA_CERT_LABEL
+#define otahttpROOT_CA_CERT_LABEL    TLS_ROOT_CA_CERT_LABEL
+#endif
+
+/**
+ * @brief Socket send and receive timeout.
+ */
+#ifndef otahttpSOCKET_TIMEOUT_MS
+#define otahttpSOCKET_TIMEOUT_MS    ( 5000U )
+#endif
+
+/**
+ * @brief Time to wait for a range to be fetched before a read fails.
+ */
+#ifndef otahttpRANGE_TIMEOUT_MS
+#define otahttpRANGE_TIMEOUT_MS    ( 30 * 1000U )
+#endif
+
+/**
+ * @brief Open the connection to the server of pcUrl and start the download.
+ *
+ * @param[in] pcUrl https url of the file. It is copied.
+ *
+ * @return pdPASS when the connection was established.
+ */
+BaseType_t xOtaHttpTransferStart( const char * pcUrl );
+
+/**
+ * @brief Read up to ulLength bytes of the file at ulOffset.
+ *
+ * Blocks until the range holding ulOffset was fetched. Bytes are only read
+ * from a single range, so a read of otaconfigFILE_BLOCK_SIZE bytes at an
+ * offset aligned on the block size returns the whole block.
+ *
+ * @return The number of bytes read, 0 at the end of the file, or -1 when the
+ * range could not be fetched.
+ */
+int32_t lOtaHttpTransferRead( uint32_t ulOffset,
+                              uint8_t * pucBuffer,
+                              uint32_t ulLength );
+
+/**
+ * @brief Stop the download, close the connection and free its buffers.
+ */
+void vOtaHttpTransferStop( void );
+
+#endif /* _OTA_HTTP_TRANSFER_H_ */
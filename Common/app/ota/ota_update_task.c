@@ -54,6 +54,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "queue.h"
 #include "sys_evt.h"
 
 #include "ota_config.h"
@@ -70,6 +71,10 @@
 /* OTA Library Interface include. */
 #include "ota_os_freertos.h"
 #include "ota_mqtt_interface.h"
+#include "ota_http_interface.h"
+
+/* OTA file download over HTTPS. */
+#include "ota_http_transfer.h"
 
 /* Include firmware version struct definition. */
 #include "ota_appversion32.h"
@@ -172,6 +177,12 @@
  */
 #define OTA_DATA_STREAM_TOPIC_FILTER_LENGTH       ( ( uint16_t ) ( sizeof( OTA_DATA_STREAM_TOPIC_FILTER ) - 1 ) )
 
+/**
+ * @brief Part of the topics of the data stream, used to tell the block
+ * requests apart from the other messages published by the OTA agent.
+ */
+#define OTA_DATA_STREAM_TOPIC_PART                "/streams/"
+
 
 /**
  * @brief Starting index of client identifier within OTA topic.
@@ -215,13 +226,39 @@ static const char * pOtaAgentStateStrings[ OtaAgentStateAll + 1 ] =
  * by OTA agent at a time along with an extra buffer to handle control message.
  * The size of each buffer is determined by the maximum size of firmware image
  * chunk, and other metadata send along with the chunk.
+ *
+ * The buffers not owned by the OTA agent are kept in a queue: a buffer is
+ * taken from it when a message is received, the message is copied into it,
+ * and it is handed over to the agent with the event, which gives it back once
+ * the event was processed.
  */
 typedef struct OtaEventBufferPool
 {
     OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
-    SemaphoreHandle_t lock;
+    QueueHandle_t xFreeBuffers;
 } OtaEventBufferPool_t;
 
+/**
+ * @brief State of the number of blocks requested at once.
+ *
+ * The agent requests a window of blocks and waits for all of them to be
+ * processed before it requests the next window, so the link is idle for a
+ * round trip between two windows. The window is sized to cover twice the
+ * round trip time with blocks, as long as there are free event buffers to
+ * receive them into, and halved when a block had to be dropped.
+ */
+typedef struct OtaBlockWindow
+{
+    uint32_t ulWindow;       /**< Number of blocks requested at once. */
+    TickType_t xRequestTime; /**< Time the last window was requested. */
+    TickType_t xBlockTime;   /**< Time the last block was received. */
+    uint32_t ulReceived;     /**< Blocks received since the last request. */
+    uint32_t ulProcessed;    /**< Events processed since the last request. */
+    uint32_t ulDropped;      /**< Blocks dropped since the window was last updated. */
+    uint32_t ulRttMs;        /**< Smoothed time from a request to its first block. */
+    uint32_t ulBlockMs;      /**< Smoothed time between two blocks of a window. */
+} OtaBlockWindow_t;
+
 /**
  * @brief The structure wraps the static buffers allocated by an OTA application
  * and used by OTA Agent. Static buffer should be in scope as long as the OTA Agent
@@ -332,6 +369,37 @@ static OtaMqttStatus_t prvMQTTUnsubscribe( const char * pTopicFilter,
                                            uint16_t topicFilterLength,
                                            uint8_t ucQoS );
 
+/**
+ * @brief Function used by OTA agent to start downloading a file over HTTPS.
+ *
+ * Opens a connection to the server of the pre-signed url, which is kept alive
+ * for the whole download.
+ *
+ * @param[in] pcUrl Pre-signed url of the file.
+ * @return OtaHttpSuccess if successful, OtaHttpInitFailed otherwise.
+ */
+static OtaHttpStatus_t prvHttpInit( char * pcUrl );
+
+/**
+ * @brief Function used by OTA agent to request file blocks over HTTPS.
+ *
+ * The blocks are read from ranges of the file prefetched by the http
+ * transfer, and sent to the OTA agent as received file blocks.
+ *
+ * @param[in] ulRangeStart Offset of the first byte requested.
+ * @param[in] ulRangeEnd Offset of the last byte requested.
+ * @return OtaHttpSuccess if successful, OtaHttpRequestFailed otherwise.
+ */
+static OtaHttpStatus_t prvHttpRequest( uint32_t ulRangeStart,
+                                       uint32_t ulRangeEnd );
+
+/**
+ * @brief Function used by OTA agent to stop downloading a file over HTTPS.
+ *
+ * @return OtaHttpSuccess.
+ */
+static OtaHttpStatus_t prvHttpDeinit( void );
+
 /**
  * @brief Initialize the OTA event buffer pool.
  *
@@ -346,7 +414,7 @@ static BaseType_t prvOTAEventBufferPoolInit( OtaEventBufferPool_t * pxBufferPool
  * Demo uses a simple statically allocated array of fixed size event buffers. The
  * number of event buffers is configured by the param otaconfigMAX_NUM_OTA_DATA_BUFFERS
  * within ota_config.h. This function is used to fetch a free buffer from the pool for processing
- * by the OTA agent task. It uses a mutex for thread safe access to the pool.
+ * by the OTA agent task. It does not block.
  *
  * @param[in] pxEventBufferPool Pointer to the Event Buffer pool.
  * @return A pointer to an unused buffer from the pool. NULL if there are no buffers available.
@@ -359,8 +427,7 @@ static OtaEventData_t * prvOTAEventBufferGet( OtaEventBufferPool_t * pxBufferPoo
  * OTA demo uses a statically allocated array of fixed size event buffers . The
  * number of event buffers is configured by the param otaconfigMAX_NUM_OTA_DATA_BUFFERS
  * within ota_config.h. The function is used by the OTA application callback to free a buffer,
- * after OTA agent has completed processing with the event. The access to the pool is made thread safe
- * using a mutex.
+ * after OTA agent has completed processing with the event.
  *
  * @param[in] pxEventBufferPool Pointer to the Event Buffer pool.
  * @param[in] pxBuffer Pointer to the buffer to be freed.
@@ -368,6 +435,37 @@ static OtaEventData_t * prvOTAEventBufferGet( OtaEventBufferPool_t * pxBufferPoo
 static void prvOTAEventBufferFree( OtaEventBufferPool_t * pxBufferPool,
                                    OtaEventData_t * const pxBuffer );
 
+/**
+ * @brief Add a sample to a moving average of times in milliseconds.
+ *
+ * @param[in] ulAverage Current average, 0 when there was no sample yet.
+ * @param[in] ulSample Time measured.
+ * @return The updated average.
+ */
+static uint32_t prvSmooth( uint32_t ulAverage,
+                           uint32_t ulSample );
+
+/**
+ * @brief Record that a window of blocks was requested.
+ */
+static void prvBlockWindowRequested( void );
+
+/**
+ * @brief Record the arrival of a block and update the round trip time and
+ * the time between blocks.
+ *
+ * @param[in] xDropped pdTRUE if the block was dropped for lack of a free event buffer.
+ */
+static void prvBlockWindowReceived( BaseType_t xDropped );
+
+/**
+ * @brief Resize the window of blocks once an event was processed.
+ *
+ * Called from the OTA agent task between two events, so that the window
+ * does not change while the agent requests blocks.
+ */
+static void prvBlockWindowUpdate( void );
+
 /**
  * @brief The function which runs the OTA agent task.
  *
@@ -437,6 +535,16 @@ static BaseType_t prvMatchClientIdentifierInTopic( const char * pTopic,
                                                    size_t clientIdentifierLength );
 
 
+/**
+ * @brief Tells whether a topic belongs to the OTA data stream.
+ *
+ * @param[in] pcTopic Pointer to the topic, not null terminated.
+ * @param[in] uxTopicLength Length of the topic.
+ * @return pdTRUE if the topic contains OTA_DATA_STREAM_TOPIC_PART.
+ */
+static BaseType_t prvIsDataStreamTopic( const char * pcTopic,
+                                        size_t uxTopicLength );
+
 /**
  * @brief Returns pdTRUE if the OTA Agent is currently executing a job.
  * @return pdTRUE if OTA agent is currently active.
@@ -449,6 +557,11 @@ static inline BaseType_t xIsOtaAgentActive( void );
  */
 static OtaAppStaticBuffer_t xAppStaticBuffer = { 0 };
 
+/**
+ * @brief Number of blocks requested at once and the measurements it is based on.
+ */
+static OtaBlockWindow_t xBlockWindow = { .ulWindow = otaconfigINITIAL_BLOCK_WINDOW };
+
 /**
  * @brief Pointer which holds the thing name received from key value store.
  */
@@ -465,15 +578,30 @@ static size_t uxThingNameLength = 0UL;
 static BaseType_t prvOTAEventBufferPoolInit( OtaEventBufferPool_t * pxBufferPool )
 {
     BaseType_t poolInit = pdFALSE;
+    uint32_t ulIndex = 0;
+    OtaEventData_t * pxBuffer = NULL;
 
     configASSERT( pxBufferPool != NULL );
 
     memset( pxBufferPool->eventBuffer, 0x00, sizeof( pxBufferPool->eventBuffer ) );
 
-    pxBufferPool->lock = xSemaphoreCreateMutex();
+    if( pxBufferPool->xFreeBuffers == NULL )
+    {
+        pxBufferPool->xFreeBuffers = xQueueCreate( otaconfigMAX_NUM_OTA_DATA_BUFFERS, sizeof( OtaEventData_t * ) );
+    }
+    else
+    {
+        ( void ) xQueueReset( pxBufferPool->xFreeBuffers );
+    }
 
-    if( pxBufferPool->lock != NULL )
+    if( pxBufferPool->xFreeBuffers != NULL )
     {
+        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
+        {
+            pxBuffer = &pxBufferPool->eventBuffer[ ulIndex ];
+            ( void ) xQueueSend( pxBufferPool->xFreeBuffers, &pxBuffer, 0 );
+        }
+
         poolInit = pdTRUE;
     }
 
@@ -486,15 +614,13 @@ static void prvOTAEventBufferFree( OtaEventBufferPool_t * pxBufferPool,
                                    OtaEventData_t * const pxBuffer )
 {
     configASSERT( pxBufferPool != NULL );
+    configASSERT( pxBuffer != NULL );
 
-    if( xSemaphoreTake( pxBufferPool->lock, portMAX_DELAY ) == pdTRUE )
-    {
-        pxBuffer->bufferUsed = false;
-        ( void ) xSemaphoreGive( pxBufferPool->lock );
-    }
-    else
+    pxBuffer->bufferUsed = false;
+
+    if( xQueueSend( pxBufferPool->xFreeBuffers, &pxBuffer, 0 ) != pdTRUE )
     {
-        LogError( ( "Failed to get buffer semaphore." ) );
+        LogError( ( "Failed to return an event buffer to the pool." ) );
     }
 }
 
@@ -502,31 +628,161 @@ static void prvOTAEventBufferFree( OtaEventBufferPool_t * pxBufferPool,
 
 static OtaEventData_t * prvOTAEventBufferGet( OtaEventBufferPool_t * pxBufferPool )
 {
-    uint32_t ulIndex = 0;
     OtaEventData_t * pFreeBuffer = NULL;
 
     configASSERT( pxBufferPool != NULL );
 
-    if( xSemaphoreTake( pxBufferPool->lock, portMAX_DELAY ) == pdTRUE )
+    if( xQueueReceive( pxBufferPool->xFreeBuffers, &pFreeBuffer, 0 ) == pdTRUE )
     {
-        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
+        pFreeBuffer->bufferUsed = true;
+    }
+    else
+    {
+        pFreeBuffer = NULL;
+    }
+
+    return pFreeBuffer;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSmooth( uint32_t ulAverage,
+                           uint32_t ulSample )
+{
+    /* Exponential moving average over about 8 samples. */
+    return ( ulAverage == 0U ) ? ulSample : ( ( 7U * ulAverage ) + ulSample ) / 8U;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulOtaGetBlockWindow( void )
+{
+    return xBlockWindow.ulWindow;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvBlockWindowRequested( void )
+{
+    taskENTER_CRITICAL();
+    {
+        xBlockWindow.xRequestTime = xTaskGetTickCount();
+        xBlockWindow.ulReceived = 0U;
+        xBlockWindow.ulProcessed = 0U;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvBlockWindowReceived( BaseType_t xDropped )
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    taskENTER_CRITICAL();
+    {
+        if( xBlockWindow.ulReceived == 0U )
         {
-            if( pxBufferPool->eventBuffer[ ulIndex ].bufferUsed == false )
-            {
-                pxBufferPool->eventBuffer[ ulIndex ].bufferUsed = true;
-                pFreeBuffer = &pxBufferPool->eventBuffer[ ulIndex ];
-                break;
-            }
+            xBlockWindow.ulRttMs = prvSmooth( xBlockWindow.ulRttMs,
+                                              ( uint32_t ) ( ( xNow - xBlockWindow.xRequestTime ) * portTICK_PERIOD_MS ) );
         }
+        else
+        {
+            xBlockWindow.ulBlockMs = prvSmooth( xBlockWindow.ulBlockMs,
+                                                ( uint32_t ) ( ( xNow - xBlockWindow.xBlockTime ) * portTICK_PERIOD_MS ) );
+        }
+
+        xBlockWindow.xBlockTime = xNow;
+        xBlockWindow.ulReceived++;
 
-        ( void ) xSemaphoreGive( pxBufferPool->lock );
+        if( xDropped == pdTRUE )
+        {
+            xBlockWindow.ulDropped++;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvBlockWindowUpdate( void )
+{
+    uint32_t ulWindow = 0U;
+    uint32_t ulTarget = 0U;
+    uint32_t ulFree = 0U;
+    uint32_t ulRttMs = 0U;
+    uint32_t ulBlockMs = 0U;
+    BaseType_t xDropped = pdFALSE;
+    BaseType_t xWindowDone = pdFALSE;
+
+    taskENTER_CRITICAL();
+    {
+        xBlockWindow.ulProcessed++;
+        ulWindow = xBlockWindow.ulWindow;
+        ulRttMs = xBlockWindow.ulRttMs;
+        ulBlockMs = xBlockWindow.ulBlockMs;
+
+        if( xBlockWindow.ulDropped > 0U )
+        {
+            xDropped = pdTRUE;
+            xBlockWindow.ulDropped = 0U;
+        }
+
+        xWindowDone = ( xBlockWindow.ulProcessed == ulWindow ) ? pdTRUE : pdFALSE;
+    }
+    taskEXIT_CRITICAL();
+
+    if( xDropped == pdTRUE )
+    {
+        /* The blocks arrived faster than the agent processed them. */
+        ulWindow = ( ulWindow + 1U ) / 2U;
+    }
+    else if( xWindowDone == pdTRUE )
+    {
+        /* The next window is about to be requested and all of the buffers
+         * holding the blocks of this one were given back to the pool. */
+        if( ulBlockMs == 0U )
+        {
+            ulTarget = otaconfigMAX_BLOCK_WINDOW;
+        }
+        else
+        {
+            ulTarget = ( ( 2U * ulRttMs ) / ulBlockMs ) + 1U;
+        }
+
+        /* Grow gradually and keep a buffer for the job messages. */
+        ulWindow = ( ulTarget < ( 2U * ulWindow ) ) ? ulTarget : ( 2U * ulWindow );
+        ulFree = ( uint32_t ) uxQueueMessagesWaiting( xAppStaticBuffer.eventBufferPool.xFreeBuffers );
+
+        if( ( ulFree > 1U ) && ( ulWindow > ( ulFree - 1U ) ) )
+        {
+            ulWindow = ulFree - 1U;
+        }
     }
     else
     {
-        LogError( ( "Failed to get buffer semaphore." ) );
+        /* Keep the window of the blocks being received. */
     }
 
-    return pFreeBuffer;
+    if( ulWindow > otaconfigMAX_BLOCK_WINDOW )
+    {
+        ulWindow = otaconfigMAX_BLOCK_WINDOW;
+    }
+    else if( ulWindow == 0U )
+    {
+        ulWindow = 1U;
+    }
+    else
+    {
+        /* Within bounds. */
+    }
+
+    if( ulWindow != xBlockWindow.ulWindow )
+    {
+        LogDebug( ( "Requesting %u blocks at once, round trip %u ms, %u ms between blocks.",
+                    ulWindow, ulRttMs, ulBlockMs ) );
+        xBlockWindow.ulWindow = ulWindow;
+    }
 }
 
 /*-----------------------------------------------------------*/
@@ -651,6 +907,7 @@ static void otaAppCallback( OtaJobEvent_t event,
             LogDebug( ( "OTA Event processing completed. Freeing the event buffer to pool." ) );
             configASSERT( pData != NULL );
             prvOTAEventBufferFree( &xAppStaticBuffer.eventBufferPool, ( OtaEventData_t * ) pData );
+            prvBlockWindowUpdate();
 
             break;
 
@@ -702,17 +959,29 @@ static void prvProcessIncomingData( void * pxContext,
 
             if( pData != NULL )
             {
+                /* The payload points into the network buffer of the MQTT agent,
+                 * which is reused as soon as this callback returns: it is copied
+                 * once, into the buffer handed over to the OTA agent. */
                 memcpy( pData->data, pPublishInfo->pPayload, pPublishInfo->payloadLength );
                 pData->dataLength = pPublishInfo->payloadLength;
                 eventMsg.eventId = OtaAgentEventReceivedFileBlock;
                 eventMsg.pEventData = pData;
 
                 /* Send job document received event. */
-                OTA_SignalEvent( &eventMsg );
+                if( OTA_SignalEvent( &eventMsg ) == true )
+                {
+                    prvBlockWindowReceived( pdFALSE );
+                }
+                else
+                {
+                    prvOTAEventBufferFree( &xAppStaticBuffer.eventBufferPool, pData );
+                    prvBlockWindowReceived( pdTRUE );
+                }
             }
             else
             {
                 LogError( ( "Error: No OTA data buffers available.\r\n" ) );
+                prvBlockWindowReceived( pdTRUE );
             }
         }
         else
@@ -921,6 +1190,27 @@ static OtaMqttStatus_t prvMQTTSubscribe( const char * pTopicFilter,
     return otaRet;
 }
 
+static BaseType_t prvIsDataStreamTopic( const char * pcTopic,
+                                        size_t uxTopicLength )
+{
+    const size_t uxPartLength = sizeof( OTA_DATA_STREAM_TOPIC_PART ) - 1U;
+    BaseType_t xIsDataStream = pdFALSE;
+    size_t uxIndex = 0;
+
+    for( uxIndex = 0; ( uxIndex + uxPartLength ) <= uxTopicLength; uxIndex++ )
+    {
+        if( strncmp( &pcTopic[ uxIndex ], OTA_DATA_STREAM_TOPIC_PART, uxPartLength ) == 0 )
+        {
+            xIsDataStream = pdTRUE;
+            break;
+        }
+    }
+
+    return xIsDataStream;
+}
+
+/*-----------------------------------------------------------*/
+
 static OtaMqttStatus_t prvMQTTPublish( const char * const pacTopic,
                                        uint16_t topicLen,
                                        const char * pMsg,
@@ -959,6 +1249,13 @@ static OtaMqttStatus_t prvMQTTPublish( const char * const pacTopic,
     }
     else
     {
+        if( prvIsDataStreamTopic( pacTopic, topicLen ) == pdTRUE )
+        {
+            /* A window of blocks is requested: its first block may arrive
+             * before the publish completes. */
+            prvBlockWindowRequested();
+        }
+
         mqttStatus = MQTTAgent_Publish( xMQTTAgentHandle,
                                         &publishInfo,
                                         &xCommandParams );
@@ -1049,6 +1346,100 @@ static OtaMqttStatus_t prvMQTTUnsubscribe( const char * pTopicFilter,
 
 /*-----------------------------------------------------------*/
 
+static OtaHttpStatus_t prvHttpInit( char * pcUrl )
+{
+    OtaHttpStatus_t xStatus = OtaHttpSuccess;
+
+    if( xOtaHttpTransferStart( pcUrl ) != pdPASS )
+    {
+        LogError( ( "Failed to start the OTA file download over HTTPS." ) );
+        xStatus = OtaHttpInitFailed;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvHttpRequest( uint32_t ulRangeStart,
+                                       uint32_t ulRangeEnd )
+{
+    OtaHttpStatus_t xStatus = OtaHttpSuccess;
+    OtaEventData_t * pData = NULL;
+    OtaEventMsg_t eventMsg = { 0 };
+    uint32_t ulOffset = ulRangeStart;
+    uint32_t ulBlocks = 0U;
+    int32_t lLength = 0;
+    BaseType_t xMore = pdTRUE;
+
+    configASSERT( ulRangeEnd >= ulRangeStart );
+    configASSERT( ( ulRangeEnd - ulRangeStart ) < OTA_DATA_BLOCK_SIZE );
+
+    /* The agent requests a single block, but numbers the blocks received
+     * over HTTP from that one on and waits for otaconfigMAX_NUM_BLOCKS_REQUEST
+     * of them before requesting more: the blocks which follow the one
+     * requested are sent along, as long as they were fetched already. */
+    prvBlockWindowRequested();
+
+    while( ( xMore == pdTRUE ) && ( ulBlocks < otaconfigMAX_NUM_BLOCKS_REQUEST ) )
+    {
+        pData = prvOTAEventBufferGet( &xAppStaticBuffer.eventBufferPool );
+
+        if( pData == NULL )
+        {
+            LogError( ( "Error: No OTA data buffers available.\r\n" ) );
+            xMore = pdFALSE;
+        }
+        else
+        {
+            lLength = lOtaHttpTransferRead( ulOffset, pData->data, ulRangeEnd - ulRangeStart + 1U );
+
+            if( lLength <= 0 )
+            {
+                prvOTAEventBufferFree( &xAppStaticBuffer.eventBufferPool, pData );
+                xMore = pdFALSE;
+            }
+            else
+            {
+                pData->dataLength = ( uint32_t ) lLength;
+                eventMsg.eventId = OtaAgentEventReceivedFileBlock;
+                eventMsg.pEventData = pData;
+
+                if( OTA_SignalEvent( &eventMsg ) == true )
+                {
+                    prvBlockWindowReceived( pdFALSE );
+                    ulOffset += ( uint32_t ) lLength;
+                    ulBlocks++;
+                }
+                else
+                {
+                    prvOTAEventBufferFree( &xAppStaticBuffer.eventBufferPool, pData );
+                    xMore = pdFALSE;
+                }
+            }
+        }
+    }
+
+    if( ulBlocks == 0U )
+    {
+        LogError( ( "Failed to read the OTA file block at %u over HTTPS.", ulRangeStart ) );
+        xStatus = OtaHttpRequestFailed;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaHttpStatus_t prvHttpDeinit( void )
+{
+    vOtaHttpTransferStop();
+
+    return OtaHttpSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvSetOtaInterfaces( OtaInterfaces_t * pOtaInterfaces )
 {
     configASSERT( pOtaInterfaces != NULL );
@@ -1069,6 +1460,11 @@ static void prvSetOtaInterfaces( OtaInterfaces_t * pOtaInterfaces )
     pOtaInterfaces->mqtt.publish = prvMQTTPublish;
     pOtaInterfaces->mqtt.unsubscribe = prvMQTTUnsubscribe;
 
+    /* Initialize the OTA library HTTP Interface.*/
+    pOtaInterfaces->http.init = prvHttpInit;
+    pOtaInterfaces->http.request = prvHttpRequest;
+    pOtaInterfaces->http.deinit = prvHttpDeinit;
+
     /* Initialize the OTA library PAL Interface.*/
     pOtaInterfaces->pal.getPlatformImageState = otaPal_GetPlatformImageState;
     pOtaInterfaces->pal.setPlatformImageState = otaPal_SetPlatformImageState;
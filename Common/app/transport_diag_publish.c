@@ -0,0 +1,243 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file transport_diag_publish.c
+ * @brief Periodically publishes the MQTT connection's TLS transport statistics.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_ERROR
+
+#include "logging.h"
+
+/* Standard includes. */
+#include <string.h>
+#include <stdio.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "kvstore.h"
+
+/* MQTT library includes. */
+#include "core_mqtt.h"
+#include "core_mqtt_agent.h"
+#include "sys_evt.h"
+
+#include "mqtt_agent_task.h"
+#include "mbedtls_transport.h"
+
+#ifndef TRANSPORT_DIAG_PUBLISH_INTERVAL_MS
+#define TRANSPORT_DIAG_PUBLISH_INTERVAL_MS    ( 60 * 1000 )
+#endif
+
+#define MQTT_PUBLISH_MAX_LEN                  ( 512 )
+#define MQTT_PUBLISH_TOPIC                    "diagnostics/transport"
+#define MQTT_PUBLICH_TOPIC_STR_LEN            ( 256 )
+#define MQTT_PUBLISH_BLOCK_TIME_MS            ( 1000 )
+#define MQTT_PUBLISH_NOTIFICATION_WAIT_MS     ( 1000 )
+
+#define MQTT_NOTIFY_IDX                       ( 1 )
+#define MQTT_PUBLISH_QOS                      ( MQTTQoS0 )
+
+/*-----------------------------------------------------------*/
+
+struct MQTTAgentCommandContext
+{
+    MQTTStatus_t xReturnStatus;
+    TaskHandle_t xTaskToNotify;
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPublishCommandCallback( MQTTAgentCommandContext_t * pxCommandContext,
+                                       MQTTAgentReturnInfo_t * pxReturnInfo )
+{
+    configASSERT( pxCommandContext != NULL );
+    configASSERT( pxReturnInfo != NULL );
+
+    pxCommandContext->xReturnStatus = pxReturnInfo->returnCode;
+
+    if( pxCommandContext->xTaskToNotify != NULL )
+    {
+        ( void ) xTaskNotifyGiveIndexed( pxCommandContext->xTaskToNotify,
+                                         MQTT_NOTIFY_IDX );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPublishAndWait( MQTTAgentHandle_t xAgentHandle,
+                                     const char * pcTopic,
+                                     const void * pvPublishData,
+                                     size_t xPublishDataLen )
+{
+    BaseType_t xResult = pdFALSE;
+    MQTTStatus_t xStatus;
+
+    MQTTPublishInfo_t xPublishInfo =
+    {
+        .qos             = MQTT_PUBLISH_QOS,
+        .retain          = 0,
+        .dup             = 0,
+        .pTopicName      = pcTopic,
+        .topicNameLength = strlen( pcTopic ),
+        .pPayload        = pvPublishData,
+        .payloadLength   = xPublishDataLen
+    };
+
+    MQTTAgentCommandContext_t xCommandContext =
+    {
+        .xTaskToNotify = xTaskGetCurrentTaskHandle(),
+        .xReturnStatus = MQTTIllegalState,
+    };
+
+    MQTTAgentCommandInfo_t xCommandParams =
+    {
+        .blockTimeMs                 = MQTT_PUBLISH_BLOCK_TIME_MS,
+        .cmdCompleteCallback         = prvPublishCommandCallback,
+        .pCmdCompleteCallbackContext = &xCommandContext,
+    };
+
+    /* Clear the notification index */
+    xTaskNotifyStateClearIndexed( NULL, MQTT_NOTIFY_IDX );
+
+    xStatus = MQTTAgent_Publish( xAgentHandle,
+                                 &xPublishInfo,
+                                 &xCommandParams );
+
+    if( xStatus == MQTTSuccess )
+    {
+        xResult = ulTaskNotifyTakeIndexed( MQTT_NOTIFY_IDX,
+                                           pdTRUE,
+                                           pdMS_TO_TICKS( MQTT_PUBLISH_NOTIFICATION_WAIT_MS ) );
+
+        if( xResult == 0 )
+        {
+            LogError( "Timed out while waiting for publish to complete." );
+            xResult = pdFALSE;
+        }
+        else if( xCommandContext.xReturnStatus != MQTTSuccess )
+        {
+            LogError( "MQTT Agent returned error code: %d during publish operation.",
+                      xCommandContext.xReturnStatus );
+            xResult = pdFALSE;
+        }
+    }
+    else
+    {
+        LogError( "MQTTAgent_Publish returned error code: %d.", xStatus );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvFormatStats( char * pcBuffer,
+                           size_t uxBufferLen,
+                           const TlsTransportStats_t * pxStats )
+{
+    return snprintf( pcBuffer, uxBufferLen,
+                     "{ \"tls_minor_version\": %d, \"tls13_fallback\": %d, "
+                     "\"connect_ms\": %lu, \"handshake_ms\": %lu, "
+                     "\"bytes_sent\": %lu, \"bytes_received\": %lu, "
+                     "\"app_bytes_sent\": %lu, \"app_bytes_received\": %lu, "
+                     "\"records_sent\": %lu, \"records_received\": %lu, "
+                     "\"send_stalls\": %lu, \"recv_wakeups\": %lu, \"recv_want_read\": %lu, "
+                     "\"socket_errors\": %lu, \"session_heap_bytes\": %ld }",
+                     pxStats->xHandshake.lTlsMinorVersion,
+                     ( int ) pxStats->xHandshake.xFallback,
+                     pxStats->xHandshake.ulConnectTimeMs,
+                     pxStats->xHandshake.ulHandshakeTimeMs,
+                     pxStats->ulBytesSent,
+                     pxStats->ulBytesReceived,
+                     pxStats->ulAppBytesSent,
+                     pxStats->ulAppBytesReceived,
+                     pxStats->ulRecordsSent,
+                     pxStats->ulRecordsReceived,
+                     pxStats->ulSendStalls,
+                     pxStats->ulRecvWakeups,
+                     pxStats->ulRecvWantRead,
+                     pxStats->ulSocketErrors,
+                     pxStats->xMemUsage.lSessionHeapDelta );
+}
+
+/*-----------------------------------------------------------*/
+
+void vTransportDiagPublishTask( void * pvParameters )
+{
+    BaseType_t xExitFlag = pdFALSE;
+    char pcPayloadBuf[ MQTT_PUBLISH_MAX_LEN ];
+    char pcTopicString[ MQTT_PUBLICH_TOPIC_STR_LEN ] = { 0 };
+    MQTTAgentHandle_t xAgentHandle = NULL;
+    size_t uxTopicLen = 0;
+
+    ( void ) pvParameters;
+
+    uxTopicLen = KVStore_getString( CS_CORE_THING_NAME, pcTopicString, MQTT_PUBLICH_TOPIC_STR_LEN );
+
+    if( uxTopicLen > 0 )
+    {
+        uxTopicLen = strlcat( pcTopicString, "/" MQTT_PUBLISH_TOPIC, MQTT_PUBLICH_TOPIC_STR_LEN );
+    }
+
+    if( ( uxTopicLen == 0 ) || ( uxTopicLen >= MQTT_PUBLICH_TOPIC_STR_LEN ) )
+    {
+        LogError( "Failed to construct topic string." );
+        xExitFlag = pdTRUE;
+    }
+
+    vSleepUntilMQTTAgentReady();
+
+    xAgentHandle = xGetMqttAgentHandle();
+
+    while( xExitFlag == pdFALSE )
+    {
+        TlsTransportStats_t xStats = { 0 };
+
+        vTaskDelay( pdMS_TO_TICKS( TRANSPORT_DIAG_PUBLISH_INTERVAL_MS ) );
+
+        vSleepUntilMQTTAgentConnected();
+
+        if( xGetMqttAgentTransportStats( &xStats ) == pdTRUE )
+        {
+            int lLen = prvFormatStats( pcPayloadBuf, MQTT_PUBLISH_MAX_LEN, &xStats );
+
+            if( ( lLen > 0 ) &&
+                ( lLen < MQTT_PUBLISH_MAX_LEN ) )
+            {
+                ( void ) prvPublishAndWait( xAgentHandle, pcTopicString, pcPayloadBuf, ( size_t ) lLen );
+            }
+            else
+            {
+                LogError( "Not enough buffer space." );
+            }
+        }
+    }
+
+    vTaskDelete( NULL );
+}
@@ -0,0 +1,755 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file cli_cryptobench.c
+ * @brief Benchmark of the mbedtls cryptographic primitives.
+ *
+ * Each primitive is run repeatedly for a fixed time and reported as one JSON
+ * object per line. The "impl" field of each result tells whether the
+ * hardware accelerated alternative implementation (hw) or the mbedtls
+ * software implementation (sw) is compiled in, so that results of builds
+ * with and without the accelerated drivers can be compared with
+ * tools/crypto_bench.py.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_ERROR
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "rtos_time.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md5.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/platform_util.h"
+
+#include "mbedtls_error_utils.h"
+
+#if defined( MBEDTLS_GCM_ALT )
+#include "crypto_sw_stm32.h"
+#if ST_SW_DISPATCH
+#define CRYPTO_BENCH_SW_DISPATCH
+#endif
+#endif
+
+#if defined( MBEDTLS_ECDSA_VERIFY_ALT ) && !defined( MBEDTLS_ECP_ALT )
+#include "ecdsa_cache_stm32.h"
+#if ST_ECDSA_VERIFY_CACHE
+#define CRYPTO_BENCH_ECDSA_CACHE
+#endif
+#endif
+
+#define CRYPTO_BENCH_DEFAULT_MS    250U
+#define CRYPTO_BENCH_MAX_LEN       4096U
+
+/* Implementation compiled in for each primitive */
+#if defined( MBEDTLS_AES_ALT )
+#define CRYPTO_BENCH_IMPL_AES    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_AES    "sw"
+#endif
+
+#if defined( MBEDTLS_GCM_ALT )
+#define CRYPTO_BENCH_IMPL_GCM    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_GCM    "sw"
+#endif
+
+#if defined( MBEDTLS_SHA1_ALT )
+#define CRYPTO_BENCH_IMPL_SHA1    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_SHA1    "sw"
+#endif
+
+#if defined( MBEDTLS_SHA256_ALT )
+#define CRYPTO_BENCH_IMPL_SHA256    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_SHA256    "sw"
+#endif
+
+#if defined( MBEDTLS_MD5_ALT )
+#define CRYPTO_BENCH_IMPL_MD5    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_MD5    "sw"
+#endif
+
+#if defined( MBEDTLS_ECDSA_SIGN_ALT ) || defined( MBEDTLS_ECP_ALT )
+#define CRYPTO_BENCH_IMPL_ECDSA_SIGN    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_ECDSA_SIGN    "sw"
+#endif
+
+#if defined( MBEDTLS_ECP_ALT )
+#define CRYPTO_BENCH_IMPL_ECDSA_VERIFY    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_ECDSA_VERIFY    "sw"
+#endif
+
+#if defined( MBEDTLS_ECDH_COMPUTE_SHARED_ALT ) || defined( MBEDTLS_ECP_ALT )
+#define CRYPTO_BENCH_IMPL_ECDH    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_ECDH    "sw"
+#endif
+
+#if defined( MBEDTLS_RSA_ALT )
+#define CRYPTO_BENCH_IMPL_RSA    "hw"
+#else
+#define CRYPTO_BENCH_IMPL_RSA    "sw"
+#endif
+
+/* Public modulus of a fixed RSA-2048 test key (e = 65537) and its PKCS#1 v1.5
+ * SHA-256 signature of pcRsaMessage. */
+static const char pcRsaMessage[] = "cli_cryptobench";
+
+static const uint8_t pucRsaModulus[ 256 ] =
+{
+    0xd6, 0x53, 0x8f, 0xff, 0xea, 0x97, 0x90, 0x44, 0xc0, 0xd2, 0xfb, 0xfe,
+    0x6a, 0xde, 0x65, 0x64, 0xf9, 0x86, 0x9e, 0x5b, 0x5f, 0x8d, 0x49, 0x23,
+    0x60, 0xf4, 0x64, 0xfb, 0x9e, 0x7e, 0x28, 0xc2, 0x87, 0x07, 0x80, 0x95,
+    0x8e, 0xaf, 0xfc, 0x7e, 0xe3, 0x73, 0x5f, 0x34, 0x35, 0x2e, 0xab, 0x01,
+    0xd3, 0xc3, 0x20, 0xf5, 0x06, 0x4c, 0x78, 0x44, 0x35, 0xae, 0x27, 0xa5,
+    0xf0, 0xb2, 0x3c, 0xce, 0x51, 0xc2, 0xbf, 0xb5, 0x68, 0x89, 0x7a, 0xba,
+    0x6a, 0x4a, 0x76, 0x79, 0x3e, 0xa8, 0x9e, 0x91, 0x4e, 0x38, 0x6b, 0xe4,
+    0x3e, 0x2b, 0xf8, 0x4e, 0xa0, 0x20, 0xa0, 0x29, 0xc0, 0xea, 0x08, 0x9a,
+    0xc5, 0x5f, 0xed, 0xbe, 0x58, 0x04, 0xf2, 0xf9, 0xaa, 0x86, 0x68, 0xb5,
+    0xa5, 0xf4, 0x60, 0xfe, 0x01, 0xab, 0x1d, 0xf0, 0x93, 0x05, 0xb9, 0x29,
+    0xe1, 0x3d, 0x70, 0xe1, 0x80, 0xfe, 0xb6, 0xb1, 0xcc, 0x37, 0x77, 0xd6,
+    0x30, 0x45, 0xcc, 0x1b, 0x7c, 0x61, 0x7b, 0x71, 0xb0, 0xda, 0x22, 0x4a,
+    0x9f, 0x3b, 0xe0, 0xc2, 0x85, 0x37, 0x85, 0x33, 0x37, 0x0f, 0x4e, 0xe8,
+    0xcc, 0xf7, 0x66, 0x16, 0x3d, 0x61, 0x4e, 0x72, 0x2b, 0x48, 0x5e, 0x89,
+    0xc1, 0xc7, 0xd1, 0xc8, 0xc8, 0xe5, 0xbf, 0xdf, 0xc9, 0x31, 0x33, 0x2f,
+    0x77, 0x26, 0x21, 0x1b, 0x37, 0x9b, 0x3f, 0x10, 0xe5, 0x11, 0x1a, 0x5a,
+    0x36, 0x87, 0x63, 0x7b, 0x4b, 0xed, 0x76, 0x2d, 0x73, 0xfe, 0xc5, 0x33,
+    0x9a, 0x0e, 0xb6, 0x0a, 0xe6, 0x95, 0xfc, 0x46, 0xed, 0xe9, 0x43, 0xe3,
+    0xa9, 0xe9, 0x14, 0x9f, 0xb0, 0x0c, 0xf6, 0x94, 0xf4, 0x9a, 0x45, 0x1b,
+    0x24, 0xfe, 0x9e, 0xee, 0x0d, 0xd9, 0x0e, 0x43, 0x79, 0x27, 0xe0, 0xd7,
+    0xf0, 0xbc, 0x15, 0xb9, 0x29, 0xf7, 0x66, 0xbf, 0x54, 0x7b, 0x97, 0xae,
+    0x41, 0x66, 0x1e, 0xe3
+};
+
+static const uint8_t pucRsaSignature[ 256 ] =
+{
+    0x91, 0x30, 0x55, 0x2f, 0x05, 0x11, 0xd5, 0x11, 0x5a, 0xb5, 0xbb, 0xa7,
+    0x0a, 0xf3, 0xdc, 0x1e, 0xeb, 0x18, 0x6d, 0xb2, 0x62, 0x61, 0x16, 0x09,
+    0x3c, 0x00, 0xff, 0x0d, 0xd7, 0xd2, 0x2e, 0x2b, 0xf5, 0x9a, 0x1e, 0x3c,
+    0x05, 0x11, 0xc0, 0x3a, 0x15, 0xcb, 0xd1, 0x41, 0x56, 0xc7, 0x11, 0xe3,
+    0xec, 0xdc, 0xaa, 0x23, 0xcf, 0x37, 0x70, 0x97, 0x41, 0xef, 0xc3, 0x63,
+    0xa3, 0x4f, 0xff, 0x37, 0xff, 0xd3, 0xe7, 0xc3, 0xc8, 0x0d, 0xc6, 0x81,
+    0x18, 0x21, 0x5d, 0x7b, 0xd1, 0x99, 0x7a, 0x9d, 0xe6, 0x29, 0x20, 0xe2,
+    0x00, 0x81, 0x03, 0xa2, 0x57, 0xfa, 0x08, 0x98, 0x84, 0xcd, 0x96, 0xaa,
+    0xfd, 0x70, 0xc5, 0x89, 0xec, 0xcb, 0x09, 0x53, 0x80, 0x31, 0x89, 0x92,
+    0xd8, 0xec, 0x4b, 0xbe, 0x6c, 0x07, 0xd3, 0x36, 0x8a, 0xc3, 0x8d, 0x2f,
+    0x90, 0x93, 0xc4, 0x95, 0x9d, 0x20, 0x41, 0x2c, 0xeb, 0x0d, 0x24, 0x75,
+    0x16, 0x14, 0x20, 0x4f, 0x85, 0xf4, 0x3e, 0x70, 0xdc, 0x7c, 0x63, 0xe3,
+    0x54, 0x6e, 0x6f, 0x05, 0x48, 0x58, 0x04, 0xc8, 0xaf, 0x4c, 0x78, 0xeb,
+    0xfa, 0xe2, 0x9b, 0xce, 0xb1, 0x6b, 0xc8, 0xca, 0xb9, 0xb0, 0x12, 0x8f,
+    0xec, 0x20, 0x79, 0x9a, 0x8f, 0xcb, 0xfb, 0xa9, 0xff, 0x1a, 0x83, 0x3e,
+    0x25, 0x90, 0x20, 0x26, 0x2c, 0x0a, 0xef, 0x48, 0xd2, 0x92, 0xf2, 0x64,
+    0xda, 0x5c, 0xa7, 0xf6, 0xa4, 0x02, 0x9e, 0x78, 0x61, 0x9b, 0xbb, 0xa4,
+    0xb2, 0x3b, 0x8a, 0xd9, 0xf2, 0x36, 0xcc, 0x1c, 0x88, 0xd4, 0x83, 0x0a,
+    0xf5, 0x4c, 0x63, 0x92, 0x83, 0xd2, 0xab, 0xf3, 0x6c, 0xf8, 0x8e, 0x34,
+    0xf6, 0x27, 0x41, 0x2d, 0x45, 0xfd, 0xf0, 0x99, 0xb2, 0x0a, 0x7f, 0xe8,
+    0xdf, 0xcd, 0x60, 0xd7, 0xa5, 0xbc, 0xb7, 0x46, 0xfa, 0x85, 0xc8, 0xe9,
+    0xa1, 0x81, 0xdb, 0xf7
+};
+
+static const uint8_t pucRsaExponent[ 3 ] = { 0x01, 0x00, 0x01 };
+
+static const uint32_t pulBenchSizes[] = { 16U, 64U, 256U, 1024U, CRYPTO_BENCH_MAX_LEN };
+
+typedef struct CryptoBenchCtx
+{
+    mbedtls_entropy_context xEntropy;
+    mbedtls_ctr_drbg_context xCtrDrbg;
+    mbedtls_aes_context xAes;
+    mbedtls_gcm_context xGcm;
+    mbedtls_ecp_group xGroup;
+    mbedtls_mpi xD;         /* Private key */
+    mbedtls_ecp_point xQ;   /* Public key */
+    mbedtls_mpi xR;         /* Reference signature of ucHash */
+    mbedtls_mpi xS;
+    mbedtls_mpi xSignR;     /* Output of the signature benchmark */
+    mbedtls_mpi xSignS;
+    mbedtls_ecp_point xPeerQ;
+    mbedtls_mpi xZ;
+    mbedtls_rsa_context xRsa;
+    uint8_t ucHash[ 32 ];
+    uint8_t ucIv[ 16 ];
+    uint8_t ucStreamBlock[ 16 ];
+    uint8_t ucTag[ 16 ];
+    size_t uxOffset;
+} CryptoBenchCtx_t;
+
+typedef int ( * CryptoBenchOp_t )( CryptoBenchCtx_t * pxCtx,
+                                   const uint8_t * pucIn,
+                                   uint8_t * pucOut,
+                                   size_t uxLen );
+
+typedef struct CryptoBenchTest
+{
+    const char * pcName;
+    const char * pcGroup;
+    const char * pcImpl;
+    BaseType_t xSized; /* pdTRUE when the test is run for each of pulBenchSizes */
+    CryptoBenchOp_t xOp;
+} CryptoBenchTest_t;
+
+static void prvCryptoBenchCommand( ConsoleIO_t * const pxCIO,
+                                   uint32_t ulArgc,
+                                   char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_cryptoBench =
+{
+    "bench",
+    "bench crypto [all|aes|hash|ecc|rsa] [ms_per_test]\r\n"
+    "    Measure the throughput and latency of the mbedtls cryptographic primitives.\r\n"
+    "    Each result tells whether the hardware accelerated (hw) or the software (sw)\r\n"
+    "    implementation is compiled in. Results are printed as JSON lines.\r\n\n",
+    prvCryptoBenchCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintResult( ConsoleIO_t * const pxCIO,
+                            int lLen )
+{
+    if( ( lLen > 0 ) &&
+        ( lLen < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->print( pcCliScratchBuffer );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpAesCbc( CryptoBenchCtx_t * pxCtx,
+                        const uint8_t * pucIn,
+                        uint8_t * pucOut,
+                        size_t uxLen )
+{
+    return mbedtls_aes_crypt_cbc( &( pxCtx->xAes ), MBEDTLS_AES_ENCRYPT, uxLen,
+                                  pxCtx->ucIv, pucIn, pucOut );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpAesCtr( CryptoBenchCtx_t * pxCtx,
+                        const uint8_t * pucIn,
+                        uint8_t * pucOut,
+                        size_t uxLen )
+{
+    return mbedtls_aes_crypt_ctr( &( pxCtx->xAes ), uxLen, &( pxCtx->uxOffset ),
+                                  pxCtx->ucIv, pxCtx->ucStreamBlock, pucIn, pucOut );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpAesGcm( CryptoBenchCtx_t * pxCtx,
+                        const uint8_t * pucIn,
+                        uint8_t * pucOut,
+                        size_t uxLen )
+{
+    return mbedtls_gcm_crypt_and_tag( &( pxCtx->xGcm ), MBEDTLS_GCM_ENCRYPT, uxLen,
+                                      pxCtx->ucIv, 12, NULL, 0, pucIn, pucOut,
+                                      sizeof( pxCtx->ucTag ), pxCtx->ucTag );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpSha1( CryptoBenchCtx_t * pxCtx,
+                      const uint8_t * pucIn,
+                      uint8_t * pucOut,
+                      size_t uxLen )
+{
+    ( void ) pucOut;
+
+    return mbedtls_sha1( pucIn, uxLen, pxCtx->ucHash );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpSha256( CryptoBenchCtx_t * pxCtx,
+                        const uint8_t * pucIn,
+                        uint8_t * pucOut,
+                        size_t uxLen )
+{
+    ( void ) pucOut;
+
+    return mbedtls_sha256( pucIn, uxLen, pxCtx->ucHash, 0 );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpMd5( CryptoBenchCtx_t * pxCtx,
+                     const uint8_t * pucIn,
+                     uint8_t * pucOut,
+                     size_t uxLen )
+{
+    ( void ) pucOut;
+
+    return mbedtls_md5( pucIn, uxLen, pxCtx->ucHash );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpEcdsaSign( CryptoBenchCtx_t * pxCtx,
+                           const uint8_t * pucIn,
+                           uint8_t * pucOut,
+                           size_t uxLen )
+{
+    ( void ) pucIn;
+    ( void ) pucOut;
+    ( void ) uxLen;
+
+    return mbedtls_ecdsa_sign( &( pxCtx->xGroup ), &( pxCtx->xSignR ), &( pxCtx->xSignS ),
+                               &( pxCtx->xD ), pxCtx->ucHash, 32,
+                               mbedtls_ctr_drbg_random, &( pxCtx->xCtrDrbg ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpEcdsaVerify( CryptoBenchCtx_t * pxCtx,
+                             const uint8_t * pucIn,
+                             uint8_t * pucOut,
+                             size_t uxLen )
+{
+    ( void ) pucIn;
+    ( void ) pucOut;
+    ( void ) uxLen;
+
+#ifdef CRYPTO_BENCH_ECDSA_CACHE
+    /* Repeated verifications with the same key reuse its cached comb table:
+     * flush it so that each run verifies a key seen for the first time. */
+    ecdsa_cache_flush();
+#endif
+
+    return mbedtls_ecdsa_verify( &( pxCtx->xGroup ), pxCtx->ucHash, 32,
+                                 &( pxCtx->xQ ), &( pxCtx->xR ), &( pxCtx->xS ) );
+}
+
+/*-----------------------------------------------------------*/
+
+#ifdef CRYPTO_BENCH_ECDSA_CACHE
+
+/* Latency of a verification with the comb table of the key in the cache. */
+static int prvOpEcdsaVerifyCached( CryptoBenchCtx_t * pxCtx,
+                                   const uint8_t * pucIn,
+                                   uint8_t * pucOut,
+                                   size_t uxLen )
+{
+    ( void ) pucIn;
+    ( void ) pucOut;
+    ( void ) uxLen;
+
+    return mbedtls_ecdsa_verify( &( pxCtx->xGroup ), pxCtx->ucHash, 32,
+                                 &( pxCtx->xQ ), &( pxCtx->xR ), &( pxCtx->xS ) );
+}
+
+#endif /* CRYPTO_BENCH_ECDSA_CACHE */
+
+/*-----------------------------------------------------------*/
+
+static int prvOpEcdh( CryptoBenchCtx_t * pxCtx,
+                      const uint8_t * pucIn,
+                      uint8_t * pucOut,
+                      size_t uxLen )
+{
+    ( void ) pucIn;
+    ( void ) pucOut;
+    ( void ) uxLen;
+
+    return mbedtls_ecdh_compute_shared( &( pxCtx->xGroup ), &( pxCtx->xZ ),
+                                        &( pxCtx->xPeerQ ), &( pxCtx->xD ),
+                                        mbedtls_ctr_drbg_random, &( pxCtx->xCtrDrbg ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpEcpKeygen( CryptoBenchCtx_t * pxCtx,
+                           const uint8_t * pucIn,
+                           uint8_t * pucOut,
+                           size_t uxLen )
+{
+    ( void ) pucIn;
+    ( void ) pucOut;
+    ( void ) uxLen;
+
+    /* Ephemeral keys of the ECDHE pool are generated the same way */
+    return mbedtls_ecp_gen_keypair( &( pxCtx->xGroup ), &( pxCtx->xSignR ), &( pxCtx->xPeerQ ),
+                                    mbedtls_ctr_drbg_random, &( pxCtx->xCtrDrbg ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvOpRsaVerify( CryptoBenchCtx_t * pxCtx,
+                           const uint8_t * pucIn,
+                           uint8_t * pucOut,
+                           size_t uxLen )
+{
+    ( void ) pucIn;
+    ( void ) pucOut;
+    ( void ) uxLen;
+
+    return mbedtls_rsa_pkcs1_verify( &( pxCtx->xRsa ), MBEDTLS_MD_SHA256, 32,
+                                     pxCtx->ucHash, pucRsaSignature );
+}
+
+/*-----------------------------------------------------------*/
+
+static const CryptoBenchTest_t xBenchTests[] =
+{
+    { "aes128_cbc",        "aes",  CRYPTO_BENCH_IMPL_AES,          pdTRUE,  prvOpAesCbc      },
+    { "aes128_ctr",        "aes",  CRYPTO_BENCH_IMPL_AES,          pdTRUE,  prvOpAesCtr      },
+    { "aes128_gcm",        "aes",  CRYPTO_BENCH_IMPL_GCM,          pdTRUE,  prvOpAesGcm      },
+    { "sha1",              "hash", CRYPTO_BENCH_IMPL_SHA1,         pdTRUE,  prvOpSha1        },
+    { "sha256",            "hash", CRYPTO_BENCH_IMPL_SHA256,       pdTRUE,  prvOpSha256      },
+    { "md5",               "hash", CRYPTO_BENCH_IMPL_MD5,          pdTRUE,  prvOpMd5         },
+    { "ecdsa_p256_sign",   "ecc",  CRYPTO_BENCH_IMPL_ECDSA_SIGN,   pdFALSE, prvOpEcdsaSign   },
+    { "ecdsa_p256_verify", "ecc",  CRYPTO_BENCH_IMPL_ECDSA_VERIFY, pdFALSE, prvOpEcdsaVerify },
+#ifdef CRYPTO_BENCH_ECDSA_CACHE
+    { "ecdsa_p256_verify_cached", "ecc", CRYPTO_BENCH_IMPL_ECDSA_VERIFY, pdFALSE, prvOpEcdsaVerifyCached },
+#endif
+    { "ecp_p256_keygen",   "ecc",  CRYPTO_BENCH_IMPL_ECDH,         pdFALSE, prvOpEcpKeygen   },
+    { "ecdh_p256_shared",  "ecc",  CRYPTO_BENCH_IMPL_ECDH,         pdFALSE, prvOpEcdh        },
+    { "rsa2048_verify",    "rsa",  CRYPTO_BENCH_IMPL_RSA,          pdFALSE, prvOpRsaVerify   },
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvBenchCtxFree( CryptoBenchCtx_t * pxCtx )
+{
+    mbedtls_rsa_free( &( pxCtx->xRsa ) );
+    mbedtls_mpi_free( &( pxCtx->xZ ) );
+    mbedtls_ecp_point_free( &( pxCtx->xPeerQ ) );
+    mbedtls_mpi_free( &( pxCtx->xSignS ) );
+    mbedtls_mpi_free( &( pxCtx->xSignR ) );
+    mbedtls_mpi_free( &( pxCtx->xS ) );
+    mbedtls_mpi_free( &( pxCtx->xR ) );
+    mbedtls_ecp_point_free( &( pxCtx->xQ ) );
+    mbedtls_mpi_free( &( pxCtx->xD ) );
+    mbedtls_ecp_group_free( &( pxCtx->xGroup ) );
+    mbedtls_gcm_free( &( pxCtx->xGcm ) );
+    mbedtls_aes_free( &( pxCtx->xAes ) );
+    mbedtls_ctr_drbg_free( &( pxCtx->xCtrDrbg ) );
+    mbedtls_entropy_free( &( pxCtx->xEntropy ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvBenchCtxInit( CryptoBenchCtx_t * pxCtx )
+{
+    int lError;
+    uint8_t ucKey[ 16 ];
+
+    mbedtls_entropy_init( &( pxCtx->xEntropy ) );
+    mbedtls_ctr_drbg_init( &( pxCtx->xCtrDrbg ) );
+    mbedtls_aes_init( &( pxCtx->xAes ) );
+    mbedtls_gcm_init( &( pxCtx->xGcm ) );
+    mbedtls_ecp_group_init( &( pxCtx->xGroup ) );
+    mbedtls_mpi_init( &( pxCtx->xD ) );
+    mbedtls_ecp_point_init( &( pxCtx->xQ ) );
+    mbedtls_mpi_init( &( pxCtx->xR ) );
+    mbedtls_mpi_init( &( pxCtx->xS ) );
+    mbedtls_mpi_init( &( pxCtx->xSignR ) );
+    mbedtls_mpi_init( &( pxCtx->xSignS ) );
+    mbedtls_ecp_point_init( &( pxCtx->xPeerQ ) );
+    mbedtls_mpi_init( &( pxCtx->xZ ) );
+    mbedtls_rsa_init( &( pxCtx->xRsa ) );
+
+    lError = mbedtls_ctr_drbg_seed( &( pxCtx->xCtrDrbg ), mbedtls_entropy_func,
+                                    &( pxCtx->xEntropy ), NULL, 0 );
+    MBEDTLS_MSG_IF_ERROR( lError, "Failed to seed PRNG: Error:" );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ctr_drbg_random( &( pxCtx->xCtrDrbg ), ucKey, sizeof( ucKey ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ctr_drbg_random( &( pxCtx->xCtrDrbg ), pxCtx->ucIv, sizeof( pxCtx->ucIv ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_aes_setkey_enc( &( pxCtx->xAes ), ucKey, 128 );
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to set AES key: Error:" );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_gcm_setkey( &( pxCtx->xGcm ), MBEDTLS_CIPHER_ID_AES, ucKey, 128 );
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to set GCM key: Error:" );
+    }
+
+    /* RSA public key and message digest of the reference signature */
+    if( lError == 0 )
+    {
+        lError = mbedtls_sha256( ( const uint8_t * ) pcRsaMessage, strlen( pcRsaMessage ),
+                                 pxCtx->ucHash, 0 );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_rsa_import_raw( &( pxCtx->xRsa ),
+                                         pucRsaModulus, sizeof( pucRsaModulus ),
+                                         NULL, 0, NULL, 0, NULL, 0,
+                                         pucRsaExponent, sizeof( pucRsaExponent ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_rsa_complete( &( pxCtx->xRsa ) );
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to import RSA key: Error:" );
+    }
+
+    /* ECC keypairs and reference signature */
+    if( lError == 0 )
+    {
+        lError = mbedtls_ecp_group_load( &( pxCtx->xGroup ), MBEDTLS_ECP_DP_SECP256R1 );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ecp_gen_keypair( &( pxCtx->xGroup ), &( pxCtx->xD ), &( pxCtx->xQ ),
+                                          mbedtls_ctr_drbg_random, &( pxCtx->xCtrDrbg ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ecp_gen_keypair( &( pxCtx->xGroup ), &( pxCtx->xZ ), &( pxCtx->xPeerQ ),
+                                          mbedtls_ctr_drbg_random, &( pxCtx->xCtrDrbg ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ecdsa_sign( &( pxCtx->xGroup ), &( pxCtx->xR ), &( pxCtx->xS ),
+                                     &( pxCtx->xD ), pxCtx->ucHash, 32,
+                                     mbedtls_ctr_drbg_random, &( pxCtx->xCtrDrbg ) );
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to generate ECC keys: Error:" );
+    }
+
+    mbedtls_platform_zeroize( ucKey, sizeof( ucKey ) );
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRunTest( ConsoleIO_t * const pxCIO,
+                              CryptoBenchCtx_t * pxCtx,
+                              const CryptoBenchTest_t * pxTest,
+                              uint8_t * pucBuffer,
+                              size_t uxLen,
+                              uint32_t ulMinMs )
+{
+    int lError = 0;
+    uint32_t ulOps = 0;
+    uint32_t ulElapsedMs = 0;
+    uint32_t ulStartMs;
+
+    /* Let lower priority tasks run between tests */
+    vTaskDelay( 1 );
+
+    ulStartMs = ulGetTimeMs();
+
+    do
+    {
+        lError = pxTest->xOp( pxCtx, pucBuffer, pucBuffer, uxLen );
+        ulOps++;
+        ulElapsedMs = ulGetTimeMs() - ulStartMs;
+    }
+    while( ( lError == 0 ) && ( ulElapsedMs < ulMinMs ) );
+
+    if( ulElapsedMs == 0 )
+    {
+        ulElapsedMs = 1;
+    }
+
+    if( lError != 0 )
+    {
+        prvPrintResult( pxCIO,
+                        snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                  "{\"test\":\"%s\",\"impl\":\"%s\",\"size\":%lu,\"error\":%d}\r\n",
+                                  pxTest->pcName, pxTest->pcImpl, ( unsigned long ) uxLen, lError ) );
+    }
+    else
+    {
+        prvPrintResult( pxCIO,
+                        snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                  "{\"test\":\"%s\",\"impl\":\"%s\",\"size\":%lu,\"ops\":%lu,"
+                                  "\"elapsed_ms\":%lu,\"us_per_op\":%lu,\"Bps\":%lu}\r\n",
+                                  pxTest->pcName, pxTest->pcImpl, ( unsigned long ) uxLen,
+                                  ( unsigned long ) ulOps, ( unsigned long ) ulElapsedMs,
+                                  ( unsigned long ) ( ( ( uint64_t ) ulElapsedMs * 1000ULL ) / ulOps ),
+                                  ( unsigned long ) ( ( ( uint64_t ) uxLen * ulOps * 1000ULL ) / ulElapsedMs ) ) );
+    }
+
+    return ( lError == 0 ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+#ifdef CRYPTO_BENCH_SW_DISPATCH
+
+/*
+ * Print the length under which an accelerated operation is processed in
+ * software, as calibrated by st_sw_init() at startup.
+ */
+static void prvPrintDispatch( ConsoleIO_t * const pxCIO,
+                              const char * pcOp,
+                              const st_sw_dispatch_t * pxDispatch )
+{
+    prvPrintResult( pxCIO,
+                    snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                              "{\"test\":\"dispatch\",\"op\":\"%s\",\"sw_threshold\":%lu,\"calibrated\":%s}\r\n",
+                              pcOp, ( unsigned long ) pxDispatch->threshold,
+                              ( pxDispatch->state == ST_SW_CALIBRATED ) ? "true" : "false" ) );
+}
+
+#endif /* CRYPTO_BENCH_SW_DISPATCH */
+
+/*-----------------------------------------------------------*/
+
+static void prvCryptoBenchCommand( ConsoleIO_t * const pxCIO,
+                                   uint32_t ulArgc,
+                                   char * ppcArgv[] )
+{
+    const char * pcGroup = "all";
+    uint32_t ulMinMs = CRYPTO_BENCH_DEFAULT_MS;
+    CryptoBenchCtx_t * pxCtx = NULL;
+    uint8_t * pucBuffer = NULL;
+    BaseType_t xSuccess = pdTRUE;
+
+    if( ( ulArgc < 2 ) ||
+        ( strcmp( ppcArgv[ 1 ], "crypto" ) != 0 ) )
+    {
+        pxCIO->print( "Error: Unknown benchmark. Usage: bench crypto [all|aes|hash|ecc|rsa] [ms_per_test]\r\n" );
+        xSuccess = pdFALSE;
+    }
+    else
+    {
+        if( ulArgc > 2 )
+        {
+            pcGroup = ppcArgv[ 2 ];
+        }
+
+        if( ulArgc > 3 )
+        {
+            ulMinMs = strtoul( ppcArgv[ 3 ], NULL, 10 );
+        }
+
+        pxCtx = pvPortMalloc( sizeof( CryptoBenchCtx_t ) );
+        pucBuffer = pvPortMalloc( CRYPTO_BENCH_MAX_LEN );
+
+        if( ( pxCtx == NULL ) || ( pucBuffer == NULL ) )
+        {
+            pxCIO->print( "Error: Failed to allocate benchmark buffers.\r\n" );
+            xSuccess = pdFALSE;
+        }
+    }
+
+    if( xSuccess == pdTRUE )
+    {
+        ( void ) memset( pucBuffer, 0xA5, CRYPTO_BENCH_MAX_LEN );
+
+        if( prvBenchCtxInit( pxCtx ) != 0 )
+        {
+            pxCIO->print( "Error: Failed to initialize the benchmark keys.\r\n" );
+            xSuccess = pdFALSE;
+        }
+        else
+        {
+            prvPrintResult( pxCIO,
+                            snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                      "{\"test\":\"info\",\"cpu_hz\":%lu,\"ms_per_test\":%lu}\r\n",
+                                      ( unsigned long ) configCPU_CLOCK_HZ, ( unsigned long ) ulMinMs ) );
+
+            for( size_t i = 0; i < ( sizeof( xBenchTests ) / sizeof( xBenchTests[ 0 ] ) ); i++ )
+            {
+                const CryptoBenchTest_t * pxTest = &( xBenchTests[ i ] );
+
+                if( ( strcmp( pcGroup, "all" ) != 0 ) &&
+                    ( strcmp( pcGroup, pxTest->pcGroup ) != 0 ) )
+                {
+                    continue;
+                }
+
+                if( pxTest->xSized == pdTRUE )
+                {
+                    for( size_t j = 0; j < ( sizeof( pulBenchSizes ) / sizeof( pulBenchSizes[ 0 ] ) ); j++ )
+                    {
+                        if( prvRunTest( pxCIO, pxCtx, pxTest, pucBuffer, pulBenchSizes[ j ], ulMinMs ) != pdTRUE )
+                        {
+                            xSuccess = pdFALSE;
+                        }
+                    }
+                }
+                else if( prvRunTest( pxCIO, pxCtx, pxTest, pucBuffer, 0, ulMinMs ) != pdTRUE )
+                {
+                    xSuccess = pdFALSE;
+                }
+            }
+        }
+
+        prvBenchCtxFree( pxCtx );
+
+#ifdef CRYPTO_BENCH_SW_DISPATCH
+        prvPrintDispatch( pxCIO, "gcm", &st_gcm_dispatch );
+#endif
+    }
+
+    if( pxCtx != NULL )
+    {
+        vPortFree( pxCtx );
+    }
+
+    if( pucBuffer != NULL )
+    {
+        vPortFree( pucBuffer );
+    }
+
+    prvPrintResult( pxCIO,
+                    snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                              "{\"test\":\"done\",\"success\":%s}\r\n",
+                              ( xSuccess == pdTRUE ) ? "true" : "false" ) );
+}
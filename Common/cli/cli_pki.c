@@ -40,6 +40,7 @@
 
 #include "tls_transport_config.h"
 #include "mbedtls_transport.h"
+#include "ecdsa_nonce_pool.h"
 
 #ifdef MBEDTLS_TRANSPORT_PKCS11
 /* PKCS11 */
@@ -532,6 +533,9 @@ static void vSubCommand_GenerateKey( ConsoleIO_t * pxCIO,
     /* If successful, print public key in PEM form to terminal. */
     if( xStatus == PKI_SUCCESS )
     {
+        /* Do not sign with the new key using nonces drawn for the old one */
+        vEcdsaNoncePoolFlush();
+
         pxCIO->print( "SUCCESS: Key pair generated and stored in\r\n" );
         pxCIO->print( "Private Key Label: " );
         pxCIO->write( pcPrvKeyLabel, strnlen( pcPrvKeyLabel, configTLS_MAX_LABEL_LEN ) );
@@ -133,5 +133,8 @@ extern const CLI_Command_Definition_t xCommandDef_reset;
 extern const CLI_Command_Definition_t xCommandDef_uptime;
 extern const CLI_Command_Definition_t xCommandDef_rngtest;
 extern const CLI_Command_Definition_t xCommandDef_assert;
+extern const CLI_Command_Definition_t xCommandDef_tlsStat;
+extern const CLI_Command_Definition_t xCommandDef_tlsBench;
+extern const CLI_Command_Definition_t xCommandDef_cryptoBench;
 
 #endif /* _CLI_PRIV */
@@ -0,0 +1,160 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file cli_tlsbench.c
+ * @brief TLS transport benchmark client.
+ *
+ * Runs the benchmark client in tls_bench.c on the target against the server
+ * implemented by tools/tls_bench.py, using the device credentials.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_ERROR
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include <stdlib.h>
+
+#include "mbedtls_transport.h"
+#include "tls_bench.h"
+
+/* Default label of the root CA certificate used to authenticate the benchmark server. */
+#ifndef TLS_BENCH_ROOT_CA_CERT_LABEL
+#define TLS_BENCH_ROOT_CA_CERT_LABEL    "bench_ca_cert"
+#endif
+
+static void prvTlsBenchCommand( ConsoleIO_t * const pxCIO,
+                                uint32_t ulArgc,
+                                char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_tlsBench =
+{
+    "tlsbench",
+    "tlsbench <host> <port> [handshakes] [bulk_bytes] [ca_label]\r\n"
+    "    Benchmark the TLS transport against a server started with tools/tls_bench.py.\r\n"
+    "    The server certificate must be signed by the certificate stored in ca_label\r\n"
+    "    (default: " TLS_BENCH_ROOT_CA_CERT_LABEL "). Results are printed as JSON lines.\r\n\n",
+    prvTlsBenchCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvTlsBenchCommand( ConsoleIO_t * const pxCIO,
+                                uint32_t ulArgc,
+                                char * ppcArgv[] )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    NetworkContext_t * pxNetworkContext = NULL;
+    const char * pcHost = NULL;
+    uint32_t ulPort = 0;
+    uint32_t ulHandshakes = TLS_BENCH_DEFAULT_HANDSHAKES;
+    uint32_t ulBulkLen = TLS_BENCH_DEFAULT_BULK_LEN;
+    const char * pcCaLabel = TLS_BENCH_ROOT_CA_CERT_LABEL;
+
+    PkiObject_t xPrivateKey = xPkiObjectFromLabel( TLS_KEY_PRV_LABEL );
+    PkiObject_t xClientCertificate = xPkiObjectFromLabel( TLS_CERT_LABEL );
+    PkiObject_t pxRootCaChain[ 1 ] = { 0 };
+
+    if( ulArgc < 3 )
+    {
+        pxCIO->print( "Error: A host and port must be specified.\r\n" );
+        xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        pcHost = ppcArgv[ 1 ];
+        ulPort = strtoul( ppcArgv[ 2 ], NULL, 10 );
+
+        if( ulArgc > 3 )
+        {
+            ulHandshakes = strtoul( ppcArgv[ 3 ], NULL, 10 );
+        }
+
+        if( ulArgc > 4 )
+        {
+            ulBulkLen = strtoul( ppcArgv[ 4 ], NULL, 10 );
+        }
+
+        if( ulArgc > 5 )
+        {
+            pcCaLabel = ppcArgv[ 5 ];
+        }
+
+        pxRootCaChain[ 0 ] = xPkiObjectFromLabel( pcCaLabel );
+
+        if( ( ulPort == 0 ) || ( ulPort > UINT16_MAX ) ||
+            ( ulHandshakes == 0 ) || ( ulBulkLen == 0 ) )
+        {
+            pxCIO->print( "Error: Invalid argument.\r\n" );
+            xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        pxNetworkContext = mbedtls_transport_allocate();
+
+        if( pxNetworkContext == NULL )
+        {
+            pxCIO->print( "Error: Failed to allocate a network context.\r\n" );
+            xStatus = TLS_TRANSPORT_INSUFFICIENT_MEMORY;
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        xStatus = mbedtls_transport_configure( pxNetworkContext, NULL,
+                                               &xPrivateKey, &xClientCertificate,
+                                               pxRootCaChain, 1 );
+
+        if( xStatus != TLS_TRANSPORT_SUCCESS )
+        {
+            pxCIO->print( "Error: Failed to configure the TLS transport.\r\n" );
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        if( xTlsBenchRun( pxNetworkContext, pcHost, ( uint16_t ) ulPort,
+                          ulHandshakes, ulBulkLen, pxCIO->print ) == pdTRUE )
+        {
+            pxCIO->print( "{\"test\":\"done\",\"status\":\"ok\"}\r\n" );
+        }
+        else
+        {
+            pxCIO->print( "Error: Benchmark failed.\r\n" );
+        }
+    }
+
+    if( pxNetworkContext != NULL )
+    {
+        mbedtls_transport_free( pxNetworkContext );
+    }
+}
@@ -0,0 +1,171 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#include <stdio.h>
+
+#include "mbedtls_transport.h"
+#include "mqtt_agent_task.h"
+#include "ecdhe_pool.h"
+#include "ecdsa_nonce_pool.h"
+
+#ifndef TFM_PSA_API
+#include "entropy_pool.h"
+#define TLSSTAT_ENTROPY_POOL
+#endif
+
+#if defined( MBEDTLS_AES_ALT ) || defined( MBEDTLS_GCM_ALT ) ||   \
+    defined( MBEDTLS_SHA1_ALT ) || defined( MBEDTLS_SHA256_ALT ) || \
+    defined( MBEDTLS_MD5_ALT )
+#include "crypto_sched_stm32.h"
+#define TLSSTAT_CRYPTO_SCHED
+#endif
+
+static void prvTlsStatCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_tlsStat =
+{
+    "tlsstat",
+    "tlsstat\r\n"
+    "    Display traffic, handshake and memory statistics for the MQTT agent TLS connection,\r\n"
+    "    and the contention on the hardware crypto accelerators.\r\n\n",
+    prvTlsStatCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintStat( ConsoleIO_t * const pxCIO,
+                          const char * pcName,
+                          uint32_t ulValue )
+{
+    int lLen = snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                         "| %-24s | %-12lu |\r\n", pcName, ( unsigned long ) ulValue );
+
+    if( ( lLen > 0 ) &&
+        ( lLen < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->print( pcCliScratchBuffer );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+#ifdef TLSSTAT_CRYPTO_SCHED
+static void prvPrintSchedStats( ConsoleIO_t * const pxCIO,
+                                const char * pcPrefix,
+                                crypto_sched_t * pxSched )
+{
+    crypto_sched_stats_t xSchedStats = { 0 };
+    char pcName[ 25 ];
+
+    crypto_sched_get_stats( pxSched, &xSchedStats );
+
+    ( void ) snprintf( pcName, sizeof( pcName ), "%s_acquisitions", pcPrefix );
+    prvPrintStat( pxCIO, pcName, xSchedStats.acquisitions );
+    ( void ) snprintf( pcName, sizeof( pcName ), "%s_contended", pcPrefix );
+    prvPrintStat( pxCIO, pcName, xSchedStats.contended );
+    ( void ) snprintf( pcName, sizeof( pcName ), "%s_yields", pcPrefix );
+    prvPrintStat( pxCIO, pcName, xSchedStats.yields );
+    ( void ) snprintf( pcName, sizeof( pcName ), "%s_wait_ms_total", pcPrefix );
+    prvPrintStat( pxCIO, pcName, xSchedStats.wait_ms_total );
+    ( void ) snprintf( pcName, sizeof( pcName ), "%s_wait_ms_max", pcPrefix );
+    prvPrintStat( pxCIO, pcName, xSchedStats.wait_ms_max );
+}
+#endif /* TLSSTAT_CRYPTO_SCHED */
+
+/*-----------------------------------------------------------*/
+
+static void prvTlsStatCommand( ConsoleIO_t * const pxCIO,
+                               uint32_t ulArgc,
+                               char * ppcArgv[] )
+{
+    TlsTransportStats_t xStats = { 0 };
+    EcdhePoolStats_t xPoolStats = { 0 };
+    EcdsaNoncePoolStats_t xNoncePoolStats = { 0 };
+
+#ifdef TLSSTAT_ENTROPY_POOL
+    EntropyPoolStats_t xEntropyStats = { 0 };
+#endif /* TLSSTAT_ENTROPY_POOL */
+
+    ( void ) ulArgc;
+    ( void ) ppcArgv;
+
+    if( xGetMqttAgentTransportStats( &xStats ) != pdTRUE )
+    {
+        pxCIO->print( "Error: Transport statistics are not available.\r\n" );
+    }
+    else
+    {
+        pxCIO->print( "+------------------------------------------+\r\n" );
+        prvPrintStat( pxCIO, "connected", ( uint32_t ) xStats.xConnected );
+        prvPrintStat( pxCIO, "tls_minor_version", ( uint32_t ) xStats.xHandshake.lTlsMinorVersion );
+        prvPrintStat( pxCIO, "tls13_fallback", ( uint32_t ) xStats.xHandshake.xFallback );
+        prvPrintStat( pxCIO, "connect_ms", xStats.xHandshake.ulConnectTimeMs );
+        prvPrintStat( pxCIO, "handshake_ms", xStats.xHandshake.ulHandshakeTimeMs );
+        prvPrintStat( pxCIO, "bytes_sent", xStats.ulBytesSent );
+        prvPrintStat( pxCIO, "bytes_received", xStats.ulBytesReceived );
+        prvPrintStat( pxCIO, "app_bytes_sent", xStats.ulAppBytesSent );
+        prvPrintStat( pxCIO, "app_bytes_received", xStats.ulAppBytesReceived );
+        prvPrintStat( pxCIO, "records_sent", xStats.ulRecordsSent );
+        prvPrintStat( pxCIO, "records_received", xStats.ulRecordsReceived );
+        prvPrintStat( pxCIO, "send_stalls", xStats.ulSendStalls );
+        prvPrintStat( pxCIO, "recv_wakeups", xStats.ulRecvWakeups );
+        prvPrintStat( pxCIO, "recv_want_read", xStats.ulRecvWantRead );
+        prvPrintStat( pxCIO, "socket_errors", xStats.ulSocketErrors );
+        prvPrintStat( pxCIO, "context_bytes", ( uint32_t ) xStats.xMemUsage.uxContextSize );
+        prvPrintStat( pxCIO, "in_buf_len", ( uint32_t ) xStats.xMemUsage.uxInBufLen );
+        prvPrintStat( pxCIO, "out_buf_len", ( uint32_t ) xStats.xMemUsage.uxOutBufLen );
+        prvPrintStat( pxCIO, "session_heap_bytes", ( uint32_t ) xStats.xMemUsage.lSessionHeapDelta );
+
+        vEcdhePoolGetStats( &xPoolStats );
+        prvPrintStat( pxCIO, "ecdhe_pool_generated", xPoolStats.ulGenerated );
+        prvPrintStat( pxCIO, "ecdhe_pool_hits", xPoolStats.ulHits );
+        prvPrintStat( pxCIO, "ecdhe_pool_misses", xPoolStats.ulMisses );
+
+        vEcdsaNoncePoolGetStats( &xNoncePoolStats );
+        prvPrintStat( pxCIO, "nonce_pool_generated", xNoncePoolStats.ulGenerated );
+        prvPrintStat( pxCIO, "nonce_pool_hits", xNoncePoolStats.ulHits );
+        prvPrintStat( pxCIO, "nonce_pool_misses", xNoncePoolStats.ulMisses );
+        prvPrintStat( pxCIO, "nonce_pool_flushes", xNoncePoolStats.ulFlushes );
+
+#ifdef TLSSTAT_ENTROPY_POOL
+        vEntropyPoolGetStats( &xEntropyStats );
+        prvPrintStat( pxCIO, "entropy_requests", xEntropyStats.ulRequests );
+        prvPrintStat( pxCIO, "entropy_blocked", xEntropyStats.ulBlocked );
+        prvPrintStat( pxCIO, "entropy_refills", xEntropyStats.ulRefills );
+        prvPrintStat( pxCIO, "entropy_health_failures", xEntropyStats.ulHealthFailures );
+#endif /* TLSSTAT_ENTROPY_POOL */
+
+#ifdef TLSSTAT_CRYPTO_SCHED
+        prvPrintSchedStats( pxCIO, "cryp", &cryp_sched );
+        prvPrintSchedStats( pxCIO, "hash", &hash_sched );
+#endif /* TLSSTAT_CRYPTO_SCHED */
+        pxCIO->print( "+------------------------------------------+\r\n" );
+    }
+}
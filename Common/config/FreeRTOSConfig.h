@@ -194,6 +194,11 @@ extern uint32_t SystemCoreClock;
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
 #define portGET_RUN_TIME_COUNTER_VALUE()    ( timer_get_count( pxHndlTim5 ) )
 
+/* Provided by projdefs.h from FreeRTOS-Kernel V10.5.0 onwards. */
+#ifndef pdTICKS_TO_MS
+#define pdTICKS_TO_MS( xTimeInTicks )    ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInTicks ) * ( uint64_t ) 1000U ) / ( uint64_t ) configTICK_RATE_HZ ) )
+#endif
+
 
 
 #endif /* FREERTOS_CONFIG_H */
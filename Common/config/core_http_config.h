@@ -34,5 +34,21 @@
 
 #include "logging.h"
 
+/**
+ * @brief Value of the User-Agent header sent with every request.
+ */
+#define HTTP_USER_AGENT_VALUE          "FreeRTOS-STM32U5"
+
+/**
+ * @brief Time to wait for more of a response once no data was received.
+ *
+ * Requires the getTime function of the HTTPResponse_t to be set.
+ */
+#define HTTP_RECV_RETRY_TIMEOUT_MS     ( 1000U )
+
+/**
+ * @brief Time to keep retrying a send which did not make any progress.
+ */
+#define HTTP_SEND_RETRY_TIMEOUT_MS     ( 1000U )
 
 #endif /* CORE_HTTP_CONFIG_H */
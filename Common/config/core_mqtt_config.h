@@ -84,4 +84,12 @@
 
 #define MQTT_AGENT_MAX_EVENT_QUEUE_WAIT_TIME         ( 1 )
 
+/**
+ * @brief Set to 1 to connect the MQTT agent using the lwIP altcp (raw API)
+ * TLS transport rather than the socket based TLS transport.
+ */
+#ifndef MQTT_AGENT_USE_ALTCP_TRANSPORT
+#define MQTT_AGENT_USE_ALTCP_TRANSPORT               0
+#endif
+
 #endif /* ifndef CORE_MQTT_CONFIG_H */
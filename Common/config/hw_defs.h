@@ -30,6 +30,9 @@ extern UART_HandleTypeDef * pxHndlUart1;
 extern DCACHE_HandleTypeDef * pxHndlDCache;
 extern DMA_HandleTypeDef * pxHndlGpdmaCh4;
 extern DMA_HandleTypeDef * pxHndlGpdmaCh5;
+extern DMA_HandleTypeDef * pxHndlGpdmaCh6;
+extern DMA_HandleTypeDef * pxHndlGpdmaCh7;
+extern DMA_HandleTypeDef * pxHndlGpdmaCh8;
 extern IWDG_HandleTypeDef * pxHwndIwdg;
 
 static inline uint32_t timer_get_count( TIM_HandleTypeDef * pxHndl )
@@ -81,6 +81,11 @@
 /* Change next define to support socket interface */
 #define LWIP_SOCKET    1
 
+/**
+ * LWIP_ALTCP==1: Enable the altcp API, used by mbedtls_altcp_transport.c
+ */
+#define LWIP_ALTCP     1
+
 /*#define MEMP_NUM_TCP_PCB                5 */
 
 /*
@@ -38,6 +38,8 @@
 
 #include "logging.h"
 
+#include <stdint.h>
+
 
 /**
  *  @brief The version for the firmware which is running. OTA agent uses this
@@ -99,8 +101,35 @@
  *  how many data blocks response is expected for each data requests.
  *  Please note that this must be set larger than zero.
  *
+ *  The OTA update task adapts it at run time, between otaconfigINITIAL_BLOCK_WINDOW and
+ *  otaconfigMAX_BLOCK_WINDOW, to the time taken by a request to be answered and to the
+ *  number of free data buffers, see ulOtaGetBlockWindow.
+ */
+#define otaconfigMAX_NUM_BLOCKS_REQUEST         ( ulOtaGetBlockWindow() )
+
+/**
+ * @brief Number of data blocks requested at once until the round trip time is measured.
+ */
+#define otaconfigINITIAL_BLOCK_WINDOW           2U
+
+/**
+ * @brief Upper bound of the number of data blocks requested at once.
+ *
+ * One data buffer is reserved for each of them, see otaconfigMAX_NUM_OTA_DATA_BUFFERS.
+ * Must not exceed 128 KB divided by the block size.
+ *
+ * 4 lets the window double once from otaconfigINITIAL_BLOCK_WINDOW, for 5 data buffers
+ * (about 17.5 KB of RAM) instead of the 3 (about 10.5 KB) of a fixed window of 2 blocks.
+ * Raise it on links with a long round trip, at about 3.5 KB of RAM per block.
+ */
+#define otaconfigMAX_BLOCK_WINDOW               4U
+
+/**
+ * @brief Number of data blocks to request at once.
+ *
+ * Implemented by the OTA update task.
  */
-#define otaconfigMAX_NUM_BLOCKS_REQUEST         2U
+uint32_t ulOtaGetBlockWindow( void );
 
 /**
  * @brief The maximum number of requests allowed to send without a response before we abort.
@@ -116,8 +145,13 @@
  *
  * This configurations parameter sets the maximum number of static data buffers used by
  * the OTA agent for job and file data blocks received.
+ *
+ * Each buffer is an OtaEventData_t of OTA_DATA_BLOCK_SIZE bytes: the block size plus
+ * OTA_REQUEST_URL_MAX_SIZE and 30 bytes for the job documents, about 3.5 KB with 2 KB
+ * blocks. They are allocated statically by the OTA update task, so each block of
+ * otaconfigMAX_BLOCK_WINDOW costs about 3.5 KB of RAM.
  */
-#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       ( otaconfigMAX_NUM_BLOCKS_REQUEST + 1 )
+#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       ( otaconfigMAX_BLOCK_WINDOW + 1U )
 
 /**
  * @brief How frequently the device will report its OTA progress to the cloud.
@@ -171,7 +205,7 @@
  * Enable data over HTTP - ( OTA_DATA_OVER_HTTP)
  * Enable data over both MQTT & HTTP ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP )
  */
-#define configENABLED_DATA_PROTOCOLS      ( OTA_DATA_OVER_MQTT )
+#define configENABLED_DATA_PROTOCOLS      ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP )
 
 /**
  * @brief The preferred protocol selected for OTA data operations.
@@ -181,8 +215,13 @@
  * and following update here to switch to HTTP as primary.
  *
  * Note - use OTA_DATA_OVER_HTTP for HTTP as primary data protocol.
+ *
+ * HTTP is opt-in: it is used for jobs created with the HTTP protocol only, or
+ * for jobs created with both protocols once it is made the primary protocol.
+ * It downloads the file over its own connection in large range requests (see
+ * ota_http_transfer.h) instead of a request per block over the shared MQTT
+ * connection.
  */
-
 #define configOTA_PRIMARY_DATA_PROTOCOL    OTA_DATA_OVER_MQTT
 
 #endif /* OTA_CONFIG_H_ */
@@ -209,14 +209,14 @@ extern "C"
 #define  USE_HAL_ADC_REGISTER_CALLBACKS          0U /* ADC register callback disabled       */
 #define  USE_HAL_COMP_REGISTER_CALLBACKS         0U /* COMP register callback disabled      */
 #define  USE_HAL_CORDIC_REGISTER_CALLBACKS       0U /* CORDIC register callback disabled    */
-#define  USE_HAL_CRYP_REGISTER_CALLBACKS         0U /* CRYP register callback disabled      */
+#define  USE_HAL_CRYP_REGISTER_CALLBACKS         1U /* CRYP register callback enabled       */
 #define  USE_HAL_DAC_REGISTER_CALLBACKS          0U /* DAC register callback disabled       */
 #define  USE_HAL_DCMI_REGISTER_CALLBACKS         0U /* DCMI register callback disabled      */
 #define  USE_HAL_DMA2D_REGISTER_CALLBACKS        0U /* DMA2D register callback disabled     */
 #define  USE_HAL_ETH_REGISTER_CALLBACKS          0U /* ETH register callback disabled       */
 #define  USE_HAL_FDCAN_REGISTER_CALLBACKS        0U /* FDCAN register callback disabled     */
 #define  USE_HAL_FMAC_REGISTER_CALLBACKS         0U /* FMAC register callback disabled      */
-#define  USE_HAL_HASH_REGISTER_CALLBACKS         0U /* HASH register callback disabled      */
+#define  USE_HAL_HASH_REGISTER_CALLBACKS         1U /* HASH register callback enabled       */
 #define  USE_HAL_HCD_REGISTER_CALLBACKS          0U /* HCD register callback disabled       */
 #define  USE_HAL_I2C_REGISTER_CALLBACKS          1U /* I2C register callback disabled       */
 #define  USE_HAL_IWDG_REGISTER_CALLBACKS         0U /* IWDG register callback disabled      */
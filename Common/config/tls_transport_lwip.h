@@ -31,6 +31,7 @@
 #define sock_recv           lwip_recv
 #define sock_close          lwip_close
 #define sock_setsockopt     lwip_setsockopt
+#define sock_getsockopt     lwip_getsockopt
 #define sock_fcntl          lwip_fcntl
 #define sock_select         lwip_select
 
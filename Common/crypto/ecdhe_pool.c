@@ -0,0 +1,287 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ecdhe_pool.c
+ * @brief Pool of precomputed ECDHE ephemeral keypairs.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_INFO
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ecdhe_pool.h"
+
+/* Mbedtls Includes */
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include "mbedtls/private_access.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+
+#include "mbedtls_error_utils.h"
+
+typedef struct EcdhePoolSlot
+{
+    mbedtls_mpi xD;
+    mbedtls_ecp_point xQ;
+    BaseType_t xReady;
+} EcdhePoolSlot_t;
+
+static EcdhePoolSlot_t xPool[ ECDHE_POOL_SIZE ] = { 0 };
+static EcdhePoolStats_t xPoolStats = { 0 };
+static TaskHandle_t xPoolTaskHandle = NULL;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Exchange the contents of two keypairs without copying the underlying limbs.
+ */
+static void prvSwapKeypair( mbedtls_mpi * pxD1,
+                            mbedtls_ecp_point * pxQ1,
+                            mbedtls_mpi * pxD2,
+                            mbedtls_ecp_point * pxQ2 )
+{
+    mbedtls_mpi_swap( pxD1, pxD2 );
+    mbedtls_mpi_swap( &( pxQ1->MBEDTLS_PRIVATE( X ) ), &( pxQ2->MBEDTLS_PRIVATE( X ) ) );
+    mbedtls_mpi_swap( &( pxQ1->MBEDTLS_PRIVATE( Y ) ), &( pxQ2->MBEDTLS_PRIVATE( Y ) ) );
+    mbedtls_mpi_swap( &( pxQ1->MBEDTLS_PRIVATE( Z ) ), &( pxQ2->MBEDTLS_PRIVATE( Z ) ) );
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xEcdhePoolTake( mbedtls_ecp_group_id xGroupId,
+                           mbedtls_mpi * pxD,
+                           mbedtls_ecp_point * pxQ )
+{
+    BaseType_t xTaken = pdFALSE;
+
+    configASSERT( pxD != NULL );
+    configASSERT( pxQ != NULL );
+
+    if( xGroupId == ECDHE_POOL_CURVE )
+    {
+        taskENTER_CRITICAL();
+
+        for( uint32_t i = 0; ( i < ECDHE_POOL_SIZE ) && ( xTaken == pdFALSE ); i++ )
+        {
+            if( xPool[ i ].xReady == pdTRUE )
+            {
+                /* The slot is left holding the caller's previous values,
+                 * which are freed by the pool task when the slot is refilled. */
+                prvSwapKeypair( pxD, pxQ, &( xPool[ i ].xD ), &( xPool[ i ].xQ ) );
+                xPool[ i ].xReady = pdFALSE;
+                xTaken = pdTRUE;
+            }
+        }
+
+        if( xTaken == pdTRUE )
+        {
+            xPoolStats.ulHits++;
+        }
+        else
+        {
+            xPoolStats.ulMisses++;
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( xPoolTaskHandle != NULL )
+        {
+            ( void ) xTaskNotifyGive( xPoolTaskHandle );
+        }
+    }
+
+    return xTaken;
+}
+
+/*-----------------------------------------------------------*/
+
+void vEcdhePoolGetStats( EcdhePoolStats_t * pxStats )
+{
+    configASSERT( pxStats != NULL );
+
+    taskENTER_CRITICAL();
+    *pxStats = xPoolStats;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+#if defined( MBEDTLS_ECDH_GEN_PUBLIC_ALT )
+
+/*
+ * Place a keypair in an empty slot. On return pxD and pxQ hold the previous
+ * contents of the slot, or the unused keypair if the pool was full.
+ */
+static BaseType_t prvPoolPut( mbedtls_mpi * pxD,
+                              mbedtls_ecp_point * pxQ )
+{
+    BaseType_t xStored = pdFALSE;
+
+    taskENTER_CRITICAL();
+
+    for( uint32_t i = 0; ( i < ECDHE_POOL_SIZE ) && ( xStored == pdFALSE ); i++ )
+    {
+        if( xPool[ i ].xReady == pdFALSE )
+        {
+            prvSwapKeypair( pxD, pxQ, &( xPool[ i ].xD ), &( xPool[ i ].xQ ) );
+            xPool[ i ].xReady = pdTRUE;
+            xPoolStats.ulGenerated++;
+            xStored = pdTRUE;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    return xStored;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPoolIsFull( void )
+{
+    BaseType_t xFull = pdTRUE;
+
+    taskENTER_CRITICAL();
+
+    for( uint32_t i = 0; i < ECDHE_POOL_SIZE; i++ )
+    {
+        if( xPool[ i ].xReady == pdFALSE )
+        {
+            xFull = pdFALSE;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    return xFull;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_ecdh_gen_public( mbedtls_ecp_group * grp,
+                             mbedtls_mpi * d,
+                             mbedtls_ecp_point * Q,
+                             int ( * f_rng )( void *, unsigned char *, size_t ),
+                             void * p_rng )
+{
+    int lError = 0;
+
+    if( xEcdhePoolTake( grp->id, d, Q ) == pdFALSE )
+    {
+        lError = mbedtls_ecp_gen_keypair( grp, d, Q, f_rng, p_rng );
+    }
+
+    return lError;
+}
+
+#endif /* MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+
+/*-----------------------------------------------------------*/
+
+void vEcdhePoolTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+#if defined( MBEDTLS_ECDH_GEN_PUBLIC_ALT )
+    int lError = 0;
+    mbedtls_ecp_group xGroup;
+    mbedtls_entropy_context xEntropyCtx;
+    mbedtls_ctr_drbg_context xCtrDrbgCtx;
+    mbedtls_mpi xD;
+    mbedtls_ecp_point xQ;
+
+    mbedtls_ecp_group_init( &xGroup );
+    mbedtls_entropy_init( &xEntropyCtx );
+    mbedtls_ctr_drbg_init( &xCtrDrbgCtx );
+    mbedtls_mpi_init( &xD );
+    mbedtls_ecp_point_init( &xQ );
+
+    for( uint32_t i = 0; i < ECDHE_POOL_SIZE; i++ )
+    {
+        mbedtls_mpi_init( &( xPool[ i ].xD ) );
+        mbedtls_ecp_point_init( &( xPool[ i ].xQ ) );
+        xPool[ i ].xReady = pdFALSE;
+    }
+
+    lError = mbedtls_ecp_group_load( &xGroup, ECDHE_POOL_CURVE );
+
+    MBEDTLS_MSG_IF_ERROR( lError, "Failed to load ECDHE pool curve: Error:" );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ctr_drbg_seed( &xCtrDrbgCtx, mbedtls_entropy_func,
+                                        &xEntropyCtx, NULL, 0 );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to seed ECDHE pool PRNG: Error:" );
+    }
+
+    if( lError == 0 )
+    {
+        xPoolTaskHandle = xTaskGetCurrentTaskHandle();
+    }
+
+    while( lError == 0 )
+    {
+        if( prvPoolIsFull() == pdTRUE )
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+        }
+        else
+        {
+            lError = mbedtls_ecp_gen_keypair( &xGroup, &xD, &xQ,
+                                              mbedtls_ctr_drbg_random, &xCtrDrbgCtx );
+
+            MBEDTLS_MSG_IF_ERROR( lError, "Failed to generate ECDHE keypair: Error:" );
+
+            if( lError == 0 )
+            {
+                ( void ) prvPoolPut( &xD, &xQ );
+            }
+
+            /* Zeroize whatever was swapped out of the pool. */
+            mbedtls_mpi_free( &xD );
+            mbedtls_ecp_point_free( &xQ );
+        }
+    }
+
+    xPoolTaskHandle = NULL;
+
+    mbedtls_ecp_group_free( &xGroup );
+    mbedtls_ctr_drbg_free( &xCtrDrbgCtx );
+    mbedtls_entropy_free( &xEntropyCtx );
+
+    LogError( "ECDHE keypair pool disabled." );
+#else
+    LogInfo( "MBEDTLS_ECDH_GEN_PUBLIC_ALT is not enabled. ECDHE keypair pool disabled." );
+#endif /* MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+
+    vTaskDelete( NULL );
+}
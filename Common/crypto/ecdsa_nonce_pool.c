@@ -0,0 +1,681 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ecdsa_nonce_pool.c
+ * @brief Pool of precomputed ECDSA nonces.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_INFO
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+#include "ecdsa_nonce_pool.h"
+
+/* Mbedtls Includes */
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include "mbedtls/private_access.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/platform_util.h"
+
+#include "mbedtls_error_utils.h"
+
+/* Number of nonces tried before giving up on a signature, as in mbedtls */
+#define ECDSA_NONCE_MAX_TRIES    10
+
+/* Length of the random salt of the key tag */
+#define ECDSA_KEY_SALT_LEN       16U
+
+/*
+ * A precomputed nonce: r = (k.G).x mod n, a random blinding value t and
+ * ( k t )^-1 mod n, big endian, padded to the length of n.
+ */
+typedef struct EcdsaNonce
+{
+    uint8_t ucR[ ECDSA_NONCE_POOL_MAX_BYTES ];
+    uint8_t ucT[ ECDSA_NONCE_POOL_MAX_BYTES ];
+    uint8_t ucKInv[ ECDSA_NONCE_POOL_MAX_BYTES ];
+    BaseType_t xReady;
+} EcdsaNonce_t;
+
+static EcdsaNonce_t xPool[ ECDSA_NONCE_POOL_SIZE ] = { 0 };
+static EcdsaNoncePoolStats_t xPoolStats = { 0 };
+static TaskHandle_t xPoolTaskHandle = NULL;
+
+#if defined( ECDSA_NONCE_POOL_ENABLED )
+
+/* Salted SHA-256 of the private key of the previous signature. The salt is
+ * drawn when the pool task starts, so that the tag cannot be matched against
+ * a known key. */
+static uint8_t ucKeySalt[ ECDSA_KEY_SALT_LEN ] = { 0 };
+static uint8_t ucKeyTag[ 32 ] = { 0 };
+static BaseType_t xKeyTagValid = pdFALSE;
+
+#endif /* ECDSA_NONCE_POOL_ENABLED */
+
+/*-----------------------------------------------------------*/
+
+void vEcdsaNoncePoolFlush( void )
+{
+    taskENTER_CRITICAL();
+
+    for( uint32_t i = 0; i < ECDSA_NONCE_POOL_SIZE; i++ )
+    {
+        mbedtls_platform_zeroize( &( xPool[ i ] ), sizeof( xPool[ i ] ) );
+        xPool[ i ].xReady = pdFALSE;
+    }
+
+    xPoolStats.ulFlushes++;
+
+    taskEXIT_CRITICAL();
+
+    if( xPoolTaskHandle != NULL )
+    {
+        ( void ) xTaskNotifyGive( xPoolTaskHandle );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vEcdsaNoncePoolGetStats( EcdsaNoncePoolStats_t * pxStats )
+{
+    configASSERT( pxStats != NULL );
+
+    taskENTER_CRITICAL();
+    *pxStats = xPoolStats;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+#if defined( ECDSA_NONCE_POOL_ENABLED )
+
+/*
+ * Move a precomputed nonce into pxNonce and wipe its slot.
+ */
+static BaseType_t prvPoolTake( mbedtls_ecp_group_id xGroupId,
+                               EcdsaNonce_t * pxNonce )
+{
+    BaseType_t xTaken = pdFALSE;
+
+    if( xGroupId == ECDSA_NONCE_POOL_CURVE )
+    {
+        taskENTER_CRITICAL();
+
+        for( uint32_t i = 0; ( i < ECDSA_NONCE_POOL_SIZE ) && ( xTaken == pdFALSE ); i++ )
+        {
+            if( xPool[ i ].xReady == pdTRUE )
+            {
+                ( void ) memcpy( pxNonce, &( xPool[ i ] ), sizeof( EcdsaNonce_t ) );
+                mbedtls_platform_zeroize( &( xPool[ i ] ), sizeof( xPool[ i ] ) );
+                xPool[ i ].xReady = pdFALSE;
+                xTaken = pdTRUE;
+            }
+        }
+
+        if( xTaken == pdTRUE )
+        {
+            xPoolStats.ulHits++;
+        }
+        else
+        {
+            xPoolStats.ulMisses++;
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( xPoolTaskHandle != NULL )
+        {
+            ( void ) xTaskNotifyGive( xPoolTaskHandle );
+        }
+    }
+
+    return xTaken;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Place a nonce in an empty slot. The nonce is dropped if the pool was
+ * flushed since ulFlushes was read, before the nonce was computed.
+ */
+static BaseType_t prvPoolPut( const EcdsaNonce_t * pxNonce,
+                              uint32_t ulFlushes )
+{
+    BaseType_t xStored = pdFALSE;
+
+    taskENTER_CRITICAL();
+
+    for( uint32_t i = 0;
+         ( i < ECDSA_NONCE_POOL_SIZE ) && ( xStored == pdFALSE ) && ( xPoolStats.ulFlushes == ulFlushes );
+         i++ )
+    {
+        if( xPool[ i ].xReady == pdFALSE )
+        {
+            ( void ) memcpy( &( xPool[ i ] ), pxNonce, sizeof( EcdsaNonce_t ) );
+            xPool[ i ].xReady = pdTRUE;
+            xPoolStats.ulGenerated++;
+            xStored = pdTRUE;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    return xStored;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvPoolIsFull( void )
+{
+    BaseType_t xFull = pdTRUE;
+
+    taskENTER_CRITICAL();
+
+    for( uint32_t i = 0; i < ECDSA_NONCE_POOL_SIZE; i++ )
+    {
+        if( xPool[ i ].xReady == pdFALSE )
+        {
+            xFull = pdFALSE;
+        }
+    }
+
+    taskEXIT_CRITICAL();
+
+    return xFull;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Wipe the pool when the private key differs from the one of the previous
+ * signature.
+ */
+static int prvCheckKey( const mbedtls_mpi * pxD )
+{
+    int lError = 0;
+    uint8_t ucKeyBuf[ ECDSA_KEY_SALT_LEN + ECDSA_NONCE_POOL_MAX_BYTES ];
+    uint8_t ucTag[ 32 ];
+    BaseType_t xChanged = pdFALSE;
+
+    ( void ) memcpy( ucKeyBuf, ucKeySalt, ECDSA_KEY_SALT_LEN );
+
+    lError = mbedtls_mpi_write_binary( pxD, &( ucKeyBuf[ ECDSA_KEY_SALT_LEN ] ),
+                                       ECDSA_NONCE_POOL_MAX_BYTES );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_sha256( ucKeyBuf, sizeof( ucKeyBuf ), ucTag, 0 );
+    }
+
+    if( lError == 0 )
+    {
+        taskENTER_CRITICAL();
+
+        if( ( xKeyTagValid == pdTRUE ) &&
+            ( memcmp( ucKeyTag, ucTag, sizeof( ucTag ) ) != 0 ) )
+        {
+            xChanged = pdTRUE;
+        }
+
+        ( void ) memcpy( ucKeyTag, ucTag, sizeof( ucTag ) );
+        xKeyTagValid = pdTRUE;
+
+        taskEXIT_CRITICAL();
+    }
+
+    if( xChanged == pdTRUE )
+    {
+        LogInfo( "ECDSA signing key changed. Flushing the nonce pool." );
+        vEcdsaNoncePoolFlush();
+    }
+
+    mbedtls_platform_zeroize( ucKeyBuf, sizeof( ucKeyBuf ) );
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Compute a nonce: draw k and t in [1, n-1], r = (k.G).x mod n != 0 and
+ * ( k t )^-1 mod n. The nonce is held in MPIs, so any curve can be used.
+ */
+static int prvNonceCompute( mbedtls_ecp_group * pxGroup,
+                            mbedtls_mpi * pxR,
+                            mbedtls_mpi * pxT,
+                            mbedtls_mpi * pxKInv,
+                            int ( * f_rng )( void *, unsigned char *, size_t ),
+                            void * p_rng )
+{
+    int lError = 0;
+    int lTries = 0;
+    mbedtls_ecp_point xPointR;
+
+    mbedtls_ecp_point_init( &xPointR );
+
+    /* pxKInv holds k until it is inverted */
+    do
+    {
+        if( ++lTries > ECDSA_NONCE_MAX_TRIES )
+        {
+            lError = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+        }
+
+        if( lError == 0 )
+        {
+            lError = mbedtls_ecp_gen_privkey( pxGroup, pxKInv, f_rng, p_rng );
+        }
+
+        if( lError == 0 )
+        {
+            lError = mbedtls_ecp_mul( pxGroup, &xPointR, pxKInv, &( pxGroup->G ), f_rng, p_rng );
+        }
+
+        if( lError == 0 )
+        {
+            lError = mbedtls_mpi_mod_mpi( pxR, &( xPointR.MBEDTLS_PRIVATE( X ) ), &( pxGroup->N ) );
+        }
+    }
+    while( ( lError == 0 ) && ( mbedtls_mpi_cmp_int( pxR, 0 ) == 0 ) );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ecp_gen_privkey( pxGroup, pxT, f_rng, p_rng );
+    }
+
+    /* pxKInv = ( k t )^-1 mod n */
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mul_mpi( pxKInv, pxKInv, pxT );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mod_mpi( pxKInv, pxKInv, &( pxGroup->N ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_inv_mod( pxKInv, pxKInv, &( pxGroup->N ) );
+    }
+
+    mbedtls_ecp_point_free( &xPointR );
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Compute a nonce of ECDSA_NONCE_POOL_CURVE for the pool, big endian,
+ * padded to the length of n.
+ */
+static int prvNonceGenerate( mbedtls_ecp_group * pxGroup,
+                             EcdsaNonce_t * pxNonce,
+                             int ( * f_rng )( void *, unsigned char *, size_t ),
+                             void * p_rng )
+{
+    int lError = 0;
+    size_t uxLen = ( pxGroup->nbits + 7U ) / 8U;
+    mbedtls_mpi xR;
+    mbedtls_mpi xT;
+    mbedtls_mpi xKInv;
+
+    if( uxLen > ECDSA_NONCE_POOL_MAX_BYTES )
+    {
+        return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+    }
+
+    mbedtls_mpi_init( &xR );
+    mbedtls_mpi_init( &xT );
+    mbedtls_mpi_init( &xKInv );
+
+    lError = prvNonceCompute( pxGroup, &xR, &xT, &xKInv, f_rng, p_rng );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_write_binary( &xR, pxNonce->ucR, uxLen );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_write_binary( &xT, pxNonce->ucT, uxLen );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_write_binary( &xKInv, pxNonce->ucKInv, uxLen );
+    }
+
+    mbedtls_mpi_free( &xR );
+    mbedtls_mpi_free( &xT );
+    mbedtls_mpi_free( &xKInv );
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Load a pooled nonce into MPIs.
+ */
+static int prvNonceLoad( const mbedtls_ecp_group * pxGroup,
+                         const EcdsaNonce_t * pxNonce,
+                         mbedtls_mpi * pxR,
+                         mbedtls_mpi * pxT,
+                         mbedtls_mpi * pxKInv )
+{
+    int lError = 0;
+    size_t uxLen = ( pxGroup->nbits + 7U ) / 8U;
+
+    lError = mbedtls_mpi_read_binary( pxR, pxNonce->ucR, uxLen );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_read_binary( pxT, pxNonce->ucT, uxLen );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_read_binary( pxKInv, pxNonce->ucKInv, uxLen );
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Convert a hash to an integer modulo n, as mbedtls does: keep the leftmost
+ * bits of the hash up to the bit length of n.
+ */
+static int prvHashToMpi( const mbedtls_ecp_group * pxGroup,
+                         mbedtls_mpi * pxE,
+                         const unsigned char * pucBuf,
+                         size_t uxBufLen )
+{
+    int lError = 0;
+    size_t uxNLen = ( pxGroup->nbits + 7U ) / 8U;
+    size_t uxUseLen = ( uxBufLen > uxNLen ) ? uxNLen : uxBufLen;
+
+    lError = mbedtls_mpi_read_binary( pxE, pucBuf, uxUseLen );
+
+    if( ( lError == 0 ) &&
+        ( ( uxUseLen * 8U ) > pxGroup->nbits ) )
+    {
+        lError = mbedtls_mpi_shift_r( pxE, ( uxUseLen * 8U ) - pxGroup->nbits );
+    }
+
+    if( ( lError == 0 ) &&
+        ( mbedtls_mpi_cmp_mpi( pxE, &( pxGroup->N ) ) >= 0 ) )
+    {
+        lError = mbedtls_mpi_sub_mpi( pxE, pxE, &( pxGroup->N ) );
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * s = ( k t )^-1 ( t e + t r d ) mod n. The blinding value t keeps the
+ * operations on the private key independent of the hash.
+ */
+static int prvSignWithNonce( const mbedtls_ecp_group * pxGroup,
+                             const mbedtls_mpi * pxR,
+                             const mbedtls_mpi * pxT,
+                             const mbedtls_mpi * pxKInv,
+                             const mbedtls_mpi * pxE,
+                             const mbedtls_mpi * pxD,
+                             mbedtls_mpi * pxS )
+{
+    int lError = 0;
+    mbedtls_mpi xTmp;
+
+    mbedtls_mpi_init( &xTmp );
+
+    /* xTmp = t r d mod n */
+    lError = mbedtls_mpi_mul_mpi( &xTmp, pxR, pxT );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mod_mpi( &xTmp, &xTmp, &( pxGroup->N ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mul_mpi( &xTmp, &xTmp, pxD );
+    }
+
+    /* s = ( t e + t r d ) ( k t )^-1 mod n */
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mul_mpi( pxS, pxE, pxT );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_add_mpi( pxS, pxS, &xTmp );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mod_mpi( pxS, pxS, &( pxGroup->N ) );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mul_mpi( pxS, pxS, pxKInv );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_mpi_mod_mpi( pxS, pxS, &( pxGroup->N ) );
+    }
+
+    mbedtls_mpi_free( &xTmp );
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+int mbedtls_ecdsa_sign( mbedtls_ecp_group * grp,
+                        mbedtls_mpi * r,
+                        mbedtls_mpi * s,
+                        const mbedtls_mpi * d,
+                        const unsigned char * buf,
+                        size_t blen,
+                        int ( * f_rng )( void *, unsigned char *, size_t ),
+                        void * p_rng )
+{
+    int lError = 0;
+    int lTries = 0;
+    EcdsaNonce_t xNonce;
+    mbedtls_mpi xE;
+    mbedtls_mpi xT;
+    mbedtls_mpi xKInv;
+
+    if( ( grp == NULL ) || ( r == NULL ) || ( s == NULL ) || ( d == NULL ) ||
+        ( ( buf == NULL ) && ( blen != 0 ) ) || ( f_rng == NULL ) ||
+        ( grp->N.MBEDTLS_PRIVATE( p ) == NULL ) ||
+        ( mbedtls_ecp_get_type( grp ) != MBEDTLS_ECP_TYPE_SHORT_WEIERSTRASS ) )
+    {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+    if( ( mbedtls_mpi_cmp_int( d, 1 ) < 0 ) ||
+        ( mbedtls_mpi_cmp_mpi( d, &( grp->N ) ) >= 0 ) )
+    {
+        return MBEDTLS_ERR_ECP_INVALID_KEY;
+    }
+
+    mbedtls_mpi_init( &xE );
+    mbedtls_mpi_init( &xT );
+    mbedtls_mpi_init( &xKInv );
+
+    if( grp->id == ECDSA_NONCE_POOL_CURVE )
+    {
+        lError = prvCheckKey( d );
+    }
+
+    if( lError == 0 )
+    {
+        lError = prvHashToMpi( grp, &xE, buf, blen );
+    }
+
+    /* Retry with another nonce in the unlikely case that s = 0 */
+    do
+    {
+        if( ++lTries > ECDSA_NONCE_MAX_TRIES )
+        {
+            lError = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+        }
+
+        /* Nonces are only pooled for ECDSA_NONCE_POOL_CURVE. Other curves and
+         * an empty pool compute the nonce now, in MPIs sized for the curve. */
+        if( lError == 0 )
+        {
+            if( prvPoolTake( grp->id, &xNonce ) == pdTRUE )
+            {
+                lError = prvNonceLoad( grp, &xNonce, r, &xT, &xKInv );
+                mbedtls_platform_zeroize( &xNonce, sizeof( xNonce ) );
+            }
+            else
+            {
+                lError = prvNonceCompute( grp, r, &xT, &xKInv, f_rng, p_rng );
+            }
+        }
+
+        if( lError == 0 )
+        {
+            lError = prvSignWithNonce( grp, r, &xT, &xKInv, &xE, d, s );
+        }
+    }
+    while( ( lError == 0 ) && ( mbedtls_mpi_cmp_int( s, 0 ) == 0 ) );
+
+    mbedtls_mpi_free( &xE );
+    mbedtls_mpi_free( &xT );
+    mbedtls_mpi_free( &xKInv );
+
+    return lError;
+}
+
+#endif /* ECDSA_NONCE_POOL_ENABLED */
+
+/*-----------------------------------------------------------*/
+
+void vEcdsaNoncePoolTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+#if defined( ECDSA_NONCE_POOL_ENABLED )
+    int lError = 0;
+    mbedtls_ecp_group xGroup;
+    mbedtls_entropy_context xEntropyCtx;
+    mbedtls_ctr_drbg_context xCtrDrbgCtx;
+    EcdsaNonce_t xNonce;
+    uint32_t ulFlushes;
+
+    mbedtls_ecp_group_init( &xGroup );
+    mbedtls_entropy_init( &xEntropyCtx );
+    mbedtls_ctr_drbg_init( &xCtrDrbgCtx );
+
+    /* Nothing computed before a reset is ever used */
+    vEcdsaNoncePoolFlush();
+
+    lError = mbedtls_ecp_group_load( &xGroup, ECDSA_NONCE_POOL_CURVE );
+
+    MBEDTLS_MSG_IF_ERROR( lError, "Failed to load ECDSA nonce pool curve: Error:" );
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ctr_drbg_seed( &xCtrDrbgCtx, mbedtls_entropy_func,
+                                        &xEntropyCtx, NULL, 0 );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to seed ECDSA nonce pool PRNG: Error:" );
+    }
+
+    if( lError == 0 )
+    {
+        lError = mbedtls_ctr_drbg_random( &xCtrDrbgCtx, ucKeySalt, sizeof( ucKeySalt ) );
+    }
+
+    if( lError == 0 )
+    {
+        xPoolTaskHandle = xTaskGetCurrentTaskHandle();
+    }
+
+    while( lError == 0 )
+    {
+        if( prvPoolIsFull() == pdTRUE )
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+        }
+        else
+        {
+            taskENTER_CRITICAL();
+            ulFlushes = xPoolStats.ulFlushes;
+            taskEXIT_CRITICAL();
+
+            lError = prvNonceGenerate( &xGroup, &xNonce,
+                                       mbedtls_ctr_drbg_random, &xCtrDrbgCtx );
+
+            MBEDTLS_MSG_IF_ERROR( lError, "Failed to generate ECDSA nonce: Error:" );
+
+            if( lError == 0 )
+            {
+                ( void ) prvPoolPut( &xNonce, ulFlushes );
+            }
+
+            mbedtls_platform_zeroize( &xNonce, sizeof( xNonce ) );
+        }
+    }
+
+    xPoolTaskHandle = NULL;
+
+    vEcdsaNoncePoolFlush();
+
+    mbedtls_ecp_group_free( &xGroup );
+    mbedtls_ctr_drbg_free( &xCtrDrbgCtx );
+    mbedtls_entropy_free( &xEntropyCtx );
+
+    LogError( "ECDSA nonce pool disabled." );
+#else
+    LogInfo( "ECDSA_NONCE_POOL is not enabled. ECDSA nonce pool disabled." );
+#endif /* ECDSA_NONCE_POOL_ENABLED */
+
+    vTaskDelete( NULL );
+}
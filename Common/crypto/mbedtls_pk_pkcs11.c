@@ -1376,7 +1376,9 @@ static size_t p11_ecdsa_get_bitlen( const void * pvCtx )
 
 static int p11_ecdsa_can_do( mbedtls_pk_type_t xType )
 {
-    return( xType == MBEDTLS_PK_ECDSA );
+    /* Match mbedtls eckey_can_do so that the key is usable for TLS 1.3 CertificateVerify */
+    return( ( xType == MBEDTLS_PK_ECDSA ) ||
+            ( xType == MBEDTLS_PK_ECKEY ) );
 }
 
 static int p11_ecdsa_verify( void * pvCtx,
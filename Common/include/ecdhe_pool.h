@@ -0,0 +1,96 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ecdhe_pool.h
+ * @brief Pool of precomputed ECDHE ephemeral keypairs.
+ *
+ * When MBEDTLS_ECDH_GEN_PUBLIC_ALT is defined in the mbedtls configuration,
+ * mbedtls_ecdh_gen_public takes a keypair generated ahead of time by
+ * vEcdhePoolTask instead of computing one during the handshake. Each pooled
+ * keypair is handed out exactly once.
+ */
+
+#ifndef _ECDHE_POOL_H_
+#define _ECDHE_POOL_H_
+
+#include "FreeRTOS.h"
+
+#include "tls_transport_config.h"
+
+#include "mbedtls/ecp.h"
+
+/**
+ * @brief Number of keypairs kept ready for use.
+ */
+#ifndef ECDHE_POOL_SIZE
+#define ECDHE_POOL_SIZE    2U
+#endif
+
+/**
+ * @brief Curve for which keypairs are precomputed.
+ * Keypairs for other curves are generated on demand.
+ */
+#ifndef ECDHE_POOL_CURVE
+#define ECDHE_POOL_CURVE    MBEDTLS_ECP_DP_SECP256R1
+#endif
+
+/**
+ * @brief Statistics of the keypair pool.
+ */
+typedef struct EcdhePoolStats
+{
+    uint32_t ulGenerated; /**< Number of keypairs precomputed. */
+    uint32_t ulHits;      /**< Number of requests served from the pool. */
+    uint32_t ulMisses;    /**< Number of requests for the pool curve that found the pool empty. */
+} EcdhePoolStats_t;
+
+/**
+ * @brief Task which keeps the pool filled.
+ *
+ * Should be created at a low priority so that keypairs are generated when the
+ * system is otherwise idle. The task deletes itself when
+ * MBEDTLS_ECDH_GEN_PUBLIC_ALT is not enabled.
+ */
+void vEcdhePoolTask( void * pvParameters );
+
+/**
+ * @brief Take a precomputed keypair from the pool.
+ *
+ * The keypair is moved into pxD and pxQ and removed from the pool.
+ *
+ * @param[in] xGroupId Curve of the requested keypair.
+ * @param[out] pxD Private key.
+ * @param[out] pxQ Public key.
+ *
+ * @return pdTRUE if a keypair was available, pdFALSE otherwise.
+ */
+BaseType_t xEcdhePoolTake( mbedtls_ecp_group_id xGroupId,
+                           mbedtls_mpi * pxD,
+                           mbedtls_ecp_point * pxQ );
+
+/**
+ * @brief Retrieve the pool statistics.
+ */
+void vEcdhePoolGetStats( EcdhePoolStats_t * pxStats );
+
+#endif /* _ECDHE_POOL_H_ */
@@ -0,0 +1,124 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file ecdsa_nonce_pool.h
+ * @brief Pool of precomputed ECDSA nonces.
+ *
+ * Most of the cost of an ECDSA signature is the scalar multiplication k.G of
+ * the nonce k, which does not depend on the message or on the key. When
+ * ECDSA_NONCE_POOL and MBEDTLS_ECDSA_SIGN_ALT are defined in the mbedtls
+ * configuration, vEcdsaNoncePoolTask precomputes r = (k.G).x mod n and the
+ * blinded inverse of k in idle time, and mbedtls_ecdsa_sign only has to
+ * compute s = k^-1 (e + r d) mod n. Each pooled nonce is handed out exactly
+ * once and wiped when it is taken.
+ *
+ * k.G is computed with mbedtls_ecp_mul. MBEDTLS_ECP_ALT is not enabled in the
+ * project configurations, so this is the software implementation of mbedtls:
+ * the pool moves the point multiplication out of the handshake, but nothing is
+ * offloaded to the PKA unless MBEDTLS_ECP_ALT is enabled.
+ *
+ * mbedtls_ecdsa_sign is replaced for every curve. Signatures on curves other
+ * than ECDSA_NONCE_POOL_CURVE compute their nonce when they are made.
+ *
+ * Signatures made with a pooled nonce are randomized: deterministic
+ * signatures (RFC 6979) are not produced while the pool is enabled.
+ */
+
+#ifndef _ECDSA_NONCE_POOL_H_
+#define _ECDSA_NONCE_POOL_H_
+
+#include "FreeRTOS.h"
+
+#include "tls_transport_config.h"
+
+#include "mbedtls/ecp.h"
+
+#if defined( MBEDTLS_ECDSA_SIGN_ALT ) && defined( ECDSA_NONCE_POOL )
+#define ECDSA_NONCE_POOL_ENABLED
+#endif
+
+/**
+ * @brief Number of nonces kept ready for use.
+ * Each nonce takes 3 * ECDSA_NONCE_POOL_MAX_BYTES bytes of RAM.
+ */
+#ifndef ECDSA_NONCE_POOL_SIZE
+#define ECDSA_NONCE_POOL_SIZE    4U
+#endif
+
+#if ( ECDSA_NONCE_POOL_SIZE < 1U ) || ( ECDSA_NONCE_POOL_SIZE > 16U )
+#error "ECDSA_NONCE_POOL_SIZE must be between 1 and 16."
+#endif
+
+/**
+ * @brief Curve for which nonces are precomputed.
+ * Signatures on other curves compute their nonce on demand, without any
+ * limit on the size of the curve.
+ */
+#ifndef ECDSA_NONCE_POOL_CURVE
+#define ECDSA_NONCE_POOL_CURVE    MBEDTLS_ECP_DP_SECP256R1
+#endif
+
+/**
+ * @brief Size in bytes of the order of ECDSA_NONCE_POOL_CURVE.
+ * Only sizes the pooled nonces.
+ */
+#ifndef ECDSA_NONCE_POOL_MAX_BYTES
+#define ECDSA_NONCE_POOL_MAX_BYTES    32U
+#endif
+
+/**
+ * @brief Statistics of the nonce pool.
+ */
+typedef struct EcdsaNoncePoolStats
+{
+    uint32_t ulGenerated; /**< Number of nonces precomputed. */
+    uint32_t ulHits;      /**< Number of signatures made with a pooled nonce. */
+    uint32_t ulMisses;    /**< Number of signatures on the pool curve that found the pool empty. */
+    uint32_t ulFlushes;   /**< Number of times the pool was wiped. */
+} EcdsaNoncePoolStats_t;
+
+/**
+ * @brief Task which keeps the pool filled.
+ *
+ * Should be created at a low priority so that nonces are generated when the
+ * system is otherwise idle. The pool is wiped when the task starts. The task
+ * deletes itself when ECDSA_NONCE_POOL_ENABLED is not defined.
+ */
+void vEcdsaNoncePoolTask( void * pvParameters );
+
+/**
+ * @brief Wipe all the pooled nonces.
+ *
+ * Called when the signing key changes. mbedtls_ecdsa_sign also wipes the
+ * pool when it is called with a different private key than the previous
+ * signature.
+ */
+void vEcdsaNoncePoolFlush( void );
+
+/**
+ * @brief Retrieve the pool statistics.
+ */
+void vEcdsaNoncePoolGetStats( EcdsaNoncePoolStats_t * pxStats );
+
+#endif /* _ECDSA_NONCE_POOL_H_ */
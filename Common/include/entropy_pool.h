@@ -0,0 +1,67 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file entropy_pool.h
+ * @brief Buffered hardware entropy source.
+ *
+ * mbedtls_hardware_poll is served from a ring of words filled by the RNG
+ * interrupt. The ring is refilled in the background whenever its level falls
+ * under a low water mark, so that callers normally return without blocking.
+ */
+
+#ifndef _ENTROPY_POOL_H_
+#define _ENTROPY_POOL_H_
+
+#include "FreeRTOS.h"
+
+/**
+ * @brief Size of the ring in 32 bit words. Must be a power of two.
+ */
+#ifndef ENTROPY_POOL_WORDS
+#define ENTROPY_POOL_WORDS    64U
+#endif
+
+/**
+ * @brief Level (in words) under which the ring is refilled.
+ */
+#ifndef ENTROPY_POOL_LOW_WATER
+#define ENTROPY_POOL_LOW_WATER    ( ENTROPY_POOL_WORDS / 2U )
+#endif
+
+/**
+ * @brief Statistics of the entropy pool.
+ */
+typedef struct EntropyPoolStats
+{
+    uint32_t ulRequests;       /**< Number of calls to mbedtls_hardware_poll. */
+    uint32_t ulBlocked;        /**< Number of calls which waited for the RNG. */
+    uint32_t ulRefills;        /**< Number of refills started at the low water mark. */
+    uint32_t ulHealthFailures; /**< Number of seed or clock errors reported by the RNG. */
+} EntropyPoolStats_t;
+
+/**
+ * @brief Retrieve the entropy pool statistics.
+ */
+void vEntropyPoolGetStats( EntropyPoolStats_t * pxStats );
+
+#endif /* _ENTROPY_POOL_H_ */
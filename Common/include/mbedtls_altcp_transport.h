@@ -0,0 +1,169 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mbedtls_altcp_transport.h
+ * @brief TLS transport interface header for the lwIP altcp (raw API) transport.
+ *
+ * This transport provides the same interface as mbedtls_transport.h, but
+ * bypasses the lwIP socket layer. Received segments are decrypted in the
+ * tcpip thread and the resulting plaintext is buffered until it is read
+ * through mbedtls_altcp_transport_recv.
+ */
+
+#ifndef _MBEDTLS_ALTCP_TRANSPORT_H
+#define _MBEDTLS_ALTCP_TRANSPORT_H
+
+#include "mbedtls_transport.h"
+
+/**
+ * @brief Size of the buffer used to hold decrypted data until it is read.
+ */
+#ifndef TLS_ALTCP_PLAINTEXT_BUFFER_LEN
+#define TLS_ALTCP_PLAINTEXT_BUFFER_LEN    ( 2048U )
+#endif
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Allocate an altcp TLS Network Context
+ *
+ * @return pointer to a NetworkContext_t used by the altcp TLS transport.
+ */
+NetworkContext_t * mbedtls_altcp_transport_allocate( void );
+
+/**
+ * @brief Deallocate an altcp TLS NetworkContext_t.
+ */
+void mbedtls_altcp_transport_free( NetworkContext_t * pxNetworkContext );
+
+TlsTransportStatus_t mbedtls_altcp_transport_configure( NetworkContext_t * pxNetworkContext,
+                                                        const char ** ppcAlpnProtos,
+                                                        const PkiObject_t * pxPrivateKey,
+                                                        const PkiObject_t * pxClientCert,
+                                                        const PkiObject_t * pxRootCaCerts,
+                                                        const size_t uxNumRootCA );
+
+/**
+ * @brief Set a callback to be called from the tcpip thread when decrypted data is available.
+ */
+int32_t mbedtls_altcp_transport_setrecvcallback( NetworkContext_t * pxNetworkContext,
+                                                 GenericCallback_t pxCallback,
+                                                 void * pvCtx );
+
+/**
+ * @brief Create a TLS connection
+ *
+ * @param[out] pNetworkContext Pointer to a network context to contain the
+ * initialized pcb.
+ * @param[in] pHostName The hostname of the remote endpoint.
+ * @param[in] port The destination port.
+ * @param[in] receiveTimeoutMs Unused. Receive calls never block.
+ * @param[in] sendTimeoutMs Unused. Send calls never block.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS, #TLS_TRANSPORT_INSUFFICIENT_MEMORY, #TLS_TRANSPORT_DNS_FAILED,
+ * #TLS_TRANSPORT_HANDSHAKE_FAILED, #TLS_TRANSPORT_INTERNAL_ERROR, or #TLS_TRANSPORT_CONNECT_FAILURE.
+ */
+TlsTransportStatus_t mbedtls_altcp_transport_connect( NetworkContext_t * pxNetworkContext,
+                                                      const char * pcHostName,
+                                                      uint16_t usPort,
+                                                      uint32_t ulRecvTimeoutMs,
+                                                      uint32_t ulSendTimeoutMs );
+
+/**
+ * @brief Retrieve heap accounting information for an altcp TLS connection.
+ *
+ * The reported context size includes the plaintext buffer.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int32_t mbedtls_altcp_transport_get_mem_usage( NetworkContext_t * pxNetworkContext,
+                                               TlsTransportMemUsage_t * pxMemUsage );
+
+/**
+ * @brief Retrieve the protocol version and timing of the last successful handshake.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int32_t mbedtls_altcp_transport_get_handshake_info( NetworkContext_t * pxNetworkContext,
+                                                    TlsTransportHandshakeInfo_t * pxHandshakeInfo );
+
+/**
+ * @brief Retrieve the traffic statistics of an altcp TLS connection.
+ *
+ * ulRecvWakeups counts the receive ready callbacks raised from the tcpip thread.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int32_t mbedtls_altcp_transport_get_stats( NetworkContext_t * pxNetworkContext,
+                                           TlsTransportStats_t * pxStats );
+
+/**
+ * @brief Gracefully disconnect an established TLS connection.
+ *
+ * @param[in] pNetworkContext Network context.
+ */
+void mbedtls_altcp_transport_disconnect( NetworkContext_t * pxNetworkContext );
+
+/**
+ * @brief Receives decrypted data from an established TLS connection.
+ *
+ * This is the altcp TLS version of the transport interface's
+ * #TransportRecv_t function.
+ *
+ * @return Number of bytes (> 0) received if successful;
+ * 0 if no data is currently available;
+ * negative value on error.
+ */
+int32_t mbedtls_altcp_transport_recv( NetworkContext_t * pxNetworkContext,
+                                      void * pBuffer,
+                                      size_t uxBytesToRecv );
+
+/**
+ * @brief Sends data over an established TLS connection.
+ *
+ * This is the altcp TLS version of the transport interface's
+ * #TransportSend_t function.
+ *
+ * @return Number of bytes (> 0) sent on success;
+ * 0 if the tcp send buffer is full;
+ * else a negative value to represent error.
+ */
+int32_t mbedtls_altcp_transport_send( NetworkContext_t * pxNetworkContext,
+                                      const void * pBuffer,
+                                      size_t uxBytesToSend );
+
+#if TLS_TRANSPORT_WRITEV_ENABLED
+
+/**
+ * @brief Sends data from multiple buffers over an established TLS connection.
+ *
+ * This is the altcp TLS version of the transport interface's
+ * #TransportWritev_t function.
+ */
+int32_t mbedtls_altcp_transport_writev( NetworkContext_t * pxNetworkContext,
+                                        TransportOutVector_t * pxIoVec,
+                                        size_t uxIoVecCount );
+
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
+
+#endif /* _MBEDTLS_ALTCP_TRANSPORT_H */
@@ -28,6 +28,8 @@
 #ifndef _MBEDTLS_TRANSPORT_H
 #define _MBEDTLS_TRANSPORT_H
 
+#include "FreeRTOS.h"
+
 #include "mbedtls_error_utils.h"
 #include "transport_interface.h"
 
@@ -58,6 +60,16 @@
 #include "psa/protected_storage.h"
 #endif /* MBEDTLS_TRANSPORT_PSA */
 
+/*
+ * Set TLS_TRANSPORT_WRITEV_ENABLED to 1 when building against a coreMQTT or
+ * coreHTTP release whose transport_interface.h defines TransportOutVector_t and
+ * the writev member of TransportInterface_t. The coreMQTT v1.2.0 and coreHTTP
+ * v2.0.0 releases in manifest.yml have neither, and never call writev.
+ */
+#ifndef TLS_TRANSPORT_WRITEV_ENABLED
+#define TLS_TRANSPORT_WRITEV_ENABLED    0
+#endif
+
 /*
  * Error codes
  */
@@ -97,6 +109,54 @@ typedef enum TlsTransportStatus
 
 typedef void ( * GenericCallback_t )( void * );
 
+/**
+ * @brief Heap accounting information for a single TLS connection.
+ */
+typedef struct TlsTransportMemUsage
+{
+    size_t uxContextSize;        /**< Size of the statically sized connection context. */
+    size_t uxHandshakeInBufLen;  /**< TLS input buffer size during the last handshake. */
+    size_t uxHandshakeOutBufLen; /**< TLS output buffer size during the last handshake. */
+    size_t uxInBufLen;           /**< Current TLS input buffer size. */
+    size_t uxOutBufLen;          /**< Current TLS output buffer size. */
+    int32_t lSessionHeapDelta;   /**< Approximate heap retained by the session after the last handshake. */
+} TlsTransportMemUsage_t;
+
+/**
+ * @brief Values for TLS_TRANSPORT_TLS13_MODE.
+ */
+#define TLS_TRANSPORT_TLS13_DISABLED     0 /**< Negotiate TLS 1.2 only. */
+#define TLS_TRANSPORT_TLS13_PREFERRED    1 /**< Attempt TLS 1.3 only, retry with TLS 1.2 only on a new connection if the handshake fails. */
+#define TLS_TRANSPORT_TLS13_REQUIRED     2 /**< Negotiate TLS 1.3 only. */
+
+typedef struct TlsTransportHandshakeInfo
+{
+    int lTlsMinorVersion;       /**< Negotiated protocol minor version. 3 for TLS 1.2, 4 for TLS 1.3. */
+    uint32_t ulConnectTimeMs;   /**< Time taken to establish the tcp connection. */
+    uint32_t ulHandshakeTimeMs; /**< Time taken by the TLS handshake, including any fallback attempt. */
+    BaseType_t xFallback;       /**< pdTRUE if a TLS 1.3 handshake failed and TLS 1.2 was used instead. */
+} TlsTransportHandshakeInfo_t;
+
+/**
+ * @brief Traffic statistics for a TLS connection. Counters are reset when a connection is established.
+ */
+typedef struct TlsTransportStats
+{
+    BaseType_t xConnected;                  /**< pdTRUE if the connection is currently established. */
+    uint32_t ulBytesSent;                   /**< Bytes written to the socket, including handshake and record overhead. */
+    uint32_t ulBytesReceived;               /**< Bytes read from the socket, including handshake and record overhead. */
+    uint32_t ulAppBytesSent;                /**< Application data bytes sent. */
+    uint32_t ulAppBytesReceived;            /**< Application data bytes received. */
+    uint32_t ulRecordsSent;                 /**< Application data records sent. */
+    uint32_t ulRecordsReceived;             /**< Application data records received. */
+    uint32_t ulSendStalls;                  /**< Sends which could not make progress because the socket or TLS layer was busy. */
+    uint32_t ulRecvWakeups;                 /**< Receive ready notifications raised by the socket notify thread. */
+    uint32_t ulRecvWantRead;                /**< Receive calls which returned without data. */
+    uint32_t ulSocketErrors;                /**< Socket send or receive errors. */
+    TlsTransportHandshakeInfo_t xHandshake; /**< Version and timing of the last handshake. */
+    TlsTransportMemUsage_t xMemUsage;       /**< Heap accounting for the connection. */
+} TlsTransportStats_t;
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -161,6 +221,47 @@ int32_t mbedtls_transport_setsockopt( NetworkContext_t * pxNetworkContext,
                                       const void * pvSockoptValue,
                                       uint32_t ulOptionLen );
 
+/**
+ * @brief Retrieve heap accounting information for a TLS connection.
+ *
+ * When MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH is enabled, the TLS I/O buffers are
+ * shrunk to the negotiated maximum fragment length after the handshake and
+ * restored to full size when the session is reset.
+ *
+ * @param[in] pxNetworkContext Network context.
+ * @param[out] pxMemUsage Location to copy the accounting information to.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int32_t mbedtls_transport_get_mem_usage( NetworkContext_t * pxNetworkContext,
+                                         TlsTransportMemUsage_t * pxMemUsage );
+
+/**
+ * @brief Retrieve the protocol version and timing of the last successful handshake.
+ *
+ * @param[in] pxNetworkContext Network context.
+ * @param[out] pxHandshakeInfo Location to copy the handshake information to.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int32_t mbedtls_transport_get_handshake_info( NetworkContext_t * pxNetworkContext,
+                                              TlsTransportHandshakeInfo_t * pxHandshakeInfo );
+
+/**
+ * @brief Retrieve the traffic statistics of a TLS connection.
+ *
+ * The handshake information and heap accounting returned by
+ * mbedtls_transport_get_handshake_info and mbedtls_transport_get_mem_usage
+ * are included.
+ *
+ * @param[in] pxNetworkContext Network context.
+ * @param[out] pxStats Location to copy the statistics to.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int32_t mbedtls_transport_get_stats( NetworkContext_t * pxNetworkContext,
+                                     TlsTransportStats_t * pxStats );
+
 /**
  * @brief Gracefully disconnect an established TLS connection.
  *
@@ -196,6 +297,26 @@ int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
                                 const void * pBuffer,
                                 size_t uxBytesToSend );
 
+#if TLS_TRANSPORT_WRITEV_ENABLED
+
+/**
+ * @brief Sends data from multiple buffers over an established TLS connection.
+ *
+ * This is the TLS version of the transport interface's #TransportWritev_t
+ * function. Small consecutive vectors are coalesced so that they are sent in
+ * a single TLS record. Vectors of TLS_TRANSPORT_WRITEV_BUFFER_LEN bytes or
+ * more are encrypted directly from the caller's buffer.
+ *
+ * @return Number of bytes (> 0) sent on success;
+ * 0 if the socket times out without sending any bytes;
+ * else a negative value to represent error.
+ */
+int32_t mbedtls_transport_writev( NetworkContext_t * pxNetworkContext,
+                                  TransportOutVector_t * pxIoVec,
+                                  size_t uxIoVecCount );
+
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
+
 
 #ifdef MBEDTLS_TRANSPORT_PKCS11
 extern mbedtls_pk_info_t mbedtls_pkcs11_pk_ecdsa;
@@ -0,0 +1,78 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tls_bench.h
+ * @brief TLS transport benchmark client.
+ *
+ * Measures handshake latency, bulk throughput and small message round trip
+ * rates of mbedtls_transport against a benchmark server. The same client runs
+ * on the target (tlsbench cli command, tools/tls_bench.py server) and on the
+ * host (tools/tls_bench_host, in-process mbedtls server).
+ *
+ * The server accepts the following newline terminated requests, each of which
+ * carries two decimal arguments (unused arguments are sent as 0):
+ *     S <len> 0        Receive and discard len bytes, then reply "K\n".
+ *     E <len> 0        Send len bytes.
+ *     P <size> <count> Echo count messages of size bytes each.
+ */
+
+#ifndef _TLS_BENCH_H_
+#define _TLS_BENCH_H_
+
+#include "FreeRTOS.h"
+
+#include "mbedtls_transport.h"
+
+#define TLS_BENCH_DEFAULT_HANDSHAKES    5U
+#define TLS_BENCH_DEFAULT_BULK_LEN      ( 64U * 1024U )
+
+/**
+ * @brief Callback which receives each result as a newline terminated JSON object.
+ */
+typedef void ( * TlsBenchOutput_t )( const char * const pcLine );
+
+/**
+ * @brief Run the handshake, bulk transfer and ping-pong benchmarks.
+ *
+ * pxNetworkContext must be configured with credentials accepted by the server
+ * and must not be connected. It is left disconnected on return.
+ *
+ * Not re-entrant: results are formatted in a static buffer.
+ *
+ * @param[in] pxNetworkContext Configured transport context.
+ * @param[in] pcHost Host name of the benchmark server.
+ * @param[in] usPort Port of the benchmark server.
+ * @param[in] ulHandshakes Number of handshakes to time.
+ * @param[in] ulBulkLen Number of bytes transferred in each direction per record size.
+ * @param[in] xOutput Callback which receives the results.
+ *
+ * @return pdTRUE if all benchmarks completed.
+ */
+BaseType_t xTlsBenchRun( NetworkContext_t * pxNetworkContext,
+                         const char * pcHost,
+                         uint16_t usPort,
+                         uint32_t ulHandshakes,
+                         uint32_t ulBulkLen,
+                         TlsBenchOutput_t xOutput );
+
+#endif /* _TLS_BENCH_H_ */
@@ -0,0 +1,1253 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mbedtls_altcp_transport.c
+ * @brief TLS transport interface implementation using mbedtls on the lwIP altcp API.
+ *
+ * Received segments are passed to mbedtls directly from the pbuf chain queued
+ * by the altcp receive callback, and are decrypted in the tcpip thread into a
+ * plaintext buffer. Once connected, all access to the pcb and the mbedtls ssl
+ * context is made either from the tcpip thread or with the lwIP core lock held.
+ *
+ * The handshake runs in the calling task without the core lock, so that the
+ * key exchange and certificate verification do not stall lwIP. During the
+ * handshake, the bio callbacks take the core lock only while they queue or
+ * dequeue pbufs.
+ */
+#include "logging_levels.h"
+
+#define LOG_LEVEL    LOG_INFO
+
+#include "logging.h"
+
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include "mbedtls_altcp_transport.h"
+#include "mbedtls_transport_common.h"
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "event_groups.h"
+#include "rtos_time.h"
+
+/* lwIP includes */
+#include "lwip/opt.h"
+
+#if LWIP_ALTCP
+
+#include "lwip/altcp.h"
+#include "lwip/altcp_tcp.h"
+#include "lwip/api.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+
+/* mbedTLS includes. */
+#include "mbedtls/error.h"
+#include MBEDTLS_CONFIG_FILE
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+
+/* Time after which a connection attempt or handshake read or write is abandoned. */
+#ifndef TLS_TRANSPORT_CONNECT_TIMEOUT_MS
+#define TLS_TRANSPORT_CONNECT_TIMEOUT_MS    10000
+#endif
+
+#define ALTCP_EVT_CONNECTED                 ( 1U << 0 )
+#define ALTCP_EVT_RX                        ( 1U << 1 )
+#define ALTCP_EVT_ERROR                     ( 1U << 2 )
+#define ALTCP_EVT_TX                        ( 1U << 3 )
+
+/**
+ * @brief Secured connection context for the altcp transport.
+ */
+typedef struct AltcpTLSContext
+{
+    ConnectionState_t xConnectionState;
+    struct altcp_pcb * pxPcb;
+    EventGroupHandle_t xEventGroup;
+
+    /* Ciphertext which has been received but not yet consumed by mbedtls */
+    struct pbuf * pxRxChain;
+    BaseType_t xPeerClosed;
+    BaseType_t xConnError;
+
+    /* Decrypted data waiting to be read */
+    uint8_t * pucPlaintextBuf;
+    size_t uxPlaintextHead;
+    size_t uxPlaintextLen;
+
+    GenericCallback_t pxRecvReadyCallback;
+    void * pvRecvReadyCallbackCtx;
+
+    /* TLS configuration and credentials */
+    TlsTransportConfig_t xConfig;
+
+    /* TLS connection */
+    mbedtls_ssl_context xSslCtx;
+
+    /* pdTRUE while the handshake runs without the core lock held */
+    BaseType_t xBioTakesLock;
+
+    /* Heap accounting */
+    TlsTransportMemUsage_t xMemUsage;
+
+    /* Handshake timing and negotiated version */
+    TlsTransportHandshakeInfo_t xHandshakeInfo;
+
+    /* Traffic counters for the current connection */
+    TlsTransportStats_t xStats;
+} AltcpTLSContext_t;
+
+/*-----------------------------------------------------------*/
+
+/* Called from the tcpip thread or with the core lock held. */
+static void vDecryptPending( AltcpTLSContext_t * pxCtx )
+{
+    BaseType_t xNotify = pdFALSE;
+
+    while( ( pxCtx->xConnectionState == STATE_CONNECTED ) &&
+           ( pxCtx->uxPlaintextLen < TLS_ALTCP_PLAINTEXT_BUFFER_LEN ) )
+    {
+        size_t uxTail = ( pxCtx->uxPlaintextHead + pxCtx->uxPlaintextLen ) % TLS_ALTCP_PLAINTEXT_BUFFER_LEN;
+        size_t uxContiguous = 0;
+        int lRslt = 0;
+
+        if( uxTail >= pxCtx->uxPlaintextHead )
+        {
+            uxContiguous = TLS_ALTCP_PLAINTEXT_BUFFER_LEN - uxTail;
+        }
+        else
+        {
+            uxContiguous = pxCtx->uxPlaintextHead - uxTail;
+        }
+
+        lRslt = mbedtls_ssl_read( &( pxCtx->xSslCtx ),
+                                  &( pxCtx->pucPlaintextBuf[ uxTail ] ),
+                                  uxContiguous );
+
+        if( lRslt > 0 )
+        {
+            pxCtx->uxPlaintextLen += ( size_t ) lRslt;
+            pxCtx->xStats.ulAppBytesReceived += ( uint32_t ) lRslt;
+
+            /* A record has been fully consumed once no buffered plaintext remains. */
+            if( mbedtls_ssl_get_bytes_avail( &( pxCtx->xSslCtx ) ) == 0 )
+            {
+                pxCtx->xStats.ulRecordsReceived++;
+            }
+
+            xNotify = pdTRUE;
+        }
+        else if( ( lRslt == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( lRslt == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            break;
+        }
+        else
+        {
+            if( ( lRslt != 0 ) &&
+                ( lRslt != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ) )
+            {
+                LogError( "Failed to decrypt received data: Error: %s : %s.",
+                          mbedtlsHighLevelCodeOrDefault( lRslt ),
+                          mbedtlsLowLevelCodeOrDefault( lRslt ) );
+            }
+
+            pxCtx->xPeerClosed = pdTRUE;
+            xNotify = pdTRUE;
+            break;
+        }
+    }
+
+    if( ( xNotify == pdTRUE ) &&
+        ( pxCtx->pxRecvReadyCallback != NULL ) )
+    {
+        pxCtx->xStats.ulRecvWakeups++;
+        pxCtx->pxRecvReadyCallback( pxCtx->pvRecvReadyCallbackCtx );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static err_t xAltcpRecvCallback( void * pvArg,
+                                 struct altcp_pcb * pxPcb,
+                                 struct pbuf * pxPbuf,
+                                 err_t xErr )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pvArg;
+
+    ( void ) pxPcb;
+
+    if( pxPbuf == NULL )
+    {
+        /* Remote end closed the connection */
+        pxCtx->xPeerClosed = pdTRUE;
+    }
+    else if( xErr != ERR_OK )
+    {
+        pbuf_free( pxPbuf );
+    }
+    else if( pxCtx->pxRxChain == NULL )
+    {
+        pxCtx->pxRxChain = pxPbuf;
+    }
+    else
+    {
+        pbuf_cat( pxCtx->pxRxChain, pxPbuf );
+    }
+
+    ( void ) xEventGroupSetBits( pxCtx->xEventGroup, ALTCP_EVT_RX );
+
+    if( pxCtx->xConnectionState == STATE_CONNECTED )
+    {
+        vDecryptPending( pxCtx );
+
+        if( ( pxCtx->xPeerClosed == pdTRUE ) &&
+            ( pxCtx->pxRecvReadyCallback != NULL ) )
+        {
+            pxCtx->pxRecvReadyCallback( pxCtx->pvRecvReadyCallbackCtx );
+        }
+    }
+
+    return ERR_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+static void vAltcpErrCallback( void * pvArg,
+                               err_t xErr )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pvArg;
+
+    LogWarn( "Network connection %p: altcp error: %d.", pxCtx, xErr );
+
+    /* The pcb has already been freed by lwIP */
+    pxCtx->pxPcb = NULL;
+    pxCtx->xConnError = pdTRUE;
+
+    ( void ) xEventGroupSetBits( pxCtx->xEventGroup, ALTCP_EVT_ERROR );
+
+    if( ( pxCtx->xConnectionState == STATE_CONNECTED ) &&
+        ( pxCtx->pxRecvReadyCallback != NULL ) )
+    {
+        pxCtx->pxRecvReadyCallback( pxCtx->pvRecvReadyCallbackCtx );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static err_t xAltcpConnectedCallback( void * pvArg,
+                                      struct altcp_pcb * pxPcb,
+                                      err_t xErr )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pvArg;
+
+    ( void ) pxPcb;
+
+    ( void ) xEventGroupSetBits( pxCtx->xEventGroup,
+                                 ( xErr == ERR_OK ) ? ALTCP_EVT_CONNECTED : ALTCP_EVT_ERROR );
+
+    return ERR_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+static err_t xAltcpSentCallback( void * pvArg,
+                                 struct altcp_pcb * pxPcb,
+                                 u16_t usLen )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pvArg;
+
+    ( void ) pxPcb;
+    ( void ) usLen;
+
+    /* Space is available in the send buffer again */
+    ( void ) xEventGroupSetBits( pxCtx->xEventGroup, ALTCP_EVT_TX );
+
+    return ERR_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * mbedtls bio send callback. Called with the core lock held, except during the
+ * handshake, when the lock is only taken while the data is queued.
+ */
+static int lAltcpSslSend( void * pvCtx,
+                          const unsigned char * pcBuf,
+                          size_t uxLen )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pvCtx;
+    int lRslt = 0;
+
+    if( pxCtx->xBioTakesLock == pdTRUE )
+    {
+        LOCK_TCPIP_CORE();
+    }
+
+    if( pxCtx->pxPcb == NULL )
+    {
+        lRslt = MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    else
+    {
+        size_t uxSendLen = altcp_sndbuf( pxCtx->pxPcb );
+
+        if( uxSendLen > uxLen )
+        {
+            uxSendLen = uxLen;
+        }
+
+        if( uxSendLen == 0 )
+        {
+            lRslt = MBEDTLS_ERR_SSL_WANT_WRITE;
+        }
+        else
+        {
+            err_t xErr = altcp_write( pxCtx->pxPcb, pcBuf, ( u16_t ) uxSendLen, TCP_WRITE_FLAG_COPY );
+
+            if( xErr == ERR_OK )
+            {
+                lRslt = ( int ) uxSendLen;
+                pxCtx->xStats.ulBytesSent += ( uint32_t ) uxSendLen;
+            }
+            else if( xErr == ERR_MEM )
+            {
+                lRslt = MBEDTLS_ERR_SSL_WANT_WRITE;
+            }
+            else
+            {
+                pxCtx->xStats.ulSocketErrors++;
+                lRslt = MBEDTLS_ERR_NET_SEND_FAILED;
+            }
+        }
+
+        /* Outside of the handshake, the caller pushes the queued segments once all records are written. */
+        if( ( lRslt > 0 ) &&
+            ( pxCtx->xBioTakesLock == pdTRUE ) )
+        {
+            ( void ) altcp_output( pxCtx->pxPcb );
+        }
+    }
+
+    if( pxCtx->xBioTakesLock == pdTRUE )
+    {
+        UNLOCK_TCPIP_CORE();
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * mbedtls bio recv callback. Called with the core lock held, except during the
+ * handshake, when the lock is only taken while data is dequeued.
+ */
+static int lAltcpSslRecv( void * pvCtx,
+                          unsigned char * pcBuf,
+                          size_t uxLen )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pvCtx;
+    int lRslt = 0;
+
+    if( pxCtx->xBioTakesLock == pdTRUE )
+    {
+        LOCK_TCPIP_CORE();
+    }
+
+    if( pxCtx->pxRxChain != NULL )
+    {
+        u16_t usCopyLen = pxCtx->pxRxChain->tot_len;
+
+        if( usCopyLen > uxLen )
+        {
+            usCopyLen = ( u16_t ) uxLen;
+        }
+
+        usCopyLen = pbuf_copy_partial( pxCtx->pxRxChain, pcBuf, usCopyLen, 0 );
+
+        pxCtx->pxRxChain = pbuf_free_header( pxCtx->pxRxChain, usCopyLen );
+
+        /* Open the tcp window now that mbedtls has consumed the data */
+        if( pxCtx->pxPcb != NULL )
+        {
+            altcp_recved( pxCtx->pxPcb, usCopyLen );
+        }
+
+        pxCtx->xStats.ulBytesReceived += usCopyLen;
+
+        lRslt = ( int ) usCopyLen;
+    }
+    else if( ( pxCtx->xPeerClosed == pdTRUE ) ||
+             ( pxCtx->xConnError == pdTRUE ) )
+    {
+        lRslt = MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    else
+    {
+        lRslt = MBEDTLS_ERR_SSL_WANT_READ;
+    }
+
+    if( pxCtx->xBioTakesLock == pdTRUE )
+    {
+        UNLOCK_TCPIP_CORE();
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Detach from and close the pcb. Called with the core lock held. */
+static void vClosePcb( AltcpTLSContext_t * pxCtx )
+{
+    if( pxCtx->pxPcb != NULL )
+    {
+        altcp_arg( pxCtx->pxPcb, NULL );
+        altcp_recv( pxCtx->pxPcb, NULL );
+        altcp_sent( pxCtx->pxPcb, NULL );
+        altcp_err( pxCtx->pxPcb, NULL );
+
+        if( altcp_close( pxCtx->pxPcb ) != ERR_OK )
+        {
+            altcp_abort( pxCtx->pxPcb );
+        }
+
+        pxCtx->pxPcb = NULL;
+    }
+
+    if( pxCtx->pxRxChain != NULL )
+    {
+        pbuf_free( pxCtx->pxRxChain );
+        pxCtx->pxRxChain = NULL;
+    }
+
+    pxCtx->uxPlaintextHead = 0;
+    pxCtx->uxPlaintextLen = 0;
+    pxCtx->xPeerClosed = pdFALSE;
+    pxCtx->xConnError = pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+NetworkContext_t * mbedtls_altcp_transport_allocate( void )
+{
+    AltcpTLSContext_t * pxCtx = NULL;
+
+    pxCtx = ( AltcpTLSContext_t * ) pvPortMalloc( sizeof( AltcpTLSContext_t ) );
+
+    if( pxCtx == NULL )
+    {
+        LogError( "Failed to allocate memory for AltcpTLSContext_t." );
+    }
+    else
+    {
+        ( void ) memset( pxCtx, 0, sizeof( AltcpTLSContext_t ) );
+
+        pxCtx->pucPlaintextBuf = ( uint8_t * ) pvPortMalloc( TLS_ALTCP_PLAINTEXT_BUFFER_LEN );
+        pxCtx->xEventGroup = xEventGroupCreate();
+
+        if( ( pxCtx->pucPlaintextBuf == NULL ) ||
+            ( pxCtx->xEventGroup == NULL ) )
+        {
+            LogError( "Failed to allocate altcp transport buffers." );
+
+            if( pxCtx->pucPlaintextBuf != NULL )
+            {
+                vPortFree( pxCtx->pucPlaintextBuf );
+            }
+
+            if( pxCtx->xEventGroup != NULL )
+            {
+                vEventGroupDelete( pxCtx->xEventGroup );
+            }
+
+            vPortFree( pxCtx );
+            pxCtx = NULL;
+        }
+    }
+
+    if( pxCtx != NULL )
+    {
+        pxCtx->xConnectionState = STATE_ALLOCATED;
+
+        vTlsConfigInit( &( pxCtx->xConfig ) );
+        mbedtls_ssl_init( &( pxCtx->xSslCtx ) );
+
+#ifdef MBEDTLS_THREADING_ALT
+        mbedtls_platform_threading_init();
+#endif /* MBEDTLS_THREADING_ALT */
+    }
+
+    return ( NetworkContext_t * ) pxCtx;
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_altcp_transport_free( NetworkContext_t * pxNetworkContext )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+
+    if( pxCtx != NULL )
+    {
+        LOCK_TCPIP_CORE();
+        vClosePcb( pxCtx );
+        UNLOCK_TCPIP_CORE();
+
+        mbedtls_ssl_free( &( pxCtx->xSslCtx ) );
+        vTlsConfigFree( &( pxCtx->xConfig ) );
+
+        vEventGroupDelete( pxCtx->xEventGroup );
+        vPortFree( pxCtx->pucPlaintextBuf );
+        vPortFree( pxCtx );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+TlsTransportStatus_t mbedtls_altcp_transport_configure( NetworkContext_t * pxNetworkContext,
+                                                        const char ** ppcAlpnProtos,
+                                                        const PkiObject_t * pxPrivateKey,
+                                                        const PkiObject_t * pxClientCert,
+                                                        const PkiObject_t * pxRootCaCerts,
+                                                        const size_t uxNumRootCA )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    BaseType_t xReconfigure = pdFALSE;
+    int lError = 0;
+
+    if( pxCtx == NULL )
+    {
+        LogError( "Provided pxNetworkContext cannot be NULL." );
+        xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( ( pxPrivateKey && !pxClientCert ) ||
+             ( !pxPrivateKey && pxClientCert ) )
+    {
+        LogError( "pxPrivateKey and pxClientCert arguments are required for client certificate authentication." );
+        xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( ( pxRootCaCerts == NULL ) ||
+             ( uxNumRootCA == 0 ) )
+    {
+        LogError( "At least one root CA certificate must be provided." );
+        xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        if( pxCtx->xConnectionState == STATE_CONNECTED )
+        {
+            mbedtls_altcp_transport_disconnect( pxNetworkContext );
+        }
+
+        /* The ssl context refers to the configuration, so it is cleared first when reconfiguring */
+        if( pxCtx->xConnectionState == STATE_CONFIGURED )
+        {
+            mbedtls_ssl_free( &( pxCtx->xSslCtx ) );
+            mbedtls_ssl_init( &( pxCtx->xSslCtx ) );
+            pxCtx->xConnectionState = STATE_ALLOCATED;
+            xReconfigure = pdTRUE;
+        }
+
+        xStatus = xTlsConfigSetup( &( pxCtx->xConfig ),
+                                   xReconfigure,
+                                   ppcAlpnProtos,
+                                   pxPrivateKey,
+                                   pxClientCert,
+                                   pxRootCaCerts,
+                                   uxNumRootCA );
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        lError = mbedtls_ssl_setup( &( pxCtx->xSslCtx ), &( pxCtx->xConfig.xSslConfig ) );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Call to mbedtls_ssl_setup failed, " );
+
+        if( lError != 0 )
+        {
+            xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+        }
+        else
+        {
+            mbedtls_ssl_set_bio( &( pxCtx->xSslCtx ), pxCtx,
+                                 lAltcpSslSend, lAltcpSslRecv, NULL );
+
+            pxCtx->xConnectionState = STATE_CONFIGURED;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_altcp_transport_setrecvcallback( NetworkContext_t * pxNetworkContext,
+                                                 GenericCallback_t pxCallback,
+                                                 void * pvCtx )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
+
+    if( ( pxCtx == NULL ) ||
+        ( pxCallback == NULL ) )
+    {
+        lError = -1;
+    }
+    else
+    {
+        LOCK_TCPIP_CORE();
+        pxCtx->pxRecvReadyCallback = pxCallback;
+        pxCtx->pvRecvReadyCallbackCtx = pvCtx;
+        UNLOCK_TCPIP_CORE();
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Open a pcb and wait for the tcp connection to be established. */
+static TlsTransportStatus_t xOpenPcb( AltcpTLSContext_t * pxCtx,
+                                      const ip_addr_t * pxAddr,
+                                      uint16_t usPort )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    EventBits_t xEvents = 0;
+    err_t xErr = ERR_OK;
+
+    ( void ) xEventGroupClearBits( pxCtx->xEventGroup,
+                                   ALTCP_EVT_CONNECTED | ALTCP_EVT_RX | ALTCP_EVT_ERROR | ALTCP_EVT_TX );
+
+    LOCK_TCPIP_CORE();
+
+    pxCtx->pxPcb = altcp_tcp_new_ip_type( IP_GET_TYPE( pxAddr ) );
+
+    if( pxCtx->pxPcb == NULL )
+    {
+        xStatus = TLS_TRANSPORT_INSUFFICIENT_SOCKETS;
+    }
+    else
+    {
+        altcp_arg( pxCtx->pxPcb, pxCtx );
+        altcp_recv( pxCtx->pxPcb, xAltcpRecvCallback );
+        altcp_sent( pxCtx->pxPcb, xAltcpSentCallback );
+        altcp_err( pxCtx->pxPcb, vAltcpErrCallback );
+
+        xErr = altcp_connect( pxCtx->pxPcb, pxAddr, usPort, xAltcpConnectedCallback );
+
+        if( xErr != ERR_OK )
+        {
+            LogError( "altcp_connect failed: %d.", xErr );
+            xStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+        }
+    }
+
+    UNLOCK_TCPIP_CORE();
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        xEvents = xEventGroupWaitBits( pxCtx->xEventGroup,
+                                       ALTCP_EVT_CONNECTED | ALTCP_EVT_ERROR,
+                                       pdTRUE,
+                                       pdFALSE,
+                                       pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_TIMEOUT_MS ) );
+
+        if( ( xEvents & ALTCP_EVT_CONNECTED ) == 0 )
+        {
+            xStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Perform the TLS handshake in the calling task. The tcpip thread does not
+ * touch the ssl context until the connection state is STATE_CONNECTED, so
+ * only the bio callbacks need the core lock.
+ */
+static int lPerformHandshake( AltcpTLSContext_t * pxCtx )
+{
+    mbedtls_ssl_context * pxSslCtx = &( pxCtx->xSslCtx );
+    size_t uxFreeHeapBefore = uxTlsMemUsageHandshakeStart( pxSslCtx, &( pxCtx->xMemUsage ) );
+    EventBits_t xWaitBits = 0;
+    EventBits_t xEvents = 0;
+    int lError = 0;
+
+    pxCtx->xBioTakesLock = pdTRUE;
+
+    do
+    {
+        lError = mbedtls_ssl_handshake( pxSslCtx );
+
+        if( ( lError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+            ( lError == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            /* Wait for the tcpip thread to queue more data or for send buffer space to be freed */
+            xWaitBits = ( lError == MBEDTLS_ERR_SSL_WANT_READ ) ? ALTCP_EVT_RX : ALTCP_EVT_TX;
+
+            xEvents = xEventGroupWaitBits( pxCtx->xEventGroup,
+                                           xWaitBits | ALTCP_EVT_ERROR,
+                                           pdTRUE,
+                                           pdFALSE,
+                                           pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_TIMEOUT_MS ) );
+
+            if( ( xEvents & ( xWaitBits | ALTCP_EVT_ERROR ) ) == 0 )
+            {
+                lError = MBEDTLS_ERR_SSL_TIMEOUT;
+            }
+        }
+    }
+    while( ( lError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+           ( lError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+    pxCtx->xBioTakesLock = pdFALSE;
+
+    if( lError != 0 )
+    {
+        LogError( "Failed to perform TLS handshake: Error: %s : %s.",
+                  mbedtlsHighLevelCodeOrDefault( lError ),
+                  mbedtlsLowLevelCodeOrDefault( lError ) );
+    }
+    else
+    {
+        LogInfo( "Network connection %p: TLS handshake successful.",
+                 pxCtx );
+
+        vTlsMemUsageHandshakeDone( pxSslCtx, &( pxCtx->xMemUsage ), uxFreeHeapBefore, pxCtx );
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+TlsTransportStatus_t mbedtls_altcp_transport_connect( NetworkContext_t * pxNetworkContext,
+                                                      const char * pcHostName,
+                                                      uint16_t usPort,
+                                                      uint32_t ulRecvTimeoutMs,
+                                                      uint32_t ulSendTimeoutMs )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    ip_addr_t xAddr = { 0 };
+    int lError = 0;
+
+    ( void ) ulRecvTimeoutMs;
+    ( void ) ulSendTimeoutMs;
+
+    if( ( pxCtx == NULL ) ||
+        ( pcHostName == NULL ) ||
+        ( usPort == 0 ) )
+    {
+        LogError( "Invalid input parameter." );
+        xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else if( pxCtx->xConnectionState != STATE_CONFIGURED )
+    {
+        LogError( "Transport must be configured and disconnected before connecting." );
+        xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+    }
+    else
+    {
+        lError = mbedtls_ssl_set_hostname( &( pxCtx->xSslCtx ), pcHostName );
+
+        if( lError != 0 )
+        {
+            LogError( "Failed to set server hostname: Error: %s : %s.",
+                      mbedtlsHighLevelCodeOrDefault( lError ),
+                      mbedtlsLowLevelCodeOrDefault( lError ) );
+            xStatus = TLS_TRANSPORT_INVALID_HOSTNAME;
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        if( netconn_gethostbyname( pcHostName, &xAddr ) != ERR_OK )
+        {
+            LogError( "Failed to resolve hostname: %s to IP address.", pcHostName );
+            xStatus = TLS_TRANSPORT_DNS_FAILED;
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        TlsTransportHandshakeInfo_t * pxInfo = &( pxCtx->xHandshakeInfo );
+        uint32_t ulStartTimeMs = ulGetTimeMs();
+
+        pxInfo->xFallback = pdFALSE;
+
+        /* Statistics are kept per connection */
+        ( void ) memset( &( pxCtx->xStats ), 0, sizeof( TlsTransportStats_t ) );
+
+        xStatus = xOpenPcb( pxCtx, &xAddr, usPort );
+
+        pxInfo->ulConnectTimeMs = ulGetTimeMs() - ulStartTimeMs;
+
+        if( xStatus != TLS_TRANSPORT_SUCCESS )
+        {
+            LogError( "Failed to connect to host: %s, port: %u.", pcHostName, usPort );
+        }
+        else
+        {
+            ulStartTimeMs = ulGetTimeMs();
+
+            lError = lPerformHandshake( pxCtx );
+
+#if TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_PREFERRED
+
+            /*
+             * Retry with TLS 1.2 on a fresh connection if the TLS 1.3 handshake
+             * failed for any reason other than server certificate validation.
+             */
+            if( ( lError != 0 ) &&
+                ( lError != MBEDTLS_ERR_X509_CERT_VERIFY_FAILED ) &&
+                ( pxCtx->xConfig.xTls13Disabled == pdFALSE ) )
+            {
+                LogWarn( "Network connection %p: TLS 1.3 handshake failed. Retrying with TLS 1.2.",
+                         pxCtx );
+
+                LOCK_TCPIP_CORE();
+                vClosePcb( pxCtx );
+                UNLOCK_TCPIP_CORE();
+
+                pxInfo->xFallback = pdTRUE;
+
+                lError = lTlsConfigFallbackToTls12( &( pxCtx->xConfig ), &( pxCtx->xSslCtx ), pcHostName );
+
+                if( lError != 0 )
+                {
+                    xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+                }
+                else
+                {
+                    xStatus = xOpenPcb( pxCtx, &xAddr, usPort );
+                }
+
+                if( xStatus == TLS_TRANSPORT_SUCCESS )
+                {
+                    lError = lPerformHandshake( pxCtx );
+                }
+            }
+#endif /* TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_PREFERRED */
+
+            pxInfo->ulHandshakeTimeMs = ulGetTimeMs() - ulStartTimeMs;
+
+            if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
+                ( lError != 0 ) )
+            {
+                xStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
+            }
+        }
+
+        if( xStatus == TLS_TRANSPORT_SUCCESS )
+        {
+            vTlsLogHandshakeInfo( &( pxCtx->xSslCtx ), pxInfo, pxCtx );
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        LogInfo( "Network connection %p: Connection to %s:%u established.",
+                 pxNetworkContext, pcHostName, usPort );
+
+        LOCK_TCPIP_CORE();
+        pxCtx->xConnectionState = STATE_CONNECTED;
+
+        /* Decrypt any application data which arrived with the end of the handshake */
+        vDecryptPending( pxCtx );
+        UNLOCK_TCPIP_CORE();
+    }
+    else if( pxCtx != NULL )
+    {
+        LOCK_TCPIP_CORE();
+        vClosePcb( pxCtx );
+        UNLOCK_TCPIP_CORE();
+
+        if( pxCtx->xConnectionState == STATE_CONFIGURED )
+        {
+            ( void ) mbedtls_ssl_session_reset( &( pxCtx->xSslCtx ) );
+        }
+
+        LogInfo( "Network connection %p: to %s:%u failed.",
+                 pxNetworkContext, pcHostName, usPort );
+    }
+    else
+    {
+        /* Empty */
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_altcp_transport_get_mem_usage( NetworkContext_t * pxNetworkContext,
+                                               TlsTransportMemUsage_t * pxMemUsage )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
+
+    if( ( pxCtx == NULL ) ||
+        ( pxMemUsage == NULL ) )
+    {
+        lError = -1;
+    }
+    else
+    {
+        LOCK_TCPIP_CORE();
+
+        *pxMemUsage = pxCtx->xMemUsage;
+
+        /* Report the current buffer sizes, which change after a session reset. */
+        vTlsGetSslBufferLengths( &( pxCtx->xSslCtx ),
+                                 &( pxMemUsage->uxInBufLen ),
+                                 &( pxMemUsage->uxOutBufLen ) );
+
+        UNLOCK_TCPIP_CORE();
+
+        pxMemUsage->uxContextSize = sizeof( AltcpTLSContext_t ) + TLS_ALTCP_PLAINTEXT_BUFFER_LEN;
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_altcp_transport_get_handshake_info( NetworkContext_t * pxNetworkContext,
+                                                    TlsTransportHandshakeInfo_t * pxHandshakeInfo )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
+
+    if( ( pxCtx == NULL ) ||
+        ( pxHandshakeInfo == NULL ) )
+    {
+        lError = -1;
+    }
+    else
+    {
+        *pxHandshakeInfo = pxCtx->xHandshakeInfo;
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_altcp_transport_get_stats( NetworkContext_t * pxNetworkContext,
+                                           TlsTransportStats_t * pxStats )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
+
+    if( ( pxCtx == NULL ) ||
+        ( pxStats == NULL ) )
+    {
+        lError = -1;
+    }
+    else
+    {
+        /* The counters are updated from the tcpip thread */
+        LOCK_TCPIP_CORE();
+        *pxStats = pxCtx->xStats;
+        pxStats->xConnected = ( pxCtx->xConnectionState == STATE_CONNECTED ) ? pdTRUE : pdFALSE;
+        UNLOCK_TCPIP_CORE();
+
+        ( void ) mbedtls_altcp_transport_get_handshake_info( pxNetworkContext, &( pxStats->xHandshake ) );
+        ( void ) mbedtls_altcp_transport_get_mem_usage( pxNetworkContext, &( pxStats->xMemUsage ) );
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_altcp_transport_disconnect( NetworkContext_t * pxNetworkContext )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+
+    configASSERT( pxCtx != NULL );
+
+    if( pxCtx != NULL )
+    {
+        LOCK_TCPIP_CORE();
+
+        if( ( pxCtx->xConnectionState == STATE_CONNECTED ) &&
+            ( pxCtx->pxPcb != NULL ) )
+        {
+            int lError = mbedtls_ssl_close_notify( &( pxCtx->xSslCtx ) );
+
+            if( lError == 0 )
+            {
+                ( void ) altcp_output( pxCtx->pxPcb );
+                LogInfo( "Network connection %p: TLS close-notify sent.", pxNetworkContext );
+            }
+        }
+
+        vClosePcb( pxCtx );
+
+        if( pxCtx->xConnectionState == STATE_CONNECTED )
+        {
+            pxCtx->xConnectionState = STATE_CONFIGURED;
+        }
+
+        if( pxCtx->xConnectionState == STATE_CONFIGURED )
+        {
+            ( void ) mbedtls_ssl_session_reset( &( pxCtx->xSslCtx ) );
+        }
+
+        UNLOCK_TCPIP_CORE();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_altcp_transport_recv( NetworkContext_t * pxNetworkContext,
+                                      void * pBuffer,
+                                      size_t uxBytesToRecv )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    uint8_t * pucBuffer = ( uint8_t * ) pBuffer;
+    int32_t lBytesRead = 0;
+
+    configASSERT( pxCtx != NULL );
+    configASSERT( pBuffer != NULL );
+    configASSERT( uxBytesToRecv > 0 );
+
+    LOCK_TCPIP_CORE();
+
+    if( pxCtx->xConnectionState == STATE_CONNECTED )
+    {
+        while( ( ( size_t ) lBytesRead < uxBytesToRecv ) &&
+               ( pxCtx->uxPlaintextLen > 0 ) )
+        {
+            size_t uxCopyLen = TLS_ALTCP_PLAINTEXT_BUFFER_LEN - pxCtx->uxPlaintextHead;
+
+            if( uxCopyLen > pxCtx->uxPlaintextLen )
+            {
+                uxCopyLen = pxCtx->uxPlaintextLen;
+            }
+
+            if( uxCopyLen > ( uxBytesToRecv - ( size_t ) lBytesRead ) )
+            {
+                uxCopyLen = uxBytesToRecv - ( size_t ) lBytesRead;
+            }
+
+            ( void ) memcpy( &( pucBuffer[ lBytesRead ] ),
+                             &( pxCtx->pucPlaintextBuf[ pxCtx->uxPlaintextHead ] ),
+                             uxCopyLen );
+
+            pxCtx->uxPlaintextHead = ( pxCtx->uxPlaintextHead + uxCopyLen ) % TLS_ALTCP_PLAINTEXT_BUFFER_LEN;
+            pxCtx->uxPlaintextLen -= uxCopyLen;
+            lBytesRead += ( int32_t ) uxCopyLen;
+        }
+
+        /* Space was freed in the plaintext buffer, so decrypt any queued records */
+        if( lBytesRead > 0 )
+        {
+            vDecryptPending( pxCtx );
+        }
+
+        if( ( lBytesRead == 0 ) &&
+            ( ( pxCtx->xPeerClosed == pdTRUE ) ||
+              ( pxCtx->xConnError == pdTRUE ) ) )
+        {
+            lBytesRead = -1;
+            pxCtx->xConnectionState = STATE_CONFIGURED;
+        }
+        else if( lBytesRead == 0 )
+        {
+            pxCtx->xStats.ulRecvWantRead++;
+        }
+        else
+        {
+            /* Empty else marker. */
+        }
+    }
+
+    UNLOCK_TCPIP_CORE();
+
+    return lBytesRead;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Count the application data records produced by a successful mbedtls_ssl_write call. */
+static void vCountRecordsSent( AltcpTLSContext_t * pxCtx,
+                               int32_t lBytesWritten )
+{
+    int lMaxPayload = mbedtls_ssl_get_max_out_record_payload( &( pxCtx->xSslCtx ) );
+
+    if( ( lBytesWritten > 0 ) &&
+        ( lMaxPayload > 0 ) )
+    {
+        pxCtx->xStats.ulRecordsSent += ( uint32_t ) ( ( lBytesWritten + lMaxPayload - 1 ) / lMaxPayload );
+        pxCtx->xStats.ulAppBytesSent += ( uint32_t ) lBytesWritten;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_altcp_transport_send( NetworkContext_t * pxNetworkContext,
+                                      const void * pBuffer,
+                                      size_t uxBytesToSend )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    int32_t tlsStatus = 0;
+
+    configASSERT( pxCtx != NULL );
+    configASSERT( pBuffer != NULL );
+    configASSERT( uxBytesToSend > 0 );
+
+    LOCK_TCPIP_CORE();
+
+    if( pxCtx->xConnectionState == STATE_CONNECTED )
+    {
+        tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxCtx->xSslCtx ),
+                                                   pBuffer,
+                                                   uxBytesToSend );
+
+        vCountRecordsSent( pxCtx, tlsStatus );
+
+        if( pxCtx->pxPcb != NULL )
+        {
+            ( void ) altcp_output( pxCtx->pxPcb );
+        }
+    }
+
+    if( ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+        ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+    {
+        /* The libraries may retry send on these errors. */
+        pxCtx->xStats.ulSendStalls++;
+        tlsStatus = 0;
+    }
+    else if( ( tlsStatus == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ) ||
+             ( tlsStatus == MBEDTLS_ERR_NET_CONN_RESET ) )
+    {
+        tlsStatus = -1;
+        pxCtx->xConnectionState = STATE_CONFIGURED;
+    }
+    else if( tlsStatus < 0 )
+    {
+        LogError( "Failed to send data:  Error: %s : %s.",
+                  mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                  mbedtlsLowLevelCodeOrDefault( tlsStatus ) );
+    }
+    else
+    {
+        /* Empty else marker. */
+    }
+
+    UNLOCK_TCPIP_CORE();
+
+    return tlsStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+#if TLS_TRANSPORT_WRITEV_ENABLED
+
+int32_t mbedtls_altcp_transport_writev( NetworkContext_t * pxNetworkContext,
+                                        TransportOutVector_t * pxIoVec,
+                                        size_t uxIoVecCount )
+{
+    AltcpTLSContext_t * pxCtx = ( AltcpTLSContext_t * ) pxNetworkContext;
+    int32_t lBytesSent = 0;
+    int32_t tlsStatus = 0;
+
+    configASSERT( pxCtx != NULL );
+    configASSERT( pxIoVec != NULL );
+    configASSERT( uxIoVecCount > 0 );
+
+    LOCK_TCPIP_CORE();
+
+    /*
+     * Each vector is written as its own record, but the resulting segments are
+     * queued together and only pushed to the network once all vectors are written.
+     */
+    for( size_t uxIdx = 0; ( uxIdx < uxIoVecCount ) && ( pxCtx->xConnectionState == STATE_CONNECTED ); uxIdx++ )
+    {
+        if( pxIoVec[ uxIdx ].iov_len > 0 )
+        {
+            tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxCtx->xSslCtx ),
+                                                       pxIoVec[ uxIdx ].iov_base,
+                                                       pxIoVec[ uxIdx ].iov_len );
+
+            vCountRecordsSent( pxCtx, tlsStatus );
+
+            if( tlsStatus > 0 )
+            {
+                lBytesSent += tlsStatus;
+            }
+
+            if( ( size_t ) tlsStatus != pxIoVec[ uxIdx ].iov_len )
+            {
+                break;
+            }
+        }
+    }
+
+    if( pxCtx->pxPcb != NULL )
+    {
+        ( void ) altcp_output( pxCtx->pxPcb );
+    }
+
+    if( ( tlsStatus == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ) ||
+        ( tlsStatus == MBEDTLS_ERR_NET_CONN_RESET ) )
+    {
+        lBytesSent = -1;
+        pxCtx->xConnectionState = STATE_CONFIGURED;
+    }
+    else if( ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
+             ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+    {
+        pxCtx->xStats.ulSendStalls++;
+    }
+    else if( tlsStatus < 0 )
+    {
+        LogError( "Failed to send data:  Error: %s : %s.",
+                  mbedtlsHighLevelCodeOrDefault( tlsStatus ),
+                  mbedtlsLowLevelCodeOrDefault( tlsStatus ) );
+        lBytesSent = tlsStatus;
+    }
+    else
+    {
+        /* Empty else marker. */
+    }
+
+    UNLOCK_TCPIP_CORE();
+
+    return lBytesSent;
+}
+
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
+
+#endif /* LWIP_ALTCP */
@@ -33,10 +33,12 @@
 #define MBEDTLS_ALLOW_PRIVATE_ACCESS
 
 #include "mbedtls_transport.h"
+#include "mbedtls_transport_common.h"
 #include <string.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
+#include "rtos_time.h"
 
 
 /* mbedTLS includes. */
@@ -54,7 +56,31 @@
 
 #include "errno.h"
 
-#define MBEDTLS_DEBUG_THRESHOLD    1
+/*
+ * Delay before a connection attempt to the next resolved address is started
+ * in parallel with any outstanding attempts.
+ */
+#ifndef TLS_TRANSPORT_CONNECT_STAGGER_MS
+#define TLS_TRANSPORT_CONNECT_STAGGER_MS    250
+#endif
+
+/* Time after which an individual connection attempt is abandoned. */
+#ifndef TLS_TRANSPORT_CONNECT_TIMEOUT_MS
+#define TLS_TRANSPORT_CONNECT_TIMEOUT_MS    10000
+#endif
+
+/* Maximum number of outstanding connection attempts (each one uses a socket). */
+#ifndef TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS
+#define TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS    2
+#endif
+
+/*
+ * Size of the per-connection buffer used by mbedtls_transport_writev to
+ * coalesce small io vectors, such as protocol headers, into a single record.
+ */
+#ifndef TLS_TRANSPORT_WRITEV_BUFFER_LEN
+#define TLS_TRANSPORT_WRITEV_BUFFER_LEN    512
+#endif
 
 #ifdef MBEDTLS_TRANSPORT_PKCS11
 #include "core_pkcs11_config.h"
@@ -69,6 +95,7 @@ typedef struct
     StackType_t puxStackBuffer[ 128 ];
     StaticTask_t xTaskBuffer;
     SockHandle_t xSockHandle;
+    uint32_t ulWakeups;
 } NotifyThreadCtx_t;
 
 /**
@@ -81,39 +108,33 @@ typedef struct TLSContext
 
     NotifyThreadCtx_t * pxNotifyThreadCtx;
 
+    /* TLS configuration and credentials */
+    TlsTransportConfig_t xConfig;
+
     /* TLS connection */
-    mbedtls_ssl_config xSslConfig;
     mbedtls_ssl_context xSslCtx;
 
-    /* Certificates */
-    mbedtls_x509_crt xRootCaChain;
-    mbedtls_x509_crt xClientCert;
-
-    /* Private Key */
-    mbedtls_pk_context xPkCtx;
-
 #ifdef MBEDTLS_TRANSPORT_PKCS11
     CK_SESSION_HANDLE xP11SessionHandle;
 #endif /* MBEDTLS_TRANSPORT_PKCS11 */
 
-    /* Entropy Ctx */
-    mbedtls_entropy_context xEntropyCtx;
+    /* Heap accounting */
+    TlsTransportMemUsage_t xMemUsage;
 
-#ifdef TRANSPORT_USE_CTR_DRBG
-    mbedtls_ctr_drbg_context xCtrDrbgCtx;
-#endif /* TRANSPORT_USE_CTR_DRBG */
-} TLSContext_t;
+    /* Handshake timing and negotiated version */
+    TlsTransportHandshakeInfo_t xHandshakeInfo;
 
+    /* Traffic counters for the current connection */
+    TlsTransportStats_t xStats;
 
-/*-----------------------------------------------------------*/
+#if TLS_TRANSPORT_WRITEV_ENABLED
+    /* Staging buffer for mbedtls_transport_writev */
+    uint8_t pucWritevBuf[ TLS_TRANSPORT_WRITEV_BUFFER_LEN ];
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
+} TLSContext_t;
 
-static TlsTransportStatus_t xConfigureCertificateAuth( TLSContext_t * pxTLSCtx,
-                                                       const PkiObject_t * pxPrivateKey,
-                                                       const PkiObject_t * pxClientCert );
 
-static TlsTransportStatus_t xConfigureCAChain( TLSContext_t * pxTLSCtx,
-                                               const PkiObject_t * pxRootCaCerts,
-                                               const size_t uxNumRootCA );
+/*-----------------------------------------------------------*/
 
 static inline void vStopSocketNotifyTask( NotifyThreadCtx_t * pxNotifyThreadCtx );
 
@@ -124,15 +145,6 @@ static void vFreeNotifyThreadCtx( NotifyThreadCtx_t * pxNotifyThreadCtx );
 
 static void vFreeNotifyThreadCtx( NotifyThreadCtx_t * pxNotifyThreadCtx );
 
-#ifdef MBEDTLS_DEBUG_C
-/* Used to print mbedTLS log output. */
-static void vTLSDebugPrint( void * ctx,
-                            int level,
-                            const char * file,
-                            int line,
-                            const char * str );
-#endif
-
 /*-----------------------------------------------------------*/
 
 static void vSocketNotifyThread( void * pvParameters )
@@ -173,6 +185,7 @@ static void vSocketNotifyThread( void * pvParameters )
             if( FD_ISSET( xSockHandle, &xReadSet ) &&
                 pxCtx->pxRecvReadyCallback )
             {
+                pxCtx->ulWakeups++;
                 pxCtx->pxRecvReadyCallback( pxCtx->pvRecvReadyCallbackCtx );
             }
         }
@@ -193,160 +206,14 @@ static void vSocketNotifyThread( void * pvParameters )
 
 /*-----------------------------------------------------------*/
 
-static int32_t lMbedtlsErrToTransportError( int32_t lError )
-{
-    switch( lError )
-    {
-        case 0:
-            lError = TLS_TRANSPORT_SUCCESS;
-            break;
-
-        case MBEDTLS_ERR_X509_ALLOC_FAILED:
-            lError = TLS_TRANSPORT_INSUFFICIENT_MEMORY;
-            break;
-
-        case MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED:
-            lError = TLS_TRANSPORT_INTERNAL_ERROR;
-            break;
-
-        case MBEDTLS_ERR_SSL_BAD_INPUT_DATA:
-            lError = TLS_TRANSPORT_INVALID_PARAMETER;
-            break;
-
-        case MBEDTLS_ERR_X509_CERT_UNKNOWN_FORMAT:
-        case MBEDTLS_ERR_X509_BAD_INPUT_DATA:
-        case MBEDTLS_ERR_PEM_BAD_INPUT_DATA:
-        case MBEDTLS_ERR_PEM_NO_HEADER_FOOTER_PRESENT:
-            lError = TLS_TRANSPORT_PKI_OBJECT_PARSE_FAIL;
-            break;
-
-        default:
-            lError = lError < 0 ? TLS_TRANSPORT_UNKNOWN_ERROR : TLS_TRANSPORT_SUCCESS;
-            break;
-    }
-
-    return lError;
-}
-
-/*-----------------------------------------------------------*/
-#ifndef MBEDTLS_X509_REMOVE_INFO
-#ifdef X509_CRT_ERROR_INFO
-#undef X509_CRT_ERROR_INFO
-#endif /* X509_CRT_ERROR_INFO */
-#define X509_CRT_ERROR_INFO( err, err_str, info ) \
-    case err:                                     \
-        pcVerifyInfo = info; break;
-static const char * pcGetVerifyInfoString( unsigned int flag )
-{
-    const char * pcVerifyInfo = "Unknown Failure reason.";
-
-    switch( flag )
-    {
-        MBEDTLS_X509_CRT_ERROR_INFO_LIST
-        default:
-            break;
-    }
-
-    return pcVerifyInfo;
-}
-#endif /* MBEDTLS_X509_REMOVE_INFO */
-
-/*-----------------------------------------------------------*/
-
-
-static void vLogCertificateVerifyResult( unsigned int flags )
-{
-#ifndef MBEDTLS_X509_REMOVE_INFO
-    for( unsigned int mask = 1; mask != ( 1U << 31 ); mask = mask << 1 )
-    {
-        if( ( flags & mask ) > 0 )
-        {
-            LogError( "Certificate Verification Failure: %s", pcGetVerifyInfoString( flags & mask ) );
-        }
-    }
-#endif /* !MBEDTLS_X509_REMOVE_INFO */
-}
-
-/*-----------------------------------------------------------*/
-
-static size_t uxGetCertCNFromName( unsigned char ** ppucCommonName,
-                                   mbedtls_x509_name * pxCertName )
-{
-    size_t uxCommonNameLen = 0;
-
-    configASSERT( ppucCommonName != NULL );
-    configASSERT( pxCertName != NULL );
-
-    *ppucCommonName = NULL;
-
-    for( ; pxCertName != NULL; pxCertName = pxCertName->next )
-    {
-        if( MBEDTLS_OID_CMP( MBEDTLS_OID_AT_CN, &( pxCertName->oid ) ) == 0 )
-        {
-            *ppucCommonName = pxCertName->MBEDTLS_PRIVATE( val ).p;
-            uxCommonNameLen = pxCertName->MBEDTLS_PRIVATE( val ).len;
-            break;
-        }
-    }
-
-    return( uxCommonNameLen );
-}
-
-/*-----------------------------------------------------------*/
-
-static void vLogCertInfo( mbedtls_x509_crt * pxCert,
-                          const char * pcMessage )
-{
-    /* Iterate over added certs and print information */
-    unsigned char * pucSubjectCN = NULL;
-    unsigned char * pucIssuerCN = NULL;
-    unsigned char * pucSerialNumber = NULL;
-    char pcSerialNumberHex[ 41 ] = { 0 };
-    size_t uxSubjectCNLen = 0;
-    size_t uxIssuerCNLen = 0;
-    size_t uxSerialNumberLen = 0;
-    mbedtls_x509_time * pxValidFrom = NULL;
-    mbedtls_x509_time * pxValidTo = NULL;
-
-    uxSubjectCNLen = uxGetCertCNFromName( &pucSubjectCN,
-                                          &( pxCert->subject ) );
-
-    uxIssuerCNLen = uxGetCertCNFromName( &pucIssuerCN,
-                                         &( pxCert->issuer ) );
-
-    uxSerialNumberLen = pxCert->serial.len;
-    pucSerialNumber = pxCert->serial.p;
-
-    for( uint32_t i = 0; i < uxSerialNumberLen; i++ )
-    {
-        if( i == 21 )
-        {
-            break;
-        }
-
-        snprintf( &( pcSerialNumberHex[ i * 2 ] ), 3, "%.02X", pucSerialNumber[ i ] );
-    }
-
-    pxValidFrom = &( pxCert->valid_from );
-    pxValidTo = &( pxCert->valid_to );
-
-    if( pcMessage && pucSubjectCN && pucIssuerCN && pucSerialNumber && pxValidFrom && pxValidTo )
-    {
-        LogInfo( "%s CN=%.*s, SN:0x%s", pcMessage, uxSubjectCNLen, pucSubjectCN, pcSerialNumberHex );
-        LogInfo( "Issuer: CN=%.*s", uxIssuerCNLen, pucIssuerCN );
-        LogInfo( "Valid From: %04d-%02d-%02d, Expires: %04d-%02d-%02d",
-                 pxValidFrom->year, pxValidFrom->mon, pxValidFrom->day,
-                 pxValidTo->year, pxValidTo->mon, pxValidTo->day );
-    }
-}
-
 /*-----------------------------------------------------------*/
 /*TODO add proper timeout */
 static int mbedtls_ssl_send( void * pvCtx,
                              const unsigned char * pcBuf,
                              size_t uxLen )
 {
-    SockHandle_t * pxSockHandle = ( SockHandle_t * ) pvCtx;
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pvCtx;
+    SockHandle_t * pxSockHandle = &( pxTLSCtx->xSockHandle );
     int lError = 0;
     size_t uxBytesSent = 0;
     uint32_t ulBackofftimeMs = 1;
@@ -368,6 +235,7 @@ static int mbedtls_ssl_send( void * pvCtx,
             if( xRslt > 0 )
             {
                 uxBytesSent += ( size_t ) xRslt;
+                pxTLSCtx->xStats.ulBytesSent += ( uint32_t ) xRslt;
             }
             else
             {
@@ -376,6 +244,7 @@ static int mbedtls_ssl_send( void * pvCtx,
                 if( lError != EWOULDBLOCK )
                 {
                     LogError( "Got Error code: %ld", lError );
+                    pxTLSCtx->xStats.ulSocketErrors++;
                 }
 
                 switch( lError )
@@ -399,6 +268,7 @@ static int mbedtls_ssl_send( void * pvCtx,
 
                 if( lError == EWOULDBLOCK )
                 {
+                    pxTLSCtx->xStats.ulSendStalls++;
                     vTaskDelay( ulBackofftimeMs );
                     ulBackofftimeMs = ulBackofftimeMs * 2;
                     lError = 0;
@@ -416,7 +286,8 @@ static int mbedtls_ssl_recv( void * pvCtx,
                              unsigned char * pcBuf,
                              size_t xLen )
 {
-    SockHandle_t * pxSockHandle = ( SockHandle_t * ) pvCtx;
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pvCtx;
+    SockHandle_t * pxSockHandle = &( pxTLSCtx->xSockHandle );
     int lError = -1;
 
     if( ( pxSockHandle != NULL ) &&
@@ -445,14 +316,20 @@ static int mbedtls_ssl_recv( void * pvCtx,
 
             case EPIPE:
             case ECONNRESET:
+                pxTLSCtx->xStats.ulSocketErrors++;
                 lError = MBEDTLS_ERR_NET_CONN_RESET;
                 break;
 
             default:
+                pxTLSCtx->xStats.ulSocketErrors++;
                 lError = MBEDTLS_ERR_NET_RECV_FAILED;
                 break;
         }
     }
+    else
+    {
+        pxTLSCtx->xStats.ulBytesReceived += ( uint32_t ) lError;
+    }
 
     return lError;
 }
@@ -473,23 +350,16 @@ NetworkContext_t * mbedtls_transport_allocate( void )
     {
         pxTLSCtx->xConnectionState = STATE_ALLOCATED;
         pxTLSCtx->xSockHandle = -1;
-        mbedtls_ssl_config_init( &( pxTLSCtx->xSslConfig ) );
+        ( void ) memset( &( pxTLSCtx->xMemUsage ), 0, sizeof( TlsTransportMemUsage_t ) );
+        ( void ) memset( &( pxTLSCtx->xHandshakeInfo ), 0, sizeof( TlsTransportHandshakeInfo_t ) );
+        ( void ) memset( &( pxTLSCtx->xStats ), 0, sizeof( TlsTransportStats_t ) );
+        vTlsConfigInit( &( pxTLSCtx->xConfig ) );
         mbedtls_ssl_init( &( pxTLSCtx->xSslCtx ) );
 
-        mbedtls_x509_crt_init( &( pxTLSCtx->xClientCert ) );
-        mbedtls_x509_crt_init( &( pxTLSCtx->xRootCaChain ) );
-        mbedtls_pk_init( &( pxTLSCtx->xPkCtx ) );
-
 #ifdef MBEDTLS_TRANSPORT_PKCS11
         pxTLSCtx->xP11SessionHandle = CK_INVALID_HANDLE;
 #endif /* MBEDTLS_TRANSPORT_PKCS11 */
 
-        mbedtls_entropy_init( &( pxTLSCtx->xEntropyCtx ) );
-
-#ifdef TRANSPORT_USE_CTR_DRBG
-        mbedtls_ctr_drbg_init( &( pxTLSCtx->xCtrDrbgCtx ) );
-#endif /* TRANSPORT_USE_CTR_DRBG */
-
 #ifdef MBEDTLS_THREADING_ALT
         mbedtls_platform_threading_init();
 #endif /* MBEDTLS_THREADING_ALT */
@@ -513,11 +383,8 @@ void mbedtls_transport_free( NetworkContext_t * pxNetworkContext )
             ( void ) sock_close( pxTLSCtx->xSockHandle );
         }
 
-        mbedtls_ssl_config_free( &( pxTLSCtx->xSslConfig ) );
         mbedtls_ssl_free( &( pxTLSCtx->xSslCtx ) );
-        mbedtls_x509_crt_free( &( pxTLSCtx->xRootCaChain ) );
-        mbedtls_x509_crt_free( &( pxTLSCtx->xClientCert ) );
-        mbedtls_pk_free( &( pxTLSCtx->xPkCtx ) );
+        vTlsConfigFree( &( pxTLSCtx->xConfig ) );
 
 #ifdef MBEDTLS_TRANSPORT_PKCS11
         if( pxTLSCtx->xP11SessionHandle != CK_INVALID_HANDLE )
@@ -532,301 +399,12 @@ void mbedtls_transport_free( NetworkContext_t * pxNetworkContext )
         }
 #endif /* MBEDTLS_TRANSPORT_PKCS11 */
 
-#ifdef TRANSPORT_USE_CTR_DRBG
-        mbedtls_entropy_free( &( pxTLSCtx->xEntropyCtx ) );
-        mbedtls_ctr_drbg_free( &( pxTLSCtx->xCtrDrbgCtx ) );
-#endif /* TRANSPORT_USE_CTR_DRBG */
-
         vPortFree( ( void * ) pxTLSCtx );
     }
 }
 
 /*-----------------------------------------------------------*/
 
-static int lValidateCertByProfile( TLSContext_t * pxTLSCtx,
-                                   mbedtls_x509_crt * pxCert )
-{
-    int lFlags = 0;
-    const mbedtls_x509_crt_profile * pxCertProfile = NULL;
-
-    if( ( pxTLSCtx == NULL ) || ( pxCert == NULL ) )
-    {
-        lFlags = -1;
-    }
-    else
-    {
-        pxCertProfile = pxTLSCtx->xSslConfig.MBEDTLS_PRIVATE( cert_profile );
-    }
-
-    if( pxCertProfile != NULL )
-    {
-        mbedtls_pk_context * pxPkCtx = &( pxCert->MBEDTLS_PRIVATE( pk ) );
-
-        /* Check hashing algorithm */
-        if( ( pxCertProfile->allowed_mds & MBEDTLS_X509_ID_FLAG( pxCert->MBEDTLS_PRIVATE( sig_md ) ) ) == 0 )
-        {
-            lFlags |= MBEDTLS_X509_BADCERT_BAD_MD;
-        }
-
-        if( ( pxCertProfile->allowed_pks & MBEDTLS_X509_ID_FLAG( pxCert->MBEDTLS_PRIVATE( sig_pk ) ) ) == 0 )
-        {
-            lFlags |= MBEDTLS_X509_BADCERT_BAD_PK;
-        }
-
-        /* Validate public key of cert */
-#if defined( MBEDTLS_RSA_C )
-        if( ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_RSA ) ||
-            ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_RSASSA_PSS ) )
-        {
-            if( mbedtls_pk_get_bitlen( pxPkCtx ) < pxCertProfile->rsa_min_bitlen )
-            {
-                lFlags |= MBEDTLS_X509_BADCERT_BAD_KEY;
-            }
-        }
-#endif /* MBEDTLS_RSA_C */
-
-#if defined( MBEDTLS_ECP_C )
-        if( ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_ECDSA ) ||
-            ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_ECKEY ) ||
-            ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_ECKEY_DH ) )
-        {
-            mbedtls_ecp_group_id xECGroupId = mbedtls_pk_ec( *pxPkCtx )->MBEDTLS_PRIVATE( grp ).id;
-
-            if( ( pxCertProfile->allowed_curves & MBEDTLS_X509_ID_FLAG( xECGroupId ) ) == 0 )
-            {
-                lFlags |= MBEDTLS_X509_BADCERT_BAD_KEY;
-            }
-        }
-#endif /* MBEDTLS_ECP_C */
-    }
-
-    return lFlags;
-}
-
-/*-----------------------------------------------------------*/
-
-static TlsTransportStatus_t xConfigureCertificateAuth( TLSContext_t * pxTLSCtx,
-                                                       const PkiObject_t * pxPrivateKey,
-                                                       const PkiObject_t * pxClientCert )
-{
-    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
-    mbedtls_pk_context * pxPkCtx = NULL;
-    mbedtls_x509_crt * pxCertCtx = NULL;
-    mbedtls_pk_context * pxCertPkCtx = NULL;
-
-    configASSERT( pxTLSCtx );
-    configASSERT( pxPrivateKey );
-    configASSERT( pxClientCert );
-
-    pxCertCtx = &( pxTLSCtx->xClientCert );
-    pxPkCtx = &( pxTLSCtx->xPkCtx );
-
-    /* Reset pk and certificate contexts if this is a reconfiguration */
-    if( pxTLSCtx->xConnectionState == STATE_CONFIGURED )
-    {
-        mbedtls_pk_free( pxPkCtx );
-        mbedtls_x509_crt_free( pxCertCtx );
-
-        mbedtls_pk_init( pxPkCtx );
-        mbedtls_x509_crt_init( pxCertCtx );
-    }
-
-    configASSERT( pxTLSCtx->xSslConfig.f_rng );
-
-    xStatus = xPkiReadPrivateKey( pxPkCtx, pxPrivateKey,
-                                  pxTLSCtx->xSslConfig.f_rng,
-                                  pxTLSCtx->xSslConfig.p_rng );
-
-    if( xStatus != TLS_TRANSPORT_SUCCESS )
-    {
-        LogError( "Failed to add private key to TLS context." );
-    }
-    else
-    {
-        xStatus = xPkiReadCertificate( pxCertCtx, pxClientCert );
-
-        if( xStatus != TLS_TRANSPORT_SUCCESS )
-        {
-            LogError( "Failed to add client certificate to TLS context." );
-        }
-        else
-        {
-            pxCertPkCtx = &( pxCertCtx->MBEDTLS_PRIVATE( pk ) );
-        }
-    }
-
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        int lRslt = lValidateCertByProfile( pxTLSCtx, pxCertCtx );
-
-        if( lRslt != 0 )
-        {
-            vLogCertificateVerifyResult( lRslt );
-
-            xStatus = TLS_TRANSPORT_CLIENT_CERT_INVALID;
-        }
-        else
-        {
-            vLogCertInfo( pxCertCtx, "Client Certificate:" );
-        }
-    }
-
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        configASSERT( pxCertPkCtx );
-        configASSERT( pxPkCtx );
-
-        if( !( mbedtls_pk_can_do( pxCertPkCtx, MBEDTLS_PK_ECDSA ) &&
-               mbedtls_pk_can_do( pxPkCtx, MBEDTLS_PK_ECDSA ) ) &&
-            !( mbedtls_pk_can_do( pxCertPkCtx, MBEDTLS_PK_RSA ) &&
-               mbedtls_pk_can_do( pxPkCtx, MBEDTLS_PK_RSA ) ) )
-        {
-            LogError( "Private key and client certificate have mismatched key types." );
-            xStatus = TLS_TRANSPORT_INVALID_CREDENTIALS;
-        }
-    }
-
-    /* Validate that the cert and pk match. */
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        mbedtls_pk_context xTempPubKeyCtx;
-
-        xTempPubKeyCtx.pk_ctx = pxCertPkCtx->pk_ctx;
-        xTempPubKeyCtx.pk_info = pxPkCtx->pk_info;
-
-        int lError = mbedtls_pk_check_pair( &xTempPubKeyCtx, pxPkCtx,
-                                            pxTLSCtx->xSslConfig.f_rng,
-                                            pxTLSCtx->xSslConfig.p_rng );
-
-        MBEDTLS_MSG_IF_ERROR( lError, "Public-Private keypair does not match the provided certificate." );
-
-        xStatus = ( lError == 0 ) ? TLS_TRANSPORT_SUCCESS : TLS_TRANSPORT_INVALID_CREDENTIALS;
-    }
-
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        int lError = mbedtls_ssl_conf_own_cert( &( pxTLSCtx->xSslConfig ),
-                                                pxCertCtx, pxPkCtx );
-
-        MBEDTLS_MSG_IF_ERROR( lError, "Failed to configure TLS client certificate " );
-
-        xStatus = ( lError == 0 ) ? TLS_TRANSPORT_SUCCESS : TLS_TRANSPORT_INVALID_CREDENTIALS;
-    }
-
-    return xStatus;
-}
-
-/*-----------------------------------------------------------*/
-
-static TlsTransportStatus_t xConfigureCAChain( TLSContext_t * pxTLSCtx,
-                                               const PkiObject_t * pxRootCaCerts,
-                                               const size_t uxNumRootCA )
-{
-    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
-
-    mbedtls_x509_crt * pxRootCertIterator = NULL;
-    mbedtls_x509_crt * pxRootCaChain = NULL;
-    size_t uxValidCertCount = 0;
-    int lError = 0;
-
-    configASSERT( pxTLSCtx );
-    configASSERT( pxRootCaCerts );
-    configASSERT( uxNumRootCA );
-
-    pxRootCaChain = &( pxTLSCtx->xRootCaChain );
-
-    for( size_t uxIdx = 0; uxIdx < uxNumRootCA; uxIdx++ )
-    {
-        const PkiObject_t * pxRootCert = &( pxRootCaCerts[ uxIdx ] );
-        mbedtls_x509_crt * pxTempCaCert = NULL;
-
-        /* Heap allocate all but the first mbedtls_x509_crt object */
-        if( pxRootCertIterator == NULL )
-        {
-            pxTempCaCert = pxRootCaChain;
-        }
-        else
-        {
-            pxTempCaCert = mbedtls_calloc( 1, sizeof( mbedtls_x509_crt ) );
-        }
-
-        /* If heap allocation failed, break out of loop */
-        if( pxTempCaCert == NULL )
-        {
-            LogError( "Failed to allocate memory for mbedtls_x509_crt object." );
-            lError = MBEDTLS_ERR_X509_ALLOC_FAILED;
-        }
-        else
-        {
-            mbedtls_x509_crt_init( pxTempCaCert );
-
-            /* load the certificate onto the heap */
-            lError = xPkiReadCertificate( pxTempCaCert, pxRootCert );
-
-            MBEDTLS_LOG_IF_ERROR( lError, "Failed to load the CA Certificate at index: %ld, Error: ", uxIdx );
-        }
-
-        if( lError == 0 )
-        {
-            lError = lValidateCertByProfile( pxTLSCtx, pxTempCaCert );
-
-            if( lError != 0 )
-            {
-#if !defined( MBEDTLS_X509_REMOVE_INFO )
-                LogError( "Failed to validate the CA Certificate at index: %ld. Reason: %s", uxIdx,
-                          pcGetVerifyInfoString( lError ) );
-#else /* !defined( MBEDTLS_X509_REMOVE_INFO ) */
-                LogError( "Failed to validate the CA Certificate at index: %ld.", uxIdx );
-#endif
-            }
-        }
-
-        if( lError == 0 )
-        {
-            vLogCertInfo( pxTempCaCert, "CA Certificate: " );
-
-            /* Append to the list */
-            if( pxRootCertIterator != NULL )
-            {
-                pxRootCertIterator->MBEDTLS_PRIVATE( next ) = pxTempCaCert;
-            }
-
-            pxRootCertIterator = pxTempCaCert;
-            uxValidCertCount++;
-        }
-        /* Otherwise, handle the error */
-        else if( pxTempCaCert != NULL )
-        {
-            /* Free any allocated data */
-            mbedtls_x509_crt_free( pxTempCaCert );
-
-            /* Free pxTempCaCert if it is heap allocated (not first in list) */
-            if( pxRootCertIterator != NULL )
-            {
-                mbedtls_free( pxTempCaCert );
-            }
-        }
-
-        /* Break on memory allocation failure */
-        if( lError == MBEDTLS_ERR_X509_ALLOC_FAILED )
-        {
-            break;
-        }
-    }
-
-    xStatus = lMbedtlsErrToTransportError( lError );
-
-    if( ( uxValidCertCount == 0 ) &&
-        ( lError != MBEDTLS_ERR_X509_ALLOC_FAILED ) )
-    {
-        LogError( "Failed to load any valid Root CA Certificates." );
-        xStatus = TLS_TRANSPORT_NO_VALID_CA_CERT;
-    }
-
-    return xStatus;
-}
-
-/*-----------------------------------------------------------*/
 TlsTransportStatus_t mbedtls_transport_configure( NetworkContext_t * pxNetworkContext,
                                                   const char ** ppcAlpnProtos,
                                                   const PkiObject_t * pxPrivateKey,
@@ -862,7 +440,7 @@ TlsTransportStatus_t mbedtls_transport_configure( NetworkContext_t * pxNetworkCo
     }
     else
     {
-        pxSslConfig = &( pxTLSCtx->xSslConfig );
+        pxSslConfig = &( pxTLSCtx->xConfig.xSslConfig );
     }
 
     /* If already connected, disconnect */
@@ -885,183 +463,181 @@ TlsTransportStatus_t mbedtls_transport_configure( NetworkContext_t * pxNetworkCo
             }
         }
 #endif /* MBEDTLS_TRANSPORT_PKCS11 */
-
-#ifdef MBEDTLS_TRANSPORT_PSA
-        if( xStatus == TLS_TRANSPORT_SUCCESS )
-        {
-            if( psa_crypto_init() != PSA_SUCCESS )
-            {
-                LogError( "Failed to initialize PSA crypto interface." );
-
-                xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
-            }
-        }
-#endif /* MBEDTLS_TRANSPORT_PSA */
     }
 
     configASSERT( pxTLSCtx->xConnectionState != STATE_CONNECTED );
 
     if( xStatus == TLS_TRANSPORT_SUCCESS )
     {
-#ifdef MBEDTLS_DEBUG_C
-        mbedtls_ssl_conf_dbg( pxSslConfig, vTLSDebugPrint, NULL );
-        mbedtls_debug_set_threshold( MBEDTLS_DEBUG_THRESHOLD );
-#endif /* MBEDTLS_DEBUG_C */
-
+        /* The ssl context refers to the configuration, so it is cleared first when reconfiguring */
         if( pxTLSCtx->xConnectionState == STATE_CONFIGURED )
         {
-            mbedtls_ssl_config_free( pxSslConfig );
-            mbedtls_ssl_config_init( pxSslConfig );
+            mbedtls_ssl_free( &( pxTLSCtx->xSslCtx ) );
+            mbedtls_ssl_init( &( pxTLSCtx->xSslCtx ) );
         }
 
-        /* Initialize SSL Config from defaults */
-        lError = mbedtls_ssl_config_defaults( pxSslConfig,
-                                              MBEDTLS_SSL_IS_CLIENT,
-                                              MBEDTLS_SSL_TRANSPORT_STREAM,
-                                              MBEDTLS_SSL_PRESET_DEFAULT );
+        xStatus = xTlsConfigSetup( &( pxTLSCtx->xConfig ),
+                                   ( pxTLSCtx->xConnectionState == STATE_CONFIGURED ) ? pdTRUE : pdFALSE,
+                                   ppcAlpnProtos,
+                                   pxPrivateKey,
+                                   pxClientCert,
+                                   pxRootCaCerts,
+                                   uxNumRootCA );
+    }
 
-        MBEDTLS_MSG_IF_ERROR( lError, "Failed to initialize ssl configuration: Error:" );
-
-        xStatus = lMbedtlsErrToTransportError( lError );
-    }
-
-    /* Setup entropy / rng contexts */
+    /* Initialize SSL context */
     if( xStatus == TLS_TRANSPORT_SUCCESS )
     {
-        int lRslt = 0;
+        mbedtls_ssl_context * pxSslCtx = &( pxTLSCtx->xSslCtx );
 
-#ifdef TRANSPORT_USE_CTR_DRBG
-        /* Seed the local RNG. */
-        lRslt = mbedtls_ctr_drbg_seed( &( pxTLSCtx->xCtrDrbgCtx ),
-                                       mbedtls_entropy_func,
-                                       &( pxTLSCtx->xEntropyCtx ),
-                                       NULL,
-                                       0 );
+        /* Setup tls connection context and associate it with the tls config. */
+        lError = mbedtls_ssl_setup( pxSslCtx, pxSslConfig );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Call to mbedtls_ssl_setup failed, " );
 
-        if( lRslt < 0 )
+        if( lError != 0 )
         {
-            LogError( "Failed to seed PRNG: Error: %s : %s.",
-                      mbedtlsHighLevelCodeOrDefault( lRslt ),
-                      mbedtlsLowLevelCodeOrDefault( lRslt ) );
             xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
         }
         else
         {
-            mbedtls_ssl_conf_rng( &( pxTLSCtx->xSslConfig ),
-                                  mbedtls_ctr_drbg_random,
-                                  &( pxTLSCtx->xCtrDrbgCtx ) );
+            /* Setup mbedtls IO callbacks */
+            mbedtls_ssl_set_bio( pxSslCtx, pxTLSCtx,
+                                 mbedtls_ssl_send, mbedtls_ssl_recv, NULL );
+
+            pxTLSCtx->xConnectionState = STATE_CONFIGURED;
         }
-#elif defined( MBEDTLS_TRANSPORT_PSA )
-        mbedtls_ssl_conf_rng( &( pxTLSCtx->xSslConfig ),
-                              lPSARandomCallback,
-                              NULL );
-#else /* ifdef TRANSPORT_USE_CTR_DRBG */
-        mbedtls_ssl_conf_rng( &( pxTLSCtx->xSslConfig ),
-                              mbedtls_entropy_func,
-                              &( pxTLSCtx->xEntropyCtx ) );
-#endif /* ifdef TRANSPORT_USE_CTR_DRBG */
+    }
 
+    return xStatus;
+}
 
-        xStatus = ( lError == 0 ) ? TLS_TRANSPORT_SUCCESS : TLS_TRANSPORT_INTERNAL_ERROR;
-    }
+/*-----------------------------------------------------------*/
 
-    /* Configure security level settings */
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
+static void vLogAddress( const struct addrinfo * pxAddr,
+                         const char * pcMessage,
+                         const char * pcHostName,
+                         uint16_t usPort )
+{
+#if LWIP_IPV4 == 1
+    if( pxAddr->ai_family == AF_INET )
     {
-        /* Set minimum ssl / tls version */
-        mbedtls_ssl_conf_min_version( pxSslConfig,
-                                      MBEDTLS_SSL_MAJOR_VERSION_3,
-                                      MBEDTLS_SSL_MINOR_VERSION_3 );
-
-        mbedtls_ssl_conf_cert_profile( pxSslConfig, &mbedtls_x509_crt_profile_default );
+        char ipAddrBuff[ IP4ADDR_STRLEN_MAX ] = { 0 };
+        ( void ) inet_ntoa_r( ( ( struct sockaddr_in * ) pxAddr->ai_addr )->sin_addr, ipAddrBuff, IP4ADDR_STRLEN_MAX );
 
-        mbedtls_ssl_conf_authmode( pxSslConfig, MBEDTLS_SSL_VERIFY_REQUIRED );
+        LogInfo( "%s address: %.*s, port: %uh for host: %s.",
+                 pcMessage, IP4ADDR_STRLEN_MAX, ipAddrBuff, usPort, pcHostName );
     }
-
-    /* Configure certificate auth if a cert and key were provided */
-    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
-        pxPrivateKey && pxClientCert )
+#endif
+#if LWIP_IPV6 == 1
+    if( pxAddr->ai_family == AF_INET6 )
     {
-        xStatus = xConfigureCertificateAuth( pxTLSCtx, pxPrivateKey, pxClientCert );
+        char ipAddrBuff[ IP6ADDR_STRLEN_MAX ] = { 0 };
+        LogInfo( "%s address: %.*s, port: %uh for host: %s.",
+                 pcMessage, IP6ADDR_STRLEN_MAX, ipAddrBuff, usPort, pcHostName );
     }
+#endif
+}
 
-    /* Configure ALPN Protocols */
-    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
-        ppcAlpnProtos )
-    {
-        /* Include an application protocol list in the TLS ClientHello
-         * message. */
-        lError = mbedtls_ssl_conf_alpn_protocols( pxSslConfig, ppcAlpnProtos );
-
-        MBEDTLS_MSG_IF_ERROR( lError, "Failed to configure ALPN protocols: " );
+/*-----------------------------------------------------------*/
 
-        xStatus = lMbedtlsErrToTransportError( lError );
-    }
+static int32_t lSetSocketNonBlocking( SockHandle_t xSockHandle,
+                                      BaseType_t xNonBlocking )
+{
+    int32_t lError = 0;
+    int lFlags = sock_fcntl( xSockHandle, F_GETFL, 0 );
 
-    /* Set Maximum Fragment Length if enabled. */
-#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    if( lFlags == -1 )
     {
-        /* Enable the max fragment extension. 4096 bytes is currently the largest fragment size permitted.
-         * See RFC 8449 https://tools.ietf.org/html/rfc8449 for more information.
-         *
-         * Smaller values can be found in "mbedtls/include/ssl.h".
-         */
-        lError = mbedtls_ssl_conf_max_frag_len( pxSslConfig, MBEDTLS_SSL_MAX_FRAG_LEN_4096 );
-
-        MBEDTLS_MSG_IF_ERROR( lError, "Failed to configure maximum fragment length extension, " );
-        xStatus = lMbedtlsErrToTransportError( lError );
+        lError = -1;
     }
-#endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
-
-    /* Load CA certificate chain. */
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    else
     {
-        if( pxTLSCtx->xConnectionState == STATE_CONFIGURED )
+        if( xNonBlocking == pdTRUE )
         {
-            mbedtls_x509_crt_free( &( pxTLSCtx->xRootCaChain ) );
-            mbedtls_x509_crt_init( &( pxTLSCtx->xRootCaChain ) );
+            lFlags |= O_NONBLOCK;
+        }
+        else
+        {
+            lFlags &= ~O_NONBLOCK;
         }
 
-        xStatus = xConfigureCAChain( pxTLSCtx, pxRootCaCerts, uxNumRootCA );
-
-        mbedtls_ssl_conf_ca_chain( pxSslConfig, &( pxTLSCtx->xRootCaChain ), NULL );
+        lError = sock_fcntl( xSockHandle, F_SETFL, lFlags );
     }
 
-    /* Initialize SSL context */
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        mbedtls_ssl_context * pxSslCtx = &( pxTLSCtx->xSslCtx );
+    return lError;
+}
 
-        /* Clear the ssl connection context if we're reconfiguring */
-        if( pxTLSCtx->xConnectionState == STATE_CONFIGURED )
-        {
-            mbedtls_ssl_free( pxSslCtx );
-            mbedtls_ssl_init( pxSslCtx );
-        }
+/*-----------------------------------------------------------*/
 
-        /* Setup tls connection context and associate it with the tls config. */
-        lError = mbedtls_ssl_setup( pxSslCtx, pxSslConfig );
+/*
+ * Start a non-blocking connection attempt to the given address.
+ * Returns the socket handle if the attempt is in progress or already connected,
+ * -1 if the attempt failed immediately. pxConnected is set to pdTRUE if the
+ * connection completed synchronously.
+ */
+static SockHandle_t xStartConnectAttempt( const struct addrinfo * pxAddr,
+                                          BaseType_t * pxConnected )
+{
+    SockHandle_t xSockHandle = -1;
+    int lError = 0;
 
-        MBEDTLS_MSG_IF_ERROR( lError, "Call to mbedtls_ssl_setup failed, " );
+    *pxConnected = pdFALSE;
 
-        if( lError != 0 )
+    xSockHandle = sock_socket( pxAddr->ai_family,
+                               pxAddr->ai_socktype,
+                               pxAddr->ai_protocol );
+
+    if( xSockHandle < 0 )
+    {
+        LogError( "Failed to allocate socket." );
+    }
+    else if( lSetSocketNonBlocking( xSockHandle, pdTRUE ) != 0 )
+    {
+        LogError( "Failed to set socket O_NONBLOCK flag." );
+        ( void ) sock_close( xSockHandle );
+        xSockHandle = -1;
+    }
+    else
+    {
+        lError = sock_connect( xSockHandle,
+                               pxAddr->ai_addr,
+                               pxAddr->ai_addrlen );
+
+        if( lError == 0 )
         {
-            xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+            *pxConnected = pdTRUE;
+        }
+        else if( *__errno() != EINPROGRESS )
+        {
+            LogWarn( "Connection attempt on socket: %ld failed: errno: %ld.", xSockHandle, *__errno() );
+            ( void ) sock_close( xSockHandle );
+            xSockHandle = -1;
         }
         else
         {
-            /* Setup mbedtls IO callbacks */
-            mbedtls_ssl_set_bio( pxSslCtx, &( pxTLSCtx->xSockHandle ),
-                                 mbedtls_ssl_send, mbedtls_ssl_recv, NULL );
-
-            pxTLSCtx->xConnectionState = STATE_CONFIGURED;
+            /* Connection is in progress. */
         }
     }
 
-    return xStatus;
+    return xSockHandle;
 }
 
+/*-----------------------------------------------------------*/
+
+/*
+ * Connect to the first reachable address returned by getaddrinfo.
+ *
+ * Connection attempts are started in resolver order. If an attempt has not
+ * completed after TLS_TRANSPORT_CONNECT_STAGGER_MS, an attempt to the next
+ * address is started in parallel (up to TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS
+ * outstanding attempts). The first socket to complete its connection is kept
+ * and all other attempts are closed.
+ *
+ * With lwIP, the resolver returns a single IPv4 address (see the lookup
+ * below), so only one attempt is made and TLS_TRANSPORT_CONNECT_TIMEOUT_MS
+ * bounds it.
+ */
 static TlsTransportStatus_t xConnectSocket( TLSContext_t * pxTLSCtx,
                                             const char * pcHostName,
                                             uint16_t usPort )
@@ -1081,7 +657,11 @@ static TlsTransportStatus_t xConnectSocket( TLSContext_t * pxTLSCtx,
         pxTLSCtx->xSockHandle = -1;
     }
 
-    /* Perform address (DNS) lookup */
+    /* Perform address (DNS) lookup.
+     * lwIP 2.1 is built without LWIP_IPV6 and its DNS client keeps one address
+     * per host name: lwip_getaddrinfo returns exactly one entry, and the
+     * staggered attempts below only start a second connection with resolvers
+     * which return several addresses, such as getaddrinfo on a host. */
     if( xStatus == TLS_TRANSPORT_SUCCESS )
     {
         const struct addrinfo xAddrInfoHint =
@@ -1107,119 +687,427 @@ static TlsTransportStatus_t xConnectSocket( TLSContext_t * pxTLSCtx,
         }
     }
 
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        struct addrinfo * pxAddrIter = pxAddrInfo;
+        SockHandle_t pxSockHandles[ TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS ];
+        const struct addrinfo * pxSockAddrs[ TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS ] = { NULL };
+        TickType_t pxStartTimes[ TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS ] = { 0 };
+        size_t uxNumPending = 0;
+        SockHandle_t xConnectedSock = -1;
+
+        for( size_t uxIdx = 0; uxIdx < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS; uxIdx++ )
+        {
+            pxSockHandles[ uxIdx ] = -1;
+        }
+
+        while( xConnectedSock < 0 )
+        {
+            TickType_t xTimeNow = xTaskGetTickCount();
+            TickType_t xWaitTicks = pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_TIMEOUT_MS );
+            struct timeval xTimeout = { 0 };
+            fd_set xWriteSet;
+            fd_set xErrorSet;
+            SockHandle_t xMaxSock = -1;
+
+            /* Start an attempt to the next supported address if a slot is free. */
+            while( ( pxAddrIter != NULL ) &&
+                   ( uxNumPending < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS ) )
+            {
+                struct addrinfo * pxAddr = pxAddrIter;
+                BaseType_t xConnected = pdFALSE;
+                SockHandle_t xSockHandle = -1;
+
+                pxAddrIter = pxAddrIter->ai_next;
+
+                /* Set port number */
+                switch( pxAddr->ai_family )
+                {
+#if LWIP_IPV4 == 1
+                    case AF_INET:
+                        ( ( struct sockaddr_in * ) pxAddr->ai_addr )->sin_port = htons( usPort );
+                        break;
+#endif
+#if LWIP_IPV6 == 1
+                    case AF_INET6:
+                        ( ( struct sockaddr_in6 * ) pxAddr->ai_addr )->sin6_port = htons( usPort );
+                        break;
+#endif
+                    default:
+                        continue;
+                        break;
+                }
+
+                vLogAddress( pxAddr, "Trying", pcHostName, usPort );
+
+                xSockHandle = xStartConnectAttempt( pxAddr, &xConnected );
+
+                if( xConnected == pdTRUE )
+                {
+                    xConnectedSock = xSockHandle;
+                    vLogAddress( pxAddr, "Connected", pcHostName, usPort );
+                }
+                else if( xSockHandle >= 0 )
+                {
+                    for( size_t uxIdx = 0; uxIdx < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS; uxIdx++ )
+                    {
+                        if( pxSockHandles[ uxIdx ] < 0 )
+                        {
+                            pxSockHandles[ uxIdx ] = xSockHandle;
+                            pxSockAddrs[ uxIdx ] = pxAddr;
+                            pxStartTimes[ uxIdx ] = xTimeNow;
+                            uxNumPending++;
+                            break;
+                        }
+                    }
+                }
+                else
+                {
+                    /* Attempt failed immediately, try the next address. */
+                    continue;
+                }
+
+                /* Only start one new attempt per stagger interval. */
+                break;
+            }
+
+            if( ( xConnectedSock >= 0 ) ||
+                ( ( uxNumPending == 0 ) && ( pxAddrIter == NULL ) ) )
+            {
+                break;
+            }
+
+            FD_ZERO( &xWriteSet );
+            FD_ZERO( &xErrorSet );
+
+            /* Wait until the stagger interval elapses, or until the oldest attempt times out. */
+            if( ( pxAddrIter != NULL ) &&
+                ( uxNumPending < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS ) )
+            {
+                xWaitTicks = pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_STAGGER_MS );
+            }
+
+            for( size_t uxIdx = 0; uxIdx < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS; uxIdx++ )
+            {
+                if( pxSockHandles[ uxIdx ] >= 0 )
+                {
+                    TickType_t xElapsed = xTimeNow - pxStartTimes[ uxIdx ];
+                    TickType_t xRemaining = 0;
+
+                    if( xElapsed < pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_TIMEOUT_MS ) )
+                    {
+                        xRemaining = pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_TIMEOUT_MS ) - xElapsed;
+                    }
+
+                    if( xRemaining < xWaitTicks )
+                    {
+                        xWaitTicks = xRemaining;
+                    }
+
+                    FD_SET( pxSockHandles[ uxIdx ], &xWriteSet );
+                    FD_SET( pxSockHandles[ uxIdx ], &xErrorSet );
+
+                    if( pxSockHandles[ uxIdx ] > xMaxSock )
+                    {
+                        xMaxSock = pxSockHandles[ uxIdx ];
+                    }
+                }
+            }
+
+            if( xMaxSock >= 0 )
+            {
+                xTimeout.tv_sec = ( long ) ( xWaitTicks / configTICK_RATE_HZ );
+                xTimeout.tv_usec = ( long ) ( ( ( xWaitTicks % configTICK_RATE_HZ ) * 1000000UL ) / configTICK_RATE_HZ );
+
+                lError = sock_select( xMaxSock + 1, NULL, &xWriteSet, &xErrorSet, &xTimeout );
+
+                if( lError < 0 )
+                {
+                    LogError( "Failed to wait for connection attempts: errno: %ld.", *__errno() );
+                    xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+                    break;
+                }
+            }
+
+            xTimeNow = xTaskGetTickCount();
+
+            /* Reap completed, failed, and timed out attempts */
+            for( size_t uxIdx = 0; uxIdx < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS; uxIdx++ )
+            {
+                SockHandle_t xSockHandle = pxSockHandles[ uxIdx ];
+                BaseType_t xCloseSocket = pdFALSE;
+
+                if( xSockHandle < 0 )
+                {
+                    continue;
+                }
+
+                if( ( xMaxSock >= 0 ) &&
+                    ( lError > 0 ) &&
+                    ( FD_ISSET( xSockHandle, &xWriteSet ) ||
+                      FD_ISSET( xSockHandle, &xErrorSet ) ) )
+                {
+                    int lSockError = 0;
+                    socklen_t xOptLen = sizeof( lSockError );
+
+                    if( ( sock_getsockopt( xSockHandle, SOL_SOCKET, SO_ERROR, &lSockError, &xOptLen ) == 0 ) &&
+                        ( lSockError == 0 ) &&
+                        ( xConnectedSock < 0 ) )
+                    {
+                        xConnectedSock = xSockHandle;
+                        vLogAddress( pxSockAddrs[ uxIdx ], "Connected", pcHostName, usPort );
+                    }
+                    else
+                    {
+                        xCloseSocket = pdTRUE;
+                    }
+                }
+                else if( ( xTimeNow - pxStartTimes[ uxIdx ] ) >= pdMS_TO_TICKS( TLS_TRANSPORT_CONNECT_TIMEOUT_MS ) )
+                {
+                    vLogAddress( pxSockAddrs[ uxIdx ], "Timed out connecting to", pcHostName, usPort );
+                    xCloseSocket = pdTRUE;
+                }
+                else
+                {
+                    /* Still in progress */
+                }
+
+                if( ( xCloseSocket == pdTRUE ) ||
+                    ( xConnectedSock == xSockHandle ) )
+                {
+                    if( xCloseSocket == pdTRUE )
+                    {
+                        ( void ) sock_close( xSockHandle );
+                    }
+
+                    pxSockHandles[ uxIdx ] = -1;
+                    pxSockAddrs[ uxIdx ] = NULL;
+                    uxNumPending--;
+                }
+            }
+        }
+
+        /* Close any losing attempts which are still outstanding. */
+        for( size_t uxIdx = 0; uxIdx < TLS_TRANSPORT_MAX_CONNECT_ATTEMPTS; uxIdx++ )
+        {
+            if( pxSockHandles[ uxIdx ] >= 0 )
+            {
+                ( void ) sock_close( pxSockHandles[ uxIdx ] );
+                pxSockHandles[ uxIdx ] = -1;
+            }
+        }
+
+        /* Restore blocking mode on the winning socket */
+        if( xConnectedSock >= 0 )
+        {
+            if( lSetSocketNonBlocking( xConnectedSock, pdFALSE ) != 0 )
+            {
+                LogError( "Failed to clear socket O_NONBLOCK flag." );
+                ( void ) sock_close( xConnectedSock );
+                xConnectedSock = -1;
+                xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+            }
+            else
+            {
+                LogInfo( "Connected socket: %ld to host: %s, port: %uh.",
+                         xConnectedSock, pcHostName, usPort );
+            }
+        }
+
+        pxTLSCtx->xSockHandle = xConnectedSock;
+    }
+
+    if( pxAddrInfo != NULL )
+    {
+        dns_freeaddrinfo( pxAddrInfo );
+        pxAddrInfo = NULL;
+    }
+
+    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
+        ( pxTLSCtx->xSockHandle < 0 ) )
+    {
+        xStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_transport_get_mem_usage( NetworkContext_t * pxNetworkContext,
+                                         TlsTransportMemUsage_t * pxMemUsage )
+{
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
+
+    if( ( pxTLSCtx == NULL ) ||
+        ( pxMemUsage == NULL ) )
+    {
+        lError = -1;
+    }
+    else
+    {
+        *pxMemUsage = pxTLSCtx->xMemUsage;
+
+        /* Report the current buffer sizes, which change after a session reset. */
+        vTlsGetSslBufferLengths( &( pxTLSCtx->xSslCtx ),
+                                 &( pxMemUsage->uxInBufLen ),
+                                 &( pxMemUsage->uxOutBufLen ) );
+
+        pxMemUsage->uxContextSize = sizeof( TLSContext_t );
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t xSetSocketOptions( TLSContext_t * pxTLSCtx,
+                                               uint32_t ulRecvTimeoutMs,
+                                               uint32_t ulSendTimeoutMs )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    int lError = 0;
+
+    /* Set send and receive timeout parameters */
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        lError = sock_setsockopt( pxTLSCtx->xSockHandle,
+                                  SOL_SOCKET,
+                                  SO_RCVTIMEO,
+                                  ( void * ) &ulRecvTimeoutMs,
+                                  sizeof( ulRecvTimeoutMs ) );
+
+        if( lError != SOCK_OK )
+        {
+            LogError( "Failed to set SO_RCVTIMEO socket option." );
+            xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        lError |= sock_setsockopt( pxTLSCtx->xSockHandle,
+                                   SOL_SOCKET,
+                                   SO_SNDTIMEO,
+                                   ( void * ) &ulSendTimeoutMs,
+                                   sizeof( ulSendTimeoutMs ) );
+
+        if( lError != SOCK_OK )
+        {
+            LogError( "Failed to set SO_SNDTIMEO socket option." );
+            xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+        }
+    }
+
+    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
+        ( ulRecvTimeoutMs == 0 ) )
+    {
+        int flags = sock_fcntl( pxTLSCtx->xSockHandle, F_GETFL, 0 );
+
+        if( flags == -1 )
+        {
+            xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+            LogError( "Failed to get socket flags." );
+        }
+        else
+        {
+            flags = ( flags | O_NONBLOCK );
+
+            if( sock_fcntl( pxTLSCtx->xSockHandle, F_SETFL, flags ) != 0 )
+            {
+                xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+                LogError( "Failed to set socket O_NONBLOCK flag." );
+            }
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static int lPerformHandshake( TLSContext_t * pxTLSCtx )
+{
+    mbedtls_ssl_context * pxSslCtx = &( pxTLSCtx->xSslCtx );
+    size_t uxFreeHeapBefore = uxTlsMemUsageHandshakeStart( pxSslCtx, &( pxTLSCtx->xMemUsage ) );
+    int lError = 0;
+
+    /* Perform the TLS handshake. */
+    do
+    {
+        lError = mbedtls_ssl_handshake( pxSslCtx );
+    }
+    while( ( lError == MBEDTLS_ERR_SSL_WANT_READ ) ||
+           ( lError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+    if( lError != 0 )
+    {
+        LogError( "Failed to perform TLS handshake: Error: %s : %s.",
+                  mbedtlsHighLevelCodeOrDefault( lError ),
+                  mbedtlsLowLevelCodeOrDefault( lError ) );
+    }
+    else
     {
-        struct addrinfo * pxAddrIter = NULL;
+        LogInfo( "Network connection %p: TLS handshake successful.",
+                 pxTLSCtx );
 
-        /* Try all of the addresses returned by getaddrinfo */
-        for( pxAddrIter = pxAddrInfo; pxAddrIter != NULL; pxAddrIter = pxAddrIter->ai_next )
-        {
-            /* Set port number */
-            switch( pxAddrIter->ai_family )
-            {
-#if LWIP_IPV4 == 1
-                case AF_INET:
-                    ( ( struct sockaddr_in * ) pxAddrIter->ai_addr )->sin_port = htons( usPort );
-                    break;
-#endif
-#if LWIP_IPV6 == 1
-                case AF_INET6:
-                    ( ( struct sockaddr_in6 * ) pxAddrIter->ai_addr )->sin6_port = htons( usPort );
-                    break;
-#endif
-                default:
-                    continue;
-                    break;
-            }
+        vTlsMemUsageHandshakeDone( pxSslCtx, &( pxTLSCtx->xMemUsage ), uxFreeHeapBefore, pxTLSCtx );
+    }
 
-#if LWIP_IPV4 == 1
-            if( pxAddrIter->ai_family == AF_INET )
-            {
-                char ipAddrBuff[ IP4ADDR_STRLEN_MAX ] = { 0 };
-                ( void ) inet_ntoa_r( pxAddrIter->ai_addr, ipAddrBuff, IP4ADDR_STRLEN_MAX );
+    return lError;
+}
 
-                LogInfo( "Trying address: %.*s, port: %uh for host: %s.",
-                         IP4ADDR_STRLEN_MAX, ipAddrBuff, usPort, pcHostName );
-            }
-#endif
-#if LWIP_IPV6 == 1
-            if( pxAddrIter->ai_family == AF_INET6 )
-            {
-                char ipAddrBuff[ IP6ADDR_STRLEN_MAX ] = { 0 };
-                LogInfo( "Trying address: %.*s, port: %uh for host: %s.",
-                         IP6ADDR_STRLEN_MAX, ipAddrBuff, usPort, pcHostName );
-            }
-#endif
+/*-----------------------------------------------------------*/
 
-            /* Allocate socket */
-            pxTLSCtx->xSockHandle = sock_socket( pxAddrIter->ai_family,
-                                                 pxAddrIter->ai_socktype,
-                                                 pxAddrIter->ai_protocol );
+int32_t mbedtls_transport_get_handshake_info( NetworkContext_t * pxNetworkContext,
+                                              TlsTransportHandshakeInfo_t * pxHandshakeInfo )
+{
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
 
-            if( pxTLSCtx->xSockHandle < 0 )
-            {
-                LogError( "Failed to allocate socket." );
-                xStatus = TLS_TRANSPORT_INSUFFICIENT_SOCKETS;
-            }
-            else
-            {
-                lError = sock_connect( pxTLSCtx->xSockHandle,
-                                       pxAddrIter->ai_addr,
-                                       pxAddrIter->ai_addrlen );
+    if( ( pxTLSCtx == NULL ) ||
+        ( pxHandshakeInfo == NULL ) )
+    {
+        lError = -1;
+    }
+    else
+    {
+        *pxHandshakeInfo = pxTLSCtx->xHandshakeInfo;
+    }
 
-                /* Upon connection error, continue to next address */
-                if( lError != 0 )
-                {
-                    ( void ) sock_close( pxTLSCtx->xSockHandle );
-                    pxTLSCtx->xSockHandle = -1;
-                }
-                else
-                {
-#if LWIP_IPV4 == 1
-                    if( pxAddrIter->ai_family == AF_INET )
-                    {
-                        char ipAddrBuff[ IP4ADDR_STRLEN_MAX ] = { 0 };
-                        ( void ) inet_ntoa_r( pxAddrIter->ai_addr, ipAddrBuff, IP4ADDR_STRLEN_MAX );
+    return lError;
+}
 
-                        LogInfo( "Connected socket: %ld to host: %s, address: %.*s, port: %uh.",
-                                 pxTLSCtx->xSockHandle, pcHostName,
-                                 IP4ADDR_STRLEN_MAX, ipAddrBuff, usPort );
-                    }
-#endif
-#if LWIP_IPV6 == 1
-                    if( pxAddrIter->ai_family == AF_INET6 )
-                    {
-                        char ipAddrBuff[ IP6ADDR_STRLEN_MAX ] = { 0 };
-                        LogInfo( "Connected socket: %ld to host: %s, address: %.*s, port: %uh.",
-                                 pxTLSCtx->xSockHandle, pcHostName,
-                                 IP6ADDR_STRLEN_MAX, ipAddrBuff, usPort );
-                    }
-#endif
-                }
-            }
+/*-----------------------------------------------------------*/
 
-            /* Exit loop on an irrecoverable error or successful connection. */
-            if( ( xStatus != TLS_TRANSPORT_SUCCESS ) ||
-                ( pxTLSCtx->xSockHandle >= 0 ) )
-            {
-                break;
-            }
-        }
-    }
+int32_t mbedtls_transport_get_stats( NetworkContext_t * pxNetworkContext,
+                                     TlsTransportStats_t * pxStats )
+{
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pxNetworkContext;
+    int32_t lError = 0;
 
-    if( pxAddrInfo != NULL )
+    if( ( pxTLSCtx == NULL ) ||
+        ( pxStats == NULL ) )
     {
-        dns_freeaddrinfo( pxAddrInfo );
-        pxAddrInfo = NULL;
+        lError = -1;
     }
-
-    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
-        ( pxTLSCtx->xSockHandle < 0 ) )
+    else
     {
-        xStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+        *pxStats = pxTLSCtx->xStats;
+
+        pxStats->xConnected = ( pxTLSCtx->xConnectionState == STATE_CONNECTED ) ? pdTRUE : pdFALSE;
+
+        if( pxTLSCtx->pxNotifyThreadCtx != NULL )
+        {
+            pxStats->ulRecvWakeups = pxTLSCtx->pxNotifyThreadCtx->ulWakeups;
+        }
+
+        ( void ) mbedtls_transport_get_handshake_info( pxNetworkContext, &( pxStats->xHandshake ) );
+        ( void ) mbedtls_transport_get_mem_usage( pxNetworkContext, &( pxStats->xMemUsage ) );
     }
 
-    return xStatus;
+    return lError;
 }
 
 /*-----------------------------------------------------------*/
@@ -1281,85 +1169,82 @@ TlsTransportStatus_t mbedtls_transport_connect( NetworkContext_t * pxNetworkCont
 
     if( xStatus == TLS_TRANSPORT_SUCCESS )
     {
+        TlsTransportHandshakeInfo_t * pxInfo = &( pxTLSCtx->xHandshakeInfo );
+        uint32_t ulStartTimeMs = ulGetTimeMs();
+
+        pxInfo->xFallback = pdFALSE;
+
+        /* Statistics are kept per connection */
+        ( void ) memset( &( pxTLSCtx->xStats ), 0, sizeof( TlsTransportStats_t ) );
+
         xStatus = xConnectSocket( pxTLSCtx, pcHostName, usPort );
-    }
 
-    /* Set send and receive timeout parameters */
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        lError = sock_setsockopt( pxTLSCtx->xSockHandle,
-                                  SOL_SOCKET,
-                                  SO_RCVTIMEO,
-                                  ( void * ) &ulRecvTimeoutMs,
-                                  sizeof( ulRecvTimeoutMs ) );
+        pxInfo->ulConnectTimeMs = ulGetTimeMs() - ulStartTimeMs;
 
-        if( lError != SOCK_OK )
+        if( xStatus == TLS_TRANSPORT_SUCCESS )
         {
-            LogError( "Failed to set SO_RCVTIMEO socket option." );
-            xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
+            xStatus = xSetSocketOptions( pxTLSCtx, ulRecvTimeoutMs, ulSendTimeoutMs );
         }
-    }
-
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        lError |= sock_setsockopt( pxTLSCtx->xSockHandle,
-                                   SOL_SOCKET,
-                                   SO_SNDTIMEO,
-                                   ( void * ) &ulSendTimeoutMs,
-                                   sizeof( ulSendTimeoutMs ) );
 
-        if( lError != SOCK_OK )
+        if( xStatus == TLS_TRANSPORT_SUCCESS )
         {
-            LogError( "Failed to set SO_SNDTIMEO socket option." );
-            xStatus = TLS_TRANSPORT_INVALID_PARAMETER;
-        }
-    }
+            ulStartTimeMs = ulGetTimeMs();
 
-    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
-        ( ulRecvTimeoutMs == 0 ) )
-    {
-        int flags = sock_fcntl( pxTLSCtx->xSockHandle, F_GETFL, 0 );
+            lError = lPerformHandshake( pxTLSCtx );
 
-        if( flags == -1 )
-        {
-            xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
-            LogError( "Failed to get socket flags." );
-        }
-        else
-        {
-            flags = ( flags | O_NONBLOCK );
+#if TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_PREFERRED
 
-            if( sock_fcntl( pxTLSCtx->xSockHandle, F_SETFL, flags ) != 0 )
+            /*
+             * Retry with TLS 1.2 on a fresh connection if the TLS 1.3 handshake
+             * failed for any reason other than server certificate validation.
+             */
+            if( ( lError != 0 ) &&
+                ( lError != MBEDTLS_ERR_X509_CERT_VERIFY_FAILED ) &&
+                ( pxTLSCtx->xConfig.xTls13Disabled == pdFALSE ) )
             {
-                xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
-                LogError( "Failed to set socket O_NONBLOCK flag." );
-            }
-        }
-    }
+                LogWarn( "Network connection %p: TLS 1.3 handshake failed. Retrying with TLS 1.2.",
+                         pxTLSCtx );
 
-    /* Perform TLS handshake. */
-    if( xStatus == TLS_TRANSPORT_SUCCESS )
-    {
-        /* Perform the TLS handshake. */
-        do
-        {
-            lError = mbedtls_ssl_handshake( pxSslCtx );
-        }
-        while( ( lError == MBEDTLS_ERR_SSL_WANT_READ ) ||
-               ( lError == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+                sock_close( pxTLSCtx->xSockHandle );
+                pxTLSCtx->xSockHandle = -1;
 
-        if( lError != 0 )
-        {
-            LogError( "Failed to perform TLS handshake: Error: %s : %s.",
-                      mbedtlsHighLevelCodeOrDefault( lError ),
-                      mbedtlsLowLevelCodeOrDefault( lError ) );
+                pxInfo->xFallback = pdTRUE;
+
+                lError = lTlsConfigFallbackToTls12( &( pxTLSCtx->xConfig ), pxSslCtx, pcHostName );
+
+                if( lError != 0 )
+                {
+                    xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+                }
+                else
+                {
+                    xStatus = xConnectSocket( pxTLSCtx, pcHostName, usPort );
+                }
+
+                if( xStatus == TLS_TRANSPORT_SUCCESS )
+                {
+                    xStatus = xSetSocketOptions( pxTLSCtx, ulRecvTimeoutMs, ulSendTimeoutMs );
+                }
+
+                if( xStatus == TLS_TRANSPORT_SUCCESS )
+                {
+                    lError = lPerformHandshake( pxTLSCtx );
+                }
+            }
+#endif /* TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_PREFERRED */
+
+            pxInfo->ulHandshakeTimeMs = ulGetTimeMs() - ulStartTimeMs;
 
-            xStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
+            if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
+                ( lError != 0 ) )
+            {
+                xStatus = TLS_TRANSPORT_HANDSHAKE_FAILED;
+            }
         }
-        else
+
+        if( xStatus == TLS_TRANSPORT_SUCCESS )
         {
-            LogInfo( "Network connection %p: TLS handshake successful.",
-                     pxTLSCtx );
+            vTlsLogHandshakeInfo( pxSslCtx, pxInfo, pxTLSCtx );
         }
     }
 
@@ -1427,6 +1312,7 @@ static void vCreateSocketNotifyTask( NotifyThreadCtx_t * pxNotifyThreadCtx,
         pxNotifyThreadCtx->pxRecvReadyCallback )
     {
         pxNotifyThreadCtx->xSockHandle = xSockHandle;
+        pxNotifyThreadCtx->ulWakeups = 0;
 
         xTaskHandle = xTaskCreateStatic( vSocketNotifyThread,
                                          "SockNotify",
@@ -1485,6 +1371,7 @@ int32_t mbedtls_transport_setrecvcallback( NetworkContext_t * pxNetworkContext,
             pxTLSCtx->pxNotifyThreadCtx = pxNotifyThreadCtx;
             pxNotifyThreadCtx->xSockHandle = -1;
             pxNotifyThreadCtx->xTaskHandle = 0;
+            pxNotifyThreadCtx->ulWakeups = 0;
         }
     }
     /* Connected and pxNotifyThreadCtx already exists */
@@ -1624,6 +1511,7 @@ int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
     {
         /* Mark these set of errors as a timeout. The libraries may retry read
          * on these errors. */
+        pxTLSCtx->xStats.ulRecvWantRead++;
         tlsStatus = 0;
     }
     /* Close the Socket if needed. */
@@ -1652,6 +1540,17 @@ int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
     }
     else
     {
+        if( tlsStatus > 0 )
+        {
+            pxTLSCtx->xStats.ulAppBytesReceived += ( uint32_t ) tlsStatus;
+
+            /* A record has been fully consumed once no buffered plaintext remains. */
+            if( mbedtls_ssl_get_bytes_avail( &( pxTLSCtx->xSslCtx ) ) == 0 )
+            {
+                pxTLSCtx->xStats.ulRecordsReceived++;
+            }
+        }
+
         if( pxTLSCtx->pxNotifyThreadCtx &&
             pxTLSCtx->pxNotifyThreadCtx->xTaskHandle )
         {
@@ -1663,34 +1562,31 @@ int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
 }
 /*-----------------------------------------------------------*/
 
-int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
-                                const void * pBuffer,
-                                size_t uxBytesToSend )
+/* Count the application data records produced by a successful mbedtls_ssl_write call. */
+static void vCountRecordsSent( TLSContext_t * pxTLSCtx,
+                               int32_t lBytesWritten )
 {
-    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pxNetworkContext;
-    int32_t tlsStatus = 0;
-
-    configASSERT( pxTLSCtx != NULL );
-    configASSERT( pBuffer != NULL );
-    configASSERT( uxBytesToSend > 0 );
+    int lMaxPayload = mbedtls_ssl_get_max_out_record_payload( &( pxTLSCtx->xSslCtx ) );
 
-    if( pxTLSCtx->xConnectionState == STATE_CONNECTED )
-    {
-        tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxTLSCtx->xSslCtx ),
-                                                   pBuffer,
-                                                   uxBytesToSend );
-    }
-    else
+    if( ( lBytesWritten > 0 ) &&
+        ( lMaxPayload > 0 ) )
     {
-        tlsStatus = 0;
+        pxTLSCtx->xStats.ulRecordsSent += ( uint32_t ) ( ( lBytesWritten + lMaxPayload - 1 ) / lMaxPayload );
     }
+}
+
+/*-----------------------------------------------------------*/
 
+static int32_t lHandleSendResult( TLSContext_t * pxTLSCtx,
+                                  int32_t tlsStatus )
+{
     if( ( tlsStatus == MBEDTLS_ERR_SSL_TIMEOUT ) ||
         ( tlsStatus == MBEDTLS_ERR_SSL_WANT_READ ) ||
         ( tlsStatus == MBEDTLS_ERR_SSL_WANT_WRITE ) )
     {
         /* Mark these set of errors as a timeout. The libraries may retry send
          * on these errors. */
+        pxTLSCtx->xStats.ulSendStalls++;
         tlsStatus = 0;
     }
     /* Close the Socket if needed. */
@@ -1727,68 +1623,150 @@ int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
 
 /*-----------------------------------------------------------*/
 
-#ifdef MBEDTLS_DEBUG_C
-static inline const char * pcMbedtlsLevelToFrLevel( int lLevel )
+int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
+                                const void * pBuffer,
+                                size_t uxBytesToSend )
 {
-    const char * pcFrLogLevel;
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pxNetworkContext;
+    int32_t tlsStatus = 0;
 
-    switch( lLevel )
-    {
-        case 1:
-            pcFrLogLevel = "ERR";
-            break;
+    configASSERT( pxTLSCtx != NULL );
+    configASSERT( pBuffer != NULL );
+    configASSERT( uxBytesToSend > 0 );
 
-        case 2:
-        case 3:
-            pcFrLogLevel = "INF";
-            break;
+    if( pxTLSCtx->xConnectionState == STATE_CONNECTED )
+    {
+        tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxTLSCtx->xSslCtx ),
+                                                   pBuffer,
+                                                   uxBytesToSend );
 
-        case 4:
-        default:
-            pcFrLogLevel = "DBG";
-            break;
+        vCountRecordsSent( pxTLSCtx, tlsStatus );
+        pxTLSCtx->xStats.ulAppBytesSent += ( tlsStatus > 0 ) ? ( uint32_t ) tlsStatus : 0;
+    }
+    else
+    {
+        tlsStatus = 0;
     }
 
-    return pcFrLogLevel;
+    return lHandleSendResult( pxTLSCtx, tlsStatus );
 }
 
-/*-------------------------------------------------------*/
+/*-----------------------------------------------------------*/
+
+#if TLS_TRANSPORT_WRITEV_ENABLED
 
-static inline const char * pcPathToBasename( const char * pcFileName )
+int32_t mbedtls_transport_writev( NetworkContext_t * pxNetworkContext,
+                                  TransportOutVector_t * pxIoVec,
+                                  size_t uxIoVecCount )
 {
-    const char * pcIter = pcFileName;
-    const char * pcBasename = pcFileName;
+    TLSContext_t * pxTLSCtx = ( TLSContext_t * ) pxNetworkContext;
+    int32_t lBytesSent = 0;
+    int32_t tlsStatus = 0;
+    size_t uxVecIdx = 0;
+    size_t uxVecOffset = 0;
+
+    configASSERT( pxTLSCtx != NULL );
+    configASSERT( pxIoVec != NULL );
+    configASSERT( uxIoVecCount > 0 );
 
-    /* Extract basename from file name */
-    while( *pcIter != '\0' )
+    while( ( pxTLSCtx->xConnectionState == STATE_CONNECTED ) &&
+           ( uxVecIdx < uxIoVecCount ) )
     {
-        if( ( *pcIter == '/' ) || ( *pcIter == '\\' ) )
+        const uint8_t * pucVecBase = ( const uint8_t * ) pxIoVec[ uxVecIdx ].iov_base;
+        size_t uxVecRemaining = pxIoVec[ uxVecIdx ].iov_len - uxVecOffset;
+
+        if( uxVecRemaining == 0 )
         {
-            pcBasename = pcIter + 1;
+            uxVecIdx++;
+            uxVecOffset = 0;
+            continue;
         }
 
-        pcIter++;
-    }
+        if( uxVecRemaining >= TLS_TRANSPORT_WRITEV_BUFFER_LEN )
+        {
+            /* Large vectors are encrypted in place. */
+            tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxTLSCtx->xSslCtx ),
+                                                       &( pucVecBase[ uxVecOffset ] ),
+                                                       uxVecRemaining );
+        }
+        else
+        {
+            size_t uxStagedLen = 0;
+            size_t uxIdx = uxVecIdx;
+            size_t uxOffset = uxVecOffset;
+
+            /*
+             * Coalesce this vector with the following ones so that they are
+             * sent in a single record. The staged data depends only on the
+             * current position, so a retry after WANT_WRITE repeats the same
+             * mbedtls_ssl_write call as required by mbedtls.
+             */
+            while( ( uxIdx < uxIoVecCount ) &&
+                   ( uxStagedLen < TLS_TRANSPORT_WRITEV_BUFFER_LEN ) )
+            {
+                size_t uxCopyLen = pxIoVec[ uxIdx ].iov_len - uxOffset;
 
-    return pcBasename;
-}
+                if( uxCopyLen > ( TLS_TRANSPORT_WRITEV_BUFFER_LEN - uxStagedLen ) )
+                {
+                    uxCopyLen = TLS_TRANSPORT_WRITEV_BUFFER_LEN - uxStagedLen;
+                }
 
-/*-------------------------------------------------------*/
+                ( void ) memcpy( &( pxTLSCtx->pucWritevBuf[ uxStagedLen ] ),
+                                 &( ( ( const uint8_t * ) pxIoVec[ uxIdx ].iov_base )[ uxOffset ] ),
+                                 uxCopyLen );
 
-static void vTLSDebugPrint( void * ctx,
-                            int lLevel,
-                            const char * pcFileName,
-                            int lLineNumber,
-                            const char * pcErrStr )
-{
-    const char * pcLogLevel;
-    const char * pcFileBaseName;
+                uxStagedLen += uxCopyLen;
+                uxIdx++;
+                uxOffset = 0;
+            }
+
+            tlsStatus = ( int32_t ) mbedtls_ssl_write( &( pxTLSCtx->xSslCtx ),
+                                                       pxTLSCtx->pucWritevBuf,
+                                                       uxStagedLen );
+        }
+
+        if( tlsStatus <= 0 )
+        {
+            break;
+        }
+
+        vCountRecordsSent( pxTLSCtx, tlsStatus );
 
-    ( void ) ctx;
+        lBytesSent += tlsStatus;
+        pxTLSCtx->xStats.ulAppBytesSent += ( uint32_t ) tlsStatus;
 
-    pcLogLevel = pcMbedtlsLevelToFrLevel( lLevel );
-    pcFileBaseName = pcPathToBasename( pcFileName );
+        /* Advance past the bytes consumed by mbedtls_ssl_write */
+        while( ( tlsStatus > 0 ) &&
+               ( uxVecIdx < uxIoVecCount ) )
+        {
+            size_t uxVecLeft = pxIoVec[ uxVecIdx ].iov_len - uxVecOffset;
+
+            if( ( size_t ) tlsStatus < uxVecLeft )
+            {
+                uxVecOffset += ( size_t ) tlsStatus;
+                tlsStatus = 0;
+            }
+            else
+            {
+                tlsStatus -= ( int32_t ) uxVecLeft;
+                uxVecIdx++;
+                uxVecOffset = 0;
+            }
+        }
+    }
+
+    if( tlsStatus < 0 )
+    {
+        tlsStatus = lHandleSendResult( pxTLSCtx, tlsStatus );
+    }
 
-    vLoggingPrintf( pcLogLevel, pcFileBaseName, lLineNumber, pcErrStr );
+    /* On timeout, report any partial progress and leave the caller to retry the remainder. */
+    if( tlsStatus < 0 )
+    {
+        lBytesSent = tlsStatus;
+    }
+
+    return lBytesSent;
 }
-#endif /* ifdef MBEDTLS_DEBUG_C */
+
+#endif /* TLS_TRANSPORT_WRITEV_ENABLED */
@@ -0,0 +1,882 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mbedtls_transport_common.c
+ * @brief TLS configuration shared by the socket and altcp mbedtls transports.
+ */
+#include "logging_levels.h"
+
+#define LOG_LEVEL    LOG_INFO
+
+#include "logging.h"
+
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include "mbedtls_transport_common.h"
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* mbedTLS includes. */
+#include "mbedtls/error.h"
+#include MBEDTLS_CONFIG_FILE
+#include "mbedtls/debug.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/pem.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/asn1.h"
+#include "mbedtls/oid.h"
+#include "pk_wrap.h"
+
+#define MBEDTLS_DEBUG_THRESHOLD    1
+
+#ifdef MBEDTLS_DEBUG_C
+/* Used to print mbedTLS log output. */
+static void vTLSDebugPrint( void * ctx,
+                            int level,
+                            const char * file,
+                            int line,
+                            const char * str );
+#endif
+
+/*-----------------------------------------------------------*/
+
+int32_t lMbedtlsErrToTransportError( int32_t lError )
+{
+    switch( lError )
+    {
+        case 0:
+            lError = TLS_TRANSPORT_SUCCESS;
+            break;
+
+        case MBEDTLS_ERR_X509_ALLOC_FAILED:
+            lError = TLS_TRANSPORT_INSUFFICIENT_MEMORY;
+            break;
+
+        case MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED:
+            lError = TLS_TRANSPORT_INTERNAL_ERROR;
+            break;
+
+        case MBEDTLS_ERR_SSL_BAD_INPUT_DATA:
+            lError = TLS_TRANSPORT_INVALID_PARAMETER;
+            break;
+
+        case MBEDTLS_ERR_X509_CERT_UNKNOWN_FORMAT:
+        case MBEDTLS_ERR_X509_BAD_INPUT_DATA:
+        case MBEDTLS_ERR_PEM_BAD_INPUT_DATA:
+        case MBEDTLS_ERR_PEM_NO_HEADER_FOOTER_PRESENT:
+            lError = TLS_TRANSPORT_PKI_OBJECT_PARSE_FAIL;
+            break;
+
+        default:
+            lError = lError < 0 ? TLS_TRANSPORT_UNKNOWN_ERROR : TLS_TRANSPORT_SUCCESS;
+            break;
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+#ifndef MBEDTLS_X509_REMOVE_INFO
+#ifdef X509_CRT_ERROR_INFO
+#undef X509_CRT_ERROR_INFO
+#endif /* X509_CRT_ERROR_INFO */
+#define X509_CRT_ERROR_INFO( err, err_str, info ) \
+    case err:                                     \
+        pcVerifyInfo = info; break;
+static const char * pcGetVerifyInfoString( unsigned int flag )
+{
+    const char * pcVerifyInfo = "Unknown Failure reason.";
+
+    switch( flag )
+    {
+        MBEDTLS_X509_CRT_ERROR_INFO_LIST
+        default:
+            break;
+    }
+
+    return pcVerifyInfo;
+}
+#endif /* MBEDTLS_X509_REMOVE_INFO */
+
+/*-----------------------------------------------------------*/
+
+
+static void vLogCertificateVerifyResult( unsigned int flags )
+{
+#ifndef MBEDTLS_X509_REMOVE_INFO
+    for( unsigned int mask = 1; mask != ( 1U << 31 ); mask = mask << 1 )
+    {
+        if( ( flags & mask ) > 0 )
+        {
+            LogError( "Certificate Verification Failure: %s", pcGetVerifyInfoString( flags & mask ) );
+        }
+    }
+#endif /* !MBEDTLS_X509_REMOVE_INFO */
+}
+
+/*-----------------------------------------------------------*/
+
+static size_t uxGetCertCNFromName( unsigned char ** ppucCommonName,
+                                   mbedtls_x509_name * pxCertName )
+{
+    size_t uxCommonNameLen = 0;
+
+    configASSERT( ppucCommonName != NULL );
+    configASSERT( pxCertName != NULL );
+
+    *ppucCommonName = NULL;
+
+    for( ; pxCertName != NULL; pxCertName = pxCertName->next )
+    {
+        if( MBEDTLS_OID_CMP( MBEDTLS_OID_AT_CN, &( pxCertName->oid ) ) == 0 )
+        {
+            *ppucCommonName = pxCertName->MBEDTLS_PRIVATE( val ).p;
+            uxCommonNameLen = pxCertName->MBEDTLS_PRIVATE( val ).len;
+            break;
+        }
+    }
+
+    return( uxCommonNameLen );
+}
+
+/*-----------------------------------------------------------*/
+
+static void vLogCertInfo( mbedtls_x509_crt * pxCert,
+                          const char * pcMessage )
+{
+    /* Iterate over added certs and print information */
+    unsigned char * pucSubjectCN = NULL;
+    unsigned char * pucIssuerCN = NULL;
+    unsigned char * pucSerialNumber = NULL;
+    char pcSerialNumberHex[ 41 ] = { 0 };
+    size_t uxSubjectCNLen = 0;
+    size_t uxIssuerCNLen = 0;
+    size_t uxSerialNumberLen = 0;
+    mbedtls_x509_time * pxValidFrom = NULL;
+    mbedtls_x509_time * pxValidTo = NULL;
+
+    uxSubjectCNLen = uxGetCertCNFromName( &pucSubjectCN,
+                                          &( pxCert->subject ) );
+
+    uxIssuerCNLen = uxGetCertCNFromName( &pucIssuerCN,
+                                         &( pxCert->issuer ) );
+
+    uxSerialNumberLen = pxCert->serial.len;
+    pucSerialNumber = pxCert->serial.p;
+
+    for( uint32_t i = 0; i < uxSerialNumberLen; i++ )
+    {
+        if( i == 21 )
+        {
+            break;
+        }
+
+        snprintf( &( pcSerialNumberHex[ i * 2 ] ), 3, "%.02X", pucSerialNumber[ i ] );
+    }
+
+    pxValidFrom = &( pxCert->valid_from );
+    pxValidTo = &( pxCert->valid_to );
+
+    if( pcMessage && pucSubjectCN && pucIssuerCN && pucSerialNumber && pxValidFrom && pxValidTo )
+    {
+        LogInfo( "%s CN=%.*s, SN:0x%s", pcMessage, uxSubjectCNLen, pucSubjectCN, pcSerialNumberHex );
+        LogInfo( "Issuer: CN=%.*s", uxIssuerCNLen, pucIssuerCN );
+        LogInfo( "Valid From: %04d-%02d-%02d, Expires: %04d-%02d-%02d",
+                 pxValidFrom->year, pxValidFrom->mon, pxValidFrom->day,
+                 pxValidTo->year, pxValidTo->mon, pxValidTo->day );
+    }
+}
+
+static int lValidateCertByProfile( const TlsTransportConfig_t * pxConfig,
+                                   mbedtls_x509_crt * pxCert )
+{
+    int lFlags = 0;
+    const mbedtls_x509_crt_profile * pxCertProfile = NULL;
+
+    if( ( pxConfig == NULL ) || ( pxCert == NULL ) )
+    {
+        lFlags = -1;
+    }
+    else
+    {
+        pxCertProfile = pxConfig->xSslConfig.MBEDTLS_PRIVATE( cert_profile );
+    }
+
+    if( pxCertProfile != NULL )
+    {
+        mbedtls_pk_context * pxPkCtx = &( pxCert->MBEDTLS_PRIVATE( pk ) );
+
+        /* Check hashing algorithm */
+        if( ( pxCertProfile->allowed_mds & MBEDTLS_X509_ID_FLAG( pxCert->MBEDTLS_PRIVATE( sig_md ) ) ) == 0 )
+        {
+            lFlags |= MBEDTLS_X509_BADCERT_BAD_MD;
+        }
+
+        if( ( pxCertProfile->allowed_pks & MBEDTLS_X509_ID_FLAG( pxCert->MBEDTLS_PRIVATE( sig_pk ) ) ) == 0 )
+        {
+            lFlags |= MBEDTLS_X509_BADCERT_BAD_PK;
+        }
+
+        /* Validate public key of cert */
+#if defined( MBEDTLS_RSA_C )
+        if( ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_RSA ) ||
+            ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_RSASSA_PSS ) )
+        {
+            if( mbedtls_pk_get_bitlen( pxPkCtx ) < pxCertProfile->rsa_min_bitlen )
+            {
+                lFlags |= MBEDTLS_X509_BADCERT_BAD_KEY;
+            }
+        }
+#endif /* MBEDTLS_RSA_C */
+
+#if defined( MBEDTLS_ECP_C )
+        if( ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_ECDSA ) ||
+            ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_ECKEY ) ||
+            ( mbedtls_pk_get_type( pxPkCtx ) == MBEDTLS_PK_ECKEY_DH ) )
+        {
+            mbedtls_ecp_group_id xECGroupId = mbedtls_pk_ec( *pxPkCtx )->MBEDTLS_PRIVATE( grp ).id;
+
+            if( ( pxCertProfile->allowed_curves & MBEDTLS_X509_ID_FLAG( xECGroupId ) ) == 0 )
+            {
+                lFlags |= MBEDTLS_X509_BADCERT_BAD_KEY;
+            }
+        }
+#endif /* MBEDTLS_ECP_C */
+    }
+
+    return lFlags;
+}
+
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t xConfigureCertificateAuth( TlsTransportConfig_t * pxConfig,
+                                                       const PkiObject_t * pxPrivateKey,
+                                                       const PkiObject_t * pxClientCert )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    mbedtls_pk_context * pxPkCtx = NULL;
+    mbedtls_x509_crt * pxCertCtx = NULL;
+    mbedtls_pk_context * pxCertPkCtx = NULL;
+
+    configASSERT( pxConfig );
+    configASSERT( pxPrivateKey );
+    configASSERT( pxClientCert );
+
+    pxCertCtx = &( pxConfig->xClientCert );
+    pxPkCtx = &( pxConfig->xPkCtx );
+
+    configASSERT( pxConfig->xSslConfig.f_rng );
+
+    xStatus = xPkiReadPrivateKey( pxPkCtx, pxPrivateKey,
+                                  pxConfig->xSslConfig.f_rng,
+                                  pxConfig->xSslConfig.p_rng );
+
+    if( xStatus != TLS_TRANSPORT_SUCCESS )
+    {
+        LogError( "Failed to add private key to TLS context." );
+    }
+    else
+    {
+        xStatus = xPkiReadCertificate( pxCertCtx, pxClientCert );
+
+        if( xStatus != TLS_TRANSPORT_SUCCESS )
+        {
+            LogError( "Failed to add client certificate to TLS context." );
+        }
+        else
+        {
+            pxCertPkCtx = &( pxCertCtx->MBEDTLS_PRIVATE( pk ) );
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        int lRslt = lValidateCertByProfile( pxConfig, pxCertCtx );
+
+        if( lRslt != 0 )
+        {
+            vLogCertificateVerifyResult( lRslt );
+
+            xStatus = TLS_TRANSPORT_CLIENT_CERT_INVALID;
+        }
+        else
+        {
+            vLogCertInfo( pxCertCtx, "Client Certificate:" );
+        }
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        configASSERT( pxCertPkCtx );
+        configASSERT( pxPkCtx );
+
+        if( !( mbedtls_pk_can_do( pxCertPkCtx, MBEDTLS_PK_ECDSA ) &&
+               mbedtls_pk_can_do( pxPkCtx, MBEDTLS_PK_ECDSA ) ) &&
+            !( mbedtls_pk_can_do( pxCertPkCtx, MBEDTLS_PK_RSA ) &&
+               mbedtls_pk_can_do( pxPkCtx, MBEDTLS_PK_RSA ) ) )
+        {
+            LogError( "Private key and client certificate have mismatched key types." );
+            xStatus = TLS_TRANSPORT_INVALID_CREDENTIALS;
+        }
+    }
+
+    /* Validate that the cert and pk match. */
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        mbedtls_pk_context xTempPubKeyCtx;
+
+        xTempPubKeyCtx.pk_ctx = pxCertPkCtx->pk_ctx;
+        xTempPubKeyCtx.pk_info = pxPkCtx->pk_info;
+
+        int lError = mbedtls_pk_check_pair( &xTempPubKeyCtx, pxPkCtx,
+                                            pxConfig->xSslConfig.f_rng,
+                                            pxConfig->xSslConfig.p_rng );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Public-Private keypair does not match the provided certificate." );
+
+        xStatus = ( lError == 0 ) ? TLS_TRANSPORT_SUCCESS : TLS_TRANSPORT_INVALID_CREDENTIALS;
+    }
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        int lError = mbedtls_ssl_conf_own_cert( &( pxConfig->xSslConfig ),
+                                                pxCertCtx, pxPkCtx );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to configure TLS client certificate " );
+
+        xStatus = ( lError == 0 ) ? TLS_TRANSPORT_SUCCESS : TLS_TRANSPORT_INVALID_CREDENTIALS;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t xConfigureCAChain( TlsTransportConfig_t * pxConfig,
+                                               const PkiObject_t * pxRootCaCerts,
+                                               const size_t uxNumRootCA )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+
+    mbedtls_x509_crt * pxRootCertIterator = NULL;
+    mbedtls_x509_crt * pxRootCaChain = NULL;
+    size_t uxValidCertCount = 0;
+    int lError = 0;
+
+    configASSERT( pxConfig );
+    configASSERT( pxRootCaCerts );
+    configASSERT( uxNumRootCA );
+
+    pxRootCaChain = &( pxConfig->xRootCaChain );
+
+    for( size_t uxIdx = 0; uxIdx < uxNumRootCA; uxIdx++ )
+    {
+        const PkiObject_t * pxRootCert = &( pxRootCaCerts[ uxIdx ] );
+        mbedtls_x509_crt * pxTempCaCert = NULL;
+
+        /* Heap allocate all but the first mbedtls_x509_crt object */
+        if( pxRootCertIterator == NULL )
+        {
+            pxTempCaCert = pxRootCaChain;
+        }
+        else
+        {
+            pxTempCaCert = mbedtls_calloc( 1, sizeof( mbedtls_x509_crt ) );
+        }
+
+        /* If heap allocation failed, break out of loop */
+        if( pxTempCaCert == NULL )
+        {
+            LogError( "Failed to allocate memory for mbedtls_x509_crt object." );
+            lError = MBEDTLS_ERR_X509_ALLOC_FAILED;
+        }
+        else
+        {
+            mbedtls_x509_crt_init( pxTempCaCert );
+
+            /* load the certificate onto the heap */
+            lError = xPkiReadCertificate( pxTempCaCert, pxRootCert );
+
+            MBEDTLS_LOG_IF_ERROR( lError, "Failed to load the CA Certificate at index: %ld, Error: ", uxIdx );
+        }
+
+        if( lError == 0 )
+        {
+            lError = lValidateCertByProfile( pxConfig, pxTempCaCert );
+
+            if( lError != 0 )
+            {
+#if !defined( MBEDTLS_X509_REMOVE_INFO )
+                LogError( "Failed to validate the CA Certificate at index: %ld. Reason: %s", uxIdx,
+                          pcGetVerifyInfoString( lError ) );
+#else /* !defined( MBEDTLS_X509_REMOVE_INFO ) */
+                LogError( "Failed to validate the CA Certificate at index: %ld.", uxIdx );
+#endif
+            }
+        }
+
+        if( lError == 0 )
+        {
+            vLogCertInfo( pxTempCaCert, "CA Certificate: " );
+
+            /* Append to the list */
+            if( pxRootCertIterator != NULL )
+            {
+                pxRootCertIterator->MBEDTLS_PRIVATE( next ) = pxTempCaCert;
+            }
+
+            pxRootCertIterator = pxTempCaCert;
+            uxValidCertCount++;
+        }
+        /* Otherwise, handle the error */
+        else if( pxTempCaCert != NULL )
+        {
+            /* Free any allocated data */
+            mbedtls_x509_crt_free( pxTempCaCert );
+
+            /* Free pxTempCaCert if it is heap allocated (not first in list) */
+            if( pxRootCertIterator != NULL )
+            {
+                mbedtls_free( pxTempCaCert );
+            }
+        }
+
+        /* Break on memory allocation failure */
+        if( lError == MBEDTLS_ERR_X509_ALLOC_FAILED )
+        {
+            break;
+        }
+    }
+
+    xStatus = lMbedtlsErrToTransportError( lError );
+
+    if( ( uxValidCertCount == 0 ) &&
+        ( lError != MBEDTLS_ERR_X509_ALLOC_FAILED ) )
+    {
+        LogError( "Failed to load any valid Root CA Certificates." );
+        xStatus = TLS_TRANSPORT_NO_VALID_CA_CERT;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTlsConfigInit( TlsTransportConfig_t * pxConfig )
+{
+    configASSERT( pxConfig );
+
+    mbedtls_ssl_config_init( &( pxConfig->xSslConfig ) );
+    mbedtls_x509_crt_init( &( pxConfig->xRootCaChain ) );
+    mbedtls_x509_crt_init( &( pxConfig->xClientCert ) );
+    mbedtls_pk_init( &( pxConfig->xPkCtx ) );
+    mbedtls_entropy_init( &( pxConfig->xEntropyCtx ) );
+
+#ifdef TRANSPORT_USE_CTR_DRBG
+    mbedtls_ctr_drbg_init( &( pxConfig->xCtrDrbgCtx ) );
+#endif /* TRANSPORT_USE_CTR_DRBG */
+
+    pxConfig->xTls13Disabled = pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTlsConfigFree( TlsTransportConfig_t * pxConfig )
+{
+    configASSERT( pxConfig );
+
+    mbedtls_ssl_config_free( &( pxConfig->xSslConfig ) );
+    mbedtls_x509_crt_free( &( pxConfig->xRootCaChain ) );
+    mbedtls_x509_crt_free( &( pxConfig->xClientCert ) );
+    mbedtls_pk_free( &( pxConfig->xPkCtx ) );
+    mbedtls_entropy_free( &( pxConfig->xEntropyCtx ) );
+
+#ifdef TRANSPORT_USE_CTR_DRBG
+    mbedtls_ctr_drbg_free( &( pxConfig->xCtrDrbgCtx ) );
+#endif /* TRANSPORT_USE_CTR_DRBG */
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * mbedtls 3.1 rejects a configuration which enables both TLS 1.2 and TLS 1.3
+ * with MBEDTLS_ERR_SSL_BAD_CONFIG in mbedtls_ssl_setup, so exactly one version
+ * is offered at a time. In TLS_TRANSPORT_TLS13_PREFERRED mode, the first
+ * attempt offers TLS 1.3 only and lTlsConfigFallbackToTls12 switches to TLS 1.2
+ * only for the retry.
+ */
+void vTlsConfigSetVersion( TlsTransportConfig_t * pxConfig,
+                           BaseType_t xAllowTls13 )
+{
+    mbedtls_ssl_config * pxSslConfig = &( pxConfig->xSslConfig );
+    int lMinorVersion = MBEDTLS_SSL_MINOR_VERSION_3;
+
+#if TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_REQUIRED
+    ( void ) xAllowTls13;
+
+    lMinorVersion = MBEDTLS_SSL_MINOR_VERSION_4;
+#elif TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_PREFERRED
+    if( xAllowTls13 == pdTRUE )
+    {
+        lMinorVersion = MBEDTLS_SSL_MINOR_VERSION_4;
+    }
+#else
+    ( void ) xAllowTls13;
+#endif /* TLS_TRANSPORT_TLS13_MODE == TLS_TRANSPORT_TLS13_REQUIRED */
+
+    mbedtls_ssl_conf_min_version( pxSslConfig,
+                                  MBEDTLS_SSL_MAJOR_VERSION_3,
+                                  lMinorVersion );
+
+    mbedtls_ssl_conf_max_version( pxSslConfig,
+                                  MBEDTLS_SSL_MAJOR_VERSION_3,
+                                  lMinorVersion );
+}
+
+/*-----------------------------------------------------------*/
+
+int lTlsConfigFallbackToTls12( TlsTransportConfig_t * pxConfig,
+                               mbedtls_ssl_context * pxSslCtx,
+                               const char * pcHostName )
+{
+    void * pvBioCtx = pxSslCtx->MBEDTLS_PRIVATE( p_bio );
+    mbedtls_ssl_send_t * pxBioSend = pxSslCtx->MBEDTLS_PRIVATE( f_send );
+    mbedtls_ssl_recv_t * pxBioRecv = pxSslCtx->MBEDTLS_PRIVATE( f_recv );
+    int lError = 0;
+
+    pxConfig->xTls13Disabled = pdTRUE;
+
+    vTlsConfigSetVersion( pxConfig, pdFALSE );
+
+    /* The protocol version is only validated by mbedtls_ssl_setup, so set up the ssl context again. */
+    mbedtls_ssl_free( pxSslCtx );
+    mbedtls_ssl_init( pxSslCtx );
+
+    lError = mbedtls_ssl_setup( pxSslCtx, &( pxConfig->xSslConfig ) );
+
+    MBEDTLS_MSG_IF_ERROR( lError, "Call to mbedtls_ssl_setup failed, " );
+
+    if( lError == 0 )
+    {
+        mbedtls_ssl_set_bio( pxSslCtx, pvBioCtx, pxBioSend, pxBioRecv, NULL );
+
+        lError = mbedtls_ssl_set_hostname( pxSslCtx, pcHostName );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to set server hostname: Error:" );
+    }
+
+    return lError;
+}
+
+/*-----------------------------------------------------------*/
+
+TlsTransportStatus_t xTlsConfigSetup( TlsTransportConfig_t * pxConfig,
+                                      BaseType_t xReconfigure,
+                                      const char ** ppcAlpnProtos,
+                                      const PkiObject_t * pxPrivateKey,
+                                      const PkiObject_t * pxClientCert,
+                                      const PkiObject_t * pxRootCaCerts,
+                                      size_t uxNumRootCA )
+{
+    mbedtls_ssl_config * pxSslConfig = NULL;
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_SUCCESS;
+    int lError = 0;
+
+    configASSERT( pxConfig );
+    configASSERT( pxRootCaCerts );
+    configASSERT( uxNumRootCA > 0 );
+
+    pxSslConfig = &( pxConfig->xSslConfig );
+
+    /* Reset all contexts if this is a reconfiguration */
+    if( xReconfigure == pdTRUE )
+    {
+        vTlsConfigFree( pxConfig );
+        vTlsConfigInit( pxConfig );
+    }
+
+#ifdef MBEDTLS_TRANSPORT_PSA
+    if( psa_crypto_init() != PSA_SUCCESS )
+    {
+        LogError( "Failed to initialize PSA crypto interface." );
+
+        xStatus = TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+#endif /* MBEDTLS_TRANSPORT_PSA */
+
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        /* Initialize SSL Config from defaults */
+        lError = mbedtls_ssl_config_defaults( pxSslConfig,
+                                              MBEDTLS_SSL_IS_CLIENT,
+                                              MBEDTLS_SSL_TRANSPORT_STREAM,
+                                              MBEDTLS_SSL_PRESET_DEFAULT );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to initialize ssl configuration: Error:" );
+
+        xStatus = lMbedtlsErrToTransportError( lError );
+    }
+
+#ifdef MBEDTLS_DEBUG_C
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        mbedtls_ssl_conf_dbg( pxSslConfig, vTLSDebugPrint, NULL );
+        mbedtls_debug_set_threshold( MBEDTLS_DEBUG_THRESHOLD );
+    }
+#endif /* MBEDTLS_DEBUG_C */
+
+    /* Setup entropy / rng contexts */
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+#ifdef TRANSPORT_USE_CTR_DRBG
+        /* Seed the local RNG. */
+        lError = mbedtls_ctr_drbg_seed( &( pxConfig->xCtrDrbgCtx ),
+                                        mbedtls_entropy_func,
+                                        &( pxConfig->xEntropyCtx ),
+                                        NULL,
+                                        0 );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to seed PRNG: Error:" );
+
+        mbedtls_ssl_conf_rng( pxSslConfig,
+                              mbedtls_ctr_drbg_random,
+                              &( pxConfig->xCtrDrbgCtx ) );
+#elif defined( MBEDTLS_TRANSPORT_PSA )
+        mbedtls_ssl_conf_rng( pxSslConfig,
+                              lPSARandomCallback,
+                              NULL );
+#else /* ifdef TRANSPORT_USE_CTR_DRBG */
+        mbedtls_ssl_conf_rng( pxSslConfig,
+                              mbedtls_entropy_func,
+                              &( pxConfig->xEntropyCtx ) );
+#endif /* ifdef TRANSPORT_USE_CTR_DRBG */
+
+        xStatus = ( lError == 0 ) ? TLS_TRANSPORT_SUCCESS : TLS_TRANSPORT_INTERNAL_ERROR;
+    }
+
+    /* Configure security level settings */
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        pxConfig->xTls13Disabled = pdFALSE;
+
+        vTlsConfigSetVersion( pxConfig, pdTRUE );
+
+        mbedtls_ssl_conf_cert_profile( pxSslConfig, &mbedtls_x509_crt_profile_default );
+
+        mbedtls_ssl_conf_authmode( pxSslConfig, MBEDTLS_SSL_VERIFY_REQUIRED );
+    }
+
+    /* Configure certificate auth if a cert and key were provided */
+    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
+        pxPrivateKey && pxClientCert )
+    {
+        xStatus = xConfigureCertificateAuth( pxConfig, pxPrivateKey, pxClientCert );
+    }
+
+    /* Configure ALPN Protocols */
+    if( ( xStatus == TLS_TRANSPORT_SUCCESS ) &&
+        ppcAlpnProtos )
+    {
+        /* Include an application protocol list in the TLS ClientHello
+         * message. */
+        lError = mbedtls_ssl_conf_alpn_protocols( pxSslConfig, ppcAlpnProtos );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to configure ALPN protocols: " );
+
+        xStatus = lMbedtlsErrToTransportError( lError );
+    }
+
+    /* Set Maximum Fragment Length if enabled. */
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        /* Enable the max fragment extension. 4096 bytes is currently the largest fragment size permitted.
+         * See RFC 8449 https://tools.ietf.org/html/rfc8449 for more information.
+         *
+         * Smaller values can be found in "mbedtls/include/ssl.h".
+         */
+        lError = mbedtls_ssl_conf_max_frag_len( pxSslConfig, TLS_TRANSPORT_MAX_FRAG_LEN );
+
+        MBEDTLS_MSG_IF_ERROR( lError, "Failed to configure maximum fragment length extension, " );
+        xStatus = lMbedtlsErrToTransportError( lError );
+    }
+#endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+
+    /* Load CA certificate chain. */
+    if( xStatus == TLS_TRANSPORT_SUCCESS )
+    {
+        xStatus = xConfigureCAChain( pxConfig, pxRootCaCerts, uxNumRootCA );
+
+        mbedtls_ssl_conf_ca_chain( pxSslConfig, &( pxConfig->xRootCaChain ), NULL );
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTlsGetSslBufferLengths( const mbedtls_ssl_context * pxSslCtx,
+                              size_t * puxInBufLen,
+                              size_t * puxOutBufLen )
+{
+#if defined( MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH )
+    *puxInBufLen = pxSslCtx->MBEDTLS_PRIVATE( in_buf_len );
+    *puxOutBufLen = pxSslCtx->MBEDTLS_PRIVATE( out_buf_len );
+#else
+    ( void ) pxSslCtx;
+
+    /* Buffers are allocated with a fixed size in mbedtls_ssl_setup. Record overhead is not included. */
+    *puxInBufLen = MBEDTLS_SSL_IN_CONTENT_LEN;
+    *puxOutBufLen = MBEDTLS_SSL_OUT_CONTENT_LEN;
+#endif /* MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH */
+}
+
+/*-----------------------------------------------------------*/
+
+size_t uxTlsMemUsageHandshakeStart( const mbedtls_ssl_context * pxSslCtx,
+                                    TlsTransportMemUsage_t * pxMemUsage )
+{
+    vTlsGetSslBufferLengths( pxSslCtx,
+                             &( pxMemUsage->uxHandshakeInBufLen ),
+                             &( pxMemUsage->uxHandshakeOutBufLen ) );
+
+    return xPortGetFreeHeapSize();
+}
+
+/*-----------------------------------------------------------*/
+
+void vTlsMemUsageHandshakeDone( const mbedtls_ssl_context * pxSslCtx,
+                                TlsTransportMemUsage_t * pxMemUsage,
+                                size_t uxFreeHeapBefore,
+                                const void * pvConnection )
+{
+    size_t uxFreeHeapAfter = xPortGetFreeHeapSize();
+
+    vTlsGetSslBufferLengths( pxSslCtx,
+                             &( pxMemUsage->uxInBufLen ),
+                             &( pxMemUsage->uxOutBufLen ) );
+
+    pxMemUsage->lSessionHeapDelta = ( int32_t ) uxFreeHeapBefore - ( int32_t ) uxFreeHeapAfter;
+
+    LogInfo( "Network connection %p: TLS buffers in: %lu -> %lu bytes, out: %lu -> %lu bytes, session heap: %ld bytes.",
+             pvConnection,
+             ( unsigned long ) pxMemUsage->uxHandshakeInBufLen, ( unsigned long ) pxMemUsage->uxInBufLen,
+             ( unsigned long ) pxMemUsage->uxHandshakeOutBufLen, ( unsigned long ) pxMemUsage->uxOutBufLen,
+             ( long ) pxMemUsage->lSessionHeapDelta );
+
+#if defined( MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH ) && defined( MBEDTLS_SSL_MAX_FRAGMENT_LENGTH )
+    if( mbedtls_ssl_get_output_max_frag_len( pxSslCtx ) >= MBEDTLS_SSL_OUT_CONTENT_LEN )
+    {
+        LogWarn( "Network connection %p: Maximum fragment length was not negotiated. TLS buffers remain at full size.",
+                 pvConnection );
+    }
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+void vTlsLogHandshakeInfo( const mbedtls_ssl_context * pxSslCtx,
+                           TlsTransportHandshakeInfo_t * pxHandshakeInfo,
+                           const void * pvConnection )
+{
+    pxHandshakeInfo->lTlsMinorVersion = pxSslCtx->MBEDTLS_PRIVATE( minor_ver );
+
+    LogInfo( "Network connection %p: Negotiated %s with %s. Connect: %lu ms, handshake: %lu ms%s.",
+             pvConnection,
+             mbedtls_ssl_get_version( pxSslCtx ),
+             mbedtls_ssl_get_ciphersuite( pxSslCtx ),
+             ( unsigned long ) pxHandshakeInfo->ulConnectTimeMs,
+             ( unsigned long ) pxHandshakeInfo->ulHandshakeTimeMs,
+             ( pxHandshakeInfo->xFallback == pdTRUE ) ? " (after TLS 1.3 fallback)" : "" );
+}
+
+/*-----------------------------------------------------------*/
+
+#ifdef MBEDTLS_DEBUG_C
+static inline const char * pcMbedtlsLevelToFrLevel( int lLevel )
+{
+    const char * pcFrLogLevel;
+
+    switch( lLevel )
+    {
+        case 1:
+            pcFrLogLevel = "ERR";
+            break;
+
+        case 2:
+        case 3:
+            pcFrLogLevel = "INF";
+            break;
+
+        case 4:
+        default:
+            pcFrLogLevel = "DBG";
+            break;
+    }
+
+    return pcFrLogLevel;
+}
+
+/*-------------------------------------------------------*/
+
+static inline const char * pcPathToBasename( const char * pcFileName )
+{
+    const char * pcIter = pcFileName;
+    const char * pcBasename = pcFileName;
+
+    /* Extract basename from file name */
+    while( *pcIter != '\0' )
+    {
+        if( ( *pcIter == '/' ) || ( *pcIter == '\\' ) )
+        {
+            pcBasename = pcIter + 1;
+        }
+
+        pcIter++;
+    }
+
+    return pcBasename;
+}
+
+/*-------------------------------------------------------*/
+
+static void vTLSDebugPrint( void * ctx,
+                            int lLevel,
+                            const char * pcFileName,
+                            int lLineNumber,
+                            const char * pcErrStr )
+{
+    const char * pcLogLevel;
+    const char * pcFileBaseName;
+
+    ( void ) ctx;
+
+    pcLogLevel = pcMbedtlsLevelToFrLevel( lLevel );
+    pcFileBaseName = pcPathToBasename( pcFileName );
+
+    vLoggingPrintf( pcLogLevel, pcFileBaseName, lLineNumber, pcErrStr );
+}
+#endif /* ifdef MBEDTLS_DEBUG_C */
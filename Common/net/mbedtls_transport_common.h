@@ -0,0 +1,171 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2021 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mbedtls_transport_common.h
+ * @brief TLS configuration shared by the socket and altcp mbedtls transports.
+ */
+
+#ifndef _MBEDTLS_TRANSPORT_COMMON_H
+#define _MBEDTLS_TRANSPORT_COMMON_H
+
+#include "mbedtls_transport.h"
+
+/*
+ * Maximum fragment length requested from the server. When
+ * MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH is enabled, the TLS I/O buffers are
+ * shrunk to this size once the handshake completes.
+ */
+#ifndef TLS_TRANSPORT_MAX_FRAG_LEN
+#define TLS_TRANSPORT_MAX_FRAG_LEN    MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#endif
+
+#ifndef TLS_TRANSPORT_TLS13_MODE
+#define TLS_TRANSPORT_TLS13_MODE    TLS_TRANSPORT_TLS13_DISABLED
+#endif
+
+#if ( TLS_TRANSPORT_TLS13_MODE != TLS_TRANSPORT_TLS13_DISABLED ) && !defined( MBEDTLS_SSL_PROTO_TLS1_3_EXPERIMENTAL )
+#error "TLS_TRANSPORT_TLS13_MODE requires MBEDTLS_SSL_PROTO_TLS1_3_EXPERIMENTAL"
+#endif
+
+/**
+ * @brief mbedtls configuration and credentials of a TLS transport context.
+ */
+typedef struct TlsTransportConfig
+{
+    /* TLS connection */
+    mbedtls_ssl_config xSslConfig;
+
+    /* Certificates */
+    mbedtls_x509_crt xRootCaChain;
+    mbedtls_x509_crt xClientCert;
+
+    /* Private Key */
+    mbedtls_pk_context xPkCtx;
+
+    /* Entropy Ctx */
+    mbedtls_entropy_context xEntropyCtx;
+
+#ifdef TRANSPORT_USE_CTR_DRBG
+    mbedtls_ctr_drbg_context xCtrDrbgCtx;
+#endif /* TRANSPORT_USE_CTR_DRBG */
+
+    /* Set once a TLS 1.3 handshake has failed, until the context is reconfigured */
+    BaseType_t xTls13Disabled;
+} TlsTransportConfig_t;
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Initialize the mbedtls objects of a TLS configuration.
+ */
+void vTlsConfigInit( TlsTransportConfig_t * pxConfig );
+
+/**
+ * @brief Free the mbedtls objects of a TLS configuration.
+ */
+void vTlsConfigFree( TlsTransportConfig_t * pxConfig );
+
+/**
+ * @brief Set up the rng, protocol versions, credentials, ALPN protocols and
+ * maximum fragment length of a TLS client configuration.
+ *
+ * Any ssl context which refers to the configuration must be freed before the
+ * configuration is set up again.
+ *
+ * @param[in] pxConfig Configuration to set up.
+ * @param[in] xReconfigure pdTRUE if the configuration has been set up before.
+ * @param[in] ppcAlpnProtos NULL terminated list of ALPN protocols, or NULL.
+ * @param[in] pxPrivateKey Client private key, or NULL.
+ * @param[in] pxClientCert Client certificate, or NULL.
+ * @param[in] pxRootCaCerts Array of trusted root CA certificates.
+ * @param[in] uxNumRootCA Number of entries in pxRootCaCerts.
+ *
+ * @return #TLS_TRANSPORT_SUCCESS or a negative TlsTransportStatus_t on failure.
+ */
+TlsTransportStatus_t xTlsConfigSetup( TlsTransportConfig_t * pxConfig,
+                                      BaseType_t xReconfigure,
+                                      const char ** ppcAlpnProtos,
+                                      const PkiObject_t * pxPrivateKey,
+                                      const PkiObject_t * pxClientCert,
+                                      const PkiObject_t * pxRootCaCerts,
+                                      size_t uxNumRootCA );
+
+/**
+ * @brief Set the range of protocol versions offered according to TLS_TRANSPORT_TLS13_MODE.
+ *
+ * @param[in] pxConfig Configuration to update.
+ * @param[in] xAllowTls13 pdFALSE to offer TLS 1.2 only after a failed TLS 1.3 handshake.
+ * Only used in TLS_TRANSPORT_TLS13_PREFERRED mode.
+ */
+void vTlsConfigSetVersion( TlsTransportConfig_t * pxConfig,
+                           BaseType_t xAllowTls13 );
+
+/**
+ * @brief Switch a configuration to TLS 1.2 only after a failed TLS 1.3 handshake.
+ *
+ * The ssl context is set up again with the same bio callbacks and server
+ * hostname. The configuration offers TLS 1.2 only until it is set up again
+ * with xTlsConfigSetup.
+ *
+ * @return 0 on success, or an mbedtls error code.
+ */
+int lTlsConfigFallbackToTls12( TlsTransportConfig_t * pxConfig,
+                               mbedtls_ssl_context * pxSslCtx,
+                               const char * pcHostName );
+
+/**
+ * @brief Convert an mbedtls error code to a TlsTransportStatus_t.
+ */
+int32_t lMbedtlsErrToTransportError( int32_t lError );
+
+/**
+ * @brief Get the current size of the TLS input and output buffers of an ssl context.
+ */
+void vTlsGetSslBufferLengths( const mbedtls_ssl_context * pxSslCtx,
+                              size_t * puxInBufLen,
+                              size_t * puxOutBufLen );
+
+/**
+ * @brief Record the buffer sizes in use at the start of a handshake.
+ *
+ * @return The free heap size, to be passed to vTlsMemUsageHandshakeDone.
+ */
+size_t uxTlsMemUsageHandshakeStart( const mbedtls_ssl_context * pxSslCtx,
+                                    TlsTransportMemUsage_t * pxMemUsage );
+
+/**
+ * @brief Record and log the buffer sizes and session heap after a successful handshake.
+ */
+void vTlsMemUsageHandshakeDone( const mbedtls_ssl_context * pxSslCtx,
+                                TlsTransportMemUsage_t * pxMemUsage,
+                                size_t uxFreeHeapBefore,
+                                const void * pvConnection );
+
+/**
+ * @brief Record and log the negotiated protocol version and ciphersuite.
+ */
+void vTlsLogHandshakeInfo( const mbedtls_ssl_context * pxSslCtx,
+                           TlsTransportHandshakeInfo_t * pxHandshakeInfo,
+                           const void * pvConnection );
+
+#endif /* _MBEDTLS_TRANSPORT_COMMON_H */
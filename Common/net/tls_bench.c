@@ -0,0 +1,426 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tls_bench.c
+ * @brief TLS transport benchmark client. See tls_bench.h for the request protocol.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_ERROR
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "rtos_time.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tls_bench.h"
+
+#define TLS_BENCH_PINGPONG_COUNT    100U
+#define TLS_BENCH_TIMEOUT_MS        10000U
+#define TLS_BENCH_MAX_CHUNK_LEN     4096U
+#define TLS_BENCH_LINE_LEN          256U
+
+static const uint32_t pulRecordSizes[] = { 64U, 256U, 1024U, TLS_BENCH_MAX_CHUNK_LEN };
+static const uint32_t pulMessageSizes[] = { 16U, 128U };
+
+static char pcLineBuffer[ TLS_BENCH_LINE_LEN ];
+
+/*-----------------------------------------------------------*/
+
+static void prvOutputResult( TlsBenchOutput_t xOutput,
+                             int lLen )
+{
+    if( ( lLen > 0 ) &&
+        ( lLen < ( int ) TLS_BENCH_LINE_LEN ) )
+    {
+        xOutput( pcLineBuffer );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvBytesPerSecond( uint32_t ulBytes,
+                                   uint32_t ulElapsedMs )
+{
+    if( ulElapsedMs == 0 )
+    {
+        ulElapsedMs = 1;
+    }
+
+    return ( uint32_t ) ( ( ( uint64_t ) ulBytes * 1000ULL ) / ulElapsedMs );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * mbedtls_transport_send and mbedtls_transport_recv return 0 when the socket
+ * or TLS layer could not make progress within the socket timeout. Only give up
+ * once no data has moved for TLS_BENCH_TIMEOUT_MS.
+ */
+static BaseType_t prvSendAll( NetworkContext_t * pxNetworkContext,
+                              const uint8_t * pucData,
+                              size_t uxLen )
+{
+    BaseType_t xSuccess = pdTRUE;
+    uint32_t ulLastProgressMs = ulGetTimeMs();
+
+    while( ( uxLen > 0 ) && ( xSuccess == pdTRUE ) )
+    {
+        int32_t lSent = mbedtls_transport_send( pxNetworkContext, pucData, uxLen );
+
+        if( lSent > 0 )
+        {
+            pucData += lSent;
+            uxLen -= ( size_t ) lSent;
+            ulLastProgressMs = ulGetTimeMs();
+        }
+        else if( lSent < 0 )
+        {
+            LogError( "Send failed: %ld", lSent );
+            xSuccess = pdFALSE;
+        }
+        else if( ( ulGetTimeMs() - ulLastProgressMs ) >= TLS_BENCH_TIMEOUT_MS )
+        {
+            LogError( "Send timed out with %lu bytes remaining.", ( unsigned long ) uxLen );
+            xSuccess = pdFALSE;
+        }
+        else
+        {
+            /* Nothing sent, try again. */
+        }
+    }
+
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRecvAll( NetworkContext_t * pxNetworkContext,
+                              uint8_t * pucData,
+                              size_t uxLen )
+{
+    BaseType_t xSuccess = pdTRUE;
+    uint32_t ulLastProgressMs = ulGetTimeMs();
+
+    while( ( uxLen > 0 ) && ( xSuccess == pdTRUE ) )
+    {
+        int32_t lRecvd = mbedtls_transport_recv( pxNetworkContext, pucData, uxLen );
+
+        if( lRecvd > 0 )
+        {
+            pucData += lRecvd;
+            uxLen -= ( size_t ) lRecvd;
+            ulLastProgressMs = ulGetTimeMs();
+        }
+        else if( lRecvd < 0 )
+        {
+            LogError( "Receive failed: %ld", lRecvd );
+            xSuccess = pdFALSE;
+        }
+        else if( ( ulGetTimeMs() - ulLastProgressMs ) >= TLS_BENCH_TIMEOUT_MS )
+        {
+            LogError( "Receive timed out with %lu bytes remaining.", ( unsigned long ) uxLen );
+            xSuccess = pdFALSE;
+        }
+        else
+        {
+            /* No data available yet, try again. */
+        }
+    }
+
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSendRequest( NetworkContext_t * pxNetworkContext,
+                                  char cRequest,
+                                  uint32_t ulArg1,
+                                  uint32_t ulArg2 )
+{
+    char pcRequest[ 32 ];
+    int lLen = snprintf( pcRequest, sizeof( pcRequest ), "%c %lu %lu\n", cRequest,
+                         ( unsigned long ) ulArg1, ( unsigned long ) ulArg2 );
+
+    configASSERT( ( lLen > 0 ) && ( lLen < ( int ) sizeof( pcRequest ) ) );
+
+    return prvSendAll( pxNetworkContext, ( const uint8_t * ) pcRequest, ( size_t ) lLen );
+}
+
+/*-----------------------------------------------------------*/
+
+static TlsTransportStatus_t prvConnect( NetworkContext_t * pxNetworkContext,
+                                        const char * pcHost,
+                                        uint16_t usPort )
+{
+    return mbedtls_transport_connect( pxNetworkContext, pcHost, usPort,
+                                      TLS_BENCH_TIMEOUT_MS, TLS_BENCH_TIMEOUT_MS );
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvBenchHandshake( TlsBenchOutput_t xOutput,
+                                     NetworkContext_t * pxNetworkContext,
+                                     const char * pcHost,
+                                     uint16_t usPort,
+                                     uint32_t ulIterations )
+{
+    BaseType_t xSuccess = pdTRUE;
+    TlsTransportHandshakeInfo_t xInfo = { 0 };
+    uint32_t ulMin = UINT32_MAX;
+    uint32_t ulMax = 0;
+    uint32_t ulTotal = 0;
+    uint32_t ulConnectTotal = 0;
+    uint32_t ulCompleted = 0;
+
+    for( uint32_t i = 0; ( i < ulIterations ) && ( xSuccess == pdTRUE ); i++ )
+    {
+        if( prvConnect( pxNetworkContext, pcHost, usPort ) != TLS_TRANSPORT_SUCCESS )
+        {
+            xSuccess = pdFALSE;
+        }
+        else
+        {
+            ( void ) mbedtls_transport_get_handshake_info( pxNetworkContext, &xInfo );
+            mbedtls_transport_disconnect( pxNetworkContext );
+
+            ulMin = ( xInfo.ulHandshakeTimeMs < ulMin ) ? xInfo.ulHandshakeTimeMs : ulMin;
+            ulMax = ( xInfo.ulHandshakeTimeMs > ulMax ) ? xInfo.ulHandshakeTimeMs : ulMax;
+            ulTotal += xInfo.ulHandshakeTimeMs;
+            ulConnectTotal += xInfo.ulConnectTimeMs;
+            ulCompleted++;
+        }
+    }
+
+    if( ulCompleted > 0 )
+    {
+        prvOutputResult( xOutput,
+                         snprintf( pcLineBuffer, TLS_BENCH_LINE_LEN,
+                                   "{\"test\":\"handshake\",\"count\":%lu,\"tls_minor_version\":%ld,"
+                                   "\"connect_ms_avg\":%lu,\"handshake_ms_min\":%lu,"
+                                   "\"handshake_ms_avg\":%lu,\"handshake_ms_max\":%lu}\r\n",
+                                   ( unsigned long ) ulCompleted, ( long ) xInfo.lTlsMinorVersion,
+                                   ( unsigned long ) ( ulConnectTotal / ulCompleted ),
+                                   ( unsigned long ) ulMin,
+                                   ( unsigned long ) ( ulTotal / ulCompleted ),
+                                   ( unsigned long ) ulMax ) );
+    }
+
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvBenchBulk( TlsBenchOutput_t xOutput,
+                                NetworkContext_t * pxNetworkContext,
+                                uint8_t * pucBuffer,
+                                uint32_t ulRecordSize,
+                                uint32_t ulBulkLen )
+{
+    BaseType_t xSuccess;
+    uint32_t ulStartMs;
+    uint32_t ulSendMs = 0;
+    uint32_t ulRecvMs = 0;
+    uint32_t ulRemaining;
+    uint8_t ucAck[ 2 ];
+
+    /* Client to server */
+    ulStartMs = ulGetTimeMs();
+    xSuccess = prvSendRequest( pxNetworkContext, 'S', ulBulkLen, 0 );
+
+    for( ulRemaining = ulBulkLen; ( ulRemaining > 0 ) && ( xSuccess == pdTRUE ); )
+    {
+        uint32_t ulChunk = ( ulRemaining < ulRecordSize ) ? ulRemaining : ulRecordSize;
+
+        xSuccess = prvSendAll( pxNetworkContext, pucBuffer, ulChunk );
+        ulRemaining -= ulChunk;
+    }
+
+    if( xSuccess == pdTRUE )
+    {
+        xSuccess = prvRecvAll( pxNetworkContext, ucAck, sizeof( ucAck ) );
+        ulSendMs = ulGetTimeMs() - ulStartMs;
+    }
+
+    /* Server to client */
+    if( xSuccess == pdTRUE )
+    {
+        ulStartMs = ulGetTimeMs();
+        xSuccess = prvSendRequest( pxNetworkContext, 'E', ulBulkLen, 0 );
+
+        for( ulRemaining = ulBulkLen; ( ulRemaining > 0 ) && ( xSuccess == pdTRUE ); )
+        {
+            uint32_t ulChunk = ( ulRemaining < ulRecordSize ) ? ulRemaining : ulRecordSize;
+
+            xSuccess = prvRecvAll( pxNetworkContext, pucBuffer, ulChunk );
+            ulRemaining -= ulChunk;
+        }
+
+        ulRecvMs = ulGetTimeMs() - ulStartMs;
+    }
+
+    if( xSuccess == pdTRUE )
+    {
+        prvOutputResult( xOutput,
+                         snprintf( pcLineBuffer, TLS_BENCH_LINE_LEN,
+                                   "{\"test\":\"bulk\",\"record_size\":%lu,\"bytes\":%lu,"
+                                   "\"send_ms\":%lu,\"send_Bps\":%lu,\"recv_ms\":%lu,\"recv_Bps\":%lu}\r\n",
+                                   ( unsigned long ) ulRecordSize, ( unsigned long ) ulBulkLen,
+                                   ( unsigned long ) ulSendMs,
+                                   ( unsigned long ) prvBytesPerSecond( ulBulkLen, ulSendMs ),
+                                   ( unsigned long ) ulRecvMs,
+                                   ( unsigned long ) prvBytesPerSecond( ulBulkLen, ulRecvMs ) ) );
+    }
+
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvBenchPingPong( TlsBenchOutput_t xOutput,
+                                    NetworkContext_t * pxNetworkContext,
+                                    uint8_t * pucBuffer,
+                                    uint32_t ulMessageSize )
+{
+    BaseType_t xSuccess;
+    uint32_t ulStartMs = ulGetTimeMs();
+    uint32_t ulElapsedMs;
+    uint32_t ulCount = 0;
+
+    xSuccess = prvSendRequest( pxNetworkContext, 'P', ulMessageSize, TLS_BENCH_PINGPONG_COUNT );
+
+    while( ( ulCount < TLS_BENCH_PINGPONG_COUNT ) && ( xSuccess == pdTRUE ) )
+    {
+        xSuccess = prvSendAll( pxNetworkContext, pucBuffer, ulMessageSize );
+
+        if( xSuccess == pdTRUE )
+        {
+            xSuccess = prvRecvAll( pxNetworkContext, pucBuffer, ulMessageSize );
+            ulCount++;
+        }
+    }
+
+    ulElapsedMs = ulGetTimeMs() - ulStartMs;
+
+    if( ulElapsedMs == 0 )
+    {
+        ulElapsedMs = 1;
+    }
+
+    if( xSuccess == pdTRUE )
+    {
+        prvOutputResult( xOutput,
+                         snprintf( pcLineBuffer, TLS_BENCH_LINE_LEN,
+                                   "{\"test\":\"pingpong\",\"message_size\":%lu,\"count\":%lu,"
+                                   "\"elapsed_ms\":%lu,\"msgs_per_s\":%lu,\"rtt_us_avg\":%lu}\r\n",
+                                   ( unsigned long ) ulMessageSize, ( unsigned long ) ulCount,
+                                   ( unsigned long ) ulElapsedMs,
+                                   ( unsigned long ) ( ( ulCount * 1000UL ) / ulElapsedMs ),
+                                   ( unsigned long ) ( ( ( uint64_t ) ulElapsedMs * 1000ULL ) / ulCount ) ) );
+    }
+
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTlsBenchRun( NetworkContext_t * pxNetworkContext,
+                         const char * pcHost,
+                         uint16_t usPort,
+                         uint32_t ulHandshakes,
+                         uint32_t ulBulkLen,
+                         TlsBenchOutput_t xOutput )
+{
+    BaseType_t xSuccess;
+    uint8_t * pucBuffer = NULL;
+
+    configASSERT( pxNetworkContext != NULL );
+    configASSERT( pcHost != NULL );
+    configASSERT( xOutput != NULL );
+
+    xSuccess = prvBenchHandshake( xOutput, pxNetworkContext, pcHost, usPort, ulHandshakes );
+
+    if( xSuccess == pdTRUE )
+    {
+        pucBuffer = pvPortMalloc( TLS_BENCH_MAX_CHUNK_LEN );
+
+        if( pucBuffer == NULL )
+        {
+            LogError( "Failed to allocate benchmark buffer." );
+            xSuccess = pdFALSE;
+        }
+        else
+        {
+            ( void ) memset( pucBuffer, 0xA5, TLS_BENCH_MAX_CHUNK_LEN );
+        }
+    }
+
+    if( xSuccess == pdTRUE )
+    {
+        xSuccess = ( prvConnect( pxNetworkContext, pcHost, usPort ) == TLS_TRANSPORT_SUCCESS ) ? pdTRUE : pdFALSE;
+    }
+
+    if( xSuccess == pdTRUE )
+    {
+        TlsTransportStats_t xStats = { 0 };
+
+        for( size_t i = 0; ( i < ( sizeof( pulRecordSizes ) / sizeof( pulRecordSizes[ 0 ] ) ) ) && ( xSuccess == pdTRUE ); i++ )
+        {
+            xSuccess = prvBenchBulk( xOutput, pxNetworkContext, pucBuffer, pulRecordSizes[ i ], ulBulkLen );
+        }
+
+        for( size_t i = 0; ( i < ( sizeof( pulMessageSizes ) / sizeof( pulMessageSizes[ 0 ] ) ) ) && ( xSuccess == pdTRUE ); i++ )
+        {
+            xSuccess = prvBenchPingPong( xOutput, pxNetworkContext, pucBuffer, pulMessageSizes[ i ] );
+        }
+
+        if( ( xSuccess == pdTRUE ) &&
+            ( mbedtls_transport_get_stats( pxNetworkContext, &xStats ) == 0 ) )
+        {
+            prvOutputResult( xOutput,
+                             snprintf( pcLineBuffer, TLS_BENCH_LINE_LEN,
+                                       "{\"test\":\"stats\",\"records_sent\":%lu,\"records_received\":%lu,"
+                                       "\"send_stalls\":%lu,\"recv_want_read\":%lu,\"session_heap_bytes\":%ld}\r\n",
+                                       ( unsigned long ) xStats.ulRecordsSent,
+                                       ( unsigned long ) xStats.ulRecordsReceived,
+                                       ( unsigned long ) xStats.ulSendStalls,
+                                       ( unsigned long ) xStats.ulRecvWantRead,
+                                       ( long ) xStats.xMemUsage.lSessionHeapDelta ) );
+        }
+
+        mbedtls_transport_disconnect( pxNetworkContext );
+    }
+
+    if( pucBuffer != NULL )
+    {
+        vPortFree( pucBuffer );
+    }
+
+    return xSuccess;
+}
@@ -39,6 +39,13 @@ UART_HandleTypeDef * pxHndlUart1 = NULL;
 DCACHE_HandleTypeDef * pxHndlDCache = NULL;
 DMA_HandleTypeDef * pxHndlGpdmaCh4 = NULL;
 DMA_HandleTypeDef * pxHndlGpdmaCh5 = NULL;
+
+/* Set by the CRYP driver of the mbedtls accelerators when it first uses DMA */
+DMA_HandleTypeDef * pxHndlGpdmaCh6 = NULL;
+DMA_HandleTypeDef * pxHndlGpdmaCh7 = NULL;
+
+/* Set by the HASH driver of the mbedtls accelerators when it first uses DMA */
+DMA_HandleTypeDef * pxHndlGpdmaCh8 = NULL;
 #ifndef TFM_PSA_API
 RNG_HandleTypeDef * pxHndlRng = NULL;
 #endif /* ! defined( TFM_PSA_API ) */
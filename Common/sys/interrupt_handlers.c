@@ -162,6 +162,30 @@ void GPDMA1_Channel5_IRQHandler( void )
     }
 }
 
+void GPDMA1_Channel6_IRQHandler( void )
+{
+    if( pxHndlGpdmaCh6 != NULL )
+    {
+        HAL_DMA_IRQHandler( pxHndlGpdmaCh6 );
+    }
+}
+
+void GPDMA1_Channel7_IRQHandler( void )
+{
+    if( pxHndlGpdmaCh7 != NULL )
+    {
+        HAL_DMA_IRQHandler( pxHndlGpdmaCh7 );
+    }
+}
+
+void GPDMA1_Channel8_IRQHandler( void )
+{
+    if( pxHndlGpdmaCh8 != NULL )
+    {
+        HAL_DMA_IRQHandler( pxHndlGpdmaCh8 );
+    }
+}
+
 /* Handle TIM6 interrupt for STM32 HAL time base. */
 void TIM6_IRQHandler( void )
 {
@@ -34,6 +34,7 @@
 #include <string.h>
 #include "mbedtls/platform.h"
 #include "mbedtls/platform_util.h"
+#include "crypto_sched_stm32.h"
 
 /* Parameter validation macros based on platform_util.h */
 #define AES_VALIDATE_RET( cond )    \
@@ -129,8 +130,12 @@ static int aes_set_key(mbedtls_aes_context *ctx,
     }
 #endif
 
+    /* Wait for the CRYP: it is reset below */
+    (void) crypto_sched_acquire(&cryp_sched, ctx);
+
     /* Initializes the CRYP peripheral */
     if (HAL_CRYP_DeInit(&ctx->hcryp_aes) != HAL_OK) {
+        crypto_sched_release(&cryp_sched);
         return (MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
     }
 
@@ -143,12 +148,15 @@ static int aes_set_key(mbedtls_aes_context *ctx,
 #endif
 
     if (HAL_CRYP_Init(&ctx->hcryp_aes) != HAL_OK) {
+        crypto_sched_release(&cryp_sched);
         return (MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
     }
 
     /* allow multi-instance of CRYP use: save context for CRYP HW module CR */
     ctx->ctx_save_cr = ctx->hcryp_aes.Instance->CR;
 
+    crypto_sched_release(&cryp_sched);
+
     return (0);
 }
 
@@ -177,6 +185,7 @@ void mbedtls_aes_free(mbedtls_aes_context *ctx)
         return;
     }
 
+    crypto_sched_forget(&cryp_sched, ctx);
     mbedtls_zeroize(ctx, sizeof(mbedtls_aes_context));
 }
 
@@ -310,6 +319,9 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
     AES_VALIDATE_RET( mode == MBEDTLS_AES_ENCRYPT ||
                       mode == MBEDTLS_AES_DECRYPT );
 
+    /* Wait for the CRYP (the key is reloaded by every HAL_CRYP_Encrypt) */
+    (void) crypto_sched_acquire(&cryp_sched, ctx);
+
     /* allow multi-instance of CRYP use: restore context for CRYP hw module */
     ctx->hcryp_aes.Instance->CR = ctx->ctx_save_cr;
 
@@ -320,22 +332,28 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
 
         /* Configure the CRYP  */
         if (HAL_CRYP_SetConfig(&ctx->hcryp_aes, &ctx->hcryp_aes.Init) != HAL_OK)
-            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        {
+            ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+            goto exit;
+        }
     }
 
     if (mode == MBEDTLS_AES_DECRYPT) { /* AES decryption */
         ret = mbedtls_internal_aes_decrypt(ctx, input, output);
         if( ret != 0 )
-            return (ret);
+            goto exit;
     } else { /* AES encryption */
         ret = mbedtls_internal_aes_encrypt(ctx, input, output);
         if( ret != 0 )
-            return (ret);
+            goto exit;
     }
     /* allow multi-instance of CRYP use: save context for CRYP HW module CR */
     ctx->ctx_save_cr = ctx->hcryp_aes.Instance->CR;
 
-    return (0);
+exit:
+    crypto_sched_release(&cryp_sched);
+
+    return (ret);
 }
 
 #if defined(MBEDTLS_CIPHER_MODE_CBC)
@@ -359,7 +377,8 @@ static int st_cbc_restore_context(mbedtls_aes_context *ctx)
     return (0);
 }
 
-int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
+/* Process a chunk of the CBC buffer, with cryp_sched owned */
+static int st_cbc_process(mbedtls_aes_context *ctx,
                           int mode,
                           size_t length,
                           unsigned char iv[16],
@@ -369,17 +388,6 @@ int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
     __ALIGN_BEGIN static uint32_t iv_32B[4] __ALIGN_END;
     int ret = 0;
 
-    AES_VALIDATE_RET( ctx != NULL );
-    AES_VALIDATE_RET( mode == MBEDTLS_AES_ENCRYPT ||
-                      mode == MBEDTLS_AES_DECRYPT );
-    AES_VALIDATE_RET( iv != NULL );
-    AES_VALIDATE_RET( input != NULL );
-    AES_VALIDATE_RET( output != NULL );
-
-    if (length % 16) {
-        return (MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH);
-    }
-
     ret = st_cbc_restore_context(ctx);
     if (ret != 0)
         return (ret);
@@ -419,8 +427,8 @@ int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
             return (MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
         }
 
-        /* current output is the IV vector for the next call */
-        memcpy(iv, output, 16);
+        /* last output block is the IV vector for the next call */
+        memcpy(iv, output + length - 16, 16);
     }
 
     /* Save the internal IV vector for multi context purpose */
@@ -429,6 +437,50 @@ int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
 
     return (0);
 }
+
+int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
+                          int mode,
+                          size_t length,
+                          unsigned char iv[16],
+                          const unsigned char *input,
+                          unsigned char *output)
+{
+    int ret = 0;
+    size_t chunk;
+
+    AES_VALIDATE_RET( ctx != NULL );
+    AES_VALIDATE_RET( mode == MBEDTLS_AES_ENCRYPT ||
+                      mode == MBEDTLS_AES_DECRYPT );
+    AES_VALIDATE_RET( iv != NULL );
+    AES_VALIDATE_RET( input != NULL );
+    AES_VALIDATE_RET( output != NULL );
+
+    if (length % 16) {
+        return (MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH);
+    }
+
+    (void) crypto_sched_acquire(&cryp_sched, ctx);
+
+    /* Long buffers are processed in chunks: each chunk fully reconfigures */
+    /* the CRYP, so waiting contexts can be served in between              */
+    while ((ret == 0) && (length > 0))
+    {
+        chunk = (length > ST_CRYP_SCHED_CHUNK) ? ST_CRYP_SCHED_CHUNK : length;
+
+        ret = st_cbc_process(ctx, mode, chunk, iv, input, output);
+
+        input += chunk;
+        output += chunk;
+        length -= chunk;
+
+        if ((ret == 0) && (length > 0) && crypto_sched_pending(&cryp_sched))
+            (void) crypto_sched_yield(&cryp_sched, ctx);
+    }
+
+    crypto_sched_release(&cryp_sched);
+
+    return (ret);
+}
 #endif /* MBEDTLS_CIPHER_MODE_CBC */
 
 #if defined(MBEDTLS_CIPHER_MODE_XTS)
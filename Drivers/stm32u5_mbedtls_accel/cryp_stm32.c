@@ -28,18 +28,38 @@
 #if defined(MBEDTLS_AES_ALT) || defined(MBEDTLS_CCM_ALT) || defined(MBEDTLS_GCM_ALT)
 
 #include "cryp_stm32.h"
+#include "mbedtls/error.h"
+#include "mbedtls/platform_util.h"
 
+#if (ST_CRYP_USE_DMA == 1)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif /* ST_CRYP_USE_DMA */
 
-/* Variables -----------------------------------------------------------------*/
-/* Mutex protection because of one Crypt Hw instance is shared over several   */
-/* mode of operations (AES, GCM, CCM implementations may be enabled together) */
-#if defined(MBEDTLS_THREADING_C)
-mbedtls_threading_mutex_t cryp_mutex;
-unsigned char cryp_mutex_started = 0;
-#endif /* MBEDTLS_THREADING_C */
+/* Private define ------------------------------------------------------------*/
+/* HAL_CRYP_Encrypt/Decrypt take a 16 bit size: process larger payloads in    */
+/* chunks which are a multiple of the AES block size                          */
+#define CRYP_MAX_CHUNK      0xFFF0U
+#define CRYP_BLOCK_MASK     0xFU
 
+/* Variables -----------------------------------------------------------------*/
+/* One Crypt Hw instance is shared over several mode of operations (AES, GCM, */
+/* CCM implementations may be enabled together): access is arbitrated by     */
+/* cryp_sched (see crypto_sched_stm32.c)                                      */
 unsigned int cryp_context_count = 0;
 
+#if (ST_CRYP_USE_DMA == 1)
+static DMA_HandleTypeDef cryp_hdma_in;
+static DMA_HandleTypeDef cryp_hdma_out;
+static unsigned char cryp_dma_initialized = 0;
+static TaskHandle_t volatile cryp_dma_task = NULL;
+static volatile HAL_StatusTypeDef cryp_dma_status = HAL_OK;
+
+/* Handles served by the application's GPDMA interrupt handlers */
+extern DMA_HandleTypeDef * ST_CRYP_DMA_IN_HANDLE;
+extern DMA_HandleTypeDef * ST_CRYP_DMA_OUT_HANDLE;
+#endif /* ST_CRYP_USE_DMA */
+
 /* Functions -----------------------------------------------------------------*/
 
 /* Implementation that should never be optimized out by the compiler */
@@ -51,6 +71,294 @@ void cryp_zeroize(void *v, size_t n)
     }
 }
 
+void cryp_context_save(CRYP_HandleTypeDef *hcryp, cryp_hw_context_t *hw)
+{
+    AES_TypeDef *aes = hcryp->Instance;
+
+    hw->cr = aes->CR;
+
+    hw->ivr[0] = aes->IVR0;
+    hw->ivr[1] = aes->IVR1;
+    hw->ivr[2] = aes->IVR2;
+    hw->ivr[3] = aes->IVR3;
+
+    hw->suspr[0] = aes->SUSP0R;
+    hw->suspr[1] = aes->SUSP1R;
+    hw->suspr[2] = aes->SUSP2R;
+    hw->suspr[3] = aes->SUSP3R;
+    hw->suspr[4] = aes->SUSP4R;
+    hw->suspr[5] = aes->SUSP5R;
+    hw->suspr[6] = aes->SUSP6R;
+    hw->suspr[7] = aes->SUSP7R;
+}
+
+void cryp_context_restore(CRYP_HandleTypeDef *hcryp,
+                          const cryp_hw_context_t *hw)
+{
+    AES_TypeDef *aes = hcryp->Instance;
+    const uint32_t *key = hcryp->Init.pKey;
+
+    /* registers can only be written with the peripheral disabled */
+    CLEAR_BIT( aes->CR, AES_CR_EN );
+    aes->CR = hw->cr & ~AES_CR_EN;
+
+    if ( hcryp->Init.KeySize == CRYP_KEYSIZE_256B )
+    {
+        aes->KEYR7 = key[0];
+        aes->KEYR6 = key[1];
+        aes->KEYR5 = key[2];
+        aes->KEYR4 = key[3];
+        aes->KEYR3 = key[4];
+        aes->KEYR2 = key[5];
+        aes->KEYR1 = key[6];
+        aes->KEYR0 = key[7];
+    }
+    else
+    {
+        aes->KEYR3 = key[0];
+        aes->KEYR2 = key[1];
+        aes->KEYR1 = key[2];
+        aes->KEYR0 = key[3];
+    }
+
+    aes->IVR0 = hw->ivr[0];
+    aes->IVR1 = hw->ivr[1];
+    aes->IVR2 = hw->ivr[2];
+    aes->IVR3 = hw->ivr[3];
+
+    aes->SUSP0R = hw->suspr[0];
+    aes->SUSP1R = hw->suspr[1];
+    aes->SUSP2R = hw->suspr[2];
+    aes->SUSP3R = hw->suspr[3];
+    aes->SUSP4R = hw->suspr[4];
+    aes->SUSP5R = hw->suspr[5];
+    aes->SUSP6R = hw->suspr[6];
+    aes->SUSP7R = hw->suspr[7];
+
+    aes->CR = hw->cr;
+}
+
+#if (ST_CRYP_USE_DMA == 1)
+/* Configure the GPDMA channels used to feed and drain the CRYP FIFOs.        */
+/* Called with cryp_sched owned on the first DMA transfer.                    */
+static int cryp_dma_init(void)
+{
+    if (cryp_dma_initialized)
+        return( 0 );
+
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    cryp_hdma_in.Instance                     = ST_CRYP_DMA_IN_CHANNEL;
+    cryp_hdma_in.Init.Request                 = GPDMA1_REQUEST_AES_IN;
+    cryp_hdma_in.Init.BlkHWRequest            = DMA_BREQ_SINGLE_BURST;
+    cryp_hdma_in.Init.Direction               = DMA_MEMORY_TO_PERIPH;
+    cryp_hdma_in.Init.SrcInc                  = DMA_SINC_INCREMENTED;
+    cryp_hdma_in.Init.DestInc                 = DMA_DINC_FIXED;
+    cryp_hdma_in.Init.SrcDataWidth            = DMA_SRC_DATAWIDTH_WORD;
+    cryp_hdma_in.Init.DestDataWidth           = DMA_DEST_DATAWIDTH_WORD;
+    cryp_hdma_in.Init.Priority                = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+    cryp_hdma_in.Init.SrcBurstLength          = 1;
+    cryp_hdma_in.Init.DestBurstLength         = 1;
+    cryp_hdma_in.Init.TransferAllocatedPort   = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1;
+    cryp_hdma_in.Init.TransferEventMode       = DMA_TCEM_BLOCK_TRANSFER;
+    cryp_hdma_in.Init.Mode                    = DMA_NORMAL;
+
+    cryp_hdma_out.Instance                    = ST_CRYP_DMA_OUT_CHANNEL;
+    cryp_hdma_out.Init.Request                = GPDMA1_REQUEST_AES_OUT;
+    cryp_hdma_out.Init.BlkHWRequest           = DMA_BREQ_SINGLE_BURST;
+    cryp_hdma_out.Init.Direction              = DMA_PERIPH_TO_MEMORY;
+    cryp_hdma_out.Init.SrcInc                 = DMA_SINC_FIXED;
+    cryp_hdma_out.Init.DestInc                = DMA_DINC_INCREMENTED;
+    cryp_hdma_out.Init.SrcDataWidth           = DMA_SRC_DATAWIDTH_WORD;
+    cryp_hdma_out.Init.DestDataWidth          = DMA_DEST_DATAWIDTH_WORD;
+    cryp_hdma_out.Init.Priority               = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+    cryp_hdma_out.Init.SrcBurstLength         = 1;
+    cryp_hdma_out.Init.DestBurstLength        = 1;
+    cryp_hdma_out.Init.TransferAllocatedPort  = DMA_SRC_ALLOCATED_PORT1 | DMA_DEST_ALLOCATED_PORT0;
+    cryp_hdma_out.Init.TransferEventMode      = DMA_TCEM_BLOCK_TRANSFER;
+    cryp_hdma_out.Init.Mode                   = DMA_NORMAL;
+
+    if ( ( HAL_DMA_Init( &cryp_hdma_in ) != HAL_OK ) ||
+         ( HAL_DMA_ConfigChannelAttributes( &cryp_hdma_in, DMA_CHANNEL_NPRIV ) != HAL_OK ) ||
+         ( HAL_DMA_Init( &cryp_hdma_out ) != HAL_OK ) ||
+         ( HAL_DMA_ConfigChannelAttributes( &cryp_hdma_out, DMA_CHANNEL_NPRIV ) != HAL_OK ) )
+    {
+        return( -1 );
+    }
+
+    ST_CRYP_DMA_IN_HANDLE = &cryp_hdma_in;
+    ST_CRYP_DMA_OUT_HANDLE = &cryp_hdma_out;
+
+    HAL_NVIC_SetPriority( ST_CRYP_DMA_IN_IRQn, ST_CRYP_DMA_IRQ_PRIORITY, 0 );
+    HAL_NVIC_EnableIRQ( ST_CRYP_DMA_IN_IRQn );
+
+    HAL_NVIC_SetPriority( ST_CRYP_DMA_OUT_IRQn, ST_CRYP_DMA_IRQ_PRIORITY, 0 );
+    HAL_NVIC_EnableIRQ( ST_CRYP_DMA_OUT_IRQn );
+
+    cryp_dma_initialized = 1;
+
+    return( 0 );
+}
+
+/* DMA is only worth its setup cost for larger payloads, requires word       */
+/* aligned buffers and a running scheduler to block the caller.              */
+static int cryp_dma_usable(const unsigned char *input, size_t length,
+                           unsigned char *output)
+{
+    if ( length < ST_CRYP_DMA_THRESHOLD )
+        return( 0 );
+
+    if ( ( ( (uintptr_t) input | (uintptr_t) output ) & 0x3U ) != 0U )
+        return( 0 );
+
+    if ( ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) ||
+         ( __get_IPSR() != 0U ) )
+        return( 0 );
+
+    return( cryp_dma_init() == 0 );
+}
+
+static void cryp_dma_complete(HAL_StatusTypeDef status)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    cryp_dma_status = status;
+
+    if ( cryp_dma_task != NULL )
+    {
+        vTaskNotifyGiveIndexedFromISR( cryp_dma_task, ST_CRYP_NOTIFY_IDX,
+                                       &xHigherPriorityTaskWoken );
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+static void cryp_dma_out_cplt(CRYP_HandleTypeDef *hcryp)
+{
+    (void) hcryp;
+    cryp_dma_complete( HAL_OK );
+}
+
+static void cryp_dma_error(CRYP_HandleTypeDef *hcryp)
+{
+    (void) hcryp;
+    cryp_dma_complete( HAL_ERROR );
+}
+
+static int cryp_process_dma(CRYP_HandleTypeDef *hcryp, int decrypt,
+                            const unsigned char *input, size_t length,
+                            unsigned char *output)
+{
+    HAL_StatusTypeDef status;
+
+    /* The DMA handles are shared by all contexts: attach them to this one */
+    __HAL_LINKDMA( hcryp, hdmain, cryp_hdma_in );
+    __HAL_LINKDMA( hcryp, hdmaout, cryp_hdma_out );
+
+    /* Completion is reported to this handle only, other users of the CRYP */
+    /* HAL keep their own callbacks                                        */
+    if ( ( HAL_CRYP_RegisterCallback( hcryp, HAL_CRYP_OUTPUT_COMPLETE_CB_ID,
+                                      cryp_dma_out_cplt ) != HAL_OK ) ||
+         ( HAL_CRYP_RegisterCallback( hcryp, HAL_CRYP_ERROR_CB_ID,
+                                      cryp_dma_error ) != HAL_OK ) )
+    {
+        return( MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED );
+    }
+
+    cryp_dma_status = HAL_OK;
+    cryp_dma_task = xTaskGetCurrentTaskHandle();
+
+    if ( decrypt )
+        status = HAL_CRYP_Decrypt_DMA( hcryp, (uint32_t *)input,
+                                       (uint16_t)length, (uint32_t *)output );
+    else
+        status = HAL_CRYP_Encrypt_DMA( hcryp, (uint32_t *)input,
+                                       (uint16_t)length, (uint32_t *)output );
+
+    if ( status == HAL_OK )
+    {
+        if ( ulTaskNotifyTakeIndexed( ST_CRYP_NOTIFY_IDX, pdTRUE,
+                                      pdMS_TO_TICKS( ST_CRYP_TIMEOUT ) ) == 0 )
+        {
+            /* Stop the transfer and return the handle to a usable state */
+            (void) HAL_DMA_Abort( &cryp_hdma_in );
+            (void) HAL_DMA_Abort( &cryp_hdma_out );
+            CLEAR_BIT( hcryp->Instance->CR, AES_CR_DMAINEN | AES_CR_DMAOUTEN );
+            hcryp->State = HAL_CRYP_STATE_READY;
+            __HAL_UNLOCK( hcryp );
+            status = HAL_TIMEOUT;
+
+            /* The completion may have been given between the timeout and */
+            /* the abort: do not leave it pending for the next transfer   */
+            (void) ulTaskNotifyTakeIndexed( ST_CRYP_NOTIFY_IDX, pdTRUE, 0 );
+        }
+        else
+        {
+            status = cryp_dma_status;
+        }
+    }
+
+    cryp_dma_task = NULL;
+
+    return( ( status == HAL_OK ) ? 0 : MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED );
+}
+
+#endif /* ST_CRYP_USE_DMA */
+
+int cryp_process(CRYP_HandleTypeDef *hcryp, int decrypt,
+                 const unsigned char *input, size_t length,
+                 unsigned char *output, cryp_hw_context_t *hw)
+{
+    int ret = 0;
+    size_t chunk;
+    size_t max_chunk = ( hw != NULL ) ? ST_CRYP_SCHED_CHUNK : CRYP_MAX_CHUNK;
+
+    while ( ( ret == 0 ) && ( length > 0 ) )
+    {
+        chunk = ( length > max_chunk ) ? max_chunk : length;
+
+#if (ST_CRYP_USE_DMA == 1)
+        if ( cryp_dma_usable( input, chunk, output ) )
+        {
+            /* Leave a trailing partial block to the polling mode */
+            chunk &= ~( (size_t) CRYP_BLOCK_MASK );
+            ret = cryp_process_dma( hcryp, decrypt, input, chunk, output );
+        }
+        else
+#endif /* ST_CRYP_USE_DMA */
+        {
+            HAL_StatusTypeDef status;
+
+            if ( decrypt )
+                status = HAL_CRYP_Decrypt( hcryp, (uint32_t *)input,
+                                           (uint16_t)chunk, (uint32_t *)output,
+                                           ST_CRYP_TIMEOUT );
+            else
+                status = HAL_CRYP_Encrypt( hcryp, (uint32_t *)input,
+                                           (uint16_t)chunk, (uint32_t *)output,
+                                           ST_CRYP_TIMEOUT );
+
+            if ( status != HAL_OK )
+                ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        }
+
+        input += chunk;
+        output += chunk;
+        length -= chunk;
+
+        /* Let the waiting contexts use the CRYP between chunks */
+        if ( ( ret == 0 ) && ( length > 0 ) && ( hw != NULL ) &&
+             crypto_sched_pending( &cryp_sched ) )
+        {
+            cryp_context_save( hcryp, hw );
+
+            if ( !crypto_sched_yield( &cryp_sched, hw ) )
+                cryp_context_restore( hcryp, hw );
+        }
+    }
+
+    return( ret );
+}
 
 /* HAL function that should be implemented in the user file */
 /**
@@ -28,10 +28,7 @@
 /* Includes ------------------------------------------------------------------*/
 /* include the appropriate header file */
 #include "stm32u5xx_hal.h"
-
-#if defined(MBEDTLS_THREADING_C)
-#include "mbedtls/threading.h"
-#endif
+#include "crypto_sched_stm32.h"
 
 /* macros --------------------------------------------------------------------*/
 /*
@@ -60,6 +57,47 @@ do {                                                    \
 /* constants -----------------------------------------------------------------*/
 #define ST_CRYP_TIMEOUT   1000  /* timeout (in ms) for the crypto processor   */
 
+/* DMA mode: payloads of at least ST_CRYP_DMA_THRESHOLD bytes are transferred */
+/* by GPDMA while the calling task blocks on a task notification. Shorter     */
+/* payloads, unaligned buffers and calls made before the scheduler is started */
+/* use the polling mode.                                                      */
+#if !defined(ST_CRYP_USE_DMA)
+#define ST_CRYP_USE_DMA           1
+#endif
+
+#if !defined(ST_CRYP_DMA_THRESHOLD)
+#define ST_CRYP_DMA_THRESHOLD     256U  /* minimum payload (in bytes) for DMA */
+#endif
+
+#if !defined(ST_CRYP_NOTIFY_IDX)
+#define ST_CRYP_NOTIFY_IDX        7U    /* task notification index           */
+#endif
+
+/* The interrupt vectors of the DMA channels belong to the application: its  */
+/* handlers call HAL_DMA_IRQHandler on the handle published in                */
+/* ST_CRYP_DMA_xxx_HANDLE (see Common/sys/interrupt_handlers.c). The CRYP     */
+/* completion callbacks are registered on each handle, which requires        */
+/* USE_HAL_CRYP_REGISTER_CALLBACKS.                                           */
+#if !defined(ST_CRYP_DMA_IN_CHANNEL)
+#define ST_CRYP_DMA_IN_CHANNEL    GPDMA1_Channel6
+#define ST_CRYP_DMA_IN_IRQn       GPDMA1_Channel6_IRQn
+#define ST_CRYP_DMA_IN_HANDLE     pxHndlGpdmaCh6
+#endif
+
+#if !defined(ST_CRYP_DMA_OUT_CHANNEL)
+#define ST_CRYP_DMA_OUT_CHANNEL   GPDMA1_Channel7
+#define ST_CRYP_DMA_OUT_IRQn      GPDMA1_Channel7_IRQn
+#define ST_CRYP_DMA_OUT_HANDLE    pxHndlGpdmaCh7
+#endif
+
+#if (ST_CRYP_USE_DMA == 1) && (USE_HAL_CRYP_REGISTER_CALLBACKS != 1)
+#error "ST_CRYP_USE_DMA requires USE_HAL_CRYP_REGISTER_CALLBACKS"
+#endif
+
+#if !defined(ST_CRYP_DMA_IRQ_PRIORITY)
+#define ST_CRYP_DMA_IRQ_PRIORITY  5U
+#endif
+
 /* defines -------------------------------------------------------------------*/
 /* AES 192 bits key length may be optional in the HW */
 #if defined CRYP_KEYSIZE_192B
@@ -68,17 +106,38 @@ do {                                                    \
 #define USE_AES_KEY192			0
 #endif /* USE_AES_KEY192 */
 
-/* variables -----------------------------------------------------------------*/
-#if defined(MBEDTLS_THREADING_C)
-extern mbedtls_threading_mutex_t cryp_mutex;
-extern unsigned char cryp_mutex_started;
-#endif /* MBEDTLS_THREADING_C */
+/* types ---------------------------------------------------------------------*/
+/* CRYP registers needed to suspend a GCM/GMAC/CCM message and resume it     */
+/* after another context used the peripheral. The key is reloaded from the  */
+/* handle (Init.pKey).                                                       */
+typedef struct
+{
+    uint32_t cr;
+    uint32_t ivr[4];
+    uint32_t suspr[8];
+} cryp_hw_context_t;
 
+/* variables -----------------------------------------------------------------*/
 extern unsigned int cryp_context_count;
 
 /* functions prototypes ------------------------------------------------------*/
 extern void cryp_zeroize(void *v, size_t n);
 
+/* Save / restore the hw context of a suspended message. Must be called with  */
+/* cryp_sched owned.                                                          */
+extern void cryp_context_save(CRYP_HandleTypeDef *hcryp, cryp_hw_context_t *hw);
+extern void cryp_context_restore(CRYP_HandleTypeDef *hcryp,
+                                 const cryp_hw_context_t *hw);
+
+/* Encrypt or decrypt a payload with an already configured CRYP handle, using */
+/* DMA when possible. Must be called with cryp_sched owned, by a context      */
+/* identified by hw. When hw is not NULL, the peripheral is handed over to    */
+/* waiting contexts every ST_CRYP_SCHED_CHUNK bytes, saving and restoring hw. */
+/* Returns 0 or MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED.                         */
+extern int cryp_process(CRYP_HandleTypeDef *hcryp, int decrypt,
+                        const unsigned char *input, size_t length,
+                        unsigned char *output, cryp_hw_context_t *hw);
+
 #ifdef __cplusplus
 }
 #endif
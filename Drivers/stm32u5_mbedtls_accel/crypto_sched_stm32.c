@@ -0,0 +1,147 @@
+/*
+ *  Copyright (C) 2019-2020 STMicroelectronics, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file implements the scheduler which shares the CRYP and HASH
+ *  peripherals between mbed TLS contexts.
+ *
+ *  Requests are served in arrival order. Long operations are split in chunks
+ *  by the callers, which hand the peripheral over between chunks when other
+ *  contexts are waiting, saving and restoring their hardware context around
+ *  the hand over.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crypto_sched_stm32.h"
+
+/* Variables -----------------------------------------------------------------*/
+crypto_sched_t cryp_sched = { 0 };
+crypto_sched_t hash_sched = { 0 };
+
+/* Functions -----------------------------------------------------------------*/
+
+int crypto_sched_acquire(crypto_sched_t *sched, const void *ctx)
+{
+    crypto_sched_waiter_t waiter;
+    TickType_t start;
+    uint32_t wait_ms;
+    int loaded;
+
+    /* Nothing can compete for the peripheral before the scheduler starts */
+    if ( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+    {
+        loaded = ( sched->hw_ctx == ctx );
+        sched->hw_ctx = ctx;
+        sched->stats.acquisitions++;
+        return( loaded );
+    }
+
+    waiter.task = xTaskGetCurrentTaskHandle();
+    waiter.next = NULL;
+    start = xTaskGetTickCount();
+
+    taskENTER_CRITICAL();
+
+    if ( ( sched->owner == NULL ) && ( sched->head == NULL ) )
+    {
+        sched->owner = waiter.task;
+    }
+    else
+    {
+        if ( sched->tail != NULL )
+            sched->tail->next = &waiter;
+        else
+            sched->head = &waiter;
+
+        sched->tail = &waiter;
+        sched->stats.contended++;
+    }
+
+    taskEXIT_CRITICAL();
+
+    /* crypto_sched_release makes this task the owner before notifying it */
+    while ( sched->owner != waiter.task )
+    {
+        (void) ulTaskNotifyTakeIndexed( ST_SCHED_NOTIFY_IDX, pdTRUE, portMAX_DELAY );
+    }
+
+    wait_ms = (uint32_t) ( ( xTaskGetTickCount() - start ) * portTICK_PERIOD_MS );
+
+    taskENTER_CRITICAL();
+    loaded = ( sched->hw_ctx == ctx );
+    sched->hw_ctx = ctx;
+    sched->stats.acquisitions++;
+    sched->stats.wait_ms_total += wait_ms;
+    if ( wait_ms > sched->stats.wait_ms_max )
+        sched->stats.wait_ms_max = wait_ms;
+    taskEXIT_CRITICAL();
+
+    return( loaded );
+}
+
+void crypto_sched_release(crypto_sched_t *sched)
+{
+    crypto_sched_waiter_t *next;
+
+    if ( xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED )
+        return;
+
+    taskENTER_CRITICAL();
+
+    next = sched->head;
+
+    if ( next != NULL )
+    {
+        sched->head = next->next;
+        if ( sched->head == NULL )
+            sched->tail = NULL;
+
+        sched->owner = next->task;
+        (void) xTaskNotifyGiveIndexed( next->task, ST_SCHED_NOTIFY_IDX );
+    }
+    else
+    {
+        sched->owner = NULL;
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+int crypto_sched_pending(crypto_sched_t *sched)
+{
+    return( sched->head != NULL );
+}
+
+int crypto_sched_yield(crypto_sched_t *sched, const void *ctx)
+{
+    sched->stats.yields++;
+    crypto_sched_release( sched );
+    return( crypto_sched_acquire( sched, ctx ) );
+}
+
+void crypto_sched_forget(crypto_sched_t *sched, const void *ctx)
+{
+    taskENTER_CRITICAL();
+    if ( sched->hw_ctx == ctx )
+        sched->hw_ctx = NULL;
+    taskEXIT_CRITICAL();
+}
+
+void crypto_sched_get_stats(crypto_sched_t *sched, crypto_sched_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = sched->stats;
+    taskEXIT_CRITICAL();
+}
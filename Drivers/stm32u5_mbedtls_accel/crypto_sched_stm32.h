@@ -0,0 +1,102 @@
+/**
+  ******************************************************************************
+  * @brief   Header file of the CRYP / HASH peripheral scheduler.
+  ******************************************************************************
+  * @attention
+  *
+  *  Copyright (C) 2019-2020 STMicroelectronics, All Rights Reserved
+  *
+  * This software component is licensed by ST under Apache 2.0 license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  * https://opensource.org/licenses/Apache-2.0
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRYPTO_SCHED_H
+#define __CRYPTO_SCHED_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* constants -----------------------------------------------------------------*/
+/* Task notification index used to hand the peripheral over to a waiter       */
+#if !defined(ST_SCHED_NOTIFY_IDX)
+#define ST_SCHED_NOTIFY_IDX       6U
+#endif
+
+/* Number of bytes processed by a context before the peripheral is handed to  */
+/* the next waiting context                                                   */
+#if !defined(ST_CRYP_SCHED_CHUNK)
+#define ST_CRYP_SCHED_CHUNK       1024U  /* multiple of the AES block size   */
+#endif
+
+#if !defined(ST_HASH_SCHED_CHUNK)
+#define ST_HASH_SCHED_CHUNK       1024U  /* multiple of the HASH block size  */
+#endif
+
+/* types ---------------------------------------------------------------------*/
+typedef struct crypto_sched_waiter
+{
+    TaskHandle_t task;
+    struct crypto_sched_waiter *next;
+} crypto_sched_waiter_t;
+
+typedef struct
+{
+    uint32_t acquisitions;   /* number of times the peripheral was granted    */
+    uint32_t contended;      /* grants which had to wait for another context  */
+    uint32_t yields;         /* long operations handed over between chunks    */
+    uint32_t wait_ms_total;  /* total time spent waiting in the queue         */
+    uint32_t wait_ms_max;    /* longest time spent waiting in the queue       */
+} crypto_sched_stats_t;
+
+/* A peripheral is granted to one task at a time, in request order            */
+typedef struct
+{
+    TaskHandle_t owner;              /* task currently using the peripheral   */
+    const void *hw_ctx;              /* context last loaded in the peripheral */
+    crypto_sched_waiter_t *head;     /* first waiting task                    */
+    crypto_sched_waiter_t *tail;     /* last waiting task                     */
+    crypto_sched_stats_t stats;
+} crypto_sched_t;
+
+/* variables -----------------------------------------------------------------*/
+extern crypto_sched_t cryp_sched;
+extern crypto_sched_t hash_sched;
+
+/* functions prototypes ------------------------------------------------------*/
+/* Wait for the peripheral. Returns 1 if ctx was the last context loaded in   */
+/* the peripheral (its hardware state is still in place), 0 otherwise.        */
+extern int crypto_sched_acquire(crypto_sched_t *sched, const void *ctx);
+
+extern void crypto_sched_release(crypto_sched_t *sched);
+
+/* Returns non zero when other contexts are waiting for the peripheral        */
+extern int crypto_sched_pending(crypto_sched_t *sched);
+
+/* Hand the peripheral to the waiting contexts, then wait for it again.       */
+/* Same return value as crypto_sched_acquire.                                 */
+extern int crypto_sched_yield(crypto_sched_t *sched, const void *ctx);
+
+/* Drop any reference to ctx, before its memory is released or reused         */
+extern void crypto_sched_forget(crypto_sched_t *sched, const void *ctx);
+
+extern void crypto_sched_get_stats(crypto_sched_t *sched,
+                                   crypto_sched_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__CRYPTO_SCHED_H */
@@ -0,0 +1,320 @@
+/*
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  Copyright (C) 2019-2020 STMicroelectronics, All Rights Reserved
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file implements the software fallback used by the alternative GCM
+ *  implementation for short messages, and the calibration of the length under
+ *  which the fallback is faster than the CRYP.
+ *
+ *  Blocks are encrypted by the mbed TLS AES. GHASH follows the mbed TLS one
+ *  (4-bit tables), which MBEDTLS_GCM_ALT leaves out of the build.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+
+#include "crypto_sw_stm32.h"
+
+#if ST_SW_DISPATCH
+
+#include "mbedtls/platform_util.h"
+
+#if ST_SW_CALIBRATE
+#include "stm32u5xx_hal.h"
+#endif
+
+/* Private macro -------------------------------------------------------------*/
+#define GET_U32_BE(b,i)                                 \
+    ( ( (uint32_t) (b)[(i)    ] << 24 )                 \
+    | ( (uint32_t) (b)[(i) + 1] << 16 )                 \
+    | ( (uint32_t) (b)[(i) + 2] <<  8 )                 \
+    | ( (uint32_t) (b)[(i) + 3]       ) )
+
+#define PUT_U32_BE(n,b,i)                               \
+do {                                                    \
+    (b)[(i)    ] = (unsigned char) ( (n) >> 24 );       \
+    (b)[(i) + 1] = (unsigned char) ( (n) >> 16 );       \
+    (b)[(i) + 2] = (unsigned char) ( (n) >>  8 );       \
+    (b)[(i) + 3] = (unsigned char) ( (n)       );       \
+} while( 0 )
+
+/* Private variables ---------------------------------------------------------*/
+/* Reduction table of the GHASH multiplication */
+static const uint64_t last4[16] =
+{
+    0x0000, 0x1c20, 0x3840, 0x2460,
+    0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560,
+    0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+#if ST_SW_CALIBRATE
+/* Calibration data: its content is irrelevant */
+static uint32_t sw_scratch[ST_SW_MAX_LEN / 4];
+#endif
+
+/* Functions -----------------------------------------------------------------*/
+
+#if ST_SW_CALIBRATE
+static uint32_t st_sw_cycles(st_sw_bench_t op, void *arg, size_t len)
+{
+    uint32_t best = UINT32_MAX;
+    uint32_t start;
+    uint32_t cycles;
+    unsigned int i;
+
+    for (i = 0; i < ST_SW_CALIBRATE_RUNS; i++)
+    {
+        start = DWT->CYCCNT;
+
+        if (op(arg, (unsigned char *) sw_scratch, len) != 0)
+            return (UINT32_MAX);
+
+        cycles = DWT->CYCCNT - start;
+        if (cycles < best)
+            best = cycles;
+    }
+
+    return (best);
+}
+
+void st_sw_calibrate(st_sw_dispatch_t *d,
+                     st_sw_bench_t hw, st_sw_bench_t sw, void *arg)
+{
+    size_t len;
+    size_t threshold = 0;
+
+    /* Enable the cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    /* Keep the largest size (in blocks) on which the software is faster */
+    for (len = 16; len <= ST_SW_MAX_LEN; len *= 2)
+    {
+        if (st_sw_cycles(sw, arg, len) >= st_sw_cycles(hw, arg, len))
+            break;
+
+        threshold = len;
+    }
+
+    d->threshold = threshold;
+    d->state = ST_SW_CALIBRATED;
+}
+#endif /* ST_SW_CALIBRATE */
+
+int st_sw_dispatch(const st_sw_dispatch_t *d, size_t len)
+{
+    return (len <= d->threshold);
+}
+
+void st_sw_gcm_init(st_sw_gcm_key_t *key)
+{
+    mbedtls_aes_init(&key->aes);
+    key->keybits = 0;
+}
+
+void st_sw_gcm_free(st_sw_gcm_key_t *key)
+{
+    mbedtls_aes_free(&key->aes);
+    mbedtls_platform_zeroize(key, sizeof(st_sw_gcm_key_t));
+}
+
+/*
+ * GCM key: mbed TLS AES key and precomputed multiples of H = E(K, 0^128)
+ */
+void st_sw_gcm_setkey(st_sw_gcm_key_t *key,
+                      const unsigned char *k, unsigned int keybits)
+{
+    unsigned char h[16] = { 0 };
+    uint64_t vh, vl;
+    uint32_t T;
+    int i, j;
+
+    key->keybits = 0;
+
+    if ((mbedtls_aes_setkey_enc(&key->aes, k, keybits) != 0) ||
+        (mbedtls_aes_crypt_ecb(&key->aes, MBEDTLS_AES_ENCRYPT, h, h) != 0))
+        return;
+
+    vh = ( (uint64_t) GET_U32_BE(h, 0) << 32 ) | GET_U32_BE(h, 4);
+    vl = ( (uint64_t) GET_U32_BE(h, 8) << 32 ) | GET_U32_BE(h, 12);
+
+    /* 8 = 1000 corresponds to 1 in GF(2^128) */
+    key->HL[8] = vl;
+    key->HH[8] = vh;
+    key->HH[0] = 0;
+    key->HL[0] = 0;
+
+    for (i = 4; i > 0; i >>= 1)
+    {
+        T = (uint32_t) (vl & 1) * 0xe1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t) T << 32);
+
+        key->HL[i] = vl;
+        key->HH[i] = vh;
+    }
+
+    for (i = 2; i <= 8; i *= 2)
+    {
+        vh = key->HH[i];
+        vl = key->HL[i];
+        for (j = 1; j < i; j++)
+        {
+            key->HH[i + j] = vh ^ key->HH[j];
+            key->HL[i + j] = vl ^ key->HL[j];
+        }
+    }
+
+    key->keybits = keybits;
+
+    mbedtls_platform_zeroize(h, sizeof(h));
+}
+
+/* x = x * H in GF(2^128) */
+static void st_sw_gcm_mult(const st_sw_gcm_key_t *key, unsigned char x[16])
+{
+    int i;
+    unsigned char lo, hi, rem;
+    uint64_t zh, zl;
+
+    lo = x[15] & 0xf;
+
+    zh = key->HH[lo];
+    zl = key->HL[lo];
+
+    for (i = 15; i >= 0; i--)
+    {
+        lo = x[i] & 0xf;
+        hi = (x[i] >> 4) & 0xf;
+
+        if (i != 15)
+        {
+            rem = (unsigned char) zl & 0xf;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4);
+            zh ^= (uint64_t) last4[rem] << 48;
+            zh ^= key->HH[lo];
+            zl ^= key->HL[lo];
+        }
+
+        rem = (unsigned char) zl & 0xf;
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4);
+        zh ^= (uint64_t) last4[rem] << 48;
+        zh ^= key->HH[hi];
+        zl ^= key->HL[hi];
+    }
+
+    PUT_U32_BE((uint32_t) (zh >> 32), x, 0);
+    PUT_U32_BE((uint32_t) zh, x, 4);
+    PUT_U32_BE((uint32_t) (zl >> 32), x, 8);
+    PUT_U32_BE((uint32_t) zl, x, 12);
+}
+
+int st_sw_gcm_crypt_and_tag(st_sw_gcm_key_t *key, int decrypt,
+                            size_t length, const unsigned char iv[12],
+                            const unsigned char *add, size_t add_len,
+                            const unsigned char *input,
+                            unsigned char *output,
+                            size_t tag_len, unsigned char *tag)
+{
+    unsigned char y[16];
+    unsigned char ectr[16];
+    unsigned char base_ectr[16];
+    unsigned char buf[16] = { 0 };
+    unsigned char c;
+    size_t use_len;
+    size_t i;
+    uint64_t bits;
+    int ret;
+
+    /* Y0 = IV || 0^31 || 1 */
+    memcpy(y, iv, 12);
+    y[12] = 0;
+    y[13] = 0;
+    y[14] = 0;
+    y[15] = 1;
+
+    ret = mbedtls_aes_crypt_ecb(&key->aes, MBEDTLS_AES_ENCRYPT, y, base_ectr);
+    if (ret != 0)
+        goto exit;
+
+    /* GHASH of the additional data */
+    for (i = 0; i < add_len; i += use_len)
+    {
+        use_len = (add_len - i < 16) ? (add_len - i) : 16;
+        for (size_t j = 0; j < use_len; j++)
+            buf[j] ^= add[i + j];
+
+        st_sw_gcm_mult(key, buf);
+    }
+
+    /* CTR encryption and GHASH of the ciphertext */
+    for (i = 0; i < length; i += use_len)
+    {
+        use_len = (length - i < 16) ? (length - i) : 16;
+
+        for (int j = 15; j >= 12; j--)
+            if (++y[j] != 0)
+                break;
+
+        ret = mbedtls_aes_crypt_ecb(&key->aes, MBEDTLS_AES_ENCRYPT, y, ectr);
+        if (ret != 0)
+            goto exit;
+
+        for (size_t j = 0; j < use_len; j++)
+        {
+            c = input[i + j];
+            output[i + j] = ectr[j] ^ c;
+            buf[j] ^= decrypt ? c : output[i + j];
+        }
+
+        st_sw_gcm_mult(key, buf);
+    }
+
+    /* GHASH of the lengths (in bits) */
+    bits = (uint64_t) add_len * 8;
+    PUT_U32_BE((uint32_t) (bits >> 32), ectr, 0);
+    PUT_U32_BE((uint32_t) bits, ectr, 4);
+    bits = (uint64_t) length * 8;
+    PUT_U32_BE((uint32_t) (bits >> 32), ectr, 8);
+    PUT_U32_BE((uint32_t) bits, ectr, 12);
+
+    for (i = 0; i < 16; i++)
+        buf[i] ^= ectr[i];
+
+    st_sw_gcm_mult(key, buf);
+
+    for (i = 0; i < tag_len; i++)
+        tag[i] = base_ectr[i] ^ buf[i];
+
+exit:
+    mbedtls_platform_zeroize(buf, sizeof(buf));
+    mbedtls_platform_zeroize(ectr, sizeof(ectr));
+    mbedtls_platform_zeroize(base_ectr, sizeof(base_ectr));
+
+    return (ret);
+}
+
+#endif /* ST_SW_DISPATCH */
+
+void st_sw_init(void)
+{
+#if ST_SW_DISPATCH && ST_SW_CALIBRATE && defined(MBEDTLS_GCM_ALT)
+    st_gcm_sw_calibrate();
+#endif
+}
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @brief   Header file of the software fallback for short GCM messages.
+  ******************************************************************************
+  * @attention
+  *
+  *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+  *  Copyright (C) 2019-2020 STMicroelectronics, All Rights Reserved
+  *
+  * This software component is licensed by ST under Apache 2.0 license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  * https://opensource.org/licenses/Apache-2.0
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRYPTO_SW_H
+#define __CRYPTO_SW_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbedtls/aes.h"
+
+/* constants -----------------------------------------------------------------*/
+/* Route GCM messages shorter than a threshold to software: the peripheral   */
+/* setup, key load and context save / restore cost more than the computation */
+/* itself for a few blocks of data. The software path uses the mbed TLS AES, */
+/* so it is not available when MBEDTLS_AES_ALT replaces it.                  */
+#if !defined(ST_SW_DISPATCH)
+#if defined(MBEDTLS_AES_ALT)
+#define ST_SW_DISPATCH            0
+#else
+#define ST_SW_DISPATCH            1
+#endif
+#endif
+
+#if ST_SW_DISPATCH && defined(MBEDTLS_AES_ALT)
+#error "ST_SW_DISPATCH requires the mbed TLS AES: undefine MBEDTLS_AES_ALT"
+#endif
+
+/* Measure the thresholds in st_sw_init(). When disabled, the build time     */
+/* thresholds below are used (the "bench crypto" cli command prints the      */
+/* measured values)                                                          */
+#if !defined(ST_SW_CALIBRATE)
+#define ST_SW_CALIBRATE           1
+#endif
+
+/* Longest operation (in bytes) which may be processed in software           */
+#if !defined(ST_SW_MAX_LEN)
+#define ST_SW_MAX_LEN             256U
+#endif
+
+#if !defined(ST_SW_CALIBRATE_RUNS)
+#define ST_SW_CALIBRATE_RUNS      4U    /* runs per size, fastest one kept    */
+#endif
+
+/* Build time threshold: messages (payload and additional data) of at most   */
+/* this number of bytes are processed in software. 0 disables the software   */
+/* path.                                                                     */
+#if !defined(ST_GCM_SW_THRESHOLD)
+#define ST_GCM_SW_THRESHOLD       64U
+#endif
+
+#define ST_SW_UNCALIBRATED        0U
+#define ST_SW_CALIBRATED          1U
+
+/* types ---------------------------------------------------------------------*/
+/* Threshold of an operation                                                 */
+typedef struct
+{
+    size_t threshold;       /* operations of at most threshold bytes are      */
+                            /* processed in software                          */
+    uint32_t state;
+} st_sw_dispatch_t;
+
+#define ST_SW_DISPATCH_INIT(threshold)  { (threshold), ST_SW_UNCALIBRATED }
+
+/* Processes len bytes of buf in place, for calibration. Returns 0 on success */
+typedef int (*st_sw_bench_t)(void *arg, unsigned char *buf, size_t len);
+
+#if ST_SW_DISPATCH
+/* AES-GCM key: mbed TLS AES encryption key and GHASH multiplication table   */
+typedef struct
+{
+    mbedtls_aes_context aes;
+    unsigned int keybits;   /* 0 when no key is loaded                        */
+    uint64_t HL[16];
+    uint64_t HH[16];
+} st_sw_gcm_key_t;
+
+/* variables -----------------------------------------------------------------*/
+/* Defined by the alternative implementations which dispatch to software     */
+extern st_sw_dispatch_t st_gcm_dispatch;
+#endif /* ST_SW_DISPATCH */
+
+/* functions prototypes ------------------------------------------------------*/
+/* Measures the thresholds of the operations compiled in (ST_SW_CALIBRATE).  */
+/* Call once from a task, before the first use of the accelerators: until    */
+/* then the build time thresholds apply.                                     */
+extern void st_sw_init(void);
+
+#if ST_SW_DISPATCH
+/* Returns 1 when an operation on len bytes should be processed in software */
+extern int st_sw_dispatch(const st_sw_dispatch_t *d, size_t len);
+
+#if ST_SW_CALIBRATE
+/* Measures hw and sw on increasing sizes up to ST_SW_MAX_LEN, and keeps the */
+/* largest size on which sw is faster                                        */
+extern void st_sw_calibrate(st_sw_dispatch_t *d,
+                            st_sw_bench_t hw, st_sw_bench_t sw, void *arg);
+
+/* Calibration of the GCM threshold on a throwaway key, in gcm_alt.c         */
+extern void st_gcm_sw_calibrate(void);
+#endif /* ST_SW_CALIBRATE */
+
+extern void st_sw_gcm_init(st_sw_gcm_key_t *key);
+extern void st_sw_gcm_free(st_sw_gcm_key_t *key);
+extern void st_sw_gcm_setkey(st_sw_gcm_key_t *key,
+                             const unsigned char *k, unsigned int keybits);
+
+/* One shot GCM with a 96 bits IV. The tag is computed over the ciphertext:  */
+/* the caller checks it on decryption. Returns 0 or an mbed TLS AES error.   */
+extern int st_sw_gcm_crypt_and_tag(st_sw_gcm_key_t *key, int decrypt,
+                                   size_t length, const unsigned char iv[12],
+                                   const unsigned char *add, size_t add_len,
+                                   const unsigned char *input,
+                                   unsigned char *output,
+                                   size_t tag_len, unsigned char *tag);
+#endif /* ST_SW_DISPATCH */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__CRYPTO_SW_H */
@@ -21,12 +21,23 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+/* The software verification builds groups of its own, including the private */
+/* reduction function and comb table of mbedtls_ecp_group                     */
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include "mbedtls/private_access.h"
 #include "mbedtls/ecdsa.h"
 
 #if defined(MBEDTLS_ECDSA_C)
 #include "mbedtls/platform.h"
 #include "mbedtls/platform_util.h"
 #include "stm32u5xx_hal.h"
+#include "ecdsa_cache_stm32.h"
+
+#if defined(MBEDTLS_ECDSA_VERIFY_ALT) && !defined(MBEDTLS_ECP_ALT) && ST_ECDSA_VERIFY_CACHE
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -43,7 +54,9 @@
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
-#if defined(MBEDTLS_ECDSA_SIGN_ALT)
+/* With ECDSA_NONCE_POOL, mbedtls_ecdsa_sign is provided by the nonce pool of
+   the application, which computes the nonce points with mbedtls_ecp_mul */
+#if defined(MBEDTLS_ECDSA_SIGN_ALT) && !defined(ECDSA_NONCE_POOL)
 
 #if !defined(MBEDTLS_ECP_ALT)
 #error "MBEDTLS_ECP_ALT must be defined, if MBEDTLS_ECDSA_SIGN_ALT is"
@@ -177,17 +190,419 @@ cleanup:
     return ret;
 }
 
-#endif /* MBEDTLS_ECDSA_SIGN_ALT*/
+#endif /* MBEDTLS_ECDSA_SIGN_ALT && !ECDSA_NONCE_POOL */
 
 #if defined(MBEDTLS_ECDSA_VERIFY_ALT)
 
 #if !defined(MBEDTLS_ECP_ALT)
-#error "MBEDTLS_ECP_ALT must be defined, if MBEDTLS_ECDSA_VERIFY_ALT is"
+/* Without the PKA, the verification runs on the software point multiplication */
+/* of mbedtls, with per-key comb tables kept by ecdsa_cache_stm32             */
+
+#if ST_ECDSA_VERIFY_CACHE
+
+#if MBEDTLS_ECP_FIXED_POINT_OPTIM != 1
+#error "ST_ECDSA_VERIFY_CACHE requires MBEDTLS_ECP_FIXED_POINT_OPTIM"
 #endif
 
+typedef struct ecdsa_cache_entry
+{
+    mbedtls_ecp_group grp;           /* curve with the public key as base point,  */
+                                     /* and the comb table of the key in grp.T    */
+    size_t bytes;                    /* heap taken by the entry                   */
+    uint32_t last_use;
+    uint32_t users;                  /* verifications running with the entry      */
+    int linked;                      /* in the cache list                         */
+    struct ecdsa_cache_entry *next;
+} ecdsa_cache_entry_t;
+
+static ecdsa_cache_entry_t *ecdsa_cache = NULL;
+static size_t ecdsa_cache_bytes = 0;
+static uint32_t ecdsa_cache_clock = 0;
+static ecdsa_cache_stats_t ecdsa_cache_stats = { 0 };
+
+static size_t ecdsa_cache_mpi_bytes( const mbedtls_mpi *X )
+{
+    return( X->MBEDTLS_PRIVATE(n) * sizeof( mbedtls_mpi_uint ) );
+}
+
+static size_t ecdsa_cache_point_bytes( const mbedtls_ecp_point *P )
+{
+    return( ecdsa_cache_mpi_bytes( &P->MBEDTLS_PRIVATE(X) ) +
+            ecdsa_cache_mpi_bytes( &P->MBEDTLS_PRIVATE(Y) ) +
+            ecdsa_cache_mpi_bytes( &P->MBEDTLS_PRIVATE(Z) ) );
+}
+
+static void ecdsa_cache_free_entry( ecdsa_cache_entry_t *entry )
+{
+    /* Frees the curve parameters and the comb table as well */
+    mbedtls_ecp_group_free( &entry->grp );
+    mbedtls_free( entry );
+}
+
+/*
+ * Returns 1 when entry holds the key Q on the curve of grp
+ */
+static int ecdsa_cache_match( const ecdsa_cache_entry_t *entry,
+                              const mbedtls_ecp_group *grp,
+                              const mbedtls_ecp_point *Q )
+{
+    return( ( entry->grp.id == grp->id ) &&
+            ( mbedtls_ecp_point_cmp( &entry->grp.G, Q ) == 0 ) );
+}
+
+/*
+ * A group of the curve of grp with Q as base point. Its comb table is
+ * computed and kept in the group by the first multiplication of its base
+ * point, as mbedtls does for the generator.
+ */
+static ecdsa_cache_entry_t *ecdsa_cache_build( const mbedtls_ecp_group *grp,
+                                               const mbedtls_ecp_point *Q )
+{
+    int ret;
+    ecdsa_cache_entry_t *entry;
+
+    entry = mbedtls_calloc( 1, sizeof( ecdsa_cache_entry_t ) );
+
+    if( entry == NULL )
+        return( NULL );
+
+    mbedtls_ecp_group_init( &entry->grp );
+
+    /* Not static constants, unlike the curves loaded by mbedtls: freed by */
+    /* mbedtls_ecp_group_free                                               */
+    entry->grp.id = grp->id;
+    entry->grp.pbits = grp->pbits;
+    entry->grp.nbits = grp->nbits;
+    entry->grp.MBEDTLS_PRIVATE(modp) = grp->MBEDTLS_PRIVATE(modp);
+
+    /* A = -3 is represented by an empty A */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &entry->grp.P, &grp->P ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &entry->grp.A, &grp->A ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &entry->grp.B, &grp->B ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_copy( &entry->grp.N, &grp->N ) );
+    MBEDTLS_MPI_CHK( mbedtls_ecp_copy( &entry->grp.G, Q ) );
+
+    entry->users = 1U;
+
+cleanup:
+    if( ret != 0 )
+    {
+        ecdsa_cache_free_entry( entry );
+        entry = NULL;
+    }
+
+    return( entry );
+}
+
+/*
+ * The cached entry of Q, or a new one when Q is not in the cache
+ */
+static ecdsa_cache_entry_t *ecdsa_cache_acquire( const mbedtls_ecp_group *grp,
+                                                 const mbedtls_ecp_point *Q )
+{
+    ecdsa_cache_entry_t *entry;
+
+    taskENTER_CRITICAL();
+
+    for( entry = ecdsa_cache; entry != NULL; entry = entry->next )
+    {
+        if( ecdsa_cache_match( entry, grp, Q ) )
+        {
+            entry->users++;
+            entry->last_use = ++ecdsa_cache_clock;
+            ecdsa_cache_stats.hits++;
+            break;
+        }
+    }
+
+    if( entry == NULL )
+        ecdsa_cache_stats.misses++;
+
+    taskEXIT_CRITICAL();
+
+    if( entry == NULL )
+        entry = ecdsa_cache_build( grp, Q );
+
+    return( entry );
+}
 
 /*
- * Verify ECDSA signature of hashed message
+ * Done with entry. A new entry is kept when the signature was valid and its
+ * table fits in the budget, after the least recently used entries which are
+ * not in use.
+ */
+static void ecdsa_cache_release( ecdsa_cache_entry_t *entry, int verified )
+{
+    size_t i;
+    ecdsa_cache_entry_t *victims = NULL;
+    ecdsa_cache_entry_t *victim;
+    ecdsa_cache_entry_t **link;
+    ecdsa_cache_entry_t **victim_link;
+    int keep = 0;
+
+    if( !entry->linked && ( entry->grp.MBEDTLS_PRIVATE(T) != NULL ) )
+    {
+        entry->bytes = sizeof( ecdsa_cache_entry_t ) +
+                       ecdsa_cache_mpi_bytes( &entry->grp.P ) +
+                       ecdsa_cache_mpi_bytes( &entry->grp.A ) +
+                       ecdsa_cache_mpi_bytes( &entry->grp.B ) +
+                       ecdsa_cache_mpi_bytes( &entry->grp.N ) +
+                       ecdsa_cache_point_bytes( &entry->grp.G );
+
+        for( i = 0; i < entry->grp.MBEDTLS_PRIVATE(T_size); i++ )
+        {
+            entry->bytes += sizeof( mbedtls_ecp_point ) +
+                            ecdsa_cache_point_bytes( &entry->grp.MBEDTLS_PRIVATE(T)[i] );
+        }
+    }
+
+    taskENTER_CRITICAL();
+
+    entry->users--;
+
+    if( !entry->linked && verified && ( entry->bytes > 0U ) &&
+        ( entry->bytes <= ST_ECDSA_VERIFY_CACHE_SIZE ) )
+    {
+        keep = 1;
+
+        /* Another verification may have cached the same key meanwhile */
+        for( victim = ecdsa_cache; victim != NULL; victim = victim->next )
+        {
+            if( ecdsa_cache_match( victim, &entry->grp, &entry->grp.G ) )
+                keep = 0;
+        }
+
+        while( keep && ( ecdsa_cache_bytes + entry->bytes > ST_ECDSA_VERIFY_CACHE_SIZE ) )
+        {
+            victim_link = NULL;
+
+            for( link = &ecdsa_cache; *link != NULL; link = &( *link )->next )
+            {
+                if( ( ( *link )->users == 0U ) &&
+                    ( ( victim_link == NULL ) || ( ( *link )->last_use < ( *victim_link )->last_use ) ) )
+                    victim_link = link;
+            }
+
+            if( victim_link == NULL )
+            {
+                /* Every entry is in use */
+                keep = 0;
+            }
+            else
+            {
+                victim = *victim_link;
+                *victim_link = victim->next;
+                victim->linked = 0;
+                victim->next = victims;
+                victims = victim;
+                ecdsa_cache_bytes -= victim->bytes;
+                ecdsa_cache_stats.evictions++;
+            }
+        }
+
+        if( keep )
+        {
+            entry->linked = 1;
+            entry->last_use = ++ecdsa_cache_clock;
+            entry->next = ecdsa_cache;
+            ecdsa_cache = entry;
+            ecdsa_cache_bytes += entry->bytes;
+        }
+    }
+
+    if( entry->linked || ( entry->users > 0U ) )
+        keep = 1;
+
+    ecdsa_cache_stats.bytes = ( uint32_t )ecdsa_cache_bytes;
+
+    taskEXIT_CRITICAL();
+
+    while( victims != NULL )
+    {
+        victim = victims;
+        victims = victim->next;
+        ecdsa_cache_free_entry( victim );
+    }
+
+    if( !keep )
+        ecdsa_cache_free_entry( entry );
+}
+
+void ecdsa_cache_flush( void )
+{
+    ecdsa_cache_entry_t *entries;
+    ecdsa_cache_entry_t *entry;
+    ecdsa_cache_entry_t **link;
+
+    taskENTER_CRITICAL();
+
+    entries = ecdsa_cache;
+    ecdsa_cache = NULL;
+    ecdsa_cache_bytes = 0;
+    ecdsa_cache_stats.bytes = 0;
+
+    /* Entries in use are freed by ecdsa_cache_release */
+    for( link = &entries; *link != NULL; )
+    {
+        entry = *link;
+        entry->linked = 0;
+
+        if( entry->users > 0U )
+            *link = entry->next;
+        else
+            link = &entry->next;
+    }
+
+    taskEXIT_CRITICAL();
+
+    while( entries != NULL )
+    {
+        entry = entries;
+        entries = entry->next;
+        ecdsa_cache_free_entry( entry );
+    }
+}
+
+void ecdsa_cache_get_stats( ecdsa_cache_stats_t *stats )
+{
+    taskENTER_CRITICAL();
+    *stats = ecdsa_cache_stats;
+    taskEXIT_CRITICAL();
+}
+
+#endif /* ST_ECDSA_VERIFY_CACHE */
+
+/*
+ * Convert the hash to an integer modulo n, as ECDSA and mbedtls do
+ */
+static int ecdsa_derive_mpi( const mbedtls_ecp_group *grp, mbedtls_mpi *x,
+                             const unsigned char *buf, size_t blen )
+{
+    int ret;
+    size_t n_size = ( grp->nbits + 7 ) / 8;
+    size_t use_size = ( blen > n_size ) ? n_size : blen;
+
+    MBEDTLS_MPI_CHK( mbedtls_mpi_read_binary( x, buf, use_size ) );
+
+    if( use_size * 8 > grp->nbits )
+        MBEDTLS_MPI_CHK( mbedtls_mpi_shift_r( x, use_size * 8 - grp->nbits ) );
+
+    if( mbedtls_mpi_cmp_mpi( x, &grp->N ) >= 0 )
+        MBEDTLS_MPI_CHK( mbedtls_mpi_sub_mpi( x, x, &grp->N ) );
+
+cleanup:
+    return( ret );
+}
+
+/*
+ * Verify ECDSA signature of hashed message: the steps of mbedtls, with
+ * u2 Q computed from the comb table of Q when it is cached
+ */
+int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
+                          const unsigned char *buf, size_t blen,
+                          const mbedtls_ecp_point *Q,
+                          const mbedtls_mpi *r,
+                          const mbedtls_mpi *s)
+{
+    int ret;
+    mbedtls_mpi e, s_inv, u1, u2;
+    mbedtls_ecp_point R;
+#if ST_ECDSA_VERIFY_CACHE
+    mbedtls_mpi zero, one;
+    mbedtls_ecp_point u2Q;
+    ecdsa_cache_entry_t *entry = NULL;
+#endif
+
+    /* Check parameters */
+    ECDSA_VALIDATE_RET( grp != NULL );
+    ECDSA_VALIDATE_RET( Q   != NULL );
+    ECDSA_VALIDATE_RET( r   != NULL );
+    ECDSA_VALIDATE_RET( s   != NULL );
+    ECDSA_VALIDATE_RET( buf != NULL || blen == 0 );
+
+    /* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
+    if( !mbedtls_ecdsa_can_do( grp->id ) || grp->N.MBEDTLS_PRIVATE(p) == NULL )
+        return( MBEDTLS_ERR_ECP_BAD_INPUT_DATA );
+
+    /* Make sure r and s are in range 1..n-1 */
+    if( mbedtls_mpi_cmp_int( r, 1 ) < 0 || mbedtls_mpi_cmp_mpi( r, &grp->N ) >= 0 ||
+        mbedtls_mpi_cmp_int( s, 1 ) < 0 || mbedtls_mpi_cmp_mpi( s, &grp->N ) >= 0 )
+        return( MBEDTLS_ERR_ECP_VERIFY_FAILED );
+
+    mbedtls_mpi_init( &e );
+    mbedtls_mpi_init( &s_inv );
+    mbedtls_mpi_init( &u1 );
+    mbedtls_mpi_init( &u2 );
+    mbedtls_ecp_point_init( &R );
+#if ST_ECDSA_VERIFY_CACHE
+    mbedtls_mpi_init( &zero );
+    mbedtls_mpi_init( &one );
+    mbedtls_ecp_point_init( &u2Q );
+#endif
+
+    /* u1 = e / s mod n, u2 = r / s mod n */
+    MBEDTLS_MPI_CHK( ecdsa_derive_mpi( grp, &e, buf, blen ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_inv_mod( &s_inv, s, &grp->N ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &u1, &e, &s_inv ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &u1, &u1, &grp->N ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mul_mpi( &u2, r, &s_inv ) );
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &u2, &u2, &grp->N ) );
+
+#if ST_ECDSA_VERIFY_CACHE
+    entry = ecdsa_cache_acquire( grp, Q );
+
+    if( entry != NULL )
+    {
+        /* R = u1 G + u2 Q: u2 Q on the group of Q, which builds or reuses the */
+        /* comb table of Q, then u1 G with the table of the generator          */
+        MBEDTLS_MPI_CHK( mbedtls_mpi_lset( &one, 1 ) );
+        MBEDTLS_MPI_CHK( mbedtls_ecp_muladd( &entry->grp, &u2Q, &u2, &entry->grp.G,
+                                             &zero, &entry->grp.G ) );
+        MBEDTLS_MPI_CHK( mbedtls_ecp_muladd( grp, &R, &u1, &grp->G, &one, &u2Q ) );
+    }
+    else
+#endif
+    {
+        /* R = u1 G + u2 Q */
+        MBEDTLS_MPI_CHK( mbedtls_ecp_muladd( grp, &R, &u1, &grp->G, &u2, Q ) );
+    }
+
+    if( mbedtls_ecp_is_zero( &R ) )
+    {
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+        goto cleanup;
+    }
+
+    /* v = xR mod n must be r */
+    MBEDTLS_MPI_CHK( mbedtls_mpi_mod_mpi( &R.MBEDTLS_PRIVATE(X), &R.MBEDTLS_PRIVATE(X), &grp->N ) );
+
+    if( mbedtls_mpi_cmp_mpi( &R.MBEDTLS_PRIVATE(X), r ) != 0 )
+        ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+
+cleanup:
+#if ST_ECDSA_VERIFY_CACHE
+    /* Only the keys of valid signatures are cached */
+    if( entry != NULL )
+        ecdsa_cache_release( entry, ( ret == 0 ) );
+
+    mbedtls_mpi_free( &zero );
+    mbedtls_mpi_free( &one );
+    mbedtls_ecp_point_free( &u2Q );
+#endif
+    mbedtls_mpi_free( &e );
+    mbedtls_mpi_free( &s_inv );
+    mbedtls_mpi_free( &u1 );
+    mbedtls_mpi_free( &u2 );
+    mbedtls_ecp_point_free( &R );
+
+    return( ret );
+}
+
+#else /* MBEDTLS_ECP_ALT */
+
+/*
+ * Verify ECDSA signature of hashed message with the PKA, in a single
+ * operation from the affine coordinates of the public key
  */
 int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
                           const unsigned char *buf, size_t blen,
@@ -270,11 +685,15 @@ int mbedtls_ecdsa_verify( mbedtls_ecp_group *grp,
     MBEDTLS_MPI_CHK((HAL_PKA_ECDSAVerif_IsValidSignature(&hpka) != 1U) ? MBEDTLS_ERR_ECP_VERIFY_FAILED : 0);
 
 cleanup:
-    /* De-initialize HW peripheral */
-    HAL_PKA_DeInit(&hpka);
+    /* The peripheral is not initialized on early errors */
+    if (hpka.Instance != NULL)
+    {
+        /* De-initialize HW peripheral */
+        HAL_PKA_DeInit(&hpka);
 
-    /* Disable HW peripheral clock */
-    __HAL_RCC_PKA_CLK_DISABLE();
+        /* Disable HW peripheral clock */
+        __HAL_RCC_PKA_CLK_DISABLE();
+    }
 
     /* Free memory */
     if (Q_binary != NULL)
@@ -298,6 +717,8 @@ cleanup:
     return ret;
 }
 
+#endif /* MBEDTLS_ECP_ALT */
+
 #endif /* MBEDTLS_ECDSA_VERIFY_ALT*/
 
 #endif /* MBEDTLS_ECDSA_C */
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @brief   Header file of the cache of ECDSA public key comb tables.
+  ******************************************************************************
+  * @attention
+  *
+  *  Copyright (C) 2019-2020 STMicroelectronics, All Rights Reserved
+  *
+  * This software component is licensed by ST under Apache 2.0 license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  * https://opensource.org/licenses/Apache-2.0
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ECDSA_CACHE_H
+#define __ECDSA_CACHE_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* constants -----------------------------------------------------------------*/
+/* Without MBEDTLS_ECP_ALT, mbedtls_ecdsa_verify computes u1 G + u2 Q in     */
+/* software. mbedtls keeps a comb table of multiples of the generator G, but */
+/* computes u2 Q without precomputation. The same certificate chains are     */
+/* however verified again on every connection, with the same few public      */
+/* keys. mbedtls_ecdsa_verify keeps in RAM the comb tables of the keys of    */
+/* the last successful verifications, and computes u2 Q from the table of Q  */
+/* on a match. The PKA verification of MBEDTLS_ECP_ALT does not use it.      */
+#if !defined(ST_ECDSA_VERIFY_CACHE)
+#define ST_ECDSA_VERIFY_CACHE         1
+#endif
+
+/* RAM budget of the cache, in bytes: a P-256 key takes about 1.2 KB         */
+#if !defined(ST_ECDSA_VERIFY_CACHE_SIZE)
+#define ST_ECDSA_VERIFY_CACHE_SIZE    4096U
+#endif
+
+/* types ---------------------------------------------------------------------*/
+typedef struct
+{
+    uint32_t hits;           /* verifications with the table of the key       */
+    uint32_t misses;         /* verifications of a key not in the cache       */
+    uint32_t evictions;      /* keys replaced while the cache was full        */
+    uint32_t bytes;          /* RAM taken by the cached keys                  */
+} ecdsa_cache_stats_t;
+
+/* functions prototypes ------------------------------------------------------*/
+/* Forget all the cached keys                                                */
+extern void ecdsa_cache_flush(void);
+
+extern void ecdsa_cache_get_stats(ecdsa_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*__ECDSA_CACHE_H */
@@ -26,6 +26,7 @@
 
 #include <string.h>
 
+#include "mbedtls/error.h"
 #include "mbedtls/platform_util.h"
 #include "mbedtls/platform.h"
 
@@ -58,18 +59,14 @@ void mbedtls_gcm_init( mbedtls_gcm_context *ctx )
     GCM_VALIDATE( ctx != NULL );
 
     __disable_irq();
-#if defined(MBEDTLS_THREADING_C)
-    /* mutex cannot be initialized twice */
-if ( !cryp_mutex_started )
-{
-    mbedtls_mutex_init( &cryp_mutex );
-    cryp_mutex_started = 1;
-}
-#endif /* MBEDTLS_THREADING_C */
     cryp_context_count++;
     __enable_irq();
 
     cryp_zeroize( (void*)ctx, sizeof(mbedtls_gcm_context) );
+
+#if ST_SW_DISPATCH
+    st_sw_gcm_init( &ctx->sw_key );
+#endif
 }
 
 int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
@@ -83,12 +80,8 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
     GCM_VALIDATE_RET( ctx != NULL );
     GCM_VALIDATE_RET( key != NULL );
 
-    /* Protect context access                                  */
-    /* (it may occur at a same time in a threaded environment) */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_lock( &cryp_mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
-#endif /* MBEDTLS_THREADING_C */
+    /* Wait for the CRYP: HAL_CRYP_Init may reset the peripheral */
+    (void) crypto_sched_acquire( &cryp_sched, &ctx->hw_ctx );
 
     switch (keybits)
     {
@@ -141,33 +134,33 @@ int mbedtls_gcm_setkey( mbedtls_gcm_context *ctx,
     }
 
     /* allow multi-context of CRYP : save context */
-    ctx->ctx_save_cr = ctx->hcryp_gcm.Instance->CR;
+    cryp_context_save( &ctx->hcryp_gcm, &ctx->hw_ctx );
+
+#if ST_SW_DISPATCH
+    st_sw_gcm_setkey( &ctx->sw_key, key, keybits );
+#endif
 
 exit :
     /* Free context access */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &cryp_mutex ) != 0 )
-        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
-#endif /* MBEDTLS_THREADING_C */
+    crypto_sched_release( &cryp_sched );
 
     return( ret );
 }
 
-int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
-                int mode,
-                const unsigned char *iv,
-                size_t iv_len,
-                const unsigned char *add,
-                size_t add_len )
+/*
+ * Start a message. The AAD is passed to the peripheral with the first payload
+ * (or by mbedtls_gcm_finish when there is none): add must remain valid until
+ * then.
+ */
+static int gcm_start( mbedtls_gcm_context *ctx,
+                      int mode,
+                      const unsigned char *iv,
+                      size_t iv_len,
+                      const unsigned char *add,
+                      size_t add_len )
 {
     int ret = 0;
     unsigned int i;
-   __ALIGN_BEGIN static uint32_t iv_32B[4] __ALIGN_END;
-
-    GCM_VALIDATE_RET( ctx != NULL );
-    GCM_VALIDATE_RET( mode != MBEDTLS_GCM_ENCRYPT || mode != MBEDTLS_GCM_DECRYPT );
-    GCM_VALIDATE_RET( iv != NULL );
-    GCM_VALIDATE_RET( add_len == 0 || add != NULL );
 
     /* IV and AD are limited to 2^64 bits, so 2^61 bytes */
     /* IV is not allowed to be zero length */
@@ -194,10 +187,7 @@ int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
 
     /* Protect context access                                  */
     /* (it may occur at a same time in a threaded environment) */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_lock( &cryp_mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
-#endif /* MBEDTLS_THREADING_C */
+    (void) crypto_sched_acquire( &cryp_sched, &ctx->hw_ctx );
 
     if ( HAL_CRYP_Init( &ctx->hcryp_gcm ) != HAL_OK )
     {
@@ -206,20 +196,24 @@ int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
     }
 
     /* allow multi-context of CRYP use: restore context */
-    ctx->hcryp_gcm.Instance->CR = ctx->ctx_save_cr;
+    /* (a new message starts: key, IV and GHASH are reloaded by the HAL) */
+    ctx->hcryp_gcm.Instance->CR = ctx->hw_ctx.cr;
 
     ctx->mode = mode;
     ctx->len = 0;
+    ctx->hdr_done = 0;
 
     /* Set IV with invert endianness */
     for( i=0; i < 3; i++ )
-        GET_UINT32_BE( iv_32B[i], iv, 4*i );
+        GET_UINT32_BE( ctx->gcm_iv[i], iv, 4*i );
 
     /* According to NIST specification, the counter value is 0x2 when
        processing the first block of payload */
-    iv_32B[3] = 0x00000002;
+    ctx->gcm_iv[3] = 0x00000002;
 
-    ctx->hcryp_gcm.Init.pInitVect = iv_32B;
+    /* The IV is only loaded by the first update: keep it in the context, */
+    /* other contexts may start a message in the meantime                 */
+    ctx->hcryp_gcm.Init.pInitVect = ctx->gcm_iv;
 
     if ( add_len > 0 )
     {
@@ -254,112 +248,235 @@ int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
     }
 
     /* allow multi-context of CRYP : save context */
-    ctx->ctx_save_cr = ctx->hcryp_gcm.Instance->CR;
+    cryp_context_save( &ctx->hcryp_gcm, &ctx->hw_ctx );
 
 exit:
     /* Free context access */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &cryp_mutex ) != 0 )
-        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
-#endif /* MBEDTLS_THREADING_C */
+    crypto_sched_release( &cryp_sched );
 
     return( ret );
 }
 
-int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
-                size_t length,
-                const unsigned char *input,
-                unsigned char *output )
+/*
+ * Run the init and header phases of the message without payload. Must be
+ * called with cryp_sched owned and the context loaded.
+ */
+static int gcm_process_header( mbedtls_gcm_context *ctx )
+{
+    HAL_StatusTypeDef status;
+    uint32_t none = 0;
+
+    if ( ctx->mode == MBEDTLS_GCM_DECRYPT )
+        status = HAL_CRYP_Decrypt( &ctx->hcryp_gcm, &none, 0, &none,
+                                   ST_CRYP_TIMEOUT );
+    else
+        status = HAL_CRYP_Encrypt( &ctx->hcryp_gcm, &none, 0, &none,
+                                   ST_CRYP_TIMEOUT );
+
+    if ( status != HAL_OK )
+        return( MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED );
+
+    ctx->hdr_done = 1;
+
+    return( 0 );
+}
+
+int mbedtls_gcm_starts( mbedtls_gcm_context *ctx,
+                        int mode,
+                        const unsigned char *iv,
+                        size_t iv_len )
+{
+    GCM_VALIDATE_RET( ctx != NULL );
+    GCM_VALIDATE_RET( mode == MBEDTLS_GCM_ENCRYPT || mode == MBEDTLS_GCM_DECRYPT );
+    GCM_VALIDATE_RET( iv != NULL );
+
+    return( gcm_start( ctx, mode, iv, iv_len, NULL, 0 ) );
+}
+
+int mbedtls_gcm_update_ad( mbedtls_gcm_context *ctx,
+                           const unsigned char *add,
+                           size_t add_len )
 {
     int ret = 0;
 
     GCM_VALIDATE_RET( ctx != NULL );
-    GCM_VALIDATE_RET( length == 0 || input != NULL );
-    GCM_VALIDATE_RET( length == 0 || output != NULL );
+    GCM_VALIDATE_RET( add_len == 0 || add != NULL );
 
-    if( output > input && (size_t) ( output - input ) < length )
+    /* AD is limited to 2^64 bits, so 2^61 bytes */
+    if( ( (uint64_t) add_len ) >> 61 != 0 )
         return( MBEDTLS_ERR_GCM_BAD_INPUT );
 
-    /* Total length is restricted to 2^39 - 256 bits, ie 2^36 - 2^5 bytes
-     * Also check for possible overflow */
-    if( ( (ctx->len + length) < ctx->len ) ||
-        ( (uint64_t)(ctx->len + length) > 0xFFFFFFFE0ull ) )
-    {
+    /* AD must be given before the payload */
+    if( ctx->len != 0 )
         return( MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    if( add_len == 0 )
+        return( 0 );
+
+    /* implementation restrict support to a single AD buffer: the CRYP */
+    /* closes its header phase when the buffer has been processed      */
+    if( ctx->hdr_done || ( ctx->hcryp_gcm.Init.HeaderSize != 0 ) )
+        return( MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED );
+
+#if !defined(STM32_AAD_ANY_LENGTH_SUPPORT)
+    /* implementation restrict support to a buffer multiple of 32 bits */
+    if ((add_len % AAD_WORD_ALIGN) != 0U)
+    {
+        return( MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED );
     }
+#endif
 
     /* Protect context access                                  */
     /* (it may occur at a same time in a threaded environment) */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_lock( &cryp_mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
-#endif /* MBEDTLS_THREADING_C */
+    /* allow multi-context of CRYP use: restore context if needed */
+    if ( !crypto_sched_acquire( &cryp_sched, &ctx->hw_ctx ) )
+        cryp_context_restore( &ctx->hcryp_gcm, &ctx->hw_ctx );
 
-    /* allow multi-context of CRYP use: restore context */
-    ctx->hcryp_gcm.Instance->CR = ctx->ctx_save_cr;
+    ctx->hcryp_gcm.Init.Header = (uint32_t *)add;
+#if defined(STM32_AAD_ANY_LENGTH_SUPPORT)
+    ctx->hcryp_gcm.Init.HeaderSize = (uint32_t)add_len;
+#else
+    ctx->hcryp_gcm.Init.HeaderSize = (uint32_t)(add_len/AAD_WORD_ALIGN);
+#endif
 
-    ctx->len += length;
+    /* Process the AD now: the caller may release add after this call */
+    if ( HAL_CRYP_SetConfig( &ctx->hcryp_gcm, &ctx->hcryp_gcm.Init ) != HAL_OK )
+    {
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        goto exit;
+    }
 
-    if( ctx->mode == MBEDTLS_GCM_DECRYPT )
+    ret = gcm_process_header( ctx );
+    if ( ret != 0 )
     {
-         if ( HAL_CRYP_Decrypt( &ctx->hcryp_gcm,
-                               (uint32_t *)input,
-                               length,
-                               (uint32_t *)output,
-                               ST_CRYP_TIMEOUT ) != HAL_OK )
-         {
-            ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-            goto exit;
-         }
+        goto exit;
     }
-    else
+
+    /* allow multi-context of CRYP : save context */
+    cryp_context_save( &ctx->hcryp_gcm, &ctx->hw_ctx );
+
+exit:
+    /* The buffer is no longer referenced */
+    ctx->hcryp_gcm.Init.Header = NULL;
+
+    /* Free context access */
+    crypto_sched_release( &cryp_sched );
+
+    return( ret );
+}
+
+int mbedtls_gcm_update( mbedtls_gcm_context *ctx,
+                        const unsigned char *input,
+                        size_t input_length,
+                        unsigned char *output,
+                        size_t output_size,
+                        size_t *output_length )
+{
+    int ret = 0;
+
+    GCM_VALIDATE_RET( ctx != NULL );
+    GCM_VALIDATE_RET( input_length == 0 || input != NULL );
+    GCM_VALIDATE_RET( input_length == 0 || output != NULL );
+    GCM_VALIDATE_RET( output_length != NULL );
+
+    *output_length = 0;
+
+    /* The payload is output as it is processed: nothing is buffered */
+    if( output_size < input_length )
+        return( MBEDTLS_ERR_GCM_BUFFER_TOO_SMALL );
+
+    if( input_length == 0 )
+        return( 0 );
+
+    if( output > input && (size_t) ( output - input ) < input_length )
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    /* Total length is restricted to 2^39 - 256 bits, ie 2^36 - 2^5 bytes
+     * Also check for possible overflow */
+    if( ( (ctx->len + input_length) < ctx->len ) ||
+        ( (uint64_t)(ctx->len + input_length) > 0xFFFFFFFE0ull ) )
     {
-         if ( HAL_CRYP_Encrypt( &ctx->hcryp_gcm,
-                               (uint32_t *)input,
-                               length,
-                               (uint32_t *)output,
-                               ST_CRYP_TIMEOUT ) != HAL_OK )
-         {
-            ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-            goto exit;
-         }
+        return( MBEDTLS_ERR_GCM_BAD_INPUT );
+    }
+
+    /* implementation restrict support to a partial block at the end of */
+    /* the payload only                                                 */
+    if( ( ctx->len % 16U ) != 0U )
+        return( MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED );
+
+    /* Protect context access                                  */
+    /* (it may occur at a same time in a threaded environment) */
+    /* allow multi-context of CRYP use: restore context if another one */
+    /* used the CRYP since this context released it                    */
+    if ( !crypto_sched_acquire( &cryp_sched, &ctx->hw_ctx ) )
+        cryp_context_restore( &ctx->hcryp_gcm, &ctx->hw_ctx );
+
+    /* Large payloads are transferred by DMA: the calling task blocks and   */
+    /* other tasks run until the CRYP has processed the whole record. Long  */
+    /* payloads are processed in chunks, so that other contexts waiting for */
+    /* the CRYP are served in between                                       */
+    ret = cryp_process( &ctx->hcryp_gcm,
+                        ( ctx->mode == MBEDTLS_GCM_DECRYPT ),
+                        input,
+                        input_length,
+                        output,
+                        &ctx->hw_ctx );
+    if ( ret != 0 )
+    {
+        goto exit;
     }
 
+    ctx->len += input_length;
+    ctx->hdr_done = 1;
+    *output_length = input_length;
+
     /* allow multi-context of CRYP : save context */
-    ctx->ctx_save_cr = ctx->hcryp_gcm.Instance->CR;
+    cryp_context_save( &ctx->hcryp_gcm, &ctx->hw_ctx );
 
 exit:
     /* Free context access */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &cryp_mutex ) != 0 )
-        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
-#endif /* MBEDTLS_THREADING_C */
+    crypto_sched_release( &cryp_sched );
 
     return( ret );
 }
 
 int mbedtls_gcm_finish( mbedtls_gcm_context *ctx,
-                unsigned char *tag,
-                size_t tag_len )
+                        unsigned char *output,
+                        size_t output_size,
+                        size_t *output_length,
+                        unsigned char *tag,
+                        size_t tag_len )
 {
     int ret = 0;
     __ALIGN_BEGIN uint8_t mac[16]      __ALIGN_END; /* temporary mac         */
 
     GCM_VALIDATE_RET( ctx != NULL );
+    GCM_VALIDATE_RET( output_length != NULL );
     GCM_VALIDATE_RET( tag != NULL );
 
+    /* mbedtls_gcm_update does not buffer any payload */
+    (void) output;
+    (void) output_size;
+    *output_length = 0;
+
     if( tag_len > 16 || tag_len < 4 )
         return( MBEDTLS_ERR_GCM_BAD_INPUT );
 
     /* Protect context access                                  */
     /* (it may occur at a same time in a threaded environment) */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_lock( &cryp_mutex ) != 0 )
-        return( MBEDTLS_ERR_THREADING_MUTEX_ERROR );
-#endif /* MBEDTLS_THREADING_C */
+    /* allow multi-context of CRYP use: restore context if needed */
+    if ( !crypto_sched_acquire( &cryp_sched, &ctx->hw_ctx ) )
+        cryp_context_restore( &ctx->hcryp_gcm, &ctx->hw_ctx );
 
-    /* allow multi-context of CRYP use: restore context */
-    ctx->hcryp_gcm.Instance->CR = ctx->ctx_save_cr;
+    /* Without payload, the init and header phases are still to be done */
+    if ( !ctx->hdr_done )
+    {
+        ret = gcm_process_header( ctx );
+        if ( ret != 0 )
+        {
+            goto exit;
+        }
+    }
 
     /* Tag has a variable length */
     memset(mac, 0, sizeof(mac));
@@ -376,18 +493,97 @@ int mbedtls_gcm_finish( mbedtls_gcm_context *ctx,
     memcpy( tag, mac, tag_len );
 
     /* allow multi-context of CRYP : save context */
-    ctx->ctx_save_cr = ctx->hcryp_gcm.Instance->CR;
+    cryp_context_save( &ctx->hcryp_gcm, &ctx->hw_ctx );
 
 exit:
     /* Free context access */
-#if defined(MBEDTLS_THREADING_C)
-    if( mbedtls_mutex_unlock( &cryp_mutex ) != 0 )
-        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
-#endif /* MBEDTLS_THREADING_C */
+    crypto_sched_release( &cryp_sched );
 
     return( ret );
 }
 
+/* One shot message: the AD is processed with the first payload block */
+static int gcm_crypt_and_tag( mbedtls_gcm_context *ctx,
+                              int mode,
+                              size_t length,
+                              const unsigned char *iv,
+                              size_t iv_len,
+                              const unsigned char *add,
+                              size_t add_len,
+                              const unsigned char *input,
+                              unsigned char *output,
+                              size_t tag_len,
+                              unsigned char *tag )
+{
+    int ret;
+    size_t olen;
+
+    if( ( ret = gcm_start( ctx, mode, iv, iv_len, add, add_len ) ) != 0 )
+        return( ret );
+
+    if( ( ret = mbedtls_gcm_update( ctx, input, length,
+                                    output, length, &olen ) ) != 0 )
+        return( ret );
+
+    if( ( ret = mbedtls_gcm_finish( ctx, NULL, 0, &olen, tag, tag_len ) ) != 0 )
+        return( ret );
+
+    return( 0 );
+}
+
+#if ST_SW_DISPATCH
+/* Software path: short records do not pay the CRYP init and GCM phases */
+st_sw_dispatch_t st_gcm_dispatch = ST_SW_DISPATCH_INIT( ST_GCM_SW_THRESHOLD );
+
+#if ST_SW_CALIBRATE
+static const unsigned char st_gcm_bench_iv[IV_LENGTH] = { 0 };
+
+static int st_gcm_bench_hw( void *arg, unsigned char *buf, size_t len )
+{
+    unsigned char tag[16];
+
+    return( gcm_crypt_and_tag( (mbedtls_gcm_context *) arg,
+                               MBEDTLS_GCM_ENCRYPT, len,
+                               st_gcm_bench_iv, IV_LENGTH, NULL, 0,
+                               buf, buf, sizeof( tag ), tag ) );
+}
+
+static int st_gcm_bench_sw( void *arg, unsigned char *buf, size_t len )
+{
+    mbedtls_gcm_context *ctx = (mbedtls_gcm_context *) arg;
+    unsigned char tag[16];
+
+    return( st_sw_gcm_crypt_and_tag( &ctx->sw_key, 0, len, st_gcm_bench_iv,
+                                     NULL, 0, buf, buf, sizeof( tag ), tag ) );
+}
+
+/*
+ * Measure the threshold once at init, on a throwaway key, instead of in the
+ * first message of the application
+ */
+void st_gcm_sw_calibrate( void )
+{
+    static const unsigned char key[16] = { 0 };
+    mbedtls_gcm_context *ctx;
+
+    ctx = mbedtls_calloc( 1, sizeof( mbedtls_gcm_context ) );
+    if ( ctx == NULL )
+        return;
+
+    mbedtls_gcm_init( ctx );
+
+    if ( ( mbedtls_gcm_setkey( ctx, MBEDTLS_CIPHER_ID_AES, key, 128 ) == 0 ) &&
+         ( ctx->sw_key.keybits != 0 ) )
+    {
+        st_sw_calibrate( &st_gcm_dispatch, st_gcm_bench_hw, st_gcm_bench_sw, ctx );
+    }
+
+    mbedtls_gcm_free( ctx );
+    mbedtls_free( ctx );
+}
+#endif /* ST_SW_CALIBRATE */
+#endif /* ST_SW_DISPATCH */
+
 int mbedtls_gcm_crypt_and_tag( mbedtls_gcm_context *ctx,
                        int mode,
                        size_t length,
@@ -400,8 +596,6 @@ int mbedtls_gcm_crypt_and_tag( mbedtls_gcm_context *ctx,
                        size_t tag_len,
                        unsigned char *tag )
 {
-    int ret;
-
     GCM_VALIDATE_RET( ctx != NULL );
     GCM_VALIDATE_RET( iv != NULL );
     GCM_VALIDATE_RET( add_len == 0 || add != NULL );
@@ -409,16 +603,22 @@ int mbedtls_gcm_crypt_and_tag( mbedtls_gcm_context *ctx,
     GCM_VALIDATE_RET( length == 0 || output != NULL );
     GCM_VALIDATE_RET( tag != NULL );
 
-    if( ( ret = mbedtls_gcm_starts( ctx, mode, iv, iv_len, add, add_len ) ) != 0 )
-        return( ret );
-
-    if( ( ret = mbedtls_gcm_update( ctx, length, input, output ) ) != 0 )
-        return( ret );
+#if ST_SW_DISPATCH
+    if ( ( iv_len == IV_LENGTH ) && ( ctx->sw_key.keybits != 0 ) &&
+         st_sw_dispatch( &st_gcm_dispatch, length + add_len ) )
+    {
+        if( tag_len > 16 || tag_len < 4 )
+            return( MBEDTLS_ERR_GCM_BAD_INPUT );
 
-    if( ( ret = mbedtls_gcm_finish( ctx, tag, tag_len ) ) != 0 )
-        return( ret );
+        return( st_sw_gcm_crypt_and_tag( &ctx->sw_key,
+                                         ( mode == MBEDTLS_GCM_DECRYPT ),
+                                         length, iv, add, add_len,
+                                         input, output, tag_len, tag ) );
+    }
+#endif
 
-    return( 0 );
+    return( gcm_crypt_and_tag( ctx, mode, length, iv, iv_len, add, add_len,
+                               input, output, tag_len, tag ) );
 }
 
 int mbedtls_gcm_auth_decrypt( mbedtls_gcm_context *ctx,
@@ -472,19 +672,21 @@ void mbedtls_gcm_free( mbedtls_gcm_context *ctx )
     __disable_irq();
     if ( cryp_context_count > 0 )
         cryp_context_count--;
-
-#if defined(MBEDTLS_THREADING_C)
-    if ( cryp_mutex_started )
-    {
-        mbedtls_mutex_free( &cryp_mutex );
-        cryp_mutex_started = 0;
-    }
-#endif /* MBEDTLS_THREADING_C */
     __enable_irq();
 
     /* Shut down CRYP on last context */
     if ( cryp_context_count == 0 )
+    {
+        (void) crypto_sched_acquire( &cryp_sched, &ctx->hw_ctx );
         HAL_CRYP_DeInit( &ctx->hcryp_gcm );
+        crypto_sched_release( &cryp_sched );
+    }
+
+    crypto_sched_forget( &cryp_sched, &ctx->hw_ctx );
+
+#if ST_SW_DISPATCH
+    st_sw_gcm_free( &ctx->sw_key );
+#endif
 
     cryp_zeroize( (void*)ctx, sizeof(mbedtls_gcm_context) );
 }
@@ -38,6 +38,7 @@
 #if defined(MBEDTLS_GCM_ALT)
 /* Includes ------------------------------------------------------------------*/
 #include "cryp_stm32.h"
+#include "crypto_sw_stm32.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,12 +54,19 @@ typedef struct mbedtls_gcm_context
     /* Encryption/Decryption key */
     uint32_t gcm_key[8];
 
+    /* Initialization vector of the current message */
+    uint32_t gcm_iv[4];
+
     CRYP_HandleTypeDef hcryp_gcm;      /* HW driver handle                    */
-    uint32_t ctx_save_cr;              /* save context for multi-context  */
+    cryp_hw_context_t hw_ctx;          /* save context for multi-context      */
     uint64_t len;                      /* total length of the encrypted data. */
+    int hdr_done;                      /* init and header phases processed    */
     int mode;                          /* The operation to perform:
                                                #MBEDTLS_GCM_ENCRYPT or
                                                #MBEDTLS_GCM_DECRYPT.          */
+#if ST_SW_DISPATCH
+    st_sw_gcm_key_t sw_key;            /* Key for short messages              */
+#endif
 }
 mbedtls_gcm_context;
 
@@ -28,17 +28,29 @@
 #if defined(MBEDTLS_SHA1_ALT) || defined(MBEDTLS_SHA256_ALT) || defined(MBEDTLS_MD5_ALT)
 
 #include "hash_stm32.h"
+#include "mbedtls/error.h"
 
-/* Variables -----------------------------------------------------------------*/
-/* Mutex protection because of one Hash Hw instance is shared over several   */
-/* algorithms (SHA-1, SHA-256, MD5 implementations may be enabled together)  */
-#if defined(MBEDTLS_THREADING_C)
-mbedtls_threading_mutex_t hash_mutex;
-unsigned char hash_mutex_started = 0;
-#endif /* MBEDTLS_THREADING_C */
+#if (ST_HASH_USE_DMA == 1)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif /* ST_HASH_USE_DMA */
 
+/* Variables -----------------------------------------------------------------*/
+/* One Hash Hw instance is shared over several algorithms (SHA-1, SHA-256,   */
+/* MD5 implementations may be enabled together): access is arbitrated by    */
+/* hash_sched (see crypto_sched_stm32.c)                                     */
 unsigned int hash_context_count = 0;
 
+#if (ST_HASH_USE_DMA == 1)
+static DMA_HandleTypeDef hash_hdma_in;
+static unsigned char hash_dma_initialized = 0;
+static TaskHandle_t volatile hash_dma_task = NULL;
+static volatile HAL_StatusTypeDef hash_dma_status = HAL_OK;
+
+/* Read by the application's interrupt handler of the channel */
+extern DMA_HandleTypeDef * ST_HASH_DMA_HANDLE;
+#endif /* ST_HASH_USE_DMA */
+
 /* Functions -----------------------------------------------------------------*/
 
 /* Implementation that should never be optimized out by the compiler */
@@ -51,4 +63,159 @@ void hash_zeroize( void *v, size_t n )
     }
 }
 
+#if (ST_HASH_USE_DMA == 1)
+/* Configure the GPDMA channel used to feed the HASH FIFO.                   */
+/* Called with hash_sched owned on the first DMA transfer.                   */
+static int hash_dma_init(void)
+{
+    if (hash_dma_initialized)
+        return( 0 );
+
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+
+    hash_hdma_in.Instance                     = ST_HASH_DMA_CHANNEL;
+    hash_hdma_in.Init.Request                 = GPDMA1_REQUEST_HASH_IN;
+    hash_hdma_in.Init.BlkHWRequest            = DMA_BREQ_SINGLE_BURST;
+    hash_hdma_in.Init.Direction               = DMA_MEMORY_TO_PERIPH;
+    hash_hdma_in.Init.SrcInc                  = DMA_SINC_INCREMENTED;
+    hash_hdma_in.Init.DestInc                 = DMA_DINC_FIXED;
+    hash_hdma_in.Init.SrcDataWidth            = DMA_SRC_DATAWIDTH_WORD;
+    hash_hdma_in.Init.DestDataWidth           = DMA_DEST_DATAWIDTH_WORD;
+    hash_hdma_in.Init.Priority                = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+    hash_hdma_in.Init.SrcBurstLength          = 1;
+    hash_hdma_in.Init.DestBurstLength         = 1;
+    hash_hdma_in.Init.TransferAllocatedPort   = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT1;
+    hash_hdma_in.Init.TransferEventMode       = DMA_TCEM_BLOCK_TRANSFER;
+    hash_hdma_in.Init.Mode                    = DMA_NORMAL;
+
+    if ( ( HAL_DMA_Init( &hash_hdma_in ) != HAL_OK ) ||
+         ( HAL_DMA_ConfigChannelAttributes( &hash_hdma_in, DMA_CHANNEL_NPRIV ) != HAL_OK ) )
+    {
+        return( -1 );
+    }
+
+    ST_HASH_DMA_HANDLE = &hash_hdma_in;
+
+    HAL_NVIC_SetPriority( ST_HASH_DMA_IRQn, ST_HASH_DMA_IRQ_PRIORITY, 0 );
+    HAL_NVIC_EnableIRQ( ST_HASH_DMA_IRQn );
+
+    hash_dma_initialized = 1;
+
+    return( 0 );
+}
+
+/* DMA is only worth its setup cost for larger inputs, requires a word      */
+/* aligned buffer and a running scheduler to block the caller. GPDMA reads  */
+/* the internal flash as well as SRAM.                                       */
+int hash_dma_usable(const unsigned char *input, size_t length)
+{
+    if ( length < ST_HASH_DMA_THRESHOLD )
+        return( 0 );
+
+    if ( ( (uintptr_t) input & 0x3U ) != 0U )
+        return( 0 );
+
+    if ( ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) ||
+         ( __get_IPSR() != 0U ) )
+        return( 0 );
+
+    return( hash_dma_init() == 0 );
+}
+
+static void hash_dma_complete(HAL_StatusTypeDef status)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    hash_dma_status = status;
+
+    if ( hash_dma_task != NULL )
+    {
+        vTaskNotifyGiveIndexedFromISR( hash_dma_task, ST_HASH_NOTIFY_IDX,
+                                       &xHigherPriorityTaskWoken );
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+static void hash_dma_in_cplt(HASH_HandleTypeDef *hhash)
+{
+    (void) hhash;
+    hash_dma_complete( HAL_OK );
+}
+
+static void hash_dma_error(HASH_HandleTypeDef *hhash)
+{
+    (void) hhash;
+    hash_dma_complete( HAL_ERROR );
+}
+
+int hash_accumulate_dma(HASH_HandleTypeDef *hhash, hash_dma_start_t start,
+                        const unsigned char *input, size_t length)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+    size_t chunk;
+
+    /* The DMA handle is shared by all contexts: attach it to this one */
+    __HAL_LINKDMA( hhash, hdmain, hash_hdma_in );
+
+    /* Completion is reported to this handle only, other users of the HASH */
+    /* HAL keep their own callbacks                                        */
+    if ( ( HAL_HASH_RegisterCallback( hhash, HAL_HASH_INPUTCPLT_CB_ID,
+                                      hash_dma_in_cplt ) != HAL_OK ) ||
+         ( HAL_HASH_RegisterCallback( hhash, HAL_HASH_ERROR_CB_ID,
+                                      hash_dma_error ) != HAL_OK ) )
+    {
+        return( MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED );
+    }
+
+    hash_dma_task = xTaskGetCurrentTaskHandle();
+
+    while ( ( status == HAL_OK ) && ( length > 0 ) )
+    {
+        chunk = ( length > ST_HASH_DMA_CHUNK ) ? ST_HASH_DMA_CHUNK : length;
+
+        hash_dma_status = HAL_OK;
+
+        /* Multiple DMA transfers: the digest is only computed by the CPU    */
+        /* feeding the last bytes of the message (HAL_HASHEx_xxx_Accmlt_End) */
+        __HAL_HASH_SET_MDMAT();
+
+        status = start( hhash, (uint8_t *)input, (uint32_t)chunk );
+
+        if ( status == HAL_OK )
+        {
+            if ( ulTaskNotifyTakeIndexed( ST_HASH_NOTIFY_IDX, pdTRUE,
+                                          pdMS_TO_TICKS( ST_HASH_TIMEOUT ) ) == 0 )
+            {
+                /* Stop the transfer and return the handle to a usable state */
+                (void) HAL_DMA_Abort( &hash_hdma_in );
+                hhash->State = HAL_HASH_STATE_READY;
+                __HAL_UNLOCK( hhash );
+                status = HAL_TIMEOUT;
+
+                /* The completion may have been given between the timeout and */
+                /* the abort: do not leave it pending for the next transfer   */
+                (void) ulTaskNotifyTakeIndexed( ST_HASH_NOTIFY_IDX, pdTRUE, 0 );
+            }
+            else
+            {
+                status = hash_dma_status;
+            }
+        }
+
+        /* Give the FIFO back to the CPU for the following accumulations */
+        CLEAR_BIT( HASH->CR, HASH_CR_DMAE );
+        __HAL_HASH_RESET_MDMAT();
+
+        input += chunk;
+        length -= chunk;
+    }
+
+    hash_dma_task = NULL;
+
+    return( ( status == HAL_OK ) ? 0 : MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED );
+}
+
+#endif /* ST_HASH_USE_DMA */
+
 #endif /* MBEDTLS_SHA1_ALT or MBEDTLS_SHA256_ALT or MBEDTLS_MD5_ALT */
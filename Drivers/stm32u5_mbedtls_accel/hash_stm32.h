@@ -28,27 +28,78 @@
 /* Includes ------------------------------------------------------------------*/
 /* include the appropriate header file */
 #include "stm32u5xx_hal.h"
-
-#if defined(MBEDTLS_THREADING_C)
-#include "mbedtls/threading.h"
-#endif
+#include "crypto_sched_stm32.h"
 
 /* macros --------------------------------------------------------------------*/
 /* constants -----------------------------------------------------------------*/
 #define ST_HASH_TIMEOUT ((uint32_t) 1000)  /* TO in ms for the hash processor */
 
+/* DMA mode: contiguous inputs of at least ST_HASH_DMA_THRESHOLD bytes       */
+/* (RAM or flash resident) are fed to the HASH by GPDMA while the calling    */
+/* task blocks on a task notification. Shorter inputs, unaligned buffers and */
+/* calls made before the scheduler is started are written by the CPU.        */
+#if !defined(ST_HASH_USE_DMA)
+#define ST_HASH_USE_DMA           1
+#endif
+
+#if !defined(ST_HASH_DMA_THRESHOLD)
+#define ST_HASH_DMA_THRESHOLD     1024U /* minimum input (in bytes) for DMA   */
+#endif
+
+/* Largest DMA transfer: the peripheral is handed over to waiting contexts  */
+/* between transfers. Multiple of 64 bytes, at most 65535 (GPDMA block).    */
+#if !defined(ST_HASH_DMA_CHUNK)
+#define ST_HASH_DMA_CHUNK         16384U
+#endif
+
+/* A task waits for a single transfer at a time: the index is shared with   */
+/* the CRYP DMA                                                             */
+#if !defined(ST_HASH_NOTIFY_IDX)
+#define ST_HASH_NOTIFY_IDX        7U    /* task notification index           */
+#endif
+
+/* The interrupt vector of the DMA channel belongs to the application: its  */
+/* handler calls HAL_DMA_IRQHandler on the handle published in              */
+/* ST_HASH_DMA_HANDLE (see Common/sys/interrupt_handlers.c). The HASH       */
+/* completion callbacks are registered on each handle, which requires      */
+/* USE_HAL_HASH_REGISTER_CALLBACKS.                                         */
+#if !defined(ST_HASH_DMA_CHANNEL)
+#define ST_HASH_DMA_CHANNEL       GPDMA1_Channel8
+#define ST_HASH_DMA_IRQn          GPDMA1_Channel8_IRQn
+#define ST_HASH_DMA_HANDLE        pxHndlGpdmaCh8
+#endif
+
+#if (ST_HASH_USE_DMA == 1) && (USE_HAL_HASH_REGISTER_CALLBACKS != 1)
+#error "ST_HASH_USE_DMA requires USE_HAL_HASH_REGISTER_CALLBACKS"
+#endif
+
+#if !defined(ST_HASH_DMA_IRQ_PRIORITY)
+#define ST_HASH_DMA_IRQ_PRIORITY  5U
+#endif
+
+/* types ---------------------------------------------------------------------*/
+/* HAL_HASH_xxx_Start_DMA of the algorithm being computed                    */
+typedef HAL_StatusTypeDef (*hash_dma_start_t)(HASH_HandleTypeDef *hhash,
+                                              uint8_t *pInBuffer, uint32_t Size);
+
 /* defines -------------------------------------------------------------------*/
 /* variables -----------------------------------------------------------------*/
-#if defined(MBEDTLS_THREADING_C)
-extern mbedtls_threading_mutex_t hash_mutex;
-extern unsigned char hash_mutex_started;
-#endif /* MBEDTLS_THREADING_C */
-
 extern unsigned int hash_context_count;
 
 /* functions prototypes ------------------------------------------------------*/
 extern void hash_zeroize(void *v, size_t n);
 
+#if (ST_HASH_USE_DMA == 1)
+/* Returns 1 when length bytes at input may be fed by DMA                     */
+extern int hash_dma_usable(const unsigned char *input, size_t length);
+
+/* Feed a multiple of 64 bytes to a message in progress, without computing   */
+/* the digest. Must be called with hash_sched owned, after the first block   */
+/* was written by the CPU. Returns 0 or MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED.*/
+extern int hash_accumulate_dma(HASH_HandleTypeDef *hhash, hash_dma_start_t start,
+                               const unsigned char *input, size_t length);
+#endif /* ST_HASH_USE_DMA */
+
 #ifdef __cplusplus
 }
 #endif
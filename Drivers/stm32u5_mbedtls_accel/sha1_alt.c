@@ -33,7 +33,7 @@
 #include <string.h>
 #include "mbedtls/platform.h"
 #include "mbedtls/platform_util.h"
-
+#include "crypto_sched_stm32.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -58,6 +58,25 @@ static void mbedtls_zeroize(void *v, size_t n)
     }
 }
 
+/* Wait for the HASH peripheral and reload the hw context of ctx if another */
+/* context used the peripheral in the meantime                              */
+static void st_sha1_acquire(mbedtls_sha1_context *ctx)
+{
+    if (!crypto_sched_acquire(&hash_sched, ctx))
+    {
+        /* restore hw context */
+        HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
+    }
+}
+
+static void st_sha1_release(mbedtls_sha1_context *ctx)
+{
+    /* save hw context */
+    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+
+    crypto_sched_release(&hash_sched);
+}
+
 void mbedtls_sha1_init(mbedtls_sha1_context *ctx)
 {
     SHA1_VALIDATE( ctx != NULL );
@@ -74,6 +93,7 @@ void mbedtls_sha1_free(mbedtls_sha1_context *ctx)
     {
         return;
     }
+    crypto_sched_forget(&hash_sched, ctx);
     mbedtls_zeroize(ctx, sizeof(mbedtls_sha1_context));
 }
 
@@ -83,22 +103,32 @@ void mbedtls_sha1_clone(mbedtls_sha1_context *dst,
     SHA1_VALIDATE( dst != NULL );
     SHA1_VALIDATE( src != NULL );
 
+    /* the HASH may still hold the former state of dst */
+    crypto_sched_forget(&hash_sched, dst);
+
     *dst = *src;
 }
 
 int mbedtls_sha1_starts_ret(mbedtls_sha1_context *ctx)
 {
+    int ret = 0;
+
     SHA1_VALIDATE_RET( ctx != NULL );
 
+    /* the HASH is fully reconfigured: no need to restore the hw context */
+    (void) crypto_sched_acquire(&hash_sched, ctx);
+
     /* HASH Configuration */
     if (HAL_HASH_DeInit(&ctx->hhash) != HAL_OK)
     {
-        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        goto exit;
     }
     ctx->hhash.Init.DataType = HASH_DATATYPE_8B;
     if (HAL_HASH_Init(&ctx->hhash) != HAL_OK)
     {
-        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        goto exit;
     }
 
     /* first block on 17 words */
@@ -106,102 +136,128 @@ int mbedtls_sha1_starts_ret(mbedtls_sha1_context *ctx)
 
     ctx->sbuf_len = 0;
 
-    /* save hw context */
-    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+exit:
+    st_sha1_release(ctx);
 
-    return 0;
+    return ret;
 }
 
 int mbedtls_internal_sha1_process( mbedtls_sha1_context *ctx, const unsigned char data[ST_SHA1_BLOCK_SIZE] )
 {
+    int ret = 0;
+
     SHA1_VALIDATE_RET( ctx != NULL );
     SHA1_VALIDATE_RET( (const unsigned char *)data != NULL );
 
-    /* restore hw context */
-    HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
+    st_sha1_acquire(ctx);
 
     if (HAL_HASH_SHA1_Accmlt(&ctx->hhash, (uint8_t *) data, ST_SHA1_BLOCK_SIZE) != 0)
     {
-        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
     }
 
-    /* save hw context */
-    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+    st_sha1_release(ctx);
 
-    return 0;
+    return ret;
 }
 
 int mbedtls_sha1_update_ret(mbedtls_sha1_context *ctx, const unsigned char *input, size_t ilen)
 {
+    int ret = 0;
     size_t currentlen = ilen;
+    const unsigned char *blocks;
+    size_t iter;
+    size_t n;
 
     SHA1_VALIDATE_RET( ctx != NULL );
     SHA1_VALIDATE_RET( ilen == 0 || input != NULL );
 
-    /* restore hw context */
-    HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
-
     if (currentlen < (ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len))
     {
         /* only store input data in context buffer */
         memcpy(ctx->sbuf + ctx->sbuf_len, input, currentlen);
         ctx->sbuf_len += currentlen;
+
+        return 0;
+    }
+
+    st_sha1_acquire(ctx);
+
+    /* fill context buffer until ST_SHA1_BLOCK_SIZE bytes, and process it */
+    memcpy(ctx->sbuf + ctx->sbuf_len, input, (ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len));
+    currentlen -= (ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len);
+
+    if (HAL_HASH_SHA1_Accmlt(&ctx->hhash, (uint8_t *)(ctx->sbuf), ST_SHA1_BLOCK_SIZE + ctx->first) != 0)
+    {
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        goto exit;
     }
-    else
+
+    /* Process following input data with size multiple of ST_SHA1_BLOCK_SIZE bytes */
+    /* (handing the HASH over between chunks of long inputs)                    */
+    blocks = input + ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len;
+    iter = currentlen / ST_SHA1_BLOCK_SIZE;
+    while (iter != 0)
     {
-        /* fill context buffer until ST_SHA1_BLOCK_SIZE bytes, and process it */
-        memcpy(ctx->sbuf + ctx->sbuf_len, input, (ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len));
-        currentlen -= (ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len);
+        n = (iter > (ST_HASH_SCHED_CHUNK / ST_SHA1_BLOCK_SIZE)) ?
+            (ST_HASH_SCHED_CHUNK / ST_SHA1_BLOCK_SIZE) : iter;
 
-        if (HAL_HASH_SHA1_Accmlt(&ctx->hhash, (uint8_t *)(ctx->sbuf), ST_SHA1_BLOCK_SIZE + ctx->first) != 0)
+        if (HAL_HASH_SHA1_Accmlt(&ctx->hhash, (uint8_t *) blocks, (n * ST_SHA1_BLOCK_SIZE)) != 0)
         {
-            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+            ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+            goto exit;
         }
 
-        /* Process following input data with size multiple of ST_SHA1_BLOCK_SIZE bytes */
-        size_t iter = currentlen / ST_SHA1_BLOCK_SIZE;
-        if (iter != 0)
+        blocks += n * ST_SHA1_BLOCK_SIZE;
+        iter -= n;
+
+        if ((iter != 0) && crypto_sched_pending(&hash_sched))
         {
-            if (HAL_HASH_SHA1_Accmlt(&ctx->hhash, (uint8_t *)(input + ST_SHA1_BLOCK_SIZE + ctx->first - ctx->sbuf_len), (iter * ST_SHA1_BLOCK_SIZE)) != 0)
+            HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+
+            if (!crypto_sched_yield(&hash_sched, ctx))
             {
-                return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+                HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
             }
         }
+    }
 
-        /* following blocks on 16 words */
-        ctx->first = 0;
+    /* following blocks on 16 words */
+    ctx->first = 0;
 
-        /* Store only the remaining input data up to (ST_SHA1_BLOCK_SIZE - 1) bytes */
-        ctx->sbuf_len = currentlen % ST_SHA1_BLOCK_SIZE;
-        if (ctx->sbuf_len != 0)
-        {
-            memcpy(ctx->sbuf, input + ilen - ctx->sbuf_len, ctx->sbuf_len);
-        }
+    /* Store only the remaining input data up to (ST_SHA1_BLOCK_SIZE - 1) bytes */
+    ctx->sbuf_len = currentlen % ST_SHA1_BLOCK_SIZE;
+    if (ctx->sbuf_len != 0)
+    {
+        memcpy(ctx->sbuf, input + ilen - ctx->sbuf_len, ctx->sbuf_len);
     }
 
-    /* save hw context */
-    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+exit:
+    st_sha1_release(ctx);
 
-    return 0;
+    return ret;
 }
 
 int mbedtls_sha1_finish_ret(mbedtls_sha1_context *ctx, unsigned char output[32])
 {
+    int ret = 0;
+
     SHA1_VALIDATE_RET( ctx != NULL );
     SHA1_VALIDATE_RET( (unsigned char *)output != NULL );
 
-    /* restore hw context */
-    HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
+    st_sha1_acquire(ctx);
 
     /* Last accumulation for pending bytes in sbuf_len, then trig processing and get digest */
     if (HAL_HASH_SHA1_Accmlt_End(&ctx->hhash, ctx->sbuf, ctx->sbuf_len, output, ST_SHA1_TIMEOUT) != 0)
     {
-        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
     }
 
+    crypto_sched_release(&hash_sched);
+
     ctx->sbuf_len = 0;
 
-    return 0;
+    return ret;
 }
 
 #endif /* MBEDTLS_SHA1_ALT*/
@@ -33,7 +33,8 @@
 #include <string.h>
 #include "mbedtls/platform.h"
 #include "mbedtls/platform_util.h"
-
+#include "crypto_sched_stm32.h"
+#include "hash_stm32.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -58,6 +59,41 @@ static void mbedtls_zeroize(void *v, size_t n)
     }
 }
 
+/* Wait for the HASH peripheral and reload the hw context of ctx if another */
+/* context used the peripheral in the meantime                              */
+static void st_sha256_acquire(mbedtls_sha256_context *ctx)
+{
+    if (!crypto_sched_acquire(&hash_sched, ctx))
+    {
+        /* restore hw context */
+        HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
+    }
+}
+
+static void st_sha256_release(mbedtls_sha256_context *ctx)
+{
+    /* save hw context */
+    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+
+    crypto_sched_release(&hash_sched);
+}
+
+static int st_sha256_accumulate(mbedtls_sha256_context *ctx, const unsigned char *data, size_t len)
+{
+    HAL_StatusTypeDef status;
+
+    if (ctx->is224 == 0)
+    {
+        status = HAL_HASHEx_SHA256_Accmlt(&ctx->hhash, (uint8_t *) data, len);
+    }
+    else
+    {
+        status = HAL_HASHEx_SHA224_Accmlt(&ctx->hhash, (uint8_t *) data, len);
+    }
+
+    return (status == HAL_OK) ? 0 : MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+}
+
 void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
 {
     SHA256_VALIDATE( ctx != NULL );
@@ -74,6 +110,7 @@ void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
     {
         return;
     }
+    crypto_sched_forget(&hash_sched, ctx);
     mbedtls_zeroize(ctx, sizeof(mbedtls_sha256_context));
 }
 
@@ -83,23 +120,33 @@ void mbedtls_sha256_clone(mbedtls_sha256_context *dst,
     SHA256_VALIDATE( dst != NULL );
     SHA256_VALIDATE( src != NULL );
 
+    /* the HASH may still hold the former state of dst */
+    crypto_sched_forget(&hash_sched, dst);
+
     *dst = *src;
 }
 
-int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
 {
+    int ret = 0;
+
     SHA256_VALIDATE_RET( ctx != NULL );
     SHA256_VALIDATE_RET( is224 == 0 || is224 == 1 );
 
+    /* the HASH is fully reconfigured: no need to restore the hw context */
+    (void) crypto_sched_acquire(&hash_sched, ctx);
+
     /* HASH Configuration */
     if (HAL_HASH_DeInit(&ctx->hhash) != HAL_OK)
     {
-        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        goto exit;
     }
     ctx->hhash.Init.DataType = HASH_DATATYPE_8B;
     if (HAL_HASH_Init(&ctx->hhash) != HAL_OK)
     {
-        return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+        goto exit;
     }
 
     ctx->is224 = is224;
@@ -109,148 +156,152 @@ int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
 
     ctx->sbuf_len = 0;
 
-#ifdef ST_HW_CONTEXT_SAVING
-    /* save hw context */
-    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
-#endif /* ST_HW_CONTEXT_SAVING */
+exit:
+    st_sha256_release(ctx);
 
-    return 0;
+    return ret;
 }
 
 int mbedtls_internal_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[ST_SHA256_BLOCK_SIZE] )
 {
+    int ret;
+
     SHA256_VALIDATE_RET( ctx != NULL );
     SHA256_VALIDATE_RET( (const unsigned char *)data != NULL );
 
-#ifdef ST_HW_CONTEXT_SAVING
-    /* restore hw context */
-    HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
-#endif /* ST_HW_CONTEXT_SAVING */
+    st_sha256_acquire(ctx);
 
-    if (ctx->is224 == 0) {
-        if (HAL_HASHEx_SHA256_Accmlt(&ctx->hhash, (uint8_t *) data, ST_SHA256_BLOCK_SIZE) != 0) {
-            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-        }
-    } else {
-        if (HAL_HASHEx_SHA224_Accmlt(&ctx->hhash, (uint8_t *) data, ST_SHA256_BLOCK_SIZE) != 0) {
-            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-        }
-    }
+    ret = st_sha256_accumulate(ctx, data, ST_SHA256_BLOCK_SIZE);
 
-#ifdef ST_HW_CONTEXT_SAVING
-    /* save hw context */
-    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
-#endif /* ST_HW_CONTEXT_SAVING */
+    st_sha256_release(ctx);
 
-    return 0;
+    return ret;
 }
 
-int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
 {
+    int ret = 0;
     size_t currentlen = ilen;
+    const unsigned char *blocks;
+    size_t iter;
+    size_t n;
 
     SHA256_VALIDATE_RET( ctx != NULL );
     SHA256_VALIDATE_RET( ilen == 0 || input != NULL );
 
-#ifdef ST_HW_CONTEXT_SAVING
-    /* restore hw context */
-    HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
-#endif /* ST_HW_CONTEXT_SAVING */
-
     if (currentlen < (ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len))
     {
         /* only store input data in context buffer */
         memcpy(ctx->sbuf + ctx->sbuf_len, input, currentlen);
         ctx->sbuf_len += currentlen;
+
+        return 0;
     }
-    else
+
+    st_sha256_acquire(ctx);
+
+    /* fill context buffer until ST_SHA256_BLOCK_SIZE bytes, and process it */
+    memcpy(ctx->sbuf + ctx->sbuf_len, input, (ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len));
+    currentlen -= (ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len);
+
+    ret = st_sha256_accumulate(ctx, ctx->sbuf, ST_SHA256_BLOCK_SIZE + ctx->first);
+    if (ret != 0)
     {
-        /* fill context buffer until ST_SHA256_BLOCK_SIZE bytes, and process it */
-        memcpy(ctx->sbuf + ctx->sbuf_len, input, (ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len));
-        currentlen -= (ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len);
+        goto exit;
+    }
 
-        if (ctx->is224 == 0)
+    /* Process following input data with size multiple of ST_SHA256_BLOCK_SIZE bytes */
+    /* (handing the HASH over between chunks of long inputs)                      */
+    blocks = input + ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len;
+    iter = currentlen / ST_SHA256_BLOCK_SIZE;
+    while (iter != 0)
+    {
+#if (ST_HASH_USE_DMA == 1)
+        /* long inputs (e.g. a firmware image in flash) are fed by DMA while */
+        /* the calling task sleeps                                           */
+        if (hash_dma_usable(blocks, iter * ST_SHA256_BLOCK_SIZE))
         {
-            if (HAL_HASHEx_SHA256_Accmlt(&ctx->hhash, (uint8_t *)(ctx->sbuf), ST_SHA256_BLOCK_SIZE + ctx->first) != 0)
-            {
-                return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-            }
+            n = (iter > (ST_HASH_DMA_CHUNK / ST_SHA256_BLOCK_SIZE)) ?
+                (ST_HASH_DMA_CHUNK / ST_SHA256_BLOCK_SIZE) : iter;
+
+            ret = hash_accumulate_dma(&ctx->hhash,
+                                      (ctx->is224 == 0) ? HAL_HASHEx_SHA256_Start_DMA :
+                                                          HAL_HASHEx_SHA224_Start_DMA,
+                                      blocks, n * ST_SHA256_BLOCK_SIZE);
         }
         else
+#endif /* ST_HASH_USE_DMA */
         {
-            if (HAL_HASHEx_SHA224_Accmlt(&ctx->hhash, (uint8_t *)(ctx->sbuf), ST_SHA256_BLOCK_SIZE + ctx->first) != 0)
-            {
-                return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-            }
+            n = (iter > (ST_HASH_SCHED_CHUNK / ST_SHA256_BLOCK_SIZE)) ?
+                (ST_HASH_SCHED_CHUNK / ST_SHA256_BLOCK_SIZE) : iter;
+
+            ret = st_sha256_accumulate(ctx, blocks, n * ST_SHA256_BLOCK_SIZE);
+        }
+        if (ret != 0)
+        {
+            goto exit;
         }
 
-        /* Process following input data with size multiple of ST_SHA256_BLOCK_SIZE bytes */
-        size_t iter = currentlen / ST_SHA256_BLOCK_SIZE;
-        if (iter != 0)
+        blocks += n * ST_SHA256_BLOCK_SIZE;
+        iter -= n;
+
+        if ((iter != 0) && crypto_sched_pending(&hash_sched))
         {
-            if (ctx->is224 == 0)
-            {
-                if (HAL_HASHEx_SHA256_Accmlt(&ctx->hhash, (uint8_t *)(input + ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len), (iter * ST_SHA256_BLOCK_SIZE)) != 0)
-                {
-                    return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-                }
-            }
-            else
+            HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
+
+            if (!crypto_sched_yield(&hash_sched, ctx))
             {
-                if (HAL_HASHEx_SHA224_Accmlt(&ctx->hhash, (uint8_t *)(input + ST_SHA256_BLOCK_SIZE + ctx->first - ctx->sbuf_len), (iter * ST_SHA256_BLOCK_SIZE)) != 0)
-                {
-                    return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
-                }
+                HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
             }
         }
+    }
 
-        /* following blocks on 16 words */
-        ctx->first = 0;
+    /* following blocks on 16 words */
+    ctx->first = 0;
 
-        /* Store only the remaining input data up to (ST_SHA256_BLOCK_SIZE - 1) bytes */
-        ctx->sbuf_len = currentlen % ST_SHA256_BLOCK_SIZE;
-        if (ctx->sbuf_len != 0)
-        {
-            memcpy(ctx->sbuf, input + ilen - ctx->sbuf_len, ctx->sbuf_len);
-        }
+    /* Store only the remaining input data up to (ST_SHA256_BLOCK_SIZE - 1) bytes */
+    ctx->sbuf_len = currentlen % ST_SHA256_BLOCK_SIZE;
+    if (ctx->sbuf_len != 0)
+    {
+        memcpy(ctx->sbuf, input + ilen - ctx->sbuf_len, ctx->sbuf_len);
     }
 
-#ifdef ST_HW_CONTEXT_SAVING
-    /* save hw context */
-    HAL_HASH_ContextSaving(&ctx->hhash, ctx->ctx_save_regs);
-#endif /* ST_HW_CONTEXT_SAVING */
-    return 0;
+exit:
+    st_sha256_release(ctx);
+
+    return ret;
 }
 
-int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx, unsigned char output[32])
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
 {
+    int ret = 0;
+
     SHA256_VALIDATE_RET( ctx != NULL );
     SHA256_VALIDATE_RET( (unsigned char *)output != NULL );
 
-#ifdef ST_HW_CONTEXT_SAVING
-    /* restore hw context */
-    HAL_HASH_ContextRestoring(&ctx->hhash, ctx->ctx_save_regs);
-#endif /* ST_HW_CONTEXT_SAVING */
+    st_sha256_acquire(ctx);
 
     /* Last accumulation for pending bytes in sbuf_len, then trig processing and get digest */
     if (ctx->is224 == 0)
     {
         if (HAL_HASHEx_SHA256_Accmlt_End(&ctx->hhash, ctx->sbuf, ctx->sbuf_len, output, ST_SHA256_TIMEOUT) != 0)
         {
-            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+            ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
         }
     }
     else
     {
         if (HAL_HASHEx_SHA224_Accmlt_End(&ctx->hhash, ctx->sbuf, ctx->sbuf_len, output, ST_SHA256_TIMEOUT) != 0)
         {
-            return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+            ret = MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
         }
     }
 
+    crypto_sched_release(&hash_sched);
+
     ctx->sbuf_len = 0;
 
-    return 0;
+    return ret;
 }
 
 #endif /* MBEDTLS_SHA256_ALT*/
@@ -320,14 +320,14 @@ void mbedtls_platform_free( void * ptr );
 /*#define MBEDTLS_DES_ALT */
 /*#define MBEDTLS_DHM_ALT */
 /*#define MBEDTLS_ECJPAKE_ALT */
-/*#define MBEDTLS_GCM_ALT */
+#define MBEDTLS_GCM_ALT
 /*#define MBEDTLS_NIST_KW_ALT */
 /*#define MBEDTLS_MD5_ALT */
 /*#define MBEDTLS_POLY1305_ALT */
 /*#define MBEDTLS_RIPEMD160_ALT */
 /*#define MBEDTLS_RSA_ALT */
 /*#define MBEDTLS_SHA1_ALT */
-/*#define MBEDTLS_SHA256_ALT */
+#define MBEDTLS_SHA256_ALT
 /*#define MBEDTLS_SHA512_ALT */
 
 /*
@@ -390,9 +390,16 @@ void mbedtls_platform_free( void * ptr );
 /*#define MBEDTLS_AES_SETKEY_DEC_ALT */
 /*#define MBEDTLS_AES_ENCRYPT_ALT */
 /*#define MBEDTLS_AES_DECRYPT_ALT */
-/*#define MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+/* Provided by Common/crypto/ecdhe_pool.c using precomputed ephemeral keypairs. */
+#define MBEDTLS_ECDH_GEN_PUBLIC_ALT
 /*#define MBEDTLS_ECDH_COMPUTE_SHARED_ALT */
-/*#define MBEDTLS_ECDSA_VERIFY_ALT */
+/* Software verification keeping the comb tables of the public keys, see
+ * Drivers/stm32u5_mbedtls_accel/ecdsa_alt.c. */
+#define MBEDTLS_ECDSA_VERIFY_ALT
+/* Define ECDSA_NONCE_POOL along with MBEDTLS_ECDSA_SIGN_ALT to sign with the nonces
+ * precomputed by Common/crypto/ecdsa_nonce_pool.c. Signatures are then randomized
+ * rather than deterministic. */
+/*#define ECDSA_NONCE_POOL */
 /*#define MBEDTLS_ECDSA_SIGN_ALT */
 /*#define MBEDTLS_ECDSA_GENKEY_ALT */
 
@@ -36,7 +36,9 @@
 #include "task.h"
 #include "stm32u5xx.h"
 #include "kvstore.h"
+#include "tls_transport_config.h"
 #include "hw_defs.h"
+#include "crypto_sw_stm32.h"
 #include <string.h>
 
 #include "lfs.h"
@@ -183,6 +185,9 @@ extern void vEnvironmentSensorPublishTask( void * );
 extern void vShadowDeviceTask( void * );
 extern void vOTAUpdateTask( void * pvParam );
 extern void vDefenderAgentTask( void * );
+extern void vTransportDiagPublishTask( void * );
+extern void vEcdhePoolTask( void * );
+extern void vEcdsaNoncePoolTask( void * );
 
 extern void otaPal_EarlyInit( void );
 
@@ -193,6 +198,9 @@ void vInitTask( void * pvArgs )
 
     ( void ) pvArgs;
 
+    /* Measure the crypto accelerator thresholds before any TLS session */
+    st_sw_init();
+
     xResult = xTaskCreate( Task_CLI, "cli", 2048, NULL, 10, NULL );
     configASSERT( xResult == pdTRUE );
 
@@ -227,6 +235,12 @@ void vInitTask( void * pvArgs )
     xResult = xTaskCreate( &net_main, "MxNet", 1024, NULL, 23, NULL );
     configASSERT( xResult == pdTRUE );
 
+    xResult = xTaskCreate( vEcdhePoolTask, "EcdhePool", 1024, NULL, tskIDLE_PRIORITY, NULL );
+    configASSERT( xResult == pdTRUE );
+
+    xResult = xTaskCreate( vEcdsaNoncePoolTask, "EcdsaNonce", 1024, NULL, tskIDLE_PRIORITY, NULL );
+    configASSERT( xResult == pdTRUE );
+
     xResult = xTaskCreate( vMQTTAgentTask, "MQTTAgent", 2048, NULL, 10, NULL );
     configASSERT( xResult == pdTRUE );
 
@@ -245,6 +259,11 @@ void vInitTask( void * pvArgs )
     xResult = xTaskCreate( vDefenderAgentTask, "AWSDefender", 2048, NULL, 5, NULL );
     configASSERT( xResult == pdTRUE );
 
+#if TRANSPORT_DIAG_PUBLISH_ENABLED
+    xResult = xTaskCreate( vTransportDiagPublishTask, "TransportDiag", 1024, NULL, 5, NULL );
+    configASSERT( xResult == pdTRUE );
+#endif /* TRANSPORT_DIAG_PUBLISH_ENABLED */
+
     while( 1 )
     {
         vTaskSuspend( NULL );
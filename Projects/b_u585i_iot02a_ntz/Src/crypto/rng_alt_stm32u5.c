@@ -26,29 +26,99 @@
 #include "semphr.h"
 #include "task.h"
 #include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
 #include "mbedtls/entropy.h"
 #include "entropy_poll.h"
+#include "entropy_pool.h"
 
 #if defined( MBEDTLS_ENTROPY_HARDWARE_ALT )
 
 #define MBEDTLS_ENTROPY_TIMEOUT_MS    100
 
+/* Index 0 is used by mbedtls callers (transport, OTA and the crypto pools) */
+#ifndef RNG_NOTIFY_IDX
+#define RNG_NOTIFY_IDX                ( 4U )
+#endif
+
+#if ( ENTROPY_POOL_WORDS & ( ENTROPY_POOL_WORDS - 1U ) ) != 0U
+#error "ENTROPY_POOL_WORDS must be a power of two"
+#endif
+
+#define ENTROPY_POOL_MASK     ( ENTROPY_POOL_WORDS - 1U )
+#define ENTROPY_POOL_LEVEL    ( ulPoolHead - ulPoolTail )
+
 /*
  * include the correct headerfile depending on the STM32 family */
 
 #include "stm32u5xx_hal.h"
-#include <string.h>
 
 extern RNG_HandleTypeDef * pxHndlRng;
 static SemaphoreHandle_t xRngMutex = NULL;
 
 static volatile TaskHandle_t xRngTaskToNotify = NULL;
+static volatile uint32_t ulRngWaitWords = 0;
+
+/*
+ * Ring of random words, filled by the RNG interrupt and drained by the holder
+ * of xRngMutex. Both indexes only increase: their difference is the level.
+ */
+static uint32_t pulEntropyPool[ ENTROPY_POOL_WORDS ];
+static volatile uint32_t ulPoolHead = 0;
+static volatile uint32_t ulPoolTail = 0;
+
+static volatile BaseType_t xRngRefilling = pdFALSE;
+static volatile BaseType_t xRngFault = pdFALSE;
+
+static EntropyPoolStats_t xPoolStats = { 0 };
+
+/*-----------------------------------------------------------*/
 
 static void vRngIrqHandler( void )
 {
     HAL_RNG_IRQHandler( pxHndlRng );
 }
 
+/*-----------------------------------------------------------*/
+
+/* Request the next word unless the ring is full. Called from the RNG interrupt
+ * or within a critical section. */
+static void prvStartRefill( void )
+{
+    if( ( xRngRefilling == pdFALSE ) &&
+        ( xRngFault == pdFALSE ) &&
+        ( ENTROPY_POOL_LEVEL < ENTROPY_POOL_WORDS ) )
+    {
+        if( HAL_RNG_GenerateRandomNumber_IT( pxHndlRng ) == HAL_OK )
+        {
+            xRngRefilling = pdTRUE;
+        }
+        else
+        {
+            xRngFault = pdTRUE;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvNotifyWaiterFromISR( BaseType_t xForce )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if( ( xRngTaskToNotify != NULL ) &&
+        ( ( xForce != pdFALSE ) ||
+          ( ENTROPY_POOL_LEVEL >= ulRngWaitWords ) ||
+          ( ENTROPY_POOL_LEVEL == ENTROPY_POOL_WORDS ) ) )
+    {
+        vTaskNotifyGiveIndexedFromISR( xRngTaskToNotify, RNG_NOTIFY_IDX, &xHigherPriorityTaskWoken );
+        xRngTaskToNotify = NULL;
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/*-----------------------------------------------------------*/
+
 static void vRngInit( void )
 {
     taskENTER_CRITICAL();
@@ -58,41 +128,100 @@ static void vRngInit( void )
     {
         xRngMutex = xSemaphoreCreateMutex();
         NVIC_SetVector( RNG_IRQn, ( uint32_t ) &vRngIrqHandler );
-        NVIC_SetPriority( RNG_IRQn, 1 );
+        /* The interrupt uses FreeRTOS FromISR APIs and must be masked by critical sections */
+        NVIC_SetPriority( RNG_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
         NVIC_EnableIRQ( RNG_IRQn );
+
+        /* Fill the ring in the background */
+        prvStartRefill();
+    }
+
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+/* Recover from a seed or clock error. Words generated around the failure are
+ * discarded. Called with xRngMutex held. */
+static void prvRngRecover( void )
+{
+    if( __HAL_RNG_GET_FLAG( pxHndlRng, RNG_FLAG_SECS ) )
+    {
+        ( void ) RNG_RecoverSeedError( pxHndlRng );
+    }
+    else
+    {
+        __HAL_RCC_RNG_CLK_DISABLE();
+        __HAL_RCC_RNG_CLK_ENABLE();
+        __HAL_RCC_RNG_FORCE_RESET();
+        __HAL_RCC_RNG_RELEASE_RESET();
+    }
+
+    /* A failure here is reported by the next refill */
+    ( void ) HAL_RNG_Init( pxHndlRng );
+
+    taskENTER_CRITICAL();
+
+    while( ENTROPY_POOL_LEVEL > 0U )
+    {
+        pulEntropyPool[ ulPoolTail & ENTROPY_POOL_MASK ] = 0;
+        ulPoolTail++;
     }
 
+    xRngRefilling = pdFALSE;
+    xRngFault = pdFALSE;
+    prvStartRefill();
+
     taskEXIT_CRITICAL();
 }
 
+/*-----------------------------------------------------------*/
+
 void HAL_RNG_ReadyDataCallback( RNG_HandleTypeDef * hrng,
                                 uint32_t random32bit )
 {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
-    ( void ) random32bit;
     ( void ) hrng;
 
-    if( xRngTaskToNotify )
+    if( ENTROPY_POOL_LEVEL < ENTROPY_POOL_WORDS )
     {
-        vTaskNotifyGiveFromISR( xRngTaskToNotify, &xHigherPriorityTaskWoken );
-        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        pulEntropyPool[ ulPoolHead & ENTROPY_POOL_MASK ] = random32bit;
+        ulPoolHead++;
     }
+
+    /* Keep going until the ring is full */
+    xRngRefilling = pdFALSE;
+    prvStartRefill();
+
+    prvNotifyWaiterFromISR( xRngFault );
 }
 
+/*-----------------------------------------------------------*/
+
 void HAL_RNG_ErrorCallback( RNG_HandleTypeDef * hrng )
 {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
     ( void ) hrng;
 
-    if( xRngTaskToNotify )
-    {
-        vTaskNotifyGiveFromISR( xRngTaskToNotify, &xHigherPriorityTaskWoken );
-        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
-    }
+    /* Stop refilling: the next caller recovers the peripheral */
+    xRngFault = pdTRUE;
+    xRngRefilling = pdFALSE;
+    xPoolStats.ulHealthFailures++;
+
+    prvNotifyWaiterFromISR( pdTRUE );
+}
+
+/*-----------------------------------------------------------*/
+
+void vEntropyPoolGetStats( EntropyPoolStats_t * pxStats )
+{
+    configASSERT( pxStats != NULL );
+
+    taskENTER_CRITICAL();
+    *pxStats = xPoolStats;
+    taskEXIT_CRITICAL();
 }
 
+/*-----------------------------------------------------------*/
+
 int mbedtls_hardware_poll( void * pvCtx,
                            unsigned char * pucOutputBuffer,
                            size_t uxBufferLen,
@@ -123,69 +252,106 @@ int mbedtls_hardware_poll( void * pvCtx,
     else if( xSemaphoreTake( xRngMutex, xTicksToWait ) )
     {
         size_t uxBytesWritten = 0;
-        size_t uxBytesRemaining = uxBufferLen;
+        BaseType_t xBlocked = pdFALSE;
+        BaseType_t xWaiting = pdFALSE;
+        BaseType_t xFault;
 
-        xRngTaskToNotify = xTaskGetCurrentTaskHandle();
+        xPoolStats.ulRequests++;
 
-        while( uxBytesRemaining > 0 &&
-               xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE )
+        while( ( lError == 0 ) &&
+               ( uxBytesWritten < uxBufferLen ) )
         {
-            HAL_StatusTypeDef xResult = HAL_RNG_GenerateRandomNumber_IT( pxHndlRng );
+            taskENTER_CRITICAL();
 
-            if( xResult != HAL_OK )
-            {
-                lError = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
-            }
-            else if( ulTaskNotifyTake( pdTRUE, xTicksToWait ) > 0 )
+            xFault = xRngFault;
+
+            if( xFault == pdFALSE )
             {
-                /* Check for error state */
-                if( __HAL_RNG_GET_FLAG( pxHndlRng, RNG_FLAG_SECS | RNG_FLAG_CECS ) )
+                while( ( ENTROPY_POOL_LEVEL > 0U ) &&
+                       ( uxBytesWritten < uxBufferLen ) )
                 {
-                    if( __HAL_RNG_GET_FLAG( pxHndlRng, RNG_FLAG_SECS ) )
-                    {
-                        RNG_RecoverSeedError( pxHndlRng );
-                    }
-                    else
+                    uint32_t ulRandomValue = pulEntropyPool[ ulPoolTail & ENTROPY_POOL_MASK ];
+                    size_t uxCopyLen = uxBufferLen - uxBytesWritten;
+
+                    if( uxCopyLen > sizeof( uint32_t ) )
                     {
-                        __HAL_RCC_RNG_CLK_DISABLE();
-                        __HAL_RCC_RNG_CLK_ENABLE();
-                        __HAL_RCC_RNG_FORCE_RESET();
-                        __HAL_RCC_RNG_RELEASE_RESET();
+                        uxCopyLen = sizeof( uint32_t );
                     }
+
+                    ( void ) memcpy( &( pucOutputBuffer[ uxBytesWritten ] ), &ulRandomValue, uxCopyLen );
+                    uxBytesWritten += uxCopyLen;
+
+                    pulEntropyPool[ ulPoolTail & ENTROPY_POOL_MASK ] = 0;
+                    ulPoolTail++;
                 }
-                else
+
+                /* Low water mark: top the ring up in the background */
+                if( ( ENTROPY_POOL_LEVEL < ENTROPY_POOL_LOW_WATER ) &&
+                    ( xRngRefilling == pdFALSE ) )
                 {
-                    uint32_t ulRandomValue = HAL_RNG_ReadLastRandomNumber( pxHndlRng );
+                    xPoolStats.ulRefills++;
+                    prvStartRefill();
+                }
 
-                    if( uxBytesRemaining > sizeof( uint32_t ) )
-                    {
-                        ( void ) memcpy( &( pucOutputBuffer[ uxBytesWritten ] ), &ulRandomValue, sizeof( uint32_t ) );
+                if( uxBytesWritten < uxBufferLen )
+                {
+                    ulRngWaitWords = ( uint32_t ) ( ( uxBufferLen - uxBytesWritten + sizeof( uint32_t ) - 1U ) / sizeof( uint32_t ) );
+                    xRngTaskToNotify = xTaskGetCurrentTaskHandle();
+                    xWaiting = pdTRUE;
+                }
+            }
 
-                        uxBytesWritten += sizeof( uint32_t );
-                        uxBytesRemaining -= sizeof( uint32_t );
-                    }
-                    else if( uxBytesRemaining > 0 )
-                    {
-                        ( void ) memcpy( &( pucOutputBuffer[ uxBytesWritten ] ), &ulRandomValue, uxBytesRemaining );
+            taskEXIT_CRITICAL();
 
-                        uxBytesWritten = uxBufferLen;
-                        uxBytesRemaining = 0;
-                    }
-                    else
-                    {
-                        uxBytesRemaining = 0;
-                    }
-                }
+            if( xFault != pdFALSE )
+            {
+                prvRngRecover();
+                lError = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
             }
-            else
+            else if( uxBytesWritten < uxBufferLen )
             {
-                uxBytesRemaining = 0;
-                break;
+                /* The ring ran dry: wait for the interrupt */
+                if( xBlocked == pdFALSE )
+                {
+                    xBlocked = pdTRUE;
+                    xPoolStats.ulBlocked++;
+                }
+
+                if( ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE ) ||
+                    ( ulTaskNotifyTakeIndexed( RNG_NOTIFY_IDX, pdTRUE, xTicksToWait ) == 0 ) )
+                {
+                    break;
+                }
+
+                xWaiting = pdFALSE;
             }
         }
 
-        xRngTaskToNotify = NULL;
+        taskENTER_CRITICAL();
+
+        /* The interrupt clears the waiter when it gives the notification */
+        if( xRngTaskToNotify != NULL )
+        {
+            xRngTaskToNotify = NULL;
+            xWaiting = pdFALSE;
+        }
+
+        taskEXIT_CRITICAL();
+
+        /* Discard a notification given after the wait timed out */
+        if( xWaiting != pdFALSE )
+        {
+            ( void ) ulTaskNotifyTakeIndexed( RNG_NOTIFY_IDX, pdTRUE, 0 );
+        }
+
         ( void ) xSemaphoreGive( xRngMutex );
+
+        if( lError != 0 )
+        {
+            mbedtls_platform_zeroize( pucOutputBuffer, uxBufferLen );
+            uxBytesWritten = 0;
+        }
+
         *puxBytesWritten = uxBytesWritten;
     }
     else
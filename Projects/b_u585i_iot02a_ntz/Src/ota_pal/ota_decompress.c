@@ -0,0 +1,339 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file ota_decompress.c
+ * @brief Streaming decompressor of compressed OTA images. See ota_decompress.h.
+ *
+ * The decompressor only depends on the C library, and uses no memory besides
+ * its OtaDecompress_t context.
+ */
+
+#include <string.h>
+
+#include "ota_decompress.h"
+
+typedef enum
+{
+    DECOMPRESS_STATE_HEADER = 0,
+    DECOMPRESS_STATE_TAG,
+    DECOMPRESS_STATE_LITERAL,
+    DECOMPRESS_STATE_DISTANCE,
+    DECOMPRESS_STATE_LENGTH,
+    DECOMPRESS_STATE_DONE
+} DecompressState_t;
+
+#define DECOMPRESS_WINDOW_MASK    ( ( 1UL << OTA_DECOMPRESS_MAX_WINDOW_LOG2 ) - 1UL )
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLe32( const uint8_t * pucData )
+{
+    return ( ( uint32_t ) pucData[ 0 ] ) |
+           ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucData[ 2 ] << 16 ) |
+           ( ( uint32_t ) pucData[ 3 ] << 24 );
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDecompressStatus_t prvFlush( OtaDecompress_t * pxDecompress )
+{
+    OtaDecompressStatus_t xStatus = OTA_DECOMPRESS_OK;
+
+    if( pxDecompress->ulOutLength > 0 )
+    {
+        if( pxDecompress->xWriteCallback( pxDecompress->pvCtx,
+                                          pxDecompress->ulImageOffset - pxDecompress->ulOutLength,
+                                          pxDecompress->ucOut,
+                                          pxDecompress->ulOutLength ) != 0 )
+        {
+            xStatus = OTA_DECOMPRESS_ERR_WRITE;
+        }
+
+        pxDecompress->ulOutLength = 0;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Append a byte to the image. The decompression is done once the image size
+ * given by the header is reached.
+ */
+static OtaDecompressStatus_t prvEmit( OtaDecompress_t * pxDecompress,
+                                      uint8_t ucByte )
+{
+    OtaDecompressStatus_t xStatus = OTA_DECOMPRESS_OK;
+
+    pxDecompress->ucWindow[ pxDecompress->ulImageOffset & DECOMPRESS_WINDOW_MASK ] = ucByte;
+    pxDecompress->ucOut[ pxDecompress->ulOutLength ] = ucByte;
+    pxDecompress->ulOutLength++;
+    pxDecompress->ulImageOffset++;
+
+    if( pxDecompress->ulImageOffset == pxDecompress->xHeader.ulImageSize )
+    {
+        xStatus = prvFlush( pxDecompress );
+        pxDecompress->ulState = DECOMPRESS_STATE_DONE;
+    }
+    else if( pxDecompress->ulOutLength == OTA_DECOMPRESS_OUT_BUFFER_SIZE )
+    {
+        xStatus = prvFlush( pxDecompress );
+    }
+    else
+    {
+        /* Keep buffering */
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDecompressStatus_t prvBackReference( OtaDecompress_t * pxDecompress,
+                                               uint32_t ulLength )
+{
+    OtaDecompressStatus_t xStatus = OTA_DECOMPRESS_OK;
+    uint32_t ulDistance = pxDecompress->ulDistance;
+
+    /* The window is zero filled before the start of the image, and the copy
+     * may overlap the bytes it produces. */
+    while( ( xStatus == OTA_DECOMPRESS_OK ) &&
+           ( ulLength > 0 ) &&
+           ( pxDecompress->ulState != DECOMPRESS_STATE_DONE ) )
+    {
+        uint8_t ucByte = pxDecompress->ucWindow[ ( pxDecompress->ulImageOffset - ulDistance ) & DECOMPRESS_WINDOW_MASK ];
+
+        xStatus = prvEmit( pxDecompress, ucByte );
+        ulLength--;
+    }
+
+    if( ( xStatus == OTA_DECOMPRESS_OK ) && ( ulLength > 0 ) )
+    {
+        /* Reference beyond the end of the image */
+        xStatus = OTA_DECOMPRESS_ERR_FORMAT;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDecompressStatus_t prvParseHeader( OtaDecompress_t * pxDecompress )
+{
+    OtaDecompressStatus_t xStatus = OTA_DECOMPRESS_OK;
+    OtaDecompressHeader_t * pxHeader = &( pxDecompress->xHeader );
+    const uint8_t * pucHeader = pxDecompress->ucHeader;
+
+    pxHeader->ulMagic = prvReadLe32( &pucHeader[ 0 ] );
+    pxHeader->ucFormatVersion = pucHeader[ 4 ];
+    pxHeader->ucWindowLog2 = pucHeader[ 5 ];
+    pxHeader->ucLookaheadLog2 = pucHeader[ 6 ];
+    /* pucHeader[ 7 ] is reserved */
+    pxHeader->ulImageSize = prvReadLe32( &pucHeader[ 8 ] );
+
+    if( ( pxHeader->ulMagic != OTA_DECOMPRESS_MAGIC ) ||
+        ( pxHeader->ucFormatVersion != OTA_DECOMPRESS_FORMAT_VERSION ) ||
+        ( pxHeader->ucWindowLog2 == 0U ) ||
+        ( pxHeader->ucLookaheadLog2 == 0U ) ||
+        ( pxHeader->ucLookaheadLog2 > pxHeader->ucWindowLog2 ) ||
+        ( pxHeader->ulImageSize == 0U ) )
+    {
+        xStatus = OTA_DECOMPRESS_ERR_FORMAT;
+    }
+    else if( pxHeader->ucWindowLog2 > OTA_DECOMPRESS_MAX_WINDOW_LOG2 )
+    {
+        /* Window larger than the window buffer */
+        xStatus = OTA_DECOMPRESS_ERR_HEADER;
+    }
+    else if( pxDecompress->xHeaderCallback( pxDecompress->pvCtx, pxHeader ) != 0 )
+    {
+        xStatus = OTA_DECOMPRESS_ERR_HEADER;
+    }
+    else
+    {
+        pxDecompress->ulState = DECOMPRESS_STATE_TAG;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Add a bit to the field being read, and act on the field once it is complete.
+ */
+static OtaDecompressStatus_t prvBit( OtaDecompress_t * pxDecompress,
+                                     uint32_t ulBit )
+{
+    OtaDecompressStatus_t xStatus = OTA_DECOMPRESS_OK;
+    uint32_t ulFieldSize;
+
+    pxDecompress->ulField = ( pxDecompress->ulField << 1 ) | ulBit;
+    pxDecompress->ulFieldBits++;
+
+    switch( pxDecompress->ulState )
+    {
+        case DECOMPRESS_STATE_TAG:
+            ulFieldSize = 1U;
+            break;
+
+        case DECOMPRESS_STATE_LITERAL:
+            ulFieldSize = 8U;
+            break;
+
+        case DECOMPRESS_STATE_DISTANCE:
+            ulFieldSize = pxDecompress->xHeader.ucWindowLog2;
+            break;
+
+        case DECOMPRESS_STATE_LENGTH:
+        default:
+            ulFieldSize = pxDecompress->xHeader.ucLookaheadLog2;
+            break;
+    }
+
+    if( pxDecompress->ulFieldBits == ulFieldSize )
+    {
+        uint32_t ulField = pxDecompress->ulField;
+
+        pxDecompress->ulField = 0;
+        pxDecompress->ulFieldBits = 0;
+
+        switch( pxDecompress->ulState )
+        {
+            case DECOMPRESS_STATE_TAG:
+                pxDecompress->ulState = ( ulField != 0U ) ? DECOMPRESS_STATE_LITERAL : DECOMPRESS_STATE_DISTANCE;
+                break;
+
+            case DECOMPRESS_STATE_LITERAL:
+                pxDecompress->ulState = DECOMPRESS_STATE_TAG;
+                xStatus = prvEmit( pxDecompress, ( uint8_t ) ulField );
+                break;
+
+            case DECOMPRESS_STATE_DISTANCE:
+                pxDecompress->ulDistance = ulField + 1U;
+                pxDecompress->ulState = DECOMPRESS_STATE_LENGTH;
+                break;
+
+            case DECOMPRESS_STATE_LENGTH:
+            default:
+                pxDecompress->ulState = DECOMPRESS_STATE_TAG;
+                xStatus = prvBackReference( pxDecompress, ulField + 1U );
+                break;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void vOtaDecompressInit( OtaDecompress_t * pxDecompress,
+                         OtaDecompressHeaderCallback_t xHeaderCallback,
+                         OtaDecompressWriteCallback_t xWriteCallback,
+                         void * pvCtx )
+{
+    ( void ) memset( pxDecompress, 0, sizeof( OtaDecompress_t ) );
+
+    pxDecompress->xHeaderCallback = xHeaderCallback;
+    pxDecompress->xWriteCallback = xWriteCallback;
+    pxDecompress->pvCtx = pvCtx;
+    pxDecompress->xStatus = OTA_DECOMPRESS_OK;
+    pxDecompress->ulState = DECOMPRESS_STATE_HEADER;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaDecompressStatus_t xOtaDecompressUpdate( OtaDecompress_t * pxDecompress,
+                                            const uint8_t * pucData,
+                                            uint32_t ulLength )
+{
+    OtaDecompressStatus_t xStatus = pxDecompress->xStatus;
+    uint32_t ulIndex = 0;
+
+    if( ( xStatus == OTA_DECOMPRESS_DONE ) && ( ulLength > 0 ) )
+    {
+        /* Data after the end of the image */
+        xStatus = OTA_DECOMPRESS_ERR_FORMAT;
+    }
+
+    while( ( xStatus == OTA_DECOMPRESS_OK ) && ( ulIndex < ulLength ) )
+    {
+        if( pxDecompress->ulState == DECOMPRESS_STATE_HEADER )
+        {
+            uint32_t ulConsumed = OTA_DECOMPRESS_HEADER_SIZE - pxDecompress->ulHeaderLength;
+
+            if( ulConsumed > ( ulLength - ulIndex ) )
+            {
+                ulConsumed = ulLength - ulIndex;
+            }
+
+            ( void ) memcpy( &( pxDecompress->ucHeader[ pxDecompress->ulHeaderLength ] ),
+                             &pucData[ ulIndex ], ulConsumed );
+            pxDecompress->ulHeaderLength += ulConsumed;
+            ulIndex += ulConsumed;
+
+            if( pxDecompress->ulHeaderLength == OTA_DECOMPRESS_HEADER_SIZE )
+            {
+                xStatus = prvParseHeader( pxDecompress );
+            }
+        }
+        else if( pxDecompress->ulState == DECOMPRESS_STATE_DONE )
+        {
+            /* Data after the byte which completed the image */
+            xStatus = OTA_DECOMPRESS_ERR_FORMAT;
+        }
+        else
+        {
+            uint8_t ucByte = pucData[ ulIndex ];
+
+            /* The bits left in the byte which completes the image are padding */
+            for( uint32_t ulBit = 0;
+                 ( ulBit < 8U ) &&
+                 ( xStatus == OTA_DECOMPRESS_OK ) &&
+                 ( pxDecompress->ulState != DECOMPRESS_STATE_DONE );
+                 ulBit++ )
+            {
+                xStatus = prvBit( pxDecompress, ( ( uint32_t ) ucByte >> ( 7U - ulBit ) ) & 1U );
+            }
+
+            ulIndex++;
+        }
+    }
+
+    if( ( xStatus == OTA_DECOMPRESS_OK ) &&
+        ( pxDecompress->ulState == DECOMPRESS_STATE_DONE ) )
+    {
+        xStatus = OTA_DECOMPRESS_DONE;
+    }
+
+    pxDecompress->xStatus = xStatus;
+
+    return xStatus;
+}
@@ -0,0 +1,144 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file ota_decompress.h
+ * @brief Streaming decompressor of compressed OTA images.
+ *
+ * A compressed image is generated by tools/ota_compress.py. It is made of a
+ * header followed by a heatshrink (LZSS) bit stream, read most significant bit
+ * first:
+ *
+ *   1 <8 bit literal>
+ *   0 <window_log2 bit distance - 1> <lookahead_log2 bit length - 1>
+ *
+ * A back reference copies length bytes from distance bytes before the end of
+ * the image produced so far. The stream ends once the image size given by the
+ * header was produced; the last byte is padded with zero bits. All header
+ * fields are little endian.
+ *
+ * The image is fed in order, in chunks of any size. The decompressor keeps
+ * the last 2^OTA_DECOMPRESS_MAX_WINDOW_LOG2 bytes of the image in a window
+ * buffer, and produces the image in order, through a buffer of
+ * OTA_DECOMPRESS_OUT_BUFFER_SIZE bytes: every call to the write callback but
+ * the last one is a full buffer at an offset which is a multiple of the buffer
+ * size.
+ */
+
+#ifndef OTA_DECOMPRESS_H
+#define OTA_DECOMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OTA_DECOMPRESS_MAGIC              ( 0x5A41544FUL ) /* "OTAZ" */
+#define OTA_DECOMPRESS_FORMAT_VERSION     ( 1U )
+
+/* Size of the serialized header */
+#define OTA_DECOMPRESS_HEADER_SIZE        ( 12U )
+
+/* Largest window supported, which sets the size of the window buffer */
+#ifndef OTA_DECOMPRESS_MAX_WINDOW_LOG2
+#define OTA_DECOMPRESS_MAX_WINDOW_LOG2    ( 11U )
+#endif
+
+/* Must be a multiple of the flash programming unit */
+#ifndef OTA_DECOMPRESS_OUT_BUFFER_SIZE
+#define OTA_DECOMPRESS_OUT_BUFFER_SIZE    ( 128U )
+#endif
+
+typedef enum
+{
+    OTA_DECOMPRESS_OK = 0,
+    OTA_DECOMPRESS_DONE,          /* The whole image was produced */
+    OTA_DECOMPRESS_ERR_FORMAT,    /* Not a compressed image, or a corrupted one */
+    OTA_DECOMPRESS_ERR_HEADER,    /* Rejected by the header callback */
+    OTA_DECOMPRESS_ERR_WRITE      /* Write callback failed */
+} OtaDecompressStatus_t;
+
+typedef struct
+{
+    uint32_t ulMagic;
+    uint8_t ucFormatVersion;
+    uint8_t ucWindowLog2;
+    uint8_t ucLookaheadLog2;
+    uint32_t ulImageSize;
+} OtaDecompressHeader_t;
+
+/* Validates the header. Returns 0 when the image can be written. */
+typedef int32_t ( * OtaDecompressHeaderCallback_t )( void * pvCtx,
+                                                     const OtaDecompressHeader_t * pxHeader );
+
+/* Writes ulLength bytes of the image at ulOffset. Returns 0 on success. */
+typedef int32_t ( * OtaDecompressWriteCallback_t )( void * pvCtx,
+                                                    uint32_t ulOffset,
+                                                    const uint8_t * pucData,
+                                                    uint32_t ulLength );
+
+typedef struct
+{
+    /* Set by vOtaDecompressInit */
+    OtaDecompressHeaderCallback_t xHeaderCallback;
+    OtaDecompressWriteCallback_t xWriteCallback;
+    void * pvCtx;
+
+    /* Decoder state */
+    OtaDecompressStatus_t xStatus;
+    uint32_t ulState;
+    uint32_t ulField;          /* Bits of the field being read */
+    uint32_t ulFieldBits;      /* Number of bits read in ulField */
+    uint32_t ulDistance;
+    OtaDecompressHeader_t xHeader;
+    uint8_t ucHeader[ OTA_DECOMPRESS_HEADER_SIZE ];
+    uint32_t ulHeaderLength;
+
+    /* Image output */
+    uint32_t ulImageOffset;    /* Bytes produced so far */
+    uint32_t ulOutLength;      /* Bytes pending in ucOut */
+    uint8_t ucOut[ OTA_DECOMPRESS_OUT_BUFFER_SIZE ];
+    uint8_t ucWindow[ 1UL << OTA_DECOMPRESS_MAX_WINDOW_LOG2 ];
+} OtaDecompress_t;
+
+/**
+ * @brief Prepare the decompression of an image.
+ */
+void vOtaDecompressInit( OtaDecompress_t * pxDecompress,
+                         OtaDecompressHeaderCallback_t xHeaderCallback,
+                         OtaDecompressWriteCallback_t xWriteCallback,
+                         void * pvCtx );
+
+/**
+ * @brief Decompress the next ulLength bytes of the compressed image.
+ *
+ * @return OTA_DECOMPRESS_OK when more data is expected, OTA_DECOMPRESS_DONE
+ * once the whole image was written, or an error. Errors are sticky.
+ */
+OtaDecompressStatus_t xOtaDecompressUpdate( OtaDecompress_t * pxDecompress,
+                                            const uint8_t * pucData,
+                                            uint32_t ulLength );
+
+#endif /* OTA_DECOMPRESS_H */
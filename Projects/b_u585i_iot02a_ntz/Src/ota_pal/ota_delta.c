@@ -0,0 +1,501 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file ota_delta.c
+ * @brief Streaming decoder of the delta OTA patch format. See ota_delta.h.
+ *
+ * The decoder only depends on the C library, and uses no memory besides its
+ * OtaDelta_t context.
+ */
+
+#include <string.h>
+
+#include "ota_delta.h"
+
+typedef enum
+{
+    DELTA_STATE_HEADER = 0,
+    DELTA_STATE_OPCODE,
+    DELTA_STATE_VARINT,
+    DELTA_STATE_ADD_DATA,
+    DELTA_STATE_INSERT_DATA,
+    DELTA_STATE_DONE
+} DeltaState_t;
+
+/* A 32 bit LEB128 varint is at most 5 bytes long */
+#define DELTA_VARINT_MAX_SHIFT    ( 35U )
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLe32( const uint8_t * pucData )
+{
+    return ( ( uint32_t ) pucData[ 0 ] ) |
+           ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucData[ 2 ] << 16 ) |
+           ( ( uint32_t ) pucData[ 3 ] << 24 );
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDeltaStatus_t prvFlush( OtaDelta_t * pxDelta )
+{
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+
+    if( pxDelta->ulOutLength > 0 )
+    {
+        if( pxDelta->xWriteCallback( pxDelta->pvCtx,
+                                     pxDelta->ulTargetOffset - pxDelta->ulOutLength,
+                                     pxDelta->ucOut,
+                                     pxDelta->ulOutLength ) != 0 )
+        {
+            xStatus = OTA_DELTA_ERR_WRITE;
+        }
+
+        pxDelta->ulOutLength = 0;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Room left in the output buffer, after flushing it if it is full.
+ */
+static OtaDeltaStatus_t prvOutSpace( OtaDelta_t * pxDelta,
+                                     uint32_t * pulSpace )
+{
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+
+    if( pxDelta->ulOutLength == OTA_DELTA_OUT_BUFFER_SIZE )
+    {
+        xStatus = prvFlush( pxDelta );
+    }
+
+    *pulSpace = OTA_DELTA_OUT_BUFFER_SIZE - pxDelta->ulOutLength;
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Check that an operation producing ulLength bytes of the target image, and
+ * reading as many bytes of the base when xFromBase is set, stays in range.
+ */
+static OtaDeltaStatus_t prvCheckRange( const OtaDelta_t * pxDelta,
+                                       uint32_t ulLength,
+                                       uint8_t xFromBase )
+{
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+
+    if( ulLength > ( pxDelta->xHeader.ulTargetSize - pxDelta->ulTargetOffset ) )
+    {
+        xStatus = OTA_DELTA_ERR_RANGE;
+    }
+    else if( ( xFromBase != 0U ) &&
+             ( ulLength > ( pxDelta->xHeader.ulBaseSize - pxDelta->ulBaseOffset ) ) )
+    {
+        xStatus = OTA_DELTA_ERR_RANGE;
+    }
+    else
+    {
+        /* In range */
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDeltaStatus_t prvCopy( OtaDelta_t * pxDelta,
+                                 uint32_t ulLength )
+{
+    OtaDeltaStatus_t xStatus = prvCheckRange( pxDelta, ulLength, 1U );
+
+    while( ( xStatus == OTA_DELTA_OK ) && ( ulLength > 0 ) )
+    {
+        uint32_t ulChunk = 0;
+
+        xStatus = prvOutSpace( pxDelta, &ulChunk );
+
+        if( xStatus != OTA_DELTA_OK )
+        {
+            break;
+        }
+
+        if( ulChunk > ulLength )
+        {
+            ulChunk = ulLength;
+        }
+
+        ( void ) memcpy( &( pxDelta->ucOut[ pxDelta->ulOutLength ] ),
+                         &( pxDelta->pucBase[ pxDelta->ulBaseOffset ] ),
+                         ulChunk );
+
+        pxDelta->ulOutLength += ulChunk;
+        pxDelta->ulTargetOffset += ulChunk;
+        pxDelta->ulBaseOffset += ulChunk;
+        ulLength -= ulChunk;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDeltaStatus_t prvSeek( OtaDelta_t * pxDelta,
+                                 uint32_t ulZigzag )
+{
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+    uint32_t ulMagnitude = ( ulZigzag >> 1 ) + ( ulZigzag & 1U );
+
+    if( ( ulZigzag & 1U ) != 0U )
+    {
+        /* Backwards */
+        if( ulMagnitude > pxDelta->ulBaseOffset )
+        {
+            xStatus = OTA_DELTA_ERR_RANGE;
+        }
+        else
+        {
+            pxDelta->ulBaseOffset -= ulMagnitude;
+        }
+    }
+    else if( ulMagnitude > ( pxDelta->xHeader.ulBaseSize - pxDelta->ulBaseOffset ) )
+    {
+        xStatus = OTA_DELTA_ERR_RANGE;
+    }
+    else
+    {
+        pxDelta->ulBaseOffset += ulMagnitude;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static OtaDeltaStatus_t prvParseHeader( OtaDelta_t * pxDelta )
+{
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+    OtaDeltaHeader_t * pxHeader = &( pxDelta->xHeader );
+    const uint8_t * pucHeader = pxDelta->ucHeader;
+
+    pxHeader->ulMagic = prvReadLe32( &pucHeader[ 0 ] );
+    pxHeader->ucFormatVersion = pucHeader[ 4 ];
+    /* pucHeader[ 5..7 ] are reserved */
+    pxHeader->ulBaseVersion = prvReadLe32( &pucHeader[ 8 ] );
+    pxHeader->ulBaseSize = prvReadLe32( &pucHeader[ 12 ] );
+    pxHeader->ulTargetSize = prvReadLe32( &pucHeader[ 16 ] );
+    ( void ) memcpy( pxHeader->ucBaseHash, &pucHeader[ 20 ], OTA_DELTA_HASH_SIZE );
+
+    if( ( pxHeader->ulMagic != OTA_DELTA_MAGIC ) ||
+        ( pxHeader->ucFormatVersion != OTA_DELTA_FORMAT_VERSION ) )
+    {
+        xStatus = OTA_DELTA_ERR_FORMAT;
+    }
+    else if( pxHeader->ulBaseSize > pxDelta->ulBaseSize )
+    {
+        xStatus = OTA_DELTA_ERR_BASE;
+    }
+    else if( pxDelta->xHeaderCallback( pxDelta->pvCtx, pxHeader ) != 0 )
+    {
+        xStatus = OTA_DELTA_ERR_BASE;
+    }
+    else
+    {
+        pxDelta->ulState = DELTA_STATE_OPCODE;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Run the operation whose opcode and varint argument were just decoded.
+ */
+static OtaDeltaStatus_t prvExecute( OtaDelta_t * pxDelta )
+{
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+    uint32_t ulArg = pxDelta->ulVarint;
+
+    pxDelta->ulState = DELTA_STATE_OPCODE;
+
+    switch( pxDelta->ucOpcode )
+    {
+        case OTA_DELTA_OP_COPY:
+            xStatus = prvCopy( pxDelta, ulArg );
+            break;
+
+        case OTA_DELTA_OP_ADD:
+            xStatus = prvCheckRange( pxDelta, ulArg, 1U );
+            pxDelta->ulRemaining = ulArg;
+
+            if( ulArg > 0 )
+            {
+                pxDelta->ulState = DELTA_STATE_ADD_DATA;
+            }
+
+            break;
+
+        case OTA_DELTA_OP_INSERT:
+            xStatus = prvCheckRange( pxDelta, ulArg, 0U );
+            pxDelta->ulRemaining = ulArg;
+
+            if( ulArg > 0 )
+            {
+                pxDelta->ulState = DELTA_STATE_INSERT_DATA;
+            }
+
+            break;
+
+        case OTA_DELTA_OP_SEEK:
+            xStatus = prvSeek( pxDelta, ulArg );
+            break;
+
+        default:
+            xStatus = OTA_DELTA_ERR_FORMAT;
+            break;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Consume the data bytes of an ADD or INSERT operation.
+ */
+static OtaDeltaStatus_t prvData( OtaDelta_t * pxDelta,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength,
+                                 uint32_t * pulConsumed )
+{
+    OtaDeltaStatus_t xStatus;
+    uint32_t ulChunk = 0;
+
+    xStatus = prvOutSpace( pxDelta, &ulChunk );
+
+    if( ulChunk > ulLength )
+    {
+        ulChunk = ulLength;
+    }
+
+    if( ulChunk > pxDelta->ulRemaining )
+    {
+        ulChunk = pxDelta->ulRemaining;
+    }
+
+    if( pxDelta->ulState == DELTA_STATE_ADD_DATA )
+    {
+        const uint8_t * pucBase = &( pxDelta->pucBase[ pxDelta->ulBaseOffset ] );
+        uint8_t * pucOut = &( pxDelta->ucOut[ pxDelta->ulOutLength ] );
+
+        for( uint32_t i = 0; i < ulChunk; i++ )
+        {
+            pucOut[ i ] = ( uint8_t ) ( pucBase[ i ] + pucData[ i ] );
+        }
+
+        pxDelta->ulBaseOffset += ulChunk;
+    }
+    else
+    {
+        ( void ) memcpy( &( pxDelta->ucOut[ pxDelta->ulOutLength ] ), pucData, ulChunk );
+    }
+
+    pxDelta->ulOutLength += ulChunk;
+    pxDelta->ulTargetOffset += ulChunk;
+    pxDelta->ulRemaining -= ulChunk;
+
+    if( pxDelta->ulRemaining == 0 )
+    {
+        pxDelta->ulState = DELTA_STATE_OPCODE;
+    }
+
+    *pulConsumed = ulChunk;
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void vOtaDeltaInit( OtaDelta_t * pxDelta,
+                    const uint8_t * pucBase,
+                    uint32_t ulBaseSize,
+                    OtaDeltaHeaderCallback_t xHeaderCallback,
+                    OtaDeltaWriteCallback_t xWriteCallback,
+                    void * pvCtx )
+{
+    ( void ) memset( pxDelta, 0, sizeof( OtaDelta_t ) );
+
+    pxDelta->pucBase = pucBase;
+    pxDelta->ulBaseSize = ulBaseSize;
+    pxDelta->xHeaderCallback = xHeaderCallback;
+    pxDelta->xWriteCallback = xWriteCallback;
+    pxDelta->pvCtx = pvCtx;
+    pxDelta->xStatus = OTA_DELTA_OK;
+    pxDelta->ulState = DELTA_STATE_HEADER;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaDeltaStatus_t xOtaDeltaUpdate( OtaDelta_t * pxDelta,
+                                  const uint8_t * pucData,
+                                  uint32_t ulLength )
+{
+    OtaDeltaStatus_t xStatus = pxDelta->xStatus;
+    uint32_t ulIndex = 0;
+
+    if( ( xStatus == OTA_DELTA_DONE ) && ( ulLength > 0 ) )
+    {
+        /* Data after the end of the patch */
+        xStatus = OTA_DELTA_ERR_FORMAT;
+    }
+
+    while( ( xStatus == OTA_DELTA_OK ) && ( ulIndex < ulLength ) )
+    {
+        uint8_t ucByte = pucData[ ulIndex ];
+        uint32_t ulConsumed = 1;
+
+        switch( pxDelta->ulState )
+        {
+            case DELTA_STATE_HEADER:
+                ulConsumed = OTA_DELTA_HEADER_SIZE - pxDelta->ulHeaderLength;
+
+                if( ulConsumed > ( ulLength - ulIndex ) )
+                {
+                    ulConsumed = ulLength - ulIndex;
+                }
+
+                ( void ) memcpy( &( pxDelta->ucHeader[ pxDelta->ulHeaderLength ] ),
+                                 &pucData[ ulIndex ], ulConsumed );
+                pxDelta->ulHeaderLength += ulConsumed;
+
+                if( pxDelta->ulHeaderLength == OTA_DELTA_HEADER_SIZE )
+                {
+                    xStatus = prvParseHeader( pxDelta );
+                }
+
+                break;
+
+            case DELTA_STATE_OPCODE:
+
+                if( ucByte == OTA_DELTA_OP_END )
+                {
+                    xStatus = prvFlush( pxDelta );
+
+                    if( ( xStatus == OTA_DELTA_OK ) &&
+                        ( pxDelta->ulTargetOffset != pxDelta->xHeader.ulTargetSize ) )
+                    {
+                        xStatus = OTA_DELTA_ERR_FORMAT;
+                    }
+
+                    pxDelta->ulState = DELTA_STATE_DONE;
+                }
+                else if( ucByte > OTA_DELTA_OP_SEEK )
+                {
+                    xStatus = OTA_DELTA_ERR_FORMAT;
+                }
+                else
+                {
+                    pxDelta->ucOpcode = ucByte;
+                    pxDelta->ulVarint = 0;
+                    pxDelta->ulVarintShift = 0;
+                    pxDelta->ulState = DELTA_STATE_VARINT;
+                }
+
+                break;
+
+            case DELTA_STATE_VARINT:
+
+                if( ( pxDelta->ulVarintShift == 28U ) && ( ( ucByte & 0x70U ) != 0U ) )
+                {
+                    /* Does not fit in 32 bits */
+                    xStatus = OTA_DELTA_ERR_FORMAT;
+                    break;
+                }
+
+                pxDelta->ulVarint |= ( ( uint32_t ) ( ucByte & 0x7FU ) ) << pxDelta->ulVarintShift;
+                pxDelta->ulVarintShift += 7U;
+
+                if( ( ucByte & 0x80U ) == 0U )
+                {
+                    xStatus = prvExecute( pxDelta );
+                }
+                else if( pxDelta->ulVarintShift >= DELTA_VARINT_MAX_SHIFT )
+                {
+                    xStatus = OTA_DELTA_ERR_FORMAT;
+                }
+                else
+                {
+                    /* More varint bytes */
+                }
+
+                break;
+
+            case DELTA_STATE_ADD_DATA:
+            case DELTA_STATE_INSERT_DATA:
+                xStatus = prvData( pxDelta, &pucData[ ulIndex ], ulLength - ulIndex, &ulConsumed );
+                break;
+
+            case DELTA_STATE_DONE:
+            default:
+                /* Trailing data */
+                xStatus = OTA_DELTA_ERR_FORMAT;
+                break;
+        }
+
+        ulIndex += ulConsumed;
+    }
+
+    if( ( xStatus == OTA_DELTA_OK ) &&
+        ( pxDelta->ulState == DELTA_STATE_DONE ) )
+    {
+        xStatus = OTA_DELTA_DONE;
+    }
+
+    pxDelta->xStatus = xStatus;
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulOtaDeltaTargetSize( const OtaDelta_t * pxDelta )
+{
+    uint32_t ulTargetSize = 0;
+
+    if( pxDelta->ulState != DELTA_STATE_HEADER )
+    {
+        ulTargetSize = pxDelta->xHeader.ulTargetSize;
+    }
+
+    return ulTargetSize;
+}
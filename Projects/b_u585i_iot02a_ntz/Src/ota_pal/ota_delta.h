@@ -0,0 +1,159 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * https://www.FreeRTOS.org
+ * https://github.com/FreeRTOS
+ *
+ */
+
+/**
+ * @file ota_delta.h
+ * @brief Streaming decoder of the delta OTA patch format.
+ *
+ * A patch rebuilds a target image from a base image, the firmware currently
+ * running. It is generated by tools/ota_delta.py and is made of a header
+ * followed by a sequence of bsdiff style operations:
+ *
+ *   OTA_DELTA_OP_COPY   <len>          copy len bytes of the base
+ *   OTA_DELTA_OP_ADD    <len> <bytes>  add bytes to len bytes of the base
+ *   OTA_DELTA_OP_INSERT <len> <bytes>  insert bytes which are not in the base
+ *   OTA_DELTA_OP_SEEK   <delta>        move the base cursor
+ *   OTA_DELTA_OP_END
+ *
+ * COPY and ADD advance the base cursor by len. Lengths are LEB128 varints and
+ * the SEEK delta is a zigzag encoded LEB128 varint. All header fields are
+ * little endian.
+ *
+ * The patch is fed in order, in chunks of any size. The target image is
+ * produced in order, through a buffer of OTA_DELTA_OUT_BUFFER_SIZE bytes:
+ * every call to the write callback but the last one is a full buffer at an
+ * offset which is a multiple of the buffer size.
+ */
+
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OTA_DELTA_MAGIC              ( 0x4441544FUL ) /* "OTAD" */
+#define OTA_DELTA_FORMAT_VERSION     ( 1U )
+
+#define OTA_DELTA_OP_END             ( 0x00U )
+#define OTA_DELTA_OP_COPY            ( 0x01U )
+#define OTA_DELTA_OP_ADD             ( 0x02U )
+#define OTA_DELTA_OP_INSERT          ( 0x03U )
+#define OTA_DELTA_OP_SEEK            ( 0x04U )
+
+#define OTA_DELTA_HASH_SIZE          ( 32U )
+
+/* Size of the serialized header */
+#define OTA_DELTA_HEADER_SIZE        ( 20U + OTA_DELTA_HASH_SIZE )
+
+/* Must be a multiple of the flash programming unit */
+#ifndef OTA_DELTA_OUT_BUFFER_SIZE
+#define OTA_DELTA_OUT_BUFFER_SIZE    ( 128U )
+#endif
+
+typedef enum
+{
+    OTA_DELTA_OK = 0,
+    OTA_DELTA_DONE,            /* The end of the patch was decoded */
+    OTA_DELTA_ERR_FORMAT,      /* Not a patch, or a corrupted patch */
+    OTA_DELTA_ERR_BASE,        /* Rejected by the header callback */
+    OTA_DELTA_ERR_RANGE,       /* Operation outside the base or target image */
+    OTA_DELTA_ERR_WRITE        /* Write callback failed */
+} OtaDeltaStatus_t;
+
+typedef struct
+{
+    uint32_t ulMagic;
+    uint8_t ucFormatVersion;
+    uint32_t ulBaseVersion;    /* AppVersion32_t of the base image */
+    uint32_t ulBaseSize;
+    uint32_t ulTargetSize;
+    uint8_t ucBaseHash[ OTA_DELTA_HASH_SIZE ]; /* SHA-256 of the base image */
+} OtaDeltaHeader_t;
+
+/* Validates the header. Returns 0 when the patch applies to the base. */
+typedef int32_t ( * OtaDeltaHeaderCallback_t )( void * pvCtx,
+                                                const OtaDeltaHeader_t * pxHeader );
+
+/* Writes ulLength bytes of the target image at ulOffset. Returns 0 on success. */
+typedef int32_t ( * OtaDeltaWriteCallback_t )( void * pvCtx,
+                                               uint32_t ulOffset,
+                                               const uint8_t * pucData,
+                                               uint32_t ulLength );
+
+typedef struct
+{
+    /* Set by vOtaDeltaInit */
+    const uint8_t * pucBase;
+    uint32_t ulBaseSize;
+    OtaDeltaHeaderCallback_t xHeaderCallback;
+    OtaDeltaWriteCallback_t xWriteCallback;
+    void * pvCtx;
+
+    /* Decoder state */
+    OtaDeltaStatus_t xStatus;
+    uint32_t ulState;
+    uint8_t ucOpcode;
+    uint32_t ulVarint;
+    uint32_t ulVarintShift;
+    uint32_t ulRemaining;      /* Bytes left in the current ADD or INSERT */
+    uint32_t ulBaseOffset;
+    OtaDeltaHeader_t xHeader;
+    uint8_t ucHeader[ OTA_DELTA_HEADER_SIZE ];
+    uint32_t ulHeaderLength;
+
+    /* Target image output */
+    uint32_t ulTargetOffset;   /* Bytes produced so far */
+    uint32_t ulOutLength;      /* Bytes pending in ucOut */
+    uint8_t ucOut[ OTA_DELTA_OUT_BUFFER_SIZE ];
+} OtaDelta_t;
+
+/**
+ * @brief Prepare the decoding of a patch against the base image pucBase.
+ */
+void vOtaDeltaInit( OtaDelta_t * pxDelta,
+                    const uint8_t * pucBase,
+                    uint32_t ulBaseSize,
+                    OtaDeltaHeaderCallback_t xHeaderCallback,
+                    OtaDeltaWriteCallback_t xWriteCallback,
+                    void * pvCtx );
+
+/**
+ * @brief Decode the next ulLength bytes of the patch.
+ *
+ * @return OTA_DELTA_OK when more patch data is expected, OTA_DELTA_DONE once
+ * the whole target image was written, or an error. Errors are sticky.
+ */
+OtaDeltaStatus_t xOtaDeltaUpdate( OtaDelta_t * pxDelta,
+                                  const uint8_t * pucData,
+                                  uint32_t ulLength );
+
+/**
+ * @brief Size of the target image, or 0 until the header was decoded.
+ */
+uint32_t ulOtaDeltaTargetSize( const OtaDelta_t * pxDelta );
+
+#endif /* OTA_DELTA_H */
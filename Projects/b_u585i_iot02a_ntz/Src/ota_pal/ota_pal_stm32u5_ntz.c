@@ -34,8 +34,12 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+#include "ota_config.h"
 #include "ota.h"
 #include "ota_pal.h"
+#include "ota_appversion32.h"
+#include "ota_delta.h"
+#include "ota_decompress.h"
 #include "stm32u5xx.h"
 #include "stm32u5xx_hal_flash.h"
 #include "lfs.h"
@@ -43,20 +47,72 @@
 
 #include "mbedtls/pk.h"
 #include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
 #include "mbedtls_error_utils.h"
 
 #include "PkiObject.h"
 
 #define FLASH_START_INACTIVE_BANK    ( ( uint32_t ) ( FLASH_BASE + FLASH_BANK_SIZE ) )
 
-#define NUM_QUAD_WORDS( length )         ( length >> 4UL )
+#define QUAD_WORD_SIZE               ( 16UL )
 
-#define NUM_REMAINING_BYTES( length )    ( length & 0x0F )
+/* Burst programming writes 8 quad-words at once */
+#define BURST_SIZE                   ( 8UL * QUAD_WORD_SIZE )
 
 #define IMAGE_CONTEXT_FILE_NAME    "/ota/image_state"
 
 #define OTA_IMAGE_MIN_SIZE         ( 16 )
 
+/*
+ * Number of blocks written ahead of the hash cursor which are remembered so
+ * that they can be hashed once the gap before them is filled. When more
+ * blocks arrive out of order, the image is hashed from flash at close.
+ */
+#ifndef OTA_PAL_HASH_WINDOW
+#define OTA_PAL_HASH_WINDOW        ( 8U )
+#endif
+
+/*
+ * Only the pages of the inactive bank which hold the image are erased. They are
+ * erased in the background by the flash interrupt, OTA_PAL_ERASE_AHEAD_PAGES
+ * pages ahead of the last written block. otaPal_WriteBlock waits only when a
+ * block lands on a page which is not erased yet.
+ */
+#ifndef OTA_PAL_ERASE_AHEAD_PAGES
+#define OTA_PAL_ERASE_AHEAD_PAGES    ( 4U )
+#endif
+
+#define OTA_PAL_ERASE_NOTIFY_IDX     ( 5U )
+#define OTA_PAL_ERASE_TIMEOUT_MS     ( 1000U )
+
+#define NUM_PAGES( length )          ( ( ( length ) + FLASH_PAGE_SIZE - 1UL ) / FLASH_PAGE_SIZE )
+
+/*
+ * Value of the fileType field of the job document for a patch generated by
+ * tools/ota_delta.py against the running firmware, instead of a full image.
+ * The patch rebuilds the new image in the inactive bank from the active one;
+ * the signature of the job document is the signature of the new image.
+ */
+#ifndef OTA_PAL_FILE_TYPE_DELTA
+#define OTA_PAL_FILE_TYPE_DELTA      ( 1UL )
+#endif
+
+/*
+ * Value of the fileType field of the job document for an image compressed by
+ * tools/ota_compress.py. The signature of the job document is the signature of
+ * the decompressed image.
+ */
+#ifndef OTA_PAL_FILE_TYPE_COMPRESSED
+#define OTA_PAL_FILE_TYPE_COMPRESSED    ( 2UL )
+#endif
+
+/*
+ * A patch or a compressed image is decoded in order. Blocks received ahead of
+ * the decoder are staged in this file until the blocks before them arrive.
+ */
+#define PAYLOAD_STAGING_FILE_NAME    "/ota/payload"
+#define OTA_PAL_STAGED_BLOCKS        ( FLASH_BANK_SIZE / otaconfigFILE_BLOCK_SIZE )
+#define OTA_PAL_STAGING_CHUNK_SIZE   ( 256U )
 
 typedef enum
 {
@@ -94,13 +150,36 @@ typedef struct
     uint32_t ulFileTargetBank;
 } OtaPalNvContext_t;
 
+typedef struct
+{
+    uint32_t ulOffset;
+    uint32_t ulLength; /* 0 when the entry is free */
+} OtaPalHashBlock_t;
+
 typedef struct
 {
     uint32_t ulTargetBank;
     uint32_t ulPendingBank;
     uint32_t ulBaseAddress;
-    uint32_t ulImageSize;
+    uint32_t ulImageSize;       /* Size of the image in the target bank */
+    uint32_t ulFileSize;        /* Size of the file received */
+    uint32_t ulFileType;
     OtaPalState_t xPalState;
+
+    /* Streaming hash of the image, updated as blocks are written */
+    mbedtls_sha256_context xHashCtx;
+    BaseType_t xHashStreaming;  /* pdFALSE when the image must be hashed at close */
+    uint32_t ulHashOffset;      /* Length of the image hashed so far */
+    OtaPalHashBlock_t xHashWindow[ OTA_PAL_HASH_WINDOW ];
+
+    /* Decoding of a patch or of a compressed image */
+    union
+    {
+        OtaDelta_t xDelta;
+        OtaDecompress_t xDecompress;
+    } xDecoder;
+    uint32_t ulPayloadOffset;   /* Length of the file decoded so far */
+    uint8_t ucStagedBlocks[ ( OTA_PAL_STAGED_BLOCKS + 7U ) / 8U ];
 } OtaPalContext_t;
 
 
@@ -113,10 +192,23 @@ static OtaPalContext_t xPalContext =
     .ulPendingBank = 0,
     .ulBaseAddress = 0,
     .ulImageSize   = 0,
+    .ulFileSize    = 0,
+    .ulFileType    = 0,
 };
 
 static uint32_t ulBankAtBootup = 0;
 
+/*
+ * Background erase of the target bank. Pages [ 0, ulErasedPages ) are erased.
+ * An erase is in progress while ulErasedPages < ulEraseEndPage.
+ */
+static uint32_t ulEraseBank = 0;
+static uint32_t ulErasePages = 0;
+static volatile uint32_t ulErasedPages = 0;
+static volatile uint32_t ulEraseEndPage = 0;
+static volatile BaseType_t xEraseError = pdFALSE;
+static volatile TaskHandle_t xEraseTaskToNotify = NULL;
+
 /* Static function forward declarations */
 
 /* Load/Save/Delete */
@@ -143,6 +235,11 @@ static HAL_StatusTypeDef prvWriteToFlash( uint32_t destination,
 
 static BaseType_t prvEraseBank( uint32_t bankNumber );
 
+static BaseType_t prvEraseAheadStart( uint32_t ulBankNumber,
+                                      uint32_t ulImageSize );
+static BaseType_t prvEraseAheadKick( uint32_t ulEndPage );
+static BaseType_t prvEraseAheadWait( uint32_t ulEndPage );
+
 /* Verify signature */
 static OtaPalStatus_t prvValidateSignature( const char * pcPubKeyLabel,
                                             const unsigned char * pucSignature,
@@ -156,6 +253,30 @@ static BaseType_t xCalculateImageHash( const unsigned char * pucImageAddress,
                                        size_t uxHashBufferLength,
                                        size_t * puxHashLength );
 
+/* Streaming image hash */
+static void prvImageHashStart( OtaPalContext_t * pxContext );
+static void prvImageHashUpdate( OtaPalContext_t * pxContext,
+                                uint32_t ulOffset,
+                                uint32_t ulLength );
+static BaseType_t prvImageHashFinish( OtaPalContext_t * pxContext,
+                                      unsigned char * pucHashBuffer,
+                                      size_t uxHashBufferLength,
+                                      size_t * puxHashLength );
+
+/* Image and patch writes */
+static BaseType_t prvWriteImage( OtaPalContext_t * pxContext,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength );
+static BaseType_t prvPayloadIsEncoded( const OtaPalContext_t * pxContext );
+static BaseType_t prvPayloadStart( OtaPalContext_t * pxContext );
+static BaseType_t prvPayloadWrite( OtaPalContext_t * pxContext,
+                                   uint32_t ulOffset,
+                                   const uint8_t * pucData,
+                                   uint32_t ulLength );
+static BaseType_t prvPayloadClose( OtaPalContext_t * pxContext );
+static void prvPayloadStagingDelete( void );
+
 const char * otaImageStateToString( OtaImageState_t xState )
 {
     const char * pcStateString;
@@ -269,6 +390,10 @@ static BaseType_t prvInitializePalContext( OtaPalContext_t * pxContext )
         pxContext->ulTargetBank = 0;
         pxContext->ulBaseAddress = 0;
         pxContext->ulImageSize = 0;
+        pxContext->ulFileSize = 0;
+        pxContext->ulFileType = 0;
+        pxContext->xHashStreaming = pdFALSE;
+        pxContext->ulHashOffset = 0;
 
         /* Open the file */
         xLfsErr = lfs_file_open( pxLfsCtx, &xFile, IMAGE_CONTEXT_FILE_NAME, LFS_O_RDONLY );
@@ -581,65 +706,55 @@ static HAL_StatusTypeDef prvWriteToFlash( uint32_t destination,
                                           uint32_t ulLength )
 {
     HAL_StatusTypeDef status = HAL_OK;
-    uint32_t i = 0U;
-    uint8_t quadWord[ 16 ] = { 0 };
-    uint32_t numQuadWords = NUM_QUAD_WORDS( ulLength );
-    uint32_t remainingBytes = NUM_REMAINING_BYTES( ulLength );
+    uint32_t ulStartAddress = destination;
+    uint8_t * pStartSource = pSource;
+    uint32_t remainingBytes = ulLength;
+    uint32_t quadWord[ QUAD_WORD_SIZE / sizeof( uint32_t ) ];
+    uint32_t burst[ BURST_SIZE / sizeof( uint32_t ) ];
+
+    configASSERT( ( destination % QUAD_WORD_SIZE ) == 0 );
 
     /* Unlock the Flash to enable the flash control register access *************/
     HAL_FLASH_Unlock();
 
-    for( i = 0U; i < numQuadWords; i++ )
+    while( ( status == HAL_OK ) &&
+           ( remainingBytes > 0 ) )
     {
         /* Pet the watchdog */
         vPetWatchdog();
 
-        /* Device voltage range supposed to be [2.7V to 3.6V], the operation will
-         * be done by word */
-
-        memcpy( quadWord, pSource, 16UL );
-        status = HAL_FLASH_Program( FLASH_TYPEPROGRAM_QUADWORD, destination, ( uint32_t ) quadWord );
-
-        if( status == HAL_OK )
+        if( ( ( destination % BURST_SIZE ) == 0 ) &&
+            ( remainingBytes >= BURST_SIZE ) )
         {
-            /* Check the written value */
-            if( memcmp( ( void * ) destination, quadWord, 16UL ) != 0 )
+            /* Program 8 quad-words at once. The source is read by words. */
+            uint32_t ulData = ( uint32_t ) pSource;
+
+            if( ( ulData % sizeof( uint32_t ) ) != 0 )
             {
-                /* Flash content doesn't match SRAM content */
-                status = HAL_ERROR;
+                ( void ) memcpy( burst, pSource, BURST_SIZE );
+                ulData = ( uint32_t ) burst;
             }
-        }
 
-        if( status == HAL_OK )
-        {
-            /* Increment FLASH destination address and the source address. */
-            destination += 16UL;
-            pSource += 16UL;
+            status = HAL_FLASH_Program( FLASH_TYPEPROGRAM_BURST, destination, ulData );
+
+            destination += BURST_SIZE;
+            pSource += BURST_SIZE;
+            remainingBytes -= BURST_SIZE;
         }
         else
         {
-            break;
-        }
-    }
+            /* Head up to the next burst boundary, or tail of the block. A
+             * partial quad-word is padded with the erased value. */
+            uint32_t ulChunk = ( remainingBytes < QUAD_WORD_SIZE ) ? remainingBytes : QUAD_WORD_SIZE;
 
-    if( status == HAL_OK )
-    {
-        if( remainingBytes > 0 )
-        {
-            memcpy( quadWord, pSource, remainingBytes );
-            memset( ( quadWord + remainingBytes ), 0xFF, ( 16UL - remainingBytes ) );
+            ( void ) memcpy( quadWord, pSource, ulChunk );
+            ( void ) memset( ( ( uint8_t * ) quadWord ) + ulChunk, 0xFF, QUAD_WORD_SIZE - ulChunk );
 
             status = HAL_FLASH_Program( FLASH_TYPEPROGRAM_QUADWORD, destination, ( uint32_t ) quadWord );
 
-            if( status == HAL_OK )
-            {
-                /* Check the written value */
-                if( memcmp( ( void * ) destination, quadWord, 16UL ) != 0 )
-                {
-                    /* Flash content doesn't match SRAM content */
-                    status = HAL_ERROR;
-                }
-            }
+            destination += QUAD_WORD_SIZE;
+            pSource += ulChunk;
+            remainingBytes -= ulChunk;
         }
     }
 
@@ -647,6 +762,14 @@ static HAL_StatusTypeDef prvWriteToFlash( uint32_t destination,
      *  to protect the FLASH memory against possible unwanted operation) *********/
     HAL_FLASH_Lock();
 
+    /* Check the written block */
+    if( ( status == HAL_OK ) &&
+        ( memcmp( ( void * ) ulStartAddress, pStartSource, ulLength ) != 0 ) )
+    {
+        /* Flash content doesn't match SRAM content */
+        status = HAL_ERROR;
+    }
+
     return status;
 }
 
@@ -685,6 +808,201 @@ static BaseType_t prvEraseBank( uint32_t bankNumber )
     return xResult;
 }
 
+static void prvFlashIrqHandler( void )
+{
+    HAL_FLASH_IRQHandler();
+}
+
+/* Called by HAL_FLASH_IRQHandler after each erased page. The flash is locked
+ * again by prvEraseAheadWait: HAL_FLASH_IRQHandler clears the erase bits of
+ * the control register after this callback returns. */
+void HAL_FLASH_EndOfOperationCallback( uint32_t ReturnValue )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ( void ) ReturnValue;
+
+    if( ulErasedPages < ulEraseEndPage )
+    {
+        ulErasedPages++;
+    }
+
+    if( ulErasedPages == ulEraseEndPage )
+    {
+        if( xEraseTaskToNotify != NULL )
+        {
+            vTaskNotifyGiveIndexedFromISR( xEraseTaskToNotify, OTA_PAL_ERASE_NOTIFY_IDX, &xHigherPriorityTaskWoken );
+            xEraseTaskToNotify = NULL;
+        }
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+void HAL_FLASH_OperationErrorCallback( uint32_t ReturnValue )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ( void ) ReturnValue;
+
+    xEraseError = pdTRUE;
+    ulEraseEndPage = ulErasedPages;
+
+    if( xEraseTaskToNotify != NULL )
+    {
+        vTaskNotifyGiveIndexedFromISR( xEraseTaskToNotify, OTA_PAL_ERASE_NOTIFY_IDX, &xHigherPriorityTaskWoken );
+        xEraseTaskToNotify = NULL;
+    }
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/*
+ * Prepare the erase of the pages of the target bank which will hold an image
+ * of ulImageSize bytes, and start erasing the first ones.
+ */
+static BaseType_t prvEraseAheadStart( uint32_t ulBankNumber,
+                                      uint32_t ulImageSize )
+{
+    static BaseType_t xIrqInitialized = pdFALSE;
+
+    configASSERT( ( ulBankNumber == FLASH_BANK_1 ) || ( ulBankNumber == FLASH_BANK_2 ) );
+
+    configASSERT( ulBankNumber != prvGetActiveBank() );
+
+    if( xIrqInitialized == pdFALSE )
+    {
+        NVIC_SetVector( FLASH_IRQn, ( uint32_t ) &prvFlashIrqHandler );
+        /* The end of operation callback advances ulErasedPages, which
+         * prvEraseAheadWait samples in a critical section before it arms
+         * xEraseTaskToNotify: the flash interrupt must not preempt it. */
+        NVIC_SetPriority( FLASH_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY );
+        NVIC_EnableIRQ( FLASH_IRQn );
+        xIrqInitialized = pdTRUE;
+    }
+
+    /* Let the erase of a previous image complete */
+    ( void ) prvEraseAheadWait( 0 );
+
+    ulEraseBank = ulBankNumber;
+    ulErasePages = NUM_PAGES( ulImageSize );
+    ulErasedPages = 0;
+    ulEraseEndPage = 0;
+    xEraseError = pdFALSE;
+
+    return prvEraseAheadKick( OTA_PAL_ERASE_AHEAD_PAGES );
+}
+
+/*
+ * Start erasing the pages up to ulEndPage in the background, unless an erase is
+ * already in progress.
+ */
+static BaseType_t prvEraseAheadKick( uint32_t ulEndPage )
+{
+    BaseType_t xResult = pdTRUE;
+
+    if( ulEndPage > ulErasePages )
+    {
+        ulEndPage = ulErasePages;
+    }
+
+    if( xEraseError == pdTRUE )
+    {
+        xResult = pdFALSE;
+    }
+    else if( ( ulErasedPages < ulEraseEndPage ) ||
+             ( ulErasedPages >= ulEndPage ) )
+    {
+        /* Busy, or nothing to erase */
+    }
+    else if( HAL_FLASH_Unlock() != HAL_OK )
+    {
+        LogError( "Failed to unlock flash for erase, errorCode = %u.", HAL_FLASH_GetError() );
+        xResult = pdFALSE;
+    }
+    else
+    {
+        FLASH_EraseInitTypeDef xEraseInit;
+
+        xEraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+        xEraseInit.Banks = ulEraseBank;
+        xEraseInit.Page = ulErasedPages;
+        xEraseInit.NbPages = ulEndPage - ulErasedPages;
+
+        ulEraseEndPage = ulEndPage;
+
+        if( HAL_FLASHEx_Erase_IT( &xEraseInit ) != HAL_OK )
+        {
+            LogError( "Failed to start the erase of flash page %u, errorCode = %u.", ulErasedPages, HAL_FLASH_GetError() );
+            ulEraseEndPage = ulErasedPages;
+            xEraseError = pdTRUE;
+            ( void ) HAL_FLASH_Lock();
+            xResult = pdFALSE;
+        }
+    }
+
+    return xResult;
+}
+
+/*
+ * Wait until the pages up to ulEndPage are erased and the flash controller is
+ * idle, erasing the missing pages if needed.
+ */
+static BaseType_t prvEraseAheadWait( uint32_t ulEndPage )
+{
+    BaseType_t xResult = pdTRUE;
+
+    if( ulEndPage > ulErasePages )
+    {
+        ulEndPage = ulErasePages;
+    }
+
+    while( xResult == pdTRUE )
+    {
+        BaseType_t xBusy;
+
+        taskENTER_CRITICAL();
+
+        xBusy = ( ulErasedPages < ulEraseEndPage ) ? pdTRUE : pdFALSE;
+
+        if( xBusy == pdTRUE )
+        {
+            ( void ) xTaskNotifyStateClearIndexed( NULL, OTA_PAL_ERASE_NOTIFY_IDX );
+            xEraseTaskToNotify = xTaskGetCurrentTaskHandle();
+        }
+
+        taskEXIT_CRITICAL();
+
+        if( xBusy == pdTRUE )
+        {
+            if( ulTaskNotifyTakeIndexed( OTA_PAL_ERASE_NOTIFY_IDX, pdTRUE,
+                                         pdMS_TO_TICKS( OTA_PAL_ERASE_TIMEOUT_MS ) ) == 0 )
+            {
+                LogError( "Timed out waiting for the erase of flash page %u.", ulErasedPages );
+                xEraseTaskToNotify = NULL;
+                xResult = pdFALSE;
+            }
+        }
+        else if( xEraseError == pdTRUE )
+        {
+            LogError( "Failed to erase flash page %u, errorCode = %u.", ulErasedPages, HAL_FLASH_GetError() );
+            ( void ) HAL_FLASH_Lock();
+            xResult = pdFALSE;
+        }
+        else if( ulErasedPages >= ulEndPage )
+        {
+            ( void ) HAL_FLASH_Lock();
+            break;
+        }
+        else
+        {
+            xResult = prvEraseAheadKick( ulEndPage );
+        }
+    }
+
+    return xResult;
+}
+
 static BaseType_t xCalculateImageHash( const unsigned char * pucImageAddress,
                                        const size_t uxImageLength,
                                        unsigned char * pucHashBuffer,
@@ -737,6 +1055,154 @@ static BaseType_t xCalculateImageHash( const unsigned char * pucImageAddress,
     return xResult;
 }
 
+/*
+ * Begin hashing a new image. Any previous streaming state is discarded.
+ */
+static void prvImageHashStart( OtaPalContext_t * pxContext )
+{
+    int lRslt = 0;
+
+    mbedtls_sha256_free( &( pxContext->xHashCtx ) );
+    mbedtls_sha256_init( &( pxContext->xHashCtx ) );
+
+    ( void ) memset( pxContext->xHashWindow, 0, sizeof( pxContext->xHashWindow ) );
+    pxContext->ulHashOffset = 0;
+
+    lRslt = mbedtls_sha256_starts( &( pxContext->xHashCtx ), 0 );
+
+    MBEDTLS_MSG_IF_ERROR( lRslt, "Failed to start the image hash." );
+
+    pxContext->xHashStreaming = ( lRslt == 0 ) ? pdTRUE : pdFALSE;
+}
+
+/*
+ * Hash a block which was just written to flash. Blocks are hashed from flash in
+ * image order: a block written ahead of the hash cursor is remembered in
+ * xHashWindow until the blocks before it have been written. When the window
+ * overflows, the streaming hash is abandoned and the whole image is hashed at
+ * close instead.
+ */
+static void prvImageHashUpdate( OtaPalContext_t * pxContext,
+                                uint32_t ulOffset,
+                                uint32_t ulLength )
+{
+    BaseType_t xHashed = pdFALSE;
+
+    if( pxContext->xHashStreaming != pdTRUE )
+    {
+        /* Image will be hashed at close. */
+    }
+    else if( ( ulOffset + ulLength ) <= pxContext->ulHashOffset )
+    {
+        /* Block was already written and hashed. */
+    }
+    else if( ulOffset < pxContext->ulHashOffset )
+    {
+        LogWarn( "Block at offset %lu overlaps the hashed part of the image. Image will be hashed at close.", ( unsigned long ) ulOffset );
+        pxContext->xHashStreaming = pdFALSE;
+    }
+    else if( ulOffset > pxContext->ulHashOffset )
+    {
+        uint32_t i;
+
+        for( i = 0; i < OTA_PAL_HASH_WINDOW; i++ )
+        {
+            if( pxContext->xHashWindow[ i ].ulLength == 0 )
+            {
+                pxContext->xHashWindow[ i ].ulOffset = ulOffset;
+                pxContext->xHashWindow[ i ].ulLength = ulLength;
+                break;
+            }
+        }
+
+        if( i == OTA_PAL_HASH_WINDOW )
+        {
+            LogInfo( "Too many blocks received out of order. Image will be hashed at close." );
+            pxContext->xHashStreaming = pdFALSE;
+        }
+    }
+    else
+    {
+        xHashed = pdTRUE;
+    }
+
+    /* Hash the block, then any remembered block which now follows the cursor. */
+    while( xHashed == pdTRUE )
+    {
+        int lRslt = mbedtls_sha256_update( &( pxContext->xHashCtx ),
+                                           ( const unsigned char * ) ( pxContext->ulBaseAddress + ulOffset ),
+                                           ulLength );
+
+        if( lRslt != 0 )
+        {
+            MBEDTLS_MSG_IF_ERROR( lRslt, "Failed to update the image hash. Image will be hashed at close." );
+            pxContext->xHashStreaming = pdFALSE;
+            break;
+        }
+
+        pxContext->ulHashOffset = ulOffset + ulLength;
+        xHashed = pdFALSE;
+
+        for( uint32_t i = 0; i < OTA_PAL_HASH_WINDOW; i++ )
+        {
+            OtaPalHashBlock_t * pxBlock = &( pxContext->xHashWindow[ i ] );
+
+            if( pxBlock->ulLength == 0 )
+            {
+                continue;
+            }
+
+            if( ( pxBlock->ulOffset + pxBlock->ulLength ) <= pxContext->ulHashOffset )
+            {
+                /* Duplicate of a block hashed since */
+                pxBlock->ulLength = 0;
+            }
+            else if( ( xHashed == pdFALSE ) &&
+                     ( pxBlock->ulOffset == pxContext->ulHashOffset ) )
+            {
+                ulOffset = pxBlock->ulOffset;
+                ulLength = pxBlock->ulLength;
+                pxBlock->ulLength = 0;
+                xHashed = pdTRUE;
+            }
+        }
+    }
+}
+
+/*
+ * Finish the streaming hash. Returns pdFALSE if the streaming hash does not
+ * cover the whole image, for instance after a block was written twice with a
+ * different length or too many blocks were received out of order; the caller
+ * then hashes the image from flash.
+ */
+static BaseType_t prvImageHashFinish( OtaPalContext_t * pxContext,
+                                      unsigned char * pucHashBuffer,
+                                      size_t uxHashBufferLength,
+                                      size_t * puxHashLength )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( ( pxContext->xHashStreaming == pdTRUE ) &&
+        ( pxContext->ulHashOffset == pxContext->ulImageSize ) &&
+        ( uxHashBufferLength >= 32U ) )
+    {
+        int lRslt = mbedtls_sha256_finish( &( pxContext->xHashCtx ), pucHashBuffer );
+
+        MBEDTLS_MSG_IF_ERROR( lRslt, "Failed to finish the image hash." );
+
+        if( lRslt == 0 )
+        {
+            *puxHashLength = 32U;
+            xResult = pdTRUE;
+        }
+    }
+
+    pxContext->xHashStreaming = pdFALSE;
+    mbedtls_sha256_free( &( pxContext->xHashCtx ) );
+
+    return xResult;
+}
+
 static OtaPalStatus_t prvValidateSignature( const char * pcPubKeyLabel,
                                             const unsigned char * pucSignature,
                                             const size_t uxSignatureLength,
@@ -787,6 +1253,393 @@ static OtaPalStatus_t prvValidateSignature( const char * pcPubKeyLabel,
     return uxStatus;
 }
 
+/*
+ * Write ulLength bytes of the image at ulOffset of the target bank, once the
+ * pages below them are erased.
+ */
+static BaseType_t prvWriteImage( OtaPalContext_t * pxContext,
+                                 uint32_t ulOffset,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength )
+{
+    BaseType_t xResult = pdFALSE;
+
+    if( prvEraseAheadWait( NUM_PAGES( ulOffset + ulLength ) ) != pdTRUE )
+    {
+        LogError( "Flash pages for offset %lu are not erased.", ( unsigned long ) ulOffset );
+    }
+    else if( prvWriteToFlash( ( pxContext->ulBaseAddress + ulOffset ), ( uint8_t * ) pucData, ulLength ) == HAL_OK )
+    {
+        prvImageHashUpdate( pxContext, ulOffset, ulLength );
+        xResult = pdTRUE;
+
+        /* Keep erasing ahead of the blocks received */
+        ( void ) prvEraseAheadKick( NUM_PAGES( ulOffset + ulLength ) + OTA_PAL_ERASE_AHEAD_PAGES );
+    }
+    else
+    {
+        LogError( "Failed to write %lu bytes at offset %lu.", ( unsigned long ) ulLength, ( unsigned long ) ulOffset );
+    }
+
+    return xResult;
+}
+
+/*
+ * Start erasing the target bank for the image of ulImageSize bytes produced by
+ * the decoder, once the header of the payload has been checked.
+ */
+static int32_t prvPayloadImageStart( OtaPalContext_t * pxContext,
+                                     uint32_t ulImageSize )
+{
+    int32_t lResult = -1;
+
+    if( ( ulImageSize > FLASH_BANK_SIZE ) ||
+        ( ulImageSize < OTA_IMAGE_MIN_SIZE ) )
+    {
+        LogError( "Invalid decoded image size: %lu.", ( unsigned long ) ulImageSize );
+    }
+    else if( prvEraseAheadStart( pxContext->ulTargetBank, ulImageSize ) != pdTRUE )
+    {
+        LogError( "Failed to start the erase of the target bank." );
+    }
+    else
+    {
+        LogInfo( "Decoding a %lu byte file into a %lu byte image.",
+                 ( unsigned long ) pxContext->ulFileSize,
+                 ( unsigned long ) ulImageSize );
+        pxContext->ulImageSize = ulImageSize;
+        lResult = 0;
+    }
+
+    return lResult;
+}
+
+/*
+ * Accept a patch only if it was generated against the running image.
+ */
+static int32_t prvDeltaHeaderCallback( void * pvCtx,
+                                       const OtaDeltaHeader_t * pxHeader )
+{
+    int32_t lResult = -1;
+    OtaPalContext_t * pxContext = ( OtaPalContext_t * ) pvCtx;
+    unsigned char ucBaseHash[ OTA_DELTA_HASH_SIZE ];
+
+    if( pxHeader->ulBaseVersion != appFirmwareVersion.u.unsignedVersion32 )
+    {
+        LogError( "Patch applies to version %u.%u.%u, running version %u.%u.%u.",
+                  ( unsigned int ) ( pxHeader->ulBaseVersion >> 24 ),
+                  ( unsigned int ) ( ( pxHeader->ulBaseVersion >> 16 ) & 0xFFU ),
+                  ( unsigned int ) ( pxHeader->ulBaseVersion & 0xFFFFU ),
+                  appFirmwareVersion.u.x.major,
+                  appFirmwareVersion.u.x.minor,
+                  appFirmwareVersion.u.x.build );
+    }
+    else if( mbedtls_sha256( ( const unsigned char * ) FLASH_BASE, pxHeader->ulBaseSize, ucBaseHash, 0 ) != 0 )
+    {
+        LogError( "Failed to hash the running image." );
+    }
+    else if( memcmp( ucBaseHash, pxHeader->ucBaseHash, OTA_DELTA_HASH_SIZE ) != 0 )
+    {
+        LogError( "Patch does not apply to the running image." );
+    }
+    else
+    {
+        lResult = prvPayloadImageStart( pxContext, pxHeader->ulTargetSize );
+    }
+
+    return lResult;
+}
+
+static int32_t prvDecompressHeaderCallback( void * pvCtx,
+                                            const OtaDecompressHeader_t * pxHeader )
+{
+    return prvPayloadImageStart( ( OtaPalContext_t * ) pvCtx, pxHeader->ulImageSize );
+}
+
+static int32_t prvPayloadWriteCallback( void * pvCtx,
+                                      uint32_t ulOffset,
+                                      const uint8_t * pucData,
+                                      uint32_t ulLength )
+{
+    return ( prvWriteImage( ( OtaPalContext_t * ) pvCtx, ulOffset, pucData, ulLength ) == pdTRUE ) ? 0 : -1;
+}
+
+static void prvPayloadStagingDelete( void )
+{
+    lfs_t * pxLfsCtx = pxGetDefaultFsCtx();
+    struct lfs_info xFileInfo = { 0 };
+
+    if( ( pxLfsCtx != NULL ) &&
+        ( lfs_stat( pxLfsCtx, PAYLOAD_STAGING_FILE_NAME, &xFileInfo ) == LFS_ERR_OK ) )
+    {
+        ( void ) lfs_remove( pxLfsCtx, PAYLOAD_STAGING_FILE_NAME );
+    }
+}
+
+/*
+ * pdTRUE when the file received is a patch or a compressed image, which is
+ * decoded into the target bank, rather than the image itself.
+ */
+static BaseType_t prvPayloadIsEncoded( const OtaPalContext_t * pxContext )
+{
+    return ( ( pxContext->ulFileType == OTA_PAL_FILE_TYPE_DELTA ) ||
+             ( pxContext->ulFileType == OTA_PAL_FILE_TYPE_COMPRESSED ) ) ? pdTRUE : pdFALSE;
+}
+
+/*
+ * Prepare the decoding of a patch or of a compressed image. The target bank is
+ * erased once the header of the payload has been checked.
+ */
+static BaseType_t prvPayloadStart( OtaPalContext_t * pxContext )
+{
+    ( void ) memset( pxContext->ucStagedBlocks, 0, sizeof( pxContext->ucStagedBlocks ) );
+    pxContext->ulPayloadOffset = 0;
+
+    if( pxContext->ulFileType == OTA_PAL_FILE_TYPE_DELTA )
+    {
+        vOtaDeltaInit( &( pxContext->xDecoder.xDelta ),
+                       ( const uint8_t * ) FLASH_BASE, FLASH_BANK_SIZE,
+                       prvDeltaHeaderCallback, prvPayloadWriteCallback, pxContext );
+    }
+    else
+    {
+        vOtaDecompressInit( &( pxContext->xDecoder.xDecompress ),
+                            prvDecompressHeaderCallback, prvPayloadWriteCallback, pxContext );
+    }
+
+    prvPayloadStagingDelete();
+
+    return pdTRUE;
+}
+
+static BaseType_t prvPayloadDecode( OtaPalContext_t * pxContext,
+                                    const uint8_t * pucData,
+                                    uint32_t ulLength )
+{
+    BaseType_t xResult = pdTRUE;
+    int lError = 0;
+
+    if( pxContext->ulFileType == OTA_PAL_FILE_TYPE_DELTA )
+    {
+        OtaDeltaStatus_t xStatus = xOtaDeltaUpdate( &( pxContext->xDecoder.xDelta ), pucData, ulLength );
+
+        if( ( xStatus != OTA_DELTA_OK ) && ( xStatus != OTA_DELTA_DONE ) )
+        {
+            lError = ( int ) xStatus;
+        }
+    }
+    else
+    {
+        OtaDecompressStatus_t xStatus = xOtaDecompressUpdate( &( pxContext->xDecoder.xDecompress ), pucData, ulLength );
+
+        if( ( xStatus != OTA_DECOMPRESS_OK ) && ( xStatus != OTA_DECOMPRESS_DONE ) )
+        {
+            lError = ( int ) xStatus;
+        }
+    }
+
+    if( lError != 0 )
+    {
+        LogError( "Failed to decode the file at offset %lu, error %d.",
+                  ( unsigned long ) pxContext->ulPayloadOffset, lError );
+        xResult = pdFALSE;
+    }
+    else
+    {
+        pxContext->ulPayloadOffset += ulLength;
+    }
+
+    return xResult;
+}
+
+static BaseType_t prvPayloadStage( const uint8_t * pucData,
+                                   uint32_t ulOffset,
+                                   uint32_t ulLength )
+{
+    BaseType_t xResult = pdFALSE;
+    lfs_t * pxLfsCtx = pxGetDefaultFsCtx();
+    lfs_file_t xFile = { 0 };
+
+    if( pxLfsCtx == NULL )
+    {
+        LogError( "File system not ready." );
+    }
+    else if( lfs_file_open( pxLfsCtx, &xFile, PAYLOAD_STAGING_FILE_NAME, ( LFS_O_WRONLY | LFS_O_CREAT ) ) != LFS_ERR_OK )
+    {
+        LogError( "Failed to open %s.", PAYLOAD_STAGING_FILE_NAME );
+    }
+    else
+    {
+        if( ( lfs_file_seek( pxLfsCtx, &xFile, ( lfs_soff_t ) ulOffset, LFS_SEEK_SET ) == ( lfs_soff_t ) ulOffset ) &&
+            ( lfs_file_write( pxLfsCtx, &xFile, pucData, ulLength ) == ( lfs_ssize_t ) ulLength ) )
+        {
+            xResult = pdTRUE;
+        }
+        else
+        {
+            LogError( "Failed to stage the block at offset %lu.", ( unsigned long ) ulOffset );
+        }
+
+        if( lfs_file_close( pxLfsCtx, &xFile ) != LFS_ERR_OK )
+        {
+            xResult = pdFALSE;
+        }
+    }
+
+    return xResult;
+}
+
+/*
+ * Decode the staged blocks which follow the decoded part of the patch.
+ */
+static BaseType_t prvPayloadDrain( OtaPalContext_t * pxContext )
+{
+    BaseType_t xResult = pdTRUE;
+    lfs_t * pxLfsCtx = pxGetDefaultFsCtx();
+    lfs_file_t xFile = { 0 };
+    BaseType_t xFileOpen = pdFALSE;
+
+    while( ( xResult == pdTRUE ) &&
+           ( pxContext->ulPayloadOffset < pxContext->ulFileSize ) )
+    {
+        uint32_t ulBlock = pxContext->ulPayloadOffset / otaconfigFILE_BLOCK_SIZE;
+        uint32_t ulLength = pxContext->ulFileSize - pxContext->ulPayloadOffset;
+
+        if( ( pxContext->ucStagedBlocks[ ulBlock / 8U ] & ( 1U << ( ulBlock % 8U ) ) ) == 0U )
+        {
+            break;
+        }
+
+        if( ulLength > otaconfigFILE_BLOCK_SIZE )
+        {
+            ulLength = otaconfigFILE_BLOCK_SIZE;
+        }
+
+        if( xFileOpen == pdFALSE )
+        {
+            if( ( pxLfsCtx == NULL ) ||
+                ( lfs_file_open( pxLfsCtx, &xFile, PAYLOAD_STAGING_FILE_NAME, LFS_O_RDONLY ) != LFS_ERR_OK ) )
+            {
+                LogError( "Failed to open %s.", PAYLOAD_STAGING_FILE_NAME );
+                xResult = pdFALSE;
+                break;
+            }
+
+            xFileOpen = pdTRUE;
+        }
+
+        if( lfs_file_seek( pxLfsCtx, &xFile, ( lfs_soff_t ) pxContext->ulPayloadOffset, LFS_SEEK_SET ) != ( lfs_soff_t ) pxContext->ulPayloadOffset )
+        {
+            xResult = pdFALSE;
+        }
+
+        while( ( xResult == pdTRUE ) && ( ulLength > 0 ) )
+        {
+            uint8_t ucChunk[ OTA_PAL_STAGING_CHUNK_SIZE ];
+            uint32_t ulChunk = ( ulLength < sizeof( ucChunk ) ) ? ulLength : sizeof( ucChunk );
+
+            if( lfs_file_read( pxLfsCtx, &xFile, ucChunk, ulChunk ) != ( lfs_ssize_t ) ulChunk )
+            {
+                LogError( "Failed to read the staged block at offset %lu.", ( unsigned long ) pxContext->ulPayloadOffset );
+                xResult = pdFALSE;
+            }
+            else
+            {
+                xResult = prvPayloadDecode( pxContext, ucChunk, ulChunk );
+                ulLength -= ulChunk;
+            }
+        }
+
+        pxContext->ucStagedBlocks[ ulBlock / 8U ] &= ( uint8_t ) ~( 1U << ( ulBlock % 8U ) );
+    }
+
+    if( xFileOpen == pdTRUE )
+    {
+        ( void ) lfs_file_close( pxLfsCtx, &xFile );
+    }
+
+    return xResult;
+}
+
+/*
+ * Decode a block of a patch or of a compressed image, or stage it when it was
+ * received ahead of the blocks before it.
+ */
+static BaseType_t prvPayloadWrite( OtaPalContext_t * pxContext,
+                                   uint32_t ulOffset,
+                                   const uint8_t * pucData,
+                                   uint32_t ulLength )
+{
+    BaseType_t xResult = pdFALSE;
+    uint32_t ulBlock = ulOffset / otaconfigFILE_BLOCK_SIZE;
+
+    if( ( ulOffset % otaconfigFILE_BLOCK_SIZE ) != 0U )
+    {
+        LogError( "Offset %lu is not aligned on a block.", ( unsigned long ) ulOffset );
+    }
+    else if( ulOffset < pxContext->ulPayloadOffset )
+    {
+        /* Block was already decoded */
+        xResult = pdTRUE;
+    }
+    else if( ulOffset > pxContext->ulPayloadOffset )
+    {
+        xResult = prvPayloadStage( pucData, ulOffset, ulLength );
+
+        if( xResult == pdTRUE )
+        {
+            pxContext->ucStagedBlocks[ ulBlock / 8U ] |= ( uint8_t ) ( 1U << ( ulBlock % 8U ) );
+        }
+    }
+    else
+    {
+        xResult = prvPayloadDecode( pxContext, pucData, ulLength );
+
+        if( xResult == pdTRUE )
+        {
+            xResult = prvPayloadDrain( pxContext );
+        }
+    }
+
+    return xResult;
+}
+
+/*
+ * Check that a patch or a compressed image was received and decoded entirely.
+ * Always succeeds for a full image.
+ */
+static BaseType_t prvPayloadClose( OtaPalContext_t * pxContext )
+{
+    BaseType_t xResult = pdTRUE;
+
+    if( prvPayloadIsEncoded( pxContext ) == pdTRUE )
+    {
+        BaseType_t xDone;
+
+        if( pxContext->ulFileType == OTA_PAL_FILE_TYPE_DELTA )
+        {
+            xDone = ( pxContext->xDecoder.xDelta.xStatus == OTA_DELTA_DONE ) ? pdTRUE : pdFALSE;
+        }
+        else
+        {
+            xDone = ( pxContext->xDecoder.xDecompress.xStatus == OTA_DECOMPRESS_DONE ) ? pdTRUE : pdFALSE;
+        }
+
+        if( ( pxContext->ulPayloadOffset != pxContext->ulFileSize ) ||
+            ( xDone != pdTRUE ) )
+        {
+            LogError( "File was not decoded entirely: %lu of %lu bytes decoded.",
+                      ( unsigned long ) pxContext->ulPayloadOffset,
+                      ( unsigned long ) pxContext->ulFileSize );
+            xResult = pdFALSE;
+        }
+
+        prvPayloadStagingDelete();
+    }
+
+    return xResult;
+}
+
 OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const pxFileContext )
 {
     OtaPalStatus_t uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
@@ -836,20 +1689,40 @@ OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const pxFileContext )
             }
         }
 
-        if( ( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess ) &&
-            ( prvEraseBank( ulTargetBank ) != pdTRUE ) )
-        {
-            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
-        }
-
         if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
         {
             pxContext->ulTargetBank = ulTargetBank;
             pxContext->ulPendingBank = prvGetActiveBank();
             pxContext->ulBaseAddress = FLASH_START_INACTIVE_BANK;
-            pxContext->ulImageSize = pxFileContext->fileSize;
+            pxContext->ulFileSize = pxFileContext->fileSize;
+            pxContext->ulFileType = pxFileContext->fileType;
+
+            if( prvPayloadIsEncoded( pxContext ) == pdTRUE )
+            {
+                /* Image size is read from the header of the payload */
+                pxContext->ulImageSize = 0;
+
+                if( prvPayloadStart( pxContext ) != pdTRUE )
+                {
+                    uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
+                }
+            }
+            else
+            {
+                pxContext->ulImageSize = pxFileContext->fileSize;
+
+                if( prvEraseAheadStart( ulTargetBank, pxFileContext->fileSize ) != pdTRUE )
+                {
+                    uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
+                }
+            }
+        }
+
+        if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
+        {
             pxContext->xPalState = OTA_PAL_FILE_OPEN;
             pxFileContext->pFile = pxContext;
+            prvImageHashStart( pxContext );
         }
 
         if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
@@ -885,7 +1758,7 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const pxFileContext,
     {
         LogError( "PAL context is invalid." );
     }
-    else if( ( offset + blockSize ) > pxContext->ulImageSize )
+    else if( ( offset + blockSize ) > pxContext->ulFileSize )
     {
         LogError( "Offset and blockSize exceeds image size" );
     }
@@ -897,7 +1770,14 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const pxFileContext,
     {
         LogError( "pData is NULL." );
     }
-    else if( prvWriteToFlash( ( pxContext->ulBaseAddress + offset ), pData, blockSize ) == HAL_OK )
+    else if( prvPayloadIsEncoded( pxContext ) == pdTRUE )
+    {
+        if( prvPayloadWrite( pxContext, offset, pData, blockSize ) == pdTRUE )
+        {
+            sBytesWritten = ( int16_t ) blockSize;
+        }
+    }
+    else if( prvWriteImage( pxContext, offset, pData, blockSize ) == pdTRUE )
     {
         sBytesWritten = ( int16_t ) blockSize;
     }
@@ -922,9 +1802,20 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const pxFileContext )
         unsigned char pucHashBuffer[ MBEDTLS_MD_MAX_SIZE ];
         size_t uxHashLength = 0;
 
-        if( xCalculateImageHash( ( unsigned char * ) ( pxContext->ulBaseAddress ),
-                                 ( size_t ) pxContext->ulImageSize,
-                                 pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength ) != pdTRUE )
+        /* The image pages were erased before their blocks were written */
+        ( void ) prvEraseAheadWait( 0 );
+
+        if( prvPayloadClose( pxContext ) != pdTRUE )
+        {
+            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+        }
+        else if( prvImageHashFinish( pxContext, pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength ) == pdTRUE )
+        {
+            LogDebug( "Using the image hash computed during the download." );
+        }
+        else if( xCalculateImageHash( ( unsigned char * ) ( pxContext->ulBaseAddress ),
+                                      ( size_t ) pxContext->ulImageSize,
+                                      pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength ) != pdTRUE )
         {
             uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
         }
@@ -962,6 +1853,11 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const pxFileContext )
 
 OtaPalStatus_t otaPal_Abort( OtaFileContext_t * const pxFileContext )
 {
+    /* Let a background erase complete before the bank is erased or reused */
+    ( void ) prvEraseAheadWait( 0 );
+
+    prvPayloadStagingDelete();
+
     return otaPal_SetPlatformImageState( pxFileContext, OtaImageStateAborted );
 }
 
@@ -390,7 +390,8 @@ void mbedtls_platform_free( void * ptr );
 /*#define MBEDTLS_AES_SETKEY_DEC_ALT */
 /*#define MBEDTLS_AES_ENCRYPT_ALT */
 /*#define MBEDTLS_AES_DECRYPT_ALT */
-/*#define MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+/* Provided by Common/crypto/ecdhe_pool.c using precomputed ephemeral keypairs. */
+#define MBEDTLS_ECDH_GEN_PUBLIC_ALT
 /*#define MBEDTLS_ECDH_COMPUTE_SHARED_ALT */
 /*#define MBEDTLS_ECDSA_VERIFY_ALT */
 /*#define MBEDTLS_ECDSA_SIGN_ALT */
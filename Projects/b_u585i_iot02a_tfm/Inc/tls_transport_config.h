@@ -28,5 +28,22 @@
  */
 #define MBEDTLS_TRANSPORT_PSA
 
+/*
+ * Define TLS_TRANSPORT_TLS13_MODE as TLS_TRANSPORT_TLS13_PREFERRED or TLS_TRANSPORT_TLS13_REQUIRED
+ * to negotiate TLS 1.3. Requires MBEDTLS_SSL_PROTO_TLS1_3_EXPERIMENTAL in the mbedtls configuration.
+ */
+/*#define TLS_TRANSPORT_TLS13_MODE    TLS_TRANSPORT_TLS13_PREFERRED */
+
+/*
+ * Set TLS_TRANSPORT_WRITEV_ENABLED to 1 to provide the transport interface writev function.
+ * Requires a coreMQTT release with vectored send. The pinned coreMQTT v1.2.0 does not call writev.
+ */
+#define TLS_TRANSPORT_WRITEV_ENABLED    0
+
+/*
+ * Set TRANSPORT_DIAG_PUBLISH_ENABLED to 1 to periodically publish the MQTT connection's
+ * transport statistics to the <thing name>/diagnostics/transport topic.
+ */
+#define TRANSPORT_DIAG_PUBLISH_ENABLED    0
 
 #endif /* TLS_TRANSPORT_CONFIG */
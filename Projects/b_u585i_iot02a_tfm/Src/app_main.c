@@ -37,6 +37,7 @@
 #include "task.h"
 #include "stm32u5xx.h"
 #include "kvstore.h"
+#include "tls_transport_config.h"
 #include "hw_defs.h"
 #include "psa/crypto.h"
 #include <string.h>
@@ -102,6 +103,8 @@ extern void vEnvironmentSensorPublishTask( void * );
 extern void vShadowDeviceTask( void * );
 extern void vOTAUpdateTask( void * pvParam );
 extern void vDefenderAgentTask( void * );
+extern void vTransportDiagPublishTask( void * );
+extern void vEcdhePoolTask( void * );
 
 void vInitTask( void * pvArgs )
 {
@@ -122,6 +125,9 @@ void vInitTask( void * pvArgs )
     xResult = xTaskCreate( &net_main, "MxNet", 1024, NULL, 23, NULL );
     configASSERT( xResult == pdTRUE );
 
+    xResult = xTaskCreate( vEcdhePoolTask, "EcdhePool", 1024, NULL, tskIDLE_PRIORITY, NULL );
+    configASSERT( xResult == pdTRUE );
+
     xResult = xTaskCreate( vMQTTAgentTask, "MQTTAgent", 2048, NULL, tskIDLE_PRIORITY + 3, NULL );
     configASSERT( xResult == pdTRUE );
 
@@ -140,6 +146,11 @@ void vInitTask( void * pvArgs )
     xResult = xTaskCreate( vDefenderAgentTask, "AWSDefender", 2048, NULL, tskIDLE_PRIORITY + 1, NULL );
     configASSERT( xResult == pdTRUE );
 
+#if TRANSPORT_DIAG_PUBLISH_ENABLED
+    xResult = xTaskCreate( vTransportDiagPublishTask, "TransportDiag", 1024, NULL, tskIDLE_PRIORITY + 1, NULL );
+    configASSERT( xResult == pdTRUE );
+#endif /* TRANSPORT_DIAG_PUBLISH_ENABLED */
+
     while( 1 )
     {
         vTaskSuspend( NULL );
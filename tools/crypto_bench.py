@@ -0,0 +1,171 @@
+#!python
+#
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+#
+#
+"""Cryptographic primitive benchmark.
+
+Runs the "bench crypto" cli command on the target and writes the results as
+JSON. The hardware accelerated and software implementations of a primitive
+cannot be linked in the same image, so each build is benchmarked separately
+and the two reports are compared with --compare.
+"""
+import argparse
+import datetime
+import json
+import logging
+
+from provision import TargetDevice, find_serial_port
+
+logger = logging.getLogger()
+
+GROUPS = ("all", "aes", "hash", "ecc", "rsa")
+
+
+def run_cryptobench(target, group, ms_per_test, timeout):
+    """Run the bench crypto command on the target and return the parsed result lines."""
+    args = [b"bench", b"crypto", bytes(group, "ascii"), bytes(str(ms_per_test), "ascii")]
+
+    target._send_cmd(*args)
+    response = target._read_response(timeout=timeout)
+
+    results = []
+    for line in response:
+        line = line.strip()
+        if line.startswith(b"{"):
+            results.append(json.loads(line))
+    return results
+
+
+def _index(report):
+    """Map (test, size) to the result of a report."""
+    return {
+        (r["test"], r.get("size", 0)): r
+        for r in report["results"]
+        if "us_per_op" in r
+    }
+
+
+def compare(baseline_path, candidate_path):
+    """Print the speedup of each primitive of candidate relative to baseline."""
+    with open(baseline_path) as f:
+        baseline = _index(json.load(f))
+    with open(candidate_path) as f:
+        candidate = _index(json.load(f))
+
+    print(
+        "{:<20} {:>6} {:>5} {:>5} {:>12} {:>12} {:>8}".format(
+            "test", "size", "base", "cand", "base_us/op", "cand_us/op", "speedup"
+        )
+    )
+
+    for key in sorted(baseline, key=lambda k: (k[0], k[1])):
+        if key not in candidate:
+            continue
+        base = baseline[key]
+        cand = candidate[key]
+        base_us = max(base["us_per_op"], 1)
+        cand_us = max(cand["us_per_op"], 1)
+        print(
+            "{:<20} {:>6} {:>5} {:>5} {:>12} {:>12} {:>7.2f}x".format(
+                key[0],
+                key[1],
+                base["impl"],
+                cand["impl"],
+                base["us_per_op"],
+                cand["us_per_op"],
+                base_us / cand_us,
+            )
+        )
+
+
+def process_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--device", type=str)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--group", choices=GROUPS, default="all")
+    parser.add_argument(
+        "--ms-per-test",
+        type=int,
+        default=250,
+        help="Minimum run time of each primitive and input size.",
+    )
+    parser.add_argument("--timeout", type=float, default=600.0)
+    parser.add_argument("--output", default="crypto_bench_results.json")
+    parser.add_argument(
+        "--compare",
+        nargs=2,
+        metavar=("BASELINE", "CANDIDATE"),
+        help="Compare two result files instead of running the benchmark.",
+    )
+    parser.add_argument("-v", "--verbose", action="store_true")
+    return parser.parse_args()
+
+
+def main():
+    args = process_args()
+
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+    else:
+        logger.setLevel(logging.INFO)
+
+    if args.compare:
+        compare(*args.compare)
+        return
+
+    devpath = args.device if args.device else find_serial_port()
+    target = TargetDevice(devpath, args.baud)
+
+    report = {
+        "timestamp": datetime.datetime.utcnow().isoformat() + "Z",
+        "device": devpath,
+        "group": args.group,
+        "ms_per_test": args.ms_per_test,
+    }
+
+    try:
+        results = run_cryptobench(target, args.group, args.ms_per_test, args.timeout)
+        done = [r for r in results if r.get("test") == "done"]
+        status = "ok" if done and done[0].get("success") else "failed"
+    except (TargetDevice.TargetError, TargetDevice.ResponseTimeout) as e:
+        logging.error("Benchmark failed: {}".format(repr(e)))
+        results = []
+        status = "failed"
+
+    report["status"] = status
+    report["results"] = results
+
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+
+    logging.info("Results written to {}".format(args.output))
+
+    if status != "ok":
+        raise SystemExit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file freertos_model.c
+ * @brief Single task kernel for the host tests of the mbedtls accelerators.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "hal_model.h"
+
+static uint32_t ulNotifyCount[ configTASK_NOTIFICATION_ARRAY_ENTRIES ];
+static BaseType_t xSchedulerState = taskSCHEDULER_RUNNING;
+static TickType_t xTickCount = 0;
+static uint8_t ucTask;
+
+BaseType_t xTaskGetSchedulerState( void )
+{
+    return xSchedulerState;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    return &ucTask;
+}
+
+TickType_t xTaskGetTickCount( void )
+{
+    return xTickCount;
+}
+
+uint32_t ulTaskNotifyTakeIndexed( UBaseType_t uxIndexToWaitOn,
+                                  BaseType_t xClearCountOnExit,
+                                  TickType_t xTicksToWait )
+{
+    uint32_t ulCount;
+
+    configASSERT( uxIndexToWaitOn < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    /* The interrupts run while the task is blocked */
+    if( ( ulNotifyCount[ uxIndexToWaitOn ] == 0U ) && ( xTicksToWait != 0U ) )
+    {
+        vModelServiceInterrupts();
+    }
+
+    ulCount = ulNotifyCount[ uxIndexToWaitOn ];
+
+    if( ulCount == 0U )
+    {
+        /* Nothing else can give the notification: the wait times out */
+        configASSERT( xTicksToWait != portMAX_DELAY );
+        xTickCount += xTicksToWait;
+    }
+    else if( xClearCountOnExit != pdFALSE )
+    {
+        ulNotifyCount[ uxIndexToWaitOn ] = 0U;
+    }
+    else
+    {
+        ulNotifyCount[ uxIndexToWaitOn ]--;
+    }
+
+    return ulCount;
+}
+
+BaseType_t xTaskNotifyGiveIndexed( TaskHandle_t xTaskToNotify,
+                                   UBaseType_t uxIndexToNotify )
+{
+    configASSERT( xTaskToNotify == &ucTask );
+    configASSERT( uxIndexToNotify < configTASK_NOTIFICATION_ARRAY_ENTRIES );
+
+    ulNotifyCount[ uxIndexToNotify ]++;
+
+    return pdPASS;
+}
+
+void vTaskNotifyGiveIndexedFromISR( TaskHandle_t xTaskToNotify,
+                                    UBaseType_t uxIndexToNotify,
+                                    BaseType_t * pxHigherPriorityTaskWoken )
+{
+    ( void ) xTaskNotifyGiveIndexed( xTaskToNotify, uxIndexToNotify );
+
+    if( pxHigherPriorityTaskWoken != NULL )
+    {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+void vModelSetSchedulerState( BaseType_t xState )
+{
+    xSchedulerState = xState;
+}
+
+uint32_t ulModelNotifyCount( UBaseType_t uxIndex )
+{
+    return ulNotifyCount[ uxIndex ];
+}
@@ -0,0 +1,996 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file hal_model.c
+ * @brief Software model of the STM32U5 AES peripheral in GCM mode, of the
+ * GPDMA channels which feed it and of the HAL functions driving them.
+ *
+ * The model follows the register level contract the CRYP driver relies on:
+ * - HAL_CRYP_Init / HAL_CRYP_SetConfig configure CR and restart the message;
+ * - with CRYP_KEYIVCONFIG_ONCE, the first HAL_CRYP_Encrypt / Decrypt of a
+ *   message runs the init phase (key, IV) and the header phase (AAD), later
+ *   calls go on with the payload from the state held in the registers;
+ * - only the last payload call of a message may end on a partial block;
+ * - HAL_CRYPEx_AESGCM_GenerateAuthTAG needs a message in its payload phase;
+ * - DMA transfers complete in the GPDMA interrupt handlers, which call the
+ *   callbacks registered on the CRYP handle.
+ */
+
+#define _POSIX_C_SOURCE    200809L
+
+#include <string.h>
+#include <time.h>
+
+#include "stm32u5xx_hal.h"
+#include "hal_model.h"
+
+#include "mbedtls/aes.h"
+
+#define GCM_BLOCK_SIZE       16U
+#define GCMPH_PAYLOAD        ( 0x2UL << 13 )
+#define GCMPH_FINAL          ( 0x3UL << 13 )
+#define MODEL_NUM_CHANNELS   8U
+#define MODEL_NUM_IRQS       64U
+
+AES_TypeDef xModelAes;
+DMA_Channel_TypeDef xModelGpdmaChannel[ MODEL_NUM_CHANNELS ];
+CoreDebug_Type xModelCoreDebug;
+uint32_t ulModelAesClock = 0;
+uint32_t ulModelGpdmaClock = 0;
+
+static ModelDmaFault_t xDmaFault = eModelDmaNormal;
+static ModelStats_t xStats;
+static uint32_t ulIpsr = 0;
+static uint8_t ucIrqEnabled[ MODEL_NUM_IRQS ];
+static DWT_Type xDwt;
+
+/* Vectors of the GPDMA channels, provided by the application */
+static void prvUnhandledInterrupt( void )
+{
+    xStats.ulMisuse++;
+}
+
+#define MODEL_DEFAULT_HANDLER( name )                \
+    void name( void ) __attribute__( ( weak ) );     \
+    void name( void ) { prvUnhandledInterrupt(); }
+
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel0_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel1_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel2_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel3_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel4_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel5_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel6_IRQHandler )
+MODEL_DEFAULT_HANDLER( GPDMA1_Channel7_IRQHandler )
+
+static void ( * const pxGpdmaVectors[ MODEL_NUM_CHANNELS ] )( void ) =
+{
+    GPDMA1_Channel0_IRQHandler, GPDMA1_Channel1_IRQHandler,
+    GPDMA1_Channel2_IRQHandler, GPDMA1_Channel3_IRQHandler,
+    GPDMA1_Channel4_IRQHandler, GPDMA1_Channel5_IRQHandler,
+    GPDMA1_Channel6_IRQHandler, GPDMA1_Channel7_IRQHandler
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPutU32( uint8_t * pucDst,
+                       uint32_t ulValue )
+{
+    pucDst[ 0 ] = ( uint8_t ) ( ulValue >> 24 );
+    pucDst[ 1 ] = ( uint8_t ) ( ulValue >> 16 );
+    pucDst[ 2 ] = ( uint8_t ) ( ulValue >> 8 );
+    pucDst[ 3 ] = ( uint8_t ) ulValue;
+}
+
+static uint32_t prvGetU32( const uint8_t * pucSrc )
+{
+    return ( ( uint32_t ) pucSrc[ 0 ] << 24 ) | ( ( uint32_t ) pucSrc[ 1 ] << 16 ) |
+           ( ( uint32_t ) pucSrc[ 2 ] << 8 ) | ( uint32_t ) pucSrc[ 3 ];
+}
+
+/* X = X * H in GF(2^128), NIST SP 800-38D algorithm 1. */
+static void prvGfMul( uint8_t * pucX,
+                      const uint8_t * pucH )
+{
+    uint8_t ucZ[ GCM_BLOCK_SIZE ] = { 0 };
+    uint8_t ucV[ GCM_BLOCK_SIZE ];
+    uint32_t i, j;
+    uint8_t ucLsb;
+
+    memcpy( ucV, pucH, GCM_BLOCK_SIZE );
+
+    for( i = 0; i < 128U; i++ )
+    {
+        if( ( pucX[ i / 8U ] >> ( 7U - ( i % 8U ) ) ) & 1U )
+        {
+            for( j = 0; j < GCM_BLOCK_SIZE; j++ )
+            {
+                ucZ[ j ] ^= ucV[ j ];
+            }
+        }
+
+        ucLsb = ucV[ 15 ] & 1U;
+
+        for( j = GCM_BLOCK_SIZE - 1U; j > 0U; j-- )
+        {
+            ucV[ j ] = ( uint8_t ) ( ( ucV[ j ] >> 1 ) | ( ucV[ j - 1U ] << 7 ) );
+        }
+
+        ucV[ 0 ] >>= 1;
+
+        if( ucLsb != 0U )
+        {
+            ucV[ 0 ] ^= 0xE1U;
+        }
+    }
+
+    memcpy( pucX, ucZ, GCM_BLOCK_SIZE );
+}
+
+/* Y = ( Y ^ data ) * H over whole blocks, the last one zero padded. */
+static void prvGhash( uint8_t * pucY,
+                      const uint8_t * pucH,
+                      const uint8_t * pucData,
+                      size_t xLen )
+{
+    size_t i, xBlock;
+
+    while( xLen > 0U )
+    {
+        xBlock = ( xLen < GCM_BLOCK_SIZE ) ? xLen : GCM_BLOCK_SIZE;
+
+        for( i = 0; i < xBlock; i++ )
+        {
+            pucY[ i ] ^= pucData[ i ];
+        }
+
+        prvGfMul( pucY, pucH );
+        pucData += xBlock;
+        xLen -= xBlock;
+    }
+}
+
+static void prvGhashLengths( uint8_t * pucY,
+                             const uint8_t * pucH,
+                             uint64_t ullAadLen,
+                             uint64_t ullLen )
+{
+    uint8_t ucBlock[ GCM_BLOCK_SIZE ];
+
+    prvPutU32( &ucBlock[ 0 ], ( uint32_t ) ( ( ullAadLen * 8U ) >> 32 ) );
+    prvPutU32( &ucBlock[ 4 ], ( uint32_t ) ( ullAadLen * 8U ) );
+    prvPutU32( &ucBlock[ 8 ], ( uint32_t ) ( ( ullLen * 8U ) >> 32 ) );
+    prvPutU32( &ucBlock[ 12 ], ( uint32_t ) ( ullLen * 8U ) );
+    prvGhash( pucY, pucH, ucBlock, GCM_BLOCK_SIZE );
+}
+
+/* Counter mode from the counter block ucCtr, whose last word is incremented. */
+static void prvCtr( mbedtls_aes_context * pxAes,
+                    uint8_t * pucCtr,
+                    const uint8_t * pucIn,
+                    size_t xLen,
+                    uint8_t * pucOut )
+{
+    uint8_t ucStream[ GCM_BLOCK_SIZE ];
+    size_t i, xBlock;
+
+    while( xLen > 0U )
+    {
+        xBlock = ( xLen < GCM_BLOCK_SIZE ) ? xLen : GCM_BLOCK_SIZE;
+        ( void ) mbedtls_aes_crypt_ecb( pxAes, MBEDTLS_AES_ENCRYPT, pucCtr, ucStream );
+        prvPutU32( &pucCtr[ 12 ], prvGetU32( &pucCtr[ 12 ] ) + 1U );
+
+        for( i = 0; i < xBlock; i++ )
+        {
+            pucOut[ i ] = pucIn[ i ] ^ ucStream[ i ];
+        }
+
+        pucIn += xBlock;
+        pucOut += xBlock;
+        xLen -= xBlock;
+    }
+}
+
+void vModelGcmReference( const uint8_t * pucKey,
+                         size_t xKeyLen,
+                         const uint8_t * pucIv,
+                         const uint8_t * pucAad,
+                         size_t xAadLen,
+                         const uint8_t * pucIn,
+                         size_t xLen,
+                         int lDecrypt,
+                         uint8_t * pucOut,
+                         uint8_t * pucTag )
+{
+    mbedtls_aes_context xAes;
+    uint8_t ucH[ GCM_BLOCK_SIZE ] = { 0 };
+    uint8_t ucY[ GCM_BLOCK_SIZE ] = { 0 };
+    uint8_t ucCtr[ GCM_BLOCK_SIZE ];
+    uint8_t ucEj0[ GCM_BLOCK_SIZE ];
+    size_t i;
+
+    mbedtls_aes_init( &xAes );
+    ( void ) mbedtls_aes_setkey_enc( &xAes, pucKey, ( unsigned int ) ( xKeyLen * 8U ) );
+    ( void ) mbedtls_aes_crypt_ecb( &xAes, MBEDTLS_AES_ENCRYPT, ucH, ucH );
+
+    memcpy( ucCtr, pucIv, 12 );
+    prvPutU32( &ucCtr[ 12 ], 1U );
+    ( void ) mbedtls_aes_crypt_ecb( &xAes, MBEDTLS_AES_ENCRYPT, ucCtr, ucEj0 );
+    prvPutU32( &ucCtr[ 12 ], 2U );
+
+    prvGhash( ucY, ucH, pucAad, xAadLen );
+
+    if( lDecrypt )
+    {
+        prvGhash( ucY, ucH, pucIn, xLen );
+        prvCtr( &xAes, ucCtr, pucIn, xLen, pucOut );
+    }
+    else
+    {
+        prvCtr( &xAes, ucCtr, pucIn, xLen, pucOut );
+        prvGhash( ucY, ucH, pucOut, xLen );
+    }
+
+    prvGhashLengths( ucY, ucH, xAadLen, xLen );
+
+    for( i = 0; i < GCM_BLOCK_SIZE; i++ )
+    {
+        pucTag[ i ] = ucY[ i ] ^ ucEj0[ i ];
+    }
+
+    mbedtls_aes_free( &xAes );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Key schedule from the key registers. */
+static void prvAesFromKeyRegisters( mbedtls_aes_context * pxAes )
+{
+    uint8_t ucKey[ 32 ];
+
+    mbedtls_aes_init( pxAes );
+
+    if( ( xModelAes.CR & AES_CR_KEYSIZE ) != 0U )
+    {
+        prvPutU32( &ucKey[ 0 ], xModelAes.KEYR7 );
+        prvPutU32( &ucKey[ 4 ], xModelAes.KEYR6 );
+        prvPutU32( &ucKey[ 8 ], xModelAes.KEYR5 );
+        prvPutU32( &ucKey[ 12 ], xModelAes.KEYR4 );
+        prvPutU32( &ucKey[ 16 ], xModelAes.KEYR3 );
+        prvPutU32( &ucKey[ 20 ], xModelAes.KEYR2 );
+        prvPutU32( &ucKey[ 24 ], xModelAes.KEYR1 );
+        prvPutU32( &ucKey[ 28 ], xModelAes.KEYR0 );
+        ( void ) mbedtls_aes_setkey_enc( pxAes, ucKey, 256 );
+    }
+    else
+    {
+        prvPutU32( &ucKey[ 0 ], xModelAes.KEYR3 );
+        prvPutU32( &ucKey[ 4 ], xModelAes.KEYR2 );
+        prvPutU32( &ucKey[ 8 ], xModelAes.KEYR1 );
+        prvPutU32( &ucKey[ 12 ], xModelAes.KEYR0 );
+        ( void ) mbedtls_aes_setkey_enc( pxAes, ucKey, 128 );
+    }
+}
+
+static void prvGetCounter( uint8_t * pucCtr )
+{
+    prvPutU32( &pucCtr[ 0 ], xModelAes.IVR3 );
+    prvPutU32( &pucCtr[ 4 ], xModelAes.IVR2 );
+    prvPutU32( &pucCtr[ 8 ], xModelAes.IVR1 );
+    prvPutU32( &pucCtr[ 12 ], xModelAes.IVR0 );
+}
+
+static void prvGetGhash( uint8_t * pucY )
+{
+    prvPutU32( &pucY[ 0 ], xModelAes.SUSP0R );
+    prvPutU32( &pucY[ 4 ], xModelAes.SUSP1R );
+    prvPutU32( &pucY[ 8 ], xModelAes.SUSP2R );
+    prvPutU32( &pucY[ 12 ], xModelAes.SUSP3R );
+}
+
+static void prvSetGhash( const uint8_t * pucY )
+{
+    xModelAes.SUSP0R = prvGetU32( &pucY[ 0 ] );
+    xModelAes.SUSP1R = prvGetU32( &pucY[ 4 ] );
+    xModelAes.SUSP2R = prvGetU32( &pucY[ 8 ] );
+    xModelAes.SUSP3R = prvGetU32( &pucY[ 12 ] );
+}
+
+static uint32_t prvHeaderBytes( const CRYP_HandleTypeDef * hcryp )
+{
+    return ( hcryp->Init.HeaderWidthUnit == CRYP_HEADERWIDTHUNIT_BYTE ) ?
+           hcryp->Init.HeaderSize : hcryp->Init.HeaderSize * 4U;
+}
+
+/* Init and header phases: key, IV and AAD. */
+static void prvInitPhase( CRYP_HandleTypeDef * hcryp )
+{
+    const uint32_t * pulKey = hcryp->Init.pKey;
+    const uint32_t * pulIv = hcryp->Init.pInitVect;
+    mbedtls_aes_context xAes;
+    uint8_t ucH[ GCM_BLOCK_SIZE ] = { 0 };
+    uint8_t ucY[ GCM_BLOCK_SIZE ] = { 0 };
+
+    if( hcryp->Init.KeySize == CRYP_KEYSIZE_256B )
+    {
+        xModelAes.KEYR7 = pulKey[ 0 ];
+        xModelAes.KEYR6 = pulKey[ 1 ];
+        xModelAes.KEYR5 = pulKey[ 2 ];
+        xModelAes.KEYR4 = pulKey[ 3 ];
+        xModelAes.KEYR3 = pulKey[ 4 ];
+        xModelAes.KEYR2 = pulKey[ 5 ];
+        xModelAes.KEYR1 = pulKey[ 6 ];
+        xModelAes.KEYR0 = pulKey[ 7 ];
+    }
+    else
+    {
+        xModelAes.KEYR3 = pulKey[ 0 ];
+        xModelAes.KEYR2 = pulKey[ 1 ];
+        xModelAes.KEYR1 = pulKey[ 2 ];
+        xModelAes.KEYR0 = pulKey[ 3 ];
+    }
+
+    xModelAes.IVR3 = pulIv[ 0 ];
+    xModelAes.IVR2 = pulIv[ 1 ];
+    xModelAes.IVR1 = pulIv[ 2 ];
+    xModelAes.IVR0 = pulIv[ 3 ];
+
+    SET_BIT( xModelAes.CR, AES_CR_EN );
+
+    prvAesFromKeyRegisters( &xAes );
+    ( void ) mbedtls_aes_crypt_ecb( &xAes, MBEDTLS_AES_ENCRYPT, ucH, ucH );
+    mbedtls_aes_free( &xAes );
+
+    if( hcryp->Init.HeaderSize != 0U )
+    {
+        prvGhash( ucY, ucH, ( const uint8_t * ) hcryp->Init.Header, prvHeaderBytes( hcryp ) );
+    }
+
+    prvSetGhash( ucY );
+    hcryp->CrypHeaderCount = hcryp->Init.HeaderSize;
+    MODIFY_REG( xModelAes.CR, AES_CR_GCMPH, GCMPH_PAYLOAD );
+}
+
+static HAL_StatusTypeDef prvProcess( CRYP_HandleTypeDef * hcryp,
+                                     uint32_t ulMode,
+                                     const uint8_t * pucIn,
+                                     uint32_t ulSize,
+                                     uint8_t * pucOut )
+{
+    mbedtls_aes_context xAes;
+    uint8_t ucH[ GCM_BLOCK_SIZE ] = { 0 };
+    uint8_t ucY[ GCM_BLOCK_SIZE ];
+    uint8_t ucCtr[ GCM_BLOCK_SIZE ];
+    int lDoKeyIv = 1;
+
+    if( ( ulModelAesClock == 0U ) || ( hcryp->Instance != &xModelAes ) )
+    {
+        xStats.ulMisuse++;
+        return HAL_ERROR;
+    }
+
+    if( hcryp->Init.DataWidthUnit == CRYP_DATAWIDTHUNIT_WORD )
+    {
+        ulSize *= 4U;
+    }
+
+    MODIFY_REG( xModelAes.CR, AES_CR_MODE, ulMode );
+
+    if( hcryp->Init.KeyIVConfigSkip == CRYP_KEYIVCONFIG_ONCE )
+    {
+        if( hcryp->KeyIVConfig == 1U )
+        {
+            /* A partial block ends the payload of the message */
+            if( ( hcryp->SizesSum % GCM_BLOCK_SIZE ) != 0U )
+            {
+                xStats.ulMisuse++;
+                return HAL_ERROR;
+            }
+
+            lDoKeyIv = 0;
+            hcryp->SizesSum += ulSize;
+        }
+        else
+        {
+            hcryp->KeyIVConfig = 1U;
+            hcryp->SizesSum = ulSize;
+        }
+    }
+    else
+    {
+        hcryp->SizesSum = ulSize;
+    }
+
+    if( lDoKeyIv )
+    {
+        prvInitPhase( hcryp );
+    }
+    else if( ( ( xModelAes.CR & AES_CR_EN ) == 0U ) ||
+             ( ( xModelAes.CR & AES_CR_GCMPH ) != GCMPH_PAYLOAD ) )
+    {
+        /* The registers do not hold a message in its payload phase */
+        xStats.ulMisuse++;
+        return HAL_ERROR;
+    }
+
+    prvAesFromKeyRegisters( &xAes );
+    ( void ) mbedtls_aes_crypt_ecb( &xAes, MBEDTLS_AES_ENCRYPT, ucH, ucH );
+    prvGetCounter( ucCtr );
+    prvGetGhash( ucY );
+
+    if( ulMode == CRYP_OPERATINGMODE_DECRYPT )
+    {
+        prvGhash( ucY, ucH, pucIn, ulSize );
+        prvCtr( &xAes, ucCtr, pucIn, ulSize, pucOut );
+    }
+    else
+    {
+        prvCtr( &xAes, ucCtr, pucIn, ulSize, pucOut );
+        prvGhash( ucY, ucH, pucOut, ulSize );
+    }
+
+    xModelAes.IVR0 = prvGetU32( &ucCtr[ 12 ] );
+    prvSetGhash( ucY );
+    mbedtls_aes_free( &xAes );
+
+    return HAL_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+void vModelAesReset( void )
+{
+    memset( &xModelAes, 0, sizeof( xModelAes ) );
+}
+
+static void prvDefaultCallback( CRYP_HandleTypeDef * hcryp )
+{
+    ( void ) hcryp;
+}
+
+static void prvDefaultOutCpltCallback( CRYP_HandleTypeDef * hcryp )
+{
+    /* The completion of a DMA transfer reached nobody */
+    ( void ) hcryp;
+    xStats.ulMisuse++;
+}
+
+HAL_StatusTypeDef HAL_CRYP_Init( CRYP_HandleTypeDef * hcryp )
+{
+    if( hcryp == NULL )
+    {
+        return HAL_ERROR;
+    }
+
+    if( hcryp->State == HAL_CRYP_STATE_RESET )
+    {
+        hcryp->Lock = HAL_UNLOCKED;
+        hcryp->InCpltCallback = prvDefaultCallback;
+        hcryp->OutCpltCallback = prvDefaultOutCpltCallback;
+        hcryp->ErrorCallback = prvDefaultCallback;
+
+        if( hcryp->MspInitCallback == NULL )
+        {
+            hcryp->MspInitCallback = HAL_CRYP_MspInit;
+        }
+
+        hcryp->MspInitCallback( hcryp );
+    }
+
+    MODIFY_REG( hcryp->Instance->CR, AES_CR_DATATYPE | AES_CR_KEYSIZE | AES_CR_CHMOD,
+                hcryp->Init.DataType | hcryp->Init.KeySize | hcryp->Init.Algorithm );
+
+    hcryp->KeyIVConfig = 0U;
+    hcryp->ErrorCode = 0U;
+    hcryp->State = HAL_CRYP_STATE_READY;
+    hcryp->Phase = CRYP_PHASE_READY;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CRYP_DeInit( CRYP_HandleTypeDef * hcryp )
+{
+    if( hcryp == NULL )
+    {
+        return HAL_ERROR;
+    }
+
+    hcryp->Phase = CRYP_PHASE_READY;
+    hcryp->KeyIVConfig = 0U;
+    CLEAR_BIT( hcryp->Instance->CR, AES_CR_EN );
+
+    if( hcryp->MspDeInitCallback == NULL )
+    {
+        hcryp->MspDeInitCallback = HAL_CRYP_MspDeInit;
+    }
+
+    hcryp->MspDeInitCallback( hcryp );
+    hcryp->State = HAL_CRYP_STATE_RESET;
+    __HAL_UNLOCK( hcryp );
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CRYP_SetConfig( CRYP_HandleTypeDef * hcryp,
+                                      CRYP_ConfigTypeDef * pConf )
+{
+    if( hcryp->State != HAL_CRYP_STATE_READY )
+    {
+        return HAL_ERROR;
+    }
+
+    __HAL_LOCK( hcryp );
+
+    if( pConf != &hcryp->Init )
+    {
+        hcryp->Init = *pConf;
+    }
+
+    MODIFY_REG( hcryp->Instance->CR, AES_CR_DATATYPE | AES_CR_KEYSIZE | AES_CR_CHMOD,
+                hcryp->Init.DataType | hcryp->Init.KeySize | hcryp->Init.Algorithm );
+
+    hcryp->KeyIVConfig = 0U;
+    hcryp->ErrorCode = 0U;
+    hcryp->Phase = CRYP_PHASE_READY;
+    __HAL_UNLOCK( hcryp );
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CRYP_RegisterCallback( CRYP_HandleTypeDef * hcryp,
+                                             HAL_CRYP_CallbackIDTypeDef CallbackID,
+                                             pCRYP_CallbackTypeDef pCallback )
+{
+    HAL_StatusTypeDef xStatus = HAL_OK;
+
+    if( pCallback == NULL )
+    {
+        return HAL_ERROR;
+    }
+
+    __HAL_LOCK( hcryp );
+
+    if( hcryp->State == HAL_CRYP_STATE_READY )
+    {
+        switch( CallbackID )
+        {
+            case HAL_CRYP_INPUT_COMPLETE_CB_ID:
+                hcryp->InCpltCallback = pCallback;
+                break;
+
+            case HAL_CRYP_OUTPUT_COMPLETE_CB_ID:
+                hcryp->OutCpltCallback = pCallback;
+                break;
+
+            case HAL_CRYP_ERROR_CB_ID:
+                hcryp->ErrorCallback = pCallback;
+                break;
+
+            case HAL_CRYP_MSPINIT_CB_ID:
+                hcryp->MspInitCallback = pCallback;
+                break;
+
+            case HAL_CRYP_MSPDEINIT_CB_ID:
+                hcryp->MspDeInitCallback = pCallback;
+                break;
+
+            default:
+                xStatus = HAL_ERROR;
+                break;
+        }
+    }
+    else
+    {
+        xStatus = HAL_ERROR;
+    }
+
+    __HAL_UNLOCK( hcryp );
+
+    return xStatus;
+}
+
+static HAL_StatusTypeDef prvCrypPolling( CRYP_HandleTypeDef * hcryp,
+                                         uint32_t ulMode,
+                                         uint32_t * pInput,
+                                         uint16_t Size,
+                                         uint32_t * pOutput )
+{
+    HAL_StatusTypeDef xStatus;
+
+    if( hcryp->State != HAL_CRYP_STATE_READY )
+    {
+        return HAL_ERROR;
+    }
+
+    __HAL_LOCK( hcryp );
+    hcryp->State = HAL_CRYP_STATE_BUSY;
+    hcryp->Phase = CRYP_PHASE_PROCESS;
+    hcryp->Size = Size;
+    xStats.ulPolled++;
+
+    xStatus = prvProcess( hcryp, ulMode, ( const uint8_t * ) pInput, Size, ( uint8_t * ) pOutput );
+
+    hcryp->State = HAL_CRYP_STATE_READY;
+    __HAL_UNLOCK( hcryp );
+
+    return xStatus;
+}
+
+HAL_StatusTypeDef HAL_CRYP_Encrypt( CRYP_HandleTypeDef * hcryp,
+                                    uint32_t * pInput,
+                                    uint16_t Size,
+                                    uint32_t * pOutput,
+                                    uint32_t Timeout )
+{
+    ( void ) Timeout;
+    return prvCrypPolling( hcryp, CRYP_OPERATINGMODE_ENCRYPT, pInput, Size, pOutput );
+}
+
+HAL_StatusTypeDef HAL_CRYP_Decrypt( CRYP_HandleTypeDef * hcryp,
+                                    uint32_t * pInput,
+                                    uint16_t Size,
+                                    uint32_t * pOutput,
+                                    uint32_t Timeout )
+{
+    ( void ) Timeout;
+    return prvCrypPolling( hcryp, CRYP_OPERATINGMODE_DECRYPT, pInput, Size, pOutput );
+}
+
+static void prvDmaInCplt( DMA_HandleTypeDef * hdma )
+{
+    CRYP_HandleTypeDef * hcryp = ( CRYP_HandleTypeDef * ) hdma->Parent;
+
+    CLEAR_BIT( hcryp->Instance->CR, AES_CR_DMAINEN );
+    hcryp->InCpltCallback( hcryp );
+}
+
+static void prvDmaOutCplt( DMA_HandleTypeDef * hdma )
+{
+    CRYP_HandleTypeDef * hcryp = ( CRYP_HandleTypeDef * ) hdma->Parent;
+
+    CLEAR_BIT( hcryp->Instance->CR, AES_CR_DMAOUTEN );
+    hcryp->State = HAL_CRYP_STATE_READY;
+    __HAL_UNLOCK( hcryp );
+    hcryp->OutCpltCallback( hcryp );
+}
+
+static void prvDmaError( DMA_HandleTypeDef * hdma )
+{
+    CRYP_HandleTypeDef * hcryp = ( CRYP_HandleTypeDef * ) hdma->Parent;
+
+    CLEAR_BIT( hcryp->Instance->CR, AES_CR_DMAINEN | AES_CR_DMAOUTEN );
+    hcryp->ErrorCode = 1U;
+    hcryp->State = HAL_CRYP_STATE_READY;
+    __HAL_UNLOCK( hcryp );
+    hcryp->ErrorCallback( hcryp );
+}
+
+static int prvDmaReady( const DMA_HandleTypeDef * hdma,
+                        const CRYP_HandleTypeDef * hcryp,
+                        uint32_t ulRequest )
+{
+    return ( hdma != NULL ) && ( hdma->Instance != NULL ) &&
+           ( hdma->Instance->ulRequest == ulRequest ) &&
+           ( hdma->Parent == hcryp ) && ( ulModelGpdmaClock != 0U );
+}
+
+static HAL_StatusTypeDef prvCrypDma( CRYP_HandleTypeDef * hcryp,
+                                     uint32_t ulMode,
+                                     uint32_t * pInput,
+                                     uint16_t Size,
+                                     uint32_t * pOutput )
+{
+    HAL_StatusTypeDef xStatus = HAL_OK;
+    DMA_Channel_TypeDef * pxIn;
+    DMA_Channel_TypeDef * pxOut;
+
+    if( hcryp->State != HAL_CRYP_STATE_READY )
+    {
+        return HAL_BUSY;
+    }
+
+    /* The channels move whole blocks of words */
+    if( !prvDmaReady( hcryp->hdmain, hcryp, GPDMA1_REQUEST_AES_IN ) ||
+        !prvDmaReady( hcryp->hdmaout, hcryp, GPDMA1_REQUEST_AES_OUT ) ||
+        ( ( Size % GCM_BLOCK_SIZE ) != 0U ) ||
+        ( ( ( ( uintptr_t ) pInput | ( uintptr_t ) pOutput ) & 0x3U ) != 0U ) )
+    {
+        xStats.ulMisuse++;
+        return HAL_ERROR;
+    }
+
+    __HAL_LOCK( hcryp );
+    hcryp->State = HAL_CRYP_STATE_BUSY;
+    hcryp->Phase = CRYP_PHASE_PROCESS;
+    hcryp->Size = Size;
+    xStats.ulDma++;
+
+    hcryp->hdmain->XferCpltCallback = prvDmaInCplt;
+    hcryp->hdmain->XferErrorCallback = prvDmaError;
+    hcryp->hdmaout->XferCpltCallback = prvDmaOutCplt;
+    hcryp->hdmaout->XferErrorCallback = prvDmaError;
+
+    if( xDmaFault == eModelDmaNoCompletion )
+    {
+        SET_BIT( hcryp->Instance->CR, AES_CR_DMAINEN | AES_CR_DMAOUTEN );
+        return HAL_OK;
+    }
+
+    xStatus = prvProcess( hcryp, ulMode, ( const uint8_t * ) pInput, Size, ( uint8_t * ) pOutput );
+
+    if( xStatus != HAL_OK )
+    {
+        hcryp->State = HAL_CRYP_STATE_READY;
+        __HAL_UNLOCK( hcryp );
+        return xStatus;
+    }
+
+    SET_BIT( hcryp->Instance->CR, AES_CR_DMAINEN | AES_CR_DMAOUTEN );
+
+    pxIn = hcryp->hdmain->Instance;
+    pxOut = hcryp->hdmaout->Instance;
+    pxIn->ulPending = 1U;
+    pxOut->ulPending = 1U;
+    pxOut->ulError = ( xDmaFault == eModelDmaError ) ? 1U : 0U;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CRYP_Encrypt_DMA( CRYP_HandleTypeDef * hcryp,
+                                        uint32_t * pInput,
+                                        uint16_t Size,
+                                        uint32_t * pOutput )
+{
+    return prvCrypDma( hcryp, CRYP_OPERATINGMODE_ENCRYPT, pInput, Size, pOutput );
+}
+
+HAL_StatusTypeDef HAL_CRYP_Decrypt_DMA( CRYP_HandleTypeDef * hcryp,
+                                        uint32_t * pInput,
+                                        uint16_t Size,
+                                        uint32_t * pOutput )
+{
+    return prvCrypDma( hcryp, CRYP_OPERATINGMODE_DECRYPT, pInput, Size, pOutput );
+}
+
+HAL_StatusTypeDef HAL_CRYPEx_AESGCM_GenerateAuthTAG( CRYP_HandleTypeDef * hcryp,
+                                                     uint32_t * pAuthTag,
+                                                     uint32_t Timeout )
+{
+    mbedtls_aes_context xAes;
+    uint8_t ucH[ GCM_BLOCK_SIZE ] = { 0 };
+    uint8_t ucY[ GCM_BLOCK_SIZE ];
+    uint8_t ucJ0[ GCM_BLOCK_SIZE ];
+    uint8_t * pucTag = ( uint8_t * ) pAuthTag;
+    uint32_t i;
+
+    ( void ) Timeout;
+
+    if( hcryp->State != HAL_CRYP_STATE_READY )
+    {
+        return HAL_ERROR;
+    }
+
+    /* Init and header phases must have been run by Encrypt / Decrypt */
+    if( ( hcryp->Phase != CRYP_PHASE_PROCESS ) ||
+        ( ( xModelAes.CR & AES_CR_GCMPH ) != GCMPH_PAYLOAD ) )
+    {
+        xStats.ulMisuse++;
+        return HAL_ERROR;
+    }
+
+    __HAL_LOCK( hcryp );
+
+    MODIFY_REG( xModelAes.CR, AES_CR_GCMPH, GCMPH_FINAL );
+
+    prvAesFromKeyRegisters( &xAes );
+    ( void ) mbedtls_aes_crypt_ecb( &xAes, MBEDTLS_AES_ENCRYPT, ucH, ucH );
+
+    prvGetGhash( ucY );
+    prvGhashLengths( ucY, ucH, prvHeaderBytes( hcryp ), hcryp->SizesSum );
+
+    prvGetCounter( ucJ0 );
+    prvPutU32( &ucJ0[ 12 ], 1U );
+    ( void ) mbedtls_aes_crypt_ecb( &xAes, MBEDTLS_AES_ENCRYPT, ucJ0, ucJ0 );
+    mbedtls_aes_free( &xAes );
+
+    for( i = 0; i < GCM_BLOCK_SIZE; i++ )
+    {
+        pucTag[ i ] = ucY[ i ] ^ ucJ0[ i ];
+    }
+
+    CLEAR_BIT( xModelAes.CR, AES_CR_EN );
+    hcryp->Phase = CRYP_PHASE_READY;
+    __HAL_UNLOCK( hcryp );
+
+    return HAL_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef * hdma )
+{
+    if( ( hdma == NULL ) || ( hdma->Instance == NULL ) || ( ulModelGpdmaClock == 0U ) )
+    {
+        return HAL_ERROR;
+    }
+
+    /* The AES requests only work in their own direction */
+    if( ( ( hdma->Init.Request == GPDMA1_REQUEST_AES_IN ) &&
+          ( hdma->Init.Direction != DMA_MEMORY_TO_PERIPH ) ) ||
+        ( ( hdma->Init.Request == GPDMA1_REQUEST_AES_OUT ) &&
+          ( hdma->Init.Direction != DMA_PERIPH_TO_MEMORY ) ) )
+    {
+        xStats.ulMisuse++;
+        return HAL_ERROR;
+    }
+
+    hdma->Instance->ulRequest = hdma->Init.Request;
+    hdma->Instance->ulPending = 0U;
+    hdma->Instance->ulError = 0U;
+    hdma->Lock = HAL_UNLOCKED;
+    hdma->State = 1U;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_ConfigChannelAttributes( DMA_HandleTypeDef * hdma,
+                                                   uint32_t ChannelAttributes )
+{
+    ( void ) ChannelAttributes;
+
+    return ( hdma->State != 0U ) ? HAL_OK : HAL_ERROR;
+}
+
+static uint32_t prvChannelIndex( const DMA_Channel_TypeDef * pxChannel )
+{
+    return ( uint32_t ) ( pxChannel - xModelGpdmaChannel );
+}
+
+static void prvRunVector( uint32_t ulChannel )
+{
+    uint32_t ulIrq = ( uint32_t ) GPDMA1_Channel0_IRQn + ulChannel;
+
+    if( ucIrqEnabled[ ulIrq ] == 0U )
+    {
+        return;
+    }
+
+    ulIpsr = ulIrq + 16U;
+    xStats.ulInterrupts++;
+    pxGpdmaVectors[ ulChannel ]();
+    ulIpsr = 0U;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort( DMA_HandleTypeDef * hdma )
+{
+    DMA_Channel_TypeDef * pxChannel = hdma->Instance;
+
+    /* The interrupt of a transfer which completed as the caller gave up on */
+    /* it runs before the channel is stopped                                */
+    if( ( xDmaFault == eModelDmaLate ) && ( pxChannel->ulPending != 0U ) )
+    {
+        prvRunVector( prvChannelIndex( pxChannel ) );
+    }
+
+    xStats.ulDmaAborted++;
+
+    pxChannel->ulPending = 0U;
+    pxChannel->ulError = 0U;
+
+    return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler( DMA_HandleTypeDef * hdma )
+{
+    DMA_Channel_TypeDef * pxChannel = hdma->Instance;
+
+    if( pxChannel->ulPending == 0U )
+    {
+        return;
+    }
+
+    pxChannel->ulPending = 0U;
+
+    if( pxChannel->ulError != 0U )
+    {
+        pxChannel->ulError = 0U;
+
+        if( hdma->XferErrorCallback != NULL )
+        {
+            hdma->XferErrorCallback( hdma );
+        }
+    }
+    else if( hdma->XferCpltCallback != NULL )
+    {
+        hdma->XferCpltCallback( hdma );
+    }
+}
+
+void HAL_NVIC_SetPriority( IRQn_Type IRQn,
+                           uint32_t PreemptPriority,
+                           uint32_t SubPriority )
+{
+    ( void ) IRQn;
+    ( void ) PreemptPriority;
+    ( void ) SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ( IRQn_Type IRQn )
+{
+    ucIrqEnabled[ ( uint32_t ) IRQn ] = 1U;
+}
+
+uint32_t __get_IPSR( void )
+{
+    return ulIpsr;
+}
+
+DWT_Type * pxModelDwt( void )
+{
+    struct timespec xNow;
+
+    if( ( ( xModelCoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk ) != 0U ) &&
+        ( ( xDwt.CTRL & DWT_CTRL_CYCCNTENA_Msk ) != 0U ) )
+    {
+        ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+        xDwt.CYCCNT = ( uint32_t ) ( ( uint64_t ) xNow.tv_sec * 1000000000ULL + ( uint64_t ) xNow.tv_nsec );
+    }
+
+    return &xDwt;
+}
+
+/*-----------------------------------------------------------*/
+
+void vModelServiceInterrupts( void )
+{
+    uint32_t i;
+
+    /* Late completions only run when the transfer is aborted */
+    if( xDmaFault == eModelDmaLate )
+    {
+        return;
+    }
+
+    for( i = 0; i < MODEL_NUM_CHANNELS; i++ )
+    {
+        if( xModelGpdmaChannel[ i ].ulPending != 0U )
+        {
+            prvRunVector( i );
+        }
+    }
+}
+
+void vModelSetDmaFault( ModelDmaFault_t xFault )
+{
+    xDmaFault = xFault;
+}
+
+void vModelGetStats( ModelStats_t * pxStats )
+{
+    *pxStats = xStats;
+}
+
+void vModelResetStats( void )
+{
+    memset( &xStats, 0, sizeof( xStats ) );
+}
@@ -0,0 +1,76 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file hal_model.h
+ * @brief Controls of the AES and GPDMA model, for the tests.
+ */
+
+#ifndef HAL_MODEL_H
+#define HAL_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Behaviour of the next DMA transfers. */
+typedef enum
+{
+    eModelDmaNormal = 0,     /* complete when the caller blocks */
+    eModelDmaNoCompletion,   /* never complete */
+    eModelDmaError,          /* complete with a transfer error */
+    eModelDmaLate            /* complete after the caller timed out, as the transfer is aborted */
+} ModelDmaFault_t;
+
+typedef struct
+{
+    uint32_t ulPolled;        /* HAL_CRYP_Encrypt / Decrypt calls */
+    uint32_t ulDma;           /* HAL_CRYP_Encrypt_DMA / Decrypt_DMA calls */
+    uint32_t ulDmaAborted;    /* transfers stopped by HAL_DMA_Abort */
+    uint32_t ulInterrupts;    /* interrupt handlers run */
+    uint32_t ulMisuse;        /* sequences the peripheral or the HAL reject */
+} ModelStats_t;
+
+void vModelSetDmaFault( ModelDmaFault_t xFault );
+
+void vModelGetStats( ModelStats_t * pxStats );
+
+void vModelResetStats( void );
+
+/* Run the pending interrupts whose vector is enabled. */
+void vModelServiceInterrupts( void );
+
+/*
+ * AES-GCM with a 96 bits IV, computed in one pass with the primitives of the
+ * model, independently of the register sequence. The tag is 16 bytes.
+ */
+void vModelGcmReference( const uint8_t * pucKey,
+                         size_t xKeyLen,
+                         const uint8_t * pucIv,
+                         const uint8_t * pucAad,
+                         size_t xAadLen,
+                         const uint8_t * pucIn,
+                         size_t xLen,
+                         int lDecrypt,
+                         uint8_t * pucOut,
+                         uint8_t * pucTag );
+
+#endif /* HAL_MODEL_H */
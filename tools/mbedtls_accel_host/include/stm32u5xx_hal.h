@@ -0,0 +1,367 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file stm32u5xx_hal.h
+ * @brief Subset of the STM32U5 HAL used by the CRYP driver of the mbedtls
+ * accelerators, implemented by a software model of the AES peripheral and of
+ * the GPDMA channels (hal_model.c).
+ *
+ * The model keeps the whole GCM state in the peripheral registers, as the
+ * hardware does: the counter in IVR0..3 and the GHASH accumulator in
+ * SUSP0R..SUSP3R. A driver which does not save and restore them when contexts
+ * share the peripheral produces wrong results.
+ */
+
+#ifndef STM32U5XX_HAL_H
+#define STM32U5XX_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Same settings as Common/config/stm32u5xx_hal_conf.h */
+#define USE_HAL_CRYP_REGISTER_CALLBACKS    1U
+
+/* Core */
+typedef enum
+{
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+    HAL_UNLOCKED = 0x00U,
+    HAL_LOCKED = 0x01U
+} HAL_LockTypeDef;
+
+#define SET_BIT( REG, BIT )                       ( ( REG ) |= ( BIT ) )
+#define CLEAR_BIT( REG, BIT )                     ( ( REG ) &= ~( BIT ) )
+#define READ_BIT( REG, BIT )                      ( ( REG ) & ( BIT ) )
+#define MODIFY_REG( REG, CLEARMASK, SETMASK )     ( ( REG ) = ( ( ( REG ) & ( ~( CLEARMASK ) ) ) | ( SETMASK ) ) )
+
+#define __HAL_LOCK( __HANDLE__ )                                  \
+    do {                                                          \
+        if( ( __HANDLE__ )->Lock == HAL_LOCKED ) return HAL_BUSY; \
+        ( __HANDLE__ )->Lock = HAL_LOCKED;                        \
+    } while( 0 )
+
+#define __HAL_UNLOCK( __HANDLE__ )                                \
+    do {                                                          \
+        ( __HANDLE__ )->Lock = HAL_UNLOCKED;                      \
+    } while( 0 )
+
+#define __HAL_LINKDMA( __HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__ ) \
+    do {                                                               \
+        ( __HANDLE__ )->__PPP_DMA_FIELD__ = &( __DMA_HANDLE__ );       \
+        ( __DMA_HANDLE__ ).Parent = ( __HANDLE__ );                    \
+    } while( 0 )
+
+#define __ALIGN_BEGIN
+#define __ALIGN_END    __attribute__( ( aligned( 4 ) ) )
+
+/* Interrupts: the model runs pending interrupts when the caller blocks. */
+typedef enum
+{
+    GPDMA1_Channel0_IRQn = 29,
+    GPDMA1_Channel1_IRQn = 30,
+    GPDMA1_Channel2_IRQn = 31,
+    GPDMA1_Channel3_IRQn = 32,
+    GPDMA1_Channel4_IRQn = 33,
+    GPDMA1_Channel5_IRQn = 34,
+    GPDMA1_Channel6_IRQn = 35,
+    GPDMA1_Channel7_IRQn = 36
+} IRQn_Type;
+
+void HAL_NVIC_SetPriority( IRQn_Type IRQn,
+                           uint32_t PreemptPriority,
+                           uint32_t SubPriority );
+void HAL_NVIC_EnableIRQ( IRQn_Type IRQn );
+
+/* Active exception number: non zero while the model runs an interrupt handler */
+uint32_t __get_IPSR( void );
+
+#define __disable_irq()
+#define __enable_irq()
+
+/* Cycle counter: CYCCNT counts nanoseconds of the host clock while enabled */
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+DWT_Type * pxModelDwt( void );
+extern CoreDebug_Type xModelCoreDebug;
+
+#define DWT                            ( pxModelDwt() )
+#define CoreDebug                      ( &xModelCoreDebug )
+#define DWT_CTRL_CYCCNTENA_Msk         ( 1UL << 0 )
+#define CoreDebug_DEMCR_TRCENA_Msk     ( 1UL << 24 )
+
+/* Clocks */
+extern uint32_t ulModelAesClock;
+extern uint32_t ulModelGpdmaClock;
+
+#define __HAL_RCC_AES_CLK_ENABLE()        ( ulModelAesClock = 1U )
+#define __HAL_RCC_AES_CLK_DISABLE()       ( ulModelAesClock = 0U )
+#define __HAL_RCC_AES_FORCE_RESET()       vModelAesReset()
+#define __HAL_RCC_AES_RELEASE_RESET()
+#define __HAL_RCC_GPDMA1_CLK_ENABLE()     ( ulModelGpdmaClock = 1U )
+
+void vModelAesReset( void );
+
+/* AES peripheral */
+typedef struct
+{
+    volatile uint32_t CR;
+    volatile uint32_t SR;
+    volatile uint32_t DINR;
+    volatile uint32_t DOUTR;
+    volatile uint32_t KEYR0;
+    volatile uint32_t KEYR1;
+    volatile uint32_t KEYR2;
+    volatile uint32_t KEYR3;
+    volatile uint32_t IVR0;
+    volatile uint32_t IVR1;
+    volatile uint32_t IVR2;
+    volatile uint32_t IVR3;
+    volatile uint32_t KEYR4;
+    volatile uint32_t KEYR5;
+    volatile uint32_t KEYR6;
+    volatile uint32_t KEYR7;
+    volatile uint32_t SUSP0R;
+    volatile uint32_t SUSP1R;
+    volatile uint32_t SUSP2R;
+    volatile uint32_t SUSP3R;
+    volatile uint32_t SUSP4R;
+    volatile uint32_t SUSP5R;
+    volatile uint32_t SUSP6R;
+    volatile uint32_t SUSP7R;
+} AES_TypeDef;
+
+extern AES_TypeDef xModelAes;
+
+#define AES                   ( &xModelAes )
+
+#define AES_CR_EN             ( 0x1UL << 0 )
+#define AES_CR_DATATYPE       ( 0x3UL << 1 )
+#define AES_CR_DATATYPE_1     ( 0x2UL << 1 )
+#define AES_CR_MODE           ( 0x3UL << 3 )
+#define AES_CR_MODE_1         ( 0x2UL << 3 )
+#define AES_CR_CHMOD          ( ( 0x3UL << 5 ) | ( 0x1UL << 16 ) )
+#define AES_CR_DMAINEN        ( 0x1UL << 11 )
+#define AES_CR_DMAOUTEN       ( 0x1UL << 12 )
+#define AES_CR_GCMPH          ( 0x3UL << 13 )
+#define AES_CR_KEYSIZE        ( 0x1UL << 18 )
+
+#define CRYP_AES_GCM_GMAC             ( 0x3UL << 5 )
+#define CRYP_DATATYPE_8B              AES_CR_DATATYPE_1
+#define CRYP_DATAWIDTHUNIT_WORD       0x00000000U
+#define CRYP_DATAWIDTHUNIT_BYTE       0x00000001U
+#define CRYP_HEADERWIDTHUNIT_WORD     0x00000000U
+#define CRYP_HEADERWIDTHUNIT_BYTE     0x00000001U
+#define CRYP_KEYSIZE_128B             0x00000000U
+#define CRYP_KEYSIZE_256B             AES_CR_KEYSIZE
+#define CRYP_KEYIVCONFIG_ALWAYS       0x00000000U
+#define CRYP_KEYIVCONFIG_ONCE         0x00000001U
+#define CRYP_OPERATINGMODE_ENCRYPT    0x00000000U
+#define CRYP_OPERATINGMODE_DECRYPT    AES_CR_MODE_1
+
+#define CRYP_PHASE_READY              0x00000001U
+#define CRYP_PHASE_PROCESS            0x00000002U
+
+/* GPDMA */
+typedef struct
+{
+    uint32_t ulRequest;    /* peripheral request, set by HAL_DMA_Init */
+    uint32_t ulPending;    /* transfer interrupt pending */
+    uint32_t ulError;      /* the pending interrupt reports an error */
+} DMA_Channel_TypeDef;
+
+extern DMA_Channel_TypeDef xModelGpdmaChannel[ 8 ];
+
+#define GPDMA1_Channel0    ( &xModelGpdmaChannel[ 0 ] )
+#define GPDMA1_Channel1    ( &xModelGpdmaChannel[ 1 ] )
+#define GPDMA1_Channel2    ( &xModelGpdmaChannel[ 2 ] )
+#define GPDMA1_Channel3    ( &xModelGpdmaChannel[ 3 ] )
+#define GPDMA1_Channel4    ( &xModelGpdmaChannel[ 4 ] )
+#define GPDMA1_Channel5    ( &xModelGpdmaChannel[ 5 ] )
+#define GPDMA1_Channel6    ( &xModelGpdmaChannel[ 6 ] )
+#define GPDMA1_Channel7    ( &xModelGpdmaChannel[ 7 ] )
+
+#define GPDMA1_REQUEST_AES_IN            90U
+#define GPDMA1_REQUEST_AES_OUT           91U
+#define DMA_BREQ_SINGLE_BURST            0x00000000U
+#define DMA_PERIPH_TO_MEMORY             0x00000000U
+#define DMA_MEMORY_TO_PERIPH             0x00000001U
+#define DMA_SINC_FIXED                   0x00000000U
+#define DMA_SINC_INCREMENTED             0x00000001U
+#define DMA_DINC_FIXED                   0x00000000U
+#define DMA_DINC_INCREMENTED             0x00000001U
+#define DMA_SRC_DATAWIDTH_WORD           0x00000002U
+#define DMA_DEST_DATAWIDTH_WORD          0x00000002U
+#define DMA_LOW_PRIORITY_HIGH_WEIGHT     0x00000002U
+#define DMA_SRC_ALLOCATED_PORT0          0x00000000U
+#define DMA_SRC_ALLOCATED_PORT1          0x00000001U
+#define DMA_DEST_ALLOCATED_PORT0         0x00000000U
+#define DMA_DEST_ALLOCATED_PORT1         0x00000002U
+#define DMA_TCEM_BLOCK_TRANSFER          0x00000000U
+#define DMA_NORMAL                       0x00000000U
+#define DMA_CHANNEL_NPRIV                0x00000010U
+
+typedef struct
+{
+    uint32_t Request;
+    uint32_t BlkHWRequest;
+    uint32_t Direction;
+    uint32_t SrcInc;
+    uint32_t DestInc;
+    uint32_t SrcDataWidth;
+    uint32_t DestDataWidth;
+    uint32_t Priority;
+    uint32_t SrcBurstLength;
+    uint32_t DestBurstLength;
+    uint32_t TransferAllocatedPort;
+    uint32_t TransferEventMode;
+    uint32_t Mode;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+    DMA_Channel_TypeDef * Instance;
+    DMA_InitTypeDef Init;
+    HAL_LockTypeDef Lock;
+    uint32_t State;
+    void * Parent;
+    void ( * XferCpltCallback )( struct __DMA_HandleTypeDef * hdma );
+    void ( * XferErrorCallback )( struct __DMA_HandleTypeDef * hdma );
+    uint32_t ErrorCode;
+} DMA_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef * hdma );
+HAL_StatusTypeDef HAL_DMA_ConfigChannelAttributes( DMA_HandleTypeDef * hdma,
+                                                   uint32_t ChannelAttributes );
+HAL_StatusTypeDef HAL_DMA_Abort( DMA_HandleTypeDef * hdma );
+void HAL_DMA_IRQHandler( DMA_HandleTypeDef * hdma );
+
+/* CRYP */
+typedef enum
+{
+    HAL_CRYP_STATE_RESET = 0x00U,
+    HAL_CRYP_STATE_READY = 0x01U,
+    HAL_CRYP_STATE_BUSY = 0x02U
+} HAL_CRYP_STATETypeDef;
+
+typedef struct
+{
+    uint32_t DataType;
+    uint32_t KeySize;
+    uint32_t * pKey;
+    uint32_t * pInitVect;
+    uint32_t Algorithm;
+    uint32_t * Header;
+    uint32_t HeaderSize;
+    uint32_t * B0;
+    uint32_t DataWidthUnit;
+    uint32_t HeaderWidthUnit;
+    uint32_t KeyIVConfigSkip;
+    uint32_t KeyMode;
+} CRYP_ConfigTypeDef;
+
+typedef struct __CRYP_HandleTypeDef
+{
+    AES_TypeDef * Instance;
+    CRYP_ConfigTypeDef Init;
+    uint32_t * pCrypInBuffPtr;
+    uint32_t * pCrypOutBuffPtr;
+    uint32_t CrypHeaderCount;
+    uint16_t CrypInCount;
+    uint16_t CrypOutCount;
+    uint16_t Size;
+    uint32_t Phase;
+    DMA_HandleTypeDef * hdmain;
+    DMA_HandleTypeDef * hdmaout;
+    HAL_LockTypeDef Lock;
+    volatile HAL_CRYP_STATETypeDef State;
+    volatile uint32_t ErrorCode;
+    uint32_t KeyIVConfig;
+    uint32_t SizesSum;
+    void ( * InCpltCallback )( struct __CRYP_HandleTypeDef * hcryp );
+    void ( * OutCpltCallback )( struct __CRYP_HandleTypeDef * hcryp );
+    void ( * ErrorCallback )( struct __CRYP_HandleTypeDef * hcryp );
+    void ( * MspInitCallback )( struct __CRYP_HandleTypeDef * hcryp );
+    void ( * MspDeInitCallback )( struct __CRYP_HandleTypeDef * hcryp );
+} CRYP_HandleTypeDef;
+
+typedef enum
+{
+    HAL_CRYP_INPUT_COMPLETE_CB_ID = 0x01U,
+    HAL_CRYP_OUTPUT_COMPLETE_CB_ID = 0x02U,
+    HAL_CRYP_ERROR_CB_ID = 0x03U,
+    HAL_CRYP_MSPINIT_CB_ID = 0x04U,
+    HAL_CRYP_MSPDEINIT_CB_ID = 0x05U
+} HAL_CRYP_CallbackIDTypeDef;
+
+typedef void ( * pCRYP_CallbackTypeDef )( CRYP_HandleTypeDef * hcryp );
+
+HAL_StatusTypeDef HAL_CRYP_Init( CRYP_HandleTypeDef * hcryp );
+HAL_StatusTypeDef HAL_CRYP_DeInit( CRYP_HandleTypeDef * hcryp );
+HAL_StatusTypeDef HAL_CRYP_SetConfig( CRYP_HandleTypeDef * hcryp,
+                                      CRYP_ConfigTypeDef * pConf );
+HAL_StatusTypeDef HAL_CRYP_RegisterCallback( CRYP_HandleTypeDef * hcryp,
+                                             HAL_CRYP_CallbackIDTypeDef CallbackID,
+                                             pCRYP_CallbackTypeDef pCallback );
+HAL_StatusTypeDef HAL_CRYP_Encrypt( CRYP_HandleTypeDef * hcryp,
+                                    uint32_t * pInput,
+                                    uint16_t Size,
+                                    uint32_t * pOutput,
+                                    uint32_t Timeout );
+HAL_StatusTypeDef HAL_CRYP_Decrypt( CRYP_HandleTypeDef * hcryp,
+                                    uint32_t * pInput,
+                                    uint16_t Size,
+                                    uint32_t * pOutput,
+                                    uint32_t Timeout );
+HAL_StatusTypeDef HAL_CRYP_Encrypt_DMA( CRYP_HandleTypeDef * hcryp,
+                                        uint32_t * pInput,
+                                        uint16_t Size,
+                                        uint32_t * pOutput );
+HAL_StatusTypeDef HAL_CRYP_Decrypt_DMA( CRYP_HandleTypeDef * hcryp,
+                                        uint32_t * pInput,
+                                        uint16_t Size,
+                                        uint32_t * pOutput );
+HAL_StatusTypeDef HAL_CRYPEx_AESGCM_GenerateAuthTAG( CRYP_HandleTypeDef * hcryp,
+                                                     uint32_t * pAuthTag,
+                                                     uint32_t Timeout );
+
+/* Provided by the driver, as by any HAL user */
+void HAL_CRYP_MspInit( CRYP_HandleTypeDef * hcryp );
+void HAL_CRYP_MspDeInit( CRYP_HandleTypeDef * hcryp );
+
+#endif /* STM32U5XX_HAL_H */
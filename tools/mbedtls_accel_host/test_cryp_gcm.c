@@ -0,0 +1,485 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file test_cryp_gcm.c
+ * @brief Host test of the alternative GCM implementation and of the CRYP
+ * driver, polling and DMA, against the peripheral model of hal_model.c.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mbedtls/gcm.h"
+#include "mbedtls/error.h"
+
+#include "cryp_stm32.h"
+#include "crypto_sw_stm32.h"
+#include "hal_model.h"
+
+/* Published by the CRYP driver and served by the application's vectors, as */
+/* in Common/sys/hal_init.c and Common/sys/interrupt_handlers.c             */
+DMA_HandleTypeDef * pxHndlGpdmaCh6 = NULL;
+DMA_HandleTypeDef * pxHndlGpdmaCh7 = NULL;
+
+void GPDMA1_Channel6_IRQHandler( void )
+{
+    if( pxHndlGpdmaCh6 != NULL )
+    {
+        HAL_DMA_IRQHandler( pxHndlGpdmaCh6 );
+    }
+}
+
+void GPDMA1_Channel7_IRQHandler( void )
+{
+    if( pxHndlGpdmaCh7 != NULL )
+    {
+        HAL_DMA_IRQHandler( pxHndlGpdmaCh7 );
+    }
+}
+
+static uint32_t ulFailures = 0;
+static uint32_t ulChecks = 0;
+
+#define CHECK( x )                                                      \
+    do {                                                                \
+        ulChecks++;                                                     \
+        if( !( x ) )                                                    \
+        {                                                               \
+            ulFailures++;                                               \
+            printf( "FAIL %s:%d: %s\n", __FILE__, __LINE__, #x );       \
+        }                                                               \
+    } while( 0 )
+
+#define MAX_LEN    20000U
+
+/* Word aligned buffers, as required by the DMA path */
+static uint32_t ulIn[ MAX_LEN / 4U + 1U ];
+static uint32_t ulOut[ MAX_LEN / 4U + 1U ];
+static uint32_t ulBack[ MAX_LEN / 4U + 1U ];
+static uint8_t ucRef[ MAX_LEN ];
+
+static uint32_t ulSeed = 0x12345678U;
+
+static void prvFill( uint8_t * pucBuf,
+                     size_t xLen )
+{
+    size_t i;
+
+    for( i = 0; i < xLen; i++ )
+    {
+        ulSeed = ulSeed * 1103515245U + 12345U;
+        pucBuf[ i ] = ( uint8_t ) ( ulSeed >> 16 );
+    }
+}
+
+static size_t prvUnhex( const char * pcHex,
+                        uint8_t * pucOut )
+{
+    size_t i, xLen = strlen( pcHex ) / 2U;
+    unsigned int uByte;
+
+    for( i = 0; i < xLen; i++ )
+    {
+        ( void ) sscanf( &pcHex[ 2U * i ], "%2x", &uByte );
+        pucOut[ i ] = ( uint8_t ) uByte;
+    }
+
+    return xLen;
+}
+
+/*-----------------------------------------------------------*/
+
+/* NIST GCM specification, test cases 1 to 4, 15 and 16 */
+typedef struct
+{
+    const char * pcKey;
+    const char * pcIv;
+    const char * pcAad;
+    const char * pcPlain;
+    const char * pcCipher;
+    const char * pcTag;
+} GcmVector_t;
+
+#define TC_KEY       "feffe9928665731c6d6a8f9467308308"
+#define TC_IV        "cafebabefacedbaddecaf888"
+#define TC_AAD       "feedfacedeadbeeffeedfacedeadbeefabaddad2"
+#define TC_PLAIN     "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72" \
+                     "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39"
+#define TC_PLAIN4    "1aafd255"
+#define TC_C128      "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e" \
+                     "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091"
+#define TC_C128_4    "473f5985"
+#define TC_C256      "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa" \
+                     "8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662"
+#define TC_C256_4    "898015ad"
+
+static const GcmVector_t xVectors[] =
+{
+    { "00000000000000000000000000000000", "000000000000000000000000", "", "", "",
+      "58e2fccefa7e3061367f1d57a4e7455a" },
+    { "00000000000000000000000000000000", "000000000000000000000000", "",
+      "00000000000000000000000000000000", "0388dace60b6a392f328c2b971b2fe78",
+      "ab6e47d42cec13bdf53a67b21257bddf" },
+    { TC_KEY, TC_IV, "", TC_PLAIN TC_PLAIN4, TC_C128 TC_C128_4, "4d5c2af327cd64a62cf35abd2ba6fab4" },
+    { TC_KEY, TC_IV, TC_AAD, TC_PLAIN, TC_C128, "5bc94fbc3221a5db94fae95ae7121a47" },
+    { TC_KEY TC_KEY, TC_IV, "", TC_PLAIN TC_PLAIN4, TC_C256 TC_C256_4, "b094dac5d93471bdec1a502270e3cc6c" },
+    { TC_KEY TC_KEY, TC_IV, TC_AAD, TC_PLAIN, TC_C256, "76fc6ece0f4e1768cddf8853bb2d551b" },
+};
+
+static void prvTestVectors( void )
+{
+    uint8_t ucKey[ 32 ], ucIv[ 12 ], ucAad[ 64 ], ucPlain[ 64 ], ucCipher[ 64 ];
+    uint8_t ucTag[ 16 ], ucOut[ 64 ], ucOutTag[ 16 ];
+    size_t xKeyLen, xAadLen, xLen, i;
+    mbedtls_gcm_context xCtx;
+
+    for( i = 0; i < sizeof( xVectors ) / sizeof( xVectors[ 0 ] ); i++ )
+    {
+        xKeyLen = prvUnhex( xVectors[ i ].pcKey, ucKey );
+        ( void ) prvUnhex( xVectors[ i ].pcIv, ucIv );
+        xAadLen = prvUnhex( xVectors[ i ].pcAad, ucAad );
+        xLen = prvUnhex( xVectors[ i ].pcPlain, ucPlain );
+        ( void ) prvUnhex( xVectors[ i ].pcCipher, ucCipher );
+        ( void ) prvUnhex( xVectors[ i ].pcTag, ucTag );
+
+        /* The model itself */
+        vModelGcmReference( ucKey, xKeyLen, ucIv, ucAad, xAadLen, ucPlain, xLen, 0, ucOut, ucOutTag );
+        CHECK( memcmp( ucOut, ucCipher, xLen ) == 0 );
+        CHECK( memcmp( ucOutTag, ucTag, 16 ) == 0 );
+
+        /* The driver through the model */
+        mbedtls_gcm_init( &xCtx );
+        CHECK( mbedtls_gcm_setkey( &xCtx, MBEDTLS_CIPHER_ID_AES, ucKey, ( unsigned int ) ( xKeyLen * 8U ) ) == 0 );
+
+        memset( ucOut, 0, sizeof( ucOut ) );
+        CHECK( mbedtls_gcm_crypt_and_tag( &xCtx, MBEDTLS_GCM_ENCRYPT, xLen, ucIv, 12, ucAad, xAadLen,
+                                          ucPlain, ucOut, 16, ucOutTag ) == 0 );
+        CHECK( memcmp( ucOut, ucCipher, xLen ) == 0 );
+        CHECK( memcmp( ucOutTag, ucTag, 16 ) == 0 );
+
+        memset( ucOut, 0, sizeof( ucOut ) );
+        CHECK( mbedtls_gcm_auth_decrypt( &xCtx, xLen, ucIv, 12, ucAad, xAadLen, ucTag, 16,
+                                         ucCipher, ucOut ) == 0 );
+        CHECK( memcmp( ucOut, ucPlain, xLen ) == 0 );
+
+        ucTag[ 0 ] ^= 1U;
+        CHECK( mbedtls_gcm_auth_decrypt( &xCtx, xLen, ucIv, 12, ucAad, xAadLen, ucTag, 16,
+                                         ucCipher, ucOut ) == MBEDTLS_ERR_GCM_AUTH_FAILED );
+
+        mbedtls_gcm_free( &xCtx );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* One shot encryption and decryption of xLen bytes at pucIn / pucOut */
+static void prvRoundTrip( mbedtls_gcm_context * pxCtx,
+                          const uint8_t * pucKey,
+                          size_t xKeyLen,
+                          uint8_t * pucIn,
+                          uint8_t * pucOut,
+                          uint8_t * pucBack,
+                          size_t xLen )
+{
+    uint8_t ucIv[ 12 ], ucAad[ 13 ], ucTag[ 16 ], ucRefTag[ 16 ];
+
+    prvFill( ucIv, sizeof( ucIv ) );
+    prvFill( ucAad, sizeof( ucAad ) );
+    prvFill( pucIn, xLen );
+
+    vModelGcmReference( pucKey, xKeyLen, ucIv, ucAad, sizeof( ucAad ), pucIn, xLen, 0, ucRef, ucRefTag );
+
+    CHECK( mbedtls_gcm_crypt_and_tag( pxCtx, MBEDTLS_GCM_ENCRYPT, xLen, ucIv, sizeof( ucIv ),
+                                      ucAad, sizeof( ucAad ), pucIn, pucOut, 16, ucTag ) == 0 );
+    CHECK( memcmp( pucOut, ucRef, xLen ) == 0 );
+    CHECK( memcmp( ucTag, ucRefTag, 16 ) == 0 );
+
+    CHECK( mbedtls_gcm_auth_decrypt( pxCtx, xLen, ucIv, sizeof( ucIv ), ucAad, sizeof( ucAad ),
+                                     ucTag, 16, pucOut, pucBack ) == 0 );
+    CHECK( memcmp( pucBack, pucIn, xLen ) == 0 );
+}
+
+static void prvTestDma( void )
+{
+    static const size_t xLens[] = { 16, 255, 256, 1024, 1040, 4096, 4100, MAX_LEN };
+    uint8_t ucKey[ 32 ];
+    mbedtls_gcm_context xCtx;
+    ModelStats_t xStats;
+    size_t i;
+
+    prvFill( ucKey, sizeof( ucKey ) );
+    mbedtls_gcm_init( &xCtx );
+    CHECK( mbedtls_gcm_setkey( &xCtx, MBEDTLS_CIPHER_ID_AES, ucKey, 256 ) == 0 );
+
+    for( i = 0; i < sizeof( xLens ) / sizeof( xLens[ 0 ] ); i++ )
+    {
+        vModelResetStats();
+        prvRoundTrip( &xCtx, ucKey, 32, ( uint8_t * ) ulIn, ( uint8_t * ) ulOut, ( uint8_t * ) ulBack, xLens[ i ] );
+        vModelGetStats( &xStats );
+
+        if( xLens[ i ] < ST_CRYP_DMA_THRESHOLD )
+        {
+            CHECK( xStats.ulDma == 0U );
+        }
+        else
+        {
+            CHECK( xStats.ulDma > 0U );
+            CHECK( xStats.ulInterrupts > 0U );
+        }
+    }
+
+    CHECK( pxHndlGpdmaCh6 != NULL );
+    CHECK( pxHndlGpdmaCh7 != NULL );
+
+    /* Unaligned buffers are processed by polling */
+    vModelResetStats();
+    prvRoundTrip( &xCtx, ucKey, 32, ( uint8_t * ) ulIn + 1, ( uint8_t * ) ulOut + 1, ( uint8_t * ) ulBack + 1, 4096 );
+    vModelGetStats( &xStats );
+    CHECK( xStats.ulDma == 0U );
+
+    /* So are the calls made before the scheduler starts */
+    vModelSetSchedulerState( taskSCHEDULER_NOT_STARTED );
+    vModelResetStats();
+    prvRoundTrip( &xCtx, ucKey, 32, ( uint8_t * ) ulIn, ( uint8_t * ) ulOut, ( uint8_t * ) ulBack, 4096 );
+    vModelGetStats( &xStats );
+    CHECK( xStats.ulDma == 0U );
+    vModelSetSchedulerState( taskSCHEDULER_RUNNING );
+
+    mbedtls_gcm_free( &xCtx );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Messages of two contexts processed in turns, in pieces */
+static void prvTestStreaming( void )
+{
+    static const size_t xPieces[] = { 48, 512, 0, 1040, 16, 2048, 7 };
+    static uint32_t ulOut2[ MAX_LEN / 4U ];
+    uint8_t ucKey1[ 16 ], ucKey2[ 32 ], ucIv[ 12 ], ucAad[ 20 ];
+    uint8_t ucTag1[ 16 ], ucTag2[ 16 ], ucRefTag[ 16 ];
+    uint8_t * pucIn = ( uint8_t * ) ulIn;
+    uint8_t * pucOut1 = ( uint8_t * ) ulOut;
+    uint8_t * pucOut2 = ( uint8_t * ) ulOut2;
+    mbedtls_gcm_context xCtx1, xCtx2;
+    size_t i, xOffset = 0, xLen = 0, xOlen;
+
+    for( i = 0; i < sizeof( xPieces ) / sizeof( xPieces[ 0 ] ); i++ )
+    {
+        xLen += xPieces[ i ];
+    }
+
+    prvFill( ucKey1, sizeof( ucKey1 ) );
+    prvFill( ucKey2, sizeof( ucKey2 ) );
+    prvFill( ucIv, sizeof( ucIv ) );
+    prvFill( ucAad, sizeof( ucAad ) );
+    prvFill( pucIn, xLen );
+
+    mbedtls_gcm_init( &xCtx1 );
+    mbedtls_gcm_init( &xCtx2 );
+    CHECK( mbedtls_gcm_setkey( &xCtx1, MBEDTLS_CIPHER_ID_AES, ucKey1, 128 ) == 0 );
+    CHECK( mbedtls_gcm_setkey( &xCtx2, MBEDTLS_CIPHER_ID_AES, ucKey2, 256 ) == 0 );
+
+    CHECK( mbedtls_gcm_starts( &xCtx1, MBEDTLS_GCM_ENCRYPT, ucIv, sizeof( ucIv ) ) == 0 );
+    CHECK( mbedtls_gcm_starts( &xCtx2, MBEDTLS_GCM_ENCRYPT, ucIv, sizeof( ucIv ) ) == 0 );
+    CHECK( mbedtls_gcm_update_ad( &xCtx1, ucAad, sizeof( ucAad ) ) == 0 );
+
+    for( i = 0; i < sizeof( xPieces ) / sizeof( xPieces[ 0 ] ); i++ )
+    {
+        CHECK( mbedtls_gcm_update( &xCtx1, pucIn + xOffset, xPieces[ i ], pucOut1 + xOffset,
+                                   xPieces[ i ], &xOlen ) == 0 );
+        CHECK( xOlen == xPieces[ i ] );
+        CHECK( mbedtls_gcm_update( &xCtx2, pucIn + xOffset, xPieces[ i ], pucOut2 + xOffset,
+                                   xPieces[ i ], &xOlen ) == 0 );
+        CHECK( xOlen == xPieces[ i ] );
+        xOffset += xPieces[ i ];
+    }
+
+    CHECK( mbedtls_gcm_finish( &xCtx2, NULL, 0, &xOlen, ucTag2, 16 ) == 0 );
+    CHECK( xOlen == 0U );
+    CHECK( mbedtls_gcm_finish( &xCtx1, NULL, 0, &xOlen, ucTag1, 16 ) == 0 );
+
+    vModelGcmReference( ucKey1, 16, ucIv, ucAad, sizeof( ucAad ), pucIn, xLen, 0, ucRef, ucRefTag );
+    CHECK( memcmp( pucOut1, ucRef, xLen ) == 0 );
+    CHECK( memcmp( ucTag1, ucRefTag, 16 ) == 0 );
+
+    vModelGcmReference( ucKey2, 32, ucIv, NULL, 0, pucIn, xLen, 0, ucRef, ucRefTag );
+    CHECK( memcmp( pucOut2, ucRef, xLen ) == 0 );
+    CHECK( memcmp( ucTag2, ucRefTag, 16 ) == 0 );
+
+    /* Authentication only, with the AD given in the middle of another message */
+    CHECK( mbedtls_gcm_starts( &xCtx1, MBEDTLS_GCM_DECRYPT, ucIv, sizeof( ucIv ) ) == 0 );
+    CHECK( mbedtls_gcm_starts( &xCtx2, MBEDTLS_GCM_DECRYPT, ucIv, sizeof( ucIv ) ) == 0 );
+    CHECK( mbedtls_gcm_update( &xCtx2, pucOut2, 1024, ( uint8_t * ) ulBack, 1024, &xOlen ) == 0 );
+    CHECK( mbedtls_gcm_update_ad( &xCtx1, ucAad, sizeof( ucAad ) ) == 0 );
+    CHECK( mbedtls_gcm_update( &xCtx2, pucOut2 + 1024, xLen - 1024, ( uint8_t * ) ulBack + 1024,
+                               xLen - 1024, &xOlen ) == 0 );
+    CHECK( mbedtls_gcm_finish( &xCtx1, NULL, 0, &xOlen, ucTag1, 16 ) == 0 );
+    CHECK( mbedtls_gcm_finish( &xCtx2, NULL, 0, &xOlen, ucTag2, 16 ) == 0 );
+
+    vModelGcmReference( ucKey1, 16, ucIv, ucAad, sizeof( ucAad ), NULL, 0, 0, ucRef, ucRefTag );
+    CHECK( memcmp( ucTag1, ucRefTag, 16 ) == 0 );
+    CHECK( memcmp( ulBack, pucIn, xLen ) == 0 );
+    vModelGcmReference( ucKey2, 32, ucIv, NULL, 0, pucIn, xLen, 0, ucRef, ucRefTag );
+    CHECK( memcmp( ucTag2, ucRefTag, 16 ) == 0 );
+
+    mbedtls_gcm_free( &xCtx1 );
+    mbedtls_gcm_free( &xCtx2 );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestRestrictions( void )
+{
+    uint8_t ucKey[ 16 ] = { 0 }, ucIv[ 16 ] = { 0 }, ucBuf[ 64 ] = { 0 }, ucTag[ 16 ];
+    mbedtls_gcm_context xCtx;
+    size_t xOlen;
+
+    mbedtls_gcm_init( &xCtx );
+    CHECK( mbedtls_gcm_setkey( &xCtx, MBEDTLS_CIPHER_ID_AES, ucKey, 128 ) == 0 );
+
+    CHECK( mbedtls_gcm_starts( &xCtx, MBEDTLS_GCM_ENCRYPT, ucIv, 16 ) ==
+           MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED );
+
+    /* The AD is a single buffer given before the payload */
+    CHECK( mbedtls_gcm_starts( &xCtx, MBEDTLS_GCM_ENCRYPT, ucIv, 12 ) == 0 );
+    CHECK( mbedtls_gcm_update_ad( &xCtx, ucBuf, 5 ) == 0 );
+    CHECK( mbedtls_gcm_update_ad( &xCtx, ucBuf, 5 ) == MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED );
+    CHECK( mbedtls_gcm_update( &xCtx, ucBuf, 32, ucBuf, 32, &xOlen ) == 0 );
+    CHECK( mbedtls_gcm_update_ad( &xCtx, ucBuf, 5 ) == MBEDTLS_ERR_GCM_BAD_INPUT );
+
+    /* Nothing is buffered, and a partial block ends the payload */
+    CHECK( mbedtls_gcm_update( &xCtx, ucBuf, 20, ucBuf, 19, &xOlen ) == MBEDTLS_ERR_GCM_BUFFER_TOO_SMALL );
+    CHECK( mbedtls_gcm_update( &xCtx, ucBuf, 20, ucBuf, 20, &xOlen ) == 0 );
+    CHECK( mbedtls_gcm_update( &xCtx, ucBuf, 16, ucBuf, 16, &xOlen ) == MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED );
+    CHECK( mbedtls_gcm_finish( &xCtx, NULL, 0, &xOlen, ucTag, 16 ) == 0 );
+
+    mbedtls_gcm_free( &xCtx );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestDmaFaults( void )
+{
+    static const ModelDmaFault_t xFaults[] = { eModelDmaNoCompletion, eModelDmaError, eModelDmaLate };
+    uint8_t ucKey[ 16 ], ucIv[ 12 ] = { 0 }, ucTag[ 16 ];
+    mbedtls_gcm_context xCtx;
+    ModelStats_t xStats;
+    size_t i;
+
+    prvFill( ucKey, sizeof( ucKey ) );
+    mbedtls_gcm_init( &xCtx );
+    CHECK( mbedtls_gcm_setkey( &xCtx, MBEDTLS_CIPHER_ID_AES, ucKey, 128 ) == 0 );
+
+    for( i = 0; i < sizeof( xFaults ) / sizeof( xFaults[ 0 ] ); i++ )
+    {
+        vModelResetStats();
+        vModelSetDmaFault( xFaults[ i ] );
+        CHECK( mbedtls_gcm_crypt_and_tag( &xCtx, MBEDTLS_GCM_ENCRYPT, 1024, ucIv, 12, NULL, 0,
+                                          ( uint8_t * ) ulIn, ( uint8_t * ) ulOut, 16, ucTag ) ==
+               MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED );
+        vModelSetDmaFault( eModelDmaNormal );
+        vModelGetStats( &xStats );
+        CHECK( xStats.ulDma == 1U );
+
+        /* No completion is left for the next transfer */
+        CHECK( ulModelNotifyCount( ST_CRYP_NOTIFY_IDX ) == 0U );
+
+        /* The peripheral is usable again */
+        prvRoundTrip( &xCtx, ucKey, 16, ( uint8_t * ) ulIn, ( uint8_t * ) ulOut, ( uint8_t * ) ulBack, 2048 );
+    }
+
+    mbedtls_gcm_free( &xCtx );
+}
+
+/*-----------------------------------------------------------*/
+
+/* The threshold is measured once, on a context of its own */
+static void prvTestCalibration( void )
+{
+    unsigned int uxContexts = cryp_context_count;
+
+    st_sw_init();
+    CHECK( st_gcm_dispatch.state == ST_SW_CALIBRATED );
+    CHECK( st_gcm_dispatch.threshold <= ST_SW_MAX_LEN );
+    CHECK( cryp_context_count == uxContexts );
+}
+
+/* Short messages processed in software, without the peripheral */
+static void prvTestSoftware( void )
+{
+    uint8_t ucKey[ 32 ];
+    mbedtls_gcm_context xCtx;
+    ModelStats_t xStats;
+    size_t xLen;
+
+    vModelResetStats();
+    prvTestVectors();
+
+    prvFill( ucKey, sizeof( ucKey ) );
+    mbedtls_gcm_init( &xCtx );
+    CHECK( mbedtls_gcm_setkey( &xCtx, MBEDTLS_CIPHER_ID_AES, ucKey, 256 ) == 0 );
+
+    for( xLen = 0; ( xLen + 13U ) <= ST_SW_MAX_LEN; xLen += 7U )
+    {
+        prvRoundTrip( &xCtx, ucKey, 32, ( uint8_t * ) ulIn + 1, ( uint8_t * ) ulOut + 3, ( uint8_t * ) ulBack, xLen );
+    }
+
+    mbedtls_gcm_free( &xCtx );
+
+    vModelGetStats( &xStats );
+    CHECK( xStats.ulPolled == 0U );
+    CHECK( xStats.ulDma == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    ModelStats_t xStats;
+
+    vModelResetStats();
+    prvTestCalibration();
+
+    st_gcm_dispatch.threshold = ST_SW_MAX_LEN;
+    prvTestSoftware();
+
+    /* Everything else goes to the peripheral */
+    st_gcm_dispatch.threshold = 0;
+    prvTestVectors();
+    prvTestStreaming();
+    prvTestRestrictions();
+    vModelGetStats( &xStats );
+    CHECK( xStats.ulMisuse == 0U );
+
+    prvTestDma();
+    vModelGetStats( &xStats );
+    CHECK( xStats.ulMisuse == 0U );
+
+    prvTestDmaFaults();
+    vModelGetStats( &xStats );
+    CHECK( xStats.ulMisuse == 0U );
+
+    printf( "%lu checks, %lu failures\n", ( unsigned long ) ulChecks, ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0U ) ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+#!python
+#
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+#
+#
+"""Compressed OTA image tool.
+
+Compresses an image for the ntz OTA PAL (see ota_decompress.h): a header
+followed by a heatshrink bit stream. The compressed image is uploaded as the
+OTA file, with the fileType given by OTA_PAL_FILE_TYPE_COMPRESSED, and the job
+document carries the signature of the uncompressed image, which
+"compress --sign-key" computes.
+
+"compress" checks every compressed image by decompressing it as the device
+would: the file is fed in OTA blocks received out of order to the streaming
+decompressor, which writes the image to a RAM copy of the inactive flash bank.
+"verify" runs the same check on an existing file.
+"""
+import argparse
+import hashlib
+import logging
+import random
+import struct
+
+from ota_delta import FLASH_BANK_SIZE, OTA_BLOCK_SIZE, OUT_BUFFER_SIZE, sign_image
+
+logger = logging.getLogger()
+
+MAGIC = 0x5A41544F
+FORMAT_VERSION = 1
+HEADER = struct.Struct("<IBBBxI")
+
+# Largest window supported by the device, OTA_DECOMPRESS_MAX_WINDOW_LOG2
+MAX_WINDOW_LOG2 = 11
+DEFAULT_LOOKAHEAD_LOG2 = 4
+
+# Number of earlier positions tried for each match
+MAX_CANDIDATES = 32
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.byte = 0
+        self.bits = 0
+
+    def write(self, value, count):
+        for shift in range(count - 1, -1, -1):
+            self.byte = (self.byte << 1) | ((value >> shift) & 1)
+            self.bits += 1
+            if self.bits == 8:
+                self.out.append(self.byte)
+                self.byte = self.bits = 0
+
+    def finish(self):
+        if self.bits:
+            self.out.append(self.byte << (8 - self.bits))
+            self.byte = self.bits = 0
+        return bytes(self.out)
+
+
+def compress(image, window_log2=MAX_WINDOW_LOG2, lookahead_log2=DEFAULT_LOOKAHEAD_LOG2):
+    """Return the compressed image, header included."""
+    window = 1 << window_log2
+    max_length = 1 << lookahead_log2
+    # A back reference costs 1 + window_log2 + lookahead_log2 bits, a literal 9
+    min_length = (1 + window_log2 + lookahead_log2) // 9 + 1
+
+    writer = BitWriter()
+    chains = {}
+    i = 0
+
+    def remember(pos):
+        key = image[pos : pos + 2]
+        chain = chains.setdefault(key, [])
+        chain.append(pos)
+        if len(chain) > MAX_CANDIDATES:
+            del chain[0]
+
+    while i < len(image):
+        best_length = 0
+        best_distance = 0
+        limit = min(max_length, len(image) - i)
+
+        for pos in reversed(chains.get(image[i : i + 2], ())):
+            distance = i - pos
+            if distance > window:
+                break
+            if image[pos + best_length : pos + best_length + 1] != image[i + best_length : i + best_length + 1]:
+                continue
+            length = 0
+            while length < limit and image[pos + length] == image[i + length]:
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_distance = distance
+                if length == limit:
+                    break
+
+        if best_length >= min_length:
+            writer.write(0, 1)
+            writer.write(best_distance - 1, window_log2)
+            writer.write(best_length - 1, lookahead_log2)
+            step = best_length
+        else:
+            writer.write(1, 1)
+            writer.write(image[i], 8)
+            step = 1
+
+        for pos in range(i, i + step):
+            remember(pos)
+        i += step
+
+    header = HEADER.pack(MAGIC, FORMAT_VERSION, window_log2, lookahead_log2, len(image))
+    return header + writer.finish()
+
+
+class Decompressor:
+    """Byte stream decoder, equivalent to xOtaDecompressUpdate."""
+
+    def __init__(self, write):
+        self.write = write
+        self.header = bytearray()
+        self.image_size = None
+        self.window_log2 = self.lookahead_log2 = None
+        self.window = bytearray(1 << MAX_WINDOW_LOG2)
+        self.offset = 0
+        self.out = bytearray()
+        self.state = "header"
+        self.field = self.field_bits = 0
+        self.distance = 0
+
+    def _emit(self, byte):
+        self.window[self.offset % len(self.window)] = byte
+        self.out.append(byte)
+        self.offset += 1
+        if self.offset == self.image_size or len(self.out) == OUT_BUFFER_SIZE:
+            self.write(self.offset - len(self.out), bytes(self.out))
+            self.out = bytearray()
+        if self.offset == self.image_size:
+            self.state = "done"
+
+    def _bit(self, bit):
+        self.field = (self.field << 1) | bit
+        self.field_bits += 1
+        size = {"tag": 1, "literal": 8, "distance": self.window_log2, "length": self.lookahead_log2}[self.state]
+        if self.field_bits < size:
+            return
+        field = self.field
+        self.field = self.field_bits = 0
+        if self.state == "tag":
+            self.state = "literal" if field else "distance"
+        elif self.state == "literal":
+            self.state = "tag"
+            self._emit(field)
+        elif self.state == "distance":
+            self.distance = field + 1
+            self.state = "length"
+        else:
+            self.state = "tag"
+            for _ in range(field + 1):
+                if self.state == "done":
+                    raise ValueError("reference beyond the end of the image")
+                self._emit(self.window[(self.offset - self.distance) % len(self.window)])
+
+    def update(self, data):
+        for byte in data:
+            if self.state == "header":
+                self.header.append(byte)
+                if len(self.header) == HEADER.size:
+                    magic, version, self.window_log2, self.lookahead_log2, self.image_size = HEADER.unpack(self.header)
+                    if magic != MAGIC or version != FORMAT_VERSION:
+                        raise ValueError("not a compressed image")
+                    if not 0 < self.lookahead_log2 <= self.window_log2 <= MAX_WINDOW_LOG2:
+                        raise ValueError("unsupported window")
+                    if not 0 < self.image_size <= FLASH_BANK_SIZE:
+                        raise ValueError("invalid image size")
+                    self.state = "tag"
+            elif self.state == "done":
+                raise ValueError("data after the end of the image")
+            else:
+                for shift in range(7, -1, -1):
+                    if self.state == "done":
+                        break
+                    self._bit((byte >> shift) & 1)
+
+    @property
+    def done(self):
+        return self.state == "done"
+
+
+def decompress(data, block_size=OTA_BLOCK_SIZE, bank_size=FLASH_BANK_SIZE, seed=None):
+    """Decompress an image like the OTA PAL and return it.
+
+    The inactive flash bank is emulated in RAM. The file is received in OTA
+    blocks, in a random order when seed is set: blocks ahead of the decoder are
+    staged until the blocks before them arrive.
+    """
+    inactive = bytearray(b"\xff" * bank_size)
+    written = set()
+
+    def write(offset, chunk):
+        if offset % OUT_BUFFER_SIZE:
+            raise ValueError("unaligned write at {}".format(offset))
+        if offset in written:
+            raise ValueError("flash written twice at {}".format(offset))
+        written.add(offset)
+        inactive[offset : offset + len(chunk)] = chunk
+
+    decompressor = Decompressor(write)
+
+    offsets = list(range(0, len(data), block_size))
+    if seed is not None:
+        random.Random(seed).shuffle(offsets)
+
+    decoded = 0
+    staged = {}
+    for offset in offsets:
+        staged[offset] = data[offset : offset + block_size]
+        while decoded in staged:
+            block = staged.pop(decoded)
+            decompressor.update(block)
+            decoded += len(block)
+
+    if not decompressor.done:
+        raise ValueError("image was not decompressed entirely")
+
+    return bytes(inactive[: decompressor.image_size])
+
+
+def verify(data, image=None, seed=0):
+    result = decompress(data, seed=seed)
+    if image is not None and result != image:
+        raise ValueError("decompressed image differs from the image")
+    return result
+
+
+def process_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    create = subparsers.add_parser("compress", help="Compress IMAGE.")
+    create.add_argument("image")
+    create.add_argument("--output", required=True)
+    create.add_argument("--window", type=int, default=MAX_WINDOW_LOG2, help="Log2 of the window size.")
+    create.add_argument("--lookahead", type=int, default=DEFAULT_LOOKAHEAD_LOG2, help="Log2 of the longest match.")
+    create.add_argument("--sign-key", help="PEM private key signing the image.")
+
+    check = subparsers.add_parser("verify", help="Decompress FILE in an emulated flash bank.")
+    check.add_argument("file")
+    check.add_argument("--image", help="Expected image.")
+    check.add_argument("--seed", type=int, default=0, help="Seed of the block reordering.")
+
+    extract = subparsers.add_parser("decompress", help="Write the image decompressed from FILE.")
+    extract.add_argument("file")
+    extract.add_argument("--output", required=True)
+
+    parser.add_argument("-v", "--verbose", action="store_true")
+    return parser.parse_args()
+
+
+def main():
+    args = process_args()
+
+    logging.basicConfig()
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+    else:
+        logger.setLevel(logging.INFO)
+
+    try:
+        if args.command == "compress":
+            if not 0 < args.lookahead <= args.window <= MAX_WINDOW_LOG2:
+                raise ValueError("window must be at most {} and not smaller than lookahead".format(MAX_WINDOW_LOG2))
+
+            with open(args.image, "rb") as f:
+                image = f.read()
+
+            data = compress(image, args.window, args.lookahead)
+            verify(data, image)
+
+            with open(args.output, "wb") as f:
+                f.write(data)
+
+            logging.info(
+                "{} byte image compressed to {} bytes ({:.1f}%), written to {}".format(
+                    len(image), len(data), 100.0 * len(data) / max(len(image), 1), args.output
+                )
+            )
+            logging.info("Image SHA-256: {}".format(hashlib.sha256(image).hexdigest()))
+
+            if args.sign_key:
+                logging.info("sig-sha256-ecdsa: {}".format(sign_image(image, args.sign_key)))
+        else:
+            with open(args.file, "rb") as f:
+                data = f.read()
+
+            if args.command == "verify":
+                image = None
+                if args.image:
+                    with open(args.image, "rb") as f:
+                        image = f.read()
+                result = verify(data, image, args.seed)
+                logging.info("Image decompressed, SHA-256: {}".format(hashlib.sha256(result).hexdigest()))
+            else:
+                with open(args.output, "wb") as f:
+                    f.write(decompress(data))
+    except ValueError as e:
+        logging.error("Failed: {}".format(e))
+        raise SystemExit(1)
+
+
+if __name__ == "__main__":
+    main()
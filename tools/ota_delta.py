@@ -0,0 +1,494 @@
+#!python
+#
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+#
+#
+"""Delta OTA patch tool.
+
+Generates the patches applied by the ntz OTA PAL (see ota_delta.h) to rebuild
+a new image from the image running on the device. The patch is uploaded as the
+OTA file, with the fileType given by OTA_PAL_FILE_TYPE_DELTA, and the job
+document carries the signature of the new image, which "create --sign-key"
+computes.
+
+"create" checks every patch by applying it as the device would: the patch is
+fed in OTA blocks received out of order to the streaming decoder, which
+rebuilds the image in a RAM copy of the inactive flash bank, reading from a
+RAM copy of the active bank. "verify" runs the same check on an existing patch.
+"""
+import argparse
+import base64
+import hashlib
+import logging
+import random
+import struct
+
+logger = logging.getLogger()
+
+MAGIC = 0x4441544F
+FORMAT_VERSION = 1
+HEADER = struct.Struct("<IB3xIII32s")
+
+OP_END = 0x00
+OP_COPY = 0x01
+OP_ADD = 0x02
+OP_INSERT = 0x03
+OP_SEEK = 0x04
+
+FLASH_BANK_SIZE = 0x100000
+OTA_BLOCK_SIZE = 2048
+OUT_BUFFER_SIZE = 128
+
+# Shortest exact match used as an anchor, and length of the key indexing it
+MIN_MATCH = 16
+KEY_SIZE = 8
+# Shortest run of unchanged bytes worth a COPY inside an approximate match
+MIN_COPY = 6
+# An approximate match ends after this many bytes without improvement
+EXTEND_SLACK = 64
+
+
+def parse_version(text):
+    """Encode major.minor.build like AppVersion32_t.u.unsignedVersion32."""
+    major, minor, build = (int(x) for x in text.split("."))
+    return (major << 24) | (minor << 16) | build
+
+
+def format_version(value):
+    return "{}.{}.{}".format(value >> 24, (value >> 16) & 0xFF, value & 0xFFFF)
+
+
+def _varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+class PatchWriter:
+    """Serialize operations, merging consecutive ones of the same kind."""
+
+    def __init__(self):
+        self.ops = []
+
+    def _append(self, op, arg, data=b""):
+        if self.ops and self.ops[-1][0] == op and op in (OP_COPY, OP_ADD, OP_INSERT):
+            prev = self.ops[-1]
+            self.ops[-1] = (op, prev[1] + arg, prev[2] + data)
+        elif op == OP_SEEK and self.ops and self.ops[-1][0] == OP_SEEK:
+            prev = self.ops[-1]
+            self.ops[-1] = (op, prev[1] + arg, b"")
+        else:
+            self.ops.append((op, arg, data))
+
+    def copy(self, length):
+        if length:
+            self._append(OP_COPY, length)
+
+    def add(self, data):
+        if data:
+            self._append(OP_ADD, len(data), bytes(data))
+
+    def insert(self, data):
+        if data:
+            self._append(OP_INSERT, len(data), bytes(data))
+
+    def seek(self, delta):
+        if delta:
+            self._append(OP_SEEK, delta)
+
+    def diff(self, base, target, b, t, length):
+        """Emit target[t:t+length] as differences from base[b:b+length]."""
+        delta = bytes((target[t + i] - base[b + i]) & 0xFF for i in range(length))
+        i = 0
+        while i < length:
+            j = i
+            while j < length and delta[j] == 0:
+                j += 1
+            if j - i >= MIN_COPY or j == length:
+                self.copy(j - i)
+                i = j
+                continue
+            # Changed bytes, up to the next run of unchanged bytes worth a COPY
+            k = j
+            while k < length:
+                if delta[k] == 0:
+                    run = k
+                    while run < length and delta[run] == 0:
+                        run += 1
+                    if run - k >= MIN_COPY or run == length:
+                        break
+                    k = run
+                else:
+                    k += 1
+            self.add(delta[i:k])
+            i = k
+
+    def serialize(self, header):
+        out = bytearray(header)
+        for op, arg, data in self.ops:
+            out.append(op)
+            out += _varint(_zigzag(arg) if op == OP_SEEK else arg)
+            out += data
+        out.append(OP_END)
+        return bytes(out)
+
+
+def _extend(base, target, b, t):
+    """Length of the approximate match at (b, t), scored like bsdiff."""
+    limit = min(len(base) - b, len(target) - t)
+    score = best_score = 0
+    best = 0
+    i = 0
+    while i < limit and i - best <= EXTEND_SLACK:
+        if base[b + i] == target[t + i]:
+            score += 1
+        i += 1
+        if score * 2 - i > best_score * 2 - best:
+            best_score = score
+            best = i
+    return best
+
+
+def _exact(base, target, b, t):
+    limit = min(len(base) - b, len(target) - t)
+    i = 0
+    while i < limit and base[b + i] == target[t + i]:
+        i += 1
+    return i
+
+
+def create_patch(base, target, base_version):
+    """Return a patch which rebuilds target from base."""
+    index = {}
+    for b in range(0, len(base) - KEY_SIZE + 1, 2):
+        index.setdefault(base[b : b + KEY_SIZE], b)
+
+    writer = PatchWriter()
+    cursor = 0
+    pending = bytearray()
+    t = 0
+
+    while t < len(target):
+        b = None
+
+        # Keep following the base where the previous match left off, as long
+        # as it resembles the target, like bsdiff does for modified code.
+        if cursor < len(base) and _extend(base, target, cursor, t) >= MIN_MATCH:
+            b = cursor
+        else:
+            candidate = index.get(target[t : t + KEY_SIZE])
+            if candidate is not None and _exact(base, target, candidate, t) >= MIN_MATCH:
+                b = candidate
+
+        if b is None:
+            pending.append(target[t])
+            t += 1
+            continue
+
+        length = _extend(base, target, b, t)
+        writer.insert(pending)
+        pending = bytearray()
+        writer.seek(b - cursor)
+        writer.diff(base, target, b, t, length)
+        cursor = b + length
+        t += length
+
+    writer.insert(pending)
+
+    header = HEADER.pack(
+        MAGIC,
+        FORMAT_VERSION,
+        base_version,
+        len(base),
+        len(target),
+        hashlib.sha256(base).digest(),
+    )
+    return writer.serialize(header)
+
+
+class PatchDecoder:
+    """Byte stream decoder, equivalent to xOtaDeltaUpdate."""
+
+    def __init__(self, base_bank, write):
+        self.base_bank = base_bank
+        self.write = write
+        self.header = bytearray()
+        self.base_size = self.target_size = None
+        self.base_offset = 0
+        self.target_offset = 0
+        self.out = bytearray()
+        self.state = "header"
+        self.op = None
+        self.varint = self.shift = 0
+        self.remaining = 0
+
+    def _emit(self, data):
+        if len(data) > self.target_size - self.target_offset:
+            raise ValueError("write beyond the target image")
+        for byte in data:
+            self.out.append(byte)
+            self.target_offset += 1
+            if len(self.out) == OUT_BUFFER_SIZE:
+                self._flush()
+
+    def _flush(self):
+        if self.out:
+            self.write(self.target_offset - len(self.out), bytes(self.out))
+            self.out = bytearray()
+
+    def _base(self, length):
+        if length > self.base_size - self.base_offset:
+            raise ValueError("read beyond the base image")
+        data = self.base_bank[self.base_offset : self.base_offset + length]
+        self.base_offset += length
+        return data
+
+    def _execute(self):
+        arg = self.varint
+        self.state = "opcode"
+        if self.op == OP_COPY:
+            self._emit(self._base(arg))
+        elif self.op == OP_SEEK:
+            delta = (arg >> 1) ^ -(arg & 1)
+            if not 0 <= self.base_offset + delta <= self.base_size:
+                raise ValueError("seek outside the base image")
+            self.base_offset += delta
+        elif arg:
+            self.remaining = arg
+            self.state = "add" if self.op == OP_ADD else "insert"
+
+    def update(self, data):
+        for byte in data:
+            if self.state == "header":
+                self.header.append(byte)
+                if len(self.header) == HEADER.size:
+                    magic, version, _, self.base_size, self.target_size, _ = HEADER.unpack(self.header)
+                    if magic != MAGIC or version != FORMAT_VERSION:
+                        raise ValueError("not a patch")
+                    if self.base_size > len(self.base_bank):
+                        raise ValueError("base image larger than the bank")
+                    self.state = "opcode"
+            elif self.state == "opcode":
+                if byte == OP_END:
+                    self._flush()
+                    if self.target_offset != self.target_size:
+                        raise ValueError("truncated patch")
+                    self.state = "done"
+                elif byte > OP_SEEK:
+                    raise ValueError("invalid opcode {}".format(byte))
+                else:
+                    self.op = byte
+                    self.varint = self.shift = 0
+                    self.state = "varint"
+            elif self.state == "varint":
+                self.varint |= (byte & 0x7F) << self.shift
+                self.shift += 7
+                if not byte & 0x80:
+                    self._execute()
+                elif self.shift >= 35:
+                    raise ValueError("invalid varint")
+            elif self.state in ("add", "insert"):
+                if self.state == "add":
+                    byte = (self._base(1)[0] + byte) & 0xFF
+                self._emit(bytes((byte,)))
+                self.remaining -= 1
+                if not self.remaining:
+                    self.state = "opcode"
+            else:
+                raise ValueError("data after the end of the patch")
+
+    @property
+    def done(self):
+        return self.state == "done"
+
+
+def read_header(patch):
+    magic, version, base_version, base_size, target_size, base_hash = HEADER.unpack_from(patch)
+    if magic != MAGIC or version != FORMAT_VERSION:
+        raise ValueError("not a patch")
+    return base_version, base_size, target_size, base_hash
+
+
+def apply_patch(base, patch, block_size=OTA_BLOCK_SIZE, bank_size=FLASH_BANK_SIZE, seed=None):
+    """Apply a patch like the OTA PAL and return the rebuilt image.
+
+    The active and inactive flash banks are emulated in RAM. The patch is
+    received in OTA blocks, in a random order when seed is set: blocks ahead of
+    the decoder are staged until the blocks before them arrive.
+    """
+    _, base_size, target_size, base_hash = read_header(patch)
+
+    if len(base) > bank_size or target_size > bank_size:
+        raise ValueError("image larger than a flash bank")
+
+    active = bytearray(b"\xff" * bank_size)
+    active[: len(base)] = base
+    if hashlib.sha256(active[:base_size]).digest() != base_hash:
+        raise ValueError("patch does not apply to this base image")
+
+    inactive = bytearray(b"\xff" * bank_size)
+    erased = [True] * (bank_size // OUT_BUFFER_SIZE)
+
+    def write(offset, data):
+        if offset % 16:
+            raise ValueError("unaligned write at {}".format(offset))
+        if not all(erased[offset // OUT_BUFFER_SIZE : (offset + len(data) + OUT_BUFFER_SIZE - 1) // OUT_BUFFER_SIZE]):
+            raise ValueError("flash written twice at {}".format(offset))
+        for i in range(offset // OUT_BUFFER_SIZE, (offset + len(data) + OUT_BUFFER_SIZE - 1) // OUT_BUFFER_SIZE):
+            erased[i] = False
+        inactive[offset : offset + len(data)] = data
+
+    decoder = PatchDecoder(active, write)
+
+    offsets = list(range(0, len(patch), block_size))
+    if seed is not None:
+        random.Random(seed).shuffle(offsets)
+
+    decoded = 0
+    staged = {}
+    for offset in offsets:
+        staged[offset] = patch[offset : offset + block_size]
+        while decoded in staged:
+            block = staged.pop(decoded)
+            decoder.update(block)
+            decoded += len(block)
+
+    if not decoder.done:
+        raise ValueError("patch was not applied entirely")
+
+    return bytes(inactive[:target_size])
+
+
+def sign_image(image, key_path):
+    """Return the base64 ECDSA signature of the image for the job document."""
+    from cryptography.hazmat.primitives import hashes, serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+
+    with open(key_path, "rb") as f:
+        key = serialization.load_pem_private_key(f.read(), password=None)
+
+    return base64.b64encode(key.sign(image, ec.ECDSA(hashes.SHA256()))).decode("ascii")
+
+
+def verify(base, patch, target=None, seed=0):
+    image = apply_patch(base, patch, seed=seed)
+    if target is not None and image != target:
+        raise ValueError("patched image differs from the target image")
+    return image
+
+
+def process_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    create = subparsers.add_parser("create", help="Generate a patch from BASE to TARGET.")
+    create.add_argument("base")
+    create.add_argument("target")
+    create.add_argument("--base-version", required=True, help="Version of the base image, major.minor.build.")
+    create.add_argument("--output", required=True)
+    create.add_argument("--sign-key", help="PEM private key signing the target image.")
+
+    check = subparsers.add_parser("verify", help="Apply a patch to BASE in emulated flash banks.")
+    check.add_argument("base")
+    check.add_argument("patch")
+    check.add_argument("--target", help="Expected image.")
+    check.add_argument("--seed", type=int, default=0, help="Seed of the block reordering.")
+
+    apply = subparsers.add_parser("apply", help="Write the image rebuilt from BASE and PATCH.")
+    apply.add_argument("base")
+    apply.add_argument("patch")
+    apply.add_argument("--output", required=True)
+
+    parser.add_argument("-v", "--verbose", action="store_true")
+    return parser.parse_args()
+
+
+def main():
+    args = process_args()
+
+    logging.basicConfig()
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+    else:
+        logger.setLevel(logging.INFO)
+
+    with open(args.base, "rb") as f:
+        base = f.read()
+
+    try:
+        if args.command == "create":
+            with open(args.target, "rb") as f:
+                target = f.read()
+
+            patch = create_patch(base, target, parse_version(args.base_version))
+            verify(base, patch, target)
+
+            with open(args.output, "wb") as f:
+                f.write(patch)
+
+            logging.info(
+                "Patch of {} bytes for a {} byte image ({:.1f}%) written to {}".format(
+                    len(patch), len(target), 100.0 * len(patch) / max(len(target), 1), args.output
+                )
+            )
+            logging.info("Image SHA-256: {}".format(hashlib.sha256(target).hexdigest()))
+
+            if args.sign_key:
+                logging.info("sig-sha256-ecdsa: {}".format(sign_image(target, args.sign_key)))
+        else:
+            with open(args.patch, "rb") as f:
+                patch = f.read()
+
+            base_version, _, target_size, _ = read_header(patch)
+            logging.info("Patch against version {}, {} byte image".format(format_version(base_version), target_size))
+
+            if args.command == "verify":
+                target = None
+                if args.target:
+                    with open(args.target, "rb") as f:
+                        target = f.read()
+                image = verify(base, patch, target, args.seed)
+                logging.info("Patch applied, image SHA-256: {}".format(hashlib.sha256(image).hexdigest()))
+            else:
+                image = apply_patch(base, patch)
+                with open(args.output, "wb") as f:
+                    f.write(image)
+    except ValueError as e:
+        logging.error("Patch failed: {}".format(e))
+        raise SystemExit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,334 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file freertos_posix.c
+ * @brief POSIX implementation of the kernel and logging shims used by the
+ * host test of the OTA http transfer: tasks are threads and queues are
+ * protected by a mutex.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "logging.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+struct QueueDefinition
+{
+    pthread_mutex_t xMutex;
+    pthread_cond_t xNotEmpty;
+    pthread_cond_t xNotFull;
+    UBaseType_t uxLength;
+    UBaseType_t uxItemSize;
+    UBaseType_t uxCount;
+    UBaseType_t uxHead;
+    uint8_t * pucItems;
+};
+
+typedef struct TaskStart
+{
+    TaskFunction_t pxTaskCode;
+    void * pvParameters;
+} TaskStart_t;
+
+static atomic_size_t uxAllocatedBlocks = 0;
+
+/*-----------------------------------------------------------*/
+
+void * pvPortMalloc( size_t xSize )
+{
+    void * pv = malloc( xSize );
+
+    if( pv != NULL )
+    {
+        ( void ) atomic_fetch_add( &uxAllocatedBlocks, 1U );
+    }
+
+    return pv;
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortFree( void * pv )
+{
+    if( pv != NULL )
+    {
+        ( void ) atomic_fetch_sub( &uxAllocatedBlocks, 1U );
+        free( pv );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+size_t uxPortAllocatedBlocks( void )
+{
+    return atomic_load( &uxAllocatedBlocks );
+}
+
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+    static struct timespec xStart = { 0 };
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    if( ( xStart.tv_sec == 0 ) && ( xStart.tv_nsec == 0 ) )
+    {
+        xStart = xNow;
+    }
+
+    return ( TickType_t ) ( ( ( xNow.tv_sec - xStart.tv_sec ) * 1000LL ) +
+                            ( ( xNow.tv_nsec - xStart.tv_nsec ) / 1000000LL ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void * prvTaskEntry( void * pvArg )
+{
+    TaskStart_t xStart = *( TaskStart_t * ) pvArg;
+
+    free( pvArg );
+    xStart.pxTaskCode( xStart.pvParameters );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskCreate( TaskFunction_t pxTaskCode,
+                        const char * const pcName,
+                        const uint32_t ulStackDepth,
+                        void * const pvParameters,
+                        UBaseType_t uxPriority,
+                        TaskHandle_t * const pxCreatedTask )
+{
+    BaseType_t xResult = pdFAIL;
+    TaskStart_t * pxStart = malloc( sizeof( TaskStart_t ) );
+    pthread_t xThread;
+    pthread_attr_t xAttr;
+
+    ( void ) pcName;
+    ( void ) ulStackDepth;
+    ( void ) uxPriority;
+
+    if( pxStart != NULL )
+    {
+        pxStart->pxTaskCode = pxTaskCode;
+        pxStart->pvParameters = pvParameters;
+
+        ( void ) pthread_attr_init( &xAttr );
+        ( void ) pthread_attr_setdetachstate( &xAttr, PTHREAD_CREATE_DETACHED );
+
+        if( pthread_create( &xThread, &xAttr, prvTaskEntry, pxStart ) == 0 )
+        {
+            xResult = pdPASS;
+
+            if( pxCreatedTask != NULL )
+            {
+                *pxCreatedTask = ( TaskHandle_t ) ( uintptr_t ) xThread;
+            }
+        }
+        else
+        {
+            free( pxStart );
+        }
+
+        ( void ) pthread_attr_destroy( &xAttr );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelete( TaskHandle_t xTaskToDelete )
+{
+    configASSERT( xTaskToDelete == NULL );
+
+    pthread_exit( NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+QueueHandle_t xQueueCreate( UBaseType_t uxQueueLength,
+                            UBaseType_t uxItemSize )
+{
+    QueueHandle_t xQueue = pvPortMalloc( sizeof( struct QueueDefinition ) );
+    pthread_condattr_t xCondAttr;
+
+    if( xQueue != NULL )
+    {
+        ( void ) memset( xQueue, 0, sizeof( struct QueueDefinition ) );
+        xQueue->pucItems = pvPortMalloc( uxQueueLength * uxItemSize );
+
+        if( xQueue->pucItems == NULL )
+        {
+            vPortFree( xQueue );
+            xQueue = NULL;
+        }
+    }
+
+    if( xQueue != NULL )
+    {
+        xQueue->uxLength = uxQueueLength;
+        xQueue->uxItemSize = uxItemSize;
+
+        ( void ) pthread_condattr_init( &xCondAttr );
+        ( void ) pthread_condattr_setclock( &xCondAttr, CLOCK_MONOTONIC );
+        ( void ) pthread_mutex_init( &( xQueue->xMutex ), NULL );
+        ( void ) pthread_cond_init( &( xQueue->xNotEmpty ), &xCondAttr );
+        ( void ) pthread_cond_init( &( xQueue->xNotFull ), &xCondAttr );
+        ( void ) pthread_condattr_destroy( &xCondAttr );
+    }
+
+    return xQueue;
+}
+
+/*-----------------------------------------------------------*/
+
+void vQueueDelete( QueueHandle_t xQueue )
+{
+    ( void ) pthread_cond_destroy( &( xQueue->xNotFull ) );
+    ( void ) pthread_cond_destroy( &( xQueue->xNotEmpty ) );
+    ( void ) pthread_mutex_destroy( &( xQueue->xMutex ) );
+    vPortFree( xQueue->pucItems );
+    vPortFree( xQueue );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Wait on pxCond, with the mutex held, until *puxCount moved away from
+ * uxBlockedCount or the ticks ran out. */
+static BaseType_t prvWait( QueueHandle_t xQueue,
+                           pthread_cond_t * pxCond,
+                           const UBaseType_t * puxCount,
+                           UBaseType_t uxBlockedCount,
+                           TickType_t xTicksToWait )
+{
+    struct timespec xDeadline;
+    int lError = 0;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xDeadline );
+    xDeadline.tv_sec += ( time_t ) ( pdTICKS_TO_MS( xTicksToWait ) / 1000U );
+    xDeadline.tv_nsec += ( long ) ( pdTICKS_TO_MS( xTicksToWait ) % 1000U ) * 1000000L;
+
+    if( xDeadline.tv_nsec >= 1000000000L )
+    {
+        xDeadline.tv_sec++;
+        xDeadline.tv_nsec -= 1000000000L;
+    }
+
+    while( ( *puxCount == uxBlockedCount ) && ( lError != ETIMEDOUT ) )
+    {
+        if( xTicksToWait == portMAX_DELAY )
+        {
+            lError = pthread_cond_wait( pxCond, &( xQueue->xMutex ) );
+        }
+        else
+        {
+            lError = pthread_cond_timedwait( pxCond, &( xQueue->xMutex ), &xDeadline );
+        }
+    }
+
+    return ( *puxCount != uxBlockedCount ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueSend( QueueHandle_t xQueue,
+                       const void * pvItemToQueue,
+                       TickType_t xTicksToWait )
+{
+    BaseType_t xResult;
+    UBaseType_t uxTail;
+
+    ( void ) pthread_mutex_lock( &( xQueue->xMutex ) );
+
+    xResult = prvWait( xQueue, &( xQueue->xNotFull ), &( xQueue->uxCount ), xQueue->uxLength, xTicksToWait );
+
+    if( xResult == pdTRUE )
+    {
+        uxTail = ( xQueue->uxHead + xQueue->uxCount ) % xQueue->uxLength;
+        ( void ) memcpy( &( xQueue->pucItems[ uxTail * xQueue->uxItemSize ] ), pvItemToQueue, xQueue->uxItemSize );
+        xQueue->uxCount++;
+        ( void ) pthread_cond_signal( &( xQueue->xNotEmpty ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &( xQueue->xMutex ) );
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue,
+                          void * pvBuffer,
+                          TickType_t xTicksToWait )
+{
+    BaseType_t xResult;
+
+    ( void ) pthread_mutex_lock( &( xQueue->xMutex ) );
+
+    xResult = prvWait( xQueue, &( xQueue->xNotEmpty ), &( xQueue->uxCount ), 0U, xTicksToWait );
+
+    if( xResult == pdTRUE )
+    {
+        ( void ) memcpy( pvBuffer, &( xQueue->pucItems[ xQueue->uxHead * xQueue->uxItemSize ] ), xQueue->uxItemSize );
+        xQueue->uxHead = ( xQueue->uxHead + 1U ) % xQueue->uxLength;
+        xQueue->uxCount--;
+        ( void ) pthread_cond_signal( &( xQueue->xNotFull ) );
+    }
+
+    ( void ) pthread_mutex_unlock( &( xQueue->xMutex ) );
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+void vLoggingPrintf( const char * const pcLogLevel,
+                     const char * const pcFunctionName,
+                     const unsigned long ulLineNumber,
+                     const char * const pcFormat,
+                     ... )
+{
+    va_list xArgs;
+
+    ( void ) fprintf( stderr, "<%s> %lu %s:%lu ", pcLogLevel,
+                      ( unsigned long ) xTaskGetTickCount(), pcFunctionName, ulLineNumber );
+
+    va_start( xArgs, pcFormat );
+    ( void ) vfprintf( stderr, pcFormat, xArgs );
+    va_end( xArgs );
+
+    ( void ) fputc( '\n', stderr );
+}
@@ -0,0 +1,649 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_model.c
+ * @brief Model of the file server behind a pre-signed url, and of the
+ * subset of coreHTTP and of the TLS transport used by the OTA http transfer.
+ *
+ * The transport calls reach the server directly: mbedtls_transport_send
+ * parses the request and queues the response, which mbedtls_transport_recv
+ * hands out. HTTPClient_Send writes the request and reads the response
+ * through the transport interface set up by the transfer, as coreHTTP does.
+ */
+
+#include "FreeRTOS.h"
+#include "core_http_client.h"
+#include "mbedtls_transport.h"
+#include "http_model.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#define MODEL_RESPONSE_HEADER_MAX    256U
+
+struct NetworkContext
+{
+    BaseType_t xConfigured;
+    BaseType_t xConnected; /* opened by the client and not disconnected yet */
+    BaseType_t xReset;     /* closed by the server */
+    uint32_t ulResponses;
+    uint8_t * pucResponse;
+    size_t uxResponseLen;
+    size_t uxResponseRead;
+};
+
+static pthread_mutex_t xServerMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t * pucFile = NULL;
+static uint32_t ulFileSize = 0U;
+static ModelServerFaults_t xFaults = { 0 };
+static ModelServerStats_t xStats = { 0 };
+
+/*-----------------------------------------------------------*/
+
+void vModelServerReset( uint32_t ulSize )
+{
+    uint32_t ulSeed = 0x2545F491U ^ ulSize;
+    uint32_t ulIndex;
+
+    ( void ) pthread_mutex_lock( &xServerMutex );
+
+    free( pucFile );
+    pucFile = malloc( ( ulSize > 0U ) ? ulSize : 1U );
+    ulFileSize = ulSize;
+
+    for( ulIndex = 0U; ulIndex < ulSize; ulIndex++ )
+    {
+        ulSeed = ( ulSeed * 1103515245U ) + 12345U;
+        pucFile[ ulIndex ] = ( uint8_t ) ( ulSeed >> 16 );
+    }
+
+    ( void ) memset( &xFaults, 0, sizeof( xFaults ) );
+    xFaults.ulFailFrom = UINT32_MAX;
+    ( void ) memset( &xStats, 0, sizeof( xStats ) );
+
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+const uint8_t * pucModelServerFile( void )
+{
+    return pucFile;
+}
+
+/*-----------------------------------------------------------*/
+
+void vModelServerSetFaults( const ModelServerFaults_t * pxFaults )
+{
+    ( void ) pthread_mutex_lock( &xServerMutex );
+    xFaults = *pxFaults;
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+void vModelServerGetStats( ModelServerStats_t * pxStats )
+{
+    ( void ) pthread_mutex_lock( &xServerMutex );
+    *pxStats = xStats;
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+PkiObject_t xPkiObjectFromLabel( const char * pcLabel )
+{
+    PkiObject_t xObject = { .pcLabel = pcLabel };
+
+    return xObject;
+}
+
+/*-----------------------------------------------------------*/
+
+NetworkContext_t * mbedtls_transport_allocate( void )
+{
+    NetworkContext_t * pxCtx = pvPortMalloc( sizeof( NetworkContext_t ) );
+
+    if( pxCtx != NULL )
+    {
+        ( void ) memset( pxCtx, 0, sizeof( NetworkContext_t ) );
+    }
+
+    return pxCtx;
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_transport_free( NetworkContext_t * pxNetworkContext )
+{
+    ( void ) pthread_mutex_lock( &xServerMutex );
+
+    if( pxNetworkContext->xConnected == pdTRUE )
+    {
+        xStats.ulMisuse++;
+    }
+
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+
+    free( pxNetworkContext->pucResponse );
+    vPortFree( pxNetworkContext );
+}
+
+/*-----------------------------------------------------------*/
+
+TlsTransportStatus_t mbedtls_transport_configure( NetworkContext_t * pxNetworkContext,
+                                                  const char ** ppcAlpnProtos,
+                                                  const PkiObject_t * pxPrivateKey,
+                                                  const PkiObject_t * pxClientCert,
+                                                  const PkiObject_t * pxRootCaCerts,
+                                                  const size_t uxNumRootCA )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_UNKNOWN_ERROR;
+
+    /* Server authentication only, the url carries the authorization */
+    if( ( ppcAlpnProtos == NULL ) && ( pxPrivateKey == NULL ) && ( pxClientCert == NULL ) &&
+        ( pxRootCaCerts != NULL ) && ( uxNumRootCA == 1U ) &&
+        ( strcmp( pxRootCaCerts->pcLabel, TLS_ROOT_CA_CERT_LABEL ) == 0 ) )
+    {
+        pxNetworkContext->xConfigured = pdTRUE;
+        xStatus = TLS_TRANSPORT_SUCCESS;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+TlsTransportStatus_t mbedtls_transport_connect( NetworkContext_t * pxNetworkContext,
+                                                const char * pcHostName,
+                                                uint16_t usPort,
+                                                uint32_t ulRecvTimeoutMs,
+                                                uint32_t ulSendTimeoutMs )
+{
+    TlsTransportStatus_t xStatus = TLS_TRANSPORT_CONNECT_FAILURE;
+
+    ( void ) ulRecvTimeoutMs;
+    ( void ) ulSendTimeoutMs;
+
+    ( void ) pthread_mutex_lock( &xServerMutex );
+
+    ( void ) snprintf( xStats.cHost, sizeof( xStats.cHost ), "%s", pcHostName );
+    xStats.usPort = usPort;
+
+    if( ( pxNetworkContext->xConfigured == pdFALSE ) || ( pxNetworkContext->xConnected == pdTRUE ) )
+    {
+        xStats.ulMisuse++;
+    }
+    else if( xFaults.xConnectFail == pdFALSE )
+    {
+        pxNetworkContext->xConnected = pdTRUE;
+        pxNetworkContext->xReset = pdFALSE;
+        pxNetworkContext->ulResponses = 0U;
+        pxNetworkContext->uxResponseLen = 0U;
+        pxNetworkContext->uxResponseRead = 0U;
+        xStats.ulConnections++;
+        xStats.ulOpenConnections++;
+        xStatus = TLS_TRANSPORT_SUCCESS;
+    }
+
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+void mbedtls_transport_disconnect( NetworkContext_t * pxNetworkContext )
+{
+    ( void ) pthread_mutex_lock( &xServerMutex );
+
+    if( pxNetworkContext->xConnected == pdTRUE )
+    {
+        pxNetworkContext->xConnected = pdFALSE;
+        xStats.ulOpenConnections--;
+    }
+    else
+    {
+        xStats.ulMisuse++;
+    }
+
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Build the response to a "Range: bytes=<first>-<last>" request, with the server mutex held */
+static BaseType_t prvServe( NetworkContext_t * pxCtx,
+                            const char * pcRequest,
+                            size_t uxRequestLen )
+{
+    const char * pcRange = NULL;
+    char cHeader[ MODEL_RESPONSE_HEADER_MAX ];
+    unsigned long ulFirst = 0UL;
+    unsigned long ulLast = 0UL;
+    uint32_t ulBodyLen = 0U;
+    int lHeaderLen;
+    BaseType_t xClose;
+
+    pcRange = memmem( pcRequest, uxRequestLen, "\r\nRange: bytes=", 15U );
+
+    if( ( strncmp( pcRequest, "GET ", 4U ) != 0 ) ||
+        ( uxRequestLen < 4U ) ||
+        ( memcmp( &( pcRequest[ uxRequestLen - 4U ] ), "\r\n\r\n", 4U ) != 0 ) ||
+        ( pcRange == NULL ) ||
+        ( sscanf( &( pcRange[ 15 ] ), "%lu-%lu", &ulFirst, &ulLast ) != 2 ) ||
+        ( ulFirst > ulLast ) )
+    {
+        xStats.ulMisuse++;
+        return pdFAIL;
+    }
+
+    xStats.ulRequests++;
+
+    if( ( xFaults.ulFailNext > 0U ) || ( ulFirst >= xFaults.ulFailFrom ) )
+    {
+        if( xFaults.ulFailNext > 0U )
+        {
+            xFaults.ulFailNext--;
+        }
+
+        xStats.ulFailed++;
+        pxCtx->xReset = pdTRUE;
+        return pdFAIL;
+    }
+
+    pxCtx->ulResponses++;
+    xClose = ( ( xFaults.ulCloseEvery > 0U ) &&
+               ( ( pxCtx->ulResponses % xFaults.ulCloseEvery ) == 0U ) ) ? pdTRUE : pdFALSE;
+
+    if( ulFirst >= ulFileSize )
+    {
+        lHeaderLen = snprintf( cHeader, sizeof( cHeader ),
+                               "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                               "Content-Range: bytes */%lu\r\n"
+                               "Content-Length: 0\r\n"
+                               "Connection: %s\r\n\r\n",
+                               ( unsigned long ) ulFileSize,
+                               ( xClose == pdTRUE ) ? "close" : "keep-alive" );
+    }
+    else
+    {
+        if( ulLast >= ulFileSize )
+        {
+            ulLast = ulFileSize - 1U;
+        }
+
+        ulBodyLen = ( uint32_t ) ( ulLast - ulFirst + 1UL );
+        lHeaderLen = snprintf( cHeader, sizeof( cHeader ),
+                               "HTTP/1.1 206 Partial Content\r\n"
+                               "Content-Type: application/octet-stream\r\n"
+                               "Content-Range: bytes %lu-%lu/%lu\r\n"
+                               "Content-Length: %lu\r\n"
+                               "Connection: %s\r\n\r\n",
+                               ulFirst + ( ( xFaults.xBadContentRange == pdTRUE ) ? 1UL : 0UL ),
+                               ulLast, ( unsigned long ) ulFileSize,
+                               ( unsigned long ) ulBodyLen,
+                               ( xClose == pdTRUE ) ? "close" : "keep-alive" );
+    }
+
+    free( pxCtx->pucResponse );
+    pxCtx->pucResponse = malloc( ( size_t ) lHeaderLen + ulBodyLen );
+    ( void ) memcpy( pxCtx->pucResponse, cHeader, ( size_t ) lHeaderLen );
+
+    if( ulBodyLen > 0U )
+    {
+        ( void ) memcpy( &( pxCtx->pucResponse[ lHeaderLen ] ), &( pucFile[ ulFirst ] ), ulBodyLen );
+    }
+
+    pxCtx->uxResponseLen = ( size_t ) lHeaderLen + ulBodyLen;
+    pxCtx->uxResponseRead = 0U;
+
+    /* Closed once the response was sent */
+    pxCtx->xReset = xClose;
+
+    return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
+                                const void * pvBuffer,
+                                size_t uxBytesToSend )
+{
+    int32_t lResult = -1;
+    uint32_t ulDelayMs;
+    struct timespec xDelay;
+
+    ( void ) pthread_mutex_lock( &xServerMutex );
+
+    if( pxNetworkContext->xConnected == pdFALSE )
+    {
+        xStats.ulMisuse++;
+    }
+    else if( ( pxNetworkContext->xReset == pdFALSE ) &&
+             ( prvServe( pxNetworkContext, pvBuffer, uxBytesToSend ) == pdPASS ) )
+    {
+        lResult = ( int32_t ) uxBytesToSend;
+    }
+
+    ulDelayMs = xFaults.ulDelayMs;
+
+    ( void ) pthread_mutex_unlock( &xServerMutex );
+
+    if( ulDelayMs > 0U )
+    {
+        xDelay.tv_sec = ulDelayMs / 1000U;
+        xDelay.tv_nsec = ( long ) ( ulDelayMs % 1000U ) * 1000000L;
+        ( void ) nanosleep( &xDelay, NULL );
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
+                                void * pvBuffer,
+                                size_t uxBufferLength )
+{
+    size_t uxLen = pxNetworkContext->uxResponseLen - pxNetworkContext->uxResponseRead;
+
+    if( uxLen > uxBufferLength )
+    {
+        uxLen = uxBufferLength;
+    }
+
+    /* Delivered in records of at most 4 KB, as over TLS */
+    if( uxLen > 4096U )
+    {
+        uxLen = 4096U;
+    }
+
+    ( void ) memcpy( pvBuffer, &( pxNetworkContext->pucResponse[ pxNetworkContext->uxResponseRead ] ), uxLen );
+    pxNetworkContext->uxResponseRead += uxLen;
+
+    return ( int32_t ) uxLen;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HTTPClient_InitializeRequestHeaders( HTTPRequestHeaders_t * pRequestHeaders,
+                                                  const HTTPRequestInfo_t * pRequestInfo )
+{
+    HTTPStatus_t xStatus = HTTPInsufficientMemory;
+    int lLen;
+
+    /* The headers end with an empty line, before which the other headers are added */
+    lLen = snprintf( ( char * ) pRequestHeaders->pBuffer, pRequestHeaders->bufferLen,
+                     "%.*s %.*s HTTP/1.1\r\n"
+                     "User-Agent: FreeRTOS\r\n"
+                     "Host: %.*s\r\n"
+                     "%s\r\n",
+                     ( int ) pRequestInfo->methodLen, pRequestInfo->pMethod,
+                     ( int ) pRequestInfo->pathLen, pRequestInfo->pPath,
+                     ( int ) pRequestInfo->hostLen, pRequestInfo->pHost,
+                     ( ( pRequestInfo->reqFlags & HTTP_REQUEST_KEEP_ALIVE_FLAG ) != 0U ) ?
+                     "Connection: keep-alive\r\n" : "Connection: close\r\n" );
+
+    if( ( lLen > 0 ) && ( ( size_t ) lLen < pRequestHeaders->bufferLen ) )
+    {
+        pRequestHeaders->headersLen = ( size_t ) lLen;
+        xStatus = HTTPSuccess;
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HTTPClient_AddRangeHeader( HTTPRequestHeaders_t * pRequestHeaders,
+                                        int32_t rangeStartOrlastNbytes,
+                                        int32_t rangeEnd )
+{
+    HTTPStatus_t xStatus = HTTPInsufficientMemory;
+    size_t uxStart = pRequestHeaders->headersLen - 2U;
+    int lLen;
+
+    if( ( rangeStartOrlastNbytes < 0 ) || ( rangeEnd < rangeStartOrlastNbytes ) )
+    {
+        xStatus = HTTPInvalidParameter;
+    }
+    else
+    {
+        lLen = snprintf( ( char * ) &( pRequestHeaders->pBuffer[ uxStart ] ),
+                         pRequestHeaders->bufferLen - uxStart,
+                         "Range: bytes=%ld-%ld\r\n\r\n",
+                         ( long ) rangeStartOrlastNbytes, ( long ) rangeEnd );
+
+        if( ( lLen > 0 ) && ( ( size_t ) lLen < ( pRequestHeaders->bufferLen - uxStart ) ) )
+        {
+            pRequestHeaders->headersLen = uxStart + ( size_t ) lLen;
+            xStatus = HTTPSuccess;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+static HTTPStatus_t prvFindHeader( const uint8_t * pucHeaders,
+                                   size_t uxHeadersLen,
+                                   const char * pcField,
+                                   size_t uxFieldLen,
+                                   const char ** ppcValue,
+                                   size_t * puxValueLen )
+{
+    HTTPStatus_t xStatus = HTTPHeaderNotFound;
+    const char * pcLine = ( const char * ) pucHeaders;
+    const char * pcEnd = &( pcLine[ uxHeadersLen ] );
+    const char * pcEol = NULL;
+    const char * pcValue = NULL;
+
+    while( ( xStatus == HTTPHeaderNotFound ) &&
+           ( ( pcEol = memmem( pcLine, ( size_t ) ( pcEnd - pcLine ), "\r\n", 2U ) ) != NULL ) )
+    {
+        if( ( ( size_t ) ( pcEol - pcLine ) > uxFieldLen ) &&
+            ( strncasecmp( pcLine, pcField, uxFieldLen ) == 0 ) &&
+            ( pcLine[ uxFieldLen ] == ':' ) )
+        {
+            pcValue = &( pcLine[ uxFieldLen + 1U ] );
+
+            while( ( pcValue < pcEol ) && ( *pcValue == ' ' ) )
+            {
+                pcValue++;
+            }
+
+            *ppcValue = pcValue;
+            *puxValueLen = ( size_t ) ( pcEol - pcValue );
+            xStatus = HTTPSuccess;
+        }
+
+        pcLine = &( pcEol[ 2 ] );
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HTTPClient_Send( const TransportInterface_t * pTransport,
+                              HTTPRequestHeaders_t * pRequestHeaders,
+                              const uint8_t * pRequestBodyBuf,
+                              size_t reqBodyBufLen,
+                              HTTPResponse_t * pResponse,
+                              uint32_t sendFlags )
+{
+    HTTPStatus_t xStatus = HTTPSuccess;
+    size_t uxReceived = 0U;
+    const uint8_t * pucEnd = NULL;
+    const char * pcValue = NULL;
+    size_t uxValueLen = 0U;
+    unsigned int uStatusCode = 0U;
+    size_t uxBodyLen = 0U;
+    int32_t lLen;
+
+    ( void ) sendFlags;
+
+    if( ( pTransport == NULL ) || ( pTransport->send == NULL ) || ( pTransport->recv == NULL ) ||
+        ( pRequestHeaders == NULL ) || ( pRequestHeaders->headersLen == 0U ) ||
+        ( pRequestBodyBuf != NULL ) || ( reqBodyBufLen != 0U ) ||
+        ( pResponse == NULL ) || ( pResponse->pBuffer == NULL ) || ( pResponse->getTime == NULL ) )
+    {
+        xStatus = HTTPInvalidParameter;
+    }
+    else if( pTransport->send( pTransport->pNetworkContext,
+                               pRequestHeaders->pBuffer,
+                               pRequestHeaders->headersLen ) != ( int32_t ) pRequestHeaders->headersLen )
+    {
+        xStatus = HTTPNetworkError;
+    }
+    else
+    {
+        /* Read up to the end of the headers, then up to the end of the body */
+        while( ( xStatus == HTTPSuccess ) &&
+               ( ( pucEnd == NULL ) || ( uxReceived < ( size_t ) ( pucEnd - pResponse->pBuffer ) + uxBodyLen ) ) )
+        {
+            if( uxReceived == pResponse->bufferLen )
+            {
+                xStatus = HTTPInsufficientMemory;
+                break;
+            }
+
+            lLen = pTransport->recv( pTransport->pNetworkContext,
+                                     &( pResponse->pBuffer[ uxReceived ] ),
+                                     pResponse->bufferLen - uxReceived );
+
+            if( lLen <= 0 )
+            {
+                xStatus = ( uxReceived == 0U ) ? HTTPNoResponse : HTTPPartialResponse;
+                break;
+            }
+
+            uxReceived += ( size_t ) lLen;
+
+            if( pucEnd == NULL )
+            {
+                pucEnd = memmem( pResponse->pBuffer, uxReceived, "\r\n\r\n", 4U );
+
+                if( pucEnd != NULL )
+                {
+                    pucEnd = &( pucEnd[ 4 ] );
+                    pResponse->pHeaders = ( const uint8_t * ) memmem( pResponse->pBuffer, uxReceived, "\r\n", 2U ) + 2U;
+                    pResponse->headersLen = ( size_t ) ( pucEnd - pResponse->pHeaders ) - 2U;
+
+                    if( ( sscanf( ( const char * ) pResponse->pBuffer, "HTTP/1.1 %3u", &uStatusCode ) != 1 ) ||
+                        ( prvFindHeader( pResponse->pHeaders, pResponse->headersLen,
+                                         "Content-Length", 14U, &pcValue, &uxValueLen ) != HTTPSuccess ) )
+                    {
+                        xStatus = HTTPInvalidResponse;
+                    }
+                    else
+                    {
+                        uxBodyLen = ( size_t ) strtoul( pcValue, NULL, 10 );
+                    }
+                }
+            }
+        }
+    }
+
+    if( xStatus == HTTPSuccess )
+    {
+        pResponse->statusCode = ( uint16_t ) uStatusCode;
+        pResponse->pBody = pucEnd;
+        pResponse->bodyLen = uxBodyLen;
+        pResponse->respFlags = 0U;
+
+        if( ( prvFindHeader( pResponse->pHeaders, pResponse->headersLen,
+                             "Connection", 10U, &pcValue, &uxValueLen ) == HTTPSuccess ) &&
+            ( uxValueLen == 5U ) && ( strncasecmp( pcValue, "close", 5U ) == 0 ) )
+        {
+            pResponse->respFlags |= HTTP_RESPONSE_CONNECTION_CLOSE_FLAG;
+        }
+        else
+        {
+            pResponse->respFlags |= HTTP_RESPONSE_CONNECTION_KEEP_ALIVE_FLAG;
+        }
+    }
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+HTTPStatus_t HTTPClient_ReadHeader( const HTTPResponse_t * pResponse,
+                                    const char * pField,
+                                    size_t fieldLen,
+                                    const char ** pValueLoc,
+                                    size_t * pValueLen )
+{
+    return prvFindHeader( pResponse->pHeaders, pResponse->headersLen,
+                          pField, fieldLen, pValueLoc, pValueLen );
+}
+
+/*-----------------------------------------------------------*/
+
+const char * HTTPClient_strerror( HTTPStatus_t status )
+{
+    const char * pcName = "HTTPError";
+
+    switch( status )
+    {
+        case HTTPSuccess:
+            pcName = "HTTPSuccess";
+            break;
+
+        case HTTPInvalidParameter:
+            pcName = "HTTPInvalidParameter";
+            break;
+
+        case HTTPNetworkError:
+            pcName = "HTTPNetworkError";
+            break;
+
+        case HTTPPartialResponse:
+            pcName = "HTTPPartialResponse";
+            break;
+
+        case HTTPNoResponse:
+            pcName = "HTTPNoResponse";
+            break;
+
+        case HTTPInsufficientMemory:
+            pcName = "HTTPInsufficientMemory";
+            break;
+
+        case HTTPInvalidResponse:
+            pcName = "HTTPInvalidResponse";
+            break;
+
+        default:
+            break;
+    }
+
+    return pcName;
+}
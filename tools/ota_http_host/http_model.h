@@ -0,0 +1,66 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file http_model.h
+ * @brief Controls of the file server model, for the tests.
+ */
+
+#ifndef HTTP_MODEL_H
+#define HTTP_MODEL_H
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/* Behaviour of the server, until the next call to vModelServerReset. */
+typedef struct
+{
+    uint32_t ulCloseEvery;       /* close the connection after every n responses, 0 never */
+    uint32_t ulFailNext;         /* number of requests to fail, as a connection reset */
+    uint32_t ulFailFrom;         /* fail every request of a range at or after this offset */
+    BaseType_t xBadContentRange; /* answer with a Content-Range off by one byte */
+    BaseType_t xConnectFail;     /* refuse the connections */
+    uint32_t ulDelayMs;          /* time taken by each response */
+} ModelServerFaults_t;
+
+typedef struct
+{
+    uint32_t ulRequests;          /* requests received */
+    uint32_t ulFailed;            /* requests failed by ulFailNext or ulFailFrom */
+    uint32_t ulConnections;       /* connections opened */
+    uint32_t ulOpenConnections;   /* connections open now */
+    uint32_t ulMisuse;            /* calls on a closed or unconfigured connection, bad requests */
+    char cHost[ 64 ];             /* host of the last connection */
+    uint16_t usPort;              /* port of the last connection */
+} ModelServerStats_t;
+
+/* Serve a new pseudo-random file of ulFileSize bytes, without faults. */
+void vModelServerReset( uint32_t ulFileSize );
+
+const uint8_t * pucModelServerFile( void );
+
+void vModelServerSetFaults( const ModelServerFaults_t * pxFaults );
+
+void vModelServerGetStats( ModelServerStats_t * pxStats );
+
+#endif /* HTTP_MODEL_H */
@@ -0,0 +1,123 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file core_http_client.h
+ * @brief Types and functions of the coreHTTP v2.0.0 client used by the OTA
+ * http transfer. They are implemented by http_model.c against a model of
+ * the file server.
+ */
+
+#ifndef CORE_HTTP_CLIENT_H_
+#define CORE_HTTP_CLIENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "transport_interface.h"
+
+#define HTTP_METHOD_GET                         "GET"
+
+#define HTTP_REQUEST_KEEP_ALIVE_FLAG            0x1U
+#define HTTP_RESPONSE_CONNECTION_CLOSE_FLAG     0x1U
+#define HTTP_RESPONSE_CONNECTION_KEEP_ALIVE_FLAG    0x2U
+
+typedef uint32_t ( * HTTPClient_GetCurrentTimeFunc_t )( void );
+
+typedef enum HTTPStatus
+{
+    HTTPSuccess = 0,
+    HTTPInvalidParameter,
+    HTTPNetworkError,
+    HTTPPartialResponse,
+    HTTPNoResponse,
+    HTTPInsufficientMemory,
+    HTTPSecurityAlertResponseHeadersSizeLimitExceeded,
+    HTTPSecurityAlertExtraneousResponseData,
+    HTTPSecurityAlertInvalidChunkHeader,
+    HTTPSecurityAlertInvalidProtocolVersion,
+    HTTPSecurityAlertInvalidStatusCode,
+    HTTPSecurityAlertInvalidCharacter,
+    HTTPSecurityAlertInvalidContentLength,
+    HTTPParserInternalError,
+    HTTPHeaderNotFound,
+    HTTPInvalidResponse
+} HTTPStatus_t;
+
+typedef struct HTTPRequestHeaders
+{
+    uint8_t * pBuffer;
+    size_t bufferLen;
+    size_t headersLen;
+} HTTPRequestHeaders_t;
+
+typedef struct HTTPRequestInfo
+{
+    const char * pMethod;
+    size_t methodLen;
+    const char * pPath;
+    size_t pathLen;
+    const char * pHost;
+    size_t hostLen;
+    uint32_t reqFlags;
+} HTTPRequestInfo_t;
+
+typedef struct HTTPClient_ResponseHeaderParsingCallback HTTPClient_ResponseHeaderParsingCallback_t;
+
+typedef struct HTTPResponse
+{
+    uint8_t * pBuffer;
+    size_t bufferLen;
+    HTTPClient_ResponseHeaderParsingCallback_t * pHeaderParsingCallback;
+    HTTPClient_GetCurrentTimeFunc_t getTime;
+    uint16_t statusCode;
+    const uint8_t * pHeaders;
+    size_t headersLen;
+    const uint8_t * pBody;
+    size_t bodyLen;
+    size_t headerCount;
+    uint32_t respFlags;
+} HTTPResponse_t;
+
+HTTPStatus_t HTTPClient_InitializeRequestHeaders( HTTPRequestHeaders_t * pRequestHeaders,
+                                                  const HTTPRequestInfo_t * pRequestInfo );
+
+HTTPStatus_t HTTPClient_AddRangeHeader( HTTPRequestHeaders_t * pRequestHeaders,
+                                        int32_t rangeStartOrlastNbytes,
+                                        int32_t rangeEnd );
+
+HTTPStatus_t HTTPClient_Send( const TransportInterface_t * pTransport,
+                              HTTPRequestHeaders_t * pRequestHeaders,
+                              const uint8_t * pRequestBodyBuf,
+                              size_t reqBodyBufLen,
+                              HTTPResponse_t * pResponse,
+                              uint32_t sendFlags );
+
+HTTPStatus_t HTTPClient_ReadHeader( const HTTPResponse_t * pResponse,
+                                    const char * pField,
+                                    size_t fieldLen,
+                                    const char ** pValueLoc,
+                                    size_t * pValueLen );
+
+const char * HTTPClient_strerror( HTTPStatus_t status );
+
+#endif /* CORE_HTTP_CLIENT_H_ */
@@ -0,0 +1,85 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file mbedtls_transport.h
+ * @brief Host stand-in for Common/include/mbedtls_transport.h. The calls used
+ * by the OTA http transfer open and close a connection of the server model
+ * in http_model.c.
+ */
+
+#ifndef _MBEDTLS_TRANSPORT_H
+#define _MBEDTLS_TRANSPORT_H
+
+#include "FreeRTOS.h"
+
+#include "transport_interface.h"
+
+/* As in Common/include/mbedtls_transport.h */
+#ifndef TLS_TRANSPORT_WRITEV_ENABLED
+#define TLS_TRANSPORT_WRITEV_ENABLED    0
+#endif
+
+#define TLS_ROOT_CA_CERT_LABEL          "root_ca_cert"
+
+typedef enum TlsTransportStatus
+{
+    TLS_TRANSPORT_SUCCESS = 0,
+    TLS_TRANSPORT_UNKNOWN_ERROR = -1,
+    TLS_TRANSPORT_CONNECT_FAILURE = -7
+} TlsTransportStatus_t;
+
+typedef struct PkiObject
+{
+    const char * pcLabel;
+} PkiObject_t;
+
+PkiObject_t xPkiObjectFromLabel( const char * pcLabel );
+
+NetworkContext_t * mbedtls_transport_allocate( void );
+
+void mbedtls_transport_free( NetworkContext_t * pxNetworkContext );
+
+TlsTransportStatus_t mbedtls_transport_configure( NetworkContext_t * pxNetworkContext,
+                                                  const char ** ppcAlpnProtos,
+                                                  const PkiObject_t * pxPrivateKey,
+                                                  const PkiObject_t * pxClientCert,
+                                                  const PkiObject_t * pxRootCaCerts,
+                                                  const size_t uxNumRootCA );
+
+TlsTransportStatus_t mbedtls_transport_connect( NetworkContext_t * pxNetworkContext,
+                                                const char * pcHostName,
+                                                uint16_t usPort,
+                                                uint32_t ulRecvTimeoutMs,
+                                                uint32_t ulSendTimeoutMs );
+
+void mbedtls_transport_disconnect( NetworkContext_t * pxNetworkContext );
+
+int32_t mbedtls_transport_recv( NetworkContext_t * pxNetworkContext,
+                                void * pvBuffer,
+                                size_t uxBufferLength );
+
+int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
+                                const void * pvBuffer,
+                                size_t uxBytesToSend );
+
+#endif /* _MBEDTLS_TRANSPORT_H */
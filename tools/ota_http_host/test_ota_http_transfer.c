@@ -0,0 +1,390 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file test_ota_http_transfer.c
+ * @brief Host test of the range reader of Common/app/ota/ota_http_transfer.c
+ * against the server model of http_model.c.
+ */
+
+#include "FreeRTOS.h"
+#include "ota_http_transfer.h"
+#include "http_model.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t ulFailures = 0;
+static uint32_t ulChecks = 0;
+
+#define CHECK( x )                                                      \
+    do {                                                                \
+        ulChecks++;                                                     \
+        if( !( x ) )                                                    \
+        {                                                               \
+            ulFailures++;                                               \
+            printf( "FAIL %s:%d: %s\n", __FILE__, __LINE__, #x );       \
+        }                                                               \
+    } while( 0 )
+
+#define TEST_URL           "https://files.example.com/ota/image.bin?X-Amz-Signature=0123abcd"
+#define TEST_BLOCK_SIZE    otaconfigFILE_BLOCK_SIZE
+
+static uint8_t ucBlock[ TEST_BLOCK_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+/* Read ulLength bytes at ulOffset and compare them with the file */
+static BaseType_t prvReadMatches( uint32_t ulOffset,
+                                  uint32_t ulLength,
+                                  int32_t lExpected )
+{
+    int32_t lRead = lOtaHttpTransferRead( ulOffset, ucBlock, ulLength );
+
+    return ( ( lRead == lExpected ) &&
+             ( ( lRead <= 0 ) ||
+               ( memcmp( ucBlock, &( pucModelServerFile()[ ulOffset ] ), ( size_t ) lRead ) == 0 ) ) ) ? pdTRUE : pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Read the file block by block from ulOffset, as the OTA agent does, up to the end of the file */
+static BaseType_t prvReadToEnd( uint32_t ulOffset,
+                                uint32_t ulFileSize )
+{
+    BaseType_t xResult = pdTRUE;
+    uint32_t ulExpected;
+
+    for( ; ( ulOffset < ulFileSize ) && ( xResult == pdTRUE ); ulOffset += TEST_BLOCK_SIZE )
+    {
+        ulExpected = ulFileSize - ulOffset;
+
+        if( ulExpected > TEST_BLOCK_SIZE )
+        {
+            ulExpected = TEST_BLOCK_SIZE;
+        }
+
+        xResult = prvReadMatches( ulOffset, TEST_BLOCK_SIZE, ( int32_t ) ulExpected );
+    }
+
+    if( xResult == pdTRUE )
+    {
+        xResult = prvReadMatches( ulFileSize, TEST_BLOCK_SIZE, 0 );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNumRanges( uint32_t ulFileSize )
+{
+    return ( ulFileSize + otahttpRANGE_SIZE - 1U ) / otahttpRANGE_SIZE;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestSequential( void )
+{
+    static const uint32_t ulSizes[] =
+    {
+        ( 5U * otahttpRANGE_SIZE ) + 1000U,
+        4U * otahttpRANGE_SIZE,
+        otahttpRANGE_SIZE + TEST_BLOCK_SIZE,
+        100U
+    };
+    ModelServerStats_t xStats;
+    size_t uxBlocks = uxPortAllocatedBlocks();
+    uint32_t ulIndex;
+
+    for( ulIndex = 0U; ulIndex < sizeof( ulSizes ) / sizeof( ulSizes[ 0 ] ); ulIndex++ )
+    {
+        vModelServerReset( ulSizes[ ulIndex ] );
+
+        CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+        CHECK( prvReadToEnd( 0U, ulSizes[ ulIndex ] ) == pdTRUE );
+        vOtaHttpTransferStop();
+
+        /* One request per range over a single connection, none past the end of the file */
+        vModelServerGetStats( &xStats );
+        CHECK( xStats.ulConnections == 1U );
+        CHECK( xStats.ulRequests == prvNumRanges( ulSizes[ ulIndex ] ) );
+        CHECK( xStats.ulOpenConnections == 0U );
+        CHECK( xStats.ulMisuse == 0U );
+        CHECK( strcmp( xStats.cHost, "files.example.com" ) == 0 );
+        CHECK( xStats.usPort == 443U );
+        CHECK( uxPortAllocatedBlocks() == uxBlocks );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestServerClose( void )
+{
+    const uint32_t ulFileSize = ( 6U * otahttpRANGE_SIZE ) - 1U;
+    ModelServerFaults_t xFaults = { .ulCloseEvery = 2U, .ulFailFrom = UINT32_MAX };
+    ModelServerStats_t xStats;
+
+    vModelServerReset( ulFileSize );
+    vModelServerSetFaults( &xFaults );
+
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    CHECK( prvReadToEnd( 0U, ulFileSize ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    /* The connection is reopened for the next request after every "Connection: close" */
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulRequests == 6U );
+    CHECK( xStats.ulConnections == 3U );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestRetry( void )
+{
+    const uint32_t ulFileSize = 3U * otahttpRANGE_SIZE;
+    ModelServerFaults_t xFaults = { .ulFailNext = 1U, .ulFailFrom = UINT32_MAX };
+    ModelServerStats_t xStats;
+
+    vModelServerReset( ulFileSize );
+    vModelServerSetFaults( &xFaults );
+
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    CHECK( prvReadToEnd( 0U, ulFileSize ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    /* The failed request is sent again on a new connection */
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulFailed == 1U );
+    CHECK( xStats.ulRequests == 4U );
+    CHECK( xStats.ulConnections == 2U );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestPersistentFailure( void )
+{
+    const uint32_t ulFileSize = ( 4U * otahttpRANGE_SIZE ) + 10U;
+    ModelServerFaults_t xFaults = { .ulFailFrom = 2U * otahttpRANGE_SIZE };
+    ModelServerStats_t xStats;
+    uint32_t ulOffset;
+
+    vModelServerReset( ulFileSize );
+    vModelServerSetFaults( &xFaults );
+
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+
+    for( ulOffset = 0U; ulOffset < xFaults.ulFailFrom; ulOffset += TEST_BLOCK_SIZE )
+    {
+        CHECK( prvReadMatches( ulOffset, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+    }
+
+    /* Each range is tried twice, and the read fails once the retry failed */
+    CHECK( prvReadMatches( ulOffset, TEST_BLOCK_SIZE, -1 ) == pdTRUE );
+    CHECK( prvReadMatches( ulOffset, TEST_BLOCK_SIZE, -1 ) == pdTRUE );
+
+    /* Once the server recovers, the next read fetches the file again from its offset */
+    xFaults.ulFailFrom = UINT32_MAX;
+    vModelServerSetFaults( &xFaults );
+    CHECK( prvReadToEnd( ulOffset, ulFileSize ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulFailed >= 4U );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestRandomAccess( void )
+{
+    const uint32_t ulFileSize = ( 8U * otahttpRANGE_SIZE ) + 333U;
+    ModelServerStats_t xStats;
+
+    vModelServerReset( ulFileSize );
+
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+
+    /* Out of the ranges being fetched: restarts the download there */
+    CHECK( prvReadMatches( ( 5U * otahttpRANGE_SIZE ) + TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+    CHECK( prvReadMatches( ( 5U * otahttpRANGE_SIZE ) + ( 2U * TEST_BLOCK_SIZE ), TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+
+    /* Backwards, to a block already read */
+    CHECK( prvReadMatches( ( 5U * otahttpRANGE_SIZE ) + TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+
+    /* Backwards, out of the ranges being fetched */
+    CHECK( prvReadMatches( TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+
+    /* A read does not cross the end of a range, which starts at the offset of the restart */
+    CHECK( prvReadMatches( TEST_BLOCK_SIZE + otahttpRANGE_SIZE - 100U, TEST_BLOCK_SIZE, 100 ) == pdTRUE );
+    CHECK( prvReadMatches( TEST_BLOCK_SIZE + otahttpRANGE_SIZE, 3U, 3 ) == pdTRUE );
+
+    /* Past the end of the file, then the last bytes */
+    CHECK( prvReadMatches( ulFileSize + TEST_BLOCK_SIZE, TEST_BLOCK_SIZE, 0 ) == pdTRUE );
+    CHECK( prvReadMatches( ulFileSize - 333U, TEST_BLOCK_SIZE, 333 ) == pdTRUE );
+
+    /* And the whole file from the start */
+    CHECK( prvReadToEnd( 0U, ulFileSize ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulConnections == 1U );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestBadContentRange( void )
+{
+    ModelServerFaults_t xFaults = { .xBadContentRange = pdTRUE, .ulFailFrom = UINT32_MAX };
+    ModelServerStats_t xStats;
+
+    vModelServerReset( 3U * otahttpRANGE_SIZE );
+    vModelServerSetFaults( &xFaults );
+
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    CHECK( prvReadMatches( 0U, TEST_BLOCK_SIZE, -1 ) == pdTRUE );
+
+    /* The file size is unknown until a response was accepted */
+    xFaults.xBadContentRange = pdFALSE;
+    vModelServerSetFaults( &xFaults );
+    CHECK( prvReadToEnd( 0U, 3U * otahttpRANGE_SIZE ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestUrls( void )
+{
+    static const char * const pcInvalid[] =
+    {
+        "http://files.example.com/image.bin",
+        "https://",
+        "https:///image.bin",
+        "https://files.example.com:0/image.bin",
+        "https://files.example.com:65536/image.bin",
+        "https://files.example.com:/image.bin",
+        "https://files.example.com:443x/image.bin"
+    };
+    ModelServerFaults_t xFaults = { .xConnectFail = pdTRUE, .ulFailFrom = UINT32_MAX };
+    ModelServerStats_t xStats;
+    size_t uxBlocks = uxPortAllocatedBlocks();
+    uint32_t ulIndex;
+
+    vModelServerReset( 1000U );
+
+    for( ulIndex = 0U; ulIndex < sizeof( pcInvalid ) / sizeof( pcInvalid[ 0 ] ); ulIndex++ )
+    {
+        CHECK( xOtaHttpTransferStart( pcInvalid[ ulIndex ] ) == pdFAIL );
+        CHECK( uxPortAllocatedBlocks() == uxBlocks );
+    }
+
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulConnections == 0U );
+
+    CHECK( xOtaHttpTransferStart( "https://192.0.2.1:8443/image.bin" ) == pdPASS );
+    CHECK( prvReadToEnd( 0U, 1000U ) == pdTRUE );
+    vOtaHttpTransferStop();
+    vModelServerGetStats( &xStats );
+    CHECK( strcmp( xStats.cHost, "192.0.2.1" ) == 0 );
+    CHECK( xStats.usPort == 8443U );
+
+    /* Without a path */
+    CHECK( xOtaHttpTransferStart( "https://files.example.com" ) == pdPASS );
+    CHECK( prvReadToEnd( 0U, 1000U ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    /* The server can not be reached */
+    vModelServerSetFaults( &xFaults );
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdFAIL );
+
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+    CHECK( uxPortAllocatedBlocks() == uxBlocks );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestStop( void )
+{
+    ModelServerFaults_t xFaults = { .ulDelayMs = 50U, .ulFailFrom = UINT32_MAX };
+    ModelServerStats_t xStats;
+    size_t uxBlocks = uxPortAllocatedBlocks();
+
+    vModelServerReset( 10U * otahttpRANGE_SIZE );
+    vModelServerSetFaults( &xFaults );
+
+    /* Stopped with the ranges being fetched */
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    vOtaHttpTransferStop();
+    CHECK( uxPortAllocatedBlocks() == uxBlocks );
+
+    /* Stopped after a read, with the next ranges being fetched */
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    CHECK( prvReadMatches( 0U, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+    vOtaHttpTransferStop();
+    CHECK( uxPortAllocatedBlocks() == uxBlocks );
+
+    /* A new transfer stops the current one */
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    CHECK( xOtaHttpTransferStart( TEST_URL ) == pdPASS );
+    CHECK( prvReadMatches( otahttpRANGE_SIZE, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE ) == pdTRUE );
+    vOtaHttpTransferStop();
+
+    /* Stopping twice is harmless */
+    vOtaHttpTransferStop();
+
+    vModelServerGetStats( &xStats );
+    CHECK( xStats.ulConnections == 4U );
+    CHECK( xStats.ulOpenConnections == 0U );
+    CHECK( xStats.ulMisuse == 0U );
+    CHECK( uxPortAllocatedBlocks() == uxBlocks );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    prvTestSequential();
+    prvTestServerClose();
+    prvTestRetry();
+    prvTestPersistentFailure();
+    prvTestRandomAccess();
+    prvTestBadContentRange();
+    prvTestUrls();
+    prvTestStop();
+
+    printf( "%lu checks, %lu failures\n", ( unsigned long ) ulChecks, ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0U ) ? 0 : 1;
+}
@@ -0,0 +1,370 @@
+#!python
+#
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+#
+#
+"""Local HTTPS file server for OTA downloads over HTTP.
+
+"serve" stands in for the pre-signed S3 url of an OTA job: it serves the files
+of a directory over HTTPS, answering range requests with 206 Partial Content
+and keeping connections alive between requests like S3 does. Point the url of
+a test job at https://<host>:<port>/<file> and provision the CA certificate of
+the server under the root CA label used by the device (otahttpROOT_CA_CERT_LABEL).
+--latency delays every response to emulate the round trip time to S3, and
+--close-every closes the connection after some responses to exercise the
+reconnection of the device.
+
+"fetch" downloads a file from the server the way the device does (see
+Common/app/ota/ota_http_transfer.c): ranges of --range-size bytes on a kept
+alive connection, with --ranges of them requested ahead. It checks the file
+and reports the throughput, and with --compare the throughput of one request
+per OTA block as done over MQTT.
+"""
+import argparse
+import hashlib
+import http.client
+import http.server
+import logging
+import os
+import queue
+import re
+import socketserver
+import ssl
+import threading
+import time
+import urllib.parse
+
+from ota_delta import OTA_BLOCK_SIZE
+
+logger = logging.getLogger()
+
+DEFAULT_RANGE_SIZE = 8 * OTA_BLOCK_SIZE
+DEFAULT_RANGES = 2
+
+RANGE_RE = re.compile(r"^bytes=(\d*)-(\d*)$")
+CONTENT_RANGE_RE = re.compile(r"^bytes (\d+)-(\d+)/(\d+)$")
+
+
+class RangeRequestHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        logger.debug("%s %s", self.address_string(), format % args)
+
+    def _path(self):
+        # The query holds the signature of a pre-signed url, it is ignored.
+        name = urllib.parse.unquote(urllib.parse.urlsplit(self.path).path).lstrip("/")
+        path = os.path.realpath(os.path.join(self.server.root, name))
+        if os.path.commonpath([path, self.server.root]) != self.server.root or not os.path.isfile(path):
+            return None
+        return path
+
+    def _reply(self, status, headers, body=b""):
+        self.server.count_response()
+        if self.server.latency:
+            time.sleep(self.server.latency)
+        close = self.server.close_every and self.server.responses % self.server.close_every == 0
+        self.send_response(status)
+        for name, value in headers:
+            self.send_header(name, value)
+        self.send_header("Content-Length", str(len(body)))
+        if close:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def do_GET(self):
+        path = self._path()
+        if path is None:
+            self._reply(404, [])
+            return
+
+        with open(path, "rb") as f:
+            data = f.read()
+        size = len(data)
+
+        range_header = self.headers.get("Range")
+        if range_header is None:
+            self._reply(200, [("Accept-Ranges", "bytes")], data)
+            return
+
+        match = RANGE_RE.match(range_header.strip())
+        if match is None or match.group(1) == match.group(2) == "":
+            self._reply(400, [])
+            return
+
+        if match.group(1) == "":
+            # Suffix range: the last N bytes
+            first = max(size - int(match.group(2)), 0)
+            last = size - 1
+        else:
+            first = int(match.group(1))
+            last = int(match.group(2)) if match.group(2) else size - 1
+            last = min(last, size - 1)
+
+        if first >= size or first > last:
+            self._reply(416, [("Content-Range", "bytes */{}".format(size))])
+            return
+
+        self.server.count_bytes(last - first + 1)
+        self._reply(
+            206,
+            [("Accept-Ranges", "bytes"), ("Content-Range", "bytes {}-{}/{}".format(first, last, size))],
+            data[first : last + 1],
+        )
+
+    do_HEAD = do_GET
+
+
+class RangeServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+    def __init__(self, address, root, latency=0.0, close_every=0):
+        super().__init__(address, RangeRequestHandler)
+        self.root = os.path.realpath(root)
+        self.latency = latency
+        self.close_every = close_every
+        self.responses = 0
+        self.bytes_sent = 0
+        self.lock = threading.Lock()
+
+    def count_response(self):
+        with self.lock:
+            self.responses += 1
+
+    def count_bytes(self, count):
+        with self.lock:
+            self.bytes_sent += count
+
+
+class Downloader:
+    """Range downloader, equivalent to ota_http_transfer.c."""
+
+    def __init__(self, url, range_size, ranges, context):
+        parts = urllib.parse.urlsplit(url)
+        if parts.scheme != "https":
+            raise ValueError("only https urls are supported")
+        self.host = parts.hostname
+        self.port = parts.port or 443
+        self.path = parts.path + ("?" + parts.query if parts.query else "")
+        self.range_size = range_size
+        self.ranges = ranges
+        self.context = context
+        self.connection = None
+        self.connections = 0
+        self.requests = 0
+        self.size = None
+
+    def _request(self, first, last):
+        # A kept alive connection may have been closed by the server, retry once.
+        for attempt in range(2):
+            if self.connection is None:
+                self.connection = http.client.HTTPSConnection(self.host, self.port, context=self.context)
+                self.connections += 1
+            try:
+                self.requests += 1
+                self.connection.request("GET", self.path, headers={"Range": "bytes={}-{}".format(first, last)})
+                response = self.connection.getresponse()
+                body = response.read()
+            except (OSError, http.client.HTTPException):
+                self.connection.close()
+                self.connection = None
+                if attempt:
+                    raise
+                continue
+            if response.will_close:
+                self.connection.close()
+                self.connection = None
+            break
+
+        if response.status != 206:
+            raise ValueError("unexpected status {} for the range at {}".format(response.status, first))
+        match = CONTENT_RANGE_RE.match(response.getheader("Content-Range", ""))
+        if match is None:
+            raise ValueError("missing or invalid Content-Range header")
+        resp_first, resp_last, size = (int(g) for g in match.groups())
+        if resp_first != first or resp_last > last or len(body) != resp_last - resp_first + 1:
+            raise ValueError("response does not match the range requested at {}".format(first))
+        if self.size is not None and size != self.size:
+            raise ValueError("file size changed")
+        self.size = size
+        return body
+
+    def fetch_range(self, offset, size):
+        last = offset + size - 1
+        if self.size is not None:
+            if offset >= self.size:
+                return b""
+            last = min(last, self.size - 1)
+        return self._request(offset, last)
+
+    def download(self):
+        """Download the file, with up to self.ranges ranges fetched ahead of the reader."""
+        requests = queue.Queue()
+        done = queue.Queue()
+
+        def fetch():
+            while True:
+                offset = requests.get()
+                if offset is None:
+                    return
+                try:
+                    done.put((offset, self.fetch_range(offset, self.range_size)))
+                except Exception as e:
+                    done.put((offset, e))
+
+        fetcher = threading.Thread(target=fetch, daemon=True)
+        fetcher.start()
+
+        next_offset = 0
+        for _ in range(self.ranges):
+            requests.put(next_offset)
+            next_offset += self.range_size
+
+        data = bytearray()
+        try:
+            while True:
+                offset, result = done.get()
+                if isinstance(result, Exception):
+                    raise result
+                data += result
+                if len(result) < self.range_size:
+                    break
+                requests.put(next_offset)
+                next_offset += self.range_size
+        finally:
+            requests.put(None)
+            fetcher.join()
+            if self.connection is not None:
+                self.connection.close()
+        return bytes(data)
+
+    def download_blocks(self):
+        """Download the file one OTA block at a time, waiting for each block."""
+        data = bytearray()
+        while self.size is None or len(data) < self.size:
+            data += self.fetch_range(len(data), OTA_BLOCK_SIZE)
+        if self.connection is not None:
+            self.connection.close()
+        return bytes(data)
+
+
+def make_context(args):
+    context = ssl.create_default_context(cafile=args.ca_cert)
+    if args.insecure:
+        context.check_hostname = False
+        context.verify_mode = ssl.CERT_NONE
+    return context
+
+
+def timed(name, download, expected):
+    start = time.monotonic()
+    data = download()
+    elapsed = max(time.monotonic() - start, 1e-6)
+    if expected is not None and data != expected:
+        raise ValueError("downloaded file differs from the expected file")
+    logging.info(
+        "{}: {} bytes in {:.2f} s ({:.1f} KB/s), SHA-256: {}".format(
+            name, len(data), elapsed, len(data) / elapsed / 1024, hashlib.sha256(data).hexdigest()
+        )
+    )
+    return elapsed
+
+
+def process_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    serve = subparsers.add_parser("serve", help="Serve the files of DIRECTORY over HTTPS.")
+    serve.add_argument("directory")
+    serve.add_argument("--cert", required=True, help="PEM certificate of the server.")
+    serve.add_argument("--key", required=True, help="PEM private key of the server.")
+    serve.add_argument("--address", default="0.0.0.0")
+    serve.add_argument("--port", type=int, default=8443)
+    serve.add_argument("--latency", type=float, default=0.0, help="Delay of each response, in ms.")
+    serve.add_argument("--close-every", type=int, default=0, help="Close the connection every N responses.")
+
+    fetch = subparsers.add_parser("fetch", help="Download URL like the device does.")
+    fetch.add_argument("url")
+    fetch.add_argument("--file", help="Expected file.")
+    fetch.add_argument("--range-size", type=int, default=DEFAULT_RANGE_SIZE, help="Bytes per range request.")
+    fetch.add_argument("--ranges", type=int, default=DEFAULT_RANGES, help="Ranges buffered, otahttpNUM_RANGES.")
+    fetch.add_argument("--compare", action="store_true", help="Also download one block per request.")
+    fetch.add_argument("--ca-cert", help="PEM CA certificate of the server.")
+    fetch.add_argument("--insecure", action="store_true", help="Do not verify the server certificate.")
+
+    parser.add_argument("-v", "--verbose", action="store_true")
+    return parser.parse_args()
+
+
+def main():
+    args = process_args()
+
+    logging.basicConfig()
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+    else:
+        logger.setLevel(logging.INFO)
+
+    if args.command == "serve":
+        server = RangeServer((args.address, args.port), args.directory, args.latency / 1000.0, args.close_every)
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+        logging.info("Serving {} on https://{}:{}/".format(server.root, args.address, args.port))
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            pass
+        logging.info("{} responses, {} bytes of ranges sent".format(server.responses, server.bytes_sent))
+    else:
+        if args.range_size <= 0 or args.range_size % OTA_BLOCK_SIZE or args.ranges < 1:
+            raise SystemExit("--range-size must be a multiple of {} and --ranges at least 1".format(OTA_BLOCK_SIZE))
+
+        expected = None
+        if args.file:
+            with open(args.file, "rb") as f:
+                expected = f.read()
+
+        try:
+            downloader = Downloader(args.url, args.range_size, args.ranges, make_context(args))
+            ranges = timed("Ranges", downloader.download, expected)
+            logging.info(
+                "{} range requests over {} connections".format(downloader.requests, downloader.connections)
+            )
+
+            if args.compare:
+                downloader = Downloader(args.url, args.range_size, args.ranges, make_context(args))
+                blocks = timed("Blocks", downloader.download_blocks, expected)
+                logging.info("Ranges were {:.1f} times faster".format(blocks / ranges))
+        except (ValueError, OSError, http.client.HTTPException) as e:
+            logging.error("Failed: {}".format(e))
+            raise SystemExit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,121 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file flash_model.c
+ * @brief RAM model of the inactive flash bank. See flash_model.h.
+ */
+
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*-----------------------------------------------------------*/
+
+void vFlashModelInit( FlashModel_t * pxFlash,
+                      uint32_t ulBankSize )
+{
+    ( void ) memset( pxFlash, 0, sizeof( FlashModel_t ) );
+
+    pxFlash->pucBank = malloc( ulBankSize );
+
+    if( pxFlash->pucBank == NULL )
+    {
+        printf( "Out of memory\n" );
+        exit( 1 );
+    }
+
+    ( void ) memset( pxFlash->pucBank, 0xFF, ulBankSize );
+    pxFlash->ulBankSize = ulBankSize;
+}
+
+/*-----------------------------------------------------------*/
+
+void vFlashModelFree( FlashModel_t * pxFlash )
+{
+    free( pxFlash->pucBank );
+    pxFlash->pucBank = NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t lFlashModelImageStart( FlashModel_t * pxFlash,
+                               uint32_t ulImageSize )
+{
+    int32_t lResult = -1;
+
+    if( ( ulImageSize > 0U ) && ( ulImageSize <= pxFlash->ulBankSize ) )
+    {
+        pxFlash->ulImageSize = ulImageSize;
+        pxFlash->ulStarts++;
+        lResult = 0;
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+int32_t lFlashModelWrite( void * pvCtx,
+                          uint32_t ulOffset,
+                          const uint8_t * pucData,
+                          uint32_t ulLength )
+{
+    FlashModel_t * pxFlash = ( FlashModel_t * ) pvCtx;
+    int32_t lResult = 0;
+
+    pxFlash->ulWrites++;
+
+    if( ( pxFlash->ulFailAtWrite != 0U ) && ( pxFlash->ulWrites == pxFlash->ulFailAtWrite ) )
+    {
+        lResult = -1;
+    }
+    else if( ( pxFlash->ulStarts == 0U ) ||
+             ( ( ulOffset % FLASH_MODEL_WRITE_ALIGN ) != 0U ) ||
+             ( ulOffset > pxFlash->ulBankSize ) ||
+             ( ulLength > ( pxFlash->ulBankSize - ulOffset ) ) )
+    {
+        pxFlash->ulMisuse++;
+        lResult = -1;
+    }
+    else
+    {
+        for( uint32_t i = 0; ( i < ulLength ) && ( lResult == 0 ); i++ )
+        {
+            if( pxFlash->pucBank[ ulOffset + i ] != 0xFFU )
+            {
+                pxFlash->ulMisuse++;
+                lResult = -1;
+            }
+        }
+    }
+
+    if( lResult == 0 )
+    {
+        ( void ) memcpy( &( pxFlash->pucBank[ ulOffset ] ), pucData, ulLength );
+        pxFlash->ulWritten += ulLength;
+    }
+
+    return lResult;
+}
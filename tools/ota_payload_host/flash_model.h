@@ -0,0 +1,72 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file flash_model.h
+ * @brief RAM model of the inactive flash bank written by the payload decoders
+ * of the ntz OTA PAL, for the tests.
+ */
+
+#ifndef FLASH_MODEL_H
+#define FLASH_MODEL_H
+
+#include <stdint.h>
+
+/* Flash programming unit of the STM32U5 (quad word) */
+#define FLASH_MODEL_WRITE_ALIGN    ( 16U )
+
+typedef struct
+{
+    uint8_t * pucBank;       /* erased to 0xFF by vFlashModelInit */
+    uint32_t ulBankSize;
+    uint32_t ulImageSize;    /* accepted by lFlashModelImageStart, 0 until then */
+    uint32_t ulStarts;       /* calls to lFlashModelImageStart which accepted the image */
+    uint32_t ulWrites;       /* writes done */
+    uint32_t ulWritten;      /* bytes written */
+    uint32_t ulMisuse;       /* writes refused: unaligned, past the bank, on programmed bytes or before the start */
+    uint32_t ulFailAtWrite;  /* fail the nth write (1 based), 0 never */
+} FlashModel_t;
+
+/* Erase a bank of ulBankSize bytes. */
+void vFlashModelInit( FlashModel_t * pxFlash,
+                      uint32_t ulBankSize );
+
+void vFlashModelFree( FlashModel_t * pxFlash );
+
+/*
+ * Accept an image of ulImageSize bytes, as prvPayloadImageStart of the PAL:
+ * the image must fit in the bank. Returns 0 when accepted.
+ */
+int32_t lFlashModelImageStart( FlashModel_t * pxFlash,
+                               uint32_t ulImageSize );
+
+/*
+ * Write callback of the decoders, with pvCtx the FlashModel_t. Writes must
+ * start at a multiple of FLASH_MODEL_WRITE_ALIGN, stay in the bank and only
+ * program erased bytes. Returns 0 on success.
+ */
+int32_t lFlashModelWrite( void * pvCtx,
+                          uint32_t ulOffset,
+                          const uint8_t * pucData,
+                          uint32_t ulLength );
+
+#endif /* FLASH_MODEL_H */
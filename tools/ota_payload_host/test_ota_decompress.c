@@ -0,0 +1,547 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file test_ota_decompress.c
+ * @brief Host test of the decompressor of the ntz OTA PAL
+ * (Projects/b_u585i_iot02a_ntz/Src/ota_pal/ota_decompress.c), writing into
+ * the flash model of flash_model.c.
+ */
+
+#include "ota_decompress.h"
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t ulFailures = 0;
+static uint32_t ulChecks = 0;
+
+#define CHECK( x )                                                      \
+    do {                                                                \
+        ulChecks++;                                                     \
+        if( !( x ) )                                                    \
+        {                                                               \
+            ulFailures++;                                               \
+            printf( "FAIL %s:%d: %s\n", __FILE__, __LINE__, #x );       \
+        }                                                               \
+    } while( 0 )
+
+#define TEST_BANK_SIZE         ( 32U * 1024U )
+#define TEST_IMAGE_SIZE        ( 12U * 1024U + 77U )
+#define TEST_OTA_BLOCK         ( 2048U )
+#define TEST_COMPRESSED_MAX    ( 64U * 1024U )
+
+/* A compressed image being built */
+typedef struct
+{
+    uint8_t ucData[ TEST_COMPRESSED_MAX ];
+    uint32_t ulLength;
+    uint32_t ulBits;       /* bits pending in ucByte */
+    uint8_t ucByte;
+} TestStream_t;
+
+static uint8_t ucImage[ TEST_BANK_SIZE * 2U ];
+static TestStream_t xStream;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    static uint32_t ulState = 0x87654321UL;
+
+    ulState ^= ulState << 13;
+    ulState ^= ulState >> 17;
+    ulState ^= ulState << 5;
+
+    return ulState;
+}
+
+/*-----------------------------------------------------------*/
+
+/* An image made of runs, of repeats of earlier bytes and of random bytes */
+static void prvImageGenerate( uint32_t ulSize )
+{
+    uint32_t ulOffset = 0;
+
+    while( ulOffset < ulSize )
+    {
+        uint32_t ulKind = prvRandom() % 4U;
+        uint32_t ulLength = 1U + ( prvRandom() % 40U );
+
+        for( uint32_t i = 0; ( i < ulLength ) && ( ulOffset < ulSize ); i++, ulOffset++ )
+        {
+            if( ( ulKind == 0U ) || ( ulOffset < 64U ) )
+            {
+                ucImage[ ulOffset ] = ( uint8_t ) prvRandom();
+            }
+            else if( ulKind == 1U )
+            {
+                ucImage[ ulOffset ] = 0xFFU;
+            }
+            else
+            {
+                ucImage[ ulOffset ] = ucImage[ ulOffset - 1U - ( ( ulKind == 2U ) ? 3U : 60U ) ];
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPutBits( uint32_t ulValue,
+                        uint32_t ulCount )
+{
+    while( ulCount > 0U )
+    {
+        ulCount--;
+        xStream.ucByte = ( uint8_t ) ( ( xStream.ucByte << 1 ) | ( ( ulValue >> ulCount ) & 1U ) );
+        xStream.ulBits++;
+
+        if( xStream.ulBits == 8U )
+        {
+            if( xStream.ulLength == TEST_COMPRESSED_MAX )
+            {
+                printf( "Test stream too long\n" );
+                exit( 1 );
+            }
+
+            xStream.ucData[ xStream.ulLength++ ] = xStream.ucByte;
+            xStream.ucByte = 0U;
+            xStream.ulBits = 0U;
+        }
+    }
+}
+
+static void prvStreamHeader( uint8_t ucWindowLog2,
+                             uint8_t ucLookaheadLog2,
+                             uint32_t ulImageSize )
+{
+    xStream.ulLength = 0U;
+    xStream.ulBits = 0U;
+    xStream.ucByte = 0U;
+
+    prvPutBits( OTA_DECOMPRESS_MAGIC & 0xFFU, 8U );
+    prvPutBits( ( OTA_DECOMPRESS_MAGIC >> 8 ) & 0xFFU, 8U );
+    prvPutBits( ( OTA_DECOMPRESS_MAGIC >> 16 ) & 0xFFU, 8U );
+    prvPutBits( ( OTA_DECOMPRESS_MAGIC >> 24 ) & 0xFFU, 8U );
+    prvPutBits( OTA_DECOMPRESS_FORMAT_VERSION, 8U );
+    prvPutBits( ucWindowLog2, 8U );
+    prvPutBits( ucLookaheadLog2, 8U );
+    prvPutBits( 0U, 8U );
+    prvPutBits( ulImageSize & 0xFFU, 8U );
+    prvPutBits( ( ulImageSize >> 8 ) & 0xFFU, 8U );
+    prvPutBits( ( ulImageSize >> 16 ) & 0xFFU, 8U );
+    prvPutBits( ( ulImageSize >> 24 ) & 0xFFU, 8U );
+}
+
+static void prvStreamLiteral( uint8_t ucByte )
+{
+    prvPutBits( 1U, 1U );
+    prvPutBits( ucByte, 8U );
+}
+
+static void prvStreamReference( uint8_t ucWindowLog2,
+                                uint8_t ucLookaheadLog2,
+                                uint32_t ulDistance,
+                                uint32_t ulLength )
+{
+    prvPutBits( 0U, 1U );
+    prvPutBits( ulDistance - 1U, ucWindowLog2 );
+    prvPutBits( ulLength - 1U, ucLookaheadLog2 );
+}
+
+/* Pad the last byte with zero bits */
+static void prvStreamFinish( void )
+{
+    if( xStream.ulBits > 0U )
+    {
+        prvPutBits( 0U, 8U - xStream.ulBits );
+    }
+}
+
+/*
+ * Compress the first ulSize bytes of ucImage with greedy matching, like
+ * tools/ota_compress.py.
+ */
+static void prvCompress( uint32_t ulSize,
+                         uint8_t ucWindowLog2,
+                         uint8_t ucLookaheadLog2 )
+{
+    uint32_t ulWindow = 1UL << ucWindowLog2;
+    uint32_t ulMaxLength = 1UL << ucLookaheadLog2;
+    uint32_t ulMinLength = ( ( 1U + ucWindowLog2 + ucLookaheadLog2 ) / 9U ) + 1U;
+    uint32_t ulOffset = 0;
+
+    prvStreamHeader( ucWindowLog2, ucLookaheadLog2, ulSize );
+
+    while( ulOffset < ulSize )
+    {
+        uint32_t ulBestLength = 0;
+        uint32_t ulBestDistance = 0;
+        uint32_t ulLimit = ( ( ulSize - ulOffset ) < ulMaxLength ) ? ( ulSize - ulOffset ) : ulMaxLength;
+
+        for( uint32_t ulDistance = 1; ( ulDistance <= ulWindow ) && ( ulDistance <= ulOffset ); ulDistance++ )
+        {
+            uint32_t ulLength = 0;
+
+            /* Matches may overlap the bytes they produce */
+            while( ( ulLength < ulLimit ) &&
+                   ( ucImage[ ulOffset - ulDistance + ulLength ] == ucImage[ ulOffset + ulLength ] ) )
+            {
+                ulLength++;
+            }
+
+            if( ulLength > ulBestLength )
+            {
+                ulBestLength = ulLength;
+                ulBestDistance = ulDistance;
+            }
+        }
+
+        if( ulBestLength >= ulMinLength )
+        {
+            prvStreamReference( ucWindowLog2, ucLookaheadLog2, ulBestDistance, ulBestLength );
+            ulOffset += ulBestLength;
+        }
+        else
+        {
+            prvStreamLiteral( ucImage[ ulOffset ] );
+            ulOffset++;
+        }
+    }
+
+    prvStreamFinish();
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvHeaderCallback( void * pvCtx,
+                                  const OtaDecompressHeader_t * pxHeader )
+{
+    return lFlashModelImageStart( ( FlashModel_t * ) pvCtx, pxHeader->ulImageSize );
+}
+
+static OtaDecompress_t * prvStart( FlashModel_t * pxFlash )
+{
+    OtaDecompress_t * pxDecompress = malloc( sizeof( OtaDecompress_t ) );
+
+    if( pxDecompress == NULL )
+    {
+        printf( "Out of memory\n" );
+        exit( 1 );
+    }
+
+    vOtaDecompressInit( pxDecompress, prvHeaderCallback, lFlashModelWrite, pxFlash );
+
+    return pxDecompress;
+}
+
+/*
+ * Feed the first ulLength bytes of the stream in chunks of ulChunk bytes, and
+ * keep feeding after an error to check that it is sticky.
+ */
+static OtaDecompressStatus_t prvFeed( OtaDecompress_t * pxDecompress,
+                                      FlashModel_t * pxFlash,
+                                      uint32_t ulStart,
+                                      uint32_t ulEnd,
+                                      uint32_t ulChunk )
+{
+    OtaDecompressStatus_t xStatus = pxDecompress->xStatus;
+
+    for( uint32_t ulOffset = ulStart; ulOffset < ulEnd; ulOffset += ulChunk )
+    {
+        OtaDecompressStatus_t xPrevious = xStatus;
+        uint32_t ulWrites = pxFlash->ulWrites;
+        uint32_t ulSize = ( ( ulEnd - ulOffset ) < ulChunk ) ? ( ulEnd - ulOffset ) : ulChunk;
+
+        xStatus = xOtaDecompressUpdate( pxDecompress, &( xStream.ucData[ ulOffset ] ), ulSize );
+
+        if( xPrevious > OTA_DECOMPRESS_DONE )
+        {
+            CHECK( xStatus == xPrevious );
+            CHECK( pxFlash->ulWrites == ulWrites );
+        }
+    }
+
+    return xStatus;
+}
+
+static OtaDecompressStatus_t prvDecompress( FlashModel_t * pxFlash,
+                                            uint32_t ulLength,
+                                            uint32_t ulChunk )
+{
+    OtaDecompress_t * pxDecompress = prvStart( pxFlash );
+    OtaDecompressStatus_t xStatus = prvFeed( pxDecompress, pxFlash, 0U, ulLength, ulChunk );
+
+    free( pxDecompress );
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The image was written entirely, in order, and nothing else was */
+static int prvImageMatches( const FlashModel_t * pxFlash,
+                            uint32_t ulSize )
+{
+    int lMatches = ( pxFlash->ulMisuse == 0U ) &&
+                   ( pxFlash->ulWritten == ulSize ) &&
+                   ( pxFlash->ulWrites == ( ulSize + OTA_DECOMPRESS_OUT_BUFFER_SIZE - 1U ) / OTA_DECOMPRESS_OUT_BUFFER_SIZE ) &&
+                   ( memcmp( pxFlash->pucBank, ucImage, ulSize ) == 0 );
+
+    for( uint32_t i = ulSize; ( i < pxFlash->ulBankSize ) && lMatches; i++ )
+    {
+        lMatches = ( pxFlash->pucBank[ i ] == 0xFFU );
+    }
+
+    return lMatches;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Images compressed with several windows, fed in chunks of 1 byte up to the whole stream */
+static void prvTestValid( void )
+{
+    static const uint8_t ucParams[][ 2 ] = { { 11U, 4U }, { 8U, 3U }, { 4U, 4U }, { 1U, 1U } };
+    static const uint32_t ulChunks[] = { 1U, 3U, 128U, TEST_OTA_BLOCK, TEST_COMPRESSED_MAX };
+    FlashModel_t xFlash;
+
+    for( uint32_t p = 0; p < sizeof( ucParams ) / sizeof( ucParams[ 0 ] ); p++ )
+    {
+        prvCompress( TEST_IMAGE_SIZE, ucParams[ p ][ 0 ], ucParams[ p ][ 1 ] );
+
+        for( uint32_t i = 0; i < sizeof( ulChunks ) / sizeof( ulChunks[ 0 ] ); i++ )
+        {
+            vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+            CHECK( prvDecompress( &xFlash, xStream.ulLength, ulChunks[ i ] ) == OTA_DECOMPRESS_DONE );
+            CHECK( xFlash.ulImageSize == TEST_IMAGE_SIZE );
+            CHECK( prvImageMatches( &xFlash, TEST_IMAGE_SIZE ) );
+            vFlashModelFree( &xFlash );
+        }
+    }
+
+    /* Images of a single byte and of exactly one output buffer */
+    prvCompress( 1U, 11U, 4U );
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_DONE );
+    CHECK( prvImageMatches( &xFlash, 1U ) );
+    vFlashModelFree( &xFlash );
+
+    prvCompress( OTA_DECOMPRESS_OUT_BUFFER_SIZE, 11U, 4U );
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_DONE );
+    CHECK( prvImageMatches( &xFlash, OTA_DECOMPRESS_OUT_BUFFER_SIZE ) );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The stream split in two at every offset, so that every field of the header
+ * and of the bit stream straddles a boundary, then cut at every offset.
+ */
+static void prvTestSplit( void )
+{
+    FlashModel_t xFlash;
+
+    prvCompress( TEST_IMAGE_SIZE, 11U, 4U );
+
+    for( uint32_t ulSplit = 0; ulSplit <= xStream.ulLength; ulSplit++ )
+    {
+        OtaDecompress_t * pxDecompress;
+
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        pxDecompress = prvStart( &xFlash );
+
+        CHECK( prvFeed( pxDecompress, &xFlash, 0U, ulSplit, TEST_COMPRESSED_MAX ) ==
+               ( ( ulSplit == xStream.ulLength ) ? OTA_DECOMPRESS_DONE : OTA_DECOMPRESS_OK ) );
+
+        /* A cut stream writes only full buffers of the start of the image */
+        CHECK( xFlash.ulMisuse == 0U );
+        CHECK( ( ulSplit == xStream.ulLength ) || ( ( xFlash.ulWritten % OTA_DECOMPRESS_OUT_BUFFER_SIZE ) == 0U ) );
+        CHECK( memcmp( xFlash.pucBank, ucImage, xFlash.ulWritten ) == 0 );
+        CHECK( xFlash.ulStarts == ( ( ulSplit >= OTA_DECOMPRESS_HEADER_SIZE ) ? 1U : 0U ) );
+
+        CHECK( prvFeed( pxDecompress, &xFlash, ulSplit, xStream.ulLength, TEST_COMPRESSED_MAX ) == OTA_DECOMPRESS_DONE );
+        CHECK( prvImageMatches( &xFlash, TEST_IMAGE_SIZE ) );
+
+        free( pxDecompress );
+        vFlashModelFree( &xFlash );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvTestCorrupt( void )
+{
+    /* Header fields: magic, version, window, lookahead and image size */
+    static const struct
+    {
+        uint32_t ulOffset;
+        uint8_t ucValue;
+        OtaDecompressStatus_t xExpected;
+    } xHeaderCases[] =
+    {
+        { 0U,  0x00U,                                       OTA_DECOMPRESS_ERR_FORMAT },
+        { 4U,  OTA_DECOMPRESS_FORMAT_VERSION + 1U,          OTA_DECOMPRESS_ERR_FORMAT },
+        { 5U,  0U,                                          OTA_DECOMPRESS_ERR_FORMAT },
+        { 5U,  OTA_DECOMPRESS_MAX_WINDOW_LOG2 + 1U,         OTA_DECOMPRESS_ERR_HEADER },
+        { 6U,  0U,                                          OTA_DECOMPRESS_ERR_FORMAT },
+        { 6U,  OTA_DECOMPRESS_MAX_WINDOW_LOG2 + 1U,         OTA_DECOMPRESS_ERR_FORMAT },
+    };
+    FlashModel_t xFlash;
+
+    for( uint32_t i = 0; i < sizeof( xHeaderCases ) / sizeof( xHeaderCases[ 0 ] ); i++ )
+    {
+        prvCompress( TEST_IMAGE_SIZE, 11U, 4U );
+        xStream.ucData[ xHeaderCases[ i ].ulOffset ] = xHeaderCases[ i ].ucValue;
+
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == xHeaderCases[ i ].xExpected );
+        CHECK( xFlash.ulStarts == 0U );
+        CHECK( xFlash.ulWrites == 0U );
+        vFlashModelFree( &xFlash );
+    }
+
+    /* An empty image */
+    prvStreamHeader( 11U, 4U, 0U );
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_ERR_FORMAT );
+    CHECK( xFlash.ulStarts == 0U );
+    vFlashModelFree( &xFlash );
+
+    /* Data after the end of the image */
+    prvCompress( TEST_IMAGE_SIZE, 11U, 4U );
+    xStream.ucData[ xStream.ulLength++ ] = 0U;
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_ERR_FORMAT );
+    CHECK( xFlash.ulMisuse == 0U );
+    CHECK( xFlash.ulWritten == TEST_IMAGE_SIZE );
+    vFlashModelFree( &xFlash );
+
+    /* Flipped bits never write outside the image, whatever the status */
+    prvCompress( 3000U, 8U, 4U );
+
+    for( uint32_t i = 0; i < 2000U; i++ )
+    {
+        uint32_t ulBit = ( OTA_DECOMPRESS_HEADER_SIZE * 8U ) + ( prvRandom() % ( ( xStream.ulLength - OTA_DECOMPRESS_HEADER_SIZE ) * 8U ) );
+        uint8_t ucMask = ( uint8_t ) ( 0x80U >> ( ulBit % 8U ) );
+
+        xStream.ucData[ ulBit / 8U ] ^= ucMask;
+
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        ( void ) prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK );
+        CHECK( xFlash.ulMisuse == 0U );
+        CHECK( xFlash.ulWritten <= 3000U );
+        vFlashModelFree( &xFlash );
+
+        xStream.ucData[ ulBit / 8U ] ^= ucMask;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Images which do not fit in the bank, and streams producing more than the image size */
+static void prvTestImageRange( void )
+{
+    FlashModel_t xFlash;
+
+    /* The header announces an image larger than the bank */
+    prvImageGenerate( TEST_BANK_SIZE + 1U );
+    prvCompress( TEST_BANK_SIZE + 1U, 11U, 4U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_ERR_HEADER );
+    CHECK( xFlash.ulStarts == 0U );
+    CHECK( xFlash.ulWrites == 0U );
+    vFlashModelFree( &xFlash );
+
+    /* The same image in a bank large enough */
+    vFlashModelInit( &xFlash, 2U * TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_DONE );
+    CHECK( prvImageMatches( &xFlash, TEST_BANK_SIZE + 1U ) );
+    vFlashModelFree( &xFlash );
+
+    /* A full bank, then a literal past the image size in the same byte */
+    prvImageGenerate( TEST_BANK_SIZE );
+    prvStreamHeader( 11U, 4U, TEST_BANK_SIZE );
+
+    for( uint32_t i = 0; i < TEST_BANK_SIZE; i++ )
+    {
+        prvStreamLiteral( ucImage[ i ] );
+    }
+
+    prvStreamLiteral( 0x55U );
+    prvStreamFinish();
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_ERR_FORMAT );
+    CHECK( xFlash.ulMisuse == 0U );
+    CHECK( prvImageMatches( &xFlash, TEST_BANK_SIZE ) );
+    vFlashModelFree( &xFlash );
+
+    /* A back reference running past the image size */
+    prvStreamHeader( 11U, 4U, TEST_BANK_SIZE );
+
+    for( uint32_t i = 0; i < TEST_BANK_SIZE - 4U; i++ )
+    {
+        prvStreamLiteral( ucImage[ i ] );
+    }
+
+    prvStreamReference( 11U, 4U, 100U, 16U );
+    prvStreamFinish();
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, TEST_OTA_BLOCK ) == OTA_DECOMPRESS_ERR_FORMAT );
+    CHECK( xFlash.ulMisuse == 0U );
+    CHECK( xFlash.ulWritten == TEST_BANK_SIZE );
+    vFlashModelFree( &xFlash );
+
+    /* A flash write failing: the error is sticky and nothing more is written */
+    prvImageGenerate( TEST_IMAGE_SIZE );
+    prvCompress( TEST_IMAGE_SIZE, 11U, 4U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    xFlash.ulFailAtWrite = 3U;
+    CHECK( prvDecompress( &xFlash, xStream.ulLength, 100U ) == OTA_DECOMPRESS_ERR_WRITE );
+    CHECK( xFlash.ulWrites == 3U );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    prvImageGenerate( TEST_IMAGE_SIZE );
+
+    prvTestValid();
+    prvTestSplit();
+    prvTestCorrupt();
+    prvTestImageRange();
+
+    printf( "%lu checks, %lu failures\n", ( unsigned long ) ulChecks, ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0U ) ? 0 : 1;
+}
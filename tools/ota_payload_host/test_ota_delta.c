@@ -0,0 +1,604 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file test_ota_delta.c
+ * @brief Host test of the delta patch decoder of the ntz OTA PAL
+ * (Projects/b_u585i_iot02a_ntz/Src/ota_pal/ota_delta.c), writing into the
+ * flash model of flash_model.c.
+ */
+
+#include "ota_delta.h"
+#include "flash_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t ulFailures = 0;
+static uint32_t ulChecks = 0;
+
+#define CHECK( x )                                                      \
+    do {                                                                \
+        ulChecks++;                                                     \
+        if( !( x ) )                                                    \
+        {                                                               \
+            ulFailures++;                                               \
+            printf( "FAIL %s:%d: %s\n", __FILE__, __LINE__, #x );       \
+        }                                                               \
+    } while( 0 )
+
+#define TEST_BANK_SIZE       ( 32U * 1024U )
+#define TEST_BASE_SIZE       ( 24U * 1024U )
+#define TEST_BASE_VERSION    ( 0x01020003UL )
+#define TEST_OTA_BLOCK       ( 2048U )
+#define TEST_PATCH_MAX       ( 64U * 1024U )
+
+/* A patch being built, and the image it rebuilds from ucBase */
+typedef struct
+{
+    uint8_t ucBody[ TEST_PATCH_MAX ];
+    uint32_t ulBodyLength;
+    uint8_t ucPatch[ TEST_PATCH_MAX ];
+    uint32_t ulPatchLength;
+    uint8_t ucTarget[ TEST_BANK_SIZE * 2U ];
+    uint32_t ulTargetLength;
+    uint32_t ulCursor;
+} TestPatch_t;
+
+static uint8_t ucBase[ TEST_BASE_SIZE ];
+static TestPatch_t xPatch;
+
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( void )
+{
+    static uint32_t ulState = 0x12345678UL;
+
+    ulState ^= ulState << 13;
+    ulState ^= ulState >> 17;
+    ulState ^= ulState << 5;
+
+    return ulState;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPut( const uint8_t * pucData,
+                    uint32_t ulLength )
+{
+    if( ulLength > ( TEST_PATCH_MAX - xPatch.ulBodyLength ) )
+    {
+        printf( "Test patch too long\n" );
+        exit( 1 );
+    }
+
+    ( void ) memcpy( &( xPatch.ucBody[ xPatch.ulBodyLength ] ), pucData, ulLength );
+    xPatch.ulBodyLength += ulLength;
+}
+
+static void prvPutOp( uint8_t ucOpcode,
+                      uint32_t ulArg )
+{
+    prvPut( &ucOpcode, 1U );
+
+    do
+    {
+        uint8_t ucByte = ( uint8_t ) ( ulArg & 0x7FU );
+
+        ulArg >>= 7;
+
+        if( ulArg != 0U )
+        {
+            ucByte |= 0x80U;
+        }
+
+        prvPut( &ucByte, 1U );
+    } while( ulArg != 0U );
+}
+
+/* Expected image bytes, which may run past a bank for the range tests */
+static void prvTarget( uint8_t ucByte )
+{
+    if( xPatch.ulTargetLength < sizeof( xPatch.ucTarget ) )
+    {
+        xPatch.ucTarget[ xPatch.ulTargetLength ] = ucByte;
+    }
+
+    xPatch.ulTargetLength++;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvPatchReset( void )
+{
+    xPatch.ulBodyLength = 0;
+    xPatch.ulPatchLength = 0;
+    xPatch.ulTargetLength = 0;
+    xPatch.ulCursor = 0;
+}
+
+static void prvCopy( uint32_t ulLength )
+{
+    prvPutOp( OTA_DELTA_OP_COPY, ulLength );
+
+    for( uint32_t i = 0; i < ulLength; i++ )
+    {
+        prvTarget( ( xPatch.ulCursor < TEST_BASE_SIZE ) ? ucBase[ xPatch.ulCursor ] : 0U );
+        xPatch.ulCursor++;
+    }
+}
+
+static void prvAdd( uint32_t ulLength )
+{
+    prvPutOp( OTA_DELTA_OP_ADD, ulLength );
+
+    for( uint32_t i = 0; i < ulLength; i++ )
+    {
+        uint8_t ucDiff = ( uint8_t ) ( prvRandom() % 5U );
+
+        prvPut( &ucDiff, 1U );
+        prvTarget( ( uint8_t ) ( ( ( xPatch.ulCursor < TEST_BASE_SIZE ) ? ucBase[ xPatch.ulCursor ] : 0U ) + ucDiff ) );
+        xPatch.ulCursor++;
+    }
+}
+
+static void prvInsert( uint32_t ulLength )
+{
+    prvPutOp( OTA_DELTA_OP_INSERT, ulLength );
+
+    for( uint32_t i = 0; i < ulLength; i++ )
+    {
+        uint8_t ucByte = ( uint8_t ) prvRandom();
+
+        prvPut( &ucByte, 1U );
+        prvTarget( ucByte );
+    }
+}
+
+static void prvSeek( int32_t lDelta )
+{
+    uint32_t ulZigzag = ( lDelta >= 0 ) ? ( ( uint32_t ) lDelta << 1 ) : ( ( ( uint32_t ) -lDelta << 1 ) - 1U );
+
+    prvPutOp( OTA_DELTA_OP_SEEK, ulZigzag );
+    xPatch.ulCursor = ( uint32_t ) ( ( int32_t ) xPatch.ulCursor + lDelta );
+}
+
+/*
+ * Serialize the header, the operations and OTA_DELTA_OP_END. The header sizes
+ * are those of the operations unless overridden by non zero arguments.
+ */
+static void prvPatchFinish( uint32_t ulBaseSize,
+                            uint32_t ulTargetSize )
+{
+    uint8_t * pucHeader = xPatch.ucPatch;
+    uint32_t ulFields[ 5 ] =
+    {
+        OTA_DELTA_MAGIC,
+        OTA_DELTA_FORMAT_VERSION,
+        TEST_BASE_VERSION,
+        ( ulBaseSize != 0U ) ? ulBaseSize : TEST_BASE_SIZE,
+        ( ulTargetSize != 0U ) ? ulTargetSize : xPatch.ulTargetLength
+    };
+
+    for( uint32_t i = 0; i < 5U; i++ )
+    {
+        pucHeader[ ( 4U * i ) ] = ( uint8_t ) ulFields[ i ];
+        pucHeader[ ( 4U * i ) + 1U ] = ( uint8_t ) ( ulFields[ i ] >> 8 );
+        pucHeader[ ( 4U * i ) + 2U ] = ( uint8_t ) ( ulFields[ i ] >> 16 );
+        pucHeader[ ( 4U * i ) + 3U ] = ( uint8_t ) ( ulFields[ i ] >> 24 );
+    }
+
+    /* Format version and reserved bytes */
+    pucHeader[ 5 ] = 0U;
+    pucHeader[ 6 ] = 0U;
+    pucHeader[ 7 ] = 0U;
+
+    /* The PAL checks the hash of the base, which the decoder only passes on */
+    ( void ) memset( &pucHeader[ 20 ], 0xA5, OTA_DELTA_HASH_SIZE );
+
+    ( void ) memcpy( &( xPatch.ucPatch[ OTA_DELTA_HEADER_SIZE ] ), xPatch.ucBody, xPatch.ulBodyLength );
+    xPatch.ulPatchLength = OTA_DELTA_HEADER_SIZE + xPatch.ulBodyLength;
+    xPatch.ucPatch[ xPatch.ulPatchLength++ ] = OTA_DELTA_OP_END;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Check the base version and the image size, as prvDeltaHeaderCallback of the PAL */
+static int32_t prvHeaderCallback( void * pvCtx,
+                                  const OtaDeltaHeader_t * pxHeader )
+{
+    int32_t lResult = -1;
+    uint8_t ucHash[ OTA_DELTA_HASH_SIZE ];
+
+    ( void ) memset( ucHash, 0xA5, sizeof( ucHash ) );
+
+    if( ( pxHeader->ulBaseVersion == TEST_BASE_VERSION ) &&
+        ( memcmp( pxHeader->ucBaseHash, ucHash, OTA_DELTA_HASH_SIZE ) == 0 ) )
+    {
+        lResult = lFlashModelImageStart( ( FlashModel_t * ) pvCtx, pxHeader->ulTargetSize );
+    }
+
+    return lResult;
+}
+
+/*
+ * Feed the first ulLength bytes of the patch in chunks of ulChunk bytes, and
+ * keep feeding after an error to check that it is sticky.
+ */
+static OtaDeltaStatus_t prvApply( FlashModel_t * pxFlash,
+                                  uint32_t ulLength,
+                                  uint32_t ulChunk )
+{
+    OtaDelta_t * pxDelta = malloc( sizeof( OtaDelta_t ) );
+    OtaDeltaStatus_t xStatus = OTA_DELTA_OK;
+    OtaDeltaStatus_t xFirstError = OTA_DELTA_OK;
+
+    if( pxDelta == NULL )
+    {
+        printf( "Out of memory\n" );
+        exit( 1 );
+    }
+
+    vOtaDeltaInit( pxDelta, ucBase, TEST_BASE_SIZE, prvHeaderCallback, lFlashModelWrite, pxFlash );
+
+    for( uint32_t ulOffset = 0; ulOffset < ulLength; ulOffset += ulChunk )
+    {
+        uint32_t ulWrites = pxFlash->ulWrites;
+        uint32_t ulSize = ( ( ulLength - ulOffset ) < ulChunk ) ? ( ulLength - ulOffset ) : ulChunk;
+
+        xStatus = xOtaDeltaUpdate( pxDelta, &( xPatch.ucPatch[ ulOffset ] ), ulSize );
+
+        if( ( xFirstError == OTA_DELTA_OK ) && ( xStatus > OTA_DELTA_DONE ) )
+        {
+            xFirstError = xStatus;
+        }
+        else if( xFirstError != OTA_DELTA_OK )
+        {
+            CHECK( xStatus == xFirstError );
+            CHECK( pxFlash->ulWrites == ulWrites );
+        }
+    }
+
+    free( pxDelta );
+
+    return xStatus;
+}
+
+/*-----------------------------------------------------------*/
+
+/* The image was written entirely, in order, and nothing else was */
+static int prvImageMatches( const FlashModel_t * pxFlash )
+{
+    int lMatches = ( pxFlash->ulMisuse == 0U ) &&
+                   ( pxFlash->ulWritten == xPatch.ulTargetLength ) &&
+                   ( pxFlash->ulWrites == ( xPatch.ulTargetLength + OTA_DELTA_OUT_BUFFER_SIZE - 1U ) / OTA_DELTA_OUT_BUFFER_SIZE ) &&
+                   ( memcmp( pxFlash->pucBank, xPatch.ucTarget, xPatch.ulTargetLength ) == 0 );
+
+    for( uint32_t i = xPatch.ulTargetLength; ( i < pxFlash->ulBankSize ) && lMatches; i++ )
+    {
+        lMatches = ( pxFlash->pucBank[ i ] == 0xFFU );
+    }
+
+    return lMatches;
+}
+
+/*-----------------------------------------------------------*/
+
+/* A patch using every operation, with varints of one to three bytes */
+static void prvBuildValidPatch( void )
+{
+    prvPatchReset();
+    prvCopy( 3000U );
+    prvAdd( 700U );
+    prvInsert( 301U );
+    prvSeek( -2500 );
+    prvCopy( 17000U );
+    prvSeek( 1200 );
+    prvAdd( 90U );
+    prvInsert( 5U );
+    prvCopy( 100U );
+    prvPatchFinish( 0U, 0U );
+}
+
+static void prvTestValid( void )
+{
+    static const uint32_t ulChunks[] = { 1U, 3U, 16U, 127U, OTA_DELTA_OUT_BUFFER_SIZE, TEST_OTA_BLOCK, TEST_PATCH_MAX };
+    FlashModel_t xFlash;
+
+    prvBuildValidPatch();
+
+    /* Not a multiple of the output buffer, so that the last write is short */
+    CHECK( ( xPatch.ulTargetLength % OTA_DELTA_OUT_BUFFER_SIZE ) != 0U );
+    CHECK( xPatch.ulTargetLength <= TEST_BANK_SIZE );
+
+    for( uint32_t i = 0; i < sizeof( ulChunks ) / sizeof( ulChunks[ 0 ] ); i++ )
+    {
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        CHECK( prvApply( &xFlash, xPatch.ulPatchLength, ulChunks[ i ] ) == OTA_DELTA_DONE );
+        CHECK( xFlash.ulImageSize == xPatch.ulTargetLength );
+        CHECK( prvImageMatches( &xFlash ) );
+        vFlashModelFree( &xFlash );
+    }
+
+    /* An image of inserted bytes only, which does not read the base */
+    prvPatchReset();
+    prvInsert( 1000U );
+    prvPatchFinish( 0U, 0U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_DONE );
+    CHECK( prvImageMatches( &xFlash ) );
+    vFlashModelFree( &xFlash );
+
+    /* The image is a copy of the base */
+    prvPatchReset();
+    prvCopy( TEST_BASE_SIZE );
+    prvPatchFinish( 0U, 0U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_DONE );
+    CHECK( prvImageMatches( &xFlash ) );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+/* A patch cut anywhere is never complete, and writes only the start of the image */
+static void prvTestTruncated( void )
+{
+    FlashModel_t xFlash;
+
+    prvBuildValidPatch();
+
+    for( uint32_t ulLength = 0; ulLength < xPatch.ulPatchLength; ulLength++ )
+    {
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+
+        CHECK( prvApply( &xFlash, ulLength, TEST_OTA_BLOCK ) == OTA_DELTA_OK );
+        CHECK( xFlash.ulMisuse == 0U );
+        CHECK( ( xFlash.ulWritten % OTA_DELTA_OUT_BUFFER_SIZE ) == 0U );
+        CHECK( xFlash.ulWritten < xPatch.ulTargetLength );
+        CHECK( memcmp( xFlash.pucBank, xPatch.ucTarget, xFlash.ulWritten ) == 0 );
+        CHECK( xFlash.ulStarts == ( ( ulLength >= OTA_DELTA_HEADER_SIZE ) ? 1U : 0U ) );
+
+        vFlashModelFree( &xFlash );
+    }
+
+    /* The end of the patch before the end of the image */
+    prvPatchReset();
+    prvCopy( 1000U );
+    prvPatchFinish( 0U, 1001U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_FORMAT );
+    vFlashModelFree( &xFlash );
+
+    /* Data after the end of the patch */
+    prvPatchReset();
+    prvCopy( 1000U );
+    prvPatchFinish( 0U, 0U );
+    xPatch.ucPatch[ xPatch.ulPatchLength++ ] = OTA_DELTA_OP_END;
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_FORMAT );
+    vFlashModelFree( &xFlash );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, 1U ) == OTA_DELTA_ERR_FORMAT );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Patches which are not valid patches */
+static void prvTestCorrupt( void )
+{
+    FlashModel_t xFlash;
+
+    /* Magic, format version, base version, unknown opcode */
+    static const uint32_t ulCorruptOffsets[] = { 0U, 4U, 8U, OTA_DELTA_HEADER_SIZE };
+    static const OtaDeltaStatus_t xExpected[] = { OTA_DELTA_ERR_FORMAT, OTA_DELTA_ERR_FORMAT, OTA_DELTA_ERR_BASE, OTA_DELTA_ERR_FORMAT };
+
+    for( uint32_t i = 0; i < sizeof( ulCorruptOffsets ) / sizeof( ulCorruptOffsets[ 0 ] ); i++ )
+    {
+        prvBuildValidPatch();
+        xPatch.ucPatch[ ulCorruptOffsets[ i ] ] = 0x7EU;
+
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == xExpected[ i ] );
+        CHECK( xFlash.ulWrites == 0U );
+        vFlashModelFree( &xFlash );
+    }
+
+    /* Varints longer than 32 bits */
+    prvPatchReset();
+    prvPut( ( const uint8_t[] ) { OTA_DELTA_OP_INSERT, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F }, 6U );
+    prvPatchFinish( 0U, 100U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_FORMAT );
+    vFlashModelFree( &xFlash );
+
+    prvPatchReset();
+    prvPut( ( const uint8_t[] ) { OTA_DELTA_OP_INSERT, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 }, 7U );
+    prvPatchFinish( 0U, 100U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_FORMAT );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Operations reading outside the base image */
+static void prvTestBaseRange( void )
+{
+    FlashModel_t xFlash;
+    uint32_t ulCase;
+
+    for( ulCase = 0; ulCase < 6U; ulCase++ )
+    {
+        prvPatchReset();
+
+        switch( ulCase )
+        {
+            case 0:
+                /* COPY past the end of the base */
+                prvSeek( ( int32_t ) TEST_BASE_SIZE - 10 );
+                prvCopy( 11U );
+                break;
+
+            case 1:
+                /* ADD past the end of the base */
+                prvCopy( TEST_BASE_SIZE - 5U );
+                prvAdd( 6U );
+                break;
+
+            case 2:
+                /* SEEK before the start of the base */
+                prvCopy( 100U );
+                prvSeek( -101 );
+                prvCopy( 1U );
+                break;
+
+            case 3:
+                /* SEEK past the end of the base */
+                prvSeek( ( int32_t ) TEST_BASE_SIZE + 1 );
+                prvInsert( 1U );
+                break;
+
+            case 4:
+                /* COPY with a length which wraps the base offset around */
+                prvSeek( 16 );
+                prvPutOp( OTA_DELTA_OP_COPY, 0xFFFFFFF8UL );
+                break;
+
+            default:
+                /* SEEK by a delta which wraps the base offset around */
+                prvSeek( 16 );
+                prvPutOp( OTA_DELTA_OP_SEEK, 0xFFFFFFFEUL );
+                prvCopy( 1U );
+                break;
+        }
+
+        prvPatchFinish( 0U, 64U );
+
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_RANGE );
+        CHECK( xFlash.ulMisuse == 0U );
+        vFlashModelFree( &xFlash );
+    }
+
+    /* A base larger than the bank read by the decoder */
+    prvBuildValidPatch();
+    prvPatchFinish( TEST_BASE_SIZE + 1U, xPatch.ulTargetLength );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_BASE );
+    CHECK( xFlash.ulStarts == 0U );
+    CHECK( xFlash.ulWrites == 0U );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+/* Images which do not fit in the bank, or longer than the header says */
+static void prvTestTargetRange( void )
+{
+    FlashModel_t xFlash;
+
+    /* The header announces an image larger than the bank */
+    prvPatchReset();
+    prvCopy( TEST_BASE_SIZE );
+    prvInsert( TEST_BANK_SIZE - TEST_BASE_SIZE + 1U );
+    prvPatchFinish( 0U, 0U );
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_BASE );
+    CHECK( xFlash.ulStarts == 0U );
+    CHECK( xFlash.ulWrites == 0U );
+    vFlashModelFree( &xFlash );
+
+    /* The same image in a bank large enough */
+    vFlashModelInit( &xFlash, 2U * TEST_BANK_SIZE );
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_DONE );
+    CHECK( prvImageMatches( &xFlash ) );
+    vFlashModelFree( &xFlash );
+
+    /* Operations producing more than the image announced by the header, which fits the bank */
+    for( uint32_t ulCase = 0; ulCase < 3U; ulCase++ )
+    {
+        prvPatchReset();
+        prvCopy( TEST_BANK_SIZE / 2U );
+
+        if( ulCase == 0U )
+        {
+            prvCopy( 1U );
+        }
+        else if( ulCase == 1U )
+        {
+            prvAdd( 1U );
+        }
+        else
+        {
+            prvInsert( 1U );
+        }
+
+        prvPatchFinish( 0U, TEST_BANK_SIZE / 2U );
+
+        vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+        CHECK( prvApply( &xFlash, xPatch.ulPatchLength, TEST_OTA_BLOCK ) == OTA_DELTA_ERR_RANGE );
+        CHECK( xFlash.ulMisuse == 0U );
+        CHECK( xFlash.ulWritten <= ( TEST_BANK_SIZE / 2U ) );
+        vFlashModelFree( &xFlash );
+    }
+
+    /* A flash write failing: the error is sticky and nothing more is written */
+    prvBuildValidPatch();
+
+    vFlashModelInit( &xFlash, TEST_BANK_SIZE );
+    xFlash.ulFailAtWrite = 3U;
+    CHECK( prvApply( &xFlash, xPatch.ulPatchLength, 100U ) == OTA_DELTA_ERR_WRITE );
+    CHECK( xFlash.ulWrites == 3U );
+    vFlashModelFree( &xFlash );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    for( uint32_t i = 0; i < TEST_BASE_SIZE; i++ )
+    {
+        ucBase[ i ] = ( uint8_t ) prvRandom();
+    }
+
+    prvTestValid();
+    prvTestTruncated();
+    prvTestCorrupt();
+    prvTestBaseRange();
+    prvTestTargetRange();
+
+    printf( "%lu checks, %lu failures\n", ( unsigned long ) ulChecks, ( unsigned long ) ulFailures );
+
+    return ( ulFailures == 0U ) ? 0 : 1;
+}
@@ -0,0 +1,340 @@
+#!python
+#
+#  FreeRTOS STM32 Reference Integration
+#
+#  Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy of
+#  this software and associated documentation files (the "Software"), to deal in
+#  the Software without restriction, including without limitation the rights to
+#  use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+#  the Software, and to permit persons to whom the Software is furnished to do so,
+#  subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+#  FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+#  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+#  IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+#  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+#  https://www.FreeRTOS.org
+#  https://github.com/FreeRTOS
+#
+#
+"""TLS transport benchmark.
+
+Runs a local TLS server with a freshly generated CA and server certificate for
+each key type, provisions the CA certificate to the target and runs the
+tlsbench cli command against the server. Results are written as JSON.
+
+tools/tls_bench_host runs the same benchmark client on the host, without a
+target, against a loopback server.
+"""
+import argparse
+import datetime
+import ipaddress
+import json
+import logging
+import os
+import socketserver
+import ssl
+import tempfile
+import threading
+
+from cryptography import x509
+from cryptography.hazmat.primitives import hashes, serialization
+from cryptography.hazmat.primitives.asymmetric import ec, rsa
+from cryptography.x509.oid import NameOID
+
+from provision import TargetDevice, find_serial_port
+
+logger = logging.getLogger()
+
+KEY_TYPES = {
+    "ec_p256": lambda: ec.generate_private_key(ec.SECP256R1()),
+    "ec_p384": lambda: ec.generate_private_key(ec.SECP384R1()),
+    "rsa_2048": lambda: rsa.generate_private_key(public_exponent=65537, key_size=2048),
+}
+
+CHUNK_SIZE = 4096
+
+
+def _build_cert(subject_cn, public_key, issuer_cn, issuer_key, is_ca, san_ip=None):
+    """Build and sign an x509 certificate."""
+    now = datetime.datetime.utcnow()
+    builder = (
+        x509.CertificateBuilder()
+        .subject_name(x509.Name([x509.NameAttribute(NameOID.COMMON_NAME, subject_cn)]))
+        .issuer_name(x509.Name([x509.NameAttribute(NameOID.COMMON_NAME, issuer_cn)]))
+        .public_key(public_key)
+        .serial_number(x509.random_serial_number())
+        .not_valid_before(now - datetime.timedelta(days=1))
+        .not_valid_after(now + datetime.timedelta(days=30))
+        .add_extension(x509.BasicConstraints(ca=is_ca, path_length=None), critical=True)
+    )
+
+    # The address is included as a dNSName as well, since older mbedtls
+    # releases only match the hostname against dNSName entries.
+    if san_ip:
+        builder = builder.add_extension(
+            x509.SubjectAlternativeName(
+                [x509.DNSName(san_ip), x509.IPAddress(ipaddress.ip_address(san_ip))]
+            ),
+            critical=False,
+        )
+
+    return builder.sign(issuer_key, hashes.SHA256())
+
+
+def _pem(obj):
+    if isinstance(obj, x509.Certificate):
+        return obj.public_bytes(serialization.Encoding.PEM)
+    return obj.private_bytes(
+        serialization.Encoding.PEM,
+        serialization.PrivateFormat.PKCS8,
+        serialization.NoEncryption(),
+    )
+
+
+def _recv_exact(conn, length):
+    remaining = length
+    while remaining > 0:
+        data = conn.recv(min(remaining, CHUNK_SIZE))
+        if not data:
+            raise ConnectionError("Connection closed by peer")
+        remaining -= len(data)
+
+
+def _recv_line(conn):
+    line = bytearray()
+    while not line.endswith(b"\n"):
+        data = conn.recv(1)
+        if not data:
+            return None
+        line += data
+    return bytes(line)
+
+
+class BenchRequestHandler(socketserver.BaseRequestHandler):
+    """Implements the request protocol documented in Common/include/tls_bench.h"""
+
+    def handle(self):
+        try:
+            conn = self.server.ssl_ctx.wrap_socket(self.request, server_side=True)
+        except (ssl.SSLError, OSError) as e:
+            logging.error("Handshake failed: {}".format(e))
+            return
+
+        try:
+            while True:
+                line = _recv_line(conn)
+                if not line:
+                    break
+
+                request, arg1, arg2 = line.decode("ascii").split()
+                arg1 = int(arg1)
+                arg2 = int(arg2)
+                logging.debug("Request: {} {} {}".format(request, arg1, arg2))
+
+                if request == "S":
+                    _recv_exact(conn, arg1)
+                    conn.sendall(b"K\n")
+                elif request == "E":
+                    payload = bytes(CHUNK_SIZE)
+                    remaining = arg1
+                    while remaining > 0:
+                        sent = conn.send(payload[: min(remaining, CHUNK_SIZE)])
+                        remaining -= sent
+                elif request == "P":
+                    for _ in range(arg2):
+                        data = bytearray()
+                        while len(data) < arg1:
+                            chunk = conn.recv(arg1 - len(data))
+                            if not chunk:
+                                raise ConnectionError("Connection closed by peer")
+                            data += chunk
+                        conn.sendall(data)
+                else:
+                    logging.error("Unknown request: {}".format(line))
+                    break
+        except (ssl.SSLError, OSError, ValueError) as e:
+            logging.error("Connection error: {}".format(e))
+        finally:
+            conn.close()
+
+
+class BenchServer(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+    def __init__(self, port, ssl_ctx):
+        self.ssl_ctx = ssl_ctx
+        super().__init__(("0.0.0.0", port), BenchRequestHandler)
+
+
+def make_server_context(tmpdir, key_type, ca_cert, ca_key, server_ip, client_cert_pem):
+    """Create an SSLContext for a server certificate of the given key type."""
+    server_key = KEY_TYPES[key_type]()
+    server_cert = _build_cert(
+        server_ip, server_key.public_key(), "tls_bench_ca", ca_key, False, server_ip
+    )
+
+    cert_path = os.path.join(tmpdir, "{}_cert.pem".format(key_type))
+    key_path = os.path.join(tmpdir, "{}_key.pem".format(key_type))
+
+    with open(cert_path, "wb") as f:
+        f.write(_pem(server_cert) + _pem(ca_cert))
+
+    with open(key_path, "wb") as f:
+        f.write(_pem(server_key))
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(cert_path, key_path)
+
+    # Request the device certificate when it can be validated locally so that
+    # the handshake includes a client signature, as it does with AWS IoT Core.
+    if client_cert_pem:
+        ctx.load_verify_locations(cadata=client_cert_pem.decode("ascii"))
+        ctx.verify_mode = ssl.CERT_REQUIRED
+
+    return ctx
+
+
+def run_tlsbench(target, host, port, handshakes, bulk_bytes, ca_label, timeout):
+    """Run the tlsbench command on the target and return the parsed result lines."""
+    args = [b"tlsbench", bytes(host, "ascii"), bytes(str(port), "ascii")]
+    args += [bytes(str(handshakes), "ascii"), bytes(str(bulk_bytes), "ascii")]
+    args += [bytes(ca_label, "ascii")]
+
+    target._send_cmd(*args)
+    response = target._read_response(timeout=timeout)
+
+    results = []
+    for line in response:
+        line = line.strip()
+        if line.startswith(b"{"):
+            results.append(json.loads(line))
+    return results
+
+
+def get_device_cert(target):
+    """Return the device certificate if it is self signed, otherwise None."""
+    target._send_cmd(b"pki export cert")
+    cert_pem = target._read_pem()
+    cert = x509.load_pem_x509_certificate(cert_pem)
+
+    if cert.issuer != cert.subject:
+        logging.warning(
+            "Device certificate is not self signed. Client authentication will not be benchmarked."
+        )
+        return None
+    return cert_pem
+
+
+def process_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument(
+        "--host", required=True, help="Address of this machine as seen by the target."
+    )
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--device", type=str)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument(
+        "--key-types",
+        default="ec_p256,rsa_2048",
+        help="Comma separated list of server key types: {}".format(", ".join(KEY_TYPES)),
+    )
+    parser.add_argument("--handshakes", type=int, default=5)
+    parser.add_argument("--bulk-bytes", type=int, default=64 * 1024)
+    parser.add_argument(
+        "--ca-label",
+        default="bench_ca_cert",
+        help="pki label to store the benchmark CA certificate in.",
+    )
+    parser.add_argument("--timeout", type=float, default=600.0)
+    parser.add_argument("--output", default="tls_bench_results.json")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    return parser.parse_args()
+
+
+def main():
+    args = process_args()
+
+    if args.verbose:
+        logger.setLevel(logging.DEBUG)
+    else:
+        logger.setLevel(logging.INFO)
+
+    key_types = args.key_types.split(",")
+    for key_type in key_types:
+        if key_type not in KEY_TYPES:
+            raise SystemExit("Unknown key type: {}".format(key_type))
+
+    devpath = args.device if args.device else find_serial_port()
+    target = TargetDevice(devpath, args.baud)
+
+    ca_key = ec.generate_private_key(ec.SECP256R1())
+    ca_cert = _build_cert("tls_bench_ca", ca_key.public_key(), "tls_bench_ca", ca_key, True)
+
+    logging.info("Importing benchmark CA certificate to label {}".format(args.ca_label))
+    target.write_cert(_pem(ca_cert), label=args.ca_label)
+
+    client_cert_pem = get_device_cert(target)
+
+    report = {
+        "timestamp": datetime.datetime.utcnow().isoformat() + "Z",
+        "device": devpath,
+        "handshakes": args.handshakes,
+        "bulk_bytes": args.bulk_bytes,
+        "client_auth": client_cert_pem is not None,
+        "runs": [],
+    }
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for key_type in key_types:
+            ssl_ctx = make_server_context(
+                tmpdir, key_type, ca_cert, ca_key, args.host, client_cert_pem
+            )
+            server = BenchServer(args.port, ssl_ctx)
+            thread = threading.Thread(target=server.serve_forever, daemon=True)
+            thread.start()
+
+            logging.info("Running benchmark with {} server key".format(key_type))
+            try:
+                results = run_tlsbench(
+                    target,
+                    args.host,
+                    args.port,
+                    args.handshakes,
+                    args.bulk_bytes,
+                    args.ca_label,
+                    args.timeout,
+                )
+                status = "ok" if any(r.get("test") == "done" for r in results) else "failed"
+            except (TargetDevice.TargetError, TargetDevice.ResponseTimeout) as e:
+                logging.error("Benchmark failed: {}".format(repr(e)))
+                results = []
+                status = "failed"
+            finally:
+                server.shutdown()
+                server.server_close()
+
+            report["runs"].append(
+                {"key_type": key_type, "status": status, "results": results}
+            )
+
+    with open(args.output, "w") as f:
+        json.dump(report, f, indent=2)
+
+    logging.info("Results written to {}".format(args.output))
+
+    if any(run["status"] != "ok" for run in report["runs"]):
+        raise SystemExit(1)
+
+
+if __name__ == "__main__":
+    main()
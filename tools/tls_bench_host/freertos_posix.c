@@ -0,0 +1,215 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file freertos_posix.c
+ * @brief POSIX implementation of the kernel, logging and socket shims used by
+ * the host build of the TLS transport.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "logging.h"
+#include "tls_transport_config.h"
+
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+
+/* Notional heap size against which xPortGetFreeHeapSize reports the bytes in use. */
+#define POSIX_HEAP_SIZE    ( 64U * 1024U * 1024U )
+
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+#if defined( __GLIBC__ ) && ( ( __GLIBC__ > 2 ) || ( __GLIBC_MINOR__ >= 33 ) )
+    struct mallinfo2 xInfo = mallinfo2();
+    size_t uxUsed = xInfo.uordblks;
+#else
+    struct mallinfo xInfo = mallinfo();
+    size_t uxUsed = ( size_t ) xInfo.uordblks;
+#endif
+
+    return ( uxUsed < POSIX_HEAP_SIZE ) ? ( POSIX_HEAP_SIZE - uxUsed ) : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void )
+{
+    static struct timespec xStart = { 0 };
+    struct timespec xNow;
+
+    ( void ) clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    if( ( xStart.tv_sec == 0 ) && ( xStart.tv_nsec == 0 ) )
+    {
+        xStart = xNow;
+    }
+
+    return ( TickType_t ) ( ( ( xNow.tv_sec - xStart.tv_sec ) * 1000LL ) +
+                            ( ( xNow.tv_nsec - xStart.tv_nsec ) / 1000000LL ) );
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelay( const TickType_t xTicksToDelay )
+{
+    uint32_t ulMs = pdTICKS_TO_MS( xTicksToDelay );
+    struct timespec xDelay =
+    {
+        .tv_sec  = ulMs / 1000U,
+        .tv_nsec = ( long ) ( ulMs % 1000U ) * 1000000L
+    };
+
+    ( void ) nanosleep( &xDelay, NULL );
+}
+
+/*-----------------------------------------------------------*/
+
+TaskHandle_t xTaskCreateStatic( TaskFunction_t pxTaskCode,
+                                const char * const pcName,
+                                const uint32_t ulStackDepth,
+                                void * const pvParameters,
+                                UBaseType_t uxPriority,
+                                StackType_t * const puxStackBuffer,
+                                StaticTask_t * const pxTaskBuffer )
+{
+    ( void ) pxTaskCode;
+    ( void ) ulStackDepth;
+    ( void ) pvParameters;
+    ( void ) uxPriority;
+    ( void ) puxStackBuffer;
+    ( void ) pxTaskBuffer;
+
+    LogWarn( "Task %s not created: tasks are not supported on the host.", pcName );
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskDelete( TaskHandle_t xTaskToDelete )
+{
+    ( void ) xTaskToDelete;
+}
+
+/*-----------------------------------------------------------*/
+
+eTaskState eTaskGetState( TaskHandle_t xTask )
+{
+    ( void ) xTask;
+
+    return eDeleted;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskNotify( TaskHandle_t xTaskToNotify,
+                        uint32_t ulValue,
+                        eNotifyAction eAction )
+{
+    ( void ) xTaskToNotify;
+    ( void ) ulValue;
+    ( void ) eAction;
+
+    return pdFAIL;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskNotifyWait( uint32_t ulBitsToClearOnEntry,
+                            uint32_t ulBitsToClearOnExit,
+                            uint32_t * pulNotificationValue,
+                            TickType_t xTicksToWait )
+{
+    ( void ) ulBitsToClearOnEntry;
+    ( void ) ulBitsToClearOnExit;
+    ( void ) pulNotificationValue;
+    ( void ) xTicksToWait;
+
+    return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xTaskNotifyStateClear( TaskHandle_t xTask )
+{
+    ( void ) xTask;
+
+    return pdFALSE;
+}
+
+/*-----------------------------------------------------------*/
+
+void vLoggingPrintf( const char * const pcLogLevel,
+                     const char * const pcFunctionName,
+                     const unsigned long ulLineNumber,
+                     const char * const pcFormat,
+                     ... )
+{
+    va_list xArgs;
+
+    ( void ) fprintf( stderr, "<%s> %lu %s:%lu ", pcLogLevel,
+                      ( unsigned long ) xTaskGetTickCount(), pcFunctionName, ulLineNumber );
+
+    va_start( xArgs, pcFormat );
+    ( void ) vfprintf( stderr, pcFormat, xArgs );
+    va_end( xArgs );
+
+    ( void ) fputc( '\n', stderr );
+}
+
+/*-----------------------------------------------------------*/
+
+int lPosixSetSockOpt( SockHandle_t xSockHandle,
+                      int lLevel,
+                      int lOptName,
+                      const void * pvOptVal,
+                      uint32_t ulOptLen )
+{
+    int lError;
+
+    if( ( lLevel == SOL_SOCKET ) &&
+        ( ( lOptName == SO_RCVTIMEO ) || ( lOptName == SO_SNDTIMEO ) ) &&
+        ( ulOptLen == sizeof( uint32_t ) ) )
+    {
+        uint32_t ulTimeoutMs = *( ( const uint32_t * ) pvOptVal );
+        struct timeval xTimeout =
+        {
+            .tv_sec  = ulTimeoutMs / 1000U,
+            .tv_usec = ( suseconds_t ) ( ulTimeoutMs % 1000U ) * 1000
+        };
+
+        lError = setsockopt( xSockHandle, lLevel, lOptName, &xTimeout, sizeof( xTimeout ) );
+    }
+    else
+    {
+        lError = setsockopt( xSockHandle, lLevel, lOptName, pvOptVal, ( socklen_t ) ulOptLen );
+    }
+
+    return lError;
+}
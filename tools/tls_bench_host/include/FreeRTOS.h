@@ -0,0 +1,62 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file FreeRTOS.h
+ * @brief Subset of the FreeRTOS kernel API used by the TLS transport, implemented on POSIX.
+ */
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef long             BaseType_t;
+typedef unsigned long    UBaseType_t;
+typedef uint32_t         TickType_t;
+typedef uint32_t         StackType_t;
+
+#define pdFALSE               ( ( BaseType_t ) 0 )
+#define pdTRUE                ( ( BaseType_t ) 1 )
+#define pdPASS                ( pdTRUE )
+#define pdFAIL                ( pdFALSE )
+
+#define configTICK_RATE_HZ    ( ( TickType_t ) 1000 )
+#define portTICK_PERIOD_MS    ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portMAX_DELAY         ( ( TickType_t ) 0xFFFFFFFFUL )
+
+#define pdMS_TO_TICKS( xTimeInMs )       ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInMs ) * ( uint64_t ) configTICK_RATE_HZ ) / ( uint64_t ) 1000U ) )
+#define pdTICKS_TO_MS( xTimeInTicks )    ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInTicks ) * ( uint64_t ) 1000U ) / ( uint64_t ) configTICK_RATE_HZ ) )
+
+#define configASSERT( x )             assert( x )
+#define configASSERT_CONTINUE( x )    ( ( void ) ( x ) )
+
+#define pvPortMalloc( xSize )         malloc( xSize )
+#define vPortFree( pv )               free( pv )
+
+/* Bytes of heap not in use by the process, relative to an arbitrary heap size. */
+size_t xPortGetFreeHeapSize( void );
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,67 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tls_transport_config.h
+ * @brief Host configuration of mbedtls_transport, with sockets provided by POSIX instead of lwIP.
+ *
+ * Credentials are passed to the transport as PEM buffers, so neither the
+ * PKCS#11 nor the PSA key store is enabled.
+ */
+
+#ifndef TLS_TRANSPORT_CONFIG
+#define TLS_TRANSPORT_CONFIG
+
+#include <stdint.h>
+
+#define TRANSPORT_USE_CTR_DRBG          1
+
+#define TLS_TRANSPORT_WRITEV_ENABLED    0
+
+#define configTLS_MAX_LABEL_LEN         32
+
+/*
+ * POSIX socket shim
+ */
+typedef int SockHandle_t;
+
+/* lwIP takes SO_RCVTIMEO and SO_SNDTIMEO as uint32_t milliseconds (LWIP_SO_SNDRCVTIMEO_NONSTANDARD). */
+int lPosixSetSockOpt( SockHandle_t xSockHandle,
+                      int lLevel,
+                      int lOptName,
+                      const void * pvOptVal,
+                      uint32_t ulOptLen );
+
+#define sock_socket                        socket
+#define sock_connect                       connect
+#define sock_send( s, buf, len, flags )    send( s, buf, len, ( flags ) | MSG_NOSIGNAL )
+#define sock_recv                          recv
+#define sock_close                         close
+#define sock_setsockopt                    lPosixSetSockOpt
+#define sock_getsockopt                    getsockopt
+#define sock_fcntl                         fcntl
+#define sock_select                        select
+
+#define dns_getaddrinfo                    getaddrinfo
+#define dns_freeaddrinfo                   freeaddrinfo
+
+#endif /* TLS_TRANSPORT_CONFIG */
@@ -0,0 +1,458 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tls_bench_host.c
+ * @brief Host benchmark of mbedtls_transport over loopback.
+ *
+ * For each key type, a CA, a server certificate and a device certificate are
+ * generated. A forked child process serves the benchmark protocol with the
+ * server credentials while this process runs the tls_bench.c client over the
+ * real mbedtls_transport with the device credentials. The server runs in a
+ * separate process so that the session heap reported by the transport only
+ * accounts for the client.
+ *
+ * Each result is written to stdout as one JSON object per line, tagged with the
+ * key type.
+ */
+
+#include "logging_levels.h"
+
+#define LOG_LEVEL    LOG_ERROR
+
+#include "logging.h"
+
+#include "FreeRTOS.h"
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/x509_crt.h"
+
+#include "mbedtls_transport.h"
+#include "tls_bench.h"
+#include "tls_bench_server.h"
+
+#define BENCH_HOST_NAME    "localhost"
+#define BENCH_PEM_LEN      4096U
+
+typedef struct BenchKeyType
+{
+    const char * pcName;
+    mbedtls_pk_type_t xPkType;
+    mbedtls_ecp_group_id xGroupId;
+    unsigned int uiRsaBits;
+} BenchKeyType_t;
+
+static const BenchKeyType_t pxKeyTypes[] =
+{
+    { "ec_p256",  MBEDTLS_PK_ECKEY, MBEDTLS_ECP_DP_SECP256R1, 0    },
+    { "ec_p384",  MBEDTLS_PK_ECKEY, MBEDTLS_ECP_DP_SECP384R1, 0    },
+    { "rsa_2048", MBEDTLS_PK_RSA,   MBEDTLS_ECP_DP_NONE,      2048 },
+};
+
+typedef struct BenchCredentials
+{
+    char pcCaCert[ BENCH_PEM_LEN ];
+    char pcServerCert[ BENCH_PEM_LEN ];
+    char pcServerKey[ BENCH_PEM_LEN ];
+    char pcDeviceCert[ BENCH_PEM_LEN ];
+    char pcDeviceKey[ BENCH_PEM_LEN ];
+} BenchCredentials_t;
+
+static mbedtls_entropy_context xEntropyCtx;
+static mbedtls_ctr_drbg_context xCtrDrbgCtx;
+
+static const char * pcCurrentKeyType = NULL;
+
+/*-----------------------------------------------------------*/
+
+static int prvGenerateKey( mbedtls_pk_context * pxPkCtx,
+                           const BenchKeyType_t * pxKeyType )
+{
+    int lRslt = mbedtls_pk_setup( pxPkCtx, mbedtls_pk_info_from_type( pxKeyType->xPkType ) );
+
+    if( lRslt == 0 )
+    {
+        if( pxKeyType->xPkType == MBEDTLS_PK_RSA )
+        {
+            lRslt = mbedtls_rsa_gen_key( mbedtls_pk_rsa( *pxPkCtx ), mbedtls_ctr_drbg_random, &xCtrDrbgCtx,
+                                         pxKeyType->uiRsaBits, 65537 );
+        }
+        else
+        {
+            lRslt = mbedtls_ecp_gen_key( pxKeyType->xGroupId, mbedtls_pk_ec( *pxPkCtx ),
+                                         mbedtls_ctr_drbg_random, &xCtrDrbgCtx );
+        }
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvWriteCert( char * pcPem,
+                         mbedtls_pk_context * pxSubjectKey,
+                         const char * pcSubjectName,
+                         mbedtls_pk_context * pxIssuerKey,
+                         const char * pcIssuerName,
+                         int lSerial,
+                         int lIsCa )
+{
+    mbedtls_x509write_cert xCrt;
+    mbedtls_mpi xSerial;
+    int lRslt;
+
+    mbedtls_x509write_crt_init( &xCrt );
+    mbedtls_mpi_init( &xSerial );
+
+    mbedtls_x509write_crt_set_version( &xCrt, MBEDTLS_X509_CRT_VERSION_3 );
+    mbedtls_x509write_crt_set_md_alg( &xCrt, MBEDTLS_MD_SHA256 );
+    mbedtls_x509write_crt_set_subject_key( &xCrt, pxSubjectKey );
+    mbedtls_x509write_crt_set_issuer_key( &xCrt, pxIssuerKey );
+
+    lRslt = mbedtls_x509write_crt_set_subject_name( &xCrt, pcSubjectName );
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509write_crt_set_issuer_name( &xCrt, pcIssuerName );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_mpi_lset( &xSerial, lSerial );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509write_crt_set_serial( &xCrt, &xSerial );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509write_crt_set_validity( &xCrt, "20220101000000", "20491231235959" );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509write_crt_set_basic_constraints( &xCrt, lIsCa, -1 );
+    }
+
+    if( ( lRslt == 0 ) && lIsCa )
+    {
+        lRslt = mbedtls_x509write_crt_set_key_usage( &xCrt, MBEDTLS_X509_KU_KEY_CERT_SIGN | MBEDTLS_X509_KU_CRL_SIGN );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509write_crt_pem( &xCrt, ( unsigned char * ) pcPem, BENCH_PEM_LEN,
+                                           mbedtls_ctr_drbg_random, &xCtrDrbgCtx );
+    }
+
+    mbedtls_mpi_free( &xSerial );
+    mbedtls_x509write_crt_free( &xCrt );
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvGenerateCredentials( const BenchKeyType_t * pxKeyType,
+                                   BenchCredentials_t * pxCreds )
+{
+    mbedtls_pk_context xCaKey;
+    mbedtls_pk_context xServerKey;
+    mbedtls_pk_context xDeviceKey;
+    int lRslt;
+
+    mbedtls_pk_init( &xCaKey );
+    mbedtls_pk_init( &xServerKey );
+    mbedtls_pk_init( &xDeviceKey );
+
+    lRslt = prvGenerateKey( &xCaKey, pxKeyType );
+
+    if( lRslt == 0 )
+    {
+        lRslt = prvGenerateKey( &xServerKey, pxKeyType );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = prvGenerateKey( &xDeviceKey, pxKeyType );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = prvWriteCert( pxCreds->pcCaCert, &xCaKey, "CN=tls_bench_ca",
+                              &xCaKey, "CN=tls_bench_ca", 1, 1 );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = prvWriteCert( pxCreds->pcServerCert, &xServerKey, "CN=" BENCH_HOST_NAME,
+                              &xCaKey, "CN=tls_bench_ca", 2, 0 );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = prvWriteCert( pxCreds->pcDeviceCert, &xDeviceKey, "CN=tls_bench_device",
+                              &xCaKey, "CN=tls_bench_ca", 3, 0 );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_pk_write_key_pem( &xServerKey, ( unsigned char * ) pxCreds->pcServerKey, BENCH_PEM_LEN );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_pk_write_key_pem( &xDeviceKey, ( unsigned char * ) pxCreds->pcDeviceKey, BENCH_PEM_LEN );
+    }
+
+    mbedtls_pk_free( &xCaKey );
+    mbedtls_pk_free( &xServerKey );
+    mbedtls_pk_free( &xDeviceKey );
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Tag each result line from tls_bench.c with the key type under test. */
+static void prvOutputLine( const char * const pcLine )
+{
+    size_t uxLen = strcspn( pcLine, "\r\n" );
+
+    if( ( uxLen > 1 ) && ( pcLine[ 0 ] == '{' ) )
+    {
+        ( void ) printf( "{\"key_type\":\"%s\",%.*s\n", pcCurrentKeyType, ( int ) ( uxLen - 1 ), &( pcLine[ 1 ] ) );
+        ( void ) fflush( stdout );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvStartServer( const BenchCredentials_t * pxCreds,
+                           uint16_t * pusPort,
+                           pid_t * pxServerPid )
+{
+    mbedtls_net_context xListenCtx;
+    struct sockaddr_in xAddr;
+    socklen_t xAddrLen = sizeof( xAddr );
+    int lRslt;
+
+    mbedtls_net_init( &xListenCtx );
+
+    lRslt = mbedtls_net_bind( &xListenCtx, "127.0.0.1", "0", MBEDTLS_NET_PROTO_TCP );
+
+    if( lRslt == 0 )
+    {
+        lRslt = getsockname( xListenCtx.fd, ( struct sockaddr * ) &xAddr, &xAddrLen );
+    }
+
+    if( lRslt == 0 )
+    {
+        *pusPort = ntohs( xAddr.sin_port );
+        *pxServerPid = fork();
+
+        if( *pxServerPid == 0 )
+        {
+            vTlsBenchServe( xListenCtx.fd, pxCreds->pcCaCert, pxCreds->pcServerCert, pxCreds->pcServerKey );
+            _exit( EXIT_FAILURE );
+        }
+        else if( *pxServerPid < 0 )
+        {
+            lRslt = -1;
+        }
+    }
+
+    mbedtls_net_free( &xListenCtx );
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRunKeyType( const BenchKeyType_t * pxKeyType,
+                                 uint32_t ulHandshakes,
+                                 uint32_t ulBulkLen )
+{
+    static BenchCredentials_t xCreds;
+    BaseType_t xSuccess = pdTRUE;
+    NetworkContext_t * pxNetworkContext = NULL;
+    pid_t xServerPid = -1;
+    uint16_t usPort = 0;
+
+    pcCurrentKeyType = pxKeyType->pcName;
+
+    if( prvGenerateCredentials( pxKeyType, &xCreds ) != 0 )
+    {
+        LogError( "Failed to generate %s credentials.", pxKeyType->pcName );
+        xSuccess = pdFALSE;
+    }
+    else if( prvStartServer( &xCreds, &usPort, &xServerPid ) != 0 )
+    {
+        LogError( "Failed to start the benchmark server." );
+        xSuccess = pdFALSE;
+    }
+    else
+    {
+        pxNetworkContext = mbedtls_transport_allocate();
+    }
+
+    if( ( xSuccess == pdTRUE ) && ( pxNetworkContext != NULL ) )
+    {
+        PkiObject_t xPrivateKey = PKI_OBJ_PEM( ( const unsigned char * ) xCreds.pcDeviceKey, strlen( xCreds.pcDeviceKey ) + 1 );
+        PkiObject_t xClientCert = PKI_OBJ_PEM( ( const unsigned char * ) xCreds.pcDeviceCert, strlen( xCreds.pcDeviceCert ) + 1 );
+        PkiObject_t xRootCa = PKI_OBJ_PEM( ( const unsigned char * ) xCreds.pcCaCert, strlen( xCreds.pcCaCert ) + 1 );
+
+        if( mbedtls_transport_configure( pxNetworkContext, NULL, &xPrivateKey,
+                                         &xClientCert, &xRootCa, 1 ) != TLS_TRANSPORT_SUCCESS )
+        {
+            LogError( "Failed to configure the TLS transport." );
+            xSuccess = pdFALSE;
+        }
+        else
+        {
+            xSuccess = xTlsBenchRun( pxNetworkContext, BENCH_HOST_NAME, usPort,
+                                     ulHandshakes, ulBulkLen, prvOutputLine );
+        }
+    }
+    else
+    {
+        xSuccess = pdFALSE;
+    }
+
+    if( pxNetworkContext != NULL )
+    {
+        mbedtls_transport_free( pxNetworkContext );
+    }
+
+    if( xServerPid > 0 )
+    {
+        ( void ) kill( xServerPid, SIGTERM );
+        ( void ) waitpid( xServerPid, NULL, 0 );
+    }
+
+    ( void ) printf( "{\"key_type\":\"%s\",\"test\":\"done\",\"status\":\"%s\"}\n",
+                     pxKeyType->pcName, ( xSuccess == pdTRUE ) ? "ok" : "failed" );
+
+    return xSuccess;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char * pcProgName )
+{
+    ( void ) fprintf( stderr,
+                      "Usage: %s [-n handshakes] [-b bulk_bytes] [-k key_type[,key_type...]]\n"
+                      "    key types: ec_p256, ec_p384, rsa_2048 (default: all)\n",
+                      pcProgName );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( int argc,
+          char ** argv )
+{
+    uint32_t ulHandshakes = TLS_BENCH_DEFAULT_HANDSHAKES;
+    uint32_t ulBulkLen = TLS_BENCH_DEFAULT_BULK_LEN;
+    const char * pcKeyTypes = NULL;
+    BaseType_t xSuccess = pdTRUE;
+    int lOpt;
+
+    while( ( lOpt = getopt( argc, argv, "n:b:k:h" ) ) != -1 )
+    {
+        switch( lOpt )
+        {
+            case 'n':
+                ulHandshakes = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'b':
+                ulBulkLen = ( uint32_t ) strtoul( optarg, NULL, 10 );
+                break;
+
+            case 'k':
+                pcKeyTypes = optarg;
+                break;
+
+            default:
+                prvUsage( argv[ 0 ] );
+                return EXIT_FAILURE;
+        }
+    }
+
+    if( ( ulHandshakes == 0 ) || ( ulBulkLen == 0 ) )
+    {
+        prvUsage( argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    /* A peer closing the connection must surface as EPIPE rather than terminate the process. */
+    ( void ) signal( SIGPIPE, SIG_IGN );
+
+    mbedtls_entropy_init( &xEntropyCtx );
+    mbedtls_ctr_drbg_init( &xCtrDrbgCtx );
+
+    if( mbedtls_ctr_drbg_seed( &xCtrDrbgCtx, mbedtls_entropy_func, &xEntropyCtx,
+                               ( const unsigned char * ) "tls_bench_host", 14 ) != 0 )
+    {
+        LogError( "Failed to seed the rng." );
+        return EXIT_FAILURE;
+    }
+
+    for( size_t i = 0; i < ( sizeof( pxKeyTypes ) / sizeof( pxKeyTypes[ 0 ] ) ); i++ )
+    {
+        const char * pcName = pxKeyTypes[ i ].pcName;
+        const char * pcMatch = ( pcKeyTypes != NULL ) ? strstr( pcKeyTypes, pcName ) : NULL;
+        size_t uxNameLen = strlen( pcName );
+
+        if( ( pcKeyTypes == NULL ) ||
+            ( ( pcMatch != NULL ) &&
+              ( ( pcMatch == pcKeyTypes ) || ( pcMatch[ -1 ] == ',' ) ) &&
+              ( ( pcMatch[ uxNameLen ] == '\0' ) || ( pcMatch[ uxNameLen ] == ',' ) ) ) )
+        {
+            if( prvRunKeyType( &( pxKeyTypes[ i ] ), ulHandshakes, ulBulkLen ) != pdTRUE )
+            {
+                xSuccess = pdFALSE;
+            }
+        }
+    }
+
+    mbedtls_ctr_drbg_free( &xCtrDrbgCtx );
+    mbedtls_entropy_free( &xEntropyCtx );
+
+    return ( xSuccess == pdTRUE ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
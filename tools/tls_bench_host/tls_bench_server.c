@@ -0,0 +1,381 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tls_bench_server.c
+ * @brief mbedtls server for the benchmark protocol described in tls_bench.h.
+ */
+
+#include "logging_levels.h"
+
+#define LOG_LEVEL    LOG_ERROR
+
+#include "logging.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+
+#include "tls_bench_server.h"
+
+#define BENCH_SERVER_BUF_LEN     4096U
+#define BENCH_SERVER_LINE_LEN    64U
+
+typedef struct BenchReader
+{
+    mbedtls_ssl_context * pxSslCtx;
+    unsigned char pucBuf[ BENCH_SERVER_BUF_LEN ];
+    size_t uxStart;
+    size_t uxEnd;
+} BenchReader_t;
+
+/*-----------------------------------------------------------*/
+
+static int prvFill( BenchReader_t * pxReader )
+{
+    int lRslt = 0;
+
+    if( pxReader->uxStart == pxReader->uxEnd )
+    {
+        do
+        {
+            lRslt = mbedtls_ssl_read( pxReader->pxSslCtx, pxReader->pucBuf, BENCH_SERVER_BUF_LEN );
+        }
+        while( ( lRslt == MBEDTLS_ERR_SSL_WANT_READ ) ||
+               ( lRslt == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+        if( lRslt > 0 )
+        {
+            pxReader->uxStart = 0;
+            pxReader->uxEnd = ( size_t ) lRslt;
+            lRslt = 0;
+        }
+        else if( lRslt == 0 )
+        {
+            /* Connection closed by the peer */
+            lRslt = MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+        }
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvReadLine( BenchReader_t * pxReader,
+                        char * pcLine,
+                        size_t uxMaxLen )
+{
+    size_t uxLen = 0;
+    int lRslt = 0;
+
+    while( lRslt == 0 )
+    {
+        lRslt = prvFill( pxReader );
+
+        if( lRslt == 0 )
+        {
+            char cNext = ( char ) pxReader->pucBuf[ pxReader->uxStart++ ];
+
+            if( cNext == '\n' )
+            {
+                pcLine[ uxLen ] = '\0';
+                break;
+            }
+            else if( uxLen < ( uxMaxLen - 1 ) )
+            {
+                pcLine[ uxLen++ ] = cNext;
+            }
+            else
+            {
+                LogError( "Request line too long." );
+                lRslt = -1;
+            }
+        }
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Read uxLen bytes into pucData, or discard them if pucData is NULL. */
+static int prvReadExact( BenchReader_t * pxReader,
+                         unsigned char * pucData,
+                         size_t uxLen )
+{
+    int lRslt = 0;
+
+    while( ( uxLen > 0 ) && ( lRslt == 0 ) )
+    {
+        lRslt = prvFill( pxReader );
+
+        if( lRslt == 0 )
+        {
+            size_t uxAvailable = pxReader->uxEnd - pxReader->uxStart;
+            size_t uxChunk = ( uxLen < uxAvailable ) ? uxLen : uxAvailable;
+
+            if( pucData != NULL )
+            {
+                ( void ) memcpy( pucData, &( pxReader->pucBuf[ pxReader->uxStart ] ), uxChunk );
+                pucData += uxChunk;
+            }
+
+            pxReader->uxStart += uxChunk;
+            uxLen -= uxChunk;
+        }
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvWriteAll( mbedtls_ssl_context * pxSslCtx,
+                        const unsigned char * pucData,
+                        size_t uxLen )
+{
+    int lRslt = 0;
+
+    while( ( uxLen > 0 ) && ( lRslt >= 0 ) )
+    {
+        lRslt = mbedtls_ssl_write( pxSslCtx, pucData, uxLen );
+
+        if( lRslt > 0 )
+        {
+            pucData += lRslt;
+            uxLen -= ( size_t ) lRslt;
+        }
+        else if( ( lRslt == MBEDTLS_ERR_SSL_WANT_READ ) ||
+                 ( lRslt == MBEDTLS_ERR_SSL_WANT_WRITE ) )
+        {
+            lRslt = 0;
+        }
+    }
+
+    return ( lRslt < 0 ) ? lRslt : 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static int prvServeRequests( BenchReader_t * pxReader )
+{
+    static unsigned char pucData[ BENCH_SERVER_BUF_LEN ];
+    char pcLine[ BENCH_SERVER_LINE_LEN ];
+    int lRslt = 0;
+
+    ( void ) memset( pucData, 0x5A, sizeof( pucData ) );
+
+    while( lRslt == 0 )
+    {
+        char cRequest = '\0';
+        unsigned long ulArg1 = 0;
+        unsigned long ulArg2 = 0;
+
+        lRslt = prvReadLine( pxReader, pcLine, sizeof( pcLine ) );
+
+        if( lRslt != 0 )
+        {
+            /* Connection closed */
+        }
+        else if( sscanf( pcLine, "%c %lu %lu", &cRequest, &ulArg1, &ulArg2 ) != 3 )
+        {
+            LogError( "Malformed request: %s", pcLine );
+            lRslt = -1;
+        }
+        else if( cRequest == 'S' )
+        {
+            lRslt = prvReadExact( pxReader, NULL, ulArg1 );
+
+            if( lRslt == 0 )
+            {
+                lRslt = prvWriteAll( pxReader->pxSslCtx, ( const unsigned char * ) "K\n", 2 );
+            }
+        }
+        else if( cRequest == 'E' )
+        {
+            while( ( ulArg1 > 0 ) && ( lRslt == 0 ) )
+            {
+                size_t uxChunk = ( ulArg1 < BENCH_SERVER_BUF_LEN ) ? ulArg1 : BENCH_SERVER_BUF_LEN;
+
+                lRslt = prvWriteAll( pxReader->pxSslCtx, pucData, uxChunk );
+                ulArg1 -= uxChunk;
+            }
+        }
+        else if( ( cRequest == 'P' ) && ( ulArg1 <= BENCH_SERVER_BUF_LEN ) )
+        {
+            for( unsigned long i = 0; ( i < ulArg2 ) && ( lRslt == 0 ); i++ )
+            {
+                lRslt = prvReadExact( pxReader, pucData, ulArg1 );
+
+                if( lRslt == 0 )
+                {
+                    lRslt = prvWriteAll( pxReader->pxSslCtx, pucData, ulArg1 );
+                }
+            }
+        }
+        else
+        {
+            LogError( "Unsupported request: %s", pcLine );
+            lRslt = -1;
+        }
+    }
+
+    return lRslt;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvServeConnection( mbedtls_ssl_context * pxSslCtx )
+{
+    static BenchReader_t xReader;
+    int lRslt;
+
+    do
+    {
+        lRslt = mbedtls_ssl_handshake( pxSslCtx );
+    }
+    while( ( lRslt == MBEDTLS_ERR_SSL_WANT_READ ) ||
+           ( lRslt == MBEDTLS_ERR_SSL_WANT_WRITE ) );
+
+    if( lRslt != 0 )
+    {
+        LogError( "Server handshake failed: -0x%04x", ( unsigned int ) -lRslt );
+    }
+    else
+    {
+        xReader.pxSslCtx = pxSslCtx;
+        xReader.uxStart = 0;
+        xReader.uxEnd = 0;
+
+        lRslt = prvServeRequests( &xReader );
+
+        if( ( lRslt != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ) &&
+            ( lRslt != MBEDTLS_ERR_NET_CONN_RESET ) )
+        {
+            LogError( "Connection ended with error: -0x%04x", ( unsigned int ) -lRslt );
+        }
+
+        ( void ) mbedtls_ssl_close_notify( pxSslCtx );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vTlsBenchServe( int lListenFd,
+                     const char * pcCaCertPem,
+                     const char * pcCertPem,
+                     const char * pcKeyPem )
+{
+    mbedtls_net_context xListenCtx = { .fd = lListenFd };
+    mbedtls_entropy_context xEntropyCtx;
+    mbedtls_ctr_drbg_context xCtrDrbgCtx;
+    mbedtls_ssl_config xSslConfig;
+    mbedtls_ssl_context xSslCtx;
+    mbedtls_x509_crt xCaCert;
+    mbedtls_x509_crt xCert;
+    mbedtls_pk_context xPkCtx;
+    int lRslt;
+
+    mbedtls_entropy_init( &xEntropyCtx );
+    mbedtls_ctr_drbg_init( &xCtrDrbgCtx );
+    mbedtls_ssl_config_init( &xSslConfig );
+    mbedtls_ssl_init( &xSslCtx );
+    mbedtls_x509_crt_init( &xCaCert );
+    mbedtls_x509_crt_init( &xCert );
+    mbedtls_pk_init( &xPkCtx );
+
+    lRslt = mbedtls_ctr_drbg_seed( &xCtrDrbgCtx, mbedtls_entropy_func, &xEntropyCtx,
+                                   ( const unsigned char * ) "tls_bench_server", 16 );
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509_crt_parse( &xCaCert, ( const unsigned char * ) pcCaCertPem, strlen( pcCaCertPem ) + 1 );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_x509_crt_parse( &xCert, ( const unsigned char * ) pcCertPem, strlen( pcCertPem ) + 1 );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_pk_parse_key( &xPkCtx, ( const unsigned char * ) pcKeyPem, strlen( pcKeyPem ) + 1,
+                                      NULL, 0, mbedtls_ctr_drbg_random, &xCtrDrbgCtx );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_ssl_config_defaults( &xSslConfig, MBEDTLS_SSL_IS_SERVER,
+                                             MBEDTLS_SSL_TRANSPORT_STREAM,
+                                             MBEDTLS_SSL_PRESET_DEFAULT );
+    }
+
+    if( lRslt == 0 )
+    {
+        mbedtls_ssl_conf_rng( &xSslConfig, mbedtls_ctr_drbg_random, &xCtrDrbgCtx );
+        mbedtls_ssl_conf_authmode( &xSslConfig, MBEDTLS_SSL_VERIFY_REQUIRED );
+        mbedtls_ssl_conf_ca_chain( &xSslConfig, &xCaCert, NULL );
+
+        lRslt = mbedtls_ssl_conf_own_cert( &xSslConfig, &xCert, &xPkCtx );
+    }
+
+    if( lRslt == 0 )
+    {
+        lRslt = mbedtls_ssl_setup( &xSslCtx, &xSslConfig );
+    }
+
+    if( lRslt != 0 )
+    {
+        LogError( "Failed to set up the benchmark server: -0x%04x", ( unsigned int ) -lRslt );
+        exit( EXIT_FAILURE );
+    }
+
+    for( ; ; )
+    {
+        mbedtls_net_context xClientCtx;
+
+        mbedtls_net_init( &xClientCtx );
+
+        lRslt = mbedtls_net_accept( &xListenCtx, &xClientCtx, NULL, 0, NULL );
+
+        if( lRslt != 0 )
+        {
+            LogError( "Failed to accept a connection: -0x%04x", ( unsigned int ) -lRslt );
+            exit( EXIT_FAILURE );
+        }
+
+        mbedtls_ssl_set_bio( &xSslCtx, &xClientCtx, mbedtls_net_send, mbedtls_net_recv, NULL );
+
+        prvServeConnection( &xSslCtx );
+
+        mbedtls_net_free( &xClientCtx );
+        ( void ) mbedtls_ssl_session_reset( &xSslCtx );
+    }
+}
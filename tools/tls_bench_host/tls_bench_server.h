@@ -0,0 +1,47 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ * Copyright (C) 2022 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file tls_bench_server.h
+ * @brief mbedtls server for the benchmark protocol described in tls_bench.h.
+ */
+
+#ifndef _TLS_BENCH_SERVER_H_
+#define _TLS_BENCH_SERVER_H_
+
+/**
+ * @brief Accept connections on a listening socket and serve the benchmark
+ * protocol, one connection at a time. Does not return.
+ *
+ * Clients must present a certificate signed by pcCaCertPem.
+ *
+ * @param[in] lListenFd Listening TCP socket.
+ * @param[in] pcCaCertPem NUL terminated PEM CA certificate.
+ * @param[in] pcCertPem NUL terminated PEM server certificate.
+ * @param[in] pcKeyPem NUL terminated PEM server private key.
+ */
+void vTlsBenchServe( int lListenFd,
+                     const char * pcCaCertPem,
+                     const char * pcCertPem,
+                     const char * pcKeyPem );
+
+#endif /* _TLS_BENCH_SERVER_H_ */